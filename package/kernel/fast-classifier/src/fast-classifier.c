@@ -799,6 +799,47 @@ static int fast_classifier_nl_genl_msg_DUMP(struct sk_buff *skb,
 /* auto offload connection once we have this many packets*/
 static int offload_at_pkts = 128;
 
+/*
+ * Policer profiles.
+ *
+ * Connections whose conntrack mark matches a profile are policed by the SFE
+ * at the profile's rates, so that policing by connmark still applies once
+ * they are offloaded.  Rates are in bytes per second and bursts in bytes.
+ */
+#define FAST_CL_POLICE_PROFILES_MAX 16
+
+struct fast_classifier_police_profile {
+	u32 mark;			/* Conntrack mark, masked */
+	u32 mask;			/* Bits of the conntrack mark to compare */
+	struct sfe_police_cfg original;	/* Policer of the original direction */
+	struct sfe_police_cfg reply;	/* Policer of the reply direction */
+};
+
+static DEFINE_SPINLOCK(police_profiles_lock);
+static struct fast_classifier_police_profile police_profiles[FAST_CL_POLICE_PROFILES_MAX];
+static int police_profiles_count;
+
+/*
+ * fast_classifier_police_get()
+ *	Police a connection as the first profile its conntrack mark matches says, if any.
+ */
+static void fast_classifier_police_get(struct nf_conn *ct, struct sfe_connection_create *p_sic)
+{
+#ifdef CONFIG_NF_CONNTRACK_MARK
+	int i;
+
+	spin_lock_bh(&police_profiles_lock);
+	for (i = 0; i < police_profiles_count; i++) {
+		if ((ct->mark & police_profiles[i].mask) == police_profiles[i].mark) {
+			p_sic->src_police = police_profiles[i].original;
+			p_sic->dest_police = police_profiles[i].reply;
+			break;
+		}
+	}
+	spin_unlock_bh(&police_profiles_lock);
+#endif
+}
+
 /*
  * fast_classifier_post_routing()
  *	Called for packets about to leave the box - either locally generated or forwarded from another interface
@@ -1156,6 +1197,8 @@ static unsigned int fast_classifier_post_routing(struct sk_buff *skb, bool is_v4
 	}
 	sic.mark = skb->mark;
 
+	fast_classifier_police_get(ct, &sic);
+
 	conn = kmalloc(sizeof(*conn), GFP_ATOMIC);
 	if (!conn) {
 		printk(KERN_CRIT "ERROR: no memory for sfe\n");
@@ -1722,6 +1765,95 @@ static ssize_t fast_classifier_get_exceptions(struct device *dev,
 	return len;
 }
 
+/*
+ * fast_classifier_get_police_profiles()
+ *	dump policer profiles
+ */
+static ssize_t fast_classifier_get_police_profiles(struct device *dev,
+						   struct device_attribute *attr,
+						   char *buf)
+{
+	struct fast_classifier_police_profile *pp;
+	size_t len = 0;
+	int i;
+
+	spin_lock_bh(&police_profiles_lock);
+	for (i = 0; i < police_profiles_count; i++) {
+		pp = &police_profiles[i];
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%08x/%08x %llu %u %llu %u %u %u\n",
+				 pp->mark, pp->mask,
+				 pp->original.rate, pp->original.burst,
+				 pp->reply.rate, pp->reply.burst,
+				 pp->original.action, pp->original.dscp);
+	}
+	spin_unlock_bh(&police_profiles_lock);
+
+	return len;
+}
+
+/*
+ * fast_classifier_set_police_profiles()
+ *	add, change or remove a policer profile
+ *
+ * Takes "mark/mask rate burst reply_rate reply_burst action dscp", the mark
+ * and mask in hex.  A profile with both rates 0 is removed.  Connections
+ * that are already offloaded keep the policers they were created with.
+ */
+static ssize_t fast_classifier_set_police_profiles(struct device *dev,
+						   struct device_attribute *attr,
+						   const char *buf, size_t size)
+{
+	struct fast_classifier_police_profile *pp;
+	u32 mark, mask, burst, reply_burst, action, dscp;
+	u64 rate, reply_rate;
+	int i;
+
+	if (sscanf(buf, "%x/%x %llu %u %llu %u %u %u", &mark, &mask, &rate, &burst,
+		   &reply_rate, &reply_burst, &action, &dscp) != 8)
+		return -EINVAL;
+
+	if ((action > SFE_POLICE_ACTION_REMARK_DSCP) || (dscp > 0x3f))
+		return -EINVAL;
+
+	mark &= mask;
+
+	spin_lock_bh(&police_profiles_lock);
+	for (i = 0; i < police_profiles_count; i++) {
+		if ((police_profiles[i].mark == mark) && (police_profiles[i].mask == mask))
+			break;
+	}
+
+	if (!rate && !reply_rate) {
+		if (i < police_profiles_count)
+			police_profiles[i] = police_profiles[--police_profiles_count];
+		spin_unlock_bh(&police_profiles_lock);
+		return size;
+	}
+
+	if (i == police_profiles_count) {
+		if (police_profiles_count == FAST_CL_POLICE_PROFILES_MAX) {
+			spin_unlock_bh(&police_profiles_lock);
+			return -ENOSPC;
+		}
+		police_profiles_count++;
+	}
+
+	pp = &police_profiles[i];
+	pp->mark = mark;
+	pp->mask = mask;
+	pp->original.rate = rate;
+	pp->original.burst = burst;
+	pp->original.action = action;
+	pp->original.dscp = dscp;
+	pp->reply.rate = reply_rate;
+	pp->reply.burst = reply_burst;
+	pp->reply.action = action;
+	pp->reply.dscp = dscp;
+	spin_unlock_bh(&police_profiles_lock);
+
+	return size;
+}
+
 /*
  * sysfs attributes.
  */
@@ -1733,6 +1865,8 @@ static const struct device_attribute fast_classifier_skip_bridge_ingress =
 	__ATTR(skip_to_bridge_ingress, S_IWUSR | S_IRUGO, fast_classifier_get_skip_bridge_ingress, fast_classifier_set_skip_bridge_ingress);
 static const struct device_attribute fast_classifier_exceptions_attr =
 	__ATTR(exceptions, S_IRUGO, fast_classifier_get_exceptions, NULL);
+static const struct device_attribute fast_classifier_police_profiles_attr =
+	__ATTR(police_profiles, S_IWUSR | S_IRUGO, fast_classifier_get_police_profiles, fast_classifier_set_police_profiles);
 
 /*
  * fast_classifier_init()
@@ -1786,6 +1920,16 @@ static int __init fast_classifier_init(void)
 		goto exit2;
 	}
 
+	result = sysfs_create_file(sc->sys_fast_classifier, &fast_classifier_police_profiles_attr.attr);
+	if (result) {
+		DEBUG_ERROR("failed to register police profiles file: %d\n", result);
+		sysfs_remove_file(sc->sys_fast_classifier, &fast_classifier_offload_at_pkts_attr.attr);
+		sysfs_remove_file(sc->sys_fast_classifier, &fast_classifier_debug_info_attr.attr);
+		sysfs_remove_file(sc->sys_fast_classifier, &fast_classifier_skip_bridge_ingress.attr);
+		sysfs_remove_file(sc->sys_fast_classifier, &fast_classifier_exceptions_attr.attr);
+		goto exit2;
+	}
+
 	sc->dev_notifier.notifier_call = fast_classifier_device_event;
 	sc->dev_notifier.priority = 1;
 	register_netdevice_notifier(&sc->dev_notifier);
@@ -1891,6 +2035,7 @@ exit3:
 	sysfs_remove_file(sc->sys_fast_classifier, &fast_classifier_debug_info_attr.attr);
 	sysfs_remove_file(sc->sys_fast_classifier, &fast_classifier_skip_bridge_ingress.attr);
 	sysfs_remove_file(sc->sys_fast_classifier, &fast_classifier_exceptions_attr.attr);
+	sysfs_remove_file(sc->sys_fast_classifier, &fast_classifier_police_profiles_attr.attr);
 
 exit2:
 	kobject_put(sc->sys_fast_classifier);
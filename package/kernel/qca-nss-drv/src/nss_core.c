@@ -27,6 +27,7 @@
 #include <nss_hal.h>
 #include <net/dst.h>
 #include <linux/etherdevice.h>
+#include <net/xfrm.h>
 #include "nss_tx_rx_common.h"
 #include "nss_data_plane.h"
 
@@ -59,6 +60,26 @@ static int max_ipv6_conn = NSS_DEFAULT_NUM_CONN;
 module_param(max_ipv6_conn, int, S_IRUGO);
 MODULE_PARM_DESC(max_ipv6_conn, "Max number of IPv6 connections");
 
+static int nss_h2n_batch = 16;
+module_param(nss_h2n_batch, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(nss_h2n_batch, "Max H2N descriptors held back within a packet burst, 1 to disable");
+
+static int nss_h2n_batch_usecs = 50;
+module_param(nss_h2n_batch_usecs, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(nss_h2n_batch_usecs, "Max time H2N descriptors are held back within a packet burst");
+
+static int nss_napi_moderation = 1;
+module_param(nss_napi_moderation, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(nss_napi_moderation, "Adaptive N2H interrupt moderation, 0 to re-enable interrupts straight away");
+
+static int nss_napi_busy_poll_usecs;
+module_param(nss_napi_busy_poll_usecs, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(nss_napi_busy_poll_usecs, "Time NAPI keeps polling after the last work found, 0 to disable");
+
+static int nss_buf_pool_size = 512;
+module_param(nss_buf_pool_size, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(nss_buf_pool_size, "Number of empty buffers kept mapped ahead of time per NSS core");
+
 /*
  * Atomic variables to control jumbo_mru & paged_mode
  */
@@ -79,6 +100,16 @@ struct nss_rx_cb_list {
 
 static struct nss_rx_cb_list nss_rx_interface_handlers[NSS_MAX_NET_INTERFACES];
 
+/*
+ * Empty buffer pool state, kept in the cb of pooled buffers
+ */
+struct nss_core_buf_pool_cb {
+	dma_addr_t buffer;		/* DMA address of the buffer */
+	uint16_t buffer_len;		/* Length of the buffer mapped for the NSS */
+};
+
+#define NSS_CORE_BUF_POOL_CB(skb) ((struct nss_core_buf_pool_cb *)(skb)->cb)
+
 /*
  * nss_core_update_max_ipv4_conn()
  *	Update the maximum number of configured IPv4 connections
@@ -808,7 +839,7 @@ static inline void nss_core_rx_pbuf(struct nss_ctx_instance *nss_ctx, struct n2h
 		 * Kraits dma_map_single() does not allocate any resource and hence unmap is a
 		 * NOP and does not have to free up any resource.
 		 */
-		dev_kfree_skb_any(nbuf);
+		nss_core_buf_pool_recycle(nss_ctx, nbuf);
 		break;
 
 	case N2H_BUFFER_CRYPTO_RESP:
@@ -1109,9 +1140,27 @@ static inline bool nss_core_handle_linear_skb(struct nss_ctx_instance *nss_ctx,
 	return true;
 }
 
+/*
+ * nss_core_n2h_writeback()
+ *	Gives the descriptors we have consumed on an N2H queue back to the NSS
+ */
+static inline void nss_core_n2h_writeback(struct nss_ctx_instance *nss_ctx, uint16_t qid)
+{
+	struct nss_if_mem_map *if_map = (struct nss_if_mem_map *)nss_ctx->vmap;
+	struct hlos_n2h_desc_ring *n2h_desc_ring = &nss_ctx->n2h_desc_ring[qid];
+
+	if_map->n2h_hlos_index[qid] = n2h_desc_ring->hlos_index;
+	n2h_desc_ring->unflushed = 0;
+	NSS_PKT_STATS_INCREMENT(nss_ctx, &nss_ctx->nss_top->stats_drv[NSS_STATS_DRV_RX_INDEX_WRITE]);
+}
+
 /*
  * nss_core_handle_cause_queue()
  *	Handle interrupt cause related to N2H/H2N queues
+ *
+ * The index is only written back to the NSS once a quarter of the ring has
+ * been consumed; nss_core_handle_napi() writes back the rest at the end of
+ * the poll.
  */
 static int32_t nss_core_handle_cause_queue(struct int_ctx_instance *int_ctx, uint16_t cause, int16_t weight)
 {
@@ -1276,7 +1325,14 @@ next:
 	}
 
 	n2h_desc_ring->hlos_index = hlos_index;
-	if_map->n2h_hlos_index[qid] = hlos_index;
+	n2h_desc_ring->unflushed += count;
+	if (unlikely(n2h_desc_ring->unflushed >= (size >> 2))) {
+		nss_core_n2h_writeback(nss_ctx, qid);
+		int_ctx->n2h_writeback &= ~(1 << qid);
+	} else {
+		int_ctx->n2h_writeback |= (1 << qid);
+	}
+
 	return count;
 }
 
@@ -1313,9 +1369,12 @@ static void nss_core_init_nss(struct nss_ctx_instance *nss_ctx, struct nss_if_me
 		h2n_desc_ring->desc_ring.desc = (struct h2n_descriptor *)(nss_ctx->vmap + if_map->h2n_desc_if[i].desc_addr - nss_ctx->vphys);
 		h2n_desc_ring->desc_ring.size = if_map->h2n_desc_if[i].size;
 		h2n_desc_ring->hlos_index = if_map->h2n_hlos_index[i];
-		spin_lock_init(&h2n_desc_ring->lock);
+		atomic_set(&h2n_desc_ring->reserve_index, h2n_desc_ring->hlos_index);
+		h2n_desc_ring->unpublished = 0;
 	}
 
+	nss_core_send_init(nss_ctx);
+
 	nss_ctx->c2c_start = if_map->c2c_start;
 
 	nss_top = nss_ctx->nss_top;
@@ -1500,21 +1559,35 @@ static void nss_core_handle_cause_nonqueue(struct int_ctx_instance *int_ctx, uin
 				desc->payload_offs = (uint16_t) (nbuf->data - nbuf->head);
 
 			} else {
-				nbuf = dev_alloc_skb(max_buf_size);
-				if (unlikely(!nbuf)) {
+				/*
+				 * Buffers from the pool are already mapped
+				 */
+				payload_len = max_buf_size + NET_SKB_PAD;
+				nbuf = nss_core_buf_pool_get(nss_ctx, &buffer, &payload_len);
+				if (likely(nbuf)) {
+					NSS_PKT_STATS_INCREMENT(nss_ctx, &nss_top->stats_drv[NSS_STATS_DRV_BUF_POOL_HIT]);
+				} else {
+					ktime_t start = ktime_get();
+
+					nbuf = dev_alloc_skb(max_buf_size);
+					if (unlikely(!nbuf)) {
+						/*
+						 * ERR:
+						 */
+						NSS_PKT_STATS_INCREMENT(nss_ctx, &nss_top->stats_drv[NSS_STATS_DRV_NBUF_ALLOC_FAILS]);
+						nss_warning("%p: Could not obtain empty buffer", nss_ctx);
+						break;
+					}
+
 					/*
-					 * ERR:
+					 * Map the skb
 					 */
-					NSS_PKT_STATS_INCREMENT(nss_ctx, &nss_top->stats_drv[NSS_STATS_DRV_NBUF_ALLOC_FAILS]);
-					nss_warning("%p: Could not obtain empty buffer", nss_ctx);
-					break;
+					buffer = dma_map_single(nss_ctx->dev, nbuf->head, payload_len, DMA_FROM_DEVICE);
+					NSS_PKT_STATS_INCREMENT(nss_ctx, &nss_top->stats_drv[NSS_STATS_DRV_BUF_POOL_MISS]);
+					NSS_PKT_STATS_ADD(nss_ctx, &nss_top->stats_drv[NSS_STATS_DRV_BUF_POOL_MISS_NS],
+						ktime_to_ns(ktime_sub(ktime_get(), start)));
 				}
 
-				/*
-				 * Map the skb
-				 */
-				payload_len = max_buf_size + NET_SKB_PAD;
-				buffer = dma_map_single(nss_ctx->dev, nbuf->head, payload_len, DMA_FROM_DEVICE);
 				desc->buffer_len = payload_len;
 				desc->payload_offs = (uint16_t) (nbuf->data - nbuf->head);
 			}
@@ -1549,6 +1622,10 @@ static void nss_core_handle_cause_nonqueue(struct int_ctx_instance *int_ctx, uin
 		 */
 		nss_hal_send_interrupt(nss_ctx, NSS_H2N_INTR_EMPTY_BUFFER_QUEUE);
 		NSS_PKT_STATS_INCREMENT(nss_ctx, &nss_top->stats_drv[NSS_STATS_DRV_TX_EMPTY]);
+
+		if (!paged_mode && !jumbo_mru) {
+			nss_core_buf_pool_schedule_refill(nss_ctx);
+		}
 	} else if (cause == NSS_N2H_INTR_TX_UNBLOCKED) {
 		nss_trace("%p: Data queue unblocked", nss_ctx);
 
@@ -1646,9 +1723,176 @@ static uint32_t nss_core_get_prioritized_cause(uint32_t cause, uint32_t *type, i
 	return 0;
 }
 
+/*
+ * Delays before interrupts are re-enabled at each moderation level
+ */
+const uint32_t nss_core_napi_mod_usecs[NSS_CORE_NAPI_MOD_LEVELS] = {0, 8, 16, 32, 64, 128};
+
+/*
+ * Polls per moderation epoch, epochs spent tuning before settling and the
+ * interrupt rate below which interrupts are never held back.
+ */
+#define NSS_CORE_NAPI_EPOCH_POLLS 64
+#define NSS_CORE_NAPI_TUNING_EPOCHS 8
+#define NSS_CORE_NAPI_LOW_IRQ_RATE 1000
+
+/*
+ * nss_core_napi_hist_bucket()
+ */
+static inline uint32_t nss_core_napi_hist_bucket(uint64_t val)
+{
+	return min_t(uint32_t, fls64(val), NSS_CORE_NAPI_HIST_BUCKETS - 1);
+}
+
+/*
+ * nss_core_napi_mod_compare()
+ *	Tells whether curr is a better (1), worse (-1) or same (0) load than prev
+ *
+ * Packet rate comes first, then packets per interrupt and then poll time per
+ * packet. Differences under 10% are noise.
+ */
+static int nss_core_napi_mod_compare(struct nss_core_napi_sample *curr, struct nss_core_napi_sample *prev)
+{
+#define NSS_CORE_NAPI_DIFFERS(a, b) (((a) > (b) ? (a) - (b) : (b) - (a)) * 10 > max((a), (b)))
+	if (NSS_CORE_NAPI_DIFFERS(curr->pkt_rate, prev->pkt_rate)) {
+		return (curr->pkt_rate > prev->pkt_rate) ? 1 : -1;
+	}
+
+	if (NSS_CORE_NAPI_DIFFERS(curr->pkts_per_irq, prev->pkts_per_irq)) {
+		return (curr->pkts_per_irq > prev->pkts_per_irq) ? 1 : -1;
+	}
+
+	if (NSS_CORE_NAPI_DIFFERS(curr->ns_per_pkt, prev->ns_per_pkt)) {
+		return (curr->ns_per_pkt < prev->ns_per_pkt) ? 1 : -1;
+	}
+#undef NSS_CORE_NAPI_DIFFERS
+
+	return 0;
+}
+
+/*
+ * nss_core_napi_mod_tune()
+ *	Moves the moderation delay one level in the direction that pays off
+ *
+ * As net_dim does, a settled context starts tuning again when its load
+ * changes, turns back when a step made things worse and settles once it runs
+ * into either end or has been tuning for too long.
+ */
+static void nss_core_napi_mod_tune(struct nss_core_napi_mod *mod, struct nss_core_napi_sample *curr, uint32_t irq_rate)
+{
+	int cmp = nss_core_napi_mod_compare(curr, &mod->prev);
+	int level;
+
+	/*
+	 * At low rates holding interrupts back only adds latency
+	 */
+	if (irq_rate < NSS_CORE_NAPI_LOW_IRQ_RATE) {
+		mod->level = 0;
+		mod->step = 0;
+		return;
+	}
+
+	if (!mod->step) {
+		if (!cmp) {
+			return;
+		}
+
+		mod->step = (mod->level < NSS_CORE_NAPI_MOD_LEVELS - 1) ? 1 : -1;
+		mod->tuning_epochs = 0;
+	} else {
+		if (cmp < 0) {
+			mod->step = -mod->step;
+		}
+
+		if (++mod->tuning_epochs > NSS_CORE_NAPI_TUNING_EPOCHS) {
+			mod->step = 0;
+			return;
+		}
+	}
+
+	level = mod->level + mod->step;
+	if ((level < 0) || (level >= NSS_CORE_NAPI_MOD_LEVELS)) {
+		mod->step = 0;
+		return;
+	}
+
+	mod->level = level;
+}
+
+/*
+ * nss_core_napi_mod_epoch()
+ *	Samples the load of an epoch and tunes the moderation delay from it
+ */
+static void nss_core_napi_mod_epoch(struct nss_core_napi_mod *mod, ktime_t now)
+{
+	struct nss_core_napi_sample curr;
+	uint64_t elapsed_us = max_t(int64_t, ktime_us_delta(now, mod->epoch_start), 1);
+	uint32_t irqs = max_t(uint32_t, mod->epoch_irqs, 1);
+	uint32_t pkts = max_t(uint32_t, mod->epoch_pkts, 1);
+	uint32_t irq_rate;
+
+	curr.pkt_rate = div64_u64((uint64_t)mod->epoch_pkts * USEC_PER_MSEC, elapsed_us);
+	curr.pkts_per_irq = mod->epoch_pkts / irqs;
+	curr.ns_per_pkt = div_u64(mod->epoch_poll_ns, pkts);
+	irq_rate = div64_u64((uint64_t)mod->epoch_irqs * USEC_PER_SEC, elapsed_us);
+
+	mod->hist_irq_rate[nss_core_napi_hist_bucket(irq_rate)]++;
+	mod->hist_level[mod->level]++;
+
+	if (nss_napi_moderation) {
+		nss_core_napi_mod_tune(mod, &curr, irq_rate);
+	}
+
+	mod->prev = curr;
+	mod->epoch_start = now;
+	mod->epoch_polls = 0;
+	mod->epoch_irqs = 0;
+	mod->epoch_pkts = 0;
+	mod->epoch_poll_ns = 0;
+}
+
+/*
+ * nss_core_napi_mod_timer()
+ *	Re-enables the interrupt once the moderation delay is over
+ */
+static enum hrtimer_restart nss_core_napi_mod_timer(struct hrtimer *timer)
+{
+	struct int_ctx_instance *int_ctx = container_of(timer, struct int_ctx_instance, mod.timer);
+
+	nss_hal_enable_interrupt(int_ctx->nss_ctx, int_ctx->shift_factor, NSS_HAL_SUPPORTED_INTERRUPTS);
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * nss_core_napi_init()
+ *	Sets up interrupt moderation for an interrupt context
+ */
+void nss_core_napi_init(struct int_ctx_instance *int_ctx)
+{
+	struct nss_core_napi_mod *mod = &int_ctx->mod;
+
+	memset(mod, 0, sizeof(*mod));
+	hrtimer_init(&mod->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	mod->timer.function = nss_core_napi_mod_timer;
+	mod->epoch_start = ktime_get();
+}
+
+/*
+ * nss_core_napi_cleanup()
+ *	Stops interrupt moderation for an interrupt context
+ */
+void nss_core_napi_cleanup(struct int_ctx_instance *int_ctx)
+{
+	hrtimer_cancel(&int_ctx->mod.timer);
+}
+
 /*
  * nss_core_handle_napi()
  *	NAPI handler for NSS
+ *
+ * Once all causes are handled the interrupt is re-enabled after the delay
+ * picked by the moderation engine. With nss_napi_busy_poll_usecs set, NAPI
+ * first keeps polling for that long after the last work it found.
  */
 int nss_core_handle_napi(struct napi_struct *napi, int budget)
 {
@@ -1657,8 +1901,18 @@ int nss_core_handle_napi(struct napi_struct *napi, int budget)
 	struct netdev_priv_instance *ndev_priv = netdev_priv(napi->dev);
 	struct int_ctx_instance *int_ctx = ndev_priv->int_ctx;
 	struct nss_ctx_instance *nss_ctx = int_ctx->nss_ctx;
+	struct nss_core_napi_mod *mod = &int_ctx->mod;
+	int poll_budget = budget;
+	ktime_t start, now;
+	uint32_t usecs;
 	bool invalid_cause;
 
+	start = ktime_get();
+	if (ktime_to_ns(mod->irq_time)) {
+		mod->hist_latency[nss_core_napi_hist_bucket(ktime_us_delta(start, mod->irq_time))]++;
+		mod->irq_time = ktime_set(0, 0);
+	}
+
 	/*
 	 * Read cause of interrupt
 	 */
@@ -1730,13 +1984,52 @@ int nss_core_handle_napi(struct napi_struct *napi, int budget)
 		int_ctx->cause |= int_cause;
 	} while ((int_ctx->cause) && (budget));
 
+	/*
+	 * Write back the N2H indexes held back during the poll, before the
+	 * NSS can interrupt us again.
+	 */
+	while (int_ctx->n2h_writeback) {
+		uint16_t qid = ffs(int_ctx->n2h_writeback) - 1;
+
+		nss_core_n2h_writeback(nss_ctx, qid);
+		int_ctx->n2h_writeback &= ~(1 << qid);
+	}
+
+	now = ktime_get();
+	mod->hist_pkts[nss_core_napi_hist_bucket(count)]++;
+	mod->epoch_pkts += count;
+	mod->epoch_poll_ns += ktime_to_ns(ktime_sub(now, start));
+	if (++mod->epoch_polls >= NSS_CORE_NAPI_EPOCH_POLLS) {
+		nss_core_napi_mod_epoch(mod, now);
+	}
+
+	if (count) {
+		mod->last_work = now;
+	}
+
 	if (int_ctx->cause == 0) {
+		/*
+		 * Stay scheduled, with the interrupt masked, while within the busy
+		 * poll window. NAPI only polls us again if we use up our budget.
+		 */
+		if (unlikely(nss_napi_busy_poll_usecs) &&
+				ktime_us_delta(now, mod->last_work) < nss_napi_busy_poll_usecs) {
+			mod->busy_polls++;
+			return poll_budget;
+		}
+
 		napi_complete(napi);
 
 		/*
-		 * Re-enable any further interrupt from this IRQ
+		 * Re-enable any further interrupt from this IRQ, once the
+		 * moderation delay is over
 		 */
-		nss_hal_enable_interrupt(nss_ctx, int_ctx->shift_factor, NSS_HAL_SUPPORTED_INTERRUPTS);
+		usecs = nss_napi_moderation ? nss_core_napi_mod_usecs[mod->level] : 0;
+		if (usecs) {
+			hrtimer_start(&mod->timer, ns_to_ktime(usecs * NSEC_PER_USEC), HRTIMER_MODE_REL);
+		} else {
+			nss_hal_enable_interrupt(nss_ctx, int_ctx->shift_factor, NSS_HAL_SUPPORTED_INTERRUPTS);
+		}
 	}
 
 	return count;
@@ -1786,6 +2079,21 @@ static inline void nss_core_send_unwind_dma(struct device *dev, struct h2n_desc_
 	}
 }
 
+/*
+ * nss_core_skb_xmit_more()
+ *	Returns true if the stack has more packets for the device right behind nbuf
+ */
+static inline bool nss_core_skb_xmit_more(struct sk_buff *nbuf)
+{
+#if ((LINUX_VERSION_CODE >= KERNEL_VERSION(3, 18, 0)) && (LINUX_VERSION_CODE < KERNEL_VERSION(5, 2, 0)))
+	return nbuf->xmit_more;
+#elif (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 2, 0))
+	return netdev_xmit_more();
+#else
+	return false;
+#endif
+}
+
 /*
  * nss_core_skb_tail_offset()
  */
@@ -1950,33 +2258,193 @@ void nss_skb_recycle(struct sk_buff *nbuf)
 #endif
 
 /*
- * nss_core_send_buffer_simple_skb()
- *	Sends one skb to NSS FW
+ * nss_core_buf_pool_add()
+ *	Maps an empty buffer for the NSS and adds it to the pool
  */
-static inline int32_t nss_core_send_buffer_simple_skb(struct nss_ctx_instance *nss_ctx,
-	struct h2n_desc_if_instance *desc_if, uint32_t if_num,
-	struct sk_buff *nbuf, uint16_t hlos_index, uint16_t flags, uint8_t buffer_type, uint16_t mss)
+static bool nss_core_buf_pool_add(struct nss_ctx_instance *nss_ctx, struct sk_buff *nbuf)
 {
-	struct h2n_descriptor *desc_ring = desc_if->desc;
-	struct h2n_descriptor *desc;
-	uint16_t bit_flags;
-	uint16_t mask;
-	uint32_t frag0phyaddr;
+	uint16_t buffer_len = nss_ctx->max_buf_size + NET_SKB_PAD;
+	dma_addr_t buffer;
+
+	buffer = dma_map_single(nss_ctx->dev, nbuf->head, buffer_len, DMA_FROM_DEVICE);
+	if (unlikely(dma_mapping_error(nss_ctx->dev, buffer))) {
+		nss_warning("%p: DMA mapping failed for pooled empty buffer", nss_ctx);
+		return false;
+	}
+
+	NSS_CORE_BUF_POOL_CB(nbuf)->buffer = buffer;
+	NSS_CORE_BUF_POOL_CB(nbuf)->buffer_len = buffer_len;
+	skb_queue_tail(&nss_ctx->buf_pool, nbuf);
+	return true;
+}
+
+/*
+ * nss_core_buf_pool_refill()
+ *	Tops the empty buffer pool up from process context
+ */
+static void nss_core_buf_pool_refill(struct work_struct *work)
+{
+	struct nss_ctx_instance *nss_ctx = container_of(work, struct nss_ctx_instance, buf_pool_refill);
+	struct sk_buff *nbuf;
+
+	while (skb_queue_len(&nss_ctx->buf_pool) < nss_buf_pool_size) {
+		nbuf = __dev_alloc_skb(nss_ctx->max_buf_size, GFP_KERNEL);
+		if (unlikely(!nbuf)) {
+			NSS_PKT_STATS_INCREMENT(nss_ctx, &nss_ctx->nss_top->stats_drv[NSS_STATS_DRV_NBUF_ALLOC_FAILS]);
+			return;
+		}
+
+		if (unlikely(!nss_core_buf_pool_add(nss_ctx, nbuf))) {
+			dev_kfree_skb_any(nbuf);
+			return;
+		}
+	}
+}
+
+/*
+ * nss_core_buf_pool_get()
+ *	Takes an empty buffer, already mapped, from the pool
+ *
+ * buffer_len is the least length the buffer must have and is updated with
+ * the length it was mapped for. Buffers mapped before max_buf_size grew are
+ * dropped. Returns NULL once the pool is empty.
+ */
+struct sk_buff *nss_core_buf_pool_get(struct nss_ctx_instance *nss_ctx, dma_addr_t *buffer, uint16_t *buffer_len)
+{
+	struct nss_core_buf_pool_cb *cb;
+	struct sk_buff *nbuf;
+
+	while ((nbuf = skb_dequeue(&nss_ctx->buf_pool))) {
+		cb = NSS_CORE_BUF_POOL_CB(nbuf);
+		if (likely(cb->buffer_len >= *buffer_len)) {
+			*buffer = cb->buffer;
+			*buffer_len = cb->buffer_len;
+			memset(nbuf->cb, 0, sizeof(nbuf->cb));
+			return nbuf;
+		}
+
+		dma_unmap_single(nss_ctx->dev, cb->buffer, cb->buffer_len, DMA_FROM_DEVICE);
+		dev_kfree_skb_any(nbuf);
+	}
+
+	return NULL;
+}
+
+/*
+ * nss_core_buf_pool_schedule_refill()
+ *	Tops the pool up in the background once it is half empty
+ */
+void nss_core_buf_pool_schedule_refill(struct nss_ctx_instance *nss_ctx)
+{
+	if (skb_queue_len(&nss_ctx->buf_pool) < (nss_buf_pool_size >> 1)) {
+		schedule_work(&nss_ctx->buf_pool_refill);
+	}
+}
 
+/*
+ * nss_core_buf_pool_recycle()
+ *	Puts a buffer the NSS has returned back in the pool, or frees it
+ *
+ * Unlike transmit buffer reuse (see nss_skb_can_recycle()) this runs once the
+ * NSS is done with the buffer, in the context it would have been freed in
+ * anyway. Socket, conntrack and xfrm state can be released here just as a
+ * free would, so buffers holding them are recycled too.
+ */
+void nss_core_buf_pool_recycle(struct nss_ctx_instance *nss_ctx, struct sk_buff *nbuf)
+{
 #if (NSS_SKB_RECYCLE_SUPPORT == 1)
-	uint16_t sz;
+	uint32_t min_skb_size = SKB_DATA_ALIGN(nss_ctx->max_buf_size + NET_SKB_PAD);
+
+	if (skb_queue_len(&nss_ctx->buf_pool) >= nss_buf_pool_size) {
+		goto free;
+	}
+
+	if (unlikely(skb_shared(nbuf) || skb_cloned(nbuf) || skb_is_nonlinear(nbuf))) {
+		goto free;
+	}
+
+	if (unlikely(nbuf->fclone != SKB_FCLONE_UNAVAILABLE)) {
+		goto free;
+	}
+
+	if (unlikely(skb_shinfo(nbuf)->tx_flags & SKBTX_DEV_ZEROCOPY)) {
+		goto free;
+	}
+
+	if (unlikely(skb_end_pointer(nbuf) - nbuf->head < min_skb_size)) {
+		goto free;
+	}
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(3, 6, 0))
+	if (unlikely(skb_pfmemalloc(nbuf))) {
+		goto free;
+	}
 #endif
 
-	bit_flags = flags | H2N_BIT_FLAG_FIRST_SEGMENT | H2N_BIT_FLAG_LAST_SEGMENT;
-	if (likely(nbuf->ip_summed == CHECKSUM_PARTIAL)) {
-		bit_flags |= H2N_BIT_FLAG_GEN_IP_TRANSPORT_CHECKSUM;
-	} else if (nbuf->ip_summed == CHECKSUM_UNNECESSARY) {
-		bit_flags |= H2N_BIT_FLAG_GEN_IP_TRANSPORT_CHECKSUM_NONE;
+	skb_orphan(nbuf);
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 4, 0))
+	nf_reset_ct(nbuf);
+	skb_ext_reset(nbuf);
+#elif (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 0, 0))
+	nf_reset(nbuf);
+	skb_ext_reset(nbuf);
+#else
+	nf_reset(nbuf);
+	secpath_reset(nbuf);
+#endif
+	nss_skb_recycle(nbuf);
+
+	if (unlikely(!nss_core_buf_pool_add(nss_ctx, nbuf))) {
+		goto free;
 	}
 
-	mask = desc_if->size - 1;
-	desc = &desc_ring[hlos_index];
+	NSS_PKT_STATS_INCREMENT(nss_ctx, &nss_ctx->nss_top->stats_drv[NSS_STATS_DRV_BUF_POOL_RECYCLED]);
+	return;
+
+free:
+#endif
+	dev_kfree_skb_any(nbuf);
+}
+
+/*
+ * nss_core_buf_pool_init()
+ *	Sets up the empty buffer pool of a core and starts filling it
+ */
+void nss_core_buf_pool_init(struct nss_ctx_instance *nss_ctx)
+{
+	skb_queue_head_init(&nss_ctx->buf_pool);
+	INIT_WORK(&nss_ctx->buf_pool_refill, nss_core_buf_pool_refill);
+	schedule_work(&nss_ctx->buf_pool_refill);
+}
+
+/*
+ * nss_core_buf_pool_cleanup()
+ *	Frees the buffers left in the empty buffer pool of a core
+ */
+void nss_core_buf_pool_cleanup(struct nss_ctx_instance *nss_ctx)
+{
+	struct nss_core_buf_pool_cb *cb;
+	struct sk_buff *nbuf;
+
+	cancel_work_sync(&nss_ctx->buf_pool_refill);
+	while ((nbuf = skb_dequeue(&nss_ctx->buf_pool))) {
+		cb = NSS_CORE_BUF_POOL_CB(nbuf);
+		dma_unmap_single(nss_ctx->dev, cb->buffer, cb->buffer_len, DMA_FROM_DEVICE);
+		dev_kfree_skb_any(nbuf);
+	}
+}
 
+/*
+ * nss_core_send_buffer_simple_map()
+ *	Maps a single descriptor skb for DMA
+ *
+ * This is done before the descriptor is reserved, as nothing may fail once it
+ * has been. *reuse tells whether the NSS may keep the buffer for receive, and
+ * *sz is the length mapped.
+ */
+static inline bool nss_core_send_buffer_simple_map(struct nss_ctx_instance *nss_ctx, uint32_t if_num,
+	struct sk_buff *nbuf, uint32_t *frag0phyaddr, uint16_t *sz, bool *reuse)
+{
 #if (NSS_SKB_RECYCLE_SUPPORT == 1)
 	/*
 	 * Check if the skb is recyclable without resetting its fields.
@@ -1989,50 +2457,80 @@ static inline int32_t nss_core_send_buffer_simple_skb(struct nss_ctx_instance *n
 	 * We are going to do both Tx and then Rx on this buffer, unmap the Tx
 	 * and then map Rx over the entire buffer.
 	 */
-	sz = max((uint16_t)nss_core_skb_tail_offset(nbuf), (uint16_t)(nss_ctx->max_buf_size + NET_SKB_PAD));
-	frag0phyaddr = (uint32_t)dma_map_single(nss_ctx->dev, nbuf->head, sz, DMA_TO_DEVICE);
-	if (unlikely(dma_mapping_error(nss_ctx->dev, frag0phyaddr))) {
+	*sz = max((uint16_t)nss_core_skb_tail_offset(nbuf), (uint16_t)(nss_ctx->max_buf_size + NET_SKB_PAD));
+	*frag0phyaddr = (uint32_t)dma_map_single(nss_ctx->dev, nbuf->head, *sz, DMA_TO_DEVICE);
+	if (unlikely(dma_mapping_error(nss_ctx->dev, *frag0phyaddr))) {
 		goto no_reuse;
 	}
 
 	/*
 	 * We are allowed to re-use the packet
 	 */
-	bit_flags |= H2N_BIT_FLAG_BUFFER_REUSE;
-	nss_core_write_one_descriptor(desc, buffer_type, frag0phyaddr, if_num,
-		(nss_ptr_t)nbuf, (uint16_t)(nbuf->data - nbuf->head), nbuf->len,
-		sz, (uint32_t)nbuf->priority, mss, bit_flags);
-
-	/*
-	 * We are done using the skb fields and can recycle it now
-	 */
-	nss_skb_recycle(nbuf);
-
-	NSS_PKT_STATS_INCREMENT(nss_ctx, &nss_ctx->nss_top->stats_drv[NSS_STATS_DRV_TX_BUFFER_REUSE]);
-	return 1;
+	*reuse = true;
+	return true;
 
 no_reuse:
 #endif
 
-	frag0phyaddr = nss_core_dma_map_single(nss_ctx->dev, nbuf);
-	if (unlikely(dma_mapping_error(nss_ctx->dev, frag0phyaddr))) {
+	*reuse = false;
+	*sz = (uint16_t)nss_core_skb_tail_offset(nbuf);
+	*frag0phyaddr = nss_core_dma_map_single(nss_ctx->dev, nbuf);
+	if (unlikely(dma_mapping_error(nss_ctx->dev, *frag0phyaddr))) {
 		nss_warning("%p: DMA mapping failed for virtual address = %p", nss_ctx, nbuf->head);
-		return 0;
+		return false;
 	}
 
-	nss_core_write_one_descriptor(desc, buffer_type, frag0phyaddr, if_num,
-		(nss_ptr_t)nbuf, (uint16_t)(nbuf->data - nbuf->head), nbuf->len,
-		(uint16_t)skb_end_offset(nbuf), (uint32_t)nbuf->priority, mss, bit_flags);
-
-	NSS_PKT_STATS_INCREMENT(nss_ctx, &nss_ctx->nss_top->stats_drv[NSS_STATS_DRV_TX_SIMPLE]);
-	return 1;
+	return true;
 }
 
 /*
- * nss_core_send_buffer_nr_frags()
- *	Sends frags array (NETIF_F_SG) to NSS FW
- *
- * Note - Opaque is set only on LAST fragment, and DISCARD is set for the rest of segments
+ * nss_core_send_buffer_simple_skb()
+ *	Sends one skb, mapped by nss_core_send_buffer_simple_map(), to NSS FW
+ */
+static inline void nss_core_send_buffer_simple_skb(struct nss_ctx_instance *nss_ctx,
+	struct h2n_desc_if_instance *desc_if, uint32_t if_num,
+	struct sk_buff *nbuf, uint16_t hlos_index, uint16_t flags, uint8_t buffer_type, uint16_t mss,
+	uint32_t frag0phyaddr, uint16_t sz, bool reuse)
+{
+	struct h2n_descriptor *desc = &desc_if->desc[hlos_index];
+	uint16_t bit_flags;
+
+	bit_flags = flags | H2N_BIT_FLAG_FIRST_SEGMENT | H2N_BIT_FLAG_LAST_SEGMENT;
+	if (likely(nbuf->ip_summed == CHECKSUM_PARTIAL)) {
+		bit_flags |= H2N_BIT_FLAG_GEN_IP_TRANSPORT_CHECKSUM;
+	} else if (nbuf->ip_summed == CHECKSUM_UNNECESSARY) {
+		bit_flags |= H2N_BIT_FLAG_GEN_IP_TRANSPORT_CHECKSUM_NONE;
+	}
+
+#if (NSS_SKB_RECYCLE_SUPPORT == 1)
+	if (reuse) {
+		bit_flags |= H2N_BIT_FLAG_BUFFER_REUSE;
+		nss_core_write_one_descriptor(desc, buffer_type, frag0phyaddr, if_num,
+			(nss_ptr_t)nbuf, (uint16_t)(nbuf->data - nbuf->head), nbuf->len,
+			sz, (uint32_t)nbuf->priority, mss, bit_flags);
+
+		/*
+		 * We are done using the skb fields and can recycle it now
+		 */
+		nss_skb_recycle(nbuf);
+
+		NSS_PKT_STATS_INCREMENT(nss_ctx, &nss_ctx->nss_top->stats_drv[NSS_STATS_DRV_TX_BUFFER_REUSE]);
+		return;
+	}
+#endif
+
+	nss_core_write_one_descriptor(desc, buffer_type, frag0phyaddr, if_num,
+		(nss_ptr_t)nbuf, (uint16_t)(nbuf->data - nbuf->head), nbuf->len,
+		(uint16_t)skb_end_offset(nbuf), (uint32_t)nbuf->priority, mss, bit_flags);
+
+	NSS_PKT_STATS_INCREMENT(nss_ctx, &nss_ctx->nss_top->stats_drv[NSS_STATS_DRV_TX_SIMPLE]);
+}
+
+/*
+ * nss_core_send_buffer_nr_frags()
+ *	Sends frags array (NETIF_F_SG) to NSS FW
+ *
+ * Note - Opaque is set only on LAST fragment, and DISCARD is set for the rest of segments
  * Used to differentiate from FRAGLIST
  */
 static inline int32_t nss_core_send_buffer_nr_frags(struct nss_ctx_instance *nss_ctx,
@@ -2164,8 +2662,6 @@ static inline int32_t nss_core_send_buffer_fraglist(struct nss_ctx_instance *nss
 	 */
 	i = 0;
 	skb_walk_frags(nbuf, iter) {
-		uint32_t nr_frags;
-
 		buffer = nss_core_dma_map_single(nss_ctx->dev, iter);
 		if (unlikely(dma_mapping_error(nss_ctx->dev, buffer))) {
 			nss_warning("%p: DMA mapping failed for virtual address = %p", nss_ctx, iter->head);
@@ -2173,17 +2669,6 @@ static inline int32_t nss_core_send_buffer_fraglist(struct nss_ctx_instance *nss
 			return -(i+1);
 		}
 
-		/*
-		 * We currently don't support frags[] array inside a
-		 * fraglist.
-		 */
-		nr_frags = skb_shinfo(iter)->nr_frags;
-		if (unlikely(nr_frags > 0)) {
-			nss_warning("%p: fraglist with page data are not supported: %p\n", nss_ctx, iter);
-			nss_core_send_unwind_dma(nss_ctx->dev, desc_if, hlos_index, i + 1, is_fraglist);
-			return -(i+1);
-		}
-
 		/*
 		 * Update index.
 		 */
@@ -2206,26 +2691,14 @@ static inline int32_t nss_core_send_buffer_fraglist(struct nss_ctx_instance *nss
 }
 
 /*
- * nss_core_send_buffer()
- *	Send network buffer to NSS
+ * nss_core_send_buffer_slots()
+ *	Returns the number of descriptors nbuf needs, or 0 if it can not be sent
  */
-int32_t nss_core_send_buffer(struct nss_ctx_instance *nss_ctx, uint32_t if_num,
-					struct sk_buff *nbuf, uint16_t qid,
-					uint8_t buffer_type, uint16_t flags)
+static inline uint16_t nss_core_send_buffer_slots(struct nss_ctx_instance *nss_ctx,
+	struct h2n_desc_if_instance *desc_if, struct sk_buff *nbuf, bool is_bounce)
 {
-	int16_t count, hlos_index, nss_index, size, mask;
+	struct sk_buff *iter;
 	uint32_t segments;
-	struct hlos_h2n_desc_rings *h2n_desc_ring = &nss_ctx->h2n_desc_rings[qid];
-	struct h2n_desc_if_instance *desc_if = &h2n_desc_ring->desc_ring;
-	struct h2n_descriptor *desc_ring;
-	struct h2n_descriptor *desc;
-	struct nss_if_mem_map *if_map = (struct nss_if_mem_map *)nss_ctx->vmap;
-	uint16_t mss = 0;
-	bool is_bounce = ((buffer_type == H2N_BUFFER_SHAPER_BOUNCE_INTERFACE) || (buffer_type == H2N_BUFFER_SHAPER_BOUNCE_BRIDGE));
-
-	desc_ring = desc_if->desc;
-	size = desc_if->size;
-	mask = size - 1;
 
 	/*
 	 * If nbuf does not have fraglist, then update nr_frags
@@ -2234,66 +2707,376 @@ int32_t nss_core_send_buffer(struct nss_ctx_instance *nss_ctx, uint32_t if_num,
 	if (!skb_has_frag_list(nbuf)) {
 		segments = skb_shinfo(nbuf)->nr_frags;
 		BUG_ON(segments > MAX_SKB_FRAGS);
-	} else {
-		struct sk_buff *iter;
-		segments = 0;
-		skb_walk_frags(nbuf, iter) {
-			segments++;
-		}
 
 		/*
-		 * Check that segments do not overflow the number of descriptors
+		 * Bounced packets are sent as a single descriptor whatever
+		 * their layout, see nss_core_send_buffer_write().
+		 */
+		return is_bounce ? 1 : segments + 1;
+	}
+
+	segments = 0;
+	skb_walk_frags(nbuf, iter) {
+		/*
+		 * We currently don't support frags[] array inside a
+		 * fraglist. Check it here as nothing may fail once our
+		 * descriptors have been reserved.
 		 */
-		if (unlikely(segments > size)) {
-			nss_warning("%p: Unable to fit in skb - %d segments in our descriptors", nss_ctx, segments);
-			return NSS_CORE_STATUS_FAILURE;
+		if (unlikely(skb_shinfo(iter)->nr_frags > 0)) {
+			nss_warning("%p: fraglist with page data are not supported: %p\n", nss_ctx, iter);
+			return 0;
 		}
+
+		segments++;
 	}
 
 	/*
-	 * Take a lock for queue
+	 * Check that segments do not overflow the number of descriptors
 	 */
-	spin_lock_bh(&h2n_desc_ring->lock);
+	if (unlikely(segments > desc_if->size)) {
+		nss_warning("%p: Unable to fit in skb - %d segments in our descriptors", nss_ctx, segments);
+		return 0;
+	}
 
-	/*
-	 * We need to work out if there's sufficent space in our transmit descriptor
-	 * ring to place all the segments of a nbuf.
-	 */
-	nss_index = if_map->h2n_nss_index[qid];
-	hlos_index = h2n_desc_ring->hlos_index;
+	return is_bounce ? 1 : segments + 1;
+}
+
+/*
+ * nss_core_send_buffer_write()
+ *	Writes a multi-descriptor nbuf to the descriptors from hlos_index
+ *
+ * Its segments are mapped as they are written. Returns false, with nothing
+ * left mapped, if nbuf could not be sent.
+ */
+static bool nss_core_send_buffer_write(struct nss_ctx_instance *nss_ctx,
+	struct h2n_desc_if_instance *desc_if, uint32_t if_num, struct sk_buff *nbuf,
+	uint16_t hlos_index, uint8_t buffer_type, uint16_t flags, uint16_t mss)
+{
+	int32_t count;
 
-	count = ((nss_index - hlos_index - 1) + size) & (mask);
+	if (skb_has_frag_list(nbuf)) {
+		count = nss_core_send_buffer_fraglist(nss_ctx, desc_if, if_num,
+			nbuf, hlos_index, flags, buffer_type, mss, true);
+	} else {
+		count = nss_core_send_buffer_nr_frags(nss_ctx, desc_if, if_num,
+			nbuf, hlos_index, flags, buffer_type, mss, false);
+	}
 
-	if (unlikely(count < (segments + 1))) {
+	if (unlikely(count <= 0)) {
 		/*
-		 * NOTE: tx_q_full_cnt and TX_STOPPED flags will be used
-		 *	when we will add support for DESC Q congestion management
-		 *	in future
+		 * The helpers have unmapped whatever they mapped
 		 */
-		h2n_desc_ring->tx_q_full_cnt++;
-		h2n_desc_ring->flags |= NSS_H2N_DESC_RING_FLAGS_TX_STOPPED;
-		spin_unlock_bh(&h2n_desc_ring->lock);
-		nss_warning("%p: Data/Command Queue full reached", nss_ctx);
+		nss_warning("%p: failed to map DMA regions:%d", nss_ctx, -count);
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * nss_core_send_queue_full()
+ *	Accounts for a full H2N queue and asks the NSS to tell us when it drains
+ */
+static void nss_core_send_queue_full(struct nss_ctx_instance *nss_ctx, struct hlos_h2n_desc_rings *h2n_desc_ring)
+{
+	/*
+	 * NOTE: tx_q_full_cnt and TX_STOPPED flags will be used
+	 *	when we will add support for DESC Q congestion management
+	 *	in future
+	 */
+	h2n_desc_ring->tx_q_full_cnt++;
+	h2n_desc_ring->flags |= NSS_H2N_DESC_RING_FLAGS_TX_STOPPED;
+	nss_warning("%p: Data/Command Queue full reached", nss_ctx);
 
 #if (NSS_PKT_STATS_ENABLED == 1)
-		if (nss_ctx->id == NSS_CORE_0) {
-			NSS_PKT_STATS_INCREMENT(nss_ctx, &nss_ctx->nss_top->stats_drv[NSS_STATS_DRV_TX_QUEUE_FULL_0]);
-		} else if (nss_ctx->id == NSS_CORE_1) {
-			NSS_PKT_STATS_INCREMENT(nss_ctx, &nss_ctx->nss_top->stats_drv[NSS_STATS_DRV_TX_QUEUE_FULL_1]);
-		} else {
-			nss_warning("%p: Invalid nss core: %d\n", nss_ctx, nss_ctx->id);
-		}
+	if (nss_ctx->id == NSS_CORE_0) {
+		NSS_PKT_STATS_INCREMENT(nss_ctx, &nss_ctx->nss_top->stats_drv[NSS_STATS_DRV_TX_QUEUE_FULL_0]);
+	} else if (nss_ctx->id == NSS_CORE_1) {
+		NSS_PKT_STATS_INCREMENT(nss_ctx, &nss_ctx->nss_top->stats_drv[NSS_STATS_DRV_TX_QUEUE_FULL_1]);
+	} else {
+		nss_warning("%p: Invalid nss core: %d\n", nss_ctx, nss_ctx->id);
+	}
 #endif
 
+	/*
+	 * Enable de-congestion interrupt from NSS
+	 */
+	nss_hal_enable_interrupt(nss_ctx, nss_ctx->int_ctx[0].shift_factor, NSS_N2H_INTR_TX_UNBLOCKED);
+}
+
+/*
+ * nss_core_send_space()
+ *	Returns the number of free descriptors on an H2N queue from hlos_index
+ */
+static inline uint16_t nss_core_send_space(struct nss_ctx_instance *nss_ctx, struct hlos_h2n_desc_rings *h2n_desc_ring,
+	uint16_t qid, uint16_t hlos_index)
+{
+	struct nss_if_mem_map *if_map = (struct nss_if_mem_map *)nss_ctx->vmap;
+	uint16_t size = h2n_desc_ring->desc_ring.size;
+	uint16_t nss_index = READ_ONCE(if_map->h2n_nss_index[qid]);
+
+	return ((nss_index - hlos_index - 1) + size) & (size - 1);
+}
+
+/*
+ * nss_core_send_reserve()
+ *	Reserves slots descriptors on an H2N queue
+ *
+ * Producers claim descriptors by moving reserve_index on with a compare and
+ * exchange, so that they can fill them in parallel. Either all slots are
+ * reserved or none are: the queue is full if they do not fit. Returns false
+ * in that case, otherwise sets *start to the first descriptor reserved.
+ */
+static bool nss_core_send_reserve(struct nss_ctx_instance *nss_ctx, struct hlos_h2n_desc_rings *h2n_desc_ring,
+	uint16_t qid, uint16_t slots, uint16_t *start)
+{
+	uint16_t mask = h2n_desc_ring->desc_ring.size - 1;
+	uint16_t hlos_index, end;
+	int reserve_index;
+
+	for (;;) {
+		reserve_index = atomic_read(&h2n_desc_ring->reserve_index);
+
 		/*
-		 * Enable de-congestion interrupt from NSS
+		 * Wait for a multi-descriptor buffer being sent to reopen the
+		 * queue, see nss_core_send_locked().
 		 */
-		nss_hal_enable_interrupt(nss_ctx, nss_ctx->int_ctx[0].shift_factor, NSS_N2H_INTR_TX_UNBLOCKED);
+		if (unlikely(reserve_index & NSS_H2N_RESERVE_CLOSED)) {
+			cpu_relax();
+			continue;
+		}
+
+		/*
+		 * We need to work out if there's sufficent space in our transmit descriptor
+		 * ring to place all the segments of a nbuf.
+		 */
+		hlos_index = (uint16_t)reserve_index;
+		if (unlikely(nss_core_send_space(nss_ctx, h2n_desc_ring, qid, hlos_index) < slots)) {
+			return false;
+		}
+
+		end = (hlos_index + slots) & mask;
+		if (likely(atomic_cmpxchg(&h2n_desc_ring->reserve_index, hlos_index, end) == hlos_index)) {
+			break;
+		}
+
+		NSS_PKT_STATS_INCREMENT(nss_ctx, &nss_ctx->nss_top->stats_drv[NSS_STATS_DRV_TX_RESERVE_RETRY]);
+	}
+
+	*start = hlos_index;
+	return true;
+}
+
+/*
+ * nss_core_send_flush_locked()
+ *	Shows the NSS every descriptor written so far, with publish_lock held
+ *
+ * Returns true if the index moved, in which case the NSS needs a doorbell.
+ */
+static inline bool nss_core_send_flush_locked(struct nss_ctx_instance *nss_ctx, struct hlos_h2n_desc_rings *h2n_desc_ring)
+{
+	struct nss_if_mem_map *if_map = (struct nss_if_mem_map *)nss_ctx->vmap;
+
+	if (!h2n_desc_ring->unpublished) {
+		return false;
+	}
+
+	if_map->h2n_hlos_index[h2n_desc_ring->qid] = h2n_desc_ring->hlos_index;
+	h2n_desc_ring->unpublished = 0;
+	NSS_PKT_STATS_INCREMENT(nss_ctx, &nss_ctx->nss_top->stats_drv[NSS_STATS_DRV_TX_INDEX_WRITE]);
+	return true;
+}
+
+/*
+ * nss_core_send_flush()
+ *	Shows the NSS descriptors whose publication was deferred and rings its doorbell
+ */
+static void nss_core_send_flush(struct nss_ctx_instance *nss_ctx, struct hlos_h2n_desc_rings *h2n_desc_ring)
+{
+	unsigned long irq_flags;
+	bool flushed;
+
+	spin_lock_irqsave(&h2n_desc_ring->publish_lock, irq_flags);
+	flushed = nss_core_send_flush_locked(nss_ctx, h2n_desc_ring);
+	spin_unlock_irqrestore(&h2n_desc_ring->publish_lock, irq_flags);
+
+	if (flushed) {
+		nss_hal_send_interrupt(nss_ctx, NSS_H2N_INTR_DATA_COMMAND_QUEUE);
+	}
+}
 
+/*
+ * nss_core_send_flush_timer()
+ *	Bounds how long deferred descriptors wait for the end of their burst
+ */
+static enum hrtimer_restart nss_core_send_flush_timer(struct hrtimer *timer)
+{
+	struct hlos_h2n_desc_rings *h2n_desc_ring = container_of(timer, struct hlos_h2n_desc_rings, flush_timer);
+
+	nss_core_send_flush(h2n_desc_ring->nss_ctx, h2n_desc_ring);
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * nss_core_send_publish()
+ *	Hands descriptors from start to end over to the NSS
+ *
+ * Descriptors are published in the order they were reserved: we wait for
+ * the producers ahead of us to move hlos_index on to our start. They are
+ * running with bottom halves disabled, so the wait is short.
+ *
+ * If more is set the caller has further packets coming, and the write of the
+ * index to the NSS is put off until the burst ends, nss_h2n_batch descriptors
+ * are pending or nss_h2n_batch_usecs have passed. Returns true if the index
+ * was written, in which case the NSS needs a doorbell.
+ */
+static bool nss_core_send_publish(struct nss_ctx_instance *nss_ctx, struct hlos_h2n_desc_rings *h2n_desc_ring,
+	uint16_t start, uint16_t end, bool more)
+{
+	uint16_t mask = h2n_desc_ring->desc_ring.size - 1;
+	unsigned long irq_flags;
+	bool flushed;
+
+	if (unlikely(READ_ONCE(h2n_desc_ring->hlos_index) != start)) {
+		NSS_PKT_STATS_INCREMENT(nss_ctx, &nss_ctx->nss_top->stats_drv[NSS_STATS_DRV_TX_PUBLISH_WAIT]);
+		while (READ_ONCE(h2n_desc_ring->hlos_index) != start) {
+			cpu_relax();
+		}
+	}
+
+	/*
+	 * Our descriptors, and those of the producers we waited for, must
+	 * be visible to the NSS before the index that covers them.
+	 */
+	mb();
+
+	spin_lock_irqsave(&h2n_desc_ring->publish_lock, irq_flags);
+	WRITE_ONCE(h2n_desc_ring->hlos_index, end);
+	h2n_desc_ring->unpublished += (end - start) & mask;
+
+	if (more && (h2n_desc_ring->unpublished < nss_h2n_batch)) {
+		if (!hrtimer_is_queued(&h2n_desc_ring->flush_timer)) {
+			hrtimer_start(&h2n_desc_ring->flush_timer, ns_to_ktime(nss_h2n_batch_usecs * NSEC_PER_USEC), HRTIMER_MODE_REL);
+		}
+
+		spin_unlock_irqrestore(&h2n_desc_ring->publish_lock, irq_flags);
+		NSS_PKT_STATS_INCREMENT(nss_ctx, &nss_ctx->nss_top->stats_drv[NSS_STATS_DRV_TX_DEFERRED]);
+		return false;
+	}
+
+	/*
+	 * Update our host index so the NSS sees we've written a new descriptor.
+	 */
+	flushed = nss_core_send_flush_locked(nss_ctx, h2n_desc_ring);
+	spin_unlock_irqrestore(&h2n_desc_ring->publish_lock, irq_flags);
+	return flushed;
+}
+
+/*
+ * nss_core_send_reserved()
+ *	Writes a single descriptor buffer to an H2N queue and publishes it
+ *
+ * The buffer is mapped before its descriptor is reserved, so that nothing
+ * can fail once it has been.
+ */
+static int32_t nss_core_send_reserved(struct nss_ctx_instance *nss_ctx, struct hlos_h2n_desc_rings *h2n_desc_ring,
+	uint32_t if_num, struct sk_buff *nbuf, uint16_t qid,
+	uint8_t buffer_type, uint16_t flags, uint16_t mss, bool more, bool *flushed)
+{
+	struct h2n_desc_if_instance *desc_if = &h2n_desc_ring->desc_ring;
+	uint16_t hlos_index, sz;
+	uint32_t frag0phyaddr;
+	bool reuse;
+
+	if (unlikely(!nss_core_send_buffer_simple_map(nss_ctx, if_num, nbuf, &frag0phyaddr, &sz, &reuse))) {
+		return NSS_CORE_STATUS_FAILURE;
+	}
+
+	if (unlikely(!nss_core_send_reserve(nss_ctx, h2n_desc_ring, qid, 1, &hlos_index))) {
+		dma_unmap_single(nss_ctx->dev, frag0phyaddr, sz, DMA_TO_DEVICE);
 		return NSS_CORE_STATUS_FAILURE_QUEUE;
 	}
 
-	desc = &desc_ring[hlos_index];
+	nss_core_send_buffer_simple_skb(nss_ctx, desc_if, if_num, nbuf, hlos_index, flags, buffer_type, mss,
+		frag0phyaddr, sz, reuse);
+	*flushed = nss_core_send_publish(nss_ctx, h2n_desc_ring, hlos_index, (hlos_index + 1) & (desc_if->size - 1), more);
+	return NSS_CORE_STATUS_SUCCESS;
+}
+
+/*
+ * nss_core_send_locked()
+ *	Writes a multi-descriptor buffer to an H2N queue and publishes it
+ *
+ * The segments of such buffers are mapped as their descriptors are written,
+ * and a mapping may fail part way. Descriptors can not be handed back once
+ * producers behind us have reserved theirs, so these buffers are not sent
+ * through a reservation: the queue lock serialises their senders, and the
+ * queue is closed to other producers while the buffer is written. If that
+ * fails the queue is simply reopened where it was.
+ */
+static int32_t nss_core_send_locked(struct nss_ctx_instance *nss_ctx, struct hlos_h2n_desc_rings *h2n_desc_ring,
+	uint32_t if_num, struct sk_buff *nbuf, uint16_t qid, uint16_t slots,
+	uint8_t buffer_type, uint16_t flags, uint16_t mss, bool more, bool *flushed)
+{
+	struct h2n_desc_if_instance *desc_if = &h2n_desc_ring->desc_ring;
+	uint16_t hlos_index, end;
+
+	spin_lock(&h2n_desc_ring->lock);
+
+	/*
+	 * Only the lock holder closes the queue, so the index we read is open.
+	 */
+	do {
+		hlos_index = (uint16_t)atomic_read(&h2n_desc_ring->reserve_index);
+	} while (atomic_cmpxchg(&h2n_desc_ring->reserve_index, hlos_index, hlos_index | NSS_H2N_RESERVE_CLOSED) != hlos_index);
+
+	if (unlikely(nss_core_send_space(nss_ctx, h2n_desc_ring, qid, hlos_index) < slots)) {
+		atomic_set(&h2n_desc_ring->reserve_index, hlos_index);
+		spin_unlock(&h2n_desc_ring->lock);
+		return NSS_CORE_STATUS_FAILURE_QUEUE;
+	}
+
+	if (unlikely(!nss_core_send_buffer_write(nss_ctx, desc_if, if_num, nbuf, hlos_index, buffer_type, flags, mss))) {
+		atomic_set(&h2n_desc_ring->reserve_index, hlos_index);
+		spin_unlock(&h2n_desc_ring->lock);
+		return NSS_CORE_STATUS_FAILURE;
+	}
+
+	/*
+	 * Our descriptors are written: producers may reserve behind them
+	 * while we wait for those ahead of us to publish.
+	 */
+	end = (hlos_index + slots) & (desc_if->size - 1);
+	atomic_set(&h2n_desc_ring->reserve_index, end);
+	spin_unlock(&h2n_desc_ring->lock);
+
+	*flushed = nss_core_send_publish(nss_ctx, h2n_desc_ring, hlos_index, end, more);
+	return NSS_CORE_STATUS_SUCCESS;
+}
+
+/*
+ * nss_core_send_one()
+ *	Writes one network buffer to an H2N queue and publishes it
+ *
+ * *flushed tells whether the NSS was shown the buffer, see nss_core_send_publish().
+ */
+static int32_t nss_core_send_one(struct nss_ctx_instance *nss_ctx, uint32_t if_num,
+					struct sk_buff *nbuf, uint16_t qid,
+					uint8_t buffer_type, uint16_t flags, bool more, bool *flushed)
+{
+	struct hlos_h2n_desc_rings *h2n_desc_ring = &nss_ctx->h2n_desc_rings[qid];
+	struct h2n_desc_if_instance *desc_if = &h2n_desc_ring->desc_ring;
+	bool is_bounce = ((buffer_type == H2N_BUFFER_SHAPER_BOUNCE_INTERFACE) || (buffer_type == H2N_BUFFER_SHAPER_BOUNCE_BRIDGE));
+	uint16_t slots;
+	uint16_t mss = 0;
+	int32_t status;
+
+	*flushed = false;
+
+	slots = nss_core_send_buffer_slots(nss_ctx, desc_if, nbuf, is_bounce);
+	if (unlikely(!slots)) {
+		return NSS_CORE_STATUS_FAILURE;
+	}
 
 	/*
 	 * Check if segmentation enabled.
@@ -2314,49 +3097,132 @@ int32_t nss_core_send_buffer(struct nss_ctx_instance *nss_ctx, uint32_t if_num,
 	}
 
 	/*
-	 * WARNING! : The following "is_bounce" check has a potential to cause corruption
-	 * if things change in the NSS. This check allows fragmented packets to be sent down
+	 * Bottom halves stay disabled from reservation to publication so that
+	 * nobody sending on this CPU can wait on us.
+	 *
+	 * WARNING! : Bounced packets are always sent as a single descriptor, see
+	 * nss_core_send_buffer_slots(). This has a potential to cause corruption
+	 * if things change in the NSS. It allows fragmented packets to be sent down
 	 * with incomplete payload information since NSS does not care about the payload content
 	 * when packets are bounced for shaping. If it starts caring in future, then this code
 	 * will have to change.
 	 *
 	 * WHY WE ARE DOING THIS - Skipping S/G processing helps with performance.
-	 *
 	 */
-	count = 0;
-	if (likely((segments == 0) || is_bounce)) {
-		count = nss_core_send_buffer_simple_skb(nss_ctx, desc_if, if_num,
-			nbuf, hlos_index, flags, buffer_type, mss);
-	} else if (skb_has_frag_list(nbuf)) {
-		count = nss_core_send_buffer_fraglist(nss_ctx, desc_if, if_num,
-			nbuf, hlos_index, flags, buffer_type, mss, true);
+	local_bh_disable();
+	if (likely(slots == 1)) {
+		status = nss_core_send_reserved(nss_ctx, h2n_desc_ring, if_num, nbuf, qid, buffer_type, flags, mss, more, flushed);
 	} else {
-		count = nss_core_send_buffer_nr_frags(nss_ctx, desc_if, if_num,
-			nbuf, hlos_index, flags, buffer_type, mss, false);
+		status = nss_core_send_locked(nss_ctx, h2n_desc_ring, if_num, nbuf, qid, slots, buffer_type, flags, mss, more, flushed);
 	}
+	local_bh_enable();
 
-	if (unlikely(count <= 0)) {
-		/*
-		 * We failed and hence we need to unmap dma regions
-		 */
-		nss_warning("%p: failed to map DMA regions:%d", nss_ctx, -count);
-		spin_unlock_bh(&h2n_desc_ring->lock);
-		return NSS_CORE_STATUS_FAILURE;
-	}
+	if (unlikely(status != NSS_CORE_STATUS_SUCCESS)) {
+		if (status == NSS_CORE_STATUS_FAILURE_QUEUE) {
+			nss_core_send_queue_full(nss_ctx, h2n_desc_ring);
+		}
 
-	/*
-	 * Update our host index so the NSS sees we've written a new descriptor.
-	 */
-	hlos_index = (hlos_index + count) & mask;
-	h2n_desc_ring->hlos_index = hlos_index;
-	if_map->h2n_hlos_index[qid] = hlos_index;
+		return status;
+	}
 
 	/*
 	 * We are holding this skb in NSS FW, let kmemleak know about it.
 	 */
 	kmemleak_not_leak(nbuf);
 	NSS_PKT_STATS_INCREMENT(nss_ctx, &nss_ctx->nss_top->stats_drv[NSS_STATS_DRV_NSS_SKB_COUNT]);
+	return NSS_CORE_STATUS_SUCCESS;
+}
+
+/*
+ * nss_core_send_buffer()
+ *	Send network buffer to NSS
+ *
+ * The NSS is shown the buffer straight away; it is up to the caller to ring
+ * its doorbell.
+ */
+int32_t nss_core_send_buffer(struct nss_ctx_instance *nss_ctx, uint32_t if_num,
+					struct sk_buff *nbuf, uint16_t qid,
+					uint8_t buffer_type, uint16_t flags)
+{
+	bool flushed;
+
+	return nss_core_send_one(nss_ctx, if_num, nbuf, qid, buffer_type, flags, false, &flushed);
+}
+
+/*
+ * nss_core_send_packet()
+ *	Send a data packet to NSS, coalescing index writes and doorbells
+ *
+ * While the stack tells us, through xmit_more, that more packets follow, the
+ * index write and doorbell are left to a later packet of the burst. The
+ * doorbell is rung here when needed, callers must not ring it themselves.
+ */
+int32_t nss_core_send_packet(struct nss_ctx_instance *nss_ctx, uint32_t if_num,
+					struct sk_buff *nbuf, uint16_t qid,
+					uint8_t buffer_type, uint16_t flags)
+{
+	bool more = (nss_h2n_batch > 1) && nss_core_skb_xmit_more(nbuf);
+	int32_t status;
+	bool flushed;
+
+	status = nss_core_send_one(nss_ctx, if_num, nbuf, qid, buffer_type, flags, more, &flushed);
+	if (unlikely(status != NSS_CORE_STATUS_SUCCESS)) {
+		/*
+		 * The caller will stop or drop; nothing may be left waiting
+		 * for the end of a burst that is not coming.
+		 */
+		nss_core_send_flush(nss_ctx, &nss_ctx->h2n_desc_rings[qid]);
+		return status;
+	}
+
+	if (flushed) {
+		nss_hal_send_interrupt(nss_ctx, NSS_H2N_INTR_DATA_COMMAND_QUEUE);
+	}
 
-	spin_unlock_bh(&h2n_desc_ring->lock);
 	return NSS_CORE_STATUS_SUCCESS;
 }
+
+/*
+ * nss_core_send_init()
+ *	Sets up the H2N flush timers of a core
+ */
+void nss_core_send_init(struct nss_ctx_instance *nss_ctx)
+{
+	int32_t i;
+
+	for (i = 0; i < NSS_H2N_DESC_RING_NUM; i++) {
+		struct hlos_h2n_desc_rings *h2n_desc_ring = &nss_ctx->h2n_desc_rings[i];
+
+		/*
+		 * The core may be initialized again if the data plane could
+		 * not be registered the first time.
+		 */
+		if (h2n_desc_ring->nss_ctx) {
+			continue;
+		}
+
+		spin_lock_init(&h2n_desc_ring->lock);
+		spin_lock_init(&h2n_desc_ring->publish_lock);
+		hrtimer_init(&h2n_desc_ring->flush_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+		h2n_desc_ring->flush_timer.function = nss_core_send_flush_timer;
+		h2n_desc_ring->qid = i;
+		h2n_desc_ring->nss_ctx = nss_ctx;
+	}
+}
+
+/*
+ * nss_core_send_cleanup()
+ *	Stops the H2N flush timers of a core
+ */
+void nss_core_send_cleanup(struct nss_ctx_instance *nss_ctx)
+{
+	int32_t i;
+
+	for (i = 0; i < NSS_H2N_DESC_RING_NUM; i++) {
+		struct hlos_h2n_desc_rings *h2n_desc_ring = &nss_ctx->h2n_desc_rings[i];
+
+		if (h2n_desc_ring->nss_ctx) {
+			hrtimer_cancel(&h2n_desc_ring->flush_timer);
+		}
+	}
+}
@@ -32,6 +32,7 @@
 #include <linux/netdevice.h>
 #include <linux/debugfs.h>
 #include <linux/workqueue.h>
+#include <linux/hrtimer.h>
 
 #include <nss_api_if.h>
 #include "nss_phys_if.h"
@@ -92,10 +93,12 @@
 #if (NSS_PKT_STATS_ENABLED == 1)
 #define NSS_PKT_STATS_INCREMENT(nss_ctx, x) nss_pkt_stats_increment((nss_ctx), (x))
 #define NSS_PKT_STATS_DECREMENT(nss_ctx, x) nss_pkt_stats_decrement((nss_ctx), (x))
+#define NSS_PKT_STATS_ADD(nss_ctx, x, v) nss_pkt_stats_add((nss_ctx), (x), (v))
 #define NSS_PKT_STATS_READ(x) nss_pkt_stats_read(x)
 #else
 #define NSS_PKT_STATS_INCREMENT(nss_ctx, x)
 #define NSS_PKT_STATS_DECREMENT(nss_ctx, x)
+#define NSS_PKT_STATS_ADD(nss_ctx, x, v)
 #define NSS_PKT_STATS_READ(x) (0)
 #endif
 
@@ -404,6 +407,16 @@ enum nss_stats_drv {
 	NSS_STATS_DRV_NSS_SKB_COUNT,		/* NSS SKB Pool Count */
 	NSS_STATS_DRV_CHAIN_SEG_PROCESSED,	/* N2H SKB Chain Processed Count */
 	NSS_STATS_DRV_FRAG_SEG_PROCESSED,	/* N2H Frag Processed Count */
+	NSS_STATS_DRV_TX_RESERVE_RETRY,		/* H2N descriptor reservations lost to another producer */
+	NSS_STATS_DRV_TX_PUBLISH_WAIT,		/* H2N publications that waited for an earlier producer */
+	NSS_STATS_DRV_TX_DOORBELL,		/* H2N data/command queue interrupts raised */
+	NSS_STATS_DRV_TX_INDEX_WRITE,		/* H2N index writes to the NSS */
+	NSS_STATS_DRV_TX_DEFERRED,		/* H2N packets whose index write was deferred */
+	NSS_STATS_DRV_RX_INDEX_WRITE,		/* N2H index writes to the NSS */
+	NSS_STATS_DRV_BUF_POOL_HIT,		/* Empty buffers given from the pool */
+	NSS_STATS_DRV_BUF_POOL_MISS,		/* Empty buffers allocated for want of pooled ones */
+	NSS_STATS_DRV_BUF_POOL_MISS_NS,		/* Nanoseconds spent allocating and mapping those */
+	NSS_STATS_DRV_BUF_POOL_RECYCLED,	/* Returned buffers recycled into the pool */
 	NSS_STATS_DRV_MAX,
 };
 
@@ -876,6 +889,49 @@ struct netdev_priv_instance {
 	struct int_ctx_instance *int_ctx;	/* Back pointer to interrupt context */
 };
 
+/*
+ * NAPI interrupt moderation
+ */
+#define NSS_CORE_NAPI_MOD_LEVELS 6	/* Number of moderation delays, see nss_core_napi_mod_usecs[] */
+#define NSS_CORE_NAPI_HIST_BUCKETS 16	/* Histogram buckets, bucket n holding values below 2^n */
+
+/*
+ * Load measured over one moderation epoch
+ */
+struct nss_core_napi_sample {
+	uint32_t pkt_rate;		/* Descriptors per millisecond */
+	uint32_t pkts_per_irq;		/* Descriptors per interrupt */
+	uint32_t ns_per_pkt;		/* Poll time per descriptor */
+};
+
+/*
+ * Interrupt moderation state of an interrupt context
+ */
+struct nss_core_napi_mod {
+	struct hrtimer timer;		/* Re-enables the interrupt once the moderation delay is over */
+	ktime_t irq_time;		/* When the interrupt being served was taken, zero if none */
+	ktime_t last_work;		/* When a poll last found work */
+	ktime_t epoch_start;		/* Start of the current epoch */
+	uint32_t epoch_polls;		/* Polls in the current epoch */
+	uint32_t epoch_irqs;		/* Interrupts in the current epoch */
+	uint32_t epoch_pkts;		/* Descriptors processed in the current epoch */
+	uint64_t epoch_poll_ns;		/* Time spent polling in the current epoch */
+	struct nss_core_napi_sample prev;
+					/* Load of the previous epoch */
+	int8_t level;			/* Current moderation delay */
+	int8_t step;			/* Direction the delay is being tuned in, zero when settled */
+	uint8_t tuning_epochs;		/* Epochs spent tuning since last settled */
+	uint64_t busy_polls;		/* Polls kept going by the busy poll window */
+	uint64_t hist_latency[NSS_CORE_NAPI_HIST_BUCKETS];
+					/* Interrupt to poll latency in microseconds */
+	uint64_t hist_pkts[NSS_CORE_NAPI_HIST_BUCKETS];
+					/* Descriptors per poll */
+	uint64_t hist_irq_rate[NSS_CORE_NAPI_HIST_BUCKETS];
+					/* Interrupts per second, once per epoch */
+	uint64_t hist_level[NSS_CORE_NAPI_MOD_LEVELS];
+					/* Epochs spent at each moderation delay */
+};
+
 /*
  * Interrupt context instance (one per queue per NSS core)
  */
@@ -891,6 +947,8 @@ struct int_ctx_instance {
 	char irq_name[11];		/* IRQ name bind to this interrupt ctx */
 	struct net_device *ndev;	/* Netdev associated with this interrupt ctx */
 	struct napi_struct napi;	/* NAPI handler */
+	uint32_t n2h_writeback;		/* N2H queues whose index is to be written back */
+	struct nss_core_napi_mod mod;	/* Interrupt moderation */
 };
 
 /*
@@ -903,6 +961,7 @@ struct hlos_n2h_desc_ring {
 	struct sk_buff *head;		/* First segment of an skb fraglist */
 	struct sk_buff *tail;		/* Last segment received of an skb fraglist */
 	struct sk_buff *jumbo_start;	/* First segment of an skb with frags[] */
+	uint32_t unflushed;		/* Descriptors consumed since the index was written back */
 };
 
 /*
@@ -910,13 +969,20 @@ struct hlos_n2h_desc_ring {
  */
 struct hlos_h2n_desc_rings {
 	struct h2n_desc_if_instance desc_ring;	/* Descriptor ring */
-	uint32_t hlos_index;
-	spinlock_t lock;			/* Lock to save from simultaneous access */
+	uint32_t hlos_index;			/* Index up to which descriptors have been written */
+	atomic_t reserve_index;			/* Index up to which producers have reserved descriptors */
+	spinlock_t lock;			/* Serialises senders of multi-descriptor buffers */
+	spinlock_t publish_lock;		/* Orders hlos_index updates with index write-backs */
+	uint32_t unpublished;			/* Descriptors written but not yet shown to the NSS */
+	struct hrtimer flush_timer;		/* Shows deferred descriptors to the NSS */
+	struct nss_ctx_instance *nss_ctx;	/* Back pointer for flush_timer */
+	uint16_t qid;				/* Queue number of this ring */
 	uint32_t flags;				/* Flags */
 	uint64_t tx_q_full_cnt;			/* Descriptor queue full count */
 };
 
 #define NSS_H2N_DESC_RING_FLAGS_TX_STOPPED 0x1	/* Tx has been stopped for this queue */
+#define NSS_H2N_RESERVE_CLOSED 0x10000		/* reserve_index bit: lock holder is writing, see nss_core_send_locked() */
 
 /*
  * struct nss_shaper_bounce_registrant
@@ -973,6 +1039,9 @@ struct nss_ctx_instance {
 	uint16_t n2h_mitigate_en;	/* N2H mitigation */
 	uint32_t max_buf_size;		/* Maximum buffer size */
 	uint32_t buf_sz_allocated;	/* size of bufs allocated from host */
+	struct sk_buff_head buf_pool;	/* Empty buffers mapped for the NSS ahead of time */
+	struct work_struct buf_pool_refill;
+					/* Tops buf_pool up from process context */
 	nss_cmn_queue_decongestion_callback_t queue_decongestion_callback[NSS_MAX_CLIENTS];
 					/* Queue decongestion callbacks */
 	void *queue_decongestion_ctx[NSS_MAX_CLIENTS];
@@ -1010,6 +1079,7 @@ struct nss_top_instance {
 	struct dentry *n2h_dentry;		/* N2H stats dentry */
 	struct dentry *lso_rx_dentry;		/* LSO_RX stats dentry */
 	struct dentry *drv_dentry;		/* HLOS driver stats dentry */
+	struct dentry *napi_dentry;		/* NAPI moderation stats dentry */
 	struct dentry *pppoe_dentry;		/* PPPOE stats dentry */
 	struct dentry *pptp_dentry;		/* PPTP  stats dentry */
 	struct dentry *l2tpv2_dentry;		/* L2TPV2  stats dentry */
@@ -1217,6 +1287,14 @@ static inline void nss_pkt_stats_decrement(struct nss_ctx_instance *nss_ctx, ato
 	atomic64_dec(stat);
 }
 
+/*
+ * nss_pkt_stats_add()
+ */
+static inline void nss_pkt_stats_add(struct nss_ctx_instance *nss_ctx, atomic64_t *stat, int64_t val)
+{
+	atomic64_add(val, stat);
+}
+
 /*
  * nss_pkt_stats_read()
  */
@@ -1227,6 +1305,16 @@ static inline uint64_t nss_pkt_stats_read(atomic64_t *stat)
 
 #endif
 
+/*
+ * nss_core_irq_mark()
+ *	Notes an interrupt taken for an interrupt context, for NAPI moderation
+ */
+static inline void nss_core_irq_mark(struct int_ctx_instance *int_ctx)
+{
+	int_ctx->mod.irq_time = ktime_get();
+	int_ctx->mod.epoch_irqs++;
+}
+
 /*
  * NSS Statistics and Data for User Space
  */
@@ -1414,6 +1502,19 @@ extern int nss_core_handle_napi(struct napi_struct *napi, int budget);
 extern int32_t nss_core_send_buffer(struct nss_ctx_instance *nss_ctx, uint32_t if_num,
 					struct sk_buff *nbuf, uint16_t qid,
 					uint8_t buffer_type, uint16_t flags);
+extern int32_t nss_core_send_packet(struct nss_ctx_instance *nss_ctx, uint32_t if_num,
+					struct sk_buff *nbuf, uint16_t qid,
+					uint8_t buffer_type, uint16_t flags);
+extern void nss_core_napi_init(struct int_ctx_instance *int_ctx);
+extern void nss_core_napi_cleanup(struct int_ctx_instance *int_ctx);
+extern const uint32_t nss_core_napi_mod_usecs[NSS_CORE_NAPI_MOD_LEVELS];
+extern void nss_core_send_init(struct nss_ctx_instance *nss_ctx);
+extern void nss_core_buf_pool_init(struct nss_ctx_instance *nss_ctx);
+extern void nss_core_buf_pool_cleanup(struct nss_ctx_instance *nss_ctx);
+extern struct sk_buff *nss_core_buf_pool_get(struct nss_ctx_instance *nss_ctx, dma_addr_t *buffer, uint16_t *buffer_len);
+extern void nss_core_buf_pool_recycle(struct nss_ctx_instance *nss_ctx, struct sk_buff *nbuf);
+extern void nss_core_buf_pool_schedule_refill(struct nss_ctx_instance *nss_ctx);
+extern void nss_core_send_cleanup(struct nss_ctx_instance *nss_ctx);
 extern void nss_wq_function( struct work_struct *work);
 extern uint32_t nss_core_register_handler(uint32_t interface, nss_core_rx_callback_t cb, void *app_data);
 extern uint32_t nss_core_unregister_handler(uint32_t interface);
@@ -0,0 +1,64 @@
+/*
+ **************************************************************************
+ * Copyright (c) 2017, The Linux Foundation. All rights reserved.
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+ * OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ **************************************************************************
+ */
+
+/*
+ * The emulated NSS cores have no GMACs or EDMA behind them, so there is no
+ * host data plane driver to take over. Physical interface packets are only
+ * seen by whoever registers for them with nss_phys_if_register().
+ */
+
+#include "nss_data_plane.h"
+#include "nss_core.h"
+
+/*
+ * __nss_data_plane_register()
+ */
+static void __nss_data_plane_register(struct nss_ctx_instance *nss_ctx)
+{
+	nss_info("%p: No data plane host to register with on the emulated NSS\n", nss_ctx);
+}
+
+/*
+ * __nss_data_plane_unregister()
+ */
+static void __nss_data_plane_unregister(void)
+{
+}
+
+/*
+ * __nss_data_plane_stats_sync()
+ */
+static void __nss_data_plane_stats_sync(struct nss_phys_if_stats *stats, uint16_t interface)
+{
+}
+
+/*
+ * __nss_data_plane_get_mtu_sz()
+ */
+static uint16_t __nss_data_plane_get_mtu_sz(uint16_t mtu)
+{
+	return mtu;
+}
+
+/*
+ * nss_data_plane_emu_ops
+ */
+struct nss_data_plane_ops nss_data_plane_emu_ops = {
+	.data_plane_register = &__nss_data_plane_register,
+	.data_plane_unregister = &__nss_data_plane_unregister,
+	.data_plane_stats_sync = &__nss_data_plane_stats_sync,
+	.data_plane_get_mtu_sz = &__nss_data_plane_get_mtu_sz,
+};
@@ -0,0 +1,831 @@
+/*
+ **************************************************************************
+ * Copyright (c) 2017, The Linux Foundation. All rights reserved.
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+ * OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ **************************************************************************
+ */
+
+/**
+ * nss_hal_pvt.c
+ *	NSS HAL private APIs for emulated NSS cores.
+ *
+ * Each emulated core is a kernel thread standing in for the NSS firmware.
+ * It owns a virtual register map in ordinary memory, laid out as the
+ * firmware lays out its TCM, and talks to the driver through the same
+ * H2N/N2H descriptor rings and interrupt causes as a real core:
+ *
+ * - Control messages are acknowledged: each one is copied into an empty
+ *   buffer with its response set to ACK and sent back as a status buffer.
+ * - Packets are consumed, echoed back up on the interface they were sent to
+ *   or forwarded up on another interface, see nss_emu_pkt_mode.
+ * - Every buffer the host sent is given back on the empty buffer queue.
+ *
+ * Interrupts to the host schedule NAPI directly. Buffers are reached through
+ * their DMA addresses, so these must be CPU physical addresses, which holds
+ * for direct and swiotlb DMA but not behind an IOMMU.
+ */
+
+#include <linux/err.h>
+#include <linux/version.h>
+#include <linux/debugfs.h>
+#include <linux/delay.h>
+#include <linux/dma-mapping.h>
+#include <linux/io.h>
+#include <linux/kthread.h>
+#include <linux/slab.h>
+#include <linux/wait.h>
+#include "nss_hal.h"
+#include "nss_core.h"
+
+/*
+ * Bus addresses of the CSM space and virtual register map of core 0, as on
+ * ipq806x. The driver only ever uses offsets from them.
+ */
+#define NSS_HAL_EMU_NPHYS 0x36000000
+#define NSS_HAL_EMU_NPHYS_STRIDE 0x400000
+#define NSS_HAL_EMU_VPHYS 0x39000000
+#define NSS_HAL_EMU_VPHYS_STRIDE 0x10000
+
+#define NSS_HAL_EMU_H2N_RINGS 2		/* Empty buffer queue and data/command queue */
+#define NSS_HAL_EMU_N2H_RINGS 2		/* Empty buffer queue and data queue 0 */
+#define NSS_HAL_EMU_RING_SIZE 128	/* Must be a power of 2 */
+#define NSS_HAL_EMU_RING_MASK (NSS_HAL_EMU_RING_SIZE - 1)
+
+#define NSS_HAL_EMU_BUDGET 64		/* H2N descriptors handled per pass */
+#define NSS_HAL_EMU_SOS_THRESHOLD (NSS_HAL_EMU_RING_SIZE / 4)
+					/* Ask for empty buffers when fewer are left */
+#define NSS_HAL_EMU_POLL_INTERVAL 1	/* Jiffies between passes without doorbells */
+
+/*
+ * What the emulated cores do with packets the host sends them
+ */
+enum nss_hal_emu_pkt_mode {
+	NSS_HAL_EMU_PKT_MODE_CONSUME,	/* Give the buffer back, as if the packet was transmitted */
+	NSS_HAL_EMU_PKT_MODE_ECHO,	/* Send the packet back up on the interface it was sent to */
+	NSS_HAL_EMU_PKT_MODE_FORWARD,	/* Send the packet up on nss_emu_fwd_if */
+};
+
+static uint nss_emu_cores = NSS_MAX_CORES;
+module_param(nss_emu_cores, uint, S_IRUGO);
+MODULE_PARM_DESC(nss_emu_cores, "Number of emulated NSS cores");
+
+static uint nss_emu_latency_us;
+module_param(nss_emu_latency_us, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(nss_emu_latency_us, "Time an emulated NSS core takes to turn descriptors around");
+
+static uint nss_emu_pkt_mode = NSS_HAL_EMU_PKT_MODE_CONSUME;
+module_param(nss_emu_pkt_mode, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(nss_emu_pkt_mode, "0: consume packets, 1: echo them, 2: forward them to nss_emu_fwd_if");
+
+static uint nss_emu_fwd_if;
+module_param(nss_emu_fwd_if, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(nss_emu_fwd_if, "Interface packets are forwarded to");
+
+/*
+ * Emulated core counters
+ */
+enum nss_hal_emu_stats_types {
+	NSS_HAL_EMU_STATS_H2N_DESCS,		/* H2N descriptors handled */
+	NSS_HAL_EMU_STATS_N2H_DESCS,		/* N2H descriptors produced */
+	NSS_HAL_EMU_STATS_MSGS_ACKED,		/* Control messages acknowledged */
+	NSS_HAL_EMU_STATS_PKTS_ECHOED,		/* Packets echoed or forwarded */
+	NSS_HAL_EMU_STATS_PKTS_CONSUMED,	/* Packet descriptors consumed */
+	NSS_HAL_EMU_STATS_NO_EMPTY_BUFFERS,	/* Replies dropped for lack of empty buffers */
+	NSS_HAL_EMU_STATS_INTERRUPTS,		/* Interrupts to the host */
+	NSS_HAL_EMU_STATS_MAX,
+};
+
+static const char *nss_hal_emu_stats_str[NSS_HAL_EMU_STATS_MAX] = {
+	"h2n_descs",
+	"n2h_descs",
+	"msgs_acked",
+	"pkts_echoed",
+	"pkts_consumed",
+	"no_empty_buffers",
+	"interrupts",
+};
+
+/*
+ * nss_hal_emu_vmap
+ *	Virtual register map of an emulated core, kept in TCM by the firmware
+ */
+struct nss_hal_emu_vmap {
+	struct nss_if_mem_map if_map;	/* Must be first, the driver finds it at vmap */
+	struct h2n_descriptor h2n_desc[NSS_HAL_EMU_H2N_RINGS][NSS_HAL_EMU_RING_SIZE] ____cacheline_aligned;
+	struct n2h_descriptor n2h_desc[NSS_HAL_EMU_N2H_RINGS][NSS_HAL_EMU_RING_SIZE] ____cacheline_aligned;
+};
+
+/*
+ * nss_hal_emu_core
+ *	An emulated NSS core, its CSM space as far as the driver is concerned
+ */
+struct nss_hal_emu_core {
+	struct nss_hal_emu_vmap vmap;		/* Virtual register map shared with the driver */
+	struct nss_ctx_instance *nss_ctx;	/* Driver context of this core */
+	struct platform_device *pdev;		/* Device the driver probes this core through */
+	struct task_struct *thread;		/* Thread running the core */
+	wait_queue_head_t doorbell_wq;		/* Thread waits here for H2N interrupts */
+	atomic_t doorbell;			/* Host sent an H2N interrupt */
+	spinlock_t lock;			/* Protects the N2H interrupt registers */
+	uint32_t n2h_status;			/* Raised N2H interrupt causes */
+	uint32_t n2h_mask;			/* Enabled N2H interrupt causes */
+	uint64_t stats[NSS_HAL_EMU_STATS_MAX];	/* Counters, exported through debugfs */
+};
+
+static struct nss_hal_emu_core *nss_hal_emu_cores[NSS_MAX_CORES];
+
+/*
+ * nss_hal_emu_from_ctx()
+ */
+static inline struct nss_hal_emu_core *nss_hal_emu_from_ctx(struct nss_ctx_instance *nss_ctx)
+{
+	return (struct nss_hal_emu_core __force *)nss_ctx->nmap;
+}
+
+/*
+ * nss_hal_emu_check_interrupt()
+ *	Interrupt the host if any raised cause is enabled. Called with the lock held.
+ *
+ * As the ipq806x interrupt handler does, the interrupt stays masked until
+ * NAPI is done with it.
+ */
+static void nss_hal_emu_check_interrupt(struct nss_hal_emu_core *emu)
+{
+	if (!(emu->n2h_status & emu->n2h_mask)) {
+		return;
+	}
+
+	emu->n2h_mask &= ~NSS_HAL_SUPPORTED_INTERRUPTS;
+	emu->stats[NSS_HAL_EMU_STATS_INTERRUPTS]++;
+	nss_core_irq_mark(&emu->nss_ctx->int_ctx[0]);
+	napi_schedule(&emu->nss_ctx->int_ctx[0].napi);
+}
+
+/*
+ * nss_hal_emu_raise_interrupt()
+ *
+ * Unlike a real interrupt this runs in process context. Bottom halves are
+ * disabled around it so that the NAPI softirq raised by napi_schedule()
+ * runs as they are enabled again, not at the next interrupt.
+ */
+static void nss_hal_emu_raise_interrupt(struct nss_hal_emu_core *emu, uint32_t cause)
+{
+	unsigned long irq_flags;
+
+	local_bh_disable();
+	spin_lock_irqsave(&emu->lock, irq_flags);
+	emu->n2h_status |= cause;
+	nss_hal_emu_check_interrupt(emu);
+	spin_unlock_irqrestore(&emu->lock, irq_flags);
+	local_bh_enable();
+}
+
+/*
+ * nss_hal_emu_n2h_space()
+ *	Number of free descriptors in an N2H ring.
+ */
+static inline uint32_t nss_hal_emu_n2h_space(struct nss_hal_emu_core *emu, uint16_t qid)
+{
+	struct nss_if_mem_map *if_map = &emu->vmap.if_map;
+
+	return (if_map->n2h_hlos_index[qid] - if_map->n2h_nss_index[qid] - 1) & NSS_HAL_EMU_RING_MASK;
+}
+
+/*
+ * nss_hal_emu_n2h_put()
+ *	Hand a descriptor to the host. The caller must have checked for space.
+ */
+static void nss_hal_emu_n2h_put(struct nss_hal_emu_core *emu, uint16_t qid, struct n2h_descriptor *n2h)
+{
+	struct nss_if_mem_map *if_map = &emu->vmap.if_map;
+	uint32_t nss_index = if_map->n2h_nss_index[qid];
+
+	emu->vmap.n2h_desc[qid][nss_index] = *n2h;
+
+	/*
+	 * The descriptor must be visible before the index that hands it over
+	 */
+	smp_wmb();
+	if_map->n2h_nss_index[qid] = (nss_index + 1) & NSS_HAL_EMU_RING_MASK;
+	emu->stats[NSS_HAL_EMU_STATS_N2H_DESCS]++;
+}
+
+/*
+ * nss_hal_emu_give_back()
+ *	Give a buffer the host sent back to it unchanged, as buffer_type.
+ */
+static void nss_hal_emu_give_back(struct nss_hal_emu_core *emu, struct h2n_descriptor *desc, uint16_t qid, uint8_t buffer_type)
+{
+	struct n2h_descriptor n2h;
+
+	memset(&n2h, 0, sizeof(n2h));
+	n2h.interface_num = desc->interface_num;
+	n2h.buffer = desc->buffer;
+	n2h.buffer_len = desc->buffer_len;
+	n2h.payload_offs = desc->payload_offs;
+	n2h.payload_len = desc->payload_len;
+	n2h.buffer_type = buffer_type;
+	n2h.opaque = desc->opaque;
+
+	nss_hal_emu_n2h_put(emu, qid, &n2h);
+}
+
+/*
+ * nss_hal_emu_reply()
+ *	Copy a buffer the host sent into an empty buffer and send that up as buffer_type.
+ *
+ * Returns the N2H cause to raise, or 0 if nothing was sent up.
+ */
+static uint32_t nss_hal_emu_reply(struct nss_hal_emu_core *emu, struct h2n_descriptor *desc, uint8_t buffer_type, uint32_t if_num)
+{
+	struct nss_if_mem_map *if_map = &emu->vmap.if_map;
+	uint32_t nss_index = if_map->h2n_nss_index[NSS_IF_EMPTY_BUFFER_QUEUE];
+	struct h2n_descriptor *empty;
+	struct n2h_descriptor n2h;
+	uint8_t *data;
+
+	/*
+	 * Only buffers that hold a whole packet or message are sent back
+	 */
+	if ((desc->bit_flags & (H2N_BIT_FLAG_FIRST_SEGMENT | H2N_BIT_FLAG_LAST_SEGMENT))
+			!= (H2N_BIT_FLAG_FIRST_SEGMENT | H2N_BIT_FLAG_LAST_SEGMENT)) {
+		return 0;
+	}
+
+	if (nss_index == READ_ONCE(if_map->h2n_hlos_index[NSS_IF_EMPTY_BUFFER_QUEUE])) {
+		emu->stats[NSS_HAL_EMU_STATS_NO_EMPTY_BUFFERS]++;
+		return NSS_N2H_INTR_EMPTY_BUFFERS_SOS;
+	}
+
+	/*
+	 * Read the empty buffer only after the index that handed it over
+	 */
+	smp_rmb();
+	empty = &emu->vmap.h2n_desc[NSS_IF_EMPTY_BUFFER_QUEUE][nss_index];
+	if (desc->payload_len > (empty->buffer_len - empty->payload_offs)) {
+		return 0;
+	}
+
+	data = (uint8_t *)phys_to_virt(empty->buffer) + empty->payload_offs;
+	memcpy(data, (uint8_t *)phys_to_virt(desc->buffer) + desc->payload_offs, desc->payload_len);
+
+	if ((buffer_type == N2H_BUFFER_STATUS) && (desc->payload_len >= sizeof(struct nss_cmn_msg))) {
+		((struct nss_cmn_msg *)data)->response = NSS_CMN_RESPONSE_ACK;
+	}
+
+	/*
+	 * There's no checksum offload here, so the packet isn't marked as checksummed
+	 */
+	memset(&n2h, 0, sizeof(n2h));
+	n2h.interface_num = if_num;
+	n2h.buffer = empty->buffer;
+	n2h.buffer_len = empty->buffer_len;
+	n2h.payload_offs = empty->payload_offs;
+	n2h.payload_len = desc->payload_len;
+	n2h.bit_flags = N2H_BIT_FLAG_FIRST_SEGMENT | N2H_BIT_FLAG_LAST_SEGMENT;
+	n2h.buffer_type = buffer_type;
+	n2h.opaque = empty->opaque;
+
+	nss_hal_emu_n2h_put(emu, NSS_IF_DATA_QUEUE_0, &n2h);
+	if_map->h2n_nss_index[NSS_IF_EMPTY_BUFFER_QUEUE] = (nss_index + 1) & NSS_HAL_EMU_RING_MASK;
+
+	return NSS_N2H_INTR_DATA_QUEUE_0;
+}
+
+/*
+ * nss_hal_emu_handle_desc()
+ *	Handle one descriptor from the data/command queue.
+ *
+ * Returns the N2H causes to raise.
+ */
+static uint32_t nss_hal_emu_handle_desc(struct nss_hal_emu_core *emu, struct h2n_descriptor *desc)
+{
+	uint32_t cause = 0;
+
+	switch (desc->buffer_type) {
+	case H2N_BUFFER_CTRL:
+		cause = nss_hal_emu_reply(emu, desc, N2H_BUFFER_STATUS, desc->interface_num);
+		if (cause & NSS_N2H_INTR_DATA_QUEUE_0) {
+			emu->stats[NSS_HAL_EMU_STATS_MSGS_ACKED]++;
+		}
+		break;
+
+	case H2N_BUFFER_PACKET:
+	case H2N_BUFFER_NATIVE_WIFI:
+		switch (READ_ONCE(nss_emu_pkt_mode)) {
+		case NSS_HAL_EMU_PKT_MODE_ECHO:
+			cause = nss_hal_emu_reply(emu, desc, N2H_BUFFER_PACKET, desc->interface_num);
+			break;
+
+		case NSS_HAL_EMU_PKT_MODE_FORWARD:
+			cause = nss_hal_emu_reply(emu, desc, N2H_BUFFER_PACKET, READ_ONCE(nss_emu_fwd_if));
+			break;
+		}
+
+		if (cause & NSS_N2H_INTR_DATA_QUEUE_0) {
+			emu->stats[NSS_HAL_EMU_STATS_PKTS_ECHOED]++;
+		} else {
+			emu->stats[NSS_HAL_EMU_STATS_PKTS_CONSUMED]++;
+		}
+		break;
+
+	/*
+	 * Bounced and crypto buffers go back up as they are, instead of being freed
+	 */
+	case H2N_BUFFER_SHAPER_BOUNCE_INTERFACE:
+		nss_hal_emu_give_back(emu, desc, NSS_IF_DATA_QUEUE_0, N2H_BUFFER_SHAPER_BOUNCED_INTERFACE);
+		return NSS_N2H_INTR_DATA_QUEUE_0;
+
+	case H2N_BUFFER_SHAPER_BOUNCE_BRIDGE:
+		nss_hal_emu_give_back(emu, desc, NSS_IF_DATA_QUEUE_0, N2H_BUFFER_SHAPER_BOUNCED_BRIDGE);
+		return NSS_N2H_INTR_DATA_QUEUE_0;
+
+	case H2N_BUFFER_CRYPTO_REQ:
+		nss_hal_emu_give_back(emu, desc, NSS_IF_DATA_QUEUE_0, N2H_BUFFER_CRYPTO_RESP);
+		return NSS_N2H_INTR_DATA_QUEUE_0;
+	}
+
+	/*
+	 * Only one of the descriptors of a scattered buffer carries the skb
+	 */
+	if (desc->opaque) {
+		nss_hal_emu_give_back(emu, desc, NSS_IF_EMPTY_BUFFER_QUEUE, N2H_BUFFER_EMPTY);
+		cause |= NSS_N2H_INTR_EMPTY_BUFFER_QUEUE;
+	}
+
+	return cause;
+}
+
+/*
+ * nss_hal_emu_core_run()
+ *	One pass of the emulated firmware over the data/command queue.
+ */
+static void nss_hal_emu_core_run(struct nss_hal_emu_core *emu)
+{
+	struct nss_if_mem_map *if_map = &emu->vmap.if_map;
+	uint32_t nss_index = if_map->h2n_nss_index[NSS_IF_DATA_QUEUE_0];
+	uint32_t hlos_index = READ_ONCE(if_map->h2n_hlos_index[NSS_IF_DATA_QUEUE_0]);
+	bool was_full = (((hlos_index + 1) & NSS_HAL_EMU_RING_MASK) == nss_index);
+	int budget = NSS_HAL_EMU_BUDGET;
+	uint32_t cause = 0;
+	uint32_t empty;
+
+	/*
+	 * Read descriptors only after the index that handed them over
+	 */
+	smp_rmb();
+
+	while ((nss_index != hlos_index) && budget) {
+		/*
+		 * A descriptor may need one N2H descriptor on each ring
+		 */
+		if (!nss_hal_emu_n2h_space(emu, NSS_IF_EMPTY_BUFFER_QUEUE) || !nss_hal_emu_n2h_space(emu, NSS_IF_DATA_QUEUE_0)) {
+			break;
+		}
+
+		cause |= nss_hal_emu_handle_desc(emu, &emu->vmap.h2n_desc[NSS_IF_DATA_QUEUE_0][nss_index]);
+		emu->stats[NSS_HAL_EMU_STATS_H2N_DESCS]++;
+		nss_index = (nss_index + 1) & NSS_HAL_EMU_RING_MASK;
+		budget--;
+	}
+
+	/*
+	 * Hand the descriptors back only once we are done with them
+	 */
+	smp_mb();
+	if_map->h2n_nss_index[NSS_IF_DATA_QUEUE_0] = nss_index;
+
+	if (was_full && (budget != NSS_HAL_EMU_BUDGET)) {
+		cause |= NSS_N2H_INTR_TX_UNBLOCKED;
+	}
+
+	empty = (READ_ONCE(if_map->h2n_hlos_index[NSS_IF_EMPTY_BUFFER_QUEUE]) - if_map->h2n_nss_index[NSS_IF_EMPTY_BUFFER_QUEUE]) & NSS_HAL_EMU_RING_MASK;
+	if (empty < NSS_HAL_EMU_SOS_THRESHOLD) {
+		cause |= NSS_N2H_INTR_EMPTY_BUFFERS_SOS;
+	}
+
+	if (cause) {
+		nss_hal_emu_raise_interrupt(emu, cause);
+	}
+
+	/*
+	 * Come straight back for the rest if we ran out of budget
+	 */
+	if (!budget) {
+		atomic_set(&emu->doorbell, 1);
+	}
+}
+
+/*
+ * nss_hal_emu_core_thread()
+ *	Runs an emulated core until it is stopped.
+ */
+static int nss_hal_emu_core_thread(void *arg)
+{
+	struct nss_hal_emu_core *emu = (struct nss_hal_emu_core *)arg;
+	uint32_t latency_us;
+
+	while (!kthread_should_stop()) {
+		wait_event_interruptible_timeout(emu->doorbell_wq,
+				atomic_read(&emu->doorbell) || kthread_should_stop(), NSS_HAL_EMU_POLL_INTERVAL);
+		atomic_set(&emu->doorbell, 0);
+
+		/*
+		 * Stand in for the time the firmware spends on the descriptors
+		 */
+		latency_us = READ_ONCE(nss_emu_latency_us);
+		if (latency_us) {
+			usleep_range(latency_us, latency_us);
+		}
+
+		nss_hal_emu_core_run(emu);
+		cond_resched();
+	}
+
+	return 0;
+}
+
+/*
+ * nss_hal_emu_debugfs_init()
+ *	Export the counters of an emulated core.
+ */
+static void nss_hal_emu_debugfs_init(struct nss_hal_emu_core *emu, int id)
+{
+	struct dentry *dentry;
+	char name[8];
+	int i;
+
+	if (!nss_top_main.top_dentry) {
+		return;
+	}
+
+	snprintf(name, sizeof(name), "emu%d", id);
+	dentry = debugfs_create_dir(name, nss_top_main.top_dentry);
+	if (unlikely(!dentry)) {
+		nss_warning("%p: Failed to create qca-nss-drv/%s directory in debugfs", emu, name);
+		return;
+	}
+
+	for (i = 0; i < NSS_HAL_EMU_STATS_MAX; i++) {
+		debugfs_create_u64(nss_hal_emu_stats_str[i], S_IRUGO, dentry, &emu->stats[i]);
+	}
+}
+
+/*
+ * __nss_hal_of_get_pdata()
+ *	Make up the platform data of an emulated core, features split as on ipq806x.
+ */
+static struct nss_platform_data *__nss_hal_of_get_pdata(struct platform_device *pdev)
+{
+	struct nss_platform_data *npd;
+	struct nss_hal_emu_core *emu;
+
+	if ((pdev->id < 0) || (pdev->id >= NSS_MAX_CORES) || !nss_hal_emu_cores[pdev->id]) {
+		pr_err("%s: not an emulated NSS core\n", dev_name(&pdev->dev));
+		return NULL;
+	}
+
+	emu = nss_hal_emu_cores[pdev->id];
+
+	npd = devm_kzalloc(&pdev->dev, sizeof(struct nss_platform_data), GFP_KERNEL);
+	if (!npd) {
+		return NULL;
+	}
+
+	npd->id = pdev->id;
+	npd->num_queue = 1;
+	npd->num_irq = 0;
+	npd->nmap = (void __iomem __force *)emu;
+	npd->vmap = (void __iomem __force *)&emu->vmap;
+	npd->nphys = NSS_HAL_EMU_NPHYS + (npd->id * NSS_HAL_EMU_NPHYS_STRIDE);
+	npd->vphys = NSS_HAL_EMU_VPHYS + (npd->id * NSS_HAL_EMU_VPHYS_STRIDE);
+
+	if (npd->id == 0) {
+		npd->bridge_enabled = NSS_FEATURE_ENABLED;
+		npd->gre_enabled = NSS_FEATURE_ENABLED;
+		npd->gre_redir_enabled = NSS_FEATURE_ENABLED;
+		npd->gre_tunnel_enabled = NSS_FEATURE_ENABLED;
+		npd->ipv4_enabled = NSS_FEATURE_ENABLED;
+		npd->ipv4_reasm_enabled = NSS_FEATURE_ENABLED;
+		npd->ipv6_enabled = NSS_FEATURE_ENABLED;
+		npd->ipv6_reasm_enabled = NSS_FEATURE_ENABLED;
+		npd->l2tpv2_enabled = NSS_FEATURE_ENABLED;
+		npd->map_t_enabled = NSS_FEATURE_ENABLED;
+		npd->pppoe_enabled = NSS_FEATURE_ENABLED;
+		npd->pptp_enabled = NSS_FEATURE_ENABLED;
+		npd->portid_enabled = NSS_FEATURE_ENABLED;
+		npd->shaping_enabled = NSS_FEATURE_ENABLED;
+		npd->tun6rd_enabled = NSS_FEATURE_ENABLED;
+		npd->tunipip6_enabled = NSS_FEATURE_ENABLED;
+		npd->vlan_enabled = NSS_FEATURE_ENABLED;
+		npd->wifioffload_enabled = NSS_FEATURE_ENABLED;
+		npd->wlanredirect_enabled = NSS_FEATURE_ENABLED;
+	} else {
+		npd->capwap_enabled = NSS_FEATURE_ENABLED;
+		npd->crypto_enabled = NSS_FEATURE_ENABLED;
+		npd->dtls_enabled = NSS_FEATURE_ENABLED;
+		npd->ipsec_enabled = NSS_FEATURE_ENABLED;
+	}
+
+	/*
+	 * Once per probe, as the core is reset again on recovery. The
+	 * directory goes with the rest of qca-nss-drv in nss_stats_clean().
+	 */
+	nss_hal_emu_debugfs_init(emu, pdev->id);
+	return npd;
+}
+
+/*
+ * __nss_hal_core_reset()
+ *	Boot an emulated core.
+ */
+static int __nss_hal_core_reset(struct platform_device *nss_dev, void __iomem *map, uint32_t addr, uint32_t clk_src)
+{
+	struct nss_hal_emu_core *emu = (struct nss_hal_emu_core __force *)map;
+	struct nss_if_mem_map *if_map = &emu->vmap.if_map;
+	uint32_t vphys = emu->nss_ctx->vphys;
+	int i;
+	unsigned long irq_flags;
+
+	if (emu->thread) {
+		kthread_stop(emu->thread);
+		emu->thread = NULL;
+	}
+
+	/*
+	 * Lay out the rings as the firmware does when it boots
+	 */
+	memset(&emu->vmap, 0, sizeof(emu->vmap));
+	for (i = 0; i < NSS_HAL_EMU_H2N_RINGS; i++) {
+		if_map->h2n_desc_if[i].desc_addr = vphys + ((uint8_t *)emu->vmap.h2n_desc[i] - (uint8_t *)&emu->vmap);
+		if_map->h2n_desc_if[i].size = NSS_HAL_EMU_RING_SIZE;
+	}
+
+	for (i = 0; i < NSS_HAL_EMU_N2H_RINGS; i++) {
+		if_map->n2h_desc_if[i].desc_addr = vphys + ((uint8_t *)emu->vmap.n2h_desc[i] - (uint8_t *)&emu->vmap);
+		if_map->n2h_desc_if[i].size = NSS_HAL_EMU_RING_SIZE;
+	}
+
+	if_map->h2n_rings = NSS_HAL_EMU_H2N_RINGS;
+	if_map->n2h_rings = NSS_HAL_EMU_N2H_RINGS;
+	if_map->if_version = DEV_INTERFACE_VERSION;
+	smp_wmb();
+	if_map->magic = DEV_MAGIC;
+
+	/*
+	 * The firmware's first request for empty buffers is what gets the
+	 * driver to set up its side. It is delivered once interrupts are enabled.
+	 */
+	spin_lock_irqsave(&emu->lock, irq_flags);
+	emu->n2h_status = NSS_N2H_INTR_EMPTY_BUFFERS_SOS;
+	spin_unlock_irqrestore(&emu->lock, irq_flags);
+
+	emu->thread = kthread_run(nss_hal_emu_core_thread, emu, "nss_emu%d", nss_dev->id);
+	if (IS_ERR(emu->thread)) {
+		int err = PTR_ERR(emu->thread);
+
+		nss_info_always("%p: Failed to start emulated NSS core %d: %d\n", emu, nss_dev->id, err);
+		emu->thread = NULL;
+		return err;
+	}
+
+	return 0;
+}
+
+/*
+ * __nss_hal_debug_enable()
+ */
+static void __nss_hal_debug_enable(void)
+{
+
+}
+
+/*
+ * __nss_hal_common_reset()
+ */
+static int __nss_hal_common_reset(struct platform_device *nss_dev)
+{
+	nss_top_main.nss_hal_common_init_done = true;
+	nss_info("nss_hal_common_reset Done\n");
+	return 0;
+}
+
+/*
+ * __nss_hal_clock_configure()
+ */
+static int __nss_hal_clock_configure(struct nss_ctx_instance *nss_ctx, struct platform_device *nss_dev, struct nss_platform_data *npd)
+{
+	return 0;
+}
+
+/*
+ * __nss_hal_firmware_load()
+ *	There is no firmware to load, the emulated core starts on reset.
+ */
+static int __nss_hal_firmware_load(struct nss_ctx_instance *nss_ctx, struct platform_device *nss_dev, struct nss_platform_data *npd)
+{
+	return 0;
+}
+
+/*
+ * __nss_hal_read_interrupt_cause()
+ */
+static void __nss_hal_read_interrupt_cause(struct nss_ctx_instance *nss_ctx, uint32_t shift_factor, uint32_t *cause)
+{
+	struct nss_hal_emu_core *emu = nss_hal_emu_from_ctx(nss_ctx);
+	unsigned long irq_flags;
+
+	spin_lock_irqsave(&emu->lock, irq_flags);
+	*cause = emu->n2h_status;
+	spin_unlock_irqrestore(&emu->lock, irq_flags);
+}
+
+/*
+ * __nss_hal_clear_interrupt_cause()
+ */
+static void __nss_hal_clear_interrupt_cause(struct nss_ctx_instance *nss_ctx, uint32_t shift_factor, uint32_t cause)
+{
+	struct nss_hal_emu_core *emu = nss_hal_emu_from_ctx(nss_ctx);
+	unsigned long irq_flags;
+
+	spin_lock_irqsave(&emu->lock, irq_flags);
+	emu->n2h_status &= ~cause;
+	spin_unlock_irqrestore(&emu->lock, irq_flags);
+}
+
+/*
+ * __nss_hal_disable_interrupt()
+ */
+static void __nss_hal_disable_interrupt(struct nss_ctx_instance *nss_ctx, uint32_t shift_factor, uint32_t cause)
+{
+	struct nss_hal_emu_core *emu = nss_hal_emu_from_ctx(nss_ctx);
+	unsigned long irq_flags;
+
+	spin_lock_irqsave(&emu->lock, irq_flags);
+	emu->n2h_mask &= ~cause;
+	spin_unlock_irqrestore(&emu->lock, irq_flags);
+}
+
+/*
+ * __nss_hal_enable_interrupt()
+ *	Causes raised while they were disabled interrupt the host right away.
+ */
+static void __nss_hal_enable_interrupt(struct nss_ctx_instance *nss_ctx, uint32_t shift_factor, uint32_t cause)
+{
+	struct nss_hal_emu_core *emu = nss_hal_emu_from_ctx(nss_ctx);
+	unsigned long irq_flags;
+
+	/*
+	 * May be called from process context, see nss_hal_emu_raise_interrupt()
+	 */
+	local_bh_disable();
+	spin_lock_irqsave(&emu->lock, irq_flags);
+	emu->n2h_mask |= cause;
+	nss_hal_emu_check_interrupt(emu);
+	spin_unlock_irqrestore(&emu->lock, irq_flags);
+	local_bh_enable();
+}
+
+/*
+ * __nss_hal_send_interrupt()
+ *	Ring the doorbell of the emulated core.
+ */
+static void __nss_hal_send_interrupt(struct nss_ctx_instance *nss_ctx, uint32_t type)
+{
+	struct nss_hal_emu_core *emu = nss_hal_emu_from_ctx(nss_ctx);
+
+	nss_assert(type < NSS_H2N_INTR_TYPE_MAX);
+
+	/*
+	 * There is no firmware state to dump
+	 */
+	if (type == NSS_H2N_INTR_TRIGGER_COREDUMP) {
+		return;
+	}
+
+	atomic_set(&emu->doorbell, 1);
+	wake_up_interruptible(&emu->doorbell_wq);
+}
+
+/*
+ * __nss_hal_request_irq_for_queue()
+ *	The emulated core schedules NAPI itself, there are no IRQs to request.
+ */
+static int __nss_hal_request_irq_for_queue(struct nss_ctx_instance *nss_ctx, struct nss_platform_data *npd, int qnum)
+{
+	struct int_ctx_instance *int_ctx = &nss_ctx->int_ctx[qnum];
+	struct nss_hal_emu_core *emu = nss_hal_emu_from_ctx(nss_ctx);
+
+	snprintf(int_ctx->irq_name, 11, "nss_queue%d", qnum);
+	int_ctx->shift_factor = 0;
+	int_ctx->queue_cause = (1 << (qnum + 1));
+	emu->nss_ctx = nss_ctx;
+	return 0;
+}
+
+/*
+ * nss_hal_emu_register_devices()
+ *	Create a platform device for each emulated core, which the driver then probes.
+ */
+int nss_hal_emu_register_devices(void)
+{
+	struct platform_device_info pdevinfo;
+	struct nss_hal_emu_core *emu;
+	int i, err;
+
+	if (!nss_emu_cores || (nss_emu_cores > NSS_MAX_CORES)) {
+		nss_info_always("Invalid number of emulated NSS cores: %u\n", nss_emu_cores);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < nss_emu_cores; i++) {
+		emu = kzalloc(sizeof(struct nss_hal_emu_core), GFP_KERNEL);
+		if (!emu) {
+			err = -ENOMEM;
+			goto fail;
+		}
+
+		init_waitqueue_head(&emu->doorbell_wq);
+		atomic_set(&emu->doorbell, 0);
+		spin_lock_init(&emu->lock);
+		nss_hal_emu_cores[i] = emu;
+
+		/*
+		 * Descriptors only carry 32 bit buffer addresses
+		 */
+		memset(&pdevinfo, 0, sizeof(pdevinfo));
+		pdevinfo.name = "qca-nss";
+		pdevinfo.id = i;
+		pdevinfo.dma_mask = DMA_BIT_MASK(32);
+
+		emu->pdev = platform_device_register_full(&pdevinfo);
+		if (IS_ERR(emu->pdev)) {
+			err = PTR_ERR(emu->pdev);
+			emu->pdev = NULL;
+			goto fail;
+		}
+	}
+
+	return 0;
+
+fail:
+	nss_info_always("Failed to create emulated NSS core %d: %d\n", i, err);
+	nss_hal_emu_unregister_devices();
+	return err;
+}
+
+/*
+ * nss_hal_emu_unregister_devices()
+ *	Stop the emulated cores and remove their platform devices.
+ */
+void nss_hal_emu_unregister_devices(void)
+{
+	struct nss_hal_emu_core *emu;
+	int i;
+
+	for (i = 0; i < NSS_MAX_CORES; i++) {
+		emu = nss_hal_emu_cores[i];
+		if (!emu) {
+			continue;
+		}
+
+		if (emu->thread) {
+			kthread_stop(emu->thread);
+			emu->thread = NULL;
+		}
+
+		if (emu->pdev) {
+			platform_device_unregister(emu->pdev);
+		}
+
+		nss_hal_emu_cores[i] = NULL;
+		kfree(emu);
+	}
+}
+
+/*
+ * nss_hal_emu_ops
+ */
+struct nss_hal_ops nss_hal_emu_ops = {
+	.common_reset = __nss_hal_common_reset,
+	.core_reset = __nss_hal_core_reset,
+	.clock_configure = __nss_hal_clock_configure,
+	.firmware_load = __nss_hal_firmware_load,
+	.debug_enable = __nss_hal_debug_enable,
+	.of_get_pdata = __nss_hal_of_get_pdata,
+	.request_irq_for_queue = __nss_hal_request_irq_for_queue,
+	.send_interrupt = __nss_hal_send_interrupt,
+	.enable_interrupt = __nss_hal_enable_interrupt,
+	.disable_interrupt = __nss_hal_disable_interrupt,
+	.clear_interrupt_cause = __nss_hal_clear_interrupt_cause,
+	.read_interrupt_cause = __nss_hal_read_interrupt_cause,
+};
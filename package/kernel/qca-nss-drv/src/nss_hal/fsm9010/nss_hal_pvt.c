@@ -72,6 +72,7 @@ static irqreturn_t nss_hal_handle_irq(int irq, void *ctx)
 	/*
 	 * Schedule tasklet to process interrupt cause
 	 */
+	nss_core_irq_mark(int_ctx);
 	napi_schedule(&int_ctx->napi);
 	return IRQ_HANDLED;
 }
@@ -41,6 +41,12 @@ extern struct nss_hal_ops nss_hal_ipq807x_ops;
 #if defined(NSS_HAL_FSM9010_SUPPORT)
 extern struct nss_hal_ops nss_hal_fsm9010_ops;
 #endif
+#if defined(NSS_HAL_EMU_SUPPORT)
+extern struct nss_hal_ops nss_hal_emu_ops;
+#define NSS_HAL_IS_EMU() (nss_top_main.hal_ops == &nss_hal_emu_ops)
+#else
+#define NSS_HAL_IS_EMU() false
+#endif
 
 #define NSS_HAL_SUPPORTED_INTERRUPTS (NSS_N2H_INTR_EMPTY_BUFFER_QUEUE | \
 					NSS_N2H_INTR_DATA_QUEUE_0 | \
@@ -87,6 +93,10 @@ static inline void nss_hal_enable_interrupt(struct nss_ctx_instance *nss_ctx, ui
  */
 static inline void nss_hal_send_interrupt(struct nss_ctx_instance *nss_ctx, uint32_t cause)
 {
+	if (cause == NSS_H2N_INTR_DATA_COMMAND_QUEUE) {
+		NSS_PKT_STATS_INCREMENT(nss_ctx, &nss_ctx->nss_top->stats_drv[NSS_STATS_DRV_TX_DOORBELL]);
+	}
+
 	nss_top_main.hal_ops->send_interrupt(nss_ctx, cause);
 }
 
@@ -117,4 +127,16 @@ int nss_hal_firmware_load(struct nss_ctx_instance *nss_ctx, struct platform_devi
  * nss_hal_dt_parse_features()
  */
 void nss_hal_dt_parse_features(struct device_node *np, struct nss_platform_data *npd);
+
+#if defined(NSS_HAL_EMU_SUPPORT)
+/*
+ * nss_hal_emu_register_devices()
+ */
+int nss_hal_emu_register_devices(void);
+
+/*
+ * nss_hal_emu_unregister_devices()
+ */
+void nss_hal_emu_unregister_devices(void);
+#endif
 #endif /* __NSS_HAL_H */
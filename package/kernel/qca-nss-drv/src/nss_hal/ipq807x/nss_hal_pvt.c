@@ -60,6 +60,7 @@ static irqreturn_t nss_hal_handle_data_cmd_queue_irq(int irq, void *ctx)
 
 	int_ctx->cause |= int_ctx->queue_cause;
 
+	nss_core_irq_mark(int_ctx);
 	if (napi_schedule_prep(&int_ctx->napi))
 		__napi_schedule(&int_ctx->napi);
 
@@ -75,6 +76,7 @@ static irqreturn_t nss_hal_handle_empty_buff_sos_irq(int irq, void *ctx)
 
 	int_ctx->cause |= NSS_N2H_INTR_EMPTY_BUFFERS_SOS;
 
+	nss_core_irq_mark(int_ctx);
 	if (napi_schedule_prep(&int_ctx->napi))
 		__napi_schedule(&int_ctx->napi);
 
@@ -90,6 +92,7 @@ static irqreturn_t nss_hal_handle_empty_buff_queue_irq(int irq, void *ctx)
 
 	int_ctx->cause |= NSS_N2H_INTR_EMPTY_BUFFER_QUEUE;
 
+	nss_core_irq_mark(int_ctx);
 	if (napi_schedule_prep(&int_ctx->napi))
 		__napi_schedule(&int_ctx->napi);
 
@@ -105,6 +108,7 @@ static irqreturn_t nss_hal_handle_tx_unblock_irq(int irq, void *ctx)
 
 	int_ctx->cause |= NSS_N2H_INTR_TX_UNBLOCKED;
 
+	nss_core_irq_mark(int_ctx);
 	if (napi_schedule_prep(&int_ctx->napi))
 		__napi_schedule(&int_ctx->napi);
 	return IRQ_HANDLED;
@@ -143,6 +143,18 @@ static void nss_hal_clean_up_netdevice(struct int_ctx_instance *int_ctx)
 {
 	int i;
 
+	/*
+	 * A poll can arm the moderation timer, which re-enables the interrupt, so
+	 * polling has to stop before the timer is cancelled and the IRQs freed.
+	 */
+	if (int_ctx->ndev) {
+		if (int_ctx->napi.poll) {
+			napi_disable(&int_ctx->napi);
+		}
+
+		nss_core_napi_cleanup(int_ctx);
+	}
+
 	for (i = 0; i < NSS_MAX_IRQ_PER_INSTANCE; i++) {
 		if (int_ctx->irq[i]) {
 			free_irq(int_ctx->irq[i], int_ctx);
@@ -199,6 +211,7 @@ static int nss_hal_register_netdevice(struct nss_ctx_instance *nss_ctx, struct n
 	 */
 	int_ctx->nss_ctx = nss_ctx;
 	int_ctx->ndev = netdev;
+	nss_core_napi_init(int_ctx);
 	err = nss_top->hal_ops->request_irq_for_queue(nss_ctx, npd, qnum);
 	if (err) {
 		nss_warning("%p: IRQ request for queue %d failed", nss_ctx, qnum);
@@ -236,7 +249,10 @@ int nss_hal_probe(struct platform_device *nss_dev)
 	}
 
 #if (NSS_DT_SUPPORT == 1)
-	if (!nss_dev->dev.of_node) {
+	/*
+	 * Emulated NSS cores are not described by the device tree
+	 */
+	if (!nss_dev->dev.of_node && !NSS_HAL_IS_EMU()) {
 		pr_err("nss-driver: Device tree not available\n");
 		return -ENODEV;
 	}
@@ -544,6 +560,11 @@ int nss_hal_probe(struct platform_device *nss_dev)
 	 */
 	nss_ctx->dev = &nss_dev->dev;
 
+	/*
+	 * Start mapping empty buffers for the NSS ahead of its first request
+	 */
+	nss_core_buf_pool_init(nss_ctx);
+
 	/*
 	 * Enable interrupts for NSS core
 	 */
@@ -613,6 +634,17 @@ int nss_hal_remove(struct platform_device *nss_dev)
 	 */
 	nss_top->data_plane_ops->data_plane_unregister();
 
+	/*
+	 * Stop flushing H2N descriptors held back from the NSS. This must come
+	 * after the data plane is gone, as its transmits may arm the flush timer.
+	 */
+	nss_core_send_cleanup(nss_ctx);
+
+	/*
+	 * Free the empty buffers we still hold mapped for the NSS
+	 */
+	nss_core_buf_pool_cleanup(nss_ctx);
+
 #if (NSS_FABRIC_SCALING_SUPPORT == 1)
 	fab_scaling_unregister(nss_core0_clk);
 #endif
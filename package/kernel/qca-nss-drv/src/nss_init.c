@@ -658,8 +658,17 @@ static int __init nss_init(void)
 	 */
 	cmn = of_find_node_by_name(NULL, "nss-common");
 	if (!cmn) {
+#if defined(NSS_HAL_EMU_SUPPORT)
+		/*
+		 * No NSS on this machine, run against emulated NSS cores instead
+		 */
+		nss_info_always("qca-nss-drv.ko is using emulated NSS cores\n");
+		nss_top_main.hal_ops = &nss_hal_emu_ops;
+		nss_top_main.data_plane_ops = &nss_data_plane_emu_ops;
+#else
 		nss_info_always("qca-nss-drv.ko is loaded for symbol link\n");
 		return 0;
+#endif
 	}
 	of_node_put(cmn);
 
@@ -795,6 +804,25 @@ static int __init nss_init(void)
 	/*
 	 * Register platform_driver
 	 */
+#if defined(NSS_HAL_EMU_SUPPORT)
+	if (NSS_HAL_IS_EMU()) {
+		int err = platform_driver_register(&nss_driver);
+		if (err) {
+			return err;
+		}
+
+		/*
+		 * Emulated NSS cores don't come from the device tree, create their devices
+		 */
+		err = nss_hal_emu_register_devices();
+		if (err) {
+			platform_driver_unregister(&nss_driver);
+		}
+
+		return err;
+	}
+#endif
+
 	return platform_driver_register(&nss_driver);
 }
 
@@ -835,6 +863,12 @@ static void __exit nss_cleanup(void)
 		nss_ppe_free();
 	}
 
+#if defined(NSS_HAL_EMU_SUPPORT)
+	if (NSS_HAL_IS_EMU()) {
+		nss_hal_emu_unregister_devices();
+	}
+#endif
+
 	platform_driver_unregister(&nss_driver);
 }
 
@@ -22,7 +22,7 @@
 #include "nss_tx_rx_common.h"
 #include "nss_ipsec.h"
 
-#if defined(NSS_HAL_IPQ806X_SUPPORT)
+#if defined(NSS_HAL_IPQ806X_SUPPORT) || defined(NSS_HAL_EMU_SUPPORT)
 #define NSS_IPSEC_ENCAP_INTERFACE_NUM NSS_IPSEC_ENCAP_IF_NUMBER
 #define NSS_IPSEC_DECAP_INTERFACE_NUM NSS_IPSEC_DECAP_IF_NUMBER
 #define NSS_IPSEC_DATA_INTERFACE_NUM NSS_C2C_TX_INTERFACE
@@ -191,7 +191,17 @@ static int8_t *nss_stats_str_drv[NSS_STATS_DRV_MAX] = {
 	"rx_bad_desciptor",
 	"nss_skb_count",
 	"rx_chain_seg_processed",
-	"rx_frag_seg_processed"
+	"rx_frag_seg_processed",
+	"tx_reserve_retry",
+	"tx_publish_wait",
+	"tx_doorbells",
+	"tx_index_writes",
+	"tx_deferred",
+	"rx_index_writes",
+	"buf_pool_hit",
+	"buf_pool_miss",
+	"buf_pool_miss_ns",
+	"buf_pool_recycled"
 };
 
 /*
@@ -1776,6 +1786,79 @@ static ssize_t nss_stats_drv_read(struct file *fp, char __user *ubuf, size_t sz,
 	return bytes_read;
 }
 
+/*
+ * nss_stats_napi_hist()
+ *	Print one NAPI histogram, bucket i counting values below 2^i
+ */
+static size_t nss_stats_napi_hist(char *lbuf, size_t size_al, size_t size_wr, const char *name, uint64_t *hist)
+{
+	int32_t i;
+
+	size_wr += scnprintf(lbuf + size_wr, size_al - size_wr, "%s:", name);
+	for (i = 0; i < NSS_CORE_NAPI_HIST_BUCKETS - 1; i++) {
+		size_wr += scnprintf(lbuf + size_wr, size_al - size_wr, " <%u=%llu", 1U << i, hist[i]);
+	}
+
+	size_wr += scnprintf(lbuf + size_wr, size_al - size_wr, " >=%u=%llu\n", 1U << (i - 1), hist[i]);
+	return size_wr;
+}
+
+/*
+ * nss_stats_napi_read()
+ *	Read NAPI moderation stats and histograms
+ */
+static ssize_t nss_stats_napi_read(struct file *fp, char __user *ubuf, size_t sz, loff_t *ppos)
+{
+	int32_t i, j, k;
+
+	/*
+	 * max output lines per queue = name line + four histograms + blank line
+	 */
+	uint32_t max_output_lines = (NSS_MAX_CORES * NSS_MAX_DATA_QUEUE * 6) + 5;
+	size_t size_al = NSS_STATS_MAX_STR_LENGTH * 4 * max_output_lines;
+	size_t size_wr = 0;
+	ssize_t bytes_read = 0;
+
+	char *lbuf = kzalloc(size_al, GFP_KERNEL);
+	if (unlikely(lbuf == NULL)) {
+		nss_warning("Could not allocate memory for local statistics buffer");
+		return 0;
+	}
+
+	size_wr = scnprintf(lbuf, size_al, "napi stats start:\n\n");
+	for (i = 0; i < NSS_MAX_CORES; i++) {
+		for (j = 0; j < NSS_MAX_DATA_QUEUE; j++) {
+			struct int_ctx_instance *int_ctx = &nss_top_main.nss[i].int_ctx[j];
+			struct nss_core_napi_mod *mod = &int_ctx->mod;
+
+			if (!int_ctx->ndev) {
+				continue;
+			}
+
+			size_wr += scnprintf(lbuf + size_wr, size_al - size_wr,
+					"%s: level = %d (%u usecs) busy_polls = %llu\n", int_ctx->irq_name,
+					mod->level, nss_core_napi_mod_usecs[mod->level], mod->busy_polls);
+			size_wr = nss_stats_napi_hist(lbuf, size_al, size_wr, "latency_us", mod->hist_latency);
+			size_wr = nss_stats_napi_hist(lbuf, size_al, size_wr, "pkts_per_poll", mod->hist_pkts);
+			size_wr = nss_stats_napi_hist(lbuf, size_al, size_wr, "irq_rate", mod->hist_irq_rate);
+
+			size_wr += scnprintf(lbuf + size_wr, size_al - size_wr, "level_epochs:");
+			for (k = 0; k < NSS_CORE_NAPI_MOD_LEVELS; k++) {
+				size_wr += scnprintf(lbuf + size_wr, size_al - size_wr, " %uus=%llu",
+						nss_core_napi_mod_usecs[k], mod->hist_level[k]);
+			}
+
+			size_wr += scnprintf(lbuf + size_wr, size_al - size_wr, "\n\n");
+		}
+	}
+
+	size_wr += scnprintf(lbuf + size_wr, size_al - size_wr, "napi stats end\n\n");
+	bytes_read = simple_read_from_buffer(ubuf, sz, ppos, lbuf, strlen(lbuf));
+	kfree(lbuf);
+
+	return bytes_read;
+}
+
 /*
  * nss_stats_pppoe_read()
  *	Read PPPoE stats
@@ -3438,6 +3521,11 @@ NSS_STATS_DECLARE_FILE_OPERATIONS(lso_rx)
  */
 NSS_STATS_DECLARE_FILE_OPERATIONS(drv)
 
+/*
+ * napi_stats_ops
+ */
+NSS_STATS_DECLARE_FILE_OPERATIONS(napi)
+
 /*
  * pppoe_stats_ops
  */
@@ -3837,6 +3925,16 @@ void nss_stats_init(void)
 		return;
 	}
 
+	/*
+	 * napi_stats
+	 */
+	nss_top_main.napi_dentry = debugfs_create_file("napi", 0400,
+						nss_top_main.stats_dentry, &nss_top_main, &nss_stats_napi_ops);
+	if (unlikely(nss_top_main.napi_dentry == NULL)) {
+		nss_warning("Failed to create qca-nss-drv/stats/napi directory in debugfs");
+		return;
+	}
+
 	/*
 	 * pppoe_stats
 	 */
@@ -26,6 +26,7 @@
 #include <linux/pkt_sched.h>
 #include <linux/string.h>
 #include <linux/random.h>
+#include <linux/sched/clock.h>
 #include <net/route.h>
 #include <net/ip.h>
 #include <net/tcp.h>
@@ -67,6 +68,9 @@
 #include "ecm_front_end_types.h"
 #include "ecm_classifier_default.h"
 #include "ecm_db.h"
+#ifdef ECM_STATE_OUTPUT_ENABLE
+#include "ecm_state_export.h"
+#endif
 
 /*
  * Magic numbers
@@ -352,7 +356,8 @@ struct ecm_db_node_instance {
 	ecm_db_node_final_callback_t final;		/* Callback to owner when object is destroyed */
 	void *arg;					/* Argument returned to owner in callbacks */
 	uint8_t flags;
-	int refs;					/* Integer to trap we never go negative */
+	atomic_t refs;					/* Integer to trap we never go negative */
+	struct rcu_head rcu;				/* Defers freeing until lockless lookups are done with the instance */
 	ecm_db_node_hash_t hash_index;
 #if (DEBUG_LEVEL > 0)
 	uint16_t magic;
@@ -399,7 +404,8 @@ struct ecm_db_host_instance {
 	ecm_db_host_final_callback_t final;		/* Callback to owner when object is destroyed */
 	void *arg;					/* Argument returned to owner in callbacks */
 	uint32_t flags;
-	int refs;					/* Integer to trap we never go negative */
+	atomic_t refs;					/* Integer to trap we never go negative */
+	struct rcu_head rcu;				/* Defers freeing until lockless lookups are done with the instance */
 	ecm_db_host_hash_t hash_index;
 #if (DEBUG_LEVEL > 0)
 	uint16_t magic;
@@ -483,7 +489,8 @@ struct ecm_db_mapping_instance {
 	ecm_db_mapping_final_callback_t final;				/* Callback to owner when object is destroyed */
 	void *arg;							/* Argument returned to owner in callbacks */
 	uint32_t flags;
-	int refs;							/* Integer to trap we never go negative */
+	atomic_t refs;							/* Integer to trap we never go negative */
+	struct rcu_head rcu;						/* Defers freeing until lockless lookups are done with the instance */
 	ecm_db_mapping_hash_t hash_index;
 #if (DEBUG_LEVEL > 0)
 	uint16_t magic;
@@ -499,11 +506,9 @@ struct ecm_db_mapping_instance {
  * struct ecm_db_timer_group
  *	A timer group - all group members within the same group have the same TTL reset value.
  *
- * Expiry of entries occurs from tail to head.
+ * The entries themselves are held in the timer wheel.
  */
 struct ecm_db_timer_group {
-	struct ecm_db_timer_group_entry *head;		/* Most recently used entry in this timer group */
-	struct ecm_db_timer_group_entry *tail;		/* Least recently used entry in this timer group. */
 	uint32_t time;					/* Time in seconds a group entry will be given to live when 'touched' */
 	ecm_db_timer_group_t tg;			/* RO: The group id */
 #if (DEBUG_LEVEL > 0)
@@ -519,6 +524,25 @@ static struct ecm_db_timer_group ecm_db_timer_groups[ECM_DB_TIMER_GROUPS_MAX];
 								/* Timer groups */
 static struct timer_list ecm_db_timer;				/* Timer to drive timer groups */
 
+/*
+ * Timer wheel
+ *	Timer group entries are held in a hierarchical timing wheel of one second ticks.
+ *
+ * Level 0 has a slot per second for the next ECM_DB_TIMER_WHEEL_SLOTS seconds, each level above
+ * that covers ECM_DB_TIMER_WHEEL_SLOTS times the span of the level below.  When the wheel reaches
+ * the start of a slot in a higher level that slot is cascaded, i.e. its entries are re-bucketed
+ * into the lower levels.  Touching an entry only records the time of the touch; an entry whose
+ * expiry has moved on is re-bucketed when the wheel reaches the slot it is in.
+ */
+#define ECM_DB_TIMER_WHEEL_LEVELS 3
+#define ECM_DB_TIMER_WHEEL_BITS 6
+#define ECM_DB_TIMER_WHEEL_SLOTS (1 << ECM_DB_TIMER_WHEEL_BITS)
+#define ECM_DB_TIMER_WHEEL_MASK (ECM_DB_TIMER_WHEEL_SLOTS - 1)
+#define ECM_DB_TIMER_WHEEL_EXPIRE_BUDGET 1024		/* Most entries expired per tick, any more are left for the next one */
+
+static struct hlist_head ecm_db_timer_wheel[ECM_DB_TIMER_WHEEL_LEVELS][ECM_DB_TIMER_WHEEL_SLOTS];
+								/* Timer wheel slots */
+
 #ifdef ECM_DB_CTA_TRACK_ENABLE
 /*
  * Classifier TYPE assignment lists.
@@ -771,7 +795,8 @@ struct ecm_db_connection_instance {
 
 	uint32_t serial;					/* RO: Serial number for the connection - unique for run lifetime */
 	uint32_t flags;
-	int refs;						/* Integer to trap we never go negative */
+	atomic_t refs;						/* Integer to trap we never go negative */
+	struct rcu_head rcu;					/* Defers freeing until lockless lookups are done with the instance */
 #if (DEBUG_LEVEL > 0)
 	uint16_t magic;
 #endif
@@ -860,6 +885,105 @@ static int ecm_db_connection_count_by_protocol[ECM_DB_PROTOCOL_COUNT];	/* Each I
  */
 static DEFINE_SPINLOCK(ecm_db_lock);					/* Protect the table from SMP access. */
 
+/*
+ * struct ecm_db_lock_stats
+ *	Per-CPU statistics for the database lock and the lookups that avoid it.
+ */
+struct ecm_db_lock_stats {
+	uint64_t acquisitions;			/* Number of times ecm_db_lock has been taken */
+	uint64_t contentions;			/* Number of times ecm_db_lock was held by another CPU when we wanted it */
+	uint64_t wait_ns;			/* Total time spent waiting for ecm_db_lock when contended */
+	uint64_t wait_max_ns;			/* Longest time spent waiting for ecm_db_lock */
+	uint64_t lockless_lookups;		/* Hash table lookups made without taking ecm_db_lock */
+	uint64_t lockless_ref_misses;		/* Lockless lookups that matched an instance already being destroyed */
+};
+
+static DEFINE_PER_CPU(struct ecm_db_lock_stats, ecm_db_lock_stats);
+
+/*
+ * ecm_db_lock_bh()
+ *	Take the database lock, recording any contention in the lock statistics.
+ */
+static inline void ecm_db_lock_bh(void)
+{
+	struct ecm_db_lock_stats *stats;
+	uint64_t start;
+	uint64_t waited;
+
+	if (likely(spin_trylock_bh(&ecm_db_lock))) {
+		__this_cpu_inc(ecm_db_lock_stats.acquisitions);
+		return;
+	}
+
+	start = sched_clock();
+	spin_lock_bh(&ecm_db_lock);
+	waited = sched_clock() - start;
+
+	stats = this_cpu_ptr(&ecm_db_lock_stats);
+	stats->acquisitions++;
+	stats->contentions++;
+	stats->wait_ns += waited;
+	if (waited > stats->wait_max_ns) {
+		stats->wait_max_ns = waited;
+	}
+}
+
+/*
+ * ecm_db_unlock_bh()
+ *	Release the database lock.
+ */
+static inline void ecm_db_unlock_bh(void)
+{
+	spin_unlock_bh(&ecm_db_lock);
+}
+
+/*
+ * ecm_db_refs_get_unless_zero()
+ *	Take a reference to an instance found by a lockless lookup.
+ *
+ * An instance whose last reference has gone is being removed from the database and must not be returned.
+ * Returns false in that case.
+ */
+static inline bool ecm_db_refs_get_unless_zero(atomic_t *refs)
+{
+	if (likely(atomic_inc_not_zero(refs))) {
+		return true;
+	}
+
+	this_cpu_inc(ecm_db_lock_stats.lockless_ref_misses);
+	return false;
+}
+
+/*
+ * ecm_db_refs_put_and_lock()
+ *	Release a reference to an instance.
+ *
+ * Only the release of the last reference takes the database lock.  Returns true, with the lock held, if that
+ * was the last reference, the caller then removes the instance from the database before releasing the lock.
+ * Otherwise returns false and sets *remaining to the number of references left.
+ */
+static bool ecm_db_refs_put_and_lock(atomic_t *refs, int *remaining)
+{
+	int old = atomic_read(refs);
+
+	while (old > 1) {
+		int prev = atomic_cmpxchg(refs, old, old - 1);
+		if (prev == old) {
+			*remaining = old - 1;
+			return false;
+		}
+		old = prev;
+	}
+
+	ecm_db_lock_bh();
+	*remaining = atomic_dec_return(refs);
+	if (*remaining == 0) {
+		return true;
+	}
+	ecm_db_unlock_bh();
+	return false;
+}
+
 /*
  * Connection state validity
  * This counter is incremented whenever a general change is detected which requires re-generation of state for ALL connections.
@@ -918,9 +1042,9 @@ int ecm_db_connection_count_get(void)
 {
 	int count;
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	count = ecm_db_connection_count;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return count;
 }
 EXPORT_SYMBOL(ecm_db_connection_count_get);
@@ -945,9 +1069,9 @@ int ecm_db_connection_count_by_protocol_get(int protocol)
 	int count;
 
 	DEBUG_ASSERT((protocol >= 0) && (protocol < ECM_DB_PROTOCOL_COUNT), "Bad protocol: %d\n", protocol);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	count = ecm_db_connection_count_by_protocol[protocol];
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return count;
 }
 EXPORT_SYMBOL(ecm_db_connection_count_by_protocol_get);
@@ -1007,10 +1131,10 @@ int32_t ecm_db_iface_mtu_reset(struct ecm_db_iface_instance *ii, int32_t mtu)
 {
 	int32_t mtu_old;
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed", ii);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	mtu_old = ii->mtu;
 	ii->mtu = mtu;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	DEBUG_INFO("%p: Mtu change from %d to %d\n", ii, mtu_old, mtu);
 
 	return mtu_old;
@@ -1078,9 +1202,9 @@ ecm_db_timer_group_t ecm_db_connection_timer_group_get(struct ecm_db_connection_
 	ecm_db_timer_group_t tg;
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	tg = ci->defunct_timer.group;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return tg;
 }
 EXPORT_SYMBOL(ecm_db_connection_timer_group_get);
@@ -1113,7 +1237,7 @@ void ecm_db_connection_data_totals_update(struct ecm_db_connection_instance *ci,
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 
 	if (is_from) {
 		/*
@@ -1155,7 +1279,7 @@ void ecm_db_connection_data_totals_update(struct ecm_db_connection_instance *ci,
 			ci->to_interfaces[i]->from_packet_total += packets;
 		}
 #endif
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		return;
 	}
 
@@ -1198,7 +1322,7 @@ void ecm_db_connection_data_totals_update(struct ecm_db_connection_instance *ci,
 		ci->from_interfaces[i]->from_packet_total += packets;
 	}
 #endif
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_connection_data_totals_update);
 
@@ -1215,7 +1339,7 @@ void ecm_db_multicast_connection_data_totals_update(struct ecm_db_connection_ins
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 
 	if (is_from) {
 		/*
@@ -1249,7 +1373,7 @@ void ecm_db_multicast_connection_data_totals_update(struct ecm_db_connection_ins
 		ci->mapping_to->host->to_packet_total += packets;
 		ci->to_node->to_packet_total += packets;
 #endif
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		return;
 	}
 
@@ -1284,7 +1408,7 @@ void ecm_db_multicast_connection_data_totals_update(struct ecm_db_connection_ins
 		ci->from_interfaces[i]->from_packet_total += packets;
 	}
 #endif
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_multicast_connection_data_totals_update);
 
@@ -1308,7 +1432,7 @@ void ecm_db_multicast_connection_interface_heirarchy_stats_update(struct ecm_db_
 		return;
 	}
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	for (heirarchy_index = 0; heirarchy_index < ECM_DB_MULTICAST_IF_MAX; heirarchy_index++) {
 
 		if (to_mc_ifaces_first[heirarchy_index] < ECM_DB_IFACE_HEIRARCHY_MAX) {
@@ -1320,7 +1444,7 @@ void ecm_db_multicast_connection_interface_heirarchy_stats_update(struct ecm_db_
 			ii->to_packet_total += packets;
 		}
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	ecm_db_multicast_connection_to_interfaces_deref_all(to_mc_ifaces, to_mc_ifaces_first);
 }
@@ -1341,7 +1465,7 @@ void ecm_db_connection_data_totals_update_dropped(struct ecm_db_connection_insta
 		/*
 		 * Update dropped totals sent by the FROM side
 		 */
-		spin_lock_bh(&ecm_db_lock);
+		ecm_db_lock_bh();
 		ci->from_data_total_dropped += size;
 		ci->from_packet_total_dropped += packets;
 #ifdef ECM_DB_ADVANCED_STATS_ENABLE
@@ -1360,14 +1484,14 @@ void ecm_db_connection_data_totals_update_dropped(struct ecm_db_connection_insta
 			ci->from_interfaces[i]->to_packet_total_dropped += packets;
 		}
 #endif
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		return;
 	}
 
 	/*
 	 * Update dropped totals sent by the TO side of this connection
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ci->to_data_total_dropped += size;
 	ci->to_packet_total_dropped += packets;
 #ifdef ECM_DB_ADVANCED_STATS_ENABLE
@@ -1386,7 +1510,7 @@ void ecm_db_connection_data_totals_update_dropped(struct ecm_db_connection_insta
 		ci->to_interfaces[i]->to_packet_total_dropped += packets;
 	}
 #endif
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_connection_data_totals_update_dropped);
 
@@ -1401,7 +1525,7 @@ void ecm_db_connection_data_stats_get(struct ecm_db_connection_instance *ci, uin
 {
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	if (from_data_total) {
 		*from_data_total = ci->from_data_total;
 	}
@@ -1426,7 +1550,7 @@ void ecm_db_connection_data_stats_get(struct ecm_db_connection_instance *ci, uin
 	if (to_packet_total_dropped) {
 		*to_packet_total_dropped = ci->to_packet_total_dropped;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_connection_data_stats_get);
 
@@ -1441,7 +1565,7 @@ void ecm_db_mapping_data_stats_get(struct ecm_db_mapping_instance *mi, uint64_t
 						uint64_t *from_packet_total_dropped, uint64_t *to_packet_total_dropped)
 {
 	DEBUG_CHECK_MAGIC(mi, ECM_DB_MAPPING_INSTANCE_MAGIC, "%p: magic failed", mi);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	if (from_data_total) {
 		*from_data_total = mi->from_data_total;
 	}
@@ -1466,7 +1590,7 @@ void ecm_db_mapping_data_stats_get(struct ecm_db_mapping_instance *mi, uint64_t
 	if (to_packet_total_dropped) {
 		*to_packet_total_dropped = mi->to_packet_total_dropped;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_mapping_data_stats_get);
 #endif
@@ -1482,7 +1606,7 @@ void ecm_db_host_data_stats_get(struct ecm_db_host_instance *hi, uint64_t *from_
 						uint64_t *from_packet_total_dropped, uint64_t *to_packet_total_dropped)
 {
 	DEBUG_CHECK_MAGIC(hi, ECM_DB_HOST_INSTANCE_MAGIC, "%p: magic failed", hi);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	if (from_data_total) {
 		*from_data_total = hi->from_data_total;
 	}
@@ -1507,7 +1631,7 @@ void ecm_db_host_data_stats_get(struct ecm_db_host_instance *hi, uint64_t *from_
 	if (to_packet_total_dropped) {
 		*to_packet_total_dropped = hi->to_packet_total_dropped;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_host_data_stats_get);
 #endif
@@ -1523,7 +1647,7 @@ void ecm_db_node_data_stats_get(struct ecm_db_node_instance *ni, uint64_t *from_
 						uint64_t *from_packet_total_dropped, uint64_t *to_packet_total_dropped)
 {
 	DEBUG_CHECK_MAGIC(ni, ECM_DB_NODE_INSTANCE_MAGIC, "%p: magic failed", ni);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	if (from_data_total) {
 		*from_data_total = ni->from_data_total;
 	}
@@ -1548,7 +1672,7 @@ void ecm_db_node_data_stats_get(struct ecm_db_node_instance *ni, uint64_t *from_
 	if (to_packet_total_dropped) {
 		*to_packet_total_dropped = ni->to_packet_total_dropped;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_node_data_stats_get);
 #endif
@@ -1564,7 +1688,7 @@ void ecm_db_iface_data_stats_get(struct ecm_db_iface_instance *ii, uint64_t *fro
 						uint64_t *from_packet_total_dropped, uint64_t *to_packet_total_dropped)
 {
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed", ii);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	if (from_data_total) {
 		*from_data_total = ii->from_data_total;
 	}
@@ -1589,7 +1713,7 @@ void ecm_db_iface_data_stats_get(struct ecm_db_iface_instance *ii, uint64_t *fro
 	if (to_packet_total_dropped) {
 		*to_packet_total_dropped = ii->to_packet_total_dropped;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_iface_data_stats_get);
 #endif
@@ -1779,9 +1903,9 @@ int ecm_db_connection_to_iface_mtu_get(struct ecm_db_connection_instance *ci)
 {
 	int mtu;
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed", ci);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	mtu = ci->to_node->iface->mtu;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return mtu;
 }
 EXPORT_SYMBOL(ecm_db_connection_to_iface_mtu_get);
@@ -1795,9 +1919,9 @@ ecm_db_iface_type_t ecm_db_connection_to_iface_type_get(struct ecm_db_connection
 	ecm_db_iface_type_t type;
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed", ci);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	type = ci->to_node->iface->type;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return type;
 }
 EXPORT_SYMBOL(ecm_db_connection_to_iface_type_get);
@@ -1810,9 +1934,9 @@ int ecm_db_connection_from_iface_mtu_get(struct ecm_db_connection_instance *ci)
 {
 	int mtu;
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed", ci);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	mtu = ci->from_node->iface->mtu;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return mtu;
 }
 EXPORT_SYMBOL(ecm_db_connection_from_iface_mtu_get);
@@ -1826,9 +1950,9 @@ ecm_db_iface_type_t ecm_db_connection_from_iface_type_get(struct ecm_db_connecti
 	ecm_db_iface_type_t type;
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed", ci);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	type = ci->from_node->iface->type;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return type;
 }
 EXPORT_SYMBOL(ecm_db_connection_from_iface_type_get);
@@ -1853,9 +1977,9 @@ uint16_t ecm_db_connection_regeneration_occurrances_get(struct ecm_db_connection
 	uint16_t occurances;
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	occurances = ci->regen_occurances;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return occurances;
 }
 EXPORT_SYMBOL(ecm_db_connection_regeneration_occurrances_get);
@@ -1868,7 +1992,7 @@ void ecm_db_conection_regeneration_completed(struct ecm_db_connection_instance *
 {
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 
 	DEBUG_ASSERT(ci->regen_in_progress, "%p: Bad call", ci);
 	DEBUG_ASSERT(ci->regen_required > 0, "%p: Bad call", ci);
@@ -1880,7 +2004,7 @@ void ecm_db_conection_regeneration_completed(struct ecm_db_connection_instance *
 	ci->regen_required--;
 	ci->regen_in_progress = false;
 	ci->regen_success++;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_conection_regeneration_completed);
 
@@ -1892,7 +2016,7 @@ void ecm_db_conection_regeneration_failed(struct ecm_db_connection_instance *ci)
 {
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 
 	DEBUG_ASSERT(ci->regen_in_progress, "%p: Bad call", ci);
 	DEBUG_ASSERT(ci->regen_required > 0, "%p: Bad call", ci);
@@ -1903,7 +2027,7 @@ void ecm_db_conection_regeneration_failed(struct ecm_db_connection_instance *ci)
 	 */
 	ci->regen_in_progress = false;
 	ci->regen_fail++;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_conection_regeneration_failed);
 
@@ -1922,7 +2046,7 @@ bool ecm_db_connection_regeneration_required_check(struct ecm_db_connection_inst
 	/*
 	 * Check the global generation counter for changes
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	if (ci->generation != ecm_db_connection_generation) {
 		/*
 		 * Re-generation is needed
@@ -1941,7 +2065,7 @@ bool ecm_db_connection_regeneration_required_check(struct ecm_db_connection_inst
 	 * so we tell the caller that it cannot handle re-generation.
 	 */
 	if (ci->regen_in_progress) {
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		return false;
 	}
 
@@ -1949,7 +2073,7 @@ bool ecm_db_connection_regeneration_required_check(struct ecm_db_connection_inst
 	 * Is re-generation required?
 	 */
 	if (ci->regen_required == 0) {
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		return false;
 	}
 
@@ -1957,7 +2081,7 @@ bool ecm_db_connection_regeneration_required_check(struct ecm_db_connection_inst
 	 * Flag that re-generation is in progress and tell the caller to handle re-generation
 	 */
 	ci->regen_in_progress = true;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return true;
 }
 EXPORT_SYMBOL(ecm_db_connection_regeneration_required_check);
@@ -1973,7 +2097,7 @@ bool ecm_db_connection_regeneration_required_peek(struct ecm_db_connection_insta
 {
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 
 	/*
 	 * Check the global generation counter for changes (record any change now)
@@ -1991,10 +2115,10 @@ bool ecm_db_connection_regeneration_required_peek(struct ecm_db_connection_insta
 		ci->generation = ecm_db_connection_generation;
 	}
 	if (ci->regen_required == 0) {
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		return false;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return true;
 }
 EXPORT_SYMBOL(ecm_db_connection_regeneration_required_peek);
@@ -2010,10 +2134,10 @@ void ecm_db_connection_regeneration_needed(struct ecm_db_connection_instance *ci
 {
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ci->regen_occurances++;
 	ci->regen_required++;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_connection_regeneration_needed);
 
@@ -2023,9 +2147,9 @@ EXPORT_SYMBOL(ecm_db_connection_regeneration_needed);
  */
 void ecm_db_regeneration_needed(void)
 {
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ecm_db_connection_generation++;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_regeneration_needed);
 
@@ -2074,7 +2198,7 @@ void ecm_db_mapping_port_count_get(struct ecm_db_mapping_instance *mi,
 {
 	DEBUG_CHECK_MAGIC(mi, ECM_DB_MAPPING_INSTANCE_MAGIC, "%p: magic failed", mi);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 
 	*tcp_from = mi->tcp_from;
 	*tcp_to = mi->tcp_to;
@@ -2090,7 +2214,7 @@ void ecm_db_mapping_port_count_get(struct ecm_db_mapping_instance *mi,
 	*nat_from = mi->nat_from;
 	*nat_to = mi->nat_to;
 
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_mapping_port_count_get);
 
@@ -2182,14 +2306,58 @@ void ecm_db_node_adress_get(struct ecm_db_node_instance *ni, uint8_t *address_bu
 }
 EXPORT_SYMBOL(ecm_db_node_adress_get);
 
+/*
+ * _ecm_db_timer_group_entry_expires()
+ *	Return the time at which a running entry expires.
+ */
+static inline uint32_t _ecm_db_timer_group_entry_expires(struct ecm_db_timer_group_entry *tge)
+{
+	return READ_ONCE(tge->touched) + ecm_db_timer_groups[tge->group].time;
+}
+
+/*
+ * _ecm_db_timer_wheel_insert()
+ *	Insert the entry into the timer wheel slot that covers the given expiry time.
+ *
+ * An expiry time that has already passed is treated as now, such entries are only inserted while the
+ * wheel is being ticked and before the current level 0 slot is examined.
+ * An expiry time beyond the span of the wheel goes into the furthest slot of the top level and is
+ * re-bucketed when that slot is cascaded.
+ */
+static void _ecm_db_timer_wheel_insert(struct ecm_db_timer_group_entry *tge, uint32_t expires)
+{
+	uint32_t now = ecm_db_time;
+	unsigned int shift = 0;
+	unsigned int level;
+	uint32_t slot;
+
+	if ((int32_t)(expires - now) < 0) {
+		expires = now;
+	}
+
+	for (level = 0; level < ECM_DB_TIMER_WHEEL_LEVELS; ++level) {
+		shift = level * ECM_DB_TIMER_WHEEL_BITS;
+		if (((expires >> shift) - (now >> shift)) < ECM_DB_TIMER_WHEEL_SLOTS) {
+			break;
+		}
+	}
+
+	if (level == ECM_DB_TIMER_WHEEL_LEVELS) {
+		level--;
+		slot = (now >> shift) + ECM_DB_TIMER_WHEEL_SLOTS - 1;
+	} else {
+		slot = expires >> shift;
+	}
+
+	hlist_add_head(&tge->node, &ecm_db_timer_wheel[level][slot & ECM_DB_TIMER_WHEEL_MASK]);
+}
+
 /*
  * _ecm_db_timer_group_entry_remove()
  *	Remove the entry from its timer group, returns false if the entry has already expired.
  */
 static bool _ecm_db_timer_group_entry_remove(struct ecm_db_timer_group_entry *tge)
 {
-	struct ecm_db_timer_group *timer_group;
-
 	/*
 	 * If not in a timer group then it is already removed
 	 */
@@ -2198,37 +2366,14 @@ static bool _ecm_db_timer_group_entry_remove(struct ecm_db_timer_group_entry *tg
 	}
 
 	/*
-	 * Remove the connection from its current group
+	 * Remove the connection from the timer wheel
 	 */
-	timer_group = &ecm_db_timer_groups[tge->group];
-
-	/*
-	 * Somewhere in the list?
-	 */
-	if (tge->prev) {
-		tge->prev->next = tge->next;
-	} else {
-		/*
-		 * First in the group
-		 */
-		DEBUG_ASSERT(timer_group->head == tge, "%p: bad head, expecting %p, got %p\n", timer_group, tge, timer_group->head);
-		timer_group->head = tge->next;
-	}
-
-	if (tge->next) {
-		tge->next->prev = tge->prev;
-	} else {
-		/*
-		 * No next so this must be the last item - we need to adjust the tail pointer
-		 */
-		DEBUG_ASSERT(timer_group->tail == tge, "%p: bad tail, expecting %p got %p\n", timer_group, tge, timer_group->tail);
-		timer_group->tail = tge->prev;
-	}
+	hlist_del(&tge->node);
 
 	/*
 	 * No longer a part of a timer group
 	 */
-	tge->group = ECM_DB_TIMER_GROUPS_MAX;
+	WRITE_ONCE(tge->group, ECM_DB_TIMER_GROUPS_MAX);
 	return true;
 }
 
@@ -2239,9 +2384,9 @@ static bool _ecm_db_timer_group_entry_remove(struct ecm_db_timer_group_entry *tg
 bool ecm_db_timer_group_entry_remove(struct ecm_db_timer_group_entry *tge)
 {
 	bool res;
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	res = _ecm_db_timer_group_entry_remove(tge);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return res;
 }
 EXPORT_SYMBOL(ecm_db_timer_group_entry_remove);
@@ -2252,35 +2397,14 @@ EXPORT_SYMBOL(ecm_db_timer_group_entry_remove);
  */
 void _ecm_db_timer_group_entry_set(struct ecm_db_timer_group_entry *tge, ecm_db_timer_group_t tg)
 {
-	struct ecm_db_timer_group *timer_group;
-
 	DEBUG_ASSERT(tge->group == ECM_DB_TIMER_GROUPS_MAX, "%p: already set\n", tge);
 
 	/*
-	 * Set group
-	 */
-	tge->group = tg;
-	timer_group = &ecm_db_timer_groups[tge->group];
-	tge->timeout = timer_group->time + ecm_db_time;
-
-	/*
-	 * Insert into a timer group at the head (as this is now touched)
+	 * Set group, as this is now touched the entry expires a full group time from now
 	 */
-	tge->prev = NULL;
-	tge->next = timer_group->head;
-	if (!timer_group->head) {
-		/*
-		 * As there is no head there is also no tail so we need to set that
-		 */
-		timer_group->tail = tge;
-	} else {
-		/*
-		 * As there is a head already there must be a tail.  Since we insert before
-		 * the current head we don't adjust the tail.
-		 */
-		timer_group->head->prev = tge;
-	}
-	timer_group->head = tge;
+	WRITE_ONCE(tge->touched, ecm_db_time);
+	WRITE_ONCE(tge->group, tg);
+	_ecm_db_timer_wheel_insert(tge, _ecm_db_timer_group_entry_expires(tge));
 }
 
 /*
@@ -2291,13 +2415,13 @@ void _ecm_db_timer_group_entry_set(struct ecm_db_timer_group_entry *tge, ecm_db_
  */
 bool ecm_db_timer_group_entry_reset(struct ecm_db_timer_group_entry *tge, ecm_db_timer_group_t tg)
 {
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 
 	/*
 	 * Remove it from its current group, if any
 	 */
 	if (!_ecm_db_timer_group_entry_remove(tge)) {
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		return false;
 	}
 
@@ -2305,7 +2429,7 @@ bool ecm_db_timer_group_entry_reset(struct ecm_db_timer_group_entry *tge, ecm_db
 	 * Set new group
 	 */
 	_ecm_db_timer_group_entry_set(tge, tg);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return true;
 }
 EXPORT_SYMBOL(ecm_db_timer_group_entry_reset);
@@ -2316,9 +2440,9 @@ EXPORT_SYMBOL(ecm_db_timer_group_entry_reset);
  */
 void ecm_db_timer_group_entry_set(struct ecm_db_timer_group_entry *tge, ecm_db_timer_group_t tg)
 {
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	_ecm_db_timer_group_entry_set(tge, tg);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_timer_group_entry_set);
 
@@ -2329,6 +2453,7 @@ EXPORT_SYMBOL(ecm_db_timer_group_entry_set);
 void ecm_db_timer_group_entry_init(struct ecm_db_timer_group_entry *tge, ecm_db_timer_group_entry_callback_t fn, void *arg)
 {
 	memset(tge, 0, sizeof(struct ecm_db_timer_group_entry));
+	INIT_HLIST_NODE(&tge->node);
 	tge->group = ECM_DB_TIMER_GROUPS_MAX;
 	tge->arg = arg;
 	tge->fn = fn;
@@ -2339,67 +2464,25 @@ EXPORT_SYMBOL(ecm_db_timer_group_entry_init);
  * ecm_db_timer_group_entry_touch()
  *	Update the timeout, if the timer is not running this has no effect.
  * It returns false if the timer is not running.
+ *
+ * This is called for every packet seen on the slow path so it does not take the lock, it only records
+ * the time of the touch.  The timer wheel moves the entry on when it next examines it.
+ * A touch racing with the expiry of the entry may return true for an entry that has just expired,
+ * which is no different from the touch having happened a moment earlier.
  */
 bool ecm_db_timer_group_entry_touch(struct ecm_db_timer_group_entry *tge)
 {
-	struct ecm_db_timer_group *timer_group;
-
-	spin_lock_bh(&ecm_db_lock);
-
 	/*
 	 * If not in a timer group then do nothing
 	 */
-	if (tge->group == ECM_DB_TIMER_GROUPS_MAX) {
-		spin_unlock_bh(&ecm_db_lock);
+	if (READ_ONCE(tge->group) == ECM_DB_TIMER_GROUPS_MAX) {
 		return false;
 	}
 
 	/*
 	 * Update time to live
 	 */
-	timer_group = &ecm_db_timer_groups[tge->group];
-
-	/*
-	 * Link out of its current position.
-	 */
-	if (!tge->prev) {
-		/*
-		 * Already at the head, just update the time
-		 */
-		tge->timeout = timer_group->time + ecm_db_time;
-		spin_unlock_bh(&ecm_db_lock);
-		return true;
-	}
-
-	/*
-	 * tge->prev is not null, so:
-	 * 1) it is in a timer list
-	 * 2) is not at the head of the list
-	 * 3) there is a head already (so more than one item on the list)
-	 * 4) there is a prev pointer.
-	 * Somewhere in the group list - unlink it.
-	 */
-	tge->prev->next = tge->next;
-
-	if (tge->next) {
-		tge->next->prev = tge->prev;
-	} else {
-		/*
-		 * Since there is no next this must be the tail
-		 */
-		DEBUG_ASSERT(timer_group->tail == tge, "%p: bad tail, expecting %p got %p\n", timer_group, tge, timer_group->tail);
-		timer_group->tail = tge->prev;
-	}
-
-	/*
-	 * Link in to head.
-	 */
-	tge->timeout = timer_group->time + ecm_db_time;
-	tge->prev = NULL;
-	tge->next = timer_group->head;
-	timer_group->head->prev = tge;
-	timer_group->head = tge;
-	spin_unlock_bh(&ecm_db_lock);
+	WRITE_ONCE(tge->touched, READ_ONCE(ecm_db_time));
 	return true;
 }
 EXPORT_SYMBOL(ecm_db_timer_group_entry_touch);
@@ -2410,9 +2493,9 @@ EXPORT_SYMBOL(ecm_db_timer_group_entry_touch);
 static void _ecm_db_connection_ref(struct ecm_db_connection_instance *ci)
 {
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed", ci);
-	ci->refs++;
-	DEBUG_TRACE("%p: connection ref %d\n", ci, ci->refs);
-	DEBUG_ASSERT(ci->refs > 0, "%p: ref wrap\n", ci);
+	atomic_inc(&ci->refs);
+	DEBUG_TRACE("%p: connection ref %d\n", ci, atomic_read(&ci->refs));
+	DEBUG_ASSERT(atomic_read(&ci->refs) > 0, "%p: ref wrap\n", ci);
 }
 
 /*
@@ -2420,9 +2503,7 @@ static void _ecm_db_connection_ref(struct ecm_db_connection_instance *ci)
  */
 void ecm_db_connection_ref(struct ecm_db_connection_instance *ci)
 {
-	spin_lock_bh(&ecm_db_lock);
 	_ecm_db_connection_ref(ci);
-	spin_unlock_bh(&ecm_db_lock);
 }
 EXPORT_SYMBOL(ecm_db_connection_ref);
 
@@ -2432,9 +2513,9 @@ EXPORT_SYMBOL(ecm_db_connection_ref);
 static void _ecm_db_mapping_ref(struct ecm_db_mapping_instance *mi)
 {
 	DEBUG_CHECK_MAGIC(mi, ECM_DB_MAPPING_INSTANCE_MAGIC, "%p: magic failed\n", mi);
-	mi->refs++;
-	DEBUG_TRACE("%p: mapping ref %d\n", mi, mi->refs);
-	DEBUG_ASSERT(mi->refs > 0, "%p: ref wrap\n", mi);
+	atomic_inc(&mi->refs);
+	DEBUG_TRACE("%p: mapping ref %d\n", mi, atomic_read(&mi->refs));
+	DEBUG_ASSERT(atomic_read(&mi->refs) > 0, "%p: ref wrap\n", mi);
 }
 
 /*
@@ -2442,9 +2523,7 @@ static void _ecm_db_mapping_ref(struct ecm_db_mapping_instance *mi)
  */
 void ecm_db_mapping_ref(struct ecm_db_mapping_instance *mi)
 {
-	spin_lock_bh(&ecm_db_lock);
 	_ecm_db_mapping_ref(mi);
-	spin_unlock_bh(&ecm_db_lock);
 }
 EXPORT_SYMBOL(ecm_db_mapping_ref);
 
@@ -2454,9 +2533,9 @@ EXPORT_SYMBOL(ecm_db_mapping_ref);
 static void _ecm_db_host_ref(struct ecm_db_host_instance *hi)
 {
 	DEBUG_CHECK_MAGIC(hi, ECM_DB_HOST_INSTANCE_MAGIC, "%p: magic failed\n", hi);
-	hi->refs++;
-	DEBUG_TRACE("%p: host ref %d\n", hi, hi->refs);
-	DEBUG_ASSERT(hi->refs > 0, "%p: ref wrap\n", hi);
+	atomic_inc(&hi->refs);
+	DEBUG_TRACE("%p: host ref %d\n", hi, atomic_read(&hi->refs));
+	DEBUG_ASSERT(atomic_read(&hi->refs) > 0, "%p: ref wrap\n", hi);
 }
 
 /*
@@ -2464,9 +2543,7 @@ static void _ecm_db_host_ref(struct ecm_db_host_instance *hi)
  */
 void ecm_db_host_ref(struct ecm_db_host_instance *hi)
 {
-	spin_lock_bh(&ecm_db_lock);
 	_ecm_db_host_ref(hi);
-	spin_unlock_bh(&ecm_db_lock);
 }
 EXPORT_SYMBOL(ecm_db_host_ref);
 
@@ -2476,9 +2553,9 @@ EXPORT_SYMBOL(ecm_db_host_ref);
 static void _ecm_db_node_ref(struct ecm_db_node_instance *ni)
 {
 	DEBUG_CHECK_MAGIC(ni, ECM_DB_NODE_INSTANCE_MAGIC, "%p: magic failed\n", ni);
-	ni->refs++;
-	DEBUG_TRACE("%p: node ref %d\n", ni, ni->refs);
-	DEBUG_ASSERT(ni->refs > 0, "%p: ref wrap\n", ni);
+	atomic_inc(&ni->refs);
+	DEBUG_TRACE("%p: node ref %d\n", ni, atomic_read(&ni->refs));
+	DEBUG_ASSERT(atomic_read(&ni->refs) > 0, "%p: ref wrap\n", ni);
 }
 
 /*
@@ -2486,9 +2563,7 @@ static void _ecm_db_node_ref(struct ecm_db_node_instance *ni)
  */
 void ecm_db_node_ref(struct ecm_db_node_instance *ni)
 {
-	spin_lock_bh(&ecm_db_lock);
 	_ecm_db_node_ref(ni);
-	spin_unlock_bh(&ecm_db_lock);
 }
 EXPORT_SYMBOL(ecm_db_node_ref);
 
@@ -2508,9 +2583,9 @@ static void _ecm_db_iface_ref(struct ecm_db_iface_instance *ii)
  */
 void ecm_db_iface_ref(struct ecm_db_iface_instance *ii)
 {
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	_ecm_db_iface_ref(ii);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_iface_ref);
 
@@ -2529,9 +2604,9 @@ static void _ecm_db_listener_ref(struct ecm_db_listener_instance *li)
  */
 void ecm_db_listener_ref(struct ecm_db_listener_instance *li)
 {
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	_ecm_db_listener_ref(li);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_listener_ref);
 
@@ -2542,12 +2617,12 @@ EXPORT_SYMBOL(ecm_db_listener_ref);
 struct ecm_db_connection_instance *ecm_db_connections_get_and_ref_first(void)
 {
 	struct ecm_db_connection_instance *ci;
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ci = ecm_db_connections;
 	if (ci) {
 		_ecm_db_connection_ref(ci);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return ci;
 }
 EXPORT_SYMBOL(ecm_db_connections_get_and_ref_first);
@@ -2560,12 +2635,12 @@ struct ecm_db_connection_instance *ecm_db_connection_get_and_ref_next(struct ecm
 {
 	struct ecm_db_connection_instance *cin;
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed", ci);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	cin = ci->next;
 	if (cin) {
 		_ecm_db_connection_ref(cin);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return cin;
 }
 EXPORT_SYMBOL(ecm_db_connection_get_and_ref_next);
@@ -2577,12 +2652,12 @@ EXPORT_SYMBOL(ecm_db_connection_get_and_ref_next);
 struct ecm_db_mapping_instance *ecm_db_mappings_get_and_ref_first(void)
 {
 	struct ecm_db_mapping_instance *mi;
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	mi = ecm_db_mappings;
 	if (mi) {
 		_ecm_db_mapping_ref(mi);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return mi;
 }
 EXPORT_SYMBOL(ecm_db_mappings_get_and_ref_first);
@@ -2595,12 +2670,12 @@ struct ecm_db_mapping_instance *ecm_db_mapping_get_and_ref_next(struct ecm_db_ma
 {
 	struct ecm_db_mapping_instance *min;
 	DEBUG_CHECK_MAGIC(mi, ECM_DB_MAPPING_INSTANCE_MAGIC, "%p: magic failed", mi);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	min = mi->next;
 	if (min) {
 		_ecm_db_mapping_ref(min);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return min;
 }
 EXPORT_SYMBOL(ecm_db_mapping_get_and_ref_next);
@@ -2612,12 +2687,12 @@ EXPORT_SYMBOL(ecm_db_mapping_get_and_ref_next);
 struct ecm_db_host_instance *ecm_db_hosts_get_and_ref_first(void)
 {
 	struct ecm_db_host_instance *hi;
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	hi = ecm_db_hosts;
 	if (hi) {
 		_ecm_db_host_ref(hi);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return hi;
 }
 EXPORT_SYMBOL(ecm_db_hosts_get_and_ref_first);
@@ -2630,12 +2705,12 @@ struct ecm_db_host_instance *ecm_db_host_get_and_ref_next(struct ecm_db_host_ins
 {
 	struct ecm_db_host_instance *hin;
 	DEBUG_CHECK_MAGIC(hi, ECM_DB_HOST_INSTANCE_MAGIC, "%p: magic failed", hi);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	hin = hi->next;
 	if (hin) {
 		_ecm_db_host_ref(hin);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return hin;
 }
 EXPORT_SYMBOL(ecm_db_host_get_and_ref_next);
@@ -2647,12 +2722,12 @@ EXPORT_SYMBOL(ecm_db_host_get_and_ref_next);
 static struct ecm_db_listener_instance *ecm_db_listeners_get_and_ref_first(void)
 {
 	struct ecm_db_listener_instance *li;
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	li = ecm_db_listeners;
 	if (li) {
 		_ecm_db_listener_ref(li);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return li;
 }
 
@@ -2664,12 +2739,12 @@ static struct ecm_db_listener_instance *ecm_db_listener_get_and_ref_next(struct
 {
 	struct ecm_db_listener_instance *lin;
 	DEBUG_CHECK_MAGIC(li, ECM_DB_LISTENER_INSTANCE_MAGIC, "%p: magic failed", li);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	lin = li->next;
 	if (lin) {
 		_ecm_db_listener_ref(lin);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return lin;
 }
 
@@ -2680,12 +2755,12 @@ static struct ecm_db_listener_instance *ecm_db_listener_get_and_ref_next(struct
 struct ecm_db_node_instance *ecm_db_nodes_get_and_ref_first(void)
 {
 	struct ecm_db_node_instance *ni;
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ni = ecm_db_nodes;
 	if (ni) {
 		_ecm_db_node_ref(ni);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return ni;
 }
 EXPORT_SYMBOL(ecm_db_nodes_get_and_ref_first);
@@ -2698,12 +2773,12 @@ struct ecm_db_node_instance *ecm_db_node_get_and_ref_next(struct ecm_db_node_ins
 {
 	struct ecm_db_node_instance *nin;
 	DEBUG_CHECK_MAGIC(ni, ECM_DB_NODE_INSTANCE_MAGIC, "%p: magic failed", ni);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	nin = ni->next;
 	if (nin) {
 		_ecm_db_node_ref(nin);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return nin;
 }
 EXPORT_SYMBOL(ecm_db_node_get_and_ref_next);
@@ -2715,12 +2790,12 @@ EXPORT_SYMBOL(ecm_db_node_get_and_ref_next);
 struct ecm_db_iface_instance *ecm_db_interfaces_get_and_ref_first(void)
 {
 	struct ecm_db_iface_instance *ii;
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii = ecm_db_interfaces;
 	if (ii) {
 		_ecm_db_iface_ref(ii);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return ii;
 }
 EXPORT_SYMBOL(ecm_db_interfaces_get_and_ref_first);
@@ -2733,12 +2808,12 @@ struct ecm_db_iface_instance *ecm_db_interface_get_and_ref_next(struct ecm_db_if
 {
 	struct ecm_db_iface_instance *iin;
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed", ii);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	iin = ii->next;
 	if (iin) {
 		_ecm_db_iface_ref(iin);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return iin;
 }
 EXPORT_SYMBOL(ecm_db_interface_get_and_ref_next);
@@ -2895,19 +2970,16 @@ int ecm_db_connection_deref(struct ecm_db_connection_instance *ci)
 	ecm_classifier_type_t ca_type;
 #endif
 	int32_t i;
+	int refs;
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed", ci);
 
-	spin_lock_bh(&ecm_db_lock);
-	ci->refs--;
-	DEBUG_TRACE("%p: connection deref %d\n", ci, ci->refs);
-	DEBUG_ASSERT(ci->refs >= 0, "%p: ref wrap\n", ci);
-
-	if (ci->refs > 0) {
-		int refs = ci->refs;
-		spin_unlock_bh(&ecm_db_lock);
+	if (!ecm_db_refs_put_and_lock(&ci->refs, &refs)) {
+		DEBUG_TRACE("%p: connection deref %d\n", ci, refs);
+		DEBUG_ASSERT(refs >= 0, "%p: ref wrap\n", ci);
 		return refs;
 	}
+	DEBUG_TRACE("%p: connection deref 0\n", ci);
 
 #ifdef ECM_MULTICAST_ENABLE
 	/*
@@ -2922,7 +2994,7 @@ int ecm_db_connection_deref(struct ecm_db_connection_instance *ci)
 	 * Remove from database if inserted
 	 */
 	if (!ci->flags & ECM_DB_CONNECTION_FLAGS_INSERTED) {
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 	} else {
 		struct ecm_db_listener_instance *li;
 #ifdef ECM_DB_XREF_ENABLE
@@ -3180,7 +3252,7 @@ int ecm_db_connection_deref(struct ecm_db_connection_instance *ci)
 		ecm_db_connection_count_by_protocol[ci->protocol]--;
 		DEBUG_ASSERT(ecm_db_connection_count_by_protocol[ci->protocol] >= 0, "%p: Invalid protocol count %d\n", ci, ecm_db_connection_count_by_protocol[ci->protocol]);
 
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 
 		/*
 		 * Throw removed event to listeners
@@ -3216,7 +3288,7 @@ int ecm_db_connection_deref(struct ecm_db_connection_instance *ci)
 	 * Default classifier is not in the classifier type assignement list, so we should start the loop index
 	 * with the first assigned classifier type.
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	for (ca_type = ECM_CLASSIFIER_TYPE_DEFAULT + 1; ca_type < ECM_CLASSIFIER_TYPES; ++ca_type) {
 		struct ecm_classifier_instance *cci = ci->assignments_by_type[ca_type];
 		if (!cci) {
@@ -3227,7 +3299,7 @@ int ecm_db_connection_deref(struct ecm_db_connection_instance *ci)
 		}
 		_ecm_db_connection_classifier_unassign(ci, cci, ca_type);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 #endif
 
 	/*
@@ -3298,15 +3370,15 @@ int ecm_db_connection_deref(struct ecm_db_connection_instance *ci)
 	 * We can now destroy the instance
 	 */
 	DEBUG_CLEAR_MAGIC(ci);
-	kfree(ci);
+	kfree_rcu(ci, rcu);
 
 	/*
 	 * Decrease global connection count
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ecm_db_connection_count--;
 	DEBUG_ASSERT(ecm_db_connection_count >= 0, "%p: connection count wrap\n", ci);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	return 0;
 }
@@ -3318,18 +3390,16 @@ EXPORT_SYMBOL(ecm_db_connection_deref);
  */
 int ecm_db_mapping_deref(struct ecm_db_mapping_instance *mi)
 {
-	DEBUG_CHECK_MAGIC(mi, ECM_DB_MAPPING_INSTANCE_MAGIC, "%p: magic failed\n", mi);
+	int refs;
 
-	spin_lock_bh(&ecm_db_lock);
-	mi->refs--;
-	DEBUG_TRACE("%p: mapping deref %d\n", mi, mi->refs);
-	DEBUG_ASSERT(mi->refs >= 0, "%p: ref wrap\n", mi);
+	DEBUG_CHECK_MAGIC(mi, ECM_DB_MAPPING_INSTANCE_MAGIC, "%p: magic failed\n", mi);
 
-	if (mi->refs > 0) {
-		int refs = mi->refs;
-		spin_unlock_bh(&ecm_db_lock);
+	if (!ecm_db_refs_put_and_lock(&mi->refs, &refs)) {
+		DEBUG_TRACE("%p: mapping deref %d\n", mi, refs);
+		DEBUG_ASSERT(refs >= 0, "%p: ref wrap\n", mi);
 		return refs;
 	}
+	DEBUG_TRACE("%p: mapping deref 0\n", mi);
 
 	DEBUG_ASSERT(!mi->tcp_from && !mi->udp_from && !mi->from, "%p: from not zero: %d, %d, %d\n",
 			mi, mi->tcp_from, mi->udp_from, mi->from);
@@ -3351,7 +3421,7 @@ int ecm_db_mapping_deref(struct ecm_db_mapping_instance *mi)
 	 * Remove from database if inserted
 	 */
 	if (!mi->flags & ECM_DB_MAPPING_FLAGS_INSERTED) {
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 	} else {
 		struct ecm_db_listener_instance *li;
 
@@ -3380,8 +3450,6 @@ int ecm_db_mapping_deref(struct ecm_db_mapping_instance *mi)
 		if (mi->hash_next) {
 			mi->hash_next->hash_prev = mi->hash_prev;
 		}
-		mi->hash_next = NULL;
-		mi->hash_prev = NULL;
 		ecm_db_mapping_table_lengths[mi->hash_index]--;
 		DEBUG_ASSERT(ecm_db_mapping_table_lengths[mi->hash_index] >= 0, "%p: invalid table len %d\n", mi, ecm_db_mapping_table_lengths[mi->hash_index]);
 
@@ -3403,7 +3471,7 @@ int ecm_db_mapping_deref(struct ecm_db_mapping_instance *mi)
 
 		mi->host->mapping_count--;
 #endif
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 
 		/*
 		 * Throw removed event to listeners
@@ -3443,15 +3511,15 @@ int ecm_db_mapping_deref(struct ecm_db_mapping_instance *mi)
 	 * We can now destroy the instance
 	 */
 	DEBUG_CLEAR_MAGIC(mi);
-	kfree(mi);
+	kfree_rcu(mi, rcu);
 
 	/*
 	 * Decrease global mapping count
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ecm_db_mapping_count--;
 	DEBUG_ASSERT(ecm_db_mapping_count >= 0, "%p: mapping count wrap\n", mi);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	return 0;
 }
@@ -3463,18 +3531,16 @@ EXPORT_SYMBOL(ecm_db_mapping_deref);
  */
 int ecm_db_host_deref(struct ecm_db_host_instance *hi)
 {
-	DEBUG_CHECK_MAGIC(hi, ECM_DB_HOST_INSTANCE_MAGIC, "%p: magic failed\n", hi);
+	int refs;
 
-	spin_lock_bh(&ecm_db_lock);
-	hi->refs--;
-	DEBUG_TRACE("%p: host deref %d\n", hi, hi->refs);
-	DEBUG_ASSERT(hi->refs >= 0, "%p: ref wrap\n", hi);
+	DEBUG_CHECK_MAGIC(hi, ECM_DB_HOST_INSTANCE_MAGIC, "%p: magic failed\n", hi);
 
-	if (hi->refs > 0) {
-		int refs = hi->refs;
-		spin_unlock_bh(&ecm_db_lock);
+	if (!ecm_db_refs_put_and_lock(&hi->refs, &refs)) {
+		DEBUG_TRACE("%p: host deref %d\n", hi, refs);
+		DEBUG_ASSERT(refs >= 0, "%p: ref wrap\n", hi);
 		return refs;
 	}
+	DEBUG_TRACE("%p: host deref 0\n", hi);
 
 #ifdef ECM_DB_XREF_ENABLE
 	DEBUG_ASSERT((hi->mappings == NULL) && (hi->mapping_count == 0), "%p: mappings not null\n", hi);
@@ -3484,7 +3550,7 @@ int ecm_db_host_deref(struct ecm_db_host_instance *hi)
 	 * Remove from database if inserted
 	 */
 	if (!hi->flags & ECM_DB_HOST_FLAGS_INSERTED) {
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 	} else {
 		struct ecm_db_listener_instance *li;
 
@@ -3513,12 +3579,10 @@ int ecm_db_host_deref(struct ecm_db_host_instance *hi)
 		if (hi->hash_next) {
 			hi->hash_next->hash_prev = hi->hash_prev;
 		}
-		hi->hash_next = NULL;
-		hi->hash_prev = NULL;
 		ecm_db_host_table_lengths[hi->hash_index]--;
 		DEBUG_ASSERT(ecm_db_host_table_lengths[hi->hash_index] >= 0, "%p: invalid table len %d\n", hi, ecm_db_host_table_lengths[hi->hash_index]);
 
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 
 		/*
 		 * Throw removed event to listeners
@@ -3551,15 +3615,15 @@ int ecm_db_host_deref(struct ecm_db_host_instance *hi)
 	 * We can now destroy the instance
 	 */
 	DEBUG_CLEAR_MAGIC(hi);
-	kfree(hi);
+	kfree_rcu(hi, rcu);
 
 	/*
 	 * Decrease global host count
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ecm_db_host_count--;
 	DEBUG_ASSERT(ecm_db_host_count >= 0, "%p: host count wrap\n", hi);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	return 0;
 }
@@ -3571,18 +3635,16 @@ EXPORT_SYMBOL(ecm_db_host_deref);
  */
 int ecm_db_node_deref(struct ecm_db_node_instance *ni)
 {
-	DEBUG_CHECK_MAGIC(ni, ECM_DB_NODE_INSTANCE_MAGIC, "%p: magic failed\n", ni);
+	int refs;
 
-	spin_lock_bh(&ecm_db_lock);
-	ni->refs--;
-	DEBUG_TRACE("%p: node deref %d\n", ni, ni->refs);
-	DEBUG_ASSERT(ni->refs >= 0, "%p: ref wrap\n", ni);
+	DEBUG_CHECK_MAGIC(ni, ECM_DB_NODE_INSTANCE_MAGIC, "%p: magic failed\n", ni);
 
-	if (ni->refs > 0) {
-		int refs = ni->refs;
-		spin_unlock_bh(&ecm_db_lock);
+	if (!ecm_db_refs_put_and_lock(&ni->refs, &refs)) {
+		DEBUG_TRACE("%p: node deref %d\n", ni, refs);
+		DEBUG_ASSERT(refs >= 0, "%p: ref wrap\n", ni);
 		return refs;
 	}
+	DEBUG_TRACE("%p: node deref 0\n", ni);
 
 #ifdef ECM_DB_XREF_ENABLE
 	DEBUG_ASSERT((ni->from_connections == NULL) && (ni->from_connections_count == 0), "%p: from_connections not null\n", ni);
@@ -3595,7 +3657,7 @@ int ecm_db_node_deref(struct ecm_db_node_instance *ni)
 	 * Remove from database if inserted
 	 */
 	if (!ni->flags & ECM_DB_NODE_FLAGS_INSERTED) {
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 	} else {
 		struct ecm_db_listener_instance *li;
 
@@ -3624,8 +3686,6 @@ int ecm_db_node_deref(struct ecm_db_node_instance *ni)
 		if (ni->hash_next) {
 			ni->hash_next->hash_prev = ni->hash_prev;
 		}
-		ni->hash_next = NULL;
-		ni->hash_prev = NULL;
 		ecm_db_node_table_lengths[ni->hash_index]--;
 		DEBUG_ASSERT(ecm_db_node_table_lengths[ni->hash_index] >= 0, "%p: invalid table len %d\n", ni, ecm_db_node_table_lengths[ni->hash_index]);
 
@@ -3647,7 +3707,7 @@ int ecm_db_node_deref(struct ecm_db_node_instance *ni)
 		ni->iface->node_count--;
 #endif
 
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 
 		/*
 		 * Throw removed event to listeners
@@ -3687,15 +3747,15 @@ int ecm_db_node_deref(struct ecm_db_node_instance *ni)
 	 * We can now destroy the instance
 	 */
 	DEBUG_CLEAR_MAGIC(ni);
-	kfree(ni);
+	kfree_rcu(ni, rcu);
 
 	/*
 	 * Decrease global node count
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ecm_db_node_count--;
 	DEBUG_ASSERT(ecm_db_node_count >= 0, "%p: node count wrap\n", ni);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	return 0;
 }
@@ -3712,14 +3772,14 @@ int ecm_db_iface_deref(struct ecm_db_iface_instance *ii)
 	/*
 	 * Decrement reference count
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii->refs--;
 	DEBUG_TRACE("%p: iface deref %d\n", ii, ii->refs);
 	DEBUG_ASSERT(ii->refs >= 0, "%p: ref wrap\n", ii);
 
 	if (ii->refs > 0) {
 		int refs = ii->refs;
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		return refs;
 	}
 
@@ -3731,7 +3791,7 @@ int ecm_db_iface_deref(struct ecm_db_iface_instance *ii)
 	 * Remove from database if inserted
 	 */
 	if (!ii->flags & ECM_DB_IFACE_FLAGS_INSERTED) {
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 	} else {
 		struct ecm_db_listener_instance *li;
 
@@ -3781,7 +3841,7 @@ int ecm_db_iface_deref(struct ecm_db_iface_instance *ii)
 		ii->iface_id_hash_prev = NULL;
 		ecm_db_iface_id_table_lengths[ii->iface_id_hash_index]--;
 		DEBUG_ASSERT(ecm_db_iface_id_table_lengths[ii->iface_id_hash_index] >= 0, "%p: invalid table len %d\n", ii, ecm_db_iface_id_table_lengths[ii->iface_id_hash_index]);
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 
 		/*
 		 * Throw removed event to listeners
@@ -3819,10 +3879,10 @@ int ecm_db_iface_deref(struct ecm_db_iface_instance *ii)
 	/*
 	 * Decrease global interface count
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ecm_db_iface_count--;
 	DEBUG_ASSERT(ecm_db_iface_count >= 0, "%p: iface count wrap\n", ii);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	return 0;
 }
@@ -3841,13 +3901,13 @@ int ecm_db_listener_deref(struct ecm_db_listener_instance *li)
 
 	DEBUG_CHECK_MAGIC(li, ECM_DB_LISTENER_INSTANCE_MAGIC, "%p: magic failed", li);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	li->refs--;
 	DEBUG_ASSERT(li->refs >= 0, "%p: ref wrap\n", li);
 	if (li->refs > 0) {
 		int refs;
 		refs = li->refs;
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		return refs;
 	}
 
@@ -3866,7 +3926,7 @@ int ecm_db_listener_deref(struct ecm_db_listener_instance *li)
 		cli = cli->next;
 	}
 	DEBUG_ASSERT(cli, "%p: not found\n", li);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Invoke final callback
@@ -3880,10 +3940,10 @@ int ecm_db_listener_deref(struct ecm_db_listener_instance *li)
 	/*
 	 * Decrease global listener count
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ecm_db_listeners_count--;
 	DEBUG_ASSERT(ecm_db_listeners_count >= 0, "%p: listener count wrap\n", li);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	return 0;
 }
@@ -4188,22 +4248,27 @@ struct ecm_db_host_instance *ecm_db_host_find_and_ref(ip_addr_t address)
 	hash_index = ecm_db_host_generate_hash_index(address);
 
 	/*
-	 * Iterate the chain looking for a host with matching details
+	 * Iterate the chain looking for a host with matching details.
+	 * This is done without the lock, hosts are freed only after all lockless lookups are done with them.
 	 */
-	spin_lock_bh(&ecm_db_lock);
-	hi = ecm_db_host_table[hash_index];
+	this_cpu_inc(ecm_db_lock_stats.lockless_lookups);
+	rcu_read_lock();
+	hi = rcu_dereference(ecm_db_host_table[hash_index]);
 	while (hi) {
 		if (!ECM_IP_ADDR_MATCH(hi->address, address)) {
-			hi = hi->hash_next;
+			hi = rcu_dereference(hi->hash_next);
 			continue;
 		}
 
-		_ecm_db_host_ref(hi);
-		spin_unlock_bh(&ecm_db_lock);
+		if (!ecm_db_refs_get_unless_zero(&hi->refs)) {
+			hi = rcu_dereference(hi->hash_next);
+			continue;
+		}
+		rcu_read_unlock();
 		DEBUG_TRACE("host found %p\n", hi);
 		return hi;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	rcu_read_unlock();
 	DEBUG_TRACE("Host not found\n");
 	return NULL;
 }
@@ -4242,27 +4307,32 @@ struct ecm_db_node_instance *ecm_db_node_find_and_ref(uint8_t *address, struct e
 	hash_index = ecm_db_node_generate_hash_index(address);
 
 	/*
-	 * Iterate the chain looking for a host with matching details
+	 * Iterate the chain looking for a node with matching details.
+	 * This is done without the lock, nodes are freed only after all lockless lookups are done with them.
 	 */
-	spin_lock_bh(&ecm_db_lock);
-	ni = ecm_db_node_table[hash_index];
+	this_cpu_inc(ecm_db_lock_stats.lockless_lookups);
+	rcu_read_lock();
+	ni = rcu_dereference(ecm_db_node_table[hash_index]);
 	while (ni) {
 		if (memcmp(ni->address, address, ETH_ALEN)) {
-			ni = ni->hash_next;
+			ni = rcu_dereference(ni->hash_next);
 			continue;
 		}
 
 		if (ni->iface != ii) {
-			ni = ni->hash_next;
+			ni = rcu_dereference(ni->hash_next);
 			continue;
 		}
 
-		_ecm_db_node_ref(ni);
-		spin_unlock_bh(&ecm_db_lock);
+		if (!ecm_db_refs_get_unless_zero(&ni->refs)) {
+			ni = rcu_dereference(ni->hash_next);
+			continue;
+		}
+		rcu_read_unlock();
 		DEBUG_TRACE("node found %p\n", ni);
 		return ni;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	rcu_read_unlock();
 	DEBUG_TRACE("Node not found\n");
 	return NULL;
 }
@@ -4284,12 +4354,12 @@ struct ecm_db_node_instance *ecm_db_node_chain_get_and_ref_first(uint8_t *addres
 	 */
 	hash_index = ecm_db_node_generate_hash_index(address);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ni = ecm_db_node_table[hash_index];
 	if (ni) {
 		_ecm_db_node_ref(ni);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	return ni;
 }
@@ -4304,12 +4374,12 @@ struct ecm_db_node_instance *ecm_db_node_chain_get_and_ref_next(struct ecm_db_no
 	struct ecm_db_node_instance *nin;
 	DEBUG_CHECK_MAGIC(ni, ECM_DB_NODE_INSTANCE_MAGIC, "%p: magic failed", ni);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	nin = ni->hash_next;
 	if (nin) {
 		_ecm_db_node_ref(nin);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return nin;
 }
 EXPORT_SYMBOL(ecm_db_node_chain_get_and_ref_next);
@@ -4322,9 +4392,9 @@ void ecm_db_iface_ethernet_address_get(struct ecm_db_iface_instance *ii, uint8_t
 {
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed", ii);
 	DEBUG_ASSERT(ii->type == ECM_DB_IFACE_TYPE_ETHERNET, "%p: Bad type, expected ethernet, actual: %d\n", ii, ii->type);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	memcpy(address, ii->type_info.ethernet.address, sizeof(ii->type_info.ethernet.address));
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_iface_ethernet_address_get);
 
@@ -4336,9 +4406,9 @@ void ecm_db_iface_bridge_address_get(struct ecm_db_iface_instance *ii, uint8_t *
 {
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed", ii);
 	DEBUG_ASSERT(ii->type == ECM_DB_IFACE_TYPE_BRIDGE, "%p: Bad type, expected bridge, actual: %d\n", ii, ii->type);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	memcpy(address, ii->type_info.bridge.address, sizeof(ii->type_info.bridge.address));
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_iface_bridge_address_get);
 
@@ -4416,9 +4486,9 @@ static void _ecm_db_iface_identifier_hash_table_remove_entry(struct ecm_db_iface
 void ecm_db_iface_identifier_hash_table_entry_check_and_update(struct ecm_db_iface_instance *ii, int32_t new_interface_identifier)
 {
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed", ii);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	if (ii->interface_identifier == new_interface_identifier) {
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		return;
 	}
 
@@ -4426,7 +4496,7 @@ void ecm_db_iface_identifier_hash_table_entry_check_and_update(struct ecm_db_ifa
 	_ecm_db_iface_identifier_hash_table_remove_entry(ii);
 	ii->interface_identifier = new_interface_identifier;
 	_ecm_db_iface_identifier_hash_table_insert_entry(ii, new_interface_identifier);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_iface_identifier_hash_table_entry_check_and_update);
 
@@ -4449,12 +4519,12 @@ struct ecm_db_iface_instance *ecm_db_iface_find_and_ref_by_interface_identifier(
 	/*
 	 * Iterate the chain looking for a host with matching details
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii = ecm_db_iface_id_table[hash_index];
 	while (ii) {
 		if (ii->interface_identifier == interface_id) {
 			_ecm_db_iface_ref(ii);
-			spin_unlock_bh(&ecm_db_lock);
+			ecm_db_unlock_bh();
 			DEBUG_TRACE("iface found %p\n", ii);
 			return ii;
 		}
@@ -4464,7 +4534,7 @@ struct ecm_db_iface_instance *ecm_db_iface_find_and_ref_by_interface_identifier(
 		 */
 		ii = ii->iface_id_hash_next;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	DEBUG_TRACE("Iface not found\n");
 	return NULL;
 }
@@ -4489,7 +4559,7 @@ struct ecm_db_iface_instance *ecm_db_iface_ifidx_find_and_ref_ethernet(uint8_t *
 	/*
 	 * Iterate the chain looking for a host with matching details
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii = ecm_db_iface_table[hash_index];
 	while (ii) {
 		if ((ii->type != ECM_DB_IFACE_TYPE_ETHERNET)
@@ -4500,11 +4570,11 @@ struct ecm_db_iface_instance *ecm_db_iface_ifidx_find_and_ref_ethernet(uint8_t *
 		}
 
 		_ecm_db_iface_ref(ii);
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		DEBUG_TRACE("iface found %p\n", ii);
 		return ii;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	DEBUG_TRACE("Iface not found\n");
 	return NULL;
 }
@@ -4519,11 +4589,11 @@ void ecm_db_iface_vlan_info_get(struct ecm_db_iface_instance *ii, struct ecm_db_
 {
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed", ii);
 	DEBUG_ASSERT(ii->type == ECM_DB_IFACE_TYPE_VLAN, "%p: Bad type, expected vlan, actual: %d\n", ii, ii->type);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	memcpy(vlan_info->address, ii->type_info.vlan.address, sizeof(ii->type_info.vlan.address));
 	vlan_info->vlan_tag = ii->type_info.vlan.vlan_tag;
 	vlan_info->vlan_tpid = ii->type_info.vlan.vlan_tpid;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_iface_vlan_info_get);
 
@@ -4546,7 +4616,7 @@ struct ecm_db_iface_instance *ecm_db_iface_find_and_ref_vlan(uint8_t *address, u
 	/*
 	 * Iterate the chain looking for a host with matching details
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii = ecm_db_iface_table[hash_index];
 	while (ii) {
 		if ((ii->type != ECM_DB_IFACE_TYPE_VLAN) || (ii->type_info.vlan.vlan_tag != vlan_tag)
@@ -4557,11 +4627,11 @@ struct ecm_db_iface_instance *ecm_db_iface_find_and_ref_vlan(uint8_t *address, u
 		}
 
 		_ecm_db_iface_ref(ii);
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		DEBUG_TRACE("iface found %p\n", ii);
 		return ii;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	DEBUG_TRACE("Iface not found\n");
 	return NULL;
 }
@@ -4587,7 +4657,7 @@ struct ecm_db_iface_instance *ecm_db_iface_find_and_ref_bridge(uint8_t *address)
 	/*
 	 * Iterate the chain looking for a host with matching details
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii = ecm_db_iface_table[hash_index];
 	while (ii) {
 		if ((ii->type != ECM_DB_IFACE_TYPE_BRIDGE) || memcmp(ii->type_info.bridge.address, address, ETH_ALEN)) {
@@ -4596,11 +4666,11 @@ struct ecm_db_iface_instance *ecm_db_iface_find_and_ref_bridge(uint8_t *address)
 		}
 
 		_ecm_db_iface_ref(ii);
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		DEBUG_TRACE("iface found %p\n", ii);
 		return ii;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	DEBUG_TRACE("Iface not found\n");
 	return NULL;
 }
@@ -4626,7 +4696,7 @@ struct ecm_db_iface_instance *ecm_db_iface_find_and_ref_lag(uint8_t *address)
 	/*
 	 * Iterate the chain looking for a host with matching details
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii = ecm_db_iface_table[hash_index];
 	while (ii) {
 		if ((ii->type != ECM_DB_IFACE_TYPE_LAG) || memcmp(ii->type_info.lag.address, address, ETH_ALEN)) {
@@ -4635,11 +4705,11 @@ struct ecm_db_iface_instance *ecm_db_iface_find_and_ref_lag(uint8_t *address)
 		}
 
 		_ecm_db_iface_ref(ii);
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		DEBUG_TRACE("iface found %p\n", ii);
 		return ii;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	DEBUG_TRACE("Iface not found\n");
 	return NULL;
 }
@@ -4655,10 +4725,10 @@ void ecm_db_iface_pppoe_session_info_get(struct ecm_db_iface_instance *ii, struc
 {
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed", ii);
 	DEBUG_ASSERT(ii->type == ECM_DB_IFACE_TYPE_PPPOE, "%p: Bad type, expected pppoe, actual: %d\n", ii, ii->type);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	memcpy(pppoe_info->remote_mac, ii->type_info.pppoe.remote_mac, sizeof(ii->type_info.pppoe.remote_mac));
 	pppoe_info->pppoe_session_id = ii->type_info.pppoe.pppoe_session_id;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 
 EXPORT_SYMBOL(ecm_db_iface_pppoe_session_info_get);
@@ -4682,7 +4752,7 @@ struct ecm_db_iface_instance *ecm_db_iface_find_and_ref_pppoe(uint16_t pppoe_ses
 	/*
 	 * Iterate the chain looking for a host with matching details
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii = ecm_db_iface_table[hash_index];
 	while (ii) {
 		if ((ii->type != ECM_DB_IFACE_TYPE_PPPOE)
@@ -4693,11 +4763,11 @@ struct ecm_db_iface_instance *ecm_db_iface_find_and_ref_pppoe(uint16_t pppoe_ses
 		}
 
 		_ecm_db_iface_ref(ii);
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		DEBUG_TRACE("iface found %p\n", ii);
 		return ii;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	DEBUG_TRACE("Iface not found\n");
 	return NULL;
 }
@@ -4712,13 +4782,13 @@ void ecm_db_iface_update_ae_interface_identifier(struct ecm_db_iface_instance *i
 {
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed", ii);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	if (ii->ae_interface_identifier == ae_interface_identifier) {
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		return;
 	}
 	ii->ae_interface_identifier = ae_interface_identifier;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_iface_update_ae_interface_identifier);
 
@@ -4731,9 +4801,9 @@ void ecm_db_iface_pppol2tpv2_session_info_get(struct ecm_db_iface_instance *ii,
 {
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed", ii);
 	DEBUG_ASSERT(ii->type == ECM_DB_IFACE_TYPE_PPPOL2TPV2, "%p: Bad type, expected pppol2tpv2, actual: %d\n", ii, ii->type);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	memcpy(pppol2tpv2_info, &ii->type_info.pppol2tpv2, sizeof(struct ecm_db_interface_info_pppol2tpv2));
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_iface_pppol2tpv2_session_info_get);
 
@@ -4757,7 +4827,7 @@ struct ecm_db_iface_instance *ecm_db_iface_find_and_ref_pppol2tpv2(uint32_t pppo
 	/*
 	 * Iterate the chain looking for a host with matching details
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii = ecm_db_iface_table[hash_index];
 
 	while (ii) {
@@ -4769,11 +4839,11 @@ struct ecm_db_iface_instance *ecm_db_iface_find_and_ref_pppol2tpv2(uint32_t pppo
 		}
 
 		_ecm_db_iface_ref(ii);
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		DEBUG_TRACE("iface found %p\n", ii);
 		return ii;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	DEBUG_TRACE("Iface not found\n");
 	return NULL;
@@ -4791,9 +4861,9 @@ void ecm_db_iface_pptp_session_info_get(struct ecm_db_iface_instance *ii, struct
 {
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed", ii);
 	DEBUG_ASSERT(ii->type == ECM_DB_IFACE_TYPE_PPTP, "%p: Bad type, expected pptp, actual: %d\n", ii, ii->type);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	memcpy(pptp_info, &ii->type_info.pptp, sizeof(struct ecm_db_interface_info_pptp));
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_iface_pptp_session_info_get);
 
@@ -4817,7 +4887,7 @@ struct ecm_db_iface_instance *ecm_db_iface_find_and_ref_pptp(uint32_t pptp_src_c
 	/*
 	 * Iterate the chain looking for a host with matching details
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii = ecm_db_iface_table[hash_index];
 
 	while (ii) {
@@ -4829,11 +4899,11 @@ struct ecm_db_iface_instance *ecm_db_iface_find_and_ref_pptp(uint32_t pptp_src_c
 		}
 
 		_ecm_db_iface_ref(ii);
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		DEBUG_TRACE("iface found %p\n", ii);
 		return ii;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	DEBUG_TRACE("Iface not found\n");
 	return NULL;
@@ -4850,9 +4920,9 @@ void ecm_db_iface_map_t_info_get(struct ecm_db_iface_instance *ii, struct ecm_db
 {
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed", ii);
 	DEBUG_ASSERT(ii->type == ECM_DB_IFACE_TYPE_MAP_T, "%p: Bad type, expected map_t, actual: %d\n", ii, ii->type);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	memcpy(map_t_info, &ii->type_info.map_t, sizeof(struct ecm_db_interface_info_map_t));
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_iface_map_t_info_get);
 
@@ -4875,7 +4945,7 @@ struct ecm_db_iface_instance *ecm_db_iface_find_and_ref_map_t(int if_index)
 	/*
 	 * Iterate the chain looking for a host with matching details
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii = ecm_db_iface_table[hash_index];
 
 	while (ii) {
@@ -4886,11 +4956,11 @@ struct ecm_db_iface_instance *ecm_db_iface_find_and_ref_map_t(int if_index)
 		}
 
 		_ecm_db_iface_ref(ii);
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		DEBUG_TRACE("%p: iface found\n", ii);
 		return ii;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	DEBUG_TRACE("Iface not found\n");
 	return NULL;
@@ -4918,7 +4988,7 @@ struct ecm_db_iface_instance *ecm_db_iface_find_and_ref_unknown(uint32_t os_spec
 	/*
 	 * Iterate the chain looking for a host with matching details
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii = ecm_db_iface_table[hash_index];
 	while (ii) {
 		if ((ii->type != ECM_DB_IFACE_TYPE_UNKNOWN) || (ii->type_info.unknown.os_specific_ident != os_specific_ident)) {
@@ -4927,11 +4997,11 @@ struct ecm_db_iface_instance *ecm_db_iface_find_and_ref_unknown(uint32_t os_spec
 		}
 
 		_ecm_db_iface_ref(ii);
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		DEBUG_TRACE("iface found %p\n", ii);
 		return ii;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	DEBUG_TRACE("Iface not found\n");
 	return NULL;
 }
@@ -4956,7 +5026,7 @@ struct ecm_db_iface_instance *ecm_db_iface_find_and_ref_loopback(uint32_t os_spe
 	/*
 	 * Iterate the chain looking for a host with matching details
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii = ecm_db_iface_table[hash_index];
 	while (ii) {
 		if ((ii->type != ECM_DB_IFACE_TYPE_LOOPBACK) || (ii->type_info.loopback.os_specific_ident != os_specific_ident)) {
@@ -4965,11 +5035,11 @@ struct ecm_db_iface_instance *ecm_db_iface_find_and_ref_loopback(uint32_t os_spe
 		}
 
 		_ecm_db_iface_ref(ii);
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		DEBUG_TRACE("iface found %p\n", ii);
 		return ii;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	DEBUG_TRACE("Iface not found\n");
 	return NULL;
 }
@@ -4996,7 +5066,7 @@ struct ecm_db_iface_instance *ecm_db_iface_find_and_ref_ipsec_tunnel(uint32_t os
 	/*
 	 * Iterate the chain looking for a host with matching details
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii = ecm_db_iface_table[hash_index];
 	while (ii) {
 		if ((ii->type != ECM_DB_IFACE_TYPE_IPSEC_TUNNEL) || (ii->type_info.ipsec_tunnel.os_specific_ident != os_specific_ident)) {
@@ -5005,11 +5075,11 @@ struct ecm_db_iface_instance *ecm_db_iface_find_and_ref_ipsec_tunnel(uint32_t os
 		}
 
 		_ecm_db_iface_ref(ii);
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		DEBUG_TRACE("iface found %p\n", ii);
 		return ii;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	DEBUG_TRACE("Iface not found\n");
 	return NULL;
 }
@@ -5037,7 +5107,7 @@ struct ecm_db_iface_instance *ecm_db_iface_find_and_ref_sit(ip_addr_t saddr, ip_
 	/*
 	 * Iterate the chain looking for a host with matching details
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii = ecm_db_iface_table[hash_index];
 	while (ii) {
 		if ((ii->type != ECM_DB_IFACE_TYPE_SIT)
@@ -5048,11 +5118,11 @@ struct ecm_db_iface_instance *ecm_db_iface_find_and_ref_sit(ip_addr_t saddr, ip_
 		}
 
 		_ecm_db_iface_ref(ii);
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		DEBUG_TRACE("iface found %p\n", ii);
 		return ii;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	DEBUG_TRACE("Iface not found\n");
 	return NULL;
 }
@@ -5081,7 +5151,7 @@ struct ecm_db_iface_instance *ecm_db_iface_find_and_ref_tunipip6(ip_addr_t saddr
 	/*
 	 * Iterate the chain looking for a host with matching details
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii = ecm_db_iface_table[hash_index];
 	while (ii) {
 		if ((ii->type != ECM_DB_IFACE_TYPE_TUNIPIP6)
@@ -5092,11 +5162,11 @@ struct ecm_db_iface_instance *ecm_db_iface_find_and_ref_tunipip6(ip_addr_t saddr
 		}
 
 		_ecm_db_iface_ref(ii);
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		DEBUG_TRACE("iface found %p\n", ii);
 		return ii;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	DEBUG_TRACE("Iface not found\n");
 	return NULL;
 }
@@ -5123,27 +5193,32 @@ struct ecm_db_mapping_instance *ecm_db_mapping_find_and_ref(ip_addr_t address, i
 	hash_index = ecm_db_mapping_generate_hash_index(address, port);
 
 	/*
-	 * Iterate the chain looking for a mapping with matching details
+	 * Iterate the chain looking for a mapping with matching details.
+	 * This is done without the lock, mappings (and their hosts) are freed only after all lockless lookups are done with them.
 	 */
-	spin_lock_bh(&ecm_db_lock);
-	mi = ecm_db_mapping_table[hash_index];
+	this_cpu_inc(ecm_db_lock_stats.lockless_lookups);
+	rcu_read_lock();
+	mi = rcu_dereference(ecm_db_mapping_table[hash_index]);
 	while (mi) {
 		if (mi->port != port) {
-			mi = mi->hash_next;
+			mi = rcu_dereference(mi->hash_next);
 			continue;
 		}
 
 		if (!ECM_IP_ADDR_MATCH(mi->host->address, address)) {
-			mi = mi->hash_next;
+			mi = rcu_dereference(mi->hash_next);
 			continue;
 		}
 
-		_ecm_db_mapping_ref(mi);
-		spin_unlock_bh(&ecm_db_lock);
+		if (!ecm_db_refs_get_unless_zero(&mi->refs)) {
+			mi = rcu_dereference(mi->hash_next);
+			continue;
+		}
+		rcu_read_unlock();
 		DEBUG_TRACE("Mapping found %p\n", mi);
 		return mi;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	rcu_read_unlock();
 	DEBUG_TRACE("Mapping not found\n");
 	return NULL;
 }
@@ -5160,10 +5235,13 @@ static struct ecm_db_connection_instance *ecm_db_connection_find_and_ref_chain(e
 	struct ecm_db_connection_instance *ci;
 
 	/*
-	 * Iterate the chain looking for a connection with matching details
+	 * Iterate the chain looking for a connection with matching details.
+	 * This is done without the lock, connections and the mappings and hosts they reference are freed only
+	 * after all lockless lookups are done with them.
 	 */
-	spin_lock_bh(&ecm_db_lock);
-	ci = ecm_db_connection_table[hash_index];
+	this_cpu_inc(ecm_db_lock_stats.lockless_lookups);
+	rcu_read_lock();
+	ci = rcu_dereference(ecm_db_connection_table[hash_index]);
 	while (ci) {
 		/*
 		 * The use of unlikely() is liberally used because under fast-hit scenarios the connection would always be at the start of a chain
@@ -5207,20 +5285,19 @@ try_reverse:
 			goto try_next;
 		}
 
-		goto connection_found;
+connection_found:
+		if (likely(ecm_db_refs_get_unless_zero(&ci->refs))) {
+			rcu_read_unlock();
+			DEBUG_TRACE("Connection found %p\n", ci);
+			return ci;
+		}
 
 try_next:
-		ci = ci->hash_next;
+		ci = rcu_dereference(ci->hash_next);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	rcu_read_unlock();
 	DEBUG_TRACE("Connection not found in hash chain\n");
 	return NULL;
-
-connection_found:
-	_ecm_db_connection_ref(ci);
-	spin_unlock_bh(&ecm_db_lock);
-	DEBUG_TRACE("Connection found %p\n", ci);
-	return ci;
 }
 
 /*
@@ -5260,24 +5337,25 @@ struct ecm_db_connection_instance *ecm_db_connection_serial_find_and_ref(uint32_
 	serial_hash_index = ecm_db_connection_generate_serial_hash_index(serial);
 
 	/*
-	 * Iterate the chain looking for a connection with matching serial
+	 * Iterate the chain looking for a connection with matching serial.
+	 * This is done without the lock, connections are freed only after all lockless lookups are done with them.
 	 */
-	spin_lock_bh(&ecm_db_lock);
-	ci = ecm_db_connection_serial_table[serial_hash_index];
+	this_cpu_inc(ecm_db_lock_stats.lockless_lookups);
+	rcu_read_lock();
+	ci = rcu_dereference(ecm_db_connection_serial_table[serial_hash_index]);
 	while (ci) {
 		/*
 		 * The use of likely() is used because under fast-hit scenarios the connection would always be at the start of a chain
 		 */
-		if (likely(ci->serial == serial)) {
-			_ecm_db_connection_ref(ci);
-			spin_unlock_bh(&ecm_db_lock);
+		if (likely(ci->serial == serial) && ecm_db_refs_get_unless_zero(&ci->refs)) {
+			rcu_read_unlock();
 			DEBUG_TRACE("Connection found %p\n", ci);
 			return ci;
 		}
 
-		ci = ci->serial_hash_next;
+		ci = rcu_dereference(ci->serial_hash_next);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	rcu_read_unlock();
 	DEBUG_TRACE("Connection not found\n");
 	return NULL;
 }
@@ -5293,11 +5371,11 @@ struct ecm_db_node_instance *ecm_db_connection_node_to_get_and_ref(struct ecm_db
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ni = ci->to_node;
 	DEBUG_CHECK_MAGIC(ni, ECM_DB_NODE_INSTANCE_MAGIC, "%p: magic failed\n", ni);
 	_ecm_db_node_ref(ni);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return ni;
 }
 EXPORT_SYMBOL(ecm_db_connection_node_to_get_and_ref);
@@ -5312,10 +5390,10 @@ struct ecm_db_node_instance *ecm_db_connection_node_from_get_and_ref(struct ecm_
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ni = ci->from_node;
 	_ecm_db_node_ref(ni);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return ni;
 }
 EXPORT_SYMBOL(ecm_db_connection_node_from_get_and_ref);
@@ -5331,12 +5409,12 @@ struct ecm_db_connection_instance *ecm_db_mapping_connections_from_get_and_ref_f
 
 	DEBUG_CHECK_MAGIC(mi, ECM_DB_MAPPING_INSTANCE_MAGIC, "%p: magic failed", mi);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ci = mi->from_connections;
 	if (ci) {
 		_ecm_db_connection_ref(ci);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	return ci;
 }
@@ -5352,12 +5430,12 @@ struct ecm_db_connection_instance *ecm_db_mapping_connections_to_get_and_ref_fir
 
 	DEBUG_CHECK_MAGIC(mi, ECM_DB_MAPPING_INSTANCE_MAGIC, "%p: magic failed", mi);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ci = mi->to_connections;
 	if (ci) {
 		_ecm_db_connection_ref(ci);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	return ci;
 }
@@ -5373,12 +5451,12 @@ struct ecm_db_connection_instance *ecm_db_mapping_connections_nat_from_get_and_r
 
 	DEBUG_CHECK_MAGIC(mi, ECM_DB_MAPPING_INSTANCE_MAGIC, "%p: magic failed", mi);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ci = mi->from_nat_connections;
 	if (ci) {
 		_ecm_db_connection_ref(ci);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	return ci;
 }
@@ -5394,12 +5472,12 @@ struct ecm_db_connection_instance *ecm_db_mapping_connections_nat_to_get_and_ref
 
 	DEBUG_CHECK_MAGIC(mi, ECM_DB_MAPPING_INSTANCE_MAGIC, "%p: magic failed", mi);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ci = mi->to_nat_connections;
 	if (ci) {
 		_ecm_db_connection_ref(ci);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	return ci;
 }
@@ -5415,12 +5493,12 @@ struct ecm_db_connection_instance *ecm_db_connection_mapping_from_get_and_ref_ne
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	nci = ci->from_next;
 	if (nci) {
 		_ecm_db_connection_ref(nci);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	return nci;
 }
@@ -5436,12 +5514,12 @@ struct ecm_db_connection_instance *ecm_db_connection_mapping_to_get_and_ref_next
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	nci = ci->to_next;
 	if (nci) {
 		_ecm_db_connection_ref(nci);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	return nci;
 }
@@ -5457,12 +5535,12 @@ struct ecm_db_connection_instance *ecm_db_connection_mapping_nat_from_get_and_re
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	nci = ci->from_nat_next;
 	if (nci) {
 		_ecm_db_connection_ref(nci);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	return nci;
 }
@@ -5478,12 +5556,12 @@ struct ecm_db_connection_instance *ecm_db_connection_mapping_nat_to_get_and_ref_
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	nci = ci->to_nat_next;
 	if (nci) {
 		_ecm_db_connection_ref(nci);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	return nci;
 }
@@ -5499,12 +5577,12 @@ struct ecm_db_connection_instance *ecm_db_iface_connections_from_get_and_ref_fir
 
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed", ii);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ci = ii->from_connections;
 	if (ci) {
 		_ecm_db_connection_ref(ci);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	return ci;
 }
@@ -5520,12 +5598,12 @@ struct ecm_db_connection_instance *ecm_db_iface_connections_to_get_and_ref_first
 
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed", ii);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ci = ii->to_connections;
 	if (ci) {
 		_ecm_db_connection_ref(ci);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	return ci;
 }
@@ -5541,12 +5619,12 @@ struct ecm_db_connection_instance *ecm_db_iface_connections_nat_from_get_and_ref
 
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed", ii);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ci = ii->from_nat_connections;
 	if (ci) {
 		_ecm_db_connection_ref(ci);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	return ci;
 }
@@ -5562,12 +5640,12 @@ struct ecm_db_connection_instance *ecm_db_iface_connections_nat_to_get_and_ref_f
 
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed", ii);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ci = ii->to_nat_connections;
 	if (ci) {
 		_ecm_db_connection_ref(ci);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	return ci;
 }
@@ -5583,12 +5661,12 @@ struct ecm_db_connection_instance *ecm_db_connection_iface_from_get_and_ref_next
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	nci = ci->iface_from_next;
 	if (nci) {
 		_ecm_db_connection_ref(nci);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	return nci;
 }
@@ -5604,12 +5682,12 @@ struct ecm_db_connection_instance *ecm_db_connection_iface_to_get_and_ref_next(s
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	nci = ci->iface_to_next;
 	if (nci) {
 		_ecm_db_connection_ref(nci);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	return nci;
 }
@@ -5625,12 +5703,12 @@ struct ecm_db_connection_instance *ecm_db_connection_iface_nat_from_get_and_ref_
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	nci = ci->iface_from_nat_next;
 	if (nci) {
 		_ecm_db_connection_ref(nci);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	return nci;
 }
@@ -5646,12 +5724,12 @@ struct ecm_db_connection_instance *ecm_db_connection_iface_nat_to_get_and_ref_ne
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	nci = ci->iface_to_nat_next;
 	if (nci) {
 		_ecm_db_connection_ref(nci);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	return nci;
 }
@@ -5667,12 +5745,12 @@ struct ecm_db_node_instance *ecm_db_iface_nodes_get_and_ref_first(struct ecm_db_
 
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed", ii);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ni = ii->nodes;
 	if (ni) {
 		_ecm_db_node_ref(ni);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	return ni;
 }
@@ -5688,9 +5766,9 @@ int ecm_db_iface_node_count_get(struct ecm_db_iface_instance *ii)
 
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	count = ii->node_count;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return count;
 }
 EXPORT_SYMBOL(ecm_db_iface_node_count_get);
@@ -5705,9 +5783,9 @@ int ecm_db_host_mapping_count_get(struct ecm_db_host_instance *hi)
 
 	DEBUG_CHECK_MAGIC(hi, ECM_DB_HOST_INSTANCE_MAGIC, "%p: magic failed\n", hi);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	count = hi->mapping_count;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return count;
 }
 EXPORT_SYMBOL(ecm_db_host_mapping_count_get);
@@ -5720,9 +5798,9 @@ struct ecm_db_host_instance *ecm_db_mapping_host_get_and_ref(struct ecm_db_mappi
 {
 	DEBUG_CHECK_MAGIC(mi, ECM_DB_MAPPING_INSTANCE_MAGIC, "%p: magic failed\n", mi);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	_ecm_db_host_ref(mi->host);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return mi->host;
 }
 EXPORT_SYMBOL(ecm_db_mapping_host_get_and_ref);
@@ -5734,9 +5812,9 @@ struct ecm_db_iface_instance *ecm_db_node_iface_get_and_ref(struct ecm_db_node_i
 {
 	DEBUG_CHECK_MAGIC(ni, ECM_DB_NODE_INSTANCE_MAGIC, "%p: magic failed\n", ni);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	_ecm_db_iface_ref(ni->iface);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return ni->iface;
 }
 EXPORT_SYMBOL(ecm_db_node_iface_get_and_ref);
@@ -5751,10 +5829,10 @@ int ecm_db_mapping_connections_total_count_get(struct ecm_db_mapping_instance *m
 
 	DEBUG_CHECK_MAGIC(mi, ECM_DB_MAPPING_INSTANCE_MAGIC, "%p: magic failed\n", mi);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	count = mi->from + mi->to + mi->nat_from + mi->nat_to;
 	DEBUG_ASSERT(count >= 0, "%p: Count overflow from: %d, to: %d, nat_from: %d, nat_to: %d\n", mi, mi->from, mi->to, mi->nat_from, mi->nat_to);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return count;
 }
 EXPORT_SYMBOL(ecm_db_mapping_connections_total_count_get);
@@ -5769,10 +5847,10 @@ struct ecm_db_mapping_instance *ecm_db_connection_mapping_from_get_and_ref(struc
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	mi = ci->mapping_from;
 	_ecm_db_mapping_ref(mi);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return mi;
 }
 EXPORT_SYMBOL(ecm_db_connection_mapping_from_get_and_ref);
@@ -5787,10 +5865,10 @@ struct ecm_db_mapping_instance *ecm_db_connection_mapping_nat_from_get_and_ref(s
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	mi = ci->mapping_nat_from;
 	_ecm_db_mapping_ref(mi);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return mi;
 }
 EXPORT_SYMBOL(ecm_db_connection_mapping_nat_from_get_and_ref);
@@ -5805,10 +5883,10 @@ struct ecm_db_mapping_instance *ecm_db_connection_mapping_to_get_and_ref(struct
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	mi = ci->mapping_to;
 	_ecm_db_mapping_ref(mi);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return mi;
 }
 EXPORT_SYMBOL(ecm_db_connection_mapping_to_get_and_ref);
@@ -5823,74 +5901,114 @@ struct ecm_db_mapping_instance *ecm_db_connection_mapping_nat_to_get_and_ref(str
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	mi = ci->mapping_nat_to;
 	_ecm_db_mapping_ref(mi);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return mi;
 }
 EXPORT_SYMBOL(ecm_db_connection_mapping_nat_to_get_and_ref);
 
+/*
+ * _ecm_db_timer_wheel_cascade()
+ *	Re-bucket the entries of the current slot of the given wheel level into the levels below it.
+ */
+static void _ecm_db_timer_wheel_cascade(unsigned int level, uint32_t time_now)
+{
+	struct hlist_head *slot;
+	struct hlist_head pending;
+	struct ecm_db_timer_group_entry *tge;
+	struct hlist_node *tmp;
+
+	slot = &ecm_db_timer_wheel[level][(time_now >> (level * ECM_DB_TIMER_WHEEL_BITS)) & ECM_DB_TIMER_WHEEL_MASK];
+	hlist_move_list(slot, &pending);
+	hlist_for_each_entry_safe(tge, tmp, &pending, node) {
+		hlist_del(&tge->node);
+		_ecm_db_timer_wheel_insert(tge, _ecm_db_timer_group_entry_expires(tge));
+	}
+}
+
 /*
  * ecm_db_timer_groups_check()
  *	Check for expired group entries, returns the number that have expired
+ *
+ * Only the level 0 slot for the current tick needs examining.  Entries in it that have been touched
+ * since they were inserted are re-bucketed according to their new expiry time, the rest have expired.
+ * Expired entries are unlinked together under the lock and their callbacks are then invoked without it.
  */
 static uint32_t ecm_db_timer_groups_check(uint32_t time_now)
 {
-	ecm_db_timer_group_t i;
+	unsigned int level;
 	uint32_t expired = 0;
+	struct hlist_head pending;
+	HLIST_HEAD(expired_list);
+	struct ecm_db_timer_group_entry *tge;
+	struct hlist_node *tmp;
 
 	DEBUG_TRACE("Timer groups check start %u\n", time_now);
 
+	ecm_db_lock_bh();
+
 	/*
-	 * Examine all timer groups for expired entries.
+	 * Cascade from the highest level down so that entries moving more than one level land in
+	 * slots that are cascaded in this same tick.
 	 */
-	for (i = 0; i < ECM_DB_TIMER_GROUPS_MAX; ++i) {
-		struct ecm_db_timer_group *timer_group;
+	for (level = ECM_DB_TIMER_WHEEL_LEVELS - 1; level > 0; --level) {
+		if (time_now & ((1 << (level * ECM_DB_TIMER_WHEEL_BITS)) - 1)) {
+			continue;
+		}
+		_ecm_db_timer_wheel_cascade(level, time_now);
+	}
+
+	hlist_move_list(&ecm_db_timer_wheel[0][time_now & ECM_DB_TIMER_WHEEL_MASK], &pending);
+	hlist_for_each_entry_safe(tge, tmp, &pending, node) {
+		uint32_t expires;
+
+		hlist_del(&tge->node);
 
 		/*
-		 * The group tail tracks the oldest entry so that is what we examine.
+		 * Touched since it was placed in this slot?
 		 */
-		timer_group = &ecm_db_timer_groups[i];
-		spin_lock_bh(&ecm_db_lock);
-		while (timer_group->tail) {
-			struct ecm_db_timer_group_entry *tge;
-
-			tge = timer_group->tail;
-			if (tge->timeout > time_now) {
-				/*
-				 * Not expired - and no further will be as they are in order
-				 */
-				break;
-			}
+		expires = _ecm_db_timer_group_entry_expires(tge);
+		if ((int32_t)(expires - time_now) > 0) {
+			_ecm_db_timer_wheel_insert(tge, expires);
+			continue;
+		}
 
-			/*
-			 * Has expired - remove the entry from the list and invoke the callback
-			 * NOTE: We know the entry is at the tail of the group
-			 */
-			if (tge->prev) {
-				tge->prev->next = NULL;
-			} else {
-				/*
-				 * First in the group
-				 */
-				DEBUG_ASSERT(timer_group->head == tge, "%p: bad head, expecting %p got %p\n", timer_group, tge, timer_group->head);
-				timer_group->head = NULL;
-			}
-			timer_group->tail = tge->prev;
-			tge->group = ECM_DB_TIMER_GROUPS_MAX;
-			spin_unlock_bh(&ecm_db_lock);
-			expired++;
-			DEBUG_TRACE("%p: Expired\n", tge);
-			tge->fn(tge->arg);
-			spin_lock_bh(&ecm_db_lock);
+		/*
+		 * Has expired but if we have already expired enough entries this tick then leave it to
+		 * the next one so that a mass expiry is spread out.
+		 */
+		if (expired == ECM_DB_TIMER_WHEEL_EXPIRE_BUDGET) {
+			hlist_add_head(&tge->node, &ecm_db_timer_wheel[0][(time_now + 1) & ECM_DB_TIMER_WHEEL_MASK]);
+			continue;
 		}
-		spin_unlock_bh(&ecm_db_lock);
+
+		WRITE_ONCE(tge->group, ECM_DB_TIMER_GROUPS_MAX);
+		hlist_add_head(&tge->node, &expired_list);
+		expired++;
 	}
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
+
+	/*
+	 * Invoke the callbacks.  An entry may be freed by its callback so we must not touch it afterwards.
+	 *
+	 * The expired entries are linked through their wheel node, which is walked here without the lock.
+	 * That is safe because, with the group set to ECM_DB_TIMER_GROUPS_MAX, nothing else links or unlinks
+	 * the node: remove and reset see the entry as already expired and leave it alone, touch only writes
+	 * the touched time, and set is only used on entries whose timer has never run.  The timer holds its
+	 * own reference on what it is for, which only the callback drops, so an entry can not be freed while
+	 * it is on this list either.
+	 */
+	hlist_for_each_entry_safe(tge, tmp, &expired_list, node) {
+		DEBUG_TRACE("%p: Expired\n", tge);
+		tge->fn(tge->arg);
+	}
+
+	ecm_db_lock_bh();
 	time_now = ecm_db_time;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	DEBUG_TRACE("Timer groups check end %u, expired count %u\n", time_now, expired);
 	return expired;
 }
@@ -5930,7 +6048,7 @@ void ecm_db_connection_classifier_assign(struct ecm_db_connection_instance *ci,
 	/*
 	 * Find place to insert the classifier
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ca = ci->assignments;
 	ca_prev = NULL;
 	while (ca) {
@@ -5976,7 +6094,7 @@ void ecm_db_connection_classifier_assign(struct ecm_db_connection_instance *ci,
 	 * Only assigned classifiers can be added.
 	 */
 	if (new_ca_type == ECM_CLASSIFIER_TYPE_DEFAULT) {
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		return;
 	}
 
@@ -5993,7 +6111,7 @@ void ecm_db_connection_classifier_assign(struct ecm_db_connection_instance *ci,
 		DEBUG_CHECK_MAGIC(ta, ECM_DB_CLASSIFIER_TYPE_ASSIGNMENT_MAGIC, "%p: magic failed, ci: %p", ta, ci);
 		DEBUG_ASSERT(ta->iteration_count != 0, "%p: Bad pending_unassign: type: %d, Iteration count zero\n", ci, new_ca_type);
 		ta->pending_unassign = false;
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		return;
 	}
 
@@ -6035,7 +6153,7 @@ void ecm_db_connection_classifier_assign(struct ecm_db_connection_instance *ci,
 	tal->type_assignment_count++;
 	DEBUG_ASSERT(tal->type_assignment_count > 0, "Bad iteration count: %d\n", tal->type_assignment_count);
 #endif
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_connection_classifier_assign);
 
@@ -6058,14 +6176,14 @@ int ecm_db_connection_classifier_assignments_get_and_ref(struct ecm_db_connectio
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
 
 	aci_count = 0;
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	aci = ci->assignments;
 	while (aci) {
 		aci->ref(aci);
 		assignments[aci_count++] = aci;
 		aci = aci->ca_next;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	DEBUG_ASSERT(aci_count >= 1, "%p: Must have at least default classifier!\n", ci);
 	return aci_count;
 }
@@ -6095,12 +6213,12 @@ struct ecm_classifier_instance *ecm_db_connection_assigned_classifier_find_and_r
 {
 	struct ecm_classifier_instance *ca;
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ca = ci->assignments_by_type[type];
 	if (ca) {
 		ca->ref(ca);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return ca;
 }
 EXPORT_SYMBOL(ecm_db_connection_assigned_classifier_find_and_ref);
@@ -6133,14 +6251,14 @@ void ecm_db_connection_classifier_unassign(struct ecm_db_connection_instance *ci
 	/*
 	 * NOTE: It is possible that in SMP this classifier has already been unassigned.
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	if (ci->assignments_by_type[ca_type] == NULL) {
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		DEBUG_TRACE("%p: Classifier type: %d already unassigned\n", ci, ca_type);
 		return;
 	}
 	_ecm_db_connection_classifier_unassign(ci, cci, ca_type);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_connection_classifier_unassign);
 
@@ -6162,7 +6280,7 @@ struct ecm_db_connection_instance *ecm_db_connection_by_classifier_type_assignme
 	DEBUG_TRACE("Get and ref first connection assigned with classifier type: %d\n", ca_type);
 
 	tal = &ecm_db_connection_classifier_type_assignments[ca_type];
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ci = tal->type_assignments_list;
 	while (ci) {
 		struct ecm_db_connection_classifier_type_assignment *ta;
@@ -6183,10 +6301,10 @@ struct ecm_db_connection_instance *ecm_db_connection_by_classifier_type_assignme
 		_ecm_db_connection_ref(ci);
 		ta->iteration_count++;
 		DEBUG_ASSERT(ta->iteration_count > 0, "Bad Iteration count: %d for type: %d, connection: %p\n", ta->iteration_count, ca_type, ci);
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		return ci;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return NULL;
 }
 EXPORT_SYMBOL(ecm_db_connection_by_classifier_type_assignment_get_and_ref_first);
@@ -6208,7 +6326,7 @@ struct ecm_db_connection_instance *ecm_db_connection_by_classifier_type_assignme
 
 	DEBUG_TRACE("Get and ref next connection assigned with classifier type: %d and ci: %p\n", ca_type, ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ta = &ci->type_assignment[ca_type];
 	cin = ta->next;
 	while (cin) {
@@ -6231,10 +6349,10 @@ struct ecm_db_connection_instance *ecm_db_connection_by_classifier_type_assignme
 		_ecm_db_connection_ref(cin);
 		tan->iteration_count++;
 		DEBUG_ASSERT(tan->iteration_count > 0, "Bad Iteration count: %d for type: %d, connection: %p\n", tan->iteration_count, ca_type, cin);
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		return cin;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return NULL;
 }
 EXPORT_SYMBOL(ecm_db_connection_by_classifier_type_assignment_get_and_ref_next);
@@ -6256,7 +6374,7 @@ void ecm_db_connection_by_classifier_type_assignment_deref(struct ecm_db_connect
 	/*
 	 * Drop the iteration count
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ta = &ci->type_assignment[ca_type];
 	DEBUG_CHECK_MAGIC(ta, ECM_DB_CLASSIFIER_TYPE_ASSIGNMENT_MAGIC, "%p: magic failed, ci: %p", ta, ci);
 	ta->iteration_count--;
@@ -6269,7 +6387,7 @@ void ecm_db_connection_by_classifier_type_assignment_deref(struct ecm_db_connect
 		DEBUG_INFO("%p: Remove type assignment: %d\n", ci, ca_type);
 		_ecm_db_classifier_type_assignment_remove(ci, ca_type);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	ecm_db_connection_deref(ci);
 }
 EXPORT_SYMBOL(ecm_db_connection_by_classifier_type_assignment_deref);
@@ -6339,13 +6457,13 @@ int32_t ecm_db_connection_from_interfaces_get_and_ref(struct ecm_db_connection_i
 	int32_t i;
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	n = ci->from_interface_first;
 	for (i = n; i < ECM_DB_IFACE_HEIRARCHY_MAX; ++i) {
 		interfaces[i] = ci->from_interfaces[i];
 		_ecm_db_iface_ref(interfaces[i]);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return n;
 }
 EXPORT_SYMBOL(ecm_db_connection_from_interfaces_get_and_ref);
@@ -6366,13 +6484,13 @@ int32_t ecm_db_connection_to_interfaces_get_and_ref(struct ecm_db_connection_ins
 	int32_t i;
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	n = ci->to_interface_first;
 	for (i = n; i < ECM_DB_IFACE_HEIRARCHY_MAX; ++i) {
 		interfaces[i] = ci->to_interfaces[i];
 		_ecm_db_iface_ref(interfaces[i]);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return n;
 }
 EXPORT_SYMBOL(ecm_db_connection_to_interfaces_get_and_ref);
@@ -6393,13 +6511,13 @@ int32_t ecm_db_connection_from_nat_interfaces_get_and_ref(struct ecm_db_connecti
 	int32_t i;
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	n = ci->from_nat_interface_first;
 	for (i = n; i < ECM_DB_IFACE_HEIRARCHY_MAX; ++i) {
 		interfaces[i] = ci->from_nat_interfaces[i];
 		_ecm_db_iface_ref(interfaces[i]);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return n;
 }
 EXPORT_SYMBOL(ecm_db_connection_from_nat_interfaces_get_and_ref);
@@ -6420,13 +6538,13 @@ int32_t ecm_db_connection_to_nat_interfaces_get_and_ref(struct ecm_db_connection
 	int32_t i;
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	n = ci->to_nat_interface_first;
 	for (i = n; i < ECM_DB_IFACE_HEIRARCHY_MAX; ++i) {
 		interfaces[i] = ci->to_nat_interfaces[i];
 		_ecm_db_iface_ref(interfaces[i]);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return n;
 }
 EXPORT_SYMBOL(ecm_db_connection_to_nat_interfaces_get_and_ref);
@@ -6483,7 +6601,7 @@ int ecm_db_multicast_connection_to_interfaces_reset(struct ecm_db_connection_ins
 	/*
 	 * Iterate the to interface list and add the new interface hierarchies
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 
 	for (heirarchy_index = 0; heirarchy_index < ECM_DB_MULTICAST_IF_MAX; heirarchy_index++) {
 		ii_temp = ecm_db_multicast_if_heirarchy_get(interfaces, heirarchy_index);
@@ -6519,7 +6637,7 @@ int ecm_db_multicast_connection_to_interfaces_reset(struct ecm_db_connection_ins
 	}
 
 	ci->to_mcast_interfaces_set = true;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	return 0;
 }
@@ -6551,7 +6669,7 @@ void ecm_db_multicast_connection_to_interfaces_update(struct ecm_db_connection_i
 	/*
 	 * Iterate the to interface list, adding in the new
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	for (heirarchy_index = 0, if_index = 0; heirarchy_index < ECM_DB_MULTICAST_IF_MAX; heirarchy_index++) {
 		ii_temp = ecm_db_multicast_if_heirarchy_get(interfaces, if_index);
 		join_first = ecm_db_multicast_if_first_get_at_index(mc_join_first, if_index);
@@ -6589,7 +6707,7 @@ void ecm_db_multicast_connection_to_interfaces_update(struct ecm_db_connection_i
 		}
 		if_index++;
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return;
 }
 EXPORT_SYMBOL(ecm_db_multicast_connection_to_interfaces_update);
@@ -6612,7 +6730,7 @@ void ecm_db_connection_from_interfaces_reset(struct ecm_db_connection_instance *
 	/*
 	 * Iterate the from interface list, removing the old and adding in the new
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	for (i = 0; i < ECM_DB_IFACE_HEIRARCHY_MAX; ++i) {
 		/*
 		 * Put any previous interface into the old list
@@ -6632,7 +6750,7 @@ void ecm_db_connection_from_interfaces_reset(struct ecm_db_connection_instance *
 	old_first = ci->from_interface_first;
 	ci->from_interface_first = new_first;
 	ci->from_interface_set = true;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Release old
@@ -6658,7 +6776,7 @@ void ecm_db_connection_to_interfaces_reset(struct ecm_db_connection_instance *ci
 	/*
 	 * Iterate the to interface list, removing the old and adding in the new
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	for (i = 0; i < ECM_DB_IFACE_HEIRARCHY_MAX; ++i) {
 		/*
 		 * Put any previous interface into the old list
@@ -6678,7 +6796,7 @@ void ecm_db_connection_to_interfaces_reset(struct ecm_db_connection_instance *ci
 	old_first = ci->to_interface_first;
 	ci->to_interface_first = new_first;
 	ci->to_interface_set = true;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Release old
@@ -6704,7 +6822,7 @@ void ecm_db_connection_from_nat_interfaces_reset(struct ecm_db_connection_instan
 	/*
 	 * Iterate the from nat interface list, removing the old and adding in the new
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	for (i = 0; i < ECM_DB_IFACE_HEIRARCHY_MAX; ++i) {
 		/*
 		 * Put any previous interface into the old list
@@ -6724,7 +6842,7 @@ void ecm_db_connection_from_nat_interfaces_reset(struct ecm_db_connection_instan
 	old_first = ci->from_nat_interface_first;
 	ci->from_nat_interface_first = new_first;
 	ci->from_nat_interface_set = true;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Release old
@@ -6750,7 +6868,7 @@ void ecm_db_connection_to_nat_interfaces_reset(struct ecm_db_connection_instance
 	/*
 	 * Iterate the to nat interface list, removing the old and adding in the new
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	for (i = 0; i < ECM_DB_IFACE_HEIRARCHY_MAX; ++i) {
 		/*
 		 * Put any previous interface into the old list
@@ -6770,7 +6888,7 @@ void ecm_db_connection_to_nat_interfaces_reset(struct ecm_db_connection_instance
 	old_first = ci->to_nat_interface_first;
 	ci->to_nat_interface_first = new_first;
 	ci->to_nat_interface_set = true;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Release old
@@ -6787,9 +6905,9 @@ int32_t ecm_db_connection_to_nat_interfaces_get_count(struct ecm_db_connection_i
 {
 	int32_t first;
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	first = ci->to_nat_interface_first;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return ECM_DB_IFACE_HEIRARCHY_MAX - first;
 }
 EXPORT_SYMBOL(ecm_db_connection_to_nat_interfaces_get_count);
@@ -6802,9 +6920,9 @@ int32_t ecm_db_connection_from_nat_interfaces_get_count(struct ecm_db_connection
 {
 	int32_t first;
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	first = ci->from_nat_interface_first;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return ECM_DB_IFACE_HEIRARCHY_MAX - first;
 }
 EXPORT_SYMBOL(ecm_db_connection_from_nat_interfaces_get_count);
@@ -6817,9 +6935,9 @@ int32_t ecm_db_connection_to_interfaces_get_count(struct ecm_db_connection_insta
 {
 	int32_t first;
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	first = ci->to_interface_first;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return ECM_DB_IFACE_HEIRARCHY_MAX - first;
 }
 EXPORT_SYMBOL(ecm_db_connection_to_interfaces_get_count);
@@ -6832,9 +6950,9 @@ int32_t ecm_db_connection_from_interfaces_get_count(struct ecm_db_connection_ins
 {
 	int32_t first;
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	first = ci->from_interface_first;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return ECM_DB_IFACE_HEIRARCHY_MAX - first;
 }
 EXPORT_SYMBOL(ecm_db_connection_from_interfaces_get_count);
@@ -6848,9 +6966,9 @@ bool ecm_db_connection_to_interfaces_set_check(struct ecm_db_connection_instance
 	bool set;
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	set = ci->to_interface_set;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return set;
 }
 EXPORT_SYMBOL(ecm_db_connection_to_interfaces_set_check);
@@ -6864,9 +6982,9 @@ bool ecm_db_connection_from_interfaces_set_check(struct ecm_db_connection_instan
 	bool set;
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	set = ci->from_interface_set;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return set;
 }
 EXPORT_SYMBOL(ecm_db_connection_from_interfaces_set_check);
@@ -6880,9 +6998,9 @@ bool ecm_db_connection_to_nat_interfaces_set_check(struct ecm_db_connection_inst
 	bool set;
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	set = ci->to_nat_interface_set;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return set;
 }
 EXPORT_SYMBOL(ecm_db_connection_to_nat_interfaces_set_check);
@@ -6896,9 +7014,9 @@ bool ecm_db_connection_from_nat_interfaces_set_check(struct ecm_db_connection_in
 	bool set;
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	set = ci->from_nat_interface_set;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return set;
 }
 EXPORT_SYMBOL(ecm_db_connection_from_nat_interfaces_set_check);
@@ -6915,7 +7033,7 @@ void ecm_db_connection_from_interfaces_clear(struct ecm_db_connection_instance *
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	for (i = ci->from_interface_first; i < ECM_DB_IFACE_HEIRARCHY_MAX; ++i) {
 		discard[i] = ci->from_interfaces[i];
 	}
@@ -6923,7 +7041,7 @@ void ecm_db_connection_from_interfaces_clear(struct ecm_db_connection_instance *
 	discard_first = ci->from_interface_first;
 	ci->from_interface_set = false;
 	ci->from_interface_first = ECM_DB_IFACE_HEIRARCHY_MAX;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Release previous
@@ -6944,7 +7062,7 @@ void ecm_db_connection_from_nat_interfaces_clear(struct ecm_db_connection_instan
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	for (i = ci->from_nat_interface_first; i < ECM_DB_IFACE_HEIRARCHY_MAX; ++i) {
 		discard[i] = ci->from_nat_interfaces[i];
 	}
@@ -6952,7 +7070,7 @@ void ecm_db_connection_from_nat_interfaces_clear(struct ecm_db_connection_instan
 	discard_first = ci->from_nat_interface_first;
 	ci->from_nat_interface_set = false;
 	ci->from_nat_interface_first = ECM_DB_IFACE_HEIRARCHY_MAX;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Release previous
@@ -6973,7 +7091,7 @@ void ecm_db_connection_to_interfaces_clear(struct ecm_db_connection_instance *ci
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	for (i = ci->to_interface_first; i < ECM_DB_IFACE_HEIRARCHY_MAX; ++i) {
 		discard[i] = ci->to_interfaces[i];
 	}
@@ -6981,7 +7099,7 @@ void ecm_db_connection_to_interfaces_clear(struct ecm_db_connection_instance *ci
 	discard_first = ci->to_interface_first;
 	ci->to_interface_set = false;
 	ci->to_interface_first = ECM_DB_IFACE_HEIRARCHY_MAX;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Release previous
@@ -7002,7 +7120,7 @@ void ecm_db_connection_to_nat_interfaces_clear(struct ecm_db_connection_instance
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	for (i = ci->to_nat_interface_first; i < ECM_DB_IFACE_HEIRARCHY_MAX; ++i) {
 		discard[i] = ci->to_nat_interfaces[i];
 	}
@@ -7010,7 +7128,7 @@ void ecm_db_connection_to_nat_interfaces_clear(struct ecm_db_connection_instance
 	discard_first = ci->to_nat_interface_first;
 	ci->to_nat_interface_set = false;
 	ci->to_nat_interface_first = ECM_DB_IFACE_HEIRARCHY_MAX;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Release previous
@@ -7072,9 +7190,9 @@ void ecm_db_connection_add(struct ecm_db_connection_instance *ci,
 	DEBUG_CHECK_MAGIC(to_nat_node, ECM_DB_NODE_INSTANCE_MAGIC, "%p: magic failed\n", to_nat_node);
 	DEBUG_ASSERT((protocol >= 0) && (protocol <= 255), "%p: invalid protocol number %d\n", ci, protocol);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	DEBUG_ASSERT(!(ci->flags & ECM_DB_CONNECTION_FLAGS_INSERTED), "%p: inserted\n", ci);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Record owner arg and callbacks
@@ -7145,7 +7263,7 @@ void ecm_db_connection_add(struct ecm_db_connection_instance *ci,
 	/*
 	 * Now we need to lock
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 
 	/*
 	 * Increment protocol counter stats
@@ -7180,7 +7298,7 @@ void ecm_db_connection_add(struct ecm_db_connection_instance *ci,
 	if (ecm_db_connection_table[hash_index]) {
 		ecm_db_connection_table[hash_index]->hash_prev = ci;
 	}
-	ecm_db_connection_table[hash_index] = ci;
+	rcu_assign_pointer(ecm_db_connection_table[hash_index], ci);
 	ecm_db_connection_table_lengths[hash_index]++;
 	DEBUG_ASSERT(ecm_db_connection_table_lengths[hash_index] > 0, "%p: invalid table len %d\n", ci, ecm_db_connection_table_lengths[hash_index]);
 
@@ -7191,7 +7309,7 @@ void ecm_db_connection_add(struct ecm_db_connection_instance *ci,
 	if (ecm_db_connection_serial_table[serial_hash_index]) {
 		ecm_db_connection_serial_table[serial_hash_index]->serial_hash_prev = ci;
 	}
-	ecm_db_connection_serial_table[serial_hash_index] = ci;
+	rcu_assign_pointer(ecm_db_connection_serial_table[serial_hash_index], ci);
 	ecm_db_connection_serial_table_lengths[serial_hash_index]++;
 	DEBUG_ASSERT(ecm_db_connection_serial_table_lengths[serial_hash_index] > 0, "%p: invalid table len %d\n", ci, ecm_db_connection_serial_table_lengths[serial_hash_index]);
 
@@ -7367,7 +7485,7 @@ void ecm_db_connection_add(struct ecm_db_connection_instance *ci,
 	 */
 	ci->generation = ecm_db_connection_generation;
 
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Throw add event to the listeners
@@ -7408,7 +7526,7 @@ void ecm_db_mapping_add(struct ecm_db_mapping_instance *mi, struct ecm_db_host_i
 	ecm_db_mapping_hash_t hash_index;
 	struct ecm_db_listener_instance *li;
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	DEBUG_CHECK_MAGIC(mi, ECM_DB_MAPPING_INSTANCE_MAGIC, "%p: magic failed\n", mi);
 	DEBUG_CHECK_MAGIC(hi, ECM_DB_HOST_INSTANCE_MAGIC, "%p: magic failed\n", hi);
 	DEBUG_ASSERT(!(mi->flags & ECM_DB_MAPPING_FLAGS_INSERTED), "%p: inserted\n", mi);
@@ -7419,7 +7537,7 @@ void ecm_db_mapping_add(struct ecm_db_mapping_instance *mi, struct ecm_db_host_i
 	DEBUG_ASSERT(mi->to_connections == NULL, "%p: connections not null\n", mi);
 	DEBUG_ASSERT(!mi->from && !mi->to && !mi->nat_from && !mi->nat_to, "%p: connection count errors\n", mi);
 #endif
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	mi->arg = arg;
 	mi->final = final;
@@ -7444,7 +7562,7 @@ void ecm_db_mapping_add(struct ecm_db_mapping_instance *mi, struct ecm_db_host_i
 	/*
 	 * Set time
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	mi->time_added = ecm_db_time;
 
 	/*
@@ -7469,7 +7587,7 @@ void ecm_db_mapping_add(struct ecm_db_mapping_instance *mi, struct ecm_db_host_i
 	if (ecm_db_mapping_table[hash_index]) {
 		ecm_db_mapping_table[hash_index]->hash_prev = mi;
 	}
-	ecm_db_mapping_table[hash_index] = mi;
+	rcu_assign_pointer(ecm_db_mapping_table[hash_index], mi);
 	ecm_db_mapping_table_lengths[hash_index]++;
 	DEBUG_ASSERT(ecm_db_mapping_table_lengths[hash_index] > 0, "%p: invalid table len %d\n", hi, ecm_db_mapping_table_lengths[hash_index]);
 
@@ -7485,7 +7603,7 @@ void ecm_db_mapping_add(struct ecm_db_mapping_instance *mi, struct ecm_db_host_i
 	hi->mappings = mi;
 	hi->mapping_count++;
 #endif
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Throw add event to the listeners
@@ -7517,13 +7635,13 @@ void ecm_db_host_add(struct ecm_db_host_instance *hi, ip_addr_t address, bool on
 	ecm_db_host_hash_t hash_index;
 	struct ecm_db_listener_instance *li;
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	DEBUG_CHECK_MAGIC(hi, ECM_DB_HOST_INSTANCE_MAGIC, "%p: magic failed\n", hi);
 	DEBUG_ASSERT(!(hi->flags & ECM_DB_HOST_FLAGS_INSERTED), "%p: inserted\n", hi);
 #ifdef ECM_DB_XREF_ENABLE
 	DEBUG_ASSERT((hi->mappings == NULL) && (hi->mapping_count == 0), "%p: mappings not null\n", hi);
 #endif
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	hi->arg = arg;
 	hi->final = final;
@@ -7539,7 +7657,7 @@ void ecm_db_host_add(struct ecm_db_host_instance *hi, ip_addr_t address, bool on
 	/*
 	 * Add into the global list
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	hi->flags |= ECM_DB_HOST_FLAGS_INSERTED;
 	hi->prev = NULL;
 	hi->next = ecm_db_hosts;
@@ -7555,7 +7673,7 @@ void ecm_db_host_add(struct ecm_db_host_instance *hi, ip_addr_t address, bool on
 	if (ecm_db_host_table[hash_index]) {
 		ecm_db_host_table[hash_index]->hash_prev = hi;
 	}
-	ecm_db_host_table[hash_index] = hi;
+	rcu_assign_pointer(ecm_db_host_table[hash_index], hi);
 	ecm_db_host_table_lengths[hash_index]++;
 	DEBUG_ASSERT(ecm_db_host_table_lengths[hash_index] > 0, "%p: invalid table len %d\n", hi, ecm_db_host_table_lengths[hash_index]);
 
@@ -7563,7 +7681,7 @@ void ecm_db_host_add(struct ecm_db_host_instance *hi, ip_addr_t address, bool on
 	 * Set time of add
 	 */
 	hi->time_added = ecm_db_time;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Throw add event to the listeners
@@ -7596,7 +7714,7 @@ void ecm_db_node_add(struct ecm_db_node_instance *ni, struct ecm_db_iface_instan
 	ecm_db_node_hash_t hash_index;
 	struct ecm_db_listener_instance *li;
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	DEBUG_CHECK_MAGIC(ni, ECM_DB_NODE_INSTANCE_MAGIC, "%p: magic failed\n", ni);
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
 	DEBUG_ASSERT(address, "%p: address null\n", ni);
@@ -7608,7 +7726,7 @@ void ecm_db_node_add(struct ecm_db_node_instance *ni, struct ecm_db_iface_instan
 	DEBUG_ASSERT((ni->from_nat_connections == NULL) && (ni->from_nat_connections_count == 0), "%p: from_nat_connections not null\n", ni);
 	DEBUG_ASSERT((ni->to_nat_connections == NULL) && (ni->to_nat_connections_count == 0), "%p: to_nat_connections not null\n", ni);
 #endif
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	memcpy(ni->address, address, ETH_ALEN);
 	ni->arg = arg;
@@ -7629,7 +7747,7 @@ void ecm_db_node_add(struct ecm_db_node_instance *ni, struct ecm_db_iface_instan
 	/*
 	 * Add into the global list
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ni->flags |= ECM_DB_NODE_FLAGS_INSERTED;
 	ni->prev = NULL;
 	ni->next = ecm_db_nodes;
@@ -7645,7 +7763,7 @@ void ecm_db_node_add(struct ecm_db_node_instance *ni, struct ecm_db_iface_instan
 	if (ecm_db_node_table[hash_index]) {
 		ecm_db_node_table[hash_index]->hash_prev = ni;
 	}
-	ecm_db_node_table[hash_index] = ni;
+	rcu_assign_pointer(ecm_db_node_table[hash_index], ni);
 	ecm_db_node_table_lengths[hash_index]++;
 	DEBUG_ASSERT(ecm_db_node_table_lengths[hash_index] > 0, "%p: invalid table len %d\n", ni, ecm_db_node_table_lengths[hash_index]);
 
@@ -7666,7 +7784,7 @@ void ecm_db_node_add(struct ecm_db_node_instance *ni, struct ecm_db_iface_instan
 	ii->nodes = ni;
 	ii->node_count++;
 #endif
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Throw add event to the listeners
@@ -7773,10 +7891,10 @@ static int ecm_db_iface_state_get_base(struct ecm_db_iface_instance *ii, struct
 	type = ii->type;
 	interface_identifier = ii->interface_identifier;
 	ae_interface_identifier = ii->ae_interface_identifier;
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	strcpy(name, ii->name);
 	mtu = ii->mtu;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 #ifdef ECM_DB_ADVANCED_STATS_ENABLE
 	ecm_db_iface_data_stats_get(ii, &from_data_total, &to_data_total,
@@ -7835,9 +7953,9 @@ static int ecm_db_iface_ethernet_state_get(struct ecm_db_iface_instance *ii, str
 	uint8_t address[ETH_ALEN];
 
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	memcpy(address, ii->type_info.ethernet.address, ETH_ALEN);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	if ((result = ecm_state_prefix_add(sfi, "ethernet"))) {
 		return result;
@@ -7865,9 +7983,9 @@ static int ecm_db_iface_lag_state_get(struct ecm_db_iface_instance *ii, struct e
 	uint8_t address[ETH_ALEN];
 
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	memcpy(address, ii->type_info.lag.address, ETH_ALEN);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	if ((result = ecm_state_prefix_add(sfi, "lag"))) {
 		return result;
@@ -7894,9 +8012,9 @@ static int ecm_db_iface_bridge_state_get(struct ecm_db_iface_instance *ii, struc
 	uint8_t address[ETH_ALEN];
 
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	memcpy(address, ii->type_info.bridge.address, ETH_ALEN);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	if ((result = ecm_state_prefix_add(sfi, "bridge"))) {
 		return result;
@@ -7925,11 +8043,11 @@ static int ecm_db_iface_vlan_state_get(struct ecm_db_iface_instance *ii, struct
 	uint16_t vlan_tpid;
 
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	memcpy(address, ii->type_info.vlan.address, ETH_ALEN);
 	vlan_tag = ii->type_info.vlan.vlan_tag;
 	vlan_tpid = ii->type_info.vlan.vlan_tpid;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	if ((result = ecm_state_prefix_add(sfi, "vlan"))) {
 		return result;
@@ -7964,10 +8082,10 @@ static int ecm_db_iface_pppoe_state_get(struct ecm_db_iface_instance *ii, struct
 	uint8_t remote_mac[ETH_ALEN];
 
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	pppoe_session_id = ii->type_info.pppoe.pppoe_session_id;
 	memcpy(remote_mac, ii->type_info.pppoe.remote_mac, ETH_ALEN);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	if ((result = ecm_state_prefix_add(sfi, "pppoe"))) {
 		return result;
@@ -7998,9 +8116,9 @@ static int ecm_db_iface_map_t_state_get(struct ecm_db_iface_instance *ii, struct
 	int32_t if_index;
 
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	if_index = ii->type_info.map_t.if_index;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	if ((result = ecm_state_prefix_add(sfi, "map_t"))) {
 		return result;
@@ -8029,9 +8147,9 @@ static int ecm_db_iface_pppol2tpv2_state_get(struct ecm_db_iface_instance *ii, s
 	struct ecm_db_interface_info_pppol2tpv2 type_info;
 
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	memcpy(&type_info, &ii->type_info, sizeof(struct ecm_db_interface_info_pppol2tpv2));
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	if ((result = ecm_state_prefix_add(sfi, "pppol2tpv2"))) {
 		return result;
@@ -8073,9 +8191,9 @@ static int ecm_db_iface_pptp_state_get(struct ecm_db_iface_instance *ii, struct
 	struct ecm_db_interface_info_pptp type_info;
 
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	memcpy(&type_info, &ii->type_info, sizeof(struct ecm_db_interface_info_pptp));
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	result = ecm_state_prefix_add(sfi, "pptp");
 	if (result) {
@@ -8111,9 +8229,9 @@ static int ecm_db_iface_unknown_state_get(struct ecm_db_iface_instance *ii, stru
 	uint32_t os_specific_ident;
 
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	os_specific_ident = ii->type_info.unknown.os_specific_ident;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	if ((result = ecm_state_prefix_add(sfi, "pppoe"))) {
 		return result;
@@ -8139,9 +8257,9 @@ static int ecm_db_iface_loopback_state_get(struct ecm_db_iface_instance *ii, str
 	uint32_t os_specific_ident;
 
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	os_specific_ident = ii->type_info.loopback.os_specific_ident;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	if ((result = ecm_state_prefix_add(sfi, "loopback"))) {
 		return result;
@@ -8170,9 +8288,9 @@ static int ecm_db_iface_ipsec_tunnel_state_get(struct ecm_db_iface_instance *ii,
 	uint32_t os_specific_ident;
 
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	os_specific_ident = ii->type_info.ipsec_tunnel.os_specific_ident;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	if ((result = ecm_state_prefix_add(sfi, "ipsec"))) {
 		return result;
@@ -8201,9 +8319,9 @@ static int ecm_db_iface_tunipip6_state_get(struct ecm_db_iface_instance *ii, str
 	uint32_t os_specific_ident;
 
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	os_specific_ident = ii->type_info.ipsec_tunnel.os_specific_ident;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	if ((result = ecm_state_prefix_add(sfi, "tunipip6"))) {
 		return result;
@@ -8232,9 +8350,9 @@ static int ecm_db_iface_sit_state_get(struct ecm_db_iface_instance *ii, struct e
 	uint32_t os_specific_ident;
 
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	os_specific_ident = ii->type_info.ipsec_tunnel.os_specific_ident;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	if ((result = ecm_state_prefix_add(sfi, "sit"))) {
 		return result;
@@ -8411,11 +8529,11 @@ int ecm_db_connection_state_get(struct ecm_state_file_instance *sfi, struct ecm_
 	/*
 	 * Identify expiration
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	if (ci->defunct_timer.group == ECM_DB_TIMER_GROUPS_MAX) {
 		expires_in = -1;
 	} else {
-		expires_in = (long int)(ci->defunct_timer.timeout - ecm_db_time);
+		expires_in = (long int)(_ecm_db_timer_group_entry_expires(&ci->defunct_timer) - ecm_db_time);
 		if (expires_in <= 0) {
 			expires_in = 0;
 		}
@@ -8429,7 +8547,7 @@ int ecm_db_connection_state_get(struct ecm_state_file_instance *sfi, struct ecm_
 	generation = ci->generation;
 	global_generation = ecm_db_connection_generation;
 
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Extract information from the connection for inclusion into the message
@@ -8958,12 +9076,12 @@ int ecm_db_node_state_get(struct ecm_state_file_instance *sfi, struct ecm_db_nod
 	 * Extract information from the node for inclusion into the message
 	 */
 #ifdef ECM_DB_XREF_ENABLE
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	from_connections_count = ni->from_connections_count;
 	to_connections_count = ni->to_connections_count;
 	from_nat_connections_count = ni->from_nat_connections_count;
 	to_nat_connections_count = ni->to_nat_connections_count;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 #endif
 	time_added = ni->time_added;
 	snprintf(address, sizeof(address), "%pM", ni->address);
@@ -9020,9 +9138,9 @@ int ecm_db_connection_hash_table_lengths_get(int index)
 	int length;
 
 	DEBUG_ASSERT((index >= 0) && (index < ECM_DB_MAPPING_HASH_SLOTS), "Bad protocol: %d\n", index);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	length = ecm_db_connection_table_lengths[index];
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return length;
 }
 EXPORT_SYMBOL(ecm_db_connection_hash_table_lengths_get);
@@ -9060,9 +9178,9 @@ int ecm_db_mapping_hash_table_lengths_get(int index)
 	int length;
 
 	DEBUG_ASSERT((index >= 0) && (index < ECM_DB_MAPPING_HASH_SLOTS), "Bad protocol: %d\n", index);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	length = ecm_db_mapping_table_lengths[index];
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return length;
 }
 EXPORT_SYMBOL(ecm_db_mapping_hash_table_lengths_get);
@@ -9100,9 +9218,9 @@ int ecm_db_host_hash_table_lengths_get(int index)
 	int length;
 
 	DEBUG_ASSERT((index >= 0) && (index < ECM_DB_HOST_HASH_SLOTS), "Bad protocol: %d\n", index);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	length = ecm_db_host_table_lengths[index];
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return length;
 }
 EXPORT_SYMBOL(ecm_db_host_hash_table_lengths_get);
@@ -9140,9 +9258,9 @@ int ecm_db_node_hash_table_lengths_get(int index)
 	int length;
 
 	DEBUG_ASSERT((index >= 0) && (index < ECM_DB_NODE_HASH_SLOTS), "Bad protocol: %d\n", index);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	length = ecm_db_node_table_lengths[index];
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return length;
 }
 EXPORT_SYMBOL(ecm_db_node_hash_table_lengths_get);
@@ -9180,9 +9298,9 @@ int ecm_db_iface_hash_table_lengths_get(int index)
 	int length;
 
 	DEBUG_ASSERT((index >= 0) && (index < ECM_DB_IFACE_HASH_SLOTS), "Bad protocol: %d\n", index);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	length = ecm_db_iface_table_lengths[index];
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return length;
 }
 EXPORT_SYMBOL(ecm_db_iface_hash_table_lengths_get);
@@ -9234,6 +9352,87 @@ int ecm_db_protocol_get_first(void)
 	return 0;
 }
 EXPORT_SYMBOL(ecm_db_protocol_get_first);
+
+/*
+ * ecm_db_connection_export_addr()
+ *	Convert an address to the network byte order form used by the binary export
+ */
+static void ecm_db_connection_export_addr(__be32 *nin, ip_addr_t addr, int ip_version)
+{
+	if (ip_version == 4) {
+		ECM_IP_ADDR_TO_NIN4_ADDR(nin[0], addr);
+		return;
+	}
+
+	nin[0] = htonl(addr[3]);
+	nin[1] = htonl(addr[2]);
+	nin[2] = htonl(addr[1]);
+	nin[3] = htonl(addr[0]);
+}
+
+/*
+ * ecm_db_connections_export()
+ *	Fill in binary export records for up to max_records connections
+ *
+ * All records are filled in under a single hold of the database lock.
+ * Returns the number of records filled in, truncated is set when there were more connections than records.
+ */
+int ecm_db_connections_export(struct ecm_state_export_conn *records, int max_records, bool *truncated)
+{
+	struct ecm_db_connection_instance *ci;
+	struct ecm_state_export_conn *rec = records;
+	int num_records = 0;
+
+	*truncated = false;
+
+	ecm_db_lock_bh();
+	for (ci = ecm_db_connections; ci; ci = ci->next) {
+		DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed", ci);
+
+		if (num_records == max_records) {
+			*truncated = true;
+			break;
+		}
+
+		ecm_db_connection_export_addr(rec->from_ip, ci->mapping_from->host->address, ci->ip_version);
+		ecm_db_connection_export_addr(rec->from_ip_nat, ci->mapping_nat_from->host->address, ci->ip_version);
+		ecm_db_connection_export_addr(rec->to_ip, ci->mapping_to->host->address, ci->ip_version);
+		ecm_db_connection_export_addr(rec->to_ip_nat, ci->mapping_nat_to->host->address, ci->ip_version);
+		rec->from_port = ci->mapping_from->port;
+		rec->from_port_nat = ci->mapping_nat_from->port;
+		rec->to_port = ci->mapping_to->port;
+		rec->to_port_nat = ci->mapping_nat_to->port;
+		rec->serial = ci->serial;
+
+		rec->from_ifindex = -1;
+		if (ci->from_interface_first < ECM_DB_IFACE_HEIRARCHY_MAX) {
+			rec->from_ifindex = ci->from_interfaces[ci->from_interface_first]->interface_identifier;
+		}
+		rec->to_ifindex = -1;
+		if (ci->to_interface_first < ECM_DB_IFACE_HEIRARCHY_MAX) {
+			rec->to_ifindex = ci->to_interfaces[ci->to_interface_first]->interface_identifier;
+		}
+
+		rec->age = ecm_db_time - ci->time_added;
+		rec->ip_version = ci->ip_version;
+		rec->protocol = ci->protocol;
+		rec->direction = ci->direction;
+		rec->is_routed = ci->is_routed;
+		rec->from_data_total = ci->from_data_total;
+		rec->to_data_total = ci->to_data_total;
+		rec->from_packet_total = ci->from_packet_total;
+		rec->to_packet_total = ci->to_packet_total;
+		rec->from_packet_total_dropped = ci->from_packet_total_dropped;
+		rec->to_packet_total_dropped = ci->to_packet_total_dropped;
+
+		rec++;
+		num_records++;
+	}
+	ecm_db_unlock_bh();
+
+	return num_records;
+}
+EXPORT_SYMBOL(ecm_db_connections_export);
 #endif
 
 /*
@@ -9249,7 +9448,7 @@ void ecm_db_iface_add_ethernet(struct ecm_db_iface_instance *ii, uint8_t *addres
 	struct ecm_db_listener_instance *li;
 	struct ecm_db_interface_info_ethernet *type_info;
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
 	DEBUG_ASSERT(address, "%p: address null\n", ii);
 #ifdef ECM_DB_XREF_ENABLE
@@ -9257,7 +9456,7 @@ void ecm_db_iface_add_ethernet(struct ecm_db_iface_instance *ii, uint8_t *addres
 #endif
 	DEBUG_ASSERT(!(ii->flags & ECM_DB_IFACE_FLAGS_INSERTED), "%p: inserted\n", ii);
 	DEBUG_ASSERT(name, "%p: no name given\n", ii);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Record general info
@@ -9291,7 +9490,7 @@ void ecm_db_iface_add_ethernet(struct ecm_db_iface_instance *ii, uint8_t *addres
 	/*
 	 * Add into the global list
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii->flags |= ECM_DB_IFACE_FLAGS_INSERTED;
 	ii->prev = NULL;
 	ii->next = ecm_db_interfaces;
@@ -9328,7 +9527,7 @@ void ecm_db_iface_add_ethernet(struct ecm_db_iface_instance *ii, uint8_t *addres
 	 * Set time of addition
 	 */
 	ii->time_added = ecm_db_time;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Throw add event to the listeners
@@ -9365,7 +9564,7 @@ void ecm_db_iface_add_lag(struct ecm_db_iface_instance *ii, uint8_t *address, ch
 	struct ecm_db_listener_instance *li;
 	struct ecm_db_interface_info_lag *type_info;
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
 	DEBUG_ASSERT(address, "%p: address null\n", ii);
 #ifdef ECM_DB_XREF_ENABLE
@@ -9373,7 +9572,7 @@ void ecm_db_iface_add_lag(struct ecm_db_iface_instance *ii, uint8_t *address, ch
 #endif
 	DEBUG_ASSERT(!(ii->flags & ECM_DB_IFACE_FLAGS_INSERTED), "%p: inserted\n", ii);
 	DEBUG_ASSERT(name, "%p: no name given\n", ii);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Record general info
@@ -9407,7 +9606,7 @@ void ecm_db_iface_add_lag(struct ecm_db_iface_instance *ii, uint8_t *address, ch
 	/*
 	 * Add into the global list
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii->flags |= ECM_DB_IFACE_FLAGS_INSERTED;
 	ii->prev = NULL;
 	ii->next = ecm_db_interfaces;
@@ -9444,7 +9643,7 @@ void ecm_db_iface_add_lag(struct ecm_db_iface_instance *ii, uint8_t *address, ch
 	 * Set time of addition
 	 */
 	ii->time_added = ecm_db_time;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Throw add event to the listeners
@@ -9481,7 +9680,7 @@ void ecm_db_iface_add_bridge(struct ecm_db_iface_instance *ii, uint8_t *address,
 	struct ecm_db_listener_instance *li;
 	struct ecm_db_interface_info_bridge *type_info;
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
 	DEBUG_ASSERT(address, "%p: address null\n", ii);
 #ifdef ECM_DB_XREF_ENABLE
@@ -9489,7 +9688,7 @@ void ecm_db_iface_add_bridge(struct ecm_db_iface_instance *ii, uint8_t *address,
 #endif
 	DEBUG_ASSERT(!(ii->flags & ECM_DB_IFACE_FLAGS_INSERTED), "%p: inserted\n", ii);
 	DEBUG_ASSERT(name, "%p: no name given\n", ii);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Record general info
@@ -9523,7 +9722,7 @@ void ecm_db_iface_add_bridge(struct ecm_db_iface_instance *ii, uint8_t *address,
 	/*
 	 * Add into the global list
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii->flags |= ECM_DB_IFACE_FLAGS_INSERTED;
 	ii->prev = NULL;
 	ii->next = ecm_db_interfaces;
@@ -9560,7 +9759,7 @@ void ecm_db_iface_add_bridge(struct ecm_db_iface_instance *ii, uint8_t *address,
 	 * Set time of addition
 	 */
 	ii->time_added = ecm_db_time;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Throw add event to the listeners
@@ -9597,7 +9796,7 @@ void ecm_db_iface_add_vlan(struct ecm_db_iface_instance *ii, uint8_t *address, u
 	struct ecm_db_listener_instance *li;
 	struct ecm_db_interface_info_vlan *type_info;
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
 	DEBUG_ASSERT(address, "%p: address null\n", ii);
 #ifdef ECM_DB_XREF_ENABLE
@@ -9605,7 +9804,7 @@ void ecm_db_iface_add_vlan(struct ecm_db_iface_instance *ii, uint8_t *address, u
 #endif
 	DEBUG_ASSERT(!(ii->flags & ECM_DB_IFACE_FLAGS_INSERTED), "%p: inserted\n", ii);
 	DEBUG_ASSERT(name, "%p: no name given\n", ii);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Record general info
@@ -9641,7 +9840,7 @@ void ecm_db_iface_add_vlan(struct ecm_db_iface_instance *ii, uint8_t *address, u
 	/*
 	 * Add into the global list
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii->flags |= ECM_DB_IFACE_FLAGS_INSERTED;
 	ii->prev = NULL;
 	ii->next = ecm_db_interfaces;
@@ -9678,7 +9877,7 @@ void ecm_db_iface_add_vlan(struct ecm_db_iface_instance *ii, uint8_t *address, u
 	 * Set time of addition
 	 */
 	ii->time_added = ecm_db_time;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Throw add event to the listeners
@@ -9717,14 +9916,14 @@ void ecm_db_iface_add_map_t(struct ecm_db_iface_instance *ii, struct ecm_db_inte
 	struct ecm_db_listener_instance *li;
 	struct ecm_db_interface_info_map_t *type_info;
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
 #ifdef ECM_DB_XREF_ENABLE
 	DEBUG_ASSERT((ii->nodes == NULL) && (ii->node_count == 0), "%p: nodes not null\n", ii);
 #endif
 	DEBUG_ASSERT(!(ii->flags & ECM_DB_IFACE_FLAGS_INSERTED), "%p: inserted\n", ii);
 	DEBUG_ASSERT(name, "%p: no name given\n", ii);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Record general info
@@ -9757,7 +9956,7 @@ void ecm_db_iface_add_map_t(struct ecm_db_iface_instance *ii, struct ecm_db_inte
 	/*
 	 * Add into the global list
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii->flags |= ECM_DB_IFACE_FLAGS_INSERTED;
 	ii->prev = NULL;
 	ii->next = ecm_db_interfaces;
@@ -9794,7 +9993,7 @@ void ecm_db_iface_add_map_t(struct ecm_db_iface_instance *ii, struct ecm_db_inte
 	 * Set time of addition
 	 */
 	ii->time_added = ecm_db_time;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Throw add event to the listeners
@@ -9833,14 +10032,14 @@ void ecm_db_iface_add_pppoe(struct ecm_db_iface_instance *ii, uint16_t pppoe_ses
 	struct ecm_db_listener_instance *li;
 	struct ecm_db_interface_info_pppoe *type_info;
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
 #ifdef ECM_DB_XREF_ENABLE
 	DEBUG_ASSERT((ii->nodes == NULL) && (ii->node_count == 0), "%p: nodes not null\n", ii);
 #endif
 	DEBUG_ASSERT(!(ii->flags & ECM_DB_IFACE_FLAGS_INSERTED), "%p: inserted\n", ii);
 	DEBUG_ASSERT(name, "%p: no name given\n", ii);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Record general info
@@ -9875,7 +10074,7 @@ void ecm_db_iface_add_pppoe(struct ecm_db_iface_instance *ii, uint16_t pppoe_ses
 	/*
 	 * Add into the global list
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii->flags |= ECM_DB_IFACE_FLAGS_INSERTED;
 	ii->prev = NULL;
 	ii->next = ecm_db_interfaces;
@@ -9912,7 +10111,7 @@ void ecm_db_iface_add_pppoe(struct ecm_db_iface_instance *ii, uint16_t pppoe_ses
 	 * Set time of addition
 	 */
 	ii->time_added = ecm_db_time;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Throw add event to the listeners
@@ -9951,14 +10150,14 @@ void ecm_db_iface_add_pppol2tpv2(struct ecm_db_iface_instance *ii, struct ecm_db
 	struct ecm_db_listener_instance *li;
 	struct ecm_db_interface_info_pppol2tpv2 *type_info;
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
 #ifdef ECM_DB_XREF_ENABLE
 	DEBUG_ASSERT((ii->nodes == NULL) && (ii->node_count == 0), "%p: nodes not null\n", ii);
 #endif
 	DEBUG_ASSERT(!(ii->flags & ECM_DB_IFACE_FLAGS_INSERTED), "%p: inserted\n", ii);
 	DEBUG_ASSERT(name, "%p: no name given\n", ii);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Record general info
@@ -9992,7 +10191,7 @@ void ecm_db_iface_add_pppol2tpv2(struct ecm_db_iface_instance *ii, struct ecm_db
 	/*
 	 * Add into the global list
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii->flags |= ECM_DB_IFACE_FLAGS_INSERTED;
 	ii->prev = NULL;
 	ii->next = ecm_db_interfaces;
@@ -10029,7 +10228,7 @@ void ecm_db_iface_add_pppol2tpv2(struct ecm_db_iface_instance *ii, struct ecm_db
 	 * Set time of addition
 	 */
 	ii->time_added = ecm_db_time;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Throw add event to the listeners
@@ -10070,13 +10269,13 @@ void ecm_db_iface_add_pptp(struct ecm_db_iface_instance *ii, struct ecm_db_inter
 	struct ecm_db_interface_info_pptp *type_info;
 
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 #ifdef ECM_DB_XREF_ENABLE
 	DEBUG_ASSERT((ii->nodes == NULL) && (ii->node_count == 0), "%p: nodes not null\n", ii);
 #endif
 	DEBUG_ASSERT(!(ii->flags & ECM_DB_IFACE_FLAGS_INSERTED), "%p: inserted\n", ii);
 	DEBUG_ASSERT(name, "%p: no name given\n", ii);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Record general info
@@ -10110,7 +10309,7 @@ void ecm_db_iface_add_pptp(struct ecm_db_iface_instance *ii, struct ecm_db_inter
 	/*
 	 * Add into the global list
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii->flags |= ECM_DB_IFACE_FLAGS_INSERTED;
 	ii->prev = NULL;
 	ii->next = ecm_db_interfaces;
@@ -10147,7 +10346,7 @@ void ecm_db_iface_add_pptp(struct ecm_db_iface_instance *ii, struct ecm_db_inter
 	 * Set time of addition
 	 */
 	ii->time_added = ecm_db_time;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Throw add event to the listeners
@@ -10184,14 +10383,14 @@ void ecm_db_iface_add_unknown(struct ecm_db_iface_instance *ii, uint32_t os_spec
 	struct ecm_db_listener_instance *li;
 	struct ecm_db_interface_info_unknown *type_info;
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
 #ifdef ECM_DB_XREF_ENABLE
 	DEBUG_ASSERT((ii->nodes == NULL) && (ii->node_count == 0), "%p: nodes not null\n", ii);
 #endif
 	DEBUG_ASSERT(!(ii->flags & ECM_DB_IFACE_FLAGS_INSERTED), "%p: inserted\n", ii);
 	DEBUG_ASSERT(name, "%p: no name given\n", ii);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Record general info
@@ -10225,7 +10424,7 @@ void ecm_db_iface_add_unknown(struct ecm_db_iface_instance *ii, uint32_t os_spec
 	/*
 	 * Add into the global list
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii->flags |= ECM_DB_IFACE_FLAGS_INSERTED;
 	ii->prev = NULL;
 	ii->next = ecm_db_interfaces;
@@ -10262,7 +10461,7 @@ void ecm_db_iface_add_unknown(struct ecm_db_iface_instance *ii, uint32_t os_spec
 	 * Set time of addition
 	 */
 	ii->time_added = ecm_db_time;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Throw add event to the listeners
@@ -10298,14 +10497,14 @@ void ecm_db_iface_add_loopback(struct ecm_db_iface_instance *ii, uint32_t os_spe
 	struct ecm_db_listener_instance *li;
 	struct ecm_db_interface_info_loopback *type_info;
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
 #ifdef ECM_DB_XREF_ENABLE
 	DEBUG_ASSERT((ii->nodes == NULL) && (ii->node_count == 0), "%p: nodes not null\n", ii);
 #endif
 	DEBUG_ASSERT(!(ii->flags & ECM_DB_IFACE_FLAGS_INSERTED), "%p: inserted\n", ii);
 	DEBUG_ASSERT(name, "%p: no name given\n", ii);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Record general info
@@ -10339,7 +10538,7 @@ void ecm_db_iface_add_loopback(struct ecm_db_iface_instance *ii, uint32_t os_spe
 	/*
 	 * Add into the global list
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii->flags |= ECM_DB_IFACE_FLAGS_INSERTED;
 	ii->prev = NULL;
 	ii->next = ecm_db_interfaces;
@@ -10376,7 +10575,7 @@ void ecm_db_iface_add_loopback(struct ecm_db_iface_instance *ii, uint32_t os_spe
 	 * Set time of addition
 	 */
 	ii->time_added = ecm_db_time;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Throw add event to the listeners
@@ -10422,14 +10621,14 @@ void ecm_db_iface_add_sit(struct ecm_db_iface_instance *ii, struct ecm_db_interf
 	ecm_db_iface_id_hash_t iface_id_hash_index;
 	struct ecm_db_listener_instance *li;
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
 #ifdef ECM_DB_XREF_ENABLE
 	DEBUG_ASSERT((ii->nodes == NULL) && (ii->node_count == 0), "%p: nodes not null\n", ii);
 #endif
 	DEBUG_ASSERT(!(ii->flags & ECM_DB_IFACE_FLAGS_INSERTED), "%p: inserted\n", ii);
 	DEBUG_ASSERT(name, "%p: no name given\n", ii);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Record general info
@@ -10462,7 +10661,7 @@ void ecm_db_iface_add_sit(struct ecm_db_iface_instance *ii, struct ecm_db_interf
 	/*
 	 * Add into the global list
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii->flags |= ECM_DB_IFACE_FLAGS_INSERTED;
 	ii->prev = NULL;
 	ii->next = ecm_db_interfaces;
@@ -10499,7 +10698,7 @@ void ecm_db_iface_add_sit(struct ecm_db_iface_instance *ii, struct ecm_db_interf
 	 * Set time of addition
 	 */
 	ii->time_added = ecm_db_time;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Throw add event to the listeners
@@ -10537,14 +10736,14 @@ void ecm_db_iface_add_tunipip6(struct ecm_db_iface_instance *ii, struct ecm_db_i
 	ecm_db_iface_id_hash_t iface_id_hash_index;
 	struct ecm_db_listener_instance *li;
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
 #ifdef ECM_DB_XREF_ENABLE
 	DEBUG_ASSERT((ii->nodes == NULL) && (ii->node_count == 0), "%p: nodes not null\n", ii);
 #endif
 	DEBUG_ASSERT(!(ii->flags & ECM_DB_IFACE_FLAGS_INSERTED), "%p: inserted\n", ii);
 	DEBUG_ASSERT(name, "%p: no name given\n", ii);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Record general info
@@ -10577,7 +10776,7 @@ void ecm_db_iface_add_tunipip6(struct ecm_db_iface_instance *ii, struct ecm_db_i
 	/*
 	 * Add into the global list
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii->flags |= ECM_DB_IFACE_FLAGS_INSERTED;
 	ii->prev = NULL;
 	ii->next = ecm_db_interfaces;
@@ -10614,7 +10813,7 @@ void ecm_db_iface_add_tunipip6(struct ecm_db_iface_instance *ii, struct ecm_db_i
 	 * Set time of addition
 	 */
 	ii->time_added = ecm_db_time;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Throw add event to the listeners
@@ -10655,14 +10854,14 @@ void ecm_db_iface_add_ipsec_tunnel(struct ecm_db_iface_instance *ii, uint32_t os
 	struct ecm_db_listener_instance *li;
 	struct ecm_db_interface_info_ipsec_tunnel *type_info;
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	DEBUG_CHECK_MAGIC(ii, ECM_DB_IFACE_INSTANCE_MAGIC, "%p: magic failed\n", ii);
 #ifdef ECM_DB_XREF_ENABLE
 	DEBUG_ASSERT((ii->nodes == NULL) && (ii->node_count == 0), "%p: nodes not null\n", ii);
 #endif
 	DEBUG_ASSERT(!(ii->flags & ECM_DB_IFACE_FLAGS_INSERTED), "%p: inserted\n", ii);
 	DEBUG_ASSERT(name, "%p: no name given\n", ii);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Record general info
@@ -10696,7 +10895,7 @@ void ecm_db_iface_add_ipsec_tunnel(struct ecm_db_iface_instance *ii, uint32_t os
 	/*
 	 * Add into the global list
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ii->flags |= ECM_DB_IFACE_FLAGS_INSERTED;
 	ii->prev = NULL;
 	ii->next = ecm_db_interfaces;
@@ -10733,7 +10932,7 @@ void ecm_db_iface_add_ipsec_tunnel(struct ecm_db_iface_instance *ii, uint32_t os
 	 * Set time of addition
 	 */
 	ii->time_added = ecm_db_time;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	/*
 	 * Throw add event to the listeners
@@ -10775,10 +10974,10 @@ void ecm_db_listener_add(struct ecm_db_listener_instance *li,
 							ecm_db_listener_final_callback_t final,
 							void *arg)
 {
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	DEBUG_CHECK_MAGIC(li, ECM_DB_LISTENER_INSTANCE_MAGIC, "%p: magic failed\n", li);
 	DEBUG_ASSERT(!(li->flags & ECM_DB_LISTENER_FLAGS_INSERTED), "%p: inserted\n", li);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	li->arg = arg;
 	li->final = final;
@@ -10796,11 +10995,11 @@ void ecm_db_listener_add(struct ecm_db_listener_instance *li,
 	/*
 	 * Add instance into listener list
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	li->flags |= ECM_DB_LISTENER_FLAGS_INSERTED;
 	li->next = ecm_db_listeners;
 	ecm_db_listeners = li;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_listener_add);
 
@@ -10840,7 +11039,7 @@ struct ecm_db_connection_instance *ecm_db_connection_alloc(void)
 	/*
 	 * Refs is 1 for the creator of the connection
 	 */
-	ci->refs = 1;
+	atomic_set(&ci->refs, 1);
 	DEBUG_SET_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC);
 
 	/*
@@ -10860,9 +11059,9 @@ struct ecm_db_connection_instance *ecm_db_connection_alloc(void)
 	/*
 	 * If the master thread is terminating then we cannot create new instances
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	if (ecm_db_terminate_pending) {
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		DEBUG_WARN("Thread terminating\n");
 		kfree(ci);
 		return NULL;
@@ -10875,7 +11074,7 @@ struct ecm_db_connection_instance *ecm_db_connection_alloc(void)
 
 	ecm_db_connection_count++;
 	DEBUG_ASSERT(ecm_db_connection_count > 0, "%p: connection count wrap\n", ci);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	DEBUG_TRACE("Connection created %p\n", ci);
 	return ci;
@@ -10896,26 +11095,26 @@ struct ecm_db_mapping_instance *ecm_db_mapping_alloc(void)
 		return NULL;
 	}
 
-	mi->refs = 1;
+	atomic_set(&mi->refs, 1);
 	DEBUG_SET_MAGIC(mi, ECM_DB_MAPPING_INSTANCE_MAGIC);
 
 	/*
 	 * Alloc operation must be atomic to ensure thread and module can be held
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 
 	/*
 	 * If the event processing thread is terminating then we cannot create new instances
 	 */
 	if (ecm_db_terminate_pending) {
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		DEBUG_WARN("Thread terminating\n");
 		kfree(mi);
 		return NULL;
 	}
 
 	ecm_db_mapping_count++;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	DEBUG_TRACE("Mapping created %p\n", mi);
 	return mi;
@@ -10935,26 +11134,26 @@ struct ecm_db_host_instance *ecm_db_host_alloc(void)
 		return NULL;
 	}
 
-	hi->refs = 1;
+	atomic_set(&hi->refs, 1);
 	DEBUG_SET_MAGIC(hi, ECM_DB_HOST_INSTANCE_MAGIC);
 
 	/*
 	 * Alloc operation must be atomic to ensure thread and module can be held
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 
 	/*
 	 * If the event processing thread is terminating then we cannot create new instances
 	 */
 	if (ecm_db_terminate_pending) {
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		DEBUG_WARN("Thread terminating\n");
 		kfree(hi);
 		return NULL;
 	}
 
 	ecm_db_host_count++;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	DEBUG_TRACE("Host created %p\n", hi);
 	return hi;
@@ -10975,26 +11174,26 @@ struct ecm_db_node_instance *ecm_db_node_alloc(void)
 		return NULL;
 	}
 
-	ni->refs = 1;
+	atomic_set(&ni->refs, 1);
 	DEBUG_SET_MAGIC(ni, ECM_DB_NODE_INSTANCE_MAGIC);
 
 	/*
 	 * Alloc operation must be atomic to ensure thread and module can be held
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 
 	/*
 	 * If the event processing thread is terminating then we cannot create new instances
 	 */
 	if (ecm_db_terminate_pending) {
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		DEBUG_WARN("Thread terminating\n");
 		kfree(ni);
 		return NULL;
 	}
 
 	ecm_db_node_count++;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	DEBUG_TRACE("Node created %p\n", ni);
 	return ni;
@@ -11021,20 +11220,20 @@ struct ecm_db_iface_instance *ecm_db_iface_alloc(void)
 	/*
 	 * Alloc operation must be atomic to ensure thread and module can be held
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 
 	/*
 	 * If the event processing thread is terminating then we cannot create new instances
 	 */
 	if (ecm_db_terminate_pending) {
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		DEBUG_WARN("Thread terminating\n");
 		kfree(ii);
 		return NULL;
 	}
 
 	ecm_db_iface_count++;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	DEBUG_TRACE("iface created %p\n", ii);
 	return ii;
@@ -11061,13 +11260,13 @@ struct ecm_db_listener_instance *ecm_db_listener_alloc(void)
 	/*
 	 * Alloc operation must be atomic to ensure thread and module can be held
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 
 	/*
 	 * If the event processing thread is terminating then we cannot create new instances
 	 */
 	if (ecm_db_terminate_pending) {
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		DEBUG_WARN("Thread terminating\n");
 		kfree(li);
 		return NULL;
@@ -11075,7 +11274,7 @@ struct ecm_db_listener_instance *ecm_db_listener_alloc(void)
 
 	ecm_db_listeners_count++;
 	DEBUG_ASSERT(ecm_db_listeners_count > 0, "%p: listener count wrap\n", li);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	DEBUG_TRACE("Listener created %p\n", li);
 	return li;
@@ -11140,7 +11339,7 @@ struct ecm_db_multicast_tuple_instance *ecm_db_multicast_connection_find_and_ref
 	 */
 	hash_index = ecm_db_multicast_generate_hash_index(group);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ti = ecm_db_multicast_tuple_instance_table[hash_index];
 
 	/*
@@ -11154,12 +11353,12 @@ struct ecm_db_multicast_tuple_instance *ecm_db_multicast_connection_find_and_ref
 
 		_ecm_db_multicast_tuple_instance_ref(ti);
 		_ecm_db_connection_ref(ti->ci);
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		DEBUG_TRACE("multicast tuple instance found %p\n", ti);
 		return ti;
 	}
 
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	DEBUG_TRACE("multicast tuple instance not found\n");
 	return NULL;
 }
@@ -11173,9 +11372,9 @@ EXPORT_SYMBOL(ecm_db_multicast_connection_find_and_ref);
 int ecm_db_multicast_tuple_instance_deref(struct ecm_db_multicast_tuple_instance *ti)
 {
 	int refs;
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	refs = _ecm_db_multicast_tuple_instance_deref(ti);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return refs;
 }
 EXPORT_SYMBOL(ecm_db_multicast_tuple_instance_deref);
@@ -11209,7 +11408,7 @@ void ecm_db_multicast_tuple_instance_add(struct ecm_db_multicast_tuple_instance
 {
 	DEBUG_CHECK_MAGIC(ti, ECM_DB_MULTICAST_INSTANCE_MAGIC, "%p: magic failed", ti);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	DEBUG_ASSERT(!(ti->flags & ECM_DB_MULTICAST_TUPLE_INSTANCE_FLAGS_INSERTED), "%p: inserted\n", ti);
 
 	/*
@@ -11230,7 +11429,7 @@ void ecm_db_multicast_tuple_instance_add(struct ecm_db_multicast_tuple_instance
 	ecm_db_multicast_tuple_instance_table[ti->hash_index] = ti;
 
 	ti->flags |= ECM_DB_MULTICAST_TUPLE_INSTANCE_FLAGS_INSERTED;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 }
 EXPORT_SYMBOL(ecm_db_multicast_tuple_instance_add);
@@ -11248,13 +11447,13 @@ struct ecm_db_multicast_tuple_instance *ecm_db_multicast_connection_get_and_ref_
 
 	hash_index = ecm_db_multicast_generate_hash_index(group);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ti = ecm_db_multicast_tuple_instance_table[hash_index];
 	if (ti) {
 		_ecm_db_multicast_tuple_instance_ref(ti);
 		_ecm_db_connection_ref(ti->ci);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	return ti;
 }
@@ -11270,13 +11469,13 @@ struct ecm_db_multicast_tuple_instance *ecm_db_multicast_connection_get_and_ref_
 {
 	struct ecm_db_multicast_tuple_instance *tin;
 	DEBUG_CHECK_MAGIC(ti, ECM_DB_MULTICAST_INSTANCE_MAGIC, "%p: magic failed", ti);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	tin = ti->next;
 	if (tin) {
 		_ecm_db_multicast_tuple_instance_ref(tin);
 		_ecm_db_connection_ref(tin->ci);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return tin;
 }
 EXPORT_SYMBOL(ecm_db_multicast_connection_get_and_ref_next);
@@ -11312,9 +11511,9 @@ uint32_t ecm_db_multicast_tuple_instance_flags_get(struct ecm_db_multicast_tuple
 	uint32_t flags;
 
 	DEBUG_CHECK_MAGIC(ti, ECM_DB_MULTICAST_INSTANCE_MAGIC, "%p: magic failed\n", ti);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	flags = ti->flags;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return flags;
 }
 EXPORT_SYMBOL(ecm_db_multicast_tuple_instance_flags_get);
@@ -11327,9 +11526,9 @@ void ecm_db_multicast_tuple_instance_flags_set(struct ecm_db_multicast_tuple_ins
 {
 	DEBUG_CHECK_MAGIC(ti, ECM_DB_MULTICAST_INSTANCE_MAGIC, "%p: magic failed\n", ti);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ti->flags |= flags;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_multicast_tuple_instance_flags_set);
 
@@ -11341,9 +11540,9 @@ void ecm_db_multicast_tuple_instance_flags_clear(struct ecm_db_multicast_tuple_i
 {
 	DEBUG_CHECK_MAGIC(ti, ECM_DB_MULTICAST_INSTANCE_MAGIC, "%p: magic failed\n", ti);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ti->flags &= ~flags;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 }
 EXPORT_SYMBOL(ecm_db_multicast_tuple_instance_flags_clear);
 
@@ -11393,9 +11592,9 @@ int32_t ecm_db_multicast_connection_to_interfaces_get_and_ref_all(struct ecm_db_
 		return if_count;
 	}
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	if (!ci->to_mcast_interfaces_set) {
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		kfree(ii_first_base);
 		kfree(heirarchy_base);
 		return if_count;
@@ -11431,7 +11630,7 @@ int32_t ecm_db_multicast_connection_to_interfaces_get_and_ref_all(struct ecm_db_
 	*interfaces = heirarchy_base;
 	*ifaces_first = ii_first_base;
 
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return if_count;
 }
 EXPORT_SYMBOL(ecm_db_multicast_connection_to_interfaces_get_and_ref_all);
@@ -11445,9 +11644,9 @@ bool ecm_db_multicast_connection_to_interfaces_set_check(struct ecm_db_connectio
 	bool set;
 
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	set = ci->to_mcast_interfaces_set;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return set;
 }
 EXPORT_SYMBOL(ecm_db_multicast_connection_to_interfaces_set_check);
@@ -11541,9 +11740,9 @@ void ecm_db_multicast_connection_to_interfaces_clear_at_index(struct ecm_db_conn
 	 */
 	DEBUG_ASSERT((index < ECM_DB_MULTICAST_IF_MAX), "%p: Invalid index for multicast interface heirarchies list %u\n", ci, index);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	if (ci->to_mcast_interface_first[index] == ECM_DB_IFACE_HEIRARCHY_MAX) {
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		return;
 	}
 
@@ -11562,7 +11761,7 @@ void ecm_db_multicast_connection_to_interfaces_clear_at_index(struct ecm_db_conn
 		ci->to_mcast_interfaces_set = false;
 	}
 
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	ecm_db_connection_interfaces_deref(discard, discard_first);
 }
@@ -11577,14 +11776,14 @@ void ecm_db_multicast_connection_to_interfaces_clear(struct ecm_db_connection_in
 	int heirarchy_index;
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed\n", ci);
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	if (!ci->to_mcast_interfaces) {
-		spin_unlock_bh(&ecm_db_lock);
+		ecm_db_unlock_bh();
 		return;
 	}
 
 	_ecm_db_multicast_connection_to_interfaces_set_clear(ci);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	for (heirarchy_index = 0; heirarchy_index < ECM_DB_MULTICAST_IF_MAX; heirarchy_index++) {
 		ecm_db_multicast_connection_to_interfaces_clear_at_index(ci, heirarchy_index);
@@ -11603,9 +11802,9 @@ EXPORT_SYMBOL(ecm_db_multicast_connection_to_interfaces_clear);
 uint32_t ecm_db_time_get(void)
 {
 	uint32_t time_now;
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	time_now = ecm_db_time;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return time_now;
 }
 EXPORT_SYMBOL(ecm_db_time_get);
@@ -11630,10 +11829,10 @@ static ssize_t ecm_db_get_defunct_all(struct file *file,
 	/*
 	 * Operate under our locks
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	num = ecm_db_connection_count + ecm_db_mapping_count + ecm_db_host_count
 			+ ecm_db_node_count + ecm_db_iface_count;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	ret = snprintf(buf, (ssize_t)PAGE_SIZE, "%d\n", num);
 	if (ret < 0) {
@@ -11688,12 +11887,12 @@ static ssize_t ecm_db_get_connection_counts_simple(struct file *file,
 	/*
 	 * Get snapshot of the protocol counts
 	 */
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	tcp_count = ecm_db_connection_count_by_protocol[IPPROTO_TCP];
 	udp_count = ecm_db_connection_count_by_protocol[IPPROTO_UDP];
 	total_count = ecm_db_connection_count;
 	other_count = total_count - (tcp_count + udp_count);
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	ret = snprintf(buf, (ssize_t)PAGE_SIZE, "tcp %d udp %d other %d total %d\n", tcp_count, udp_count, other_count, total_count);
 	if (ret < 0) {
@@ -11713,6 +11912,80 @@ static struct file_operations ecm_db_connection_count_simple_fops = {
 	.read = ecm_db_get_connection_counts_simple,
 };
 
+/*
+ * ecm_db_get_lock_stats()
+ *	Return the database lock statistics for each CPU and in total.
+ */
+static ssize_t ecm_db_get_lock_stats(struct file *file,
+					char __user *user_buf,
+					size_t sz, loff_t *ppos)
+{
+	struct ecm_db_lock_stats total;
+	int len = 0;
+	int cpu;
+	int ret;
+	char *buf;
+
+	buf = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!buf) {
+		return -ENOMEM;
+	}
+
+	memset(&total, 0, sizeof(total));
+	for_each_possible_cpu(cpu) {
+		struct ecm_db_lock_stats *stats = per_cpu_ptr(&ecm_db_lock_stats, cpu);
+
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+				"cpu%d acquisitions %llu contentions %llu wait_ns %llu wait_max_ns %llu lockless_lookups %llu lockless_ref_misses %llu\n",
+				cpu, (unsigned long long)stats->acquisitions, (unsigned long long)stats->contentions,
+				(unsigned long long)stats->wait_ns, (unsigned long long)stats->wait_max_ns,
+				(unsigned long long)stats->lockless_lookups, (unsigned long long)stats->lockless_ref_misses);
+
+		total.acquisitions += stats->acquisitions;
+		total.contentions += stats->contentions;
+		total.wait_ns += stats->wait_ns;
+		if (stats->wait_max_ns > total.wait_max_ns) {
+			total.wait_max_ns = stats->wait_max_ns;
+		}
+		total.lockless_lookups += stats->lockless_lookups;
+		total.lockless_ref_misses += stats->lockless_ref_misses;
+	}
+
+	len += scnprintf(buf + len, PAGE_SIZE - len,
+			"total acquisitions %llu contentions %llu wait_ns %llu wait_max_ns %llu lockless_lookups %llu lockless_ref_misses %llu\n",
+			(unsigned long long)total.acquisitions, (unsigned long long)total.contentions,
+			(unsigned long long)total.wait_ns, (unsigned long long)total.wait_max_ns,
+			(unsigned long long)total.lockless_lookups, (unsigned long long)total.lockless_ref_misses);
+
+	ret = simple_read_from_buffer(user_buf, sz, ppos, buf, len);
+	kfree(buf);
+	return ret;
+}
+
+/*
+ * ecm_db_reset_lock_stats()
+ *	Any write resets the database lock statistics.
+ */
+static ssize_t ecm_db_reset_lock_stats(struct file *file,
+					const char __user *user_buf,
+					size_t sz, loff_t *ppos)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		memset(per_cpu_ptr(&ecm_db_lock_stats, cpu), 0, sizeof(struct ecm_db_lock_stats));
+	}
+	return sz;
+}
+
+/*
+ * File operations for lock statistics.
+ */
+static struct file_operations ecm_db_lock_stats_fops = {
+	.read = ecm_db_get_lock_stats,
+	.write = ecm_db_reset_lock_stats,
+};
+
 /*
  * ecm_db_timer_callback()
  *	Manage expiration of connections
@@ -11729,9 +12002,10 @@ static void ecm_db_timer_callback(unsigned long data)
 	/*
 	 * Increment timer.
 	 */
-	spin_lock_bh(&ecm_db_lock);
-	timer = ++ecm_db_time;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
+	timer = ecm_db_time + 1;
+	WRITE_ONCE(ecm_db_time, timer);
+	ecm_db_unlock_bh();
 	DEBUG_TRACE("Garbage timer tick %d\n", timer);
 
 	/*
@@ -11758,12 +12032,12 @@ static inline struct ecm_db_connection_instance *ecm_db_node_from_connections_ge
 {
 	struct ecm_db_connection_instance *ci;
 	DEBUG_CHECK_MAGIC(node, ECM_DB_NODE_INSTANCE_MAGIC, "%p: magic failed", node);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ci = node->from_connections;
 	if (ci) {
 		_ecm_db_connection_ref(ci);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return ci;
 }
 
@@ -11775,12 +12049,12 @@ static inline struct ecm_db_connection_instance *ecm_db_node_from_connection_get
 {
 	struct ecm_db_connection_instance *cin;
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed", ci);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	cin = ci->node_from_next;
 	if (cin) {
 		_ecm_db_connection_ref(cin);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return cin;
 }
 
@@ -11792,12 +12066,12 @@ static inline struct ecm_db_connection_instance *ecm_db_node_to_connections_get_
 {
 	struct ecm_db_connection_instance *ci;
 	DEBUG_CHECK_MAGIC(node, ECM_DB_NODE_INSTANCE_MAGIC, "%p: magic failed", node);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ci = node->to_connections;
 	if (ci) {
 		_ecm_db_connection_ref(ci);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return ci;
 }
 
@@ -11809,12 +12083,12 @@ static inline struct ecm_db_connection_instance *ecm_db_node_to_connection_get_a
 {
 	struct ecm_db_connection_instance *cin;
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed", ci);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	cin = ci->node_to_next;
 	if (cin) {
 		_ecm_db_connection_ref(cin);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return cin;
 }
 
@@ -11826,12 +12100,12 @@ static inline struct ecm_db_connection_instance *ecm_db_node_from_nat_connection
 {
 	struct ecm_db_connection_instance *ci;
 	DEBUG_CHECK_MAGIC(node, ECM_DB_NODE_INSTANCE_MAGIC, "%p: magic failed", node);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ci = node->from_nat_connections;
 	if (ci) {
 		_ecm_db_connection_ref(ci);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return ci;
 }
 
@@ -11843,12 +12117,12 @@ static inline struct ecm_db_connection_instance *ecm_db_node_from_nat_connection
 {
 	struct ecm_db_connection_instance *cin;
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed", ci);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	cin = ci->node_from_nat_next;
 	if (cin) {
 		_ecm_db_connection_ref(cin);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return cin;
 }
 
@@ -11860,12 +12134,12 @@ static inline struct ecm_db_connection_instance *ecm_db_node_to_nat_connections_
 {
 	struct ecm_db_connection_instance *ci;
 	DEBUG_CHECK_MAGIC(node, ECM_DB_NODE_INSTANCE_MAGIC, "%p: magic failed", node);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ci = node->to_nat_connections;
 	if (ci) {
 		_ecm_db_connection_ref(ci);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return ci;
 }
 
@@ -11877,12 +12151,12 @@ static inline struct ecm_db_connection_instance *ecm_db_node_to_nat_connection_g
 {
 	struct ecm_db_connection_instance *cin;
 	DEBUG_CHECK_MAGIC(ci, ECM_DB_CONNECTION_INSTANCE_MAGIC, "%p: magic failed", ci);
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	cin = ci->node_to_nat_next;
 	if (cin) {
 		_ecm_db_connection_ref(cin);
 	}
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 	return cin;
 }
 
@@ -12343,6 +12617,12 @@ int ecm_db_init(struct dentry *dentry)
 		goto init_cleanup;
 	}
 
+	if (!debugfs_create_file("lock_stats", S_IRUGO | S_IWUSR, ecm_db_dentry,
+					NULL, &ecm_db_lock_stats_fops)) {
+		DEBUG_ERROR("Failed to create ecm db lock stats file in debugfs\n");
+		goto init_cleanup;
+	}
+
 	ecm_db_connection_table = vzalloc(sizeof(struct ecm_db_connection_instance *) * ECM_DB_CONNECTION_HASH_SLOTS);
 	if (!ecm_db_connection_table) {
 		DEBUG_ERROR("Failed to allocate virtual memory for ecm_db_connection_table\n");
@@ -12526,9 +12806,9 @@ void ecm_db_exit(void)
 {
 	DEBUG_INFO("ECM DB Module exit\n");
 
-	spin_lock_bh(&ecm_db_lock);
+	ecm_db_lock_bh();
 	ecm_db_terminate_pending = true;
-	spin_unlock_bh(&ecm_db_lock);
+	ecm_db_unlock_bh();
 
 	ecm_db_connection_defunct_all();
 
@@ -12541,6 +12821,11 @@ void ecm_db_exit(void)
 	 */
 	del_timer_sync(&ecm_db_timer);
 
+	/*
+	 * Wait for instances released by the final derefs to be freed
+	 */
+	rcu_barrier();
+
 	/*
 	 * Free the tables.
 	 */
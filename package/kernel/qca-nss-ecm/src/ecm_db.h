@@ -355,6 +355,9 @@ int ecm_db_iface_hash_index_get_next(int index);
 int ecm_db_iface_hash_index_get_first(void);
 int ecm_db_protocol_get_next(int protocol);
 int ecm_db_protocol_get_first(void);
+
+struct ecm_state_export_conn;
+int ecm_db_connections_export(struct ecm_state_export_conn *records, int max_records, bool *truncated);
 #endif
 
 #ifdef ECM_MULTICAST_ENABLE
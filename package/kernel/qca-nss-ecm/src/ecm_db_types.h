@@ -184,9 +184,8 @@ struct ecm_multicast_if_update {
  * WARNING: Do NOT inspect any of these fields - they are for exclusive use of the DB timer code.  Use the API's to control the timer and inspect its state.
  */
 struct ecm_db_timer_group_entry {
-	struct ecm_db_timer_group_entry *next;			/* Link to the next entry in the timer group chain */
-	struct ecm_db_timer_group_entry *prev;			/* Link to the previous entry in the timer group chain */
-	uint32_t timeout;					/* Time this entry expires providing the timer group is not the ECM_DB_TIMER_GROUPS_MAX */
+	struct hlist_node node;					/* Link into the timer wheel slot holding this entry */
+	uint32_t touched;					/* Time this entry was last touched, its expiry is this plus the timer group time */
 	ecm_db_timer_group_t group;				/* The timer group to which this entry belongs, if this is ECM_DB_TIMER_GROUPS_MAX then the timer is not running */
 	void *arg;						/* Argument returned in callback */
 	ecm_db_timer_group_entry_callback_t fn;			/* Function called when timer expires */
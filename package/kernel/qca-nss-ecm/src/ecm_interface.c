@@ -5367,7 +5367,12 @@ static int ecm_interface_node_br_fdb_notify_event(struct notifier_block *nb,
 {
 	uint8_t *mac =  (uint8_t *)data;
 
-	if (ECM_FRONT_END_TYPE_NSS == ecm_front_end_type_get()) {
+	/*
+	 * Both front ends accelerate bridged flows, which must not outlive the
+	 * FDB entries they were created from.
+	 */
+	if ((ECM_FRONT_END_TYPE_NSS == ecm_front_end_type_get()) ||
+	    (ECM_FRONT_END_TYPE_SFE == ecm_front_end_type_get())) {
 		DEBUG_INFO("FDB updated for node %pM\n", mac);
 		ecm_interface_node_connections_defunct(mac);
 	}
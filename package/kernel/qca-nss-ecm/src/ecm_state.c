@@ -26,6 +26,8 @@
 #include <linux/inet.h>
 #include <linux/ipv6.h>
 #include <linux/netfilter_bridge.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
 
 /*
  * Debug output levels
@@ -45,6 +47,7 @@
 #include "ecm_front_end_types.h"
 #include "ecm_classifier_default.h"
 #include "ecm_db.h"
+#include "ecm_state_export.h"
 
 /*
  * Magic numbers
@@ -557,6 +560,81 @@ static void ecm_state_file_classifier_type_assignments_release(struct ecm_state_
 }
 #endif
 
+/*
+ * ecm_state_export_open()
+ *	Take a binary snapshot of the connection database.
+ */
+static int ecm_state_export_open(struct inode *inode, struct file *file)
+{
+	struct ecm_state_export_hdr *hdr;
+	int max_records;
+	bool truncated;
+
+	/*
+	 * The snapshot can't be allocated under the database lock so leave some room
+	 * for connections added in the meantime.
+	 */
+	max_records = ecm_db_connection_count_get();
+	max_records += (max_records >> 3) + 16;
+
+	hdr = vmalloc_user(sizeof(*hdr) + (size_t)max_records * sizeof(struct ecm_state_export_conn));
+	if (!hdr) {
+		return -ENOMEM;
+	}
+
+	hdr->magic = ECM_STATE_EXPORT_MAGIC;
+	hdr->version = ECM_STATE_EXPORT_VERSION;
+	hdr->record_size = sizeof(struct ecm_state_export_conn);
+	hdr->num_records = ecm_db_connections_export((struct ecm_state_export_conn *)(hdr + 1), max_records, &truncated);
+	if (truncated) {
+		hdr->flags |= ECM_STATE_EXPORT_FLAG_TRUNCATED;
+	}
+
+	DEBUG_INFO("Export snapshot %p, %u connections\n", hdr, hdr->num_records);
+	file->private_data = hdr;
+	return 0;
+}
+
+/*
+ * ecm_state_export_read()
+ *	Copy the connection snapshot to userspace.
+ */
+static ssize_t ecm_state_export_read(struct file *file, char __user *buffer, size_t length, loff_t *offset)
+{
+	struct ecm_state_export_hdr *hdr = (struct ecm_state_export_hdr *)file->private_data;
+
+	return simple_read_from_buffer(buffer, length, offset, hdr,
+				       sizeof(*hdr) + hdr->num_records * sizeof(struct ecm_state_export_conn));
+}
+
+/*
+ * ecm_state_export_mmap()
+ *	Map the connection snapshot into userspace.
+ */
+static int ecm_state_export_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	return remap_vmalloc_range(vma, file->private_data, vma->vm_pgoff);
+}
+
+/*
+ * ecm_state_export_release()
+ */
+static int ecm_state_export_release(struct inode *inode, struct file *file)
+{
+	vfree(file->private_data);
+	return 0;
+}
+
+/*
+ * File operations used in the binary export minor of the char device
+ */
+static const struct file_operations ecm_state_export_fops = {
+	.read = ecm_state_export_read,
+	.mmap = ecm_state_export_mmap,
+	.llseek = default_llseek,
+	.release = ecm_state_export_release
+};
+
 /*
  * ecm_state_char_device_open()
  *	Opens the special char device file which we use to dump our state.
@@ -565,6 +643,11 @@ static int ecm_state_char_device_open(struct inode *inode, struct file *file)
 {
 	struct ecm_state_file_instance *sfi;
 
+	if (iminor(inode) == ECM_STATE_EXPORT_MINOR) {
+		replace_fops(file, &ecm_state_export_fops);
+		return ecm_state_export_open(inode, file);
+	}
+
 	DEBUG_INFO("State open\n");
 
 	/*
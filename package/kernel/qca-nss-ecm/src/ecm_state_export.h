@@ -0,0 +1,86 @@
+/*
+ **************************************************************************
+ * Copyright (c) 2015, The Linux Foundation.  All rights reserved.
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+ * OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ **************************************************************************
+ */
+
+/*
+ * Binary connection export.
+ *
+ * Opening minor ECM_STATE_EXPORT_MINOR of the ecm_state char device takes a
+ * snapshot of the connection database.  The snapshot is a struct
+ * ecm_state_export_hdr followed by num_records struct ecm_state_export_conn
+ * records and can be read() or mmap()ed until the file is closed.
+ *
+ * This header is shared with userspace.
+ */
+#ifndef __ECM_STATE_EXPORT_H
+#define __ECM_STATE_EXPORT_H
+
+#include <linux/types.h>
+
+#define ECM_STATE_EXPORT_MINOR 1
+#define ECM_STATE_EXPORT_MAGIC 0x45434d58	/* "ECMX" */
+#define ECM_STATE_EXPORT_VERSION 1
+
+/*
+ * Snapshot flags
+ */
+#define ECM_STATE_EXPORT_FLAG_TRUNCATED 0x1	/* Connections were added while the snapshot was taken and some are missing */
+
+/*
+ * struct ecm_state_export_hdr
+ *	Snapshot header
+ */
+struct ecm_state_export_hdr {
+	__u32 magic;				/* ECM_STATE_EXPORT_MAGIC */
+	__u16 version;				/* ECM_STATE_EXPORT_VERSION */
+	__u16 record_size;			/* Size of each connection record */
+	__u32 num_records;			/* Number of connection records following the header */
+	__u32 flags;				/* ECM_STATE_EXPORT_FLAG_... */
+};
+
+/*
+ * struct ecm_state_export_conn
+ *	Connection record
+ *
+ * Addresses are in network byte order, IPv4 addresses only use addr[0].
+ * Ports are in host byte order.
+ */
+struct ecm_state_export_conn {
+	__be32 from_ip[4];			/* Address the connection was established from */
+	__be32 from_ip_nat[4];			/* NAT address the connection was established from */
+	__be32 to_ip[4];			/* Address the connection was established to */
+	__be32 to_ip_nat[4];			/* NAT address the connection was established to */
+	__u16 from_port;			/* Port the connection was established from */
+	__u16 from_port_nat;			/* NAT port the connection was established from */
+	__u16 to_port;				/* Port the connection was established to */
+	__u16 to_port_nat;			/* NAT port the connection was established to */
+	__u32 serial;				/* Serial number of the connection */
+	__s32 from_ifindex;			/* Outermost interface of the from path, -1 when unknown */
+	__s32 to_ifindex;			/* Outermost interface of the to path, -1 when unknown */
+	__u32 age;				/* Seconds since the connection was added to the database */
+	__u8 ip_version;			/* 4 or 6 */
+	__u8 protocol;				/* IP protocol number */
+	__u8 direction;				/* ecm_db_direction_t */
+	__u8 is_routed;				/* Non-zero when the connection is routed */
+	__u32 reserved;
+	__u64 from_data_total;			/* Bytes sent by the from side */
+	__u64 to_data_total;			/* Bytes sent by the to side */
+	__u64 from_packet_total;		/* Packets sent by the from side */
+	__u64 to_packet_total;			/* Packets sent by the to side */
+	__u64 from_packet_total_dropped;	/* Packets from the from side that were dropped */
+	__u64 to_packet_total_dropped;		/* Packets from the to side that were dropped */
+};
+
+#endif /* __ECM_STATE_EXPORT_H */
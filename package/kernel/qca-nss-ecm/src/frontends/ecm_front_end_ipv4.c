@@ -51,6 +51,9 @@
  * General operational control
  */
 int ecm_front_end_ipv4_stopped = 0;	/* When non-zero further traffic will not be processed */
+#ifdef ECM_MULTICAST_ENABLE
+int ecm_front_end_ipv4_mc_stopped = 0;	/* When non-zero further multicast traffic will not be processed */
+#endif
 
 /*
  * ecm_front_end_ipv4_interface_construct_ip_addr_set()
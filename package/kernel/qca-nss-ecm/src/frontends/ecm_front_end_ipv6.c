@@ -52,6 +52,9 @@
  * General operational control
  */
 int ecm_front_end_ipv6_stopped = 0;	/* When non-zero further traffic will not be processed */
+#ifdef ECM_MULTICAST_ENABLE
+int ecm_front_end_ipv6_mc_stopped = 0;	/* When non-zero further multicast traffic will not be processed */
+#endif
 
 /*
  * ecm_front_end_ipv6_interface_construct_ip_addr_set()
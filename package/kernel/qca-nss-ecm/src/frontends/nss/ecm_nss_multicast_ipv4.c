@@ -61,11 +61,6 @@
 #include <linux/if_vlan.h>
 #endif
 
-/*
- * General operational control
- */
-int ecm_front_end_ipv4_mc_stopped = 0;	/* When non-zero further traffic will not be processed */
-
 /*
  * Debug output levels
  * 0 = OFF
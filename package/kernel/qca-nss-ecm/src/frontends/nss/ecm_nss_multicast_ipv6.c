@@ -92,11 +92,6 @@
 #include "ecm_nss_multicast_ipv6.h"
 #include "ecm_nss_common.h"
 
-/*
- * General operational control
- */
-int ecm_front_end_ipv6_mc_stopped = 0;	/* When non-zero further traffic will not be processed */
-
 /*
  * Magic numbers
  */
@@ -139,6 +139,20 @@ bool ecm_sfe_ipv6_terminate_pending = false;		/* True when the user has signalle
  */
 struct sfe_drv_ctx_instance *ecm_sfe_ipv6_drv_mgr = NULL;
 
+/*
+ * Rule message batching.
+ * Create/destroy rule messages are coalesced for up to one jiffy, or until rule_batch_max
+ * messages are pending, and sent to the sfe driver as one batch message.
+ * Setting rule_batch_max to 0 or 1 sends every message on its own.
+ */
+uint32_t ecm_sfe_ipv6_rule_batch_max = SFE_RULE_BATCH_MAX;	/* Maximum rule messages per batch */
+static struct sfe_ipv6_batch_msg *ecm_sfe_ipv6_rule_batch = NULL;	/* Batch being filled, NULL when none */
+static struct timer_list ecm_sfe_ipv6_rule_batch_timer;	/* Flushes a partially filled batch */
+static DEFINE_SPINLOCK(ecm_sfe_ipv6_rule_batch_lock);		/* Protects ecm_sfe_ipv6_rule_batch */
+static bool ecm_sfe_ipv6_rule_batch_stopped = false;		/* Batching stopped for module exit, protected by ecm_sfe_ipv6_rule_batch_lock */
+static uint32_t ecm_sfe_ipv6_rule_batch_sent = 0;		/* Batch messages sent */
+static uint32_t ecm_sfe_ipv6_rule_batch_msgs = 0;		/* Rule messages sent within batches */
+
 static unsigned long ecm_sfe_ipv6_accel_cmd_time_avg_samples = 0;	/* Sum of time taken for the set of accel command samples, used to compute average time for an accel command to complete */
 static unsigned long ecm_sfe_ipv6_accel_cmd_time_avg_set = 1;	/* How many samples in the set */
 static unsigned long ecm_sfe_ipv6_decel_cmd_time_avg_samples = 0;	/* Sum of time taken for the set of accel command samples, used to compute average time for an accel command to complete */
@@ -783,7 +797,7 @@ static unsigned int ecm_sfe_ipv6_ip_process(struct net_device *out_dev, struct n
 	 * Check for a multicast Destination address here.
 	 */
 	ECM_NIN6_ADDR_TO_IP_ADDR(ip_dest_addr, orig_tuple.dst.u3.in6);
-	if (ecm_ip_addr_is_multicast(ip_dest_addr)) {
+	if (ecm_ip_addr_is_multicast(ip_dest_addr) && (skb->pkt_type == PACKET_MULTICAST)) {
 		DEBUG_TRACE("skb %p multicast daddr " ECM_IP_ADDR_OCTAL_FMT "\n", skb, ECM_IP_ADDR_TO_OCTAL(ip_dest_addr));
 
 		return ecm_sfe_multicast_ipv6_connection_process(out_dev,
@@ -943,6 +957,11 @@ static unsigned int ecm_sfe_ipv6_post_routing_hook(const struct nf_hook_ops *ops
 		DEBUG_TRACE("Multicast, ignoring: %p\n", skb);
 		return NF_ACCEPT;
 	}
+#else
+	if ((skb->pkt_type == PACKET_MULTICAST) && unlikely(ecm_front_end_ipv6_mc_stopped)) {
+		DEBUG_TRACE("Multicast frontend stopped, ignoring: %p\n", skb);
+		return NF_ACCEPT;
+	}
 #endif
 
 #ifdef ECM_INTERFACE_PPPOE_ENABLE
@@ -971,6 +990,324 @@ static unsigned int ecm_sfe_ipv6_post_routing_hook(const struct nf_hook_ops *ops
 	return result;
 }
 
+/*
+ * ecm_sfe_ipv6_bridge_post_routing_hook()
+ *	Called for packets that are going out to one of the bridge physical interfaces.
+ *
+ * These may have come from another bridged interface or from a non-bridged interface.
+ * Conntrack information may be available or not if this skb is bridged.
+ *
+ * Only plain Ethernet IP flows between two ports are offloaded.  Once they are,
+ * their packets no longer pass through the bridge, so ebtables and br_netfilter
+ * rules don't see them and the FDB entries of the hosts are only refreshed when
+ * the connection is synced.
+ */
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4, 4, 0))
+static unsigned int ecm_sfe_ipv6_bridge_post_routing_hook(void *priv,
+					struct sk_buff *skb,
+					const struct nf_hook_state *nhs)
+{
+	struct net_device *out = nhs->out;
+#elif (LINUX_VERSION_CODE <= KERNEL_VERSION(3, 6, 0))
+static unsigned int ecm_sfe_ipv6_bridge_post_routing_hook(unsigned int hooknum,
+					struct sk_buff *skb,
+					const struct net_device *in_unused,
+					const struct net_device *out,
+					int (*okfn)(struct sk_buff *))
+{
+#else
+static unsigned int ecm_sfe_ipv6_bridge_post_routing_hook(const struct nf_hook_ops *ops,
+					struct sk_buff *skb,
+					const struct net_device *in_unused,
+					const struct net_device *out,
+					int (*okfn)(struct sk_buff *))
+{
+#endif
+	struct ethhdr *skb_eth_hdr;
+	uint16_t eth_type;
+	struct net_device *bridge;
+	struct net_device *in;
+	bool can_accel = true;
+	unsigned int result;
+
+	DEBUG_TRACE("%p: Bridge: %s\n", out, out->name);
+
+	if (ecm_front_end_acceleration_rejected(skb)) {
+		DEBUG_TRACE("Acceleration rejected\n");
+		return NF_ACCEPT;
+	}
+
+	/*
+	 * If operations have stopped then do not process packets
+	 */
+	spin_lock_bh(&ecm_sfe_ipv6_lock);
+	if (unlikely(ecm_front_end_ipv6_stopped)) {
+		spin_unlock_bh(&ecm_sfe_ipv6_lock);
+		DEBUG_TRACE("Front end stopped\n");
+		return NF_ACCEPT;
+	}
+	spin_unlock_bh(&ecm_sfe_ipv6_lock);
+
+	/*
+	 * Don't process broadcast or multicast
+	 */
+	if (skb->pkt_type == PACKET_BROADCAST) {
+		DEBUG_TRACE("Broadcast, ignoring: %p\n", skb);
+		return NF_ACCEPT;
+	}
+
+#ifndef ECM_MULTICAST_ENABLE
+	if (skb->pkt_type == PACKET_MULTICAST) {
+		DEBUG_TRACE("Multicast, ignoring: %p\n", skb);
+		return NF_ACCEPT;
+	}
+#else
+	if ((skb->pkt_type == PACKET_MULTICAST) && unlikely(ecm_front_end_ipv6_mc_stopped)) {
+		DEBUG_TRACE("Multicast frontend stopped, ignoring: %p\n", skb);
+		return NF_ACCEPT;
+	}
+#endif
+
+	/*
+	 * Check packet is an IP Ethernet packet.  The SFE doesn't bridge PPPoE sessions.
+	 */
+	skb_eth_hdr = eth_hdr(skb);
+	if (!skb_eth_hdr) {
+		DEBUG_TRACE("%p: Not Eth\n", skb);
+		return NF_ACCEPT;
+	}
+	eth_type = ntohs(skb_eth_hdr->h_proto);
+	if (unlikely(eth_type != 0x86DD)) {
+		DEBUG_TRACE("%p: Not IP\n", skb);
+		return NF_ACCEPT;
+	}
+
+	/*
+	 * Identify interface from where this packet came.
+	 * There are three scenarios to consider here:
+	 * 1. Packet came from a local source.
+	 *	Ignore - local is not handled.
+	 * 2. Packet came from a routed path.
+	 *	Ignore - it was handled in INET post routing.
+	 * 3. Packet is bridged from another port.
+	 *	Process.
+	 *
+	 * Begin by identifying case 1.
+	 * NOTE: We are given 'out' (which we implicitly know is a bridge port) so out interface's master is the 'bridge'.
+	 */
+	bridge = ecm_interface_get_and_hold_dev_master((struct net_device *)out);
+	DEBUG_ASSERT(bridge, "Expected bridge\n");
+	in = dev_get_by_index(&init_net, skb->skb_iif);
+	if (!in) {
+		/*
+		 * Case 1.
+		 */
+		DEBUG_TRACE("Local traffic: %p, ignoring traffic to bridge: %p (%s) \n", skb, bridge, bridge->name);
+		dev_put(bridge);
+		return NF_ACCEPT;
+	}
+	dev_put(in);
+
+	/*
+	 * Case 2:
+	 *	For routed packets the skb will have the src mac matching the bridge mac.
+	 * Case 3:
+	 *	If the packet was not local (case 1) or routed (case 2) then we process.
+	 */
+
+	/*
+	 * Pass in NULL (for skb) and 0 for cookie since doing FDB lookup only
+	 */
+	in = br_port_dev_get(bridge, skb_eth_hdr->h_source, NULL, 0);
+	if (!in) {
+		DEBUG_TRACE("skb: %p, no in device for bridge: %p (%s)\n", skb, bridge, bridge->name);
+		dev_put(bridge);
+		return NF_ACCEPT;
+	}
+	if (in == out) {
+		DEBUG_TRACE("skb: %p, bridge: %p (%s), port bounce on %p (%s)\n", skb, bridge, bridge->name, out, out->name);
+		dev_put(in);
+		dev_put(bridge);
+		return NF_ACCEPT;
+	}
+	if (!ecm_mac_addr_equal(skb_eth_hdr->h_source, bridge->dev_addr)) {
+		/*
+		 * Case 2: Routed trafffic would be handled by the INET post routing.
+		 */
+		DEBUG_TRACE("skb: %p, Ignoring routed packet to bridge: %p (%s)\n", skb, bridge, bridge->name);
+		dev_put(in);
+		dev_put(bridge);
+		return NF_ACCEPT;
+	}
+
+	if (!is_multicast_ether_addr(skb_eth_hdr->h_dest)) {
+		/*
+		 * Process the packet, if we have this mac address in the fdb table.
+		 */
+#if (LINUX_VERSION_CODE <= KERNEL_VERSION(3,6,0))
+		if (!br_fdb_has_entry((struct net_device *)out, skb_eth_hdr->h_dest)) {
+#else
+		if (!br_fdb_has_entry((struct net_device *)out, skb_eth_hdr->h_dest, 0)) {
+#endif
+			DEBUG_WARN("skb: %p, No fdb entry for this mac address %pM in the bridge: %p (%s)\n",
+					skb, skb_eth_hdr->h_dest, bridge, bridge->name);
+			dev_put(in);
+			dev_put(bridge);
+			return NF_ACCEPT;
+		}
+	}
+	DEBUG_TRACE("Bridge process skb: %p, bridge: %p (%s), In: %p (%s), Out: %p (%s)\n",
+			skb, bridge, bridge->name, in, in->name, out, out->name);
+
+	result = ecm_sfe_ipv6_ip_process((struct net_device *)out, in,
+				skb_eth_hdr->h_source, skb_eth_hdr->h_dest, can_accel, false, false, skb);
+
+	dev_put(in);
+	dev_put(bridge);
+	return result;
+}
+
+/*
+ * ecm_sfe_ipv6_rule_batch_callback()
+ *	Handle the response to a batch by handing each rule's response to its own callback.
+ */
+static void ecm_sfe_ipv6_rule_batch_callback(void *app_data, struct sfe_ipv6_batch_msg *batch)
+{
+	uint32_t i;
+
+	for (i = 0; i < batch->num_msgs; ++i) {
+		struct sfe_ipv6_msg *nim = &batch->msgs[i];
+		sfe_ipv6_msg_callback_t cb = (sfe_ipv6_msg_callback_t)nim->cm.cb;
+
+		if (cb) {
+			cb((void *)nim->cm.app_data, nim);
+		}
+	}
+}
+
+/*
+ * ecm_sfe_ipv6_rule_batch_send()
+ *	Send a detached batch to the sfe driver and free it.
+ *
+ * Should the batch be refused each rule is retried on its own, and a rule that still cannot be
+ * sent is given a negative response through its callback, just as if the driver had NACKed it.
+ */
+static void ecm_sfe_ipv6_rule_batch_send(struct sfe_ipv6_batch_msg *batch)
+{
+	sfe_tx_status_t sfe_tx_status;
+	uint32_t i;
+
+	DEBUG_TRACE("Send batch %p of %u rule messages\n", batch, batch->num_msgs);
+	sfe_tx_status = sfe_drv_ipv6_tx_batch(ecm_sfe_ipv6_drv_mgr, batch);
+	if (sfe_tx_status == SFE_TX_SUCCESS) {
+		spin_lock_bh(&ecm_sfe_ipv6_lock);
+		ecm_sfe_ipv6_rule_batch_sent++;
+		ecm_sfe_ipv6_rule_batch_msgs += batch->num_msgs;
+		spin_unlock_bh(&ecm_sfe_ipv6_lock);
+		kfree(batch);
+		return;
+	}
+
+	DEBUG_WARN("Batch %p refused: %d, sending rules individually\n", batch, sfe_tx_status);
+	for (i = 0; i < batch->num_msgs; ++i) {
+		struct sfe_ipv6_msg *nim = &batch->msgs[i];
+		sfe_ipv6_msg_callback_t cb = (sfe_ipv6_msg_callback_t)nim->cm.cb;
+
+		if (sfe_drv_ipv6_tx(ecm_sfe_ipv6_drv_mgr, nim) == SFE_TX_SUCCESS) {
+			continue;
+		}
+
+		nim->cm.response = SFE_CMN_RESPONSE_EMSG;
+		if (cb) {
+			cb((void *)nim->cm.app_data, nim);
+		}
+	}
+	kfree(batch);
+}
+
+/*
+ * ecm_sfe_ipv6_rule_batch_flush()
+ *	Detach and send any partially filled batch.
+ */
+static void ecm_sfe_ipv6_rule_batch_flush(void)
+{
+	struct sfe_ipv6_batch_msg *batch;
+
+	spin_lock_bh(&ecm_sfe_ipv6_rule_batch_lock);
+	batch = ecm_sfe_ipv6_rule_batch;
+	ecm_sfe_ipv6_rule_batch = NULL;
+	spin_unlock_bh(&ecm_sfe_ipv6_rule_batch_lock);
+
+	if (batch) {
+		ecm_sfe_ipv6_rule_batch_send(batch);
+	}
+}
+
+/*
+ * ecm_sfe_ipv6_rule_batch_timer_callback()
+ *	The coalescing window has closed, send whatever has been collected.
+ */
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4, 15, 0))
+static void ecm_sfe_ipv6_rule_batch_timer_callback(struct timer_list *arg)
+#else
+static void ecm_sfe_ipv6_rule_batch_timer_callback(unsigned long data)
+#endif /*KERNEL_VERSION(4, 15, 0)*/
+{
+	ecm_sfe_ipv6_rule_batch_flush();
+}
+
+/*
+ * ecm_sfe_ipv6_rule_tx()
+ *	Queue a create/destroy rule message for the sfe driver.
+ *
+ * The message is copied so the caller may release it on return.  As with sfe_drv_ipv6_tx()
+ * the response is delivered to the callback given in the message header, but only once the
+ * batch holding it has been processed.
+ */
+sfe_tx_status_t ecm_sfe_ipv6_rule_tx(struct sfe_ipv6_msg *nim)
+{
+	struct sfe_ipv6_batch_msg *batch;
+	struct sfe_ipv6_batch_msg *full = NULL;
+	uint32_t batch_max;
+
+	batch_max = min_t(uint32_t, READ_ONCE(ecm_sfe_ipv6_rule_batch_max), SFE_RULE_BATCH_MAX);
+	if (batch_max <= 1) {
+		return sfe_drv_ipv6_tx(ecm_sfe_ipv6_drv_mgr, nim);
+	}
+
+	spin_lock_bh(&ecm_sfe_ipv6_rule_batch_lock);
+	if (unlikely(ecm_sfe_ipv6_rule_batch_stopped)) {
+		spin_unlock_bh(&ecm_sfe_ipv6_rule_batch_lock);
+		return sfe_drv_ipv6_tx(ecm_sfe_ipv6_drv_mgr, nim);
+	}
+
+	batch = ecm_sfe_ipv6_rule_batch;
+	if (!batch) {
+		batch = (struct sfe_ipv6_batch_msg *)kmalloc(sizeof(struct sfe_ipv6_batch_msg), GFP_ATOMIC | __GFP_NOWARN);
+		if (!batch) {
+			spin_unlock_bh(&ecm_sfe_ipv6_rule_batch_lock);
+			return sfe_drv_ipv6_tx(ecm_sfe_ipv6_drv_mgr, nim);
+		}
+
+		sfe_ipv6_batch_msg_init(batch, SFE_SPECIAL_INTERFACE_IPV6, ecm_sfe_ipv6_rule_batch_callback, NULL);
+		ecm_sfe_ipv6_rule_batch = batch;
+		mod_timer(&ecm_sfe_ipv6_rule_batch_timer, jiffies + 1);
+	}
+
+	memcpy(&batch->msgs[batch->num_msgs++], nim, sizeof(struct sfe_ipv6_msg));
+	if (batch->num_msgs >= batch_max) {
+		ecm_sfe_ipv6_rule_batch = NULL;
+		full = batch;
+	}
+	spin_unlock_bh(&ecm_sfe_ipv6_rule_batch_lock);
+
+	if (full) {
+		ecm_sfe_ipv6_rule_batch_send(full);
+	}
+
+	return SFE_TX_SUCCESS;
+}
+
 /*
  * ecm_sfe_ipv6_stats_sync_callback()
  *	Callback handler from the sfe driver.
@@ -1192,6 +1529,13 @@ static void ecm_sfe_ipv6_stats_sync_callback(void *app_data, struct sfe_ipv6_msg
 				neigh_release(neigh);
 			}
 #endif
+		} else {
+			/*
+			 * Bridged flows bypass the bridge so refresh its FDB entries for
+			 * the hosts ourselves, along with any VLAN interface statistics.
+			 */
+			ecm_interface_stats_update(ci, sync->flow_tx_packet_count, sync->flow_tx_byte_count, sync->flow_rx_packet_count, sync->flow_rx_byte_count,
+							sync->return_tx_packet_count, sync->return_tx_byte_count, sync->return_rx_packet_count, sync->return_rx_byte_count);
 		}
 	}
 
@@ -1378,6 +1722,20 @@ static struct nf_hook_ops ecm_sfe_ipv6_netfilter_hooks[] __read_mostly = {
 		.hooknum        = NF_INET_POST_ROUTING,
 		.priority       = NF_IP6_PRI_NAT_SRC + 1,
 	},
+
+	/*
+	 * The bridge post routing hook monitors packets going to interfaces that are part of a bridge arrangement.
+	 * For example Wireles LAN (WLAN) and Wired LAN (LAN).
+	 */
+	{
+		.hook		= ecm_sfe_ipv6_bridge_post_routing_hook,
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(4, 4, 0))
+		.owner		= THIS_MODULE,
+#endif
+		.pf		= PF_BRIDGE,
+		.hooknum	= NF_BR_POST_ROUTING,
+		.priority	= NF_BR_PRI_FILTER_OTHER,
+	},
 };
 
 /*
@@ -1601,6 +1959,24 @@ int ecm_sfe_ipv6_init(struct dentry *dentry)
 		goto task_cleanup;
 	}
 
+	if (!debugfs_create_u32("rule_batch_max", S_IRUGO | S_IWUSR, ecm_sfe_ipv6_dentry,
+					(u32 *)&ecm_sfe_ipv6_rule_batch_max)) {
+		DEBUG_ERROR("Failed to create ecm sfe ipv6 rule_batch_max file in debugfs\n");
+		goto task_cleanup;
+	}
+
+	if (!debugfs_create_u32("rule_batch_sent", S_IRUGO, ecm_sfe_ipv6_dentry,
+					(u32 *)&ecm_sfe_ipv6_rule_batch_sent)) {
+		DEBUG_ERROR("Failed to create ecm sfe ipv6 rule_batch_sent file in debugfs\n");
+		goto task_cleanup;
+	}
+
+	if (!debugfs_create_u32("rule_batch_msgs", S_IRUGO, ecm_sfe_ipv6_dentry,
+					(u32 *)&ecm_sfe_ipv6_rule_batch_msgs)) {
+		DEBUG_ERROR("Failed to create ecm sfe ipv6 rule_batch_msgs file in debugfs\n");
+		goto task_cleanup;
+	}
+
 	if (!ecm_sfe_ported_ipv6_debugfs_init(ecm_sfe_ipv6_dentry)) {
 		DEBUG_ERROR("Failed to create ecm ported files in debugfs\n");
 		goto task_cleanup;
@@ -1627,6 +2003,14 @@ int ecm_sfe_ipv6_init(struct dentry *dentry)
 	 */
 	ecm_sfe_ipv6_drv_mgr = sfe_drv_ipv6_notify_register(ecm_sfe_ipv6_stats_sync_callback, NULL);
 
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4, 15, 0))
+	timer_setup(&ecm_sfe_ipv6_rule_batch_timer, ecm_sfe_ipv6_rule_batch_timer_callback, 0);
+#else
+	init_timer(&ecm_sfe_ipv6_rule_batch_timer);
+	ecm_sfe_ipv6_rule_batch_timer.function = ecm_sfe_ipv6_rule_batch_timer_callback;
+	ecm_sfe_ipv6_rule_batch_timer.data = 0;
+#endif /*KERNEL_VERSION(4, 15, 0)*/
+
 	/*
 	 * Register netfilter hooks
 	 */
@@ -1638,7 +2022,14 @@ int ecm_sfe_ipv6_init(struct dentry *dentry)
 	}
 
 #ifdef ECM_MULTICAST_ENABLE
-	ecm_sfe_multicast_ipv6_init();
+	result = ecm_sfe_multicast_ipv6_init(ecm_sfe_ipv6_dentry);
+	if (result < 0) {
+		DEBUG_ERROR("Failed to init ecm ipv6 multicast frontend\n");
+		sfe_drv_ipv6_notify_unregister();
+		nf_unregister_net_hooks(&init_net, ecm_sfe_ipv6_netfilter_hooks,
+				ARRAY_SIZE(ecm_sfe_ipv6_netfilter_hooks));
+		goto task_cleanup;
+	}
 #endif
 	return 0;
 
@@ -1665,6 +2056,16 @@ void ecm_sfe_ipv6_exit(void)
 	nf_unregister_net_hooks(&init_net, ecm_sfe_ipv6_netfilter_hooks,
 			    ARRAY_SIZE(ecm_sfe_ipv6_netfilter_hooks));
 
+	/*
+	 * Send any rule messages still waiting to be batched.  Batching is stopped first so
+	 * that a concurrent ecm_sfe_ipv6_rule_tx() cannot start a new batch and re-arm the timer.
+	 */
+	spin_lock_bh(&ecm_sfe_ipv6_rule_batch_lock);
+	ecm_sfe_ipv6_rule_batch_stopped = true;
+	spin_unlock_bh(&ecm_sfe_ipv6_rule_batch_lock);
+	ecm_sfe_ipv6_rule_batch_flush();
+	del_timer_sync(&ecm_sfe_ipv6_rule_batch_timer);
+
 	/*
 	 * Unregister from the Linux SFE Network driver
 	 */
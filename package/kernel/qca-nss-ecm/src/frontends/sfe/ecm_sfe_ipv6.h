@@ -50,6 +50,12 @@ extern bool ecm_sfe_ipv6_terminate_pending;		/* True when the user has signalled
  */
 extern struct sfe_drv_ctx_instance *ecm_sfe_ipv6_drv_mgr;
 
+/*
+ * Rule message batching
+ */
+extern uint32_t ecm_sfe_ipv6_rule_batch_max;			/* Maximum rule messages per batch */
+extern sfe_tx_status_t ecm_sfe_ipv6_rule_tx(struct sfe_ipv6_msg *nim);
+
 /*
  * ecm_sfe_ipv6_accel_pending_set()
  *	Set pending acceleration for the connection object.
@@ -529,6 +529,17 @@ static void ecm_sfe_ported_ipv4_connection_accelerate(struct ecm_front_end_conne
 			memcpy(nircm->pppoe_rule.flow_pppoe_remote_mac, pppoe_info.remote_mac, ETH_ALEN);
 			nircm->valid_flags |= SFE_RULE_CREATE_PPPOE_VALID;
 
+			/*
+			 * SFE adds and removes the PPPoE header itself so it wants the
+			 * interface the session is carried on, the one below the PPPoE.
+			 */
+			if (list_index == from_ifaces_first) {
+				DEBUG_TRACE("%p: PPPoE - no carrier interface\n", npci);
+				rule_invalid = true;
+				break;
+			}
+			nircm->conn_rule.flow_interface_num = ecm_db_iface_ae_interface_identifier_get(from_ifaces[list_index - 1]);
+
 			DEBUG_TRACE("%p: PPPoE - session: %x, mac: %pM\n", npci,
 					nircm->pppoe_rule.flow_pppoe_session_id,
 					nircm->pppoe_rule.flow_pppoe_remote_mac);
@@ -696,6 +707,17 @@ static void ecm_sfe_ported_ipv4_connection_accelerate(struct ecm_front_end_conne
 			memcpy(nircm->pppoe_rule.return_pppoe_remote_mac, pppoe_info.remote_mac, ETH_ALEN);
 			nircm->valid_flags |= SFE_RULE_CREATE_PPPOE_VALID;
 
+			/*
+			 * SFE adds and removes the PPPoE header itself so it wants the
+			 * interface the session is carried on, the one below the PPPoE.
+			 */
+			if (list_index == to_ifaces_first) {
+				DEBUG_TRACE("%p: PPPoE - no carrier interface\n", npci);
+				rule_invalid = true;
+				break;
+			}
+			nircm->conn_rule.return_interface_num = ecm_db_iface_ae_interface_identifier_get(to_ifaces[list_index - 1]);
+
 			DEBUG_TRACE("%p: PPPoE - session: %x, mac: %pM\n", npci,
 				    nircm->pppoe_rule.return_pppoe_session_id,
 				    nircm->pppoe_rule.return_pppoe_remote_mac);
@@ -1119,7 +1141,7 @@ static void ecm_sfe_ported_ipv4_connection_accelerate(struct ecm_front_end_conne
 	/*
 	 * Call the rule create function
 	 */
-	sfe_tx_status = sfe_drv_ipv4_tx(ecm_sfe_ipv4_drv_mgr, &nim);
+	sfe_tx_status = ecm_sfe_ipv4_rule_tx(&nim);
 	if (sfe_tx_status == SFE_TX_SUCCESS) {
 		/*
 		 * Reset the driver_fail count - transmission was okay here.
@@ -1380,7 +1402,7 @@ static void ecm_sfe_ported_ipv4_connection_decelerate(struct ecm_front_end_conne
 	/*
 	 * Destroy the SFE connection cache entry.
 	 */
-	sfe_tx_status = sfe_drv_ipv4_tx(ecm_sfe_ipv4_drv_mgr, &nim);
+	sfe_tx_status = ecm_sfe_ipv4_rule_tx(&nim);
 	if (sfe_tx_status == SFE_TX_SUCCESS) {
 		/*
 		 * Reset the driver_fail count - transmission was okay here.
@@ -32,10 +32,16 @@
 #include <linux/netfilter/xt_dscp.h>
 #include <linux/if_bridge.h>
 #include <linux/version.h>
+#ifdef SFE_SUPPORT_PPPOE
+#include <linux/if_arp.h>
+#include <linux/ppp_channel.h>
+#endif
 
 #include "sfe.h"
 #include "sfe_cm.h"
 #include "sfe_backport.h"
+#include "sfe_vlan.h"
+#include "sfe_tun.h"
 
 typedef enum sfe_cm_exception {
 	SFE_CM_EXCEPTION_PACKET_BROADCAST,
@@ -115,6 +121,64 @@ static inline void sfe_cm_incr_exceptions(sfe_cm_exception_t except)
 	spin_unlock_bh(&sc->lock);
 }
 
+/*
+ * sfe_cm_ipv4_dev_ok()
+ *	Check that a device is one we can forward IPv4 packets from.
+ */
+static inline bool sfe_cm_ipv4_dev_ok(struct net_device *dev)
+{
+	struct in_device *in_dev;
+
+	/*
+	 * Does our input device support IP processing?
+	 */
+	in_dev = (struct in_device *)dev->ip_ptr;
+	if (unlikely(!in_dev)) {
+		DEBUG_TRACE("no IP processing for device: %s\n", dev->name);
+		return false;
+	}
+
+	/*
+	 * Does it have an IP address?  If it doesn't then we can't do anything
+	 * interesting here!
+	 */
+	if (unlikely(!in_dev->ifa_list)) {
+		DEBUG_TRACE("no IP address for device: %s\n", dev->name);
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * sfe_cm_ipv6_dev_ok()
+ *	Check that a device is one we can forward IPv6 packets from.
+ */
+static inline bool sfe_cm_ipv6_dev_ok(struct net_device *dev)
+{
+	struct inet6_dev *in_dev;
+
+	/*
+	 * Does our input device support IPv6 processing?
+	 */
+	in_dev = (struct inet6_dev *)dev->ip6_ptr;
+	if (unlikely(!in_dev)) {
+		DEBUG_TRACE("no IPv6 processing for device: %s\n", dev->name);
+		return false;
+	}
+
+	/*
+	 * Does it have an IPv6 address?  If it doesn't then we can't do anything
+	 * interesting here!
+	 */
+	if (unlikely(list_empty(&in_dev->addr_list))) {
+		DEBUG_TRACE("no IPv6 address for device: %s\n", dev->name);
+		return false;
+	}
+
+	return true;
+}
+
 /*
  * sfe_cm_recv()
  *	Handle packet receives.
@@ -124,6 +188,7 @@ static inline void sfe_cm_incr_exceptions(sfe_cm_exception_t except)
 int sfe_cm_recv(struct sk_buff *skb)
 {
 	struct net_device *dev;
+	__be16 proto;
 
 	/*
 	 * We know that for the vast majority of packets we need the transport
@@ -135,59 +200,118 @@ int sfe_cm_recv(struct sk_buff *skb)
 	dev = skb->dev;
 
 	/*
-	 * We're only interested in IPv4 and IPv6 packets.
+	 * VLAN tagged packets are seen first on the real device, and PPPoE
+	 * sessions on their carrier device.  Those don't normally have IP
+	 * addresses so we don't check them.
 	 */
-	if (likely(htons(ETH_P_IP) == skb->protocol)) {
-		struct in_device *in_dev;
+	if (unlikely(skb_vlan_tag_present(skb) ||
+		     ((htons(ETH_P_IP) != skb->protocol) && (htons(ETH_P_IPV6) != skb->protocol)))) {
+		proto = sfe_tun_l3_proto(skb, sfe_vlan_l3_proto(skb));
+		if (proto == htons(ETH_P_IP)) {
+			return sfe_ipv4_recv(dev, skb);
+		}
 
-		/*
-		 * Does our input device support IP processing?
-		 */
-		in_dev = (struct in_device *)dev->ip_ptr;
-		if (unlikely(!in_dev)) {
-			DEBUG_TRACE("no IP processing for device: %s\n", dev->name);
-			return 0;
+		if (proto == htons(ETH_P_IPV6)) {
+			return sfe_ipv6_recv(dev, skb);
 		}
 
-		/*
-		 * Does it have an IP address?  If it doesn't then we can't do anything
-		 * interesting here!
-		 */
-		if (unlikely(!in_dev->ifa_list)) {
-			DEBUG_TRACE("no IP address for device: %s\n", dev->name);
+		DEBUG_TRACE("not IP packet\n");
+		return 0;
+	}
+
+	/*
+	 * We're only interested in IPv4 and IPv6 packets.  The device has to
+	 * handle the outer protocol of tunnelled packets, which are passed on
+	 * to the protocol they carry.
+	 */
+	if (likely(htons(ETH_P_IP) == skb->protocol)) {
+		if (unlikely(!sfe_cm_ipv4_dev_ok(dev))) {
 			return 0;
 		}
+	} else if (unlikely(!sfe_cm_ipv6_dev_ok(dev))) {
+		return 0;
+	}
 
+	proto = sfe_tun_l3_proto(skb, skb->protocol);
+	if (likely(htons(ETH_P_IP) == proto)) {
 		return sfe_ipv4_recv(dev, skb);
 	}
 
-	if (likely(htons(ETH_P_IPV6) == skb->protocol)) {
-		struct inet6_dev *in_dev;
+	return sfe_ipv6_recv(dev, skb);
+}
+
+/*
+ * sfe_recv_list()
+ *	Handle a batch of packet receives, such as those gathered by a NAPI poll.
+ *
+ * Packets that are forwarded are removed from the list.  Those that aren't are
+ * left on it for our caller to pass up the stack, e.g. with
+ * netif_receive_skb_list().  The order of packets within each IP version is
+ * preserved.
+ *
+ * Compared with calling sfe_recv() for each packet this saves an RCU read-side
+ * section per packet and, for consecutive packets of one flow, the hash
+ * lookup.  Forwarded packets are still sent one dev_queue_xmit() at a time,
+ * without xmit_more.
+ */
+void sfe_recv_list(struct list_head *head)
+{
+	struct sk_buff *skb;
+	struct sk_buff *tmp;
+	__be16 proto;
+	LIST_HEAD(ipv4_list);
+	LIST_HEAD(ipv6_list);
+
+	/*
+	 * Sort the packets by IP version in one pass so that each address family
+	 * handles its packets as a single batch.
+	 */
+	list_for_each_entry_safe(skb, tmp, head, list) {
+		prefetch(skb->data + 32);
 
 		/*
-		 * Does our input device support IPv6 processing?
+		 * As in sfe_cm_recv() we don't check the devices VLAN tagged and
+		 * PPPoE session packets are seen on.
 		 */
-		in_dev = (struct inet6_dev *)dev->ip6_ptr;
-		if (unlikely(!in_dev)) {
-			DEBUG_TRACE("no IPv6 processing for device: %s\n", dev->name);
-			return 0;
+		if (unlikely(skb_vlan_tag_present(skb) ||
+			     ((htons(ETH_P_IP) != skb->protocol) && (htons(ETH_P_IPV6) != skb->protocol)))) {
+			proto = sfe_tun_l3_proto(skb, sfe_vlan_l3_proto(skb));
+			if (proto == htons(ETH_P_IP)) {
+				list_move_tail(&skb->list, &ipv4_list);
+			} else if (proto == htons(ETH_P_IPV6)) {
+				list_move_tail(&skb->list, &ipv6_list);
+			} else {
+				DEBUG_TRACE("not IP packet\n");
+			}
+			continue;
 		}
 
-		/*
-		 * Does it have an IPv6 address?  If it doesn't then we can't do anything
-		 * interesting here!
-		 */
-		if (unlikely(list_empty(&in_dev->addr_list))) {
-			DEBUG_TRACE("no IPv6 address for device: %s\n", dev->name);
-			return 0;
+		if (likely(htons(ETH_P_IP) == skb->protocol)) {
+			if (unlikely(!sfe_cm_ipv4_dev_ok(skb->dev))) {
+				continue;
+			}
+		} else if (unlikely(!sfe_cm_ipv6_dev_ok(skb->dev))) {
+			continue;
+		}
+
+		if (likely(htons(ETH_P_IP) == sfe_tun_l3_proto(skb, skb->protocol))) {
+			list_move_tail(&skb->list, &ipv4_list);
+		} else {
+			list_move_tail(&skb->list, &ipv6_list);
 		}
+	}
 
-		return sfe_ipv6_recv(dev, skb);
+	if (!list_empty(&ipv4_list)) {
+		sfe_ipv4_recv_list(&ipv4_list);
+		list_splice_tail(&ipv4_list, head);
 	}
 
-	DEBUG_TRACE("not IP packet\n");
-	return 0;
+	if (!list_empty(&ipv6_list)) {
+		sfe_ipv6_recv_list(&ipv6_list);
+		list_splice_tail(&ipv6_list, head);
+	}
 }
+EXPORT_SYMBOL(sfe_recv_list);
 
 /*
  * sfe_cm_find_dev_and_mac_addr()
@@ -276,6 +400,64 @@ ret_fail:
 	return false;
 }
 
+#ifdef SFE_SUPPORT_PPPOE
+/*
+ * sfe_cm_pppoe_dev_get()
+ *	If dev is a PPPoE session device then return the device that carries the session.
+ *
+ * The session id (in host order) and the MAC address of the remote end are
+ * returned via session_id and remote_mac.  The carrier device is returned held
+ * and the caller must dev_put() it.  Returns NULL if dev isn't a PPPoE session.
+ */
+static struct net_device *sfe_cm_pppoe_dev_get(struct net_device *dev, u16 *session_id, u8 *remote_mac)
+{
+	struct ppp_channel *ppp_chan[1];
+	struct pppoe_opt addressing;
+
+	if ((dev->type != ARPHRD_PPP) || !(dev->flags & IFF_POINTOPOINT)) {
+		return NULL;
+	}
+
+	/*
+	 * We can't handle multilink PPP as packets could go out on any of the links.
+	 */
+	if (ppp_is_multilink(dev) > 0) {
+		DEBUG_TRACE("%s: multilink PPP\n", dev->name);
+		return NULL;
+	}
+
+	if (ppp_hold_channels(dev, ppp_chan, 1) != 1) {
+		DEBUG_TRACE("%s: no single PPP channel\n", dev->name);
+		return NULL;
+	}
+
+	if (ppp_channel_get_protocol(ppp_chan[0]) != PX_PROTO_OE) {
+		ppp_release_channels(ppp_chan, 1);
+		DEBUG_TRACE("%s: PPP channel isn't PPPoE\n", dev->name);
+		return NULL;
+	}
+
+	/*
+	 * The carrier device is returned held.
+	 */
+	pppoe_channel_addressing_get(ppp_chan[0], &addressing);
+	ppp_release_channels(ppp_chan, 1);
+
+	if (!addressing.dev) {
+		DEBUG_TRACE("%s: PPPoE session has no carrier device\n", dev->name);
+		return NULL;
+	}
+
+	*session_id = ntohs(addressing.pa.sid);
+	memcpy(remote_mac, addressing.pa.remote, ETH_ALEN);
+
+	DEBUG_TRACE("%s: PPPoE session: %x, carrier: %s, remote mac: %pM\n",
+		    dev->name, *session_id, addressing.dev->name, remote_mac);
+
+	return addressing.dev;
+}
+#endif
+
 /*
  * sfe_cm_post_routing()
  *	Called for packets about to leave the box - either locally generated or forwarded from another interface
@@ -293,6 +475,12 @@ static unsigned int sfe_cm_post_routing(struct sk_buff *skb, int is_v4)
 	struct net_device *dest_dev_tmp;
 	struct net_device *src_br_dev = NULL;
 	struct net_device *dest_br_dev = NULL;
+#ifdef SFE_SUPPORT_PPPOE
+	struct net_device *src_pppoe_dev = NULL;
+	struct net_device *dest_pppoe_dev = NULL;
+#endif
+	struct net_device *src_vlan_dev;
+	struct net_device *dest_vlan_dev;
 	struct nf_conntrack_tuple orig_tuple;
 	struct nf_conntrack_tuple reply_tuple;
 	SFE_NF_CONN_ACCT(acct);
@@ -409,6 +597,12 @@ static unsigned int sfe_cm_post_routing(struct sk_buff *skb, int is_v4)
 
 	sic.flags = 0;
 
+	/*
+	 * We leave policing to the qdiscs, so don't police the connection here.
+	 */
+	memset(&sic.src_police, 0, sizeof(sic.src_police));
+	memset(&sic.dest_police, 0, sizeof(sic.dest_police));
+
 	/*
 	 * Get addressing information, non-NAT first
 	 */
@@ -612,18 +806,69 @@ static unsigned int sfe_cm_post_routing(struct sk_buff *skb, int is_v4)
 		dest_dev = dest_br_dev;
 	}
 
-	sic.src_dev = src_dev;
-	sic.dest_dev = dest_dev;
-
 	sic.src_mtu = src_dev->mtu;
 	sic.dest_mtu = dest_dev->mtu;
 
+#ifdef SFE_SUPPORT_PPPOE
+	/*
+	 * For PPPoE sessions the SFE adds and removes the PPPoE header itself so
+	 * it wants the device that carries the session, not the PPP device.  The
+	 * MTUs are still those of the PPP devices.
+	 */
+	src_pppoe_dev = sfe_cm_pppoe_dev_get(src_dev, &sic.src_pppoe_session_id, sic.src_pppoe_remote_mac);
+	if (src_pppoe_dev) {
+		sic.flags |= SFE_CREATE_FLAG_SRC_PPPOE;
+		src_dev = src_pppoe_dev;
+	}
+
+	dest_pppoe_dev = sfe_cm_pppoe_dev_get(dest_dev, &sic.dest_pppoe_session_id, sic.dest_pppoe_remote_mac);
+	if (dest_pppoe_dev) {
+		sic.flags |= SFE_CREATE_FLAG_DEST_PPPOE;
+		dest_dev = dest_pppoe_dev;
+	}
+#endif
+
+	/*
+	 * The SFE also adds and removes VLAN tags itself so it wants the real
+	 * device underneath any VLAN devices.
+	 */
+	sic.src_vlan_count = 0;
+	src_vlan_dev = sfe_vlan_real_dev_get(src_dev, skb->priority, sic.src_vlan_tag, &sic.src_vlan_count);
+	if (src_vlan_dev) {
+		src_dev = src_vlan_dev;
+	}
+
+	sic.dest_vlan_count = 0;
+	dest_vlan_dev = sfe_vlan_real_dev_get(dest_dev, skb->priority, sic.dest_vlan_tag, &sic.dest_vlan_count);
+	if (dest_vlan_dev) {
+		dest_dev = dest_vlan_dev;
+	}
+
+	sic.src_dev = src_dev;
+	sic.dest_dev = dest_dev;
+
 	if (likely(is_v4)) {
 		sfe_ipv4_create_rule(&sic);
 	} else {
 		sfe_ipv6_create_rule(&sic);
 	}
 
+	if (dest_vlan_dev) {
+		dev_put(dest_vlan_dev);
+	}
+	if (src_vlan_dev) {
+		dev_put(src_vlan_dev);
+	}
+
+#ifdef SFE_SUPPORT_PPPOE
+	if (dest_pppoe_dev) {
+		dev_put(dest_pppoe_dev);
+	}
+	if (src_pppoe_dev) {
+		dev_put(src_pppoe_dev);
+	}
+#endif
+
 	/*
 	 * If we had bridge ports then release them too.
 	 */
@@ -931,6 +1176,23 @@ int sfe_cm_device_event(struct notifier_block *this, unsigned long event, void *
 	struct net_device *dev = SFE_DEV_EVENT_PTR(ptr);
 
 	if (dev && (event == NETDEV_DOWN)) {
+		/*
+		 * Rules for a VLAN device refer to the real device underneath it so
+		 * we can't tell which ones belong to it.
+		 */
+		if (is_vlan_dev(dev)) {
+			dev = NULL;
+		}
+#ifdef SFE_SUPPORT_PPPOE
+
+		/*
+		 * Likewise rules for a PPPoE session refer to its carrier device
+		 * rather than the PPP device.
+		 */
+		if (dev && (dev->type == ARPHRD_PPP)) {
+			dev = NULL;
+		}
+#endif
 		sfe_ipv4_destroy_all_rules_for_dev(dev);
 		sfe_ipv6_destroy_all_rules_for_dev(dev);
 	}
@@ -24,6 +24,26 @@
 					/* Indicates that we should remark priority of skb */
 #define SFE_CREATE_FLAG_REMARK_DSCP BIT(2)
 					/* Indicates that we should remark DSCP of packet */
+#define SFE_CREATE_FLAG_SRC_PPPOE BIT(3)
+					/* Indicates that the source side is a PPPoE session */
+#define SFE_CREATE_FLAG_DEST_PPPOE BIT(4)
+					/* Indicates that the destination side is a PPPoE session */
+#define SFE_CREATE_FLAG_BRIDGE_FLOW BIT(5)
+					/* Indicates that the connection is bridged rather than routed */
+#define SFE_CREATE_FLAG_SRC_TUN BIT(6)
+					/* Indicates that the source side is reached through a tunnel */
+#define SFE_CREATE_FLAG_DEST_TUN BIT(7)
+					/* Indicates that the destination side is reached through a tunnel */
+
+/*
+ * Maximum number of VLAN tags (802.1Q or QinQ) on either side of a connection.
+ */
+#define SFE_MAX_VLAN_DEPTH 2
+
+/*
+ * Maximum number of egress interfaces of a multicast connection.
+ */
+#define SFE_MAX_MC_IF 16
 
 /*
  * IPv6 address structure
@@ -37,8 +57,90 @@ typedef union {
 	struct sfe_ipv6_addr	ip6[1];
 } sfe_ip_addr_t;
 
+/*
+ * tunnel types.
+ */
+enum sfe_tun_type {
+	SFE_TUN_TYPE_NONE,		/* Not tunnelled */
+	SFE_TUN_TYPE_6RD,		/* IPv6 in IPv4 (6rd, 6in4) */
+	SFE_TUN_TYPE_IPIP6,		/* IPv4 in IPv6 (DS-Lite) */
+	SFE_TUN_TYPE_GRE,		/* IPv4 or IPv6 in GRE over IPv4 */
+};
+
+/*
+ * tunnel flags.
+ */
+#define SFE_TUN_FLAG_DF BIT(0)
+					/* Set DF in the outer IPv4 header */
+#define SFE_TUN_FLAG_INHERIT_TTL BIT(1)
+					/* Copy the outer TTL or hop limit from the inner header */
+#define SFE_TUN_FLAG_INHERIT_TOS BIT(2)
+					/* Copy the outer TOS or traffic class from the inner header */
+#define SFE_TUN_FLAG_GRE_KEY BIT(3)
+					/* GRE packets carry a key */
+#define SFE_TUN_FLAG_ENCAP_LIMIT BIT(4)
+					/* Add a tunnel encapsulation limit option to the outer IPv6 header */
+
+/*
+ * tunnel endpoint.
+ *
+ * Describes the outer headers of one side of a connection.  local_ip is our
+ * end of the tunnel and remote_ip the peer's.  The addresses are IPv4 for
+ * 6rd and GRE and IPv6 for IPIP6.
+ */
+struct sfe_tun {
+	u8 type;
+	u8 flags;
+	u8 ttl;
+	u8 tos;
+	u8 encap_limit;
+	sfe_ip_addr_t local_ip;
+	sfe_ip_addr_t remote_ip;
+	__be32 flowlabel;
+	__be32 gre_key;
+};
+
+/*
+ * policer actions for packets that exceed the rate.
+ */
+#define SFE_POLICE_ACTION_DROP 0
+					/* Drop the packet */
+#define SFE_POLICE_ACTION_REMARK_DSCP 1
+					/* Forward the packet with its DSCP remarked */
+
+/*
+ * policer of one direction of a connection.
+ *
+ * The direction's packets are measured against a token bucket of burst bytes
+ * that fills at rate bytes per second.  Lengths are those of the IP packets.
+ * A rate of 0 means the direction isn't policed.
+ */
+struct sfe_police_cfg {
+	u64 rate;
+	u32 burst;
+	u8 action;
+	u8 dscp;
+};
+
 /*
  * connection creation structure.
+ *
+ * When a side is a PPPoE session its device is the one carrying the session,
+ * not the PPP device, and the SFE adds and removes the PPPoE header itself.
+ *
+ * Likewise when a side is reached through VLAN devices its device is the real
+ * device underneath them and the SFE adds and removes the VLAN tags.  Tags are
+ * (TPID << 16) | TCI, outermost first.
+ *
+ * When a side is reached through a tunnel its device is the one carrying the
+ * tunnelled packets, its MAC is that of the next hop on that device and its
+ * MTU is the tunnel's.  The SFE adds and removes the outer headers itself.
+ *
+ * For bridged connections the devices are the bridge ports and the addresses
+ * and ports are never translated.
+ *
+ * src_police polices the packets the source sends and dest_police those the
+ * destination sends.
  */
 struct sfe_connection_create {
 	int protocol;
@@ -76,6 +178,79 @@ struct sfe_connection_create {
 	u32 dest_priority;
 	u32 src_dscp;
 	u32 dest_dscp;
+	u16 src_pppoe_session_id;
+	u8 src_pppoe_remote_mac[ETH_ALEN];
+	u16 dest_pppoe_session_id;
+	u8 dest_pppoe_remote_mac[ETH_ALEN];
+	u32 src_vlan_tag[SFE_MAX_VLAN_DEPTH];
+	u32 dest_vlan_tag[SFE_MAX_VLAN_DEPTH];
+	u8 src_vlan_count;
+	u8 dest_vlan_count;
+	struct sfe_tun src_tun;
+	struct sfe_tun dest_tun;
+	struct sfe_police_cfg src_police;
+	struct sfe_police_cfg dest_police;
+};
+
+/*
+ * multicast egress interface flags.
+ */
+#define SFE_MC_XMIT_IF_FLAG_BRIDGE_FLOW BIT(0)
+					/* Indicates that the interface is a bridge port, so packets are not routed */
+#define SFE_MC_XMIT_IF_FLAG_JOIN BIT(1)
+					/* Indicates that the interface joins the group (updates only) */
+#define SFE_MC_XMIT_IF_FLAG_LEAVE BIT(2)
+					/* Indicates that the interface leaves the group (updates only) */
+
+/*
+ * multicast egress interface.
+ *
+ * As for unicast connections the device is the one carrying any PPPoE
+ * session or VLAN tags and the SFE adds the headers itself, pppoe_session_id
+ * being 0 if there is no session.  src_mac is the source MAC for routed
+ * interfaces; bridge ports keep the packet's own.
+ */
+struct sfe_mc_xmit_if {
+	struct net_device *dev;
+	u32 flags;
+	u32 mtu;
+	u8 src_mac[ETH_ALEN];
+	u16 pppoe_session_id;
+	u8 pppoe_remote_mac[ETH_ALEN];
+	u32 vlan_tag[SFE_MAX_VLAN_DEPTH];
+	u8 vlan_count;
+};
+
+/*
+ * multicast connection creation structure.
+ *
+ * A multicast connection matches UDP packets from src_ip to the group
+ * dest_ip on src_dev and sends a copy out of each of the egress interfaces,
+ * all with the group MAC dest_mac as destination.  Addresses and ports are
+ * never translated.  Only SFE_CREATE_FLAG_REMARK_PRIORITY,
+ * SFE_CREATE_FLAG_REMARK_DSCP and SFE_CREATE_FLAG_SRC_PPPOE apply.
+ *
+ * The same structure updates the egress interfaces of an existing
+ * connection, in which case only the interfaces flagged to join or leave
+ * are looked at.
+ */
+struct sfe_mc_connection_create {
+	int protocol;
+	struct net_device *src_dev;
+	u32 flags;
+	sfe_ip_addr_t src_ip;
+	sfe_ip_addr_t dest_ip;
+	__be16 src_port;
+	__be16 dest_port;
+	u8 dest_mac[ETH_ALEN];
+	u32 mark;
+	u32 priority;
+	u32 dscp;
+	u16 src_pppoe_session_id;
+	u32 src_vlan_tag[SFE_MAX_VLAN_DEPTH];
+	u8 src_vlan_count;
+	u8 xmit_if_count;
+	struct sfe_mc_xmit_if xmit_if[SFE_MAX_MC_IF];
 };
 
 /*
@@ -149,6 +324,11 @@ struct sfe_connection_mark {
  */
 extern int (*athrs_fast_nat_recv)(struct sk_buff *skb);
 
+/*
+ * Batched receive entry point for drivers, provided by the connection manager.
+ */
+void sfe_recv_list(struct list_head *head);
+
 /*
  * Expose what should be a static flag in the TCP connection tracker.
  */
@@ -164,34 +344,54 @@ extern int nf_ct_tcp_no_window_check;
  */
 typedef void (*sfe_sync_rule_callback_t)(struct sfe_connection_sync *);
 
+/*
+ * Optional callback used by the periodic sync to hand over
+ * several connections' state in one call.  Syncs caused by
+ * flushes and destroys still go through the single callback.
+ */
+typedef void (*sfe_sync_rule_batch_callback_t)(struct sfe_connection_sync *sis, unsigned int count);
+
 /*
  * IPv4 APIs used by connection manager
  */
 int sfe_ipv4_recv(struct net_device *dev, struct sk_buff *skb);
+void sfe_ipv4_recv_list(struct list_head *head);
 int sfe_ipv4_create_rule(struct sfe_connection_create *sic);
 void sfe_ipv4_destroy_rule(struct sfe_connection_destroy *sid);
 void sfe_ipv4_destroy_all_rules_for_dev(struct net_device *dev);
 void sfe_ipv4_register_sync_rule_callback(sfe_sync_rule_callback_t callback);
+void sfe_ipv4_register_sync_rule_batch_callback(sfe_sync_rule_batch_callback_t callback);
 void sfe_ipv4_update_rule(struct sfe_connection_create *sic);
 void sfe_ipv4_mark_rule(struct sfe_connection_mark *mark);
+int sfe_ipv4_create_mc_rule(struct sfe_mc_connection_create *smc);
+int sfe_ipv4_update_mc_rule(struct sfe_mc_connection_create *smc);
 
 #ifdef SFE_SUPPORT_IPV6
 /*
  * IPv6 APIs used by connection manager
  */
 int sfe_ipv6_recv(struct net_device *dev, struct sk_buff *skb);
+void sfe_ipv6_recv_list(struct list_head *head);
 int sfe_ipv6_create_rule(struct sfe_connection_create *sic);
 void sfe_ipv6_destroy_rule(struct sfe_connection_destroy *sid);
 void sfe_ipv6_destroy_all_rules_for_dev(struct net_device *dev);
 void sfe_ipv6_register_sync_rule_callback(sfe_sync_rule_callback_t callback);
+void sfe_ipv6_register_sync_rule_batch_callback(sfe_sync_rule_batch_callback_t callback);
 void sfe_ipv6_update_rule(struct sfe_connection_create *sic);
 void sfe_ipv6_mark_rule(struct sfe_connection_mark *mark);
+int sfe_ipv6_create_mc_rule(struct sfe_mc_connection_create *smc);
+int sfe_ipv6_update_mc_rule(struct sfe_mc_connection_create *smc);
 #else
 static inline int sfe_ipv6_recv(struct net_device *dev, struct sk_buff *skb)
 {
 	return 0;
 }
 
+static inline void sfe_ipv6_recv_list(struct list_head *head)
+{
+	return;
+}
+
 static inline int sfe_ipv6_create_rule(struct sfe_connection_create *sic)
 {
 	return 0;
@@ -212,6 +412,11 @@ static inline void sfe_ipv6_register_sync_rule_callback(sfe_sync_rule_callback_t
 	return;
 }
 
+static inline void sfe_ipv6_register_sync_rule_batch_callback(sfe_sync_rule_batch_callback_t callback)
+{
+	return;
+}
+
 static inline void sfe_ipv6_update_rule(struct sfe_connection_create *sic)
 {
 	return;
@@ -221,6 +426,16 @@ static inline void sfe_ipv6_mark_rule(struct sfe_connection_mark *mark)
 {
 	return;
 }
+
+static inline int sfe_ipv6_create_mc_rule(struct sfe_mc_connection_create *smc)
+{
+	return 0;
+}
+
+static inline int sfe_ipv6_update_mc_rule(struct sfe_mc_connection_create *smc)
+{
+	return 0;
+}
 #endif
 
 /*
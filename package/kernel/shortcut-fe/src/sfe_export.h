@@ -0,0 +1,81 @@
+/*
+ * sfe_export.h
+ *	Shortcut forwarding engine binary connection export.
+ *
+ * Copyright (c) 2013-2016 The Linux Foundation. All rights reserved.
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+ * OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Opening minor SFE_EXPORT_MINOR of the sfe_ipv4 or sfe_ipv6 debug char device
+ * takes a snapshot of the connection table.  The snapshot is a struct
+ * sfe_export_hdr followed by num_records struct sfe_export_conn records and
+ * can be read() or mmap()ed until the file is closed.
+ *
+ * This header is shared with userspace.
+ */
+#ifndef __SFE_EXPORT_H
+#define __SFE_EXPORT_H
+
+#include <linux/types.h>
+
+#define SFE_EXPORT_MINOR 1
+#define SFE_EXPORT_MAGIC 0x53464558	/* "SFEX" */
+#define SFE_EXPORT_VERSION 1
+
+/*
+ * Snapshot flags.
+ */
+#define SFE_EXPORT_FLAG_IPV6 0x1	/* Records hold IPv6 addresses, otherwise only addr[0] is used */
+#define SFE_EXPORT_FLAG_TRUNCATED 0x2	/* Connections were added while the snapshot was taken and some are missing */
+
+/*
+ * Snapshot header.
+ */
+struct sfe_export_hdr {
+	__u32 magic;			/* SFE_EXPORT_MAGIC */
+	__u16 version;			/* SFE_EXPORT_VERSION */
+	__u16 record_size;		/* Size of each connection record */
+	__u32 num_records;		/* Number of connection records following the header */
+	__u32 flags;			/* SFE_EXPORT_FLAG_... */
+};
+
+/*
+ * Connection record.  Addresses and ports are in network byte order.
+ */
+struct sfe_export_conn {
+	__be32 src_ip[4];		/* Src IP addr pre-translation */
+	__be32 src_ip_xlate[4];		/* Src IP addr post-translation */
+	__be32 dest_ip[4];		/* Dest IP addr pre-translation */
+	__be32 dest_ip_xlate[4];	/* Dest IP addr post-translation */
+	__be16 src_port;		/* Src port pre-translation */
+	__be16 src_port_xlate;		/* Src port post-translation */
+	__be16 dest_port;		/* Dest port pre-translation */
+	__be16 dest_port_xlate;		/* Dest port post-translation */
+	__u32 src_ifindex;		/* Original direction source device */
+	__u32 dest_ifindex;		/* Reply direction source device */
+	__u32 src_priority;		/* Original direction priority */
+	__u32 dest_priority;		/* Reply direction priority */
+	__u32 mark;			/* mark for outgoing packet */
+	__u8 protocol;			/* IP protocol number */
+	__u8 src_dscp;			/* Original direction DSCP */
+	__u8 dest_dscp;			/* Reply direction DSCP */
+	__u8 reserved0;
+	__u64 src_rx_packets;		/* Packets received in the original direction */
+	__u64 src_rx_bytes;		/* Bytes received in the original direction */
+	__u64 dest_rx_packets;		/* Packets received in the reply direction */
+	__u64 dest_rx_bytes;		/* Bytes received in the reply direction */
+	__u32 last_sync_ms;		/* Time since the connection was last synced to the connection manager */
+	__u32 reserved1;
+};
+
+#endif /* __SFE_EXPORT_H */
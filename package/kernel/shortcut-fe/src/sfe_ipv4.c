@@ -22,9 +22,23 @@
 #include <net/tcp.h>
 #include <linux/etherdevice.h>
 #include <linux/version.h>
+#include <linux/rculist.h>
+#include <linux/u64_stats_sync.h>
+#include <linux/jhash.h>
+#include <linux/random.h>
+#include <linux/workqueue.h>
+#include <linux/mm.h>
+#include <linux/log2.h>
+#include <linux/sched/clock.h>
+#include <linux/vmalloc.h>
 
 #include "sfe.h"
 #include "sfe_cm.h"
+#include "sfe_export.h"
+#include "sfe_pppoe.h"
+#include "sfe_vlan.h"
+#include "sfe_tun.h"
+#include "sfe_police.h"
 
 /*
  * By default Linux IP header and transport layer header structures are
@@ -57,6 +71,12 @@ struct sfe_ipv4_eth_hdr {
 #define SFE_IPV4_DSCP_MASK 0x3
 #define SFE_IPV4_DSCP_SHIFT 2
 
+/*
+ * IP checksum adjustment for decrementing the TTL, which is the high byte of
+ * its 16-bit word.
+ */
+#define SFE_IPV4_TTL_DEC_CSUM_ADJUSTMENT ((u16)~(__force u16)htons(0x0100))
+
 /*
  * An IPv4 header, but with an optional "packed" attribute to
  * help with performance on some platforms (see the definition of
@@ -171,93 +191,187 @@ struct sfe_ipv4_tcp_connection_match {
 					/* remark priority of SKB */
 #define SFE_IPV4_CONNECTION_MATCH_FLAG_DSCP_REMARK (1<<6)
 					/* remark DSCP of packet */
+#define SFE_IPV4_CONNECTION_MATCH_FLAG_PPPOE_DECAP (1<<7)
+					/* Strip the PPPoE session header of received packets */
+#define SFE_IPV4_CONNECTION_MATCH_FLAG_PPPOE_ENCAP (1<<8)
+					/* Add a PPPoE session header to transmitted packets */
+#define SFE_IPV4_CONNECTION_MATCH_FLAG_BRIDGE_FLOW (1<<9)
+					/* Bridged connection, don't route */
+#define SFE_IPV4_CONNECTION_MATCH_FLAG_MULTICAST (1<<10)
+					/* Multicast connection, transmit on each of mc_xmit's interfaces */
+#define SFE_IPV4_CONNECTION_MATCH_FLAG_TUN_DECAP (1<<11)
+					/* Strip the tunnel headers of received packets */
+#define SFE_IPV4_CONNECTION_MATCH_FLAG_TUN_ENCAP (1<<12)
+					/* Add tunnel headers to transmitted packets */
+
+/*
+ * Per-CPU packet and byte counters for a connection match entry.
+ *
+ * These are only ever incremented by the fast path on the local CPU and are
+ * folded into the summary stats when the connection is synced.
+ */
+struct sfe_ipv4_connection_match_stats {
+	u64 rx_packet_count;		/* Packets received on this CPU */
+	u64 rx_byte_count;		/* Bytes received on this CPU */
+	struct u64_stats_sync syncp;	/* Protects 64-bit reads on 32-bit hosts */
+};
+
+/*
+ * Bit flags for IPv4 multicast egress interfaces.
+ */
+#define SFE_IPV4_MC_XMIT_IF_FLAG_BRIDGE_FLOW (1<<0)
+					/* Bridge port, don't route and keep the source MAC address */
+#define SFE_IPV4_MC_XMIT_IF_FLAG_WRITE_L2_HDR (1<<1)
+					/* Write an L2 header */
+#define SFE_IPV4_MC_XMIT_IF_FLAG_WRITE_FAST_ETH_HDR (1<<2)
+					/* Fast Ethernet header write */
+#define SFE_IPV4_MC_XMIT_IF_FLAG_PPPOE_ENCAP (1<<3)
+					/* Add a PPPoE session header */
+
+/*
+ * IPv4 multicast egress interface.
+ */
+struct sfe_ipv4_mc_xmit_if {
+	struct net_device *xmit_dev;	/* Network device on which to transmit */
+	u32 flags;			/* Bit flags */
+	unsigned short int xmit_dev_mtu;
+					/* Interface MTU */
+	u16 xmit_headroom;		/* Headroom needed for the headers we add */
+	u16 xmit_dest_mac[ETH_ALEN / 2];
+					/* Destination MAC address, the group's or the PPPoE peer's */
+	u16 xmit_src_mac[ETH_ALEN / 2];
+					/* Source MAC address to use when routing */
+	__be16 xmit_pppoe_session_id;	/* PPPoE session to transmit on */
+	u8 xmit_vlan_count;		/* Number of VLAN tags to add to transmitted packets */
+	u32 xmit_vlan_tag[SFE_MAX_VLAN_DEPTH];
+					/* VLAN tags to add to transmitted packets, outermost first */
+};
+
+/*
+ * IPv4 multicast egress interface list.
+ *
+ * The list is never changed once it's published.  Updates replace the whole
+ * list and free the old one once fast path readers are done with it.
+ */
+struct sfe_ipv4_mc_xmit {
+	struct rcu_head rcu;		/* Used to defer freeing until fast path readers are done */
+	unsigned short int min_mtu;	/* Smallest MTU of the interfaces */
+	bool routed;			/* At least one interface is routed */
+	bool bridged;			/* At least one interface is a bridge port */
+	u8 count;			/* Number of interfaces */
+	struct sfe_ipv4_mc_xmit_if xif[SFE_MAX_MC_IF];
+};
 
 /*
  * IPv4 connection matching structure.
  */
 struct sfe_ipv4_connection_match {
 	/*
-	 * References to other objects.
+	 * The fields are ordered so that a hash lookup and the rewrite of a packet
+	 * that needs no optional processing only touch the start of the structure:
+	 * three 32-byte cache lines on 32-bit platforms.  Fields that are only
+	 * used for some packets or connections come next and the ones only used by
+	 * the control path last.  Keep it that way when adding fields.
 	 */
-	struct sfe_ipv4_connection_match *next;
-	struct sfe_ipv4_connection_match *prev;
-	struct sfe_ipv4_connection *connection;
-	struct sfe_ipv4_connection_match *counter_match;
-					/* Matches the flow in the opposite direction as the one in *connection */
-	struct sfe_ipv4_connection_match *active_next;
-	struct sfe_ipv4_connection_match *active_prev;
-	bool active;			/* Flag to indicate if we're on the active list */
 
 	/*
-	 * Characteristics that identify flows that match this rule.
+	 * Characteristics that identify flows that match this rule, compared by
+	 * every hash lookup.
 	 */
-	struct net_device *match_dev;	/* Network device */
-	u8 match_protocol;		/* Protocol */
+	struct hlist_node hnode;	/* Connection match hash chain linkage, RCU protected */
 	__be32 match_src_ip;		/* Source IP address */
 	__be32 match_dest_ip;		/* Destination IP address */
 	__be16 match_src_port;		/* Source port/connection ident */
 	__be16 match_dest_port;		/* Destination port/connection ident */
-
-	/*
-	 * Control the operations of the match.
-	 */
+	u8 match_protocol;		/* Protocol */
+	u8 match_vlan_count;		/* Number of VLAN tags of received packets */
+	__be16 match_pppoe_session_id;	/* PPPoE session of received packets, 0 if none */
+	struct net_device *match_dev;	/* Network device */
 	u32 flags;			/* Bit flags */
-#ifdef CONFIG_NF_FLOW_COOKIE
-	u32 flow_cookie;		/* used flow cookie, for debug */
-#endif
-#ifdef CONFIG_XFRM
-	u32 flow_accel;             /* The flow accelerated or not */
-#endif
-
-	/*
-	 * Connection state that we track once we match.
-	 */
-	union {				/* Protocol-specific state */
-		struct sfe_ipv4_tcp_connection_match tcp;
-	} protocol_state;
-	/*
-	 * Stats recorded in a sync period. These stats will be added to
-	 * rx_packet_count64/rx_byte_count64 after a sync period.
-	 */
-	u32 rx_packet_count;
-	u32 rx_byte_count;
 
 	/*
 	 * Packet translation information.
 	 */
 	__be32 xlate_src_ip;		/* Address after source translation */
+	__be32 xlate_dest_ip;		/* Address after destination translation */
 	__be16 xlate_src_port;	/* Port/connection ident after source translation */
+	__be16 xlate_dest_port;	/* Port/connection ident after destination translation */
 	u16 xlate_src_csum_adjustment;
 					/* Transport layer checksum adjustment after source translation */
-	u16 xlate_src_partial_csum_adjustment;
-					/* Transport layer pseudo header checksum adjustment after source translation */
-
-	__be32 xlate_dest_ip;		/* Address after destination translation */
-	__be16 xlate_dest_port;	/* Port/connection ident after destination translation */
 	u16 xlate_dest_csum_adjustment;
 					/* Transport layer checksum adjustment after destination translation */
+	u16 xlate_src_partial_csum_adjustment;
+					/* Transport layer pseudo header checksum adjustment after source translation */
 	u16 xlate_dest_partial_csum_adjustment;
 					/* Transport layer pseudo header checksum adjustment after destination translation */
-
-	/*
-	 * QoS information
-	 */
-	u32 priority;
-	u32 dscp;
+	u16 ip_csum_adjustment;
+					/* IP header checksum adjustment for the TTL decrement and address translations */
 
 	/*
 	 * Packet transmit information.
 	 */
-	struct net_device *xmit_dev;	/* Network device on which to transmit */
+	u16 xmit_headroom;		/* Headroom needed for the headers we add, 0 if just the L2 header */
 	unsigned short int xmit_dev_mtu;
 					/* Interface MTU */
+	struct net_device *xmit_dev;	/* Network device on which to transmit */
 	u16 xmit_dest_mac[ETH_ALEN / 2];
 					/* Destination MAC address to use when forwarding */
 	u16 xmit_src_mac[ETH_ALEN / 2];
 					/* Source MAC address to use when forwarding */
+	__be16 xmit_pppoe_session_id;	/* PPPoE session to transmit on */
+	u8 xmit_vlan_count;		/* Number of VLAN tags to add to transmitted packets */
+	bool active;			/* Flag to indicate if we're on the active list */
+	struct sfe_ipv4_connection *connection;
+
+	/*
+	 * Per-CPU stats updated by the fast path without taking any lock. These
+	 * are summed into rx_packet_count64/rx_byte_count64 at sync time.
+	 */
+	struct sfe_ipv4_connection_match_stats __percpu *stats;
+
+	/*
+	 * QoS information
+	 */
+	u32 priority;
+	u32 dscp;
+
+	/*
+	 * Connection state that we track once we match.
+	 */
+	struct sfe_ipv4_connection_match *counter_match;
+					/* Matches the flow in the opposite direction as the one in *connection */
+	union {				/* Protocol-specific state */
+		struct sfe_ipv4_tcp_connection_match tcp;
+	} protocol_state;
+#ifdef CONFIG_XFRM
+	u32 flow_accel;             /* The flow accelerated or not */
+#endif
+	struct sfe_police *police;	/* Policer, NULL if the flow isn't policed */
+
+	/*
+	 * Encapsulations of received and transmitted packets.
+	 */
+	struct sfe_tun_info match_tun;	/* Tunnel headers of received packets */
+	u32 match_vlan_tag[SFE_MAX_VLAN_DEPTH];
+					/* VLAN tags of received packets, outermost first */
+	u32 xmit_vlan_tag[SFE_MAX_VLAN_DEPTH];
+					/* VLAN tags to add to transmitted packets, outermost first */
+	struct sfe_tun_xmit xmit_tun;	/* Tunnel headers to add to transmitted packets */
+	struct sfe_ipv4_mc_xmit __rcu *mc_xmit;
+					/* Interfaces to transmit on for multicast connections, NULL otherwise */
+
+	/*
+	 * Control path state.
+	 */
+	struct sfe_ipv4_connection_match *active_next;
+	struct sfe_ipv4_connection_match *active_prev;
+	unsigned long active_jiffies;	/* Time at which we were put on the active list */
+#ifdef CONFIG_NF_FLOW_COOKIE
+	u32 flow_cookie;		/* used flow cookie, for debug */
+#endif
 
 	/*
-	 * Summary stats.
+	 * Summary stats, as of the last sync.
 	 */
 	u64 rx_packet_count64;
 	u64 rx_byte_count64;
@@ -294,25 +408,93 @@ struct sfe_ipv4_connection {
 					/* Pointer to the previous entry in the list of all connections */
 	u32 mark;			/* mark for outgoing packet */
 	u32 debug_read_seq;		/* sequence number for debug dump */
+	spinlock_t lock;		/* Protects the TCP state of both connection match entries */
+	bool removed;			/* Connection has been removed from the hash tables */
+	struct rcu_head rcu;		/* Used to defer freeing until fast path readers are done */
 };
 
 /*
  * IPv4 connections and hash table size information.
+ *
+ * The connection and connection match hash tables always have the same number
+ * of buckets and are resized together as connections come and go.
  */
 #define SFE_IPV4_CONNECTION_HASH_SHIFT 12
 #define SFE_IPV4_CONNECTION_HASH_SIZE (1 << SFE_IPV4_CONNECTION_HASH_SHIFT)
-#define SFE_IPV4_CONNECTION_HASH_MASK (SFE_IPV4_CONNECTION_HASH_SIZE - 1)
+					/* Default initial size */
+#define SFE_IPV4_CONNECTION_HASH_SHIFT_MIN 4
+#define SFE_IPV4_CONNECTION_HASH_SHIFT_MAX 17
+
+/*
+ * Number of entries in the chain length and hit depth histograms.  The last
+ * entry counts everything at or beyond that length.
+ */
+#define SFE_IPV4_CONNECTION_HASH_HISTOGRAM_SIZE 8
+
+/*
+ * Periodic sync tuning.  Each tick syncs enough of the active list to get round
+ * all of it once every SFE_IPV4_SYNC_TICKS_PER_PASS ticks, handing the records over
+ * in batches of up to SFE_IPV4_SYNC_BATCH_SIZE, unless it runs out of CPU budget first.
+ */
+#define SFE_IPV4_SYNC_PERIOD ((HZ + 99) / 100)
+#define SFE_IPV4_SYNC_TICKS_PER_PASS 64
+#define SFE_IPV4_SYNC_BATCH_SIZE 16
+#define SFE_IPV4_SYNC_BUDGET_US 500
+					/* Default CPU time each tick may use */
+
+/*
+ * IPv4 connection hash tables.
+ */
+struct sfe_ipv4_connection_hash {
+	unsigned int shift;		/* log2 of the number of buckets */
+	u32 seed;			/* Random key for the hash function */
+	struct sfe_ipv4_connection **conn_hash;
+					/* Connection hash table */
+	struct hlist_head *conn_match_hash;
+					/* Connection match hash table, RCU protected for fast path lookups */
+};
 
 #ifdef CONFIG_NF_FLOW_COOKIE
 #define SFE_FLOW_COOKIE_SIZE 2048
 #define SFE_FLOW_COOKIE_MASK 0x7ff
 
 struct sfe_flow_cookie_entry {
-	struct sfe_ipv4_connection_match *match;
+	struct sfe_ipv4_connection_match __rcu *match;
 	unsigned long last_clean_time;
 };
 #endif
 
+/*
+ * IPv4 fragment tracking.
+ *
+ * Only the first fragment of a UDP datagram carries its ports.  When we forward
+ * one we note the ports against the datagram, and the datagram's other fragments
+ * find their connection through them.  The table is direct mapped; a datagram
+ * that can't have an entry is left to the slow path in its entirety.
+ */
+#define SFE_IPV4_FRAG_TABLE_SIZE 1024
+#define SFE_IPV4_FRAG_TABLE_MASK (SFE_IPV4_FRAG_TABLE_SIZE - 1)
+#define SFE_IPV4_FRAG_TIMEOUT (HZ / 2)
+
+enum sfe_ipv4_frag_state {
+	SFE_IPV4_FRAG_STATE_FREE,	/* Entry not in use */
+	SFE_IPV4_FRAG_STATE_FORWARD,	/* Datagram is being forwarded by us */
+	SFE_IPV4_FRAG_STATE_SLOW,	/* Datagram is being passed to the slow path */
+};
+
+struct sfe_ipv4_frag {
+	__be32 src_ip;			/* Source IP address of the datagram */
+	__be32 dest_ip;			/* Destination IP address of the datagram */
+	__be16 id;			/* IP ID of the datagram */
+	u8 protocol;			/* Protocol of the datagram */
+	u8 state;			/* enum sfe_ipv4_frag_state */
+	__be16 src_port;		/* Source port carried by the first fragment */
+	__be16 dest_port;		/* Destination port carried by the first fragment */
+	u16 len_seen;			/* Number of payload bytes seen so far */
+	u16 len_total;			/* Payload length of the datagram, 0 until the last fragment is seen */
+	unsigned long timeout;		/* Time (jiffies) after which the entry is free again */
+};
+
 enum sfe_ipv4_exception_events {
 	SFE_IPV4_EXCEPTION_EVENT_UDP_HEADER_INCOMPLETE,
 	SFE_IPV4_EXCEPTION_EVENT_UDP_NO_CONNECTION,
@@ -351,6 +533,17 @@ enum sfe_ipv4_exception_events {
 	SFE_IPV4_EXCEPTION_EVENT_IP_OPTIONS_INCOMPLETE,
 	SFE_IPV4_EXCEPTION_EVENT_UNHANDLED_PROTOCOL,
 	SFE_IPV4_EXCEPTION_EVENT_CLONED_SKB_UNSHARE_ERROR,
+	SFE_IPV4_EXCEPTION_EVENT_PPPOE_HEADER_INVALID,
+	SFE_IPV4_EXCEPTION_EVENT_PPPOE_SESSION_MISMATCH,
+	SFE_IPV4_EXCEPTION_EVENT_NO_HEADROOM,
+	SFE_IPV4_EXCEPTION_EVENT_VLAN_HEADER_INVALID,
+	SFE_IPV4_EXCEPTION_EVENT_VLAN_MISMATCH,
+	SFE_IPV4_EXCEPTION_EVENT_BRIDGE_MAC_MISMATCH,
+	SFE_IPV4_EXCEPTION_EVENT_MULTICAST_CLONE_FAILED,
+	SFE_IPV4_EXCEPTION_EVENT_TUN_HEADER_INVALID,
+	SFE_IPV4_EXCEPTION_EVENT_TUN_MISMATCH,
+	SFE_IPV4_EXCEPTION_EVENT_UDP_FRAGMENT_NOT_TRACKED,
+	SFE_IPV4_EXCEPTION_EVENT_GSO_NOT_SUPPORTED,
 	SFE_IPV4_EXCEPTION_EVENT_LAST
 };
 
@@ -391,14 +584,88 @@ static char *sfe_ipv4_exception_events_string[SFE_IPV4_EXCEPTION_EVENT_LAST] = {
 	"DATAGRAM_INCOMPLETE",
 	"IP_OPTIONS_INCOMPLETE",
 	"UNHANDLED_PROTOCOL",
-	"CLONED_SKB_UNSHARE_ERROR"
+	"CLONED_SKB_UNSHARE_ERROR",
+	"PPPOE_HEADER_INVALID",
+	"PPPOE_SESSION_MISMATCH",
+	"NO_HEADROOM",
+	"VLAN_HEADER_INVALID",
+	"VLAN_MISMATCH",
+	"BRIDGE_MAC_MISMATCH",
+	"MULTICAST_CLONE_FAILED",
+	"TUN_HEADER_INVALID",
+	"TUN_MISMATCH",
+	"UDP_FRAGMENT_NOT_TRACKED",
+	"GSO_NOT_SUPPORTED"
+};
+
+/*
+ * Per-CPU statistics.
+ *
+ * Both the forwarding and the exception paths update these without taking the
+ * module lock; they are summed into the summary statistics by
+ * sfe_ipv4_update_summary_stats().
+ */
+struct sfe_ipv4_stats {
+	u64 connection_create_requests;	/* Number of IPv4 connection create requests */
+	u64 connection_create_collisions;
+					/* Number of IPv4 connection create requests that collided with existing hash table entries */
+	u64 connection_destroy_requests;
+					/* Number of IPv4 connection destroy requests */
+	u64 connection_destroy_misses;	/* Number of IPv4 connection destroy requests that missed our hash table */
+	u64 connection_flushes;		/* Number of IPv4 connection flushes */
+	u64 connection_match_hash_hits;	/* Number of IPv4 connection match hash hits */
+	u64 connection_match_hash_hit_depths[SFE_IPV4_CONNECTION_HASH_HISTOGRAM_SIZE];
+					/* Number of hash hits at each position in a chain */
+	u64 packets_forwarded;		/* Number of IPv4 packets forwarded */
+	u64 packets_not_forwarded;	/* Number of IPv4 packets not forwarded */
+	u64 packets_policed;		/* Number of IPv4 packets dropped by connection policers */
+	u64 exception_events[SFE_IPV4_EXCEPTION_EVENT_LAST];
+					/* Number of each IPv4 exception event */
+	struct u64_stats_sync syncp;	/* Protects 64-bit reads on 32-bit hosts */
 };
 
 /*
  * Per-module structure.
+ *
+ * The fields used by the packet path are read mostly and are kept apart from
+ * the lock and the state the control path writes under it, so that rule
+ * churn does not keep stealing the cache line forwarding depends on.
  */
 struct sfe_ipv4 {
-	spinlock_t lock;		/* Lock for SMP correctness */
+	/*
+	 * Read mostly, used by the packet path.
+	 */
+	struct sfe_ipv4_connection_hash __rcu *hash;
+					/* Connection and connection match hash tables */
+	struct sfe_ipv4_stats __percpu *stats;
+					/* Per-CPU statistics */
+	sfe_sync_rule_callback_t __rcu sync_rule_callback;
+					/* Callback function registered by a connection manager for stats syncing */
+	sfe_sync_rule_batch_callback_t __rcu sync_rule_batch_callback;
+					/* Callback function registered by a connection manager for periodic stats syncing in batches */
+#ifdef CONFIG_NF_FLOW_COOKIE
+	int flow_cookie_enable;
+					/* Enable/disable flow cookie at runtime */
+	flow_cookie_set_func_t flow_cookie_set_func;
+					/* function used to configure flow cookie in hardware*/
+	struct sfe_flow_cookie_entry sfe_flow_cookie_table[SFE_FLOW_COOKIE_SIZE];
+					/* flow cookie table*/
+#endif
+
+	/*
+	 * Written by the packet path under the fragment lock.
+	 */
+	spinlock_t frag_lock ____cacheline_aligned_in_smp;
+					/* Lock for the fragment table */
+	u32 frag_seed;			/* Random key for the fragment table hash */
+	struct sfe_ipv4_frag frag_table[SFE_IPV4_FRAG_TABLE_SIZE];
+					/* Fragmented datagrams being tracked */
+
+	/*
+	 * Written by the control path under the lock.
+	 */
+	spinlock_t lock ____cacheline_aligned_in_smp;
+					/* Lock for SMP correctness */
 	struct sfe_ipv4_connection_match *active_head;
 					/* Head of the list of recently active connections */
 	struct sfe_ipv4_connection_match *active_tail;
@@ -409,41 +676,17 @@ struct sfe_ipv4 {
 					/* Tail of the list of all connections */
 	unsigned int num_connections;	/* Number of connections */
 	struct timer_list timer;	/* Timer used for periodic sync ops */
-	sfe_sync_rule_callback_t __rcu sync_rule_callback;
-					/* Callback function registered by a connection manager for stats syncing */
-	struct sfe_ipv4_connection *conn_hash[SFE_IPV4_CONNECTION_HASH_SIZE];
-					/* Connection hash table */
-	struct sfe_ipv4_connection_match *conn_match_hash[SFE_IPV4_CONNECTION_HASH_SIZE];
-					/* Connection match hash table */
-#ifdef CONFIG_NF_FLOW_COOKIE
-	struct sfe_flow_cookie_entry sfe_flow_cookie_table[SFE_FLOW_COOKIE_SIZE];
-					/* flow cookie table*/
-	flow_cookie_set_func_t flow_cookie_set_func;
-					/* function used to configure flow cookie in hardware*/
-	int flow_cookie_enable;
-					/* Enable/disable flow cookie at runtime */
-#endif
-
-	/*
-	 * Stats recorded in a sync period. These stats will be added to
-	 * connection_xxx64 after a sync period.
-	 */
-	u32 connection_create_requests;
-					/* Number of IPv4 connection create requests */
-	u32 connection_create_collisions;
-					/* Number of IPv4 connection create requests that collided with existing hash table entries */
-	u32 connection_destroy_requests;
-					/* Number of IPv4 connection destroy requests */
-	u32 connection_destroy_misses;
-					/* Number of IPv4 connection destroy requests that missed our hash table */
-	u32 connection_match_hash_hits;
-					/* Number of IPv4 connection match hash hits */
-	u32 connection_match_hash_reorders;
-					/* Number of IPv4 connection match hash reorders */
-	u32 connection_flushes;		/* Number of IPv4 connection flushes */
-	u32 packets_forwarded;		/* Number of IPv4 packets forwarded */
-	u32 packets_not_forwarded;	/* Number of IPv4 packets not forwarded */
-	u32 exception_events[SFE_IPV4_EXCEPTION_EVENT_LAST];
+	unsigned int hash_min_shift;	/* Size below which the hash tables are never shrunk */
+	struct work_struct hash_resize_work;
+					/* Resizes the hash tables outside of the packet path */
+	u64 hash_resizes;		/* Number of times the hash tables have been resized */
+	unsigned int active_count;	/* Number of connection match entries on the active list */
+	unsigned int sync_budget_us;	/* CPU time each periodic sync may use */
+	u64 sync_records;		/* Number of connection states synced by the periodic sync */
+	u64 sync_batches;		/* Number of batches the periodic sync handed them over in */
+	u64 sync_budget_overruns;	/* Number of periodic syncs cut short by their CPU budget */
+	struct sfe_connection_sync sync_batch[SFE_IPV4_SYNC_BATCH_SIZE];
+					/* Batch of connection states being handed over by the periodic sync */
 
 	/*
 	 * Summary statistics.
@@ -458,14 +701,20 @@ struct sfe_ipv4 {
 					/* Number of IPv4 connection destroy requests that missed our hash table */
 	u64 connection_match_hash_hits64;
 					/* Number of IPv4 connection match hash hits */
-	u64 connection_match_hash_reorders64;
-					/* Number of IPv4 connection match hash reorders */
+	u64 connection_match_hash_hit_depths64[SFE_IPV4_CONNECTION_HASH_HISTOGRAM_SIZE];
+					/* Number of IPv4 connection match hash hits at each position in a chain */
 	u64 connection_flushes64;	/* Number of IPv4 connection flushes */
 	u64 packets_forwarded64;	/* Number of IPv4 packets forwarded */
 	u64 packets_not_forwarded64;
 					/* Number of IPv4 packets not forwarded */
+	u64 packets_policed64;		/* Number of IPv4 packets dropped by connection policers */
 	u64 exception_events64[SFE_IPV4_EXCEPTION_EVENT_LAST];
 
+	/*
+	 * Totals of the per-CPU statistics as of the last summary update.
+	 */
+	struct sfe_ipv4_stats stats_folded;
+
 	/*
 	 * Control state.
 	 */
@@ -486,6 +735,7 @@ enum sfe_ipv4_debug_xml_states {
 	SFE_IPV4_DEBUG_XML_STATE_EXCEPTIONS_EXCEPTION,
 	SFE_IPV4_DEBUG_XML_STATE_EXCEPTIONS_END,
 	SFE_IPV4_DEBUG_XML_STATE_STATS,
+	SFE_IPV4_DEBUG_XML_STATE_HASH,
 	SFE_IPV4_DEBUG_XML_STATE_END,
 	SFE_IPV4_DEBUG_XML_STATE_DONE
 };
@@ -502,25 +752,36 @@ struct sfe_ipv4_debug_xml_write_state {
 typedef bool (*sfe_ipv4_debug_xml_write_method_t)(struct sfe_ipv4 *si, char *buffer, char *msg, size_t *length,
 						  int *total_read, struct sfe_ipv4_debug_xml_write_state *ws);
 
+/*
+ * State carried from one packet to the next while handling a batch of packets
+ * passed to sfe_ipv4_recv_list().
+ */
+struct sfe_ipv4_recv_batch {
+	struct sfe_ipv4_connection_match *last_cm;
+					/* Connection match used for the previous packet */
+	struct sk_buff_head xmit_queue;	/* Forwarded packets waiting to be transmitted */
+};
+
 static struct sfe_ipv4 __si;
 
 /*
- * sfe_ipv4_gen_ip_csum()
- *	Generate the IP checksum for an IPv4 header.
+ * Initial number of connection hash buckets, rounded up to a power of two.  The
+ * hash tables grow from here as connections are added.
+ */
+static unsigned int hash_size = SFE_IPV4_CONNECTION_HASH_SIZE;
+module_param(hash_size, uint, 0444);
+MODULE_PARM_DESC(hash_size, "Initial number of IPv4 connection hash buckets");
+
+/*
+ * sfe_ipv4_update_ip_csum()
+ *	Update the IP checksum of an IPv4 header incrementally, as in RFC1624.
  *
- * Note that this function assumes that we have only 20 bytes of IP header.
+ * adj is the ones-complement sum of the differences between the new and old
+ * values of the 16-bit words of the header that have changed.
  */
-static inline u16 sfe_ipv4_gen_ip_csum(struct sfe_ipv4_ip_hdr *iph)
+static inline void sfe_ipv4_update_ip_csum(struct sfe_ipv4_ip_hdr *iph, u32 adj)
 {
-	u32 sum;
-	u16 *i = (u16 *)iph;
-
-	iph->check = 0;
-
-	/*
-	 * Generate the sum.
-	 */
-	sum = i[0] + i[1] + i[2] + i[3] + i[4] + i[5] + i[6] + i[7] + i[8] + i[9];
+	u32 sum = (u16)~(__force u16)iph->check + adj;
 
 	/*
 	 * Fold it to ones-complement form.
@@ -528,138 +789,388 @@ static inline u16 sfe_ipv4_gen_ip_csum(struct sfe_ipv4_ip_hdr *iph)
 	sum = (sum & 0xffff) + (sum >> 16);
 	sum = (sum & 0xffff) + (sum >> 16);
 
-	return (u16)sum ^ 0xffff;
+	iph->check = (__force __sum16)~sum;
 }
 
 /*
- * sfe_ipv4_get_connection_match_hash()
- *	Generate the hash used in connection match lookups.
+ * sfe_ipv4_remark_dscp()
+ *	Remark the DSCP of an IPv4 header and return the IP checksum adjustment for it.
  */
-static inline unsigned int sfe_ipv4_get_connection_match_hash(struct net_device *dev, u8 protocol,
-							      __be32 src_ip, __be16 src_port,
-							      __be32 dest_ip, __be16 dest_port)
+static inline u32 sfe_ipv4_remark_dscp(struct sfe_ipv4_ip_hdr *iph, u32 dscp)
 {
-	size_t dev_addr = (size_t)dev;
-	u32 hash = ((u32)dev_addr) ^ ntohl(src_ip ^ dest_ip) ^ protocol ^ ntohs(src_port ^ dest_port);
-	return ((hash >> SFE_IPV4_CONNECTION_HASH_SHIFT) ^ hash) & SFE_IPV4_CONNECTION_HASH_MASK;
+	u16 old_word = *(u16 *)iph;
+
+	iph->tos = (iph->tos & SFE_IPV4_DSCP_MASK) | dscp;
+	return (u16)~old_word + *(u16 *)iph;
 }
 
 /*
- * sfe_ipv4_find_sfe_ipv4_connection_match()
- *	Get the IPv4 flow match info that corresponds to a particular 5-tuple.
+ * sfe_ipv4_police()
+ *	Police a packet of length len, remarking its DSCP if it exceeds the rate.
  *
- * On entry we must be holding the lock that protects the hash table.
+ * Returns false if the packet must be dropped instead.
  */
-static struct sfe_ipv4_connection_match *
-sfe_ipv4_find_sfe_ipv4_connection_match(struct sfe_ipv4 *si, struct net_device *dev, u8 protocol,
-					__be32 src_ip, __be16 src_port,
-					__be32 dest_ip, __be16 dest_port)
+static inline bool sfe_ipv4_police(struct sfe_police *p, struct sfe_ipv4_ip_hdr *iph, unsigned int len, u32 *ip_csum_adj)
 {
-	struct sfe_ipv4_connection_match *cm;
-	struct sfe_ipv4_connection_match *head;
-	unsigned int conn_match_idx;
-
-	conn_match_idx = sfe_ipv4_get_connection_match_hash(dev, protocol, src_ip, src_port, dest_ip, dest_port);
-	cm = si->conn_match_hash[conn_match_idx];
-
-	/*
-	 * If we don't have anything in this chain then bail.
-	 */
-	if (unlikely(!cm)) {
-		return NULL;
+	if (likely(sfe_police_conform(p, len))) {
+		return true;
 	}
 
-	/*
-	 * Hopefully the first entry is the one we want.
-	 */
-	if ((cm->match_src_port == src_port)
-	    && (cm->match_dest_port == dest_port)
-	    && (cm->match_src_ip == src_ip)
-	    && (cm->match_dest_ip == dest_ip)
-	    && (cm->match_protocol == protocol)
-	    && (cm->match_dev == dev)) {
-		si->connection_match_hash_hits++;
-		return cm;
+	if (p->action == SFE_POLICE_ACTION_DROP) {
+		return false;
 	}
 
-	/*
-	 * Unfortunately we didn't find it at head, so we search it in chain and
-	 * move matching entry to the top of the hash chain. We presume that this
-	 * will be reused again very quickly.
-	 */
-	head = cm;
-	do {
-		cm = cm->next;
-	} while (cm && (cm->match_src_port != src_port
-		 || cm->match_dest_port != dest_port
-		 || cm->match_src_ip != src_ip
-		 || cm->match_dest_ip != dest_ip
-		 || cm->match_protocol != protocol
-		 || cm->match_dev != dev));
+	*ip_csum_adj += sfe_ipv4_remark_dscp(iph, p->dscp << SFE_IPV4_DSCP_SHIFT);
+	return true;
+}
 
-	/*
-	 * Not found then we're done.
-	 */
-	if (unlikely(!cm)) {
+/*
+ * sfe_ipv4_connection_hash_alloc()
+ *	Allocate a set of empty hash tables.
+ */
+static struct sfe_ipv4_connection_hash *sfe_ipv4_connection_hash_alloc(unsigned int shift)
+{
+	struct sfe_ipv4_connection_hash *h;
+	unsigned int size = 1 << shift;
+
+	h = kzalloc(sizeof(struct sfe_ipv4_connection_hash), GFP_KERNEL);
+	if (!h) {
 		return NULL;
 	}
 
-	/*
-	 * We found a match so move it.
-	 */
-	if (cm->next) {
-		cm->next->prev = cm->prev;
+	h->conn_hash = kvcalloc(size, sizeof(struct sfe_ipv4_connection *), GFP_KERNEL);
+	h->conn_match_hash = kvcalloc(size, sizeof(struct hlist_head), GFP_KERNEL);
+	if (!h->conn_hash || !h->conn_match_hash) {
+		kvfree(h->conn_hash);
+		kvfree(h->conn_match_hash);
+		kfree(h);
+		return NULL;
 	}
-	cm->prev->next = cm->next;
-	cm->prev = NULL;
-	cm->next = head;
-	head->prev = cm;
-	si->conn_match_hash[conn_match_idx] = cm;
-	si->connection_match_hash_reorders++;
 
-	return cm;
+	h->shift = shift;
+	h->seed = get_random_u32();
+	return h;
 }
 
 /*
- * sfe_ipv4_connection_match_update_summary_stats()
- *	Update the summary stats for a connection match entry.
+ * sfe_ipv4_connection_hash_free()
+ *	Free a set of hash tables.
  */
-static inline void sfe_ipv4_connection_match_update_summary_stats(struct sfe_ipv4_connection_match *cm)
+static void sfe_ipv4_connection_hash_free(struct sfe_ipv4_connection_hash *h)
 {
-	cm->rx_packet_count64 += cm->rx_packet_count;
-	cm->rx_packet_count = 0;
-	cm->rx_byte_count64 += cm->rx_byte_count;
-	cm->rx_byte_count = 0;
+	kvfree(h->conn_hash);
+	kvfree(h->conn_match_hash);
+	kfree(h);
 }
 
 /*
- * sfe_ipv4_connection_match_compute_translations()
- *	Compute port and address translations for a connection match entry.
+ * sfe_ipv4_connection_hash_locked()
+ *	Get the current hash tables.
+ *
+ * On entry we must be holding the lock that protects the hash table.
  */
-static void sfe_ipv4_connection_match_compute_translations(struct sfe_ipv4_connection_match *cm)
+static inline struct sfe_ipv4_connection_hash *sfe_ipv4_connection_hash_locked(struct sfe_ipv4 *si)
 {
-	/*
-	 * Before we insert the entry look to see if this is tagged as doing address
-	 * translations.  If it is then work out the adjustment that we need to apply
-	 * to the transport checksum.
-	 */
-	if (cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_XLATE_SRC) {
-		/*
-		 * Precompute an incremental checksum adjustment so we can
-		 * edit packets in this stream very quickly.  The algorithm is from RFC1624.
-		 */
-		u16 src_ip_hi = cm->match_src_ip >> 16;
-		u16 src_ip_lo = cm->match_src_ip & 0xffff;
-		u32 xlate_src_ip = ~cm->xlate_src_ip;
-		u16 xlate_src_ip_hi = xlate_src_ip >> 16;
-		u16 xlate_src_ip_lo = xlate_src_ip & 0xffff;
-		u16 xlate_src_port = ~cm->xlate_src_port;
-		u32 adj;
+	return rcu_dereference_protected(si->hash, lockdep_is_held(&si->lock));
+}
 
-		/*
-		 * When we compute this fold it down to a 16-bit offset
-		 * as that way we can avoid having to do a double
-		 * folding of the twos-complement result because the
+/*
+ * sfe_ipv4_stats_inc()
+ *	Increment one of this CPU's statistics counters.
+ *
+ * Must be called with bottom halves disabled, as the packet path always is,
+ * so that two updates cannot interleave on the same CPU.
+ */
+#define sfe_ipv4_stats_inc(si, counter) \
+	do { \
+		struct sfe_ipv4_stats *__stats = this_cpu_ptr((si)->stats); \
+		u64_stats_update_begin(&__stats->syncp); \
+		__stats->counter++; \
+		u64_stats_update_end(&__stats->syncp); \
+	} while (0)
+
+/*
+ * sfe_ipv4_exception_stats_inc()
+ *	Account a packet that could not be forwarded because of an exception event.
+ */
+static inline void sfe_ipv4_exception_stats_inc(struct sfe_ipv4 *si, enum sfe_ipv4_exception_events event)
+{
+	struct sfe_ipv4_stats *stats = this_cpu_ptr(si->stats);
+
+	u64_stats_update_begin(&stats->syncp);
+	stats->exception_events[event]++;
+	stats->packets_not_forwarded++;
+	u64_stats_update_end(&stats->syncp);
+}
+
+/*
+ * sfe_ipv4_get_connection_match_hash()
+ *	Generate the hash used in connection match lookups.
+ *
+ * The hash is keyed with a random seed so that the chain an entry lands in
+ * can't be chosen by picking addresses and ports.
+ */
+static inline unsigned int sfe_ipv4_get_connection_match_hash(struct sfe_ipv4_connection_hash *h,
+							      struct net_device *dev, u8 protocol,
+							      __be32 src_ip, __be16 src_port,
+							      __be32 dest_ip, __be16 dest_port)
+{
+	u32 ports = ((__force u32)src_port << 16) | (__force u32)dest_port;
+	u32 hash = jhash_3words((__force u32)src_ip, (__force u32)dest_ip, ports,
+				h->seed ^ ((u32)dev->ifindex << 8) ^ protocol);
+	return hash & ((1 << h->shift) - 1);
+}
+
+/*
+ * sfe_ipv4_find_sfe_ipv4_connection_match()
+ *	Get the IPv4 flow match info that corresponds to a particular 5-tuple.
+ *
+ * On entry we must be within an RCU read-side critical section or holding the
+ * lock that protects the hash table.  The chain is never reordered so that
+ * lookups can run concurrently on all CPUs without taking a lock.
+ */
+static struct sfe_ipv4_connection_match *
+sfe_ipv4_find_sfe_ipv4_connection_match(struct sfe_ipv4 *si, struct net_device *dev, u8 protocol,
+					__be32 src_ip, __be16 src_port,
+					__be32 dest_ip, __be16 dest_port)
+{
+	struct sfe_ipv4_connection_hash *h;
+	struct sfe_ipv4_connection_match *cm;
+	unsigned int conn_match_idx;
+	unsigned int depth = 0;
+
+	h = rcu_dereference_check(si->hash, lockdep_is_held(&si->lock));
+	conn_match_idx = sfe_ipv4_get_connection_match_hash(h, dev, protocol, src_ip, src_port, dest_ip, dest_port);
+
+	hlist_for_each_entry_rcu(cm, &h->conn_match_hash[conn_match_idx], hnode) {
+		if ((cm->match_src_port == src_port)
+		    && (cm->match_dest_port == dest_port)
+		    && (cm->match_src_ip == src_ip)
+		    && (cm->match_dest_ip == dest_ip)
+		    && (cm->match_protocol == protocol)
+		    && (cm->match_dev == dev)) {
+			struct sfe_ipv4_stats *stats = this_cpu_ptr(si->stats);
+
+			u64_stats_update_begin(&stats->syncp);
+			stats->connection_match_hash_hits++;
+			stats->connection_match_hash_hit_depths[depth]++;
+			u64_stats_update_end(&stats->syncp);
+			return cm;
+		}
+
+		if (depth < SFE_IPV4_CONNECTION_HASH_HISTOGRAM_SIZE - 1) {
+			depth++;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * sfe_ipv4_recv_find_connection_match()
+ *	Find the connection match for a UDP or TCP packet we've received.
+ *
+ * Packets of the same flow tend to arrive together so when we're handling a
+ * batch we try the connection match used for the previous packet first.
+ */
+static inline struct sfe_ipv4_connection_match *
+sfe_ipv4_recv_find_connection_match(struct sfe_ipv4 *si, struct sfe_ipv4_recv_batch *batch,
+				    struct sk_buff *skb, struct net_device *dev, u8 protocol,
+				    __be32 src_ip, __be16 src_port,
+				    __be32 dest_ip, __be16 dest_port)
+{
+	struct sfe_ipv4_connection_match *cm;
+
+	if (batch) {
+		cm = batch->last_cm;
+		if (cm
+		    && (cm->match_src_port == src_port)
+		    && (cm->match_dest_port == dest_port)
+		    && (cm->match_src_ip == src_ip)
+		    && (cm->match_dest_ip == dest_ip)
+		    && (cm->match_protocol == protocol)
+		    && (cm->match_dev == dev)
+		    && likely(!READ_ONCE(cm->connection->removed))) {
+			return cm;
+		}
+	}
+
+#ifdef CONFIG_NF_FLOW_COOKIE
+	cm = rcu_dereference(si->sfe_flow_cookie_table[skb->flow_cookie & SFE_FLOW_COOKIE_MASK].match);
+	if (unlikely(!cm)) {
+		cm = sfe_ipv4_find_sfe_ipv4_connection_match(si, dev, protocol, src_ip, src_port, dest_ip, dest_port);
+	}
+#else
+	cm = sfe_ipv4_find_sfe_ipv4_connection_match(si, dev, protocol, src_ip, src_port, dest_ip, dest_port);
+#endif
+
+	if (batch) {
+		batch->last_cm = cm;
+	}
+
+	return cm;
+}
+
+/*
+ * sfe_ipv4_connection_match_get_stats()
+ *	Sum the per-CPU packet and byte counters of a connection match entry.
+ */
+static void sfe_ipv4_connection_match_get_stats(struct sfe_ipv4_connection_match *cm,
+						u64 *packets, u64 *bytes)
+{
+	u64 rx_packets = 0;
+	u64 rx_bytes = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct sfe_ipv4_connection_match_stats *stats = per_cpu_ptr(cm->stats, cpu);
+		unsigned int start;
+		u64 p;
+		u64 b;
+
+		do {
+			start = u64_stats_fetch_begin_irq(&stats->syncp);
+			p = stats->rx_packet_count;
+			b = stats->rx_byte_count;
+		} while (u64_stats_fetch_retry_irq(&stats->syncp, start));
+
+		rx_packets += p;
+		rx_bytes += b;
+	}
+
+	*packets = rx_packets;
+	*bytes = rx_bytes;
+}
+
+/*
+ * sfe_ipv4_connection_match_update_summary_stats()
+ *	Update the summary stats for a connection match entry.
+ *
+ * Returns the number of packets and bytes seen since the previous update.  The
+ * caller must serialise updates for a given entry, either by holding the lock
+ * or by having removed the connection from the hash tables.
+ */
+static inline void sfe_ipv4_connection_match_update_summary_stats(struct sfe_ipv4_connection_match *cm,
+								  u32 *new_packets, u32 *new_bytes)
+{
+	u64 packets;
+	u64 bytes;
+
+	sfe_ipv4_connection_match_get_stats(cm, &packets, &bytes);
+
+	*new_packets = (u32)(packets - cm->rx_packet_count64);
+	*new_bytes = (u32)(bytes - cm->rx_byte_count64);
+	cm->rx_packet_count64 = packets;
+	cm->rx_byte_count64 = bytes;
+}
+
+/*
+ * sfe_ipv4_connection_match_update_rx_stats()
+ *	Account a forwarded packet against a connection match entry.
+ *
+ * A GSO packet counts as the number of segments it will be sent as.
+ */
+static inline void sfe_ipv4_connection_match_update_rx_stats(struct sfe_ipv4 *si,
+							     struct sfe_ipv4_connection_match *cm,
+							     struct sk_buff *skb, unsigned int len)
+{
+	struct sfe_ipv4_connection_match_stats *cm_stats = this_cpu_ptr(cm->stats);
+	struct sfe_ipv4_stats *stats = this_cpu_ptr(si->stats);
+	unsigned int packets = skb_is_gso(skb) ? skb_shinfo(skb)->gso_segs : 1;
+
+	u64_stats_update_begin(&cm_stats->syncp);
+	cm_stats->rx_packet_count += packets;
+	cm_stats->rx_byte_count += len;
+	u64_stats_update_end(&cm_stats->syncp);
+
+	u64_stats_update_begin(&stats->syncp);
+	stats->packets_forwarded += packets;
+	u64_stats_update_end(&stats->syncp);
+}
+
+/*
+ * sfe_ipv4_xmit_fits_mtu()
+ *	Check that a packet fits the MTU of the transmit interface.
+ *
+ * GSO packets are segmented when they're transmitted so it's their segments
+ * that have to fit.
+ */
+static inline bool sfe_ipv4_xmit_fits_mtu(struct sk_buff *skb, unsigned int len, unsigned int mtu)
+{
+	if (likely(!skb_is_gso(skb))) {
+		return len <= mtu;
+	}
+
+	return skb_gso_validate_network_len(skb, mtu);
+}
+
+/*
+ * sfe_ipv4_connection_match_activate()
+ *	Put a connection match entry on the active list so that it gets synced.
+ *
+ * The active flag is checked without the lock first so that only the first
+ * packet after each sync has to take it.
+ */
+static inline void sfe_ipv4_connection_match_activate(struct sfe_ipv4 *si,
+						      struct sfe_ipv4_connection_match *cm)
+{
+	if (likely(READ_ONCE(cm->active))) {
+		return;
+	}
+
+	spin_lock_bh(&si->lock);
+
+	/*
+	 * If we're not already on the active list then insert ourselves at the tail
+	 * of the current list.  The connection may have been removed by another CPU
+	 * since we looked it up, in which case it must not be linked in again.
+	 */
+	if (!cm->active && !cm->connection->removed) {
+		cm->active = true;
+		cm->active_jiffies = jiffies;
+		cm->active_prev = si->active_tail;
+		if (likely(si->active_tail)) {
+			si->active_tail->active_next = cm;
+		} else {
+			si->active_head = cm;
+		}
+		si->active_tail = cm;
+		si->active_count++;
+	}
+
+	spin_unlock_bh(&si->lock);
+}
+
+/*
+ * sfe_ipv4_connection_match_compute_translations()
+ *	Compute port and address translations for a connection match entry.
+ */
+static void sfe_ipv4_connection_match_compute_translations(struct sfe_ipv4_connection_match *cm)
+{
+	u32 ip_csum_adj = 0;
+
+	/*
+	 * Before we insert the entry look to see if this is tagged as doing address
+	 * translations.  If it is then work out the adjustment that we need to apply
+	 * to the transport checksum.
+	 */
+	if (cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_XLATE_SRC) {
+		/*
+		 * Precompute an incremental checksum adjustment so we can
+		 * edit packets in this stream very quickly.  The algorithm is from RFC1624.
+		 */
+		u16 src_ip_hi = cm->match_src_ip >> 16;
+		u16 src_ip_lo = cm->match_src_ip & 0xffff;
+		u32 xlate_src_ip = ~cm->xlate_src_ip;
+		u16 xlate_src_ip_hi = xlate_src_ip >> 16;
+		u16 xlate_src_ip_lo = xlate_src_ip & 0xffff;
+		u16 xlate_src_port = ~cm->xlate_src_port;
+		u32 adj;
+
+		/*
+		 * When we compute this fold it down to a 16-bit offset
+		 * as that way we can avoid having to do a double
+		 * folding of the twos-complement result because the
 		 * addition of 2 16-bit values cannot cause a double
 		 * wrap-around!
 		 */
@@ -720,38 +1231,111 @@ static void sfe_ipv4_connection_match_compute_translations(struct sfe_ipv4_conne
 		cm->xlate_dest_partial_csum_adjustment = (u16)adj;
 	}
 
+	/*
+	 * The changes to the IP header are the same for every packet, apart from
+	 * any DSCP remarking, so we precompute the adjustment for them as well.
+	 */
+	if (!(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_BRIDGE_FLOW)) {
+		ip_csum_adj += SFE_IPV4_TTL_DEC_CSUM_ADJUSTMENT;
+	}
+
+	if (cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_XLATE_SRC) {
+		ip_csum_adj += cm->xlate_src_partial_csum_adjustment;
+	}
+
+	if (cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_XLATE_DEST) {
+		ip_csum_adj += cm->xlate_dest_partial_csum_adjustment;
+	}
+
+	ip_csum_adj = (ip_csum_adj & 0xffff) + (ip_csum_adj >> 16);
+	ip_csum_adj = (ip_csum_adj & 0xffff) + (ip_csum_adj >> 16);
+	cm->ip_csum_adjustment = (u16)ip_csum_adj;
+}
+
+/*
+ * sfe_ipv4_stats_read()
+ *	Read one of a CPU's statistics counters without tearing it.
+ */
+static inline u64 sfe_ipv4_stats_read(struct sfe_ipv4_stats *stats, u64 *counter)
+{
+	unsigned int start;
+	u64 val;
+
+	do {
+		start = u64_stats_fetch_begin_irq(&stats->syncp);
+		val = *counter;
+	} while (u64_stats_fetch_retry_irq(&stats->syncp, start));
+
+	return val;
 }
 
+/*
+ * sfe_ipv4_stats_fold()
+ *	Add one of a CPU's statistics counters into its summary counter.
+ */
+#define sfe_ipv4_stats_fold(si, stats, counter, summary) \
+	do { \
+		u64 __val = sfe_ipv4_stats_read(stats, &(stats)->counter); \
+		(si)->stats_folded.counter += __val; \
+		(si)->summary += __val; \
+	} while (0)
+
+/*
+ * sfe_ipv4_stats_unfold()
+ *	Take the per-CPU totals added in by the last summary update back out of a summary counter.
+ */
+#define sfe_ipv4_stats_unfold(si, counter, summary) \
+	do { \
+		(si)->summary -= (si)->stats_folded.counter; \
+		(si)->stats_folded.counter = 0; \
+	} while (0)
+
 /*
  * sfe_ipv4_update_summary_stats()
  *	Update the summary stats.
+ *
+ * The per-CPU counters are never reset, so the totals added in last time are
+ * taken back out and the current ones added in, one counter at a time.
  */
 static void sfe_ipv4_update_summary_stats(struct sfe_ipv4 *si)
 {
+	int cpu;
 	int i;
 
-	si->connection_create_requests64 += si->connection_create_requests;
-	si->connection_create_requests = 0;
-	si->connection_create_collisions64 += si->connection_create_collisions;
-	si->connection_create_collisions = 0;
-	si->connection_destroy_requests64 += si->connection_destroy_requests;
-	si->connection_destroy_requests = 0;
-	si->connection_destroy_misses64 += si->connection_destroy_misses;
-	si->connection_destroy_misses = 0;
-	si->connection_match_hash_hits64 += si->connection_match_hash_hits;
-	si->connection_match_hash_hits = 0;
-	si->connection_match_hash_reorders64 += si->connection_match_hash_reorders;
-	si->connection_match_hash_reorders = 0;
-	si->connection_flushes64 += si->connection_flushes;
-	si->connection_flushes = 0;
-	si->packets_forwarded64 += si->packets_forwarded;
-	si->packets_forwarded = 0;
-	si->packets_not_forwarded64 += si->packets_not_forwarded;
-	si->packets_not_forwarded = 0;
-
+	sfe_ipv4_stats_unfold(si, connection_create_requests, connection_create_requests64);
+	sfe_ipv4_stats_unfold(si, connection_create_collisions, connection_create_collisions64);
+	sfe_ipv4_stats_unfold(si, connection_destroy_requests, connection_destroy_requests64);
+	sfe_ipv4_stats_unfold(si, connection_destroy_misses, connection_destroy_misses64);
+	sfe_ipv4_stats_unfold(si, connection_flushes, connection_flushes64);
+	sfe_ipv4_stats_unfold(si, connection_match_hash_hits, connection_match_hash_hits64);
+	for (i = 0; i < SFE_IPV4_CONNECTION_HASH_HISTOGRAM_SIZE; i++) {
+		sfe_ipv4_stats_unfold(si, connection_match_hash_hit_depths[i], connection_match_hash_hit_depths64[i]);
+	}
+	sfe_ipv4_stats_unfold(si, packets_forwarded, packets_forwarded64);
+	sfe_ipv4_stats_unfold(si, packets_not_forwarded, packets_not_forwarded64);
+	sfe_ipv4_stats_unfold(si, packets_policed, packets_policed64);
 	for (i = 0; i < SFE_IPV4_EXCEPTION_EVENT_LAST; i++) {
-		si->exception_events64[i] += si->exception_events[i];
-		si->exception_events[i] = 0;
+		sfe_ipv4_stats_unfold(si, exception_events[i], exception_events64[i]);
+	}
+
+	for_each_possible_cpu(cpu) {
+		struct sfe_ipv4_stats *stats = per_cpu_ptr(si->stats, cpu);
+
+		sfe_ipv4_stats_fold(si, stats, connection_create_requests, connection_create_requests64);
+		sfe_ipv4_stats_fold(si, stats, connection_create_collisions, connection_create_collisions64);
+		sfe_ipv4_stats_fold(si, stats, connection_destroy_requests, connection_destroy_requests64);
+		sfe_ipv4_stats_fold(si, stats, connection_destroy_misses, connection_destroy_misses64);
+		sfe_ipv4_stats_fold(si, stats, connection_flushes, connection_flushes64);
+		sfe_ipv4_stats_fold(si, stats, connection_match_hash_hits, connection_match_hash_hits64);
+		for (i = 0; i < SFE_IPV4_CONNECTION_HASH_HISTOGRAM_SIZE; i++) {
+			sfe_ipv4_stats_fold(si, stats, connection_match_hash_hit_depths[i], connection_match_hash_hit_depths64[i]);
+		}
+		sfe_ipv4_stats_fold(si, stats, packets_forwarded, packets_forwarded64);
+		sfe_ipv4_stats_fold(si, stats, packets_not_forwarded, packets_not_forwarded64);
+		sfe_ipv4_stats_fold(si, stats, packets_policed, packets_policed64);
+		for (i = 0; i < SFE_IPV4_EXCEPTION_EVENT_LAST; i++) {
+			sfe_ipv4_stats_fold(si, stats, exception_events[i], exception_events64[i]);
+		}
 	}
 }
 
@@ -764,22 +1348,16 @@ static void sfe_ipv4_update_summary_stats(struct sfe_ipv4 *si)
 static inline void sfe_ipv4_insert_sfe_ipv4_connection_match(struct sfe_ipv4 *si,
 							     struct sfe_ipv4_connection_match *cm)
 {
-	struct sfe_ipv4_connection_match **hash_head;
-	struct sfe_ipv4_connection_match *prev_head;
+	struct sfe_ipv4_connection_hash *h = sfe_ipv4_connection_hash_locked(si);
 	unsigned int conn_match_idx
-		= sfe_ipv4_get_connection_match_hash(cm->match_dev, cm->match_protocol,
+		= sfe_ipv4_get_connection_match_hash(h, cm->match_dev, cm->match_protocol,
 						     cm->match_src_ip, cm->match_src_port,
 						     cm->match_dest_ip, cm->match_dest_port);
 
-	hash_head = &si->conn_match_hash[conn_match_idx];
-	prev_head = *hash_head;
-	cm->prev = NULL;
-	if (prev_head) {
-		prev_head->prev = cm;
-	}
-
-	cm->next = prev_head;
-	*hash_head = cm;
+	/*
+	 * Publish the entry to the fast path.  It must be fully initialised by now.
+	 */
+	hlist_add_head_rcu(&cm->hnode, &h->conn_match_hash[conn_match_idx]);
 
 #ifdef CONFIG_NF_FLOW_COOKIE
 	if (!si->flow_cookie_enable)
@@ -792,7 +1370,7 @@ static inline void sfe_ipv4_insert_sfe_ipv4_connection_match(struct sfe_ipv4 *si
 	for (conn_match_idx = 1; conn_match_idx < SFE_FLOW_COOKIE_SIZE; conn_match_idx++) {
 		struct sfe_flow_cookie_entry *entry = &si->sfe_flow_cookie_table[conn_match_idx];
 
-		if ((NULL == entry->match) && time_is_before_jiffies(entry->last_clean_time + HZ)) {
+		if ((NULL == rcu_access_pointer(entry->match)) && time_is_before_jiffies(entry->last_clean_time + HZ)) {
 			flow_cookie_set_func_t func;
 
 			rcu_read_lock();
@@ -800,7 +1378,7 @@ static inline void sfe_ipv4_insert_sfe_ipv4_connection_match(struct sfe_ipv4 *si
 			if (func) {
 				if (!func(cm->match_protocol, cm->match_src_ip, cm->match_src_port,
 					 cm->match_dest_ip, cm->match_dest_port, conn_match_idx)) {
-					entry->match = cm;
+					rcu_assign_pointer(entry->match, cm);
 					cm->flow_cookie = conn_match_idx;
 				}
 			}
@@ -830,7 +1408,7 @@ static inline void sfe_ipv4_remove_sfe_ipv4_connection_match(struct sfe_ipv4 *si
 		for (conn_match_idx = 1; conn_match_idx < SFE_FLOW_COOKIE_SIZE; conn_match_idx++) {
 			struct sfe_flow_cookie_entry *entry = &si->sfe_flow_cookie_table[conn_match_idx];
 
-			if (cm == entry->match) {
+			if (cm == rcu_access_pointer(entry->match)) {
 				flow_cookie_set_func_t func;
 
 				rcu_read_lock();
@@ -842,7 +1420,7 @@ static inline void sfe_ipv4_remove_sfe_ipv4_connection_match(struct sfe_ipv4 *si
 				rcu_read_unlock();
 
 				cm->flow_cookie = 0;
-				entry->match = NULL;
+				RCU_INIT_POINTER(entry->match, NULL);
 				entry->last_clean_time = jiffies;
 				break;
 			}
@@ -851,21 +1429,11 @@ static inline void sfe_ipv4_remove_sfe_ipv4_connection_match(struct sfe_ipv4 *si
 #endif
 
 	/*
-	 * Unlink the connection match entry from the hash.
+	 * Unlink the connection match entry from the hash.  Fast path readers may
+	 * still be walking through it so it can't be freed until a grace period
+	 * has elapsed.
 	 */
-	if (cm->prev) {
-		cm->prev->next = cm->next;
-	} else {
-		unsigned int conn_match_idx
-			= sfe_ipv4_get_connection_match_hash(cm->match_dev, cm->match_protocol,
-							     cm->match_src_ip, cm->match_src_port,
-							     cm->match_dest_ip, cm->match_dest_port);
-		si->conn_match_hash[conn_match_idx] = cm->next;
-	}
-
-	if (cm->next) {
-		cm->next->prev = cm->prev;
-	}
+	hlist_del_rcu(&cm->hnode);
 
 	/*
 	 * If the connection match entry is in the active list remove it.
@@ -882,6 +1450,8 @@ static inline void sfe_ipv4_remove_sfe_ipv4_connection_match(struct sfe_ipv4 *si
 		} else {
 			si->active_tail = cm->active_prev;
 		}
+
+		si->active_count--;
 	}
 }
 
@@ -889,11 +1459,13 @@ static inline void sfe_ipv4_remove_sfe_ipv4_connection_match(struct sfe_ipv4 *si
  * sfe_ipv4_get_connection_hash()
  *	Generate the hash used in connection lookups.
  */
-static inline unsigned int sfe_ipv4_get_connection_hash(u8 protocol, __be32 src_ip, __be16 src_port,
+static inline unsigned int sfe_ipv4_get_connection_hash(struct sfe_ipv4_connection_hash *h,
+							u8 protocol, __be32 src_ip, __be16 src_port,
 							__be32 dest_ip, __be16 dest_port)
 {
-	u32 hash = ntohl(src_ip ^ dest_ip) ^ protocol ^ ntohs(src_port ^ dest_port);
-	return ((hash >> SFE_IPV4_CONNECTION_HASH_SHIFT) ^ hash) & SFE_IPV4_CONNECTION_HASH_MASK;
+	u32 ports = ((__force u32)src_port << 16) | (__force u32)dest_port;
+	u32 hash = jhash_3words((__force u32)src_ip, (__force u32)dest_ip, ports, h->seed ^ protocol);
+	return hash & ((1 << h->shift) - 1);
 }
 
 /*
@@ -906,9 +1478,10 @@ static inline struct sfe_ipv4_connection *sfe_ipv4_find_sfe_ipv4_connection(stru
 									    __be32 src_ip, __be16 src_port,
 									    __be32 dest_ip, __be16 dest_port)
 {
+	struct sfe_ipv4_connection_hash *h = sfe_ipv4_connection_hash_locked(si);
 	struct sfe_ipv4_connection *c;
-	unsigned int conn_idx = sfe_ipv4_get_connection_hash(protocol, src_ip, src_port, dest_ip, dest_port);
-	c = si->conn_hash[conn_idx];
+	unsigned int conn_idx = sfe_ipv4_get_connection_hash(h, protocol, src_ip, src_port, dest_ip, dest_port);
+	c = h->conn_hash[conn_idx];
 
 	/*
 	 * If we don't have anything in this chain then bale.
@@ -974,6 +1547,114 @@ void sfe_ipv4_mark_rule(struct sfe_connection_mark *mark)
 	}
 }
 
+/*
+ * sfe_ipv4_connection_hash_target_shift()
+ *	Work out the hash table size for the current number of connections.
+ *
+ * This aims for between a quarter and a half of a connection per bucket.
+ */
+static unsigned int sfe_ipv4_connection_hash_target_shift(struct sfe_ipv4 *si)
+{
+	unsigned int shift = order_base_2(si->num_connections) + 1;
+
+	return clamp_t(unsigned int, shift, si->hash_min_shift, SFE_IPV4_CONNECTION_HASH_SHIFT_MAX);
+}
+
+/*
+ * sfe_ipv4_connection_hash_check_resize()
+ *	Schedule a resize if the hash tables have become too full or too empty.
+ *
+ * We grow once there is more than one connection per bucket and shrink once
+ * there is less than one per eight buckets so that a resize never leaves the
+ * tables ready to be resized straight back again.
+ *
+ * On entry we must be holding the lock that protects the hash table.
+ */
+static inline void sfe_ipv4_connection_hash_check_resize(struct sfe_ipv4 *si)
+{
+	struct sfe_ipv4_connection_hash *h = sfe_ipv4_connection_hash_locked(si);
+	unsigned int size = 1 << h->shift;
+
+	if (unlikely(((si->num_connections > size) && (h->shift < SFE_IPV4_CONNECTION_HASH_SHIFT_MAX))
+		     || ((si->num_connections < size / 8) && (h->shift > si->hash_min_shift)))) {
+		schedule_work(&si->hash_resize_work);
+	}
+}
+
+/*
+ * sfe_ipv4_connection_hash_resize()
+ *	Move every connection into new hash tables sized for the number of connections.
+ *
+ * This runs from a workqueue so that the new tables can be allocated with
+ * GFP_KERNEL.  The entries are relinked under the lock, but a fast path lookup
+ * racing with this may miss and send its packet through the slow path, which
+ * is harmless.  The old tables are freed once no reader can still be using them.
+ */
+static void sfe_ipv4_connection_hash_resize(struct work_struct *work)
+{
+	struct sfe_ipv4 *si = container_of(work, struct sfe_ipv4, hash_resize_work);
+	struct sfe_ipv4_connection_hash *old_hash;
+	struct sfe_ipv4_connection_hash *new_hash;
+	struct sfe_ipv4_connection *c;
+	unsigned int shift;
+
+	spin_lock_bh(&si->lock);
+	old_hash = sfe_ipv4_connection_hash_locked(si);
+	shift = sfe_ipv4_connection_hash_target_shift(si);
+	spin_unlock_bh(&si->lock);
+
+	/*
+	 * We're the only thing that replaces the tables so old_hash stays valid.
+	 */
+	if (shift == old_hash->shift) {
+		return;
+	}
+
+	new_hash = sfe_ipv4_connection_hash_alloc(shift);
+	if (!new_hash) {
+		DEBUG_WARN("Failed to allocate %u bucket connection hash\n", 1 << shift);
+		return;
+	}
+
+	spin_lock_bh(&si->lock);
+	for (c = si->all_connections_head; c; c = c->all_connections_next) {
+		struct sfe_ipv4_connection_match *cms[2] = {c->original_match, c->reply_match};
+		struct sfe_ipv4_connection **hash_head;
+		unsigned int conn_idx;
+		int i;
+
+		conn_idx = sfe_ipv4_get_connection_hash(new_hash, c->protocol, c->src_ip, c->src_port,
+							c->dest_ip, c->dest_port);
+		hash_head = &new_hash->conn_hash[conn_idx];
+		c->prev = NULL;
+		c->next = *hash_head;
+		if (*hash_head) {
+			(*hash_head)->prev = c;
+		}
+		*hash_head = c;
+
+		for (i = 0; i < 2; i++) {
+			struct sfe_ipv4_connection_match *cm = cms[i];
+			unsigned int conn_match_idx
+				= sfe_ipv4_get_connection_match_hash(new_hash, cm->match_dev, cm->match_protocol,
+								     cm->match_src_ip, cm->match_src_port,
+								     cm->match_dest_ip, cm->match_dest_port);
+
+			hlist_del_rcu(&cm->hnode);
+			hlist_add_head_rcu(&cm->hnode, &new_hash->conn_match_hash[conn_match_idx]);
+		}
+	}
+
+	rcu_assign_pointer(si->hash, new_hash);
+	si->hash_resizes++;
+	spin_unlock_bh(&si->lock);
+
+	DEBUG_INFO("Connection hash resized from %u to %u buckets\n", 1 << old_hash->shift, 1 << shift);
+
+	synchronize_rcu();
+	sfe_ipv4_connection_hash_free(old_hash);
+}
+
 /*
  * sfe_ipv4_insert_sfe_ipv4_connection()
  *	Insert a connection into the hash.
@@ -982,6 +1663,7 @@ void sfe_ipv4_mark_rule(struct sfe_connection_mark *mark)
  */
 static void sfe_ipv4_insert_sfe_ipv4_connection(struct sfe_ipv4 *si, struct sfe_ipv4_connection *c)
 {
+	struct sfe_ipv4_connection_hash *h = sfe_ipv4_connection_hash_locked(si);
 	struct sfe_ipv4_connection **hash_head;
 	struct sfe_ipv4_connection *prev_head;
 	unsigned int conn_idx;
@@ -989,9 +1671,9 @@ static void sfe_ipv4_insert_sfe_ipv4_connection(struct sfe_ipv4 *si, struct sfe_
 	/*
 	 * Insert entry into the connection hash.
 	 */
-	conn_idx = sfe_ipv4_get_connection_hash(c->protocol, c->src_ip, c->src_port,
+	conn_idx = sfe_ipv4_get_connection_hash(h, c->protocol, c->src_ip, c->src_port,
 						c->dest_ip, c->dest_port);
-	hash_head = &si->conn_hash[conn_idx];
+	hash_head = &h->conn_hash[conn_idx];
 	prev_head = *hash_head;
 	c->prev = NULL;
 	if (prev_head) {
@@ -1021,16 +1703,27 @@ static void sfe_ipv4_insert_sfe_ipv4_connection(struct sfe_ipv4 *si, struct sfe_
 	 */
 	sfe_ipv4_insert_sfe_ipv4_connection_match(si, c->original_match);
 	sfe_ipv4_insert_sfe_ipv4_connection_match(si, c->reply_match);
+
+	sfe_ipv4_connection_hash_check_resize(si);
 }
 
 /*
  * sfe_ipv4_remove_sfe_ipv4_connection()
  *	Remove a sfe_ipv4_connection object from the hash.
  *
- * On entry we must be holding the lock that protects the hash table.
+ * On entry we must be holding the lock that protects the hash table.  Returns
+ * false if the connection had already been removed, which can happen when
+ * several CPUs find the same connection in the fast path and all try to flush
+ * it.  Only the caller that gets true may go on to flush the connection.
  */
-static void sfe_ipv4_remove_sfe_ipv4_connection(struct sfe_ipv4 *si, struct sfe_ipv4_connection *c)
+static bool sfe_ipv4_remove_sfe_ipv4_connection(struct sfe_ipv4 *si, struct sfe_ipv4_connection *c)
 {
+	if (c->removed) {
+		return false;
+	}
+
+	c->removed = true;
+
 	/*
 	 * Remove the connection match objects.
 	 */
@@ -1043,9 +1736,10 @@ static void sfe_ipv4_remove_sfe_ipv4_connection(struct sfe_ipv4 *si, struct sfe_
 	if (c->prev) {
 		c->prev->next = c->next;
 	} else {
-		unsigned int conn_idx = sfe_ipv4_get_connection_hash(c->protocol, c->src_ip, c->src_port,
+		struct sfe_ipv4_connection_hash *h = sfe_ipv4_connection_hash_locked(si);
+		unsigned int conn_idx = sfe_ipv4_get_connection_hash(h, c->protocol, c->src_ip, c->src_port,
 								     c->dest_ip, c->dest_port);
-		si->conn_hash[conn_idx] = c->next;
+		h->conn_hash[conn_idx] = c->next;
 	}
 
 	if (c->next) {
@@ -1068,6 +1762,8 @@ static void sfe_ipv4_remove_sfe_ipv4_connection(struct sfe_ipv4 *si, struct sfe_
 	}
 
 	si->num_connections--;
+	sfe_ipv4_connection_hash_check_resize(si);
+	return true;
 }
 
 /*
@@ -1100,20 +1796,19 @@ static void sfe_ipv4_gen_sync_sfe_ipv4_connection(struct sfe_ipv4 *si, struct sf
 
 	original_cm = c->original_match;
 	reply_cm = c->reply_match;
+	spin_lock_bh(&c->lock);
 	sis->src_td_max_window = original_cm->protocol_state.tcp.max_win;
 	sis->src_td_end = original_cm->protocol_state.tcp.end;
 	sis->src_td_max_end = original_cm->protocol_state.tcp.max_end;
 	sis->dest_td_max_window = reply_cm->protocol_state.tcp.max_win;
 	sis->dest_td_end = reply_cm->protocol_state.tcp.end;
 	sis->dest_td_max_end = reply_cm->protocol_state.tcp.max_end;
+	spin_unlock_bh(&c->lock);
 
-	sis->src_new_packet_count = original_cm->rx_packet_count;
-	sis->src_new_byte_count = original_cm->rx_byte_count;
-	sis->dest_new_packet_count = reply_cm->rx_packet_count;
-	sis->dest_new_byte_count = reply_cm->rx_byte_count;
-
-	sfe_ipv4_connection_match_update_summary_stats(original_cm);
-	sfe_ipv4_connection_match_update_summary_stats(reply_cm);
+	sfe_ipv4_connection_match_update_summary_stats(original_cm, &sis->src_new_packet_count,
+						       &sis->src_new_byte_count);
+	sfe_ipv4_connection_match_update_summary_stats(reply_cm, &sis->dest_new_packet_count,
+						       &sis->dest_new_byte_count);
 
 	sis->src_dev = original_cm->match_dev;
 	sis->src_packet_count = original_cm->rx_packet_count64;
@@ -1133,38 +1828,37 @@ static void sfe_ipv4_gen_sync_sfe_ipv4_connection(struct sfe_ipv4 *si, struct sf
 }
 
 /*
- * sfe_ipv4_flush_sfe_ipv4_connection()
- *	Flush a connection and free all associated resources.
- *
- * We need to be called with bottom halves disabled locally as we need to acquire
- * the connection hash lock and release it again.  In general we're actually called
- * from within a BH and so we're fine, but we're also called when connections are
- * torn down.
+ * sfe_ipv4_free_mc_xmit()
+ *	Release a multicast egress interface list.
  */
-static void sfe_ipv4_flush_sfe_ipv4_connection(struct sfe_ipv4 *si,
-					       struct sfe_ipv4_connection *c,
-					       sfe_sync_reason_t reason)
+static void sfe_ipv4_free_mc_xmit(struct sfe_ipv4_mc_xmit *mcx)
 {
-	struct sfe_connection_sync sis;
-	u64 now_jiffies;
-	sfe_sync_rule_callback_t sync_rule_callback;
+	unsigned int i;
 
-	rcu_read_lock();
-	spin_lock_bh(&si->lock);
-	si->connection_flushes++;
-	sync_rule_callback = rcu_dereference(si->sync_rule_callback);
-	spin_unlock_bh(&si->lock);
-
-	if (sync_rule_callback) {
-		/*
-		 * Generate a sync message and then sync.
-		 */
-		now_jiffies = get_jiffies_64();
-		sfe_ipv4_gen_sync_sfe_ipv4_connection(si, c, &sis, reason, now_jiffies);
-		sync_rule_callback(&sis);
+	for (i = 0; i < mcx->count; i++) {
+		dev_put(mcx->xif[i].xmit_dev);
 	}
 
-	rcu_read_unlock();
+	kfree(mcx);
+}
+
+/*
+ * sfe_ipv4_free_mc_xmit_rcu()
+ *	Release a replaced multicast egress interface list once no fast path reader can still be using it.
+ */
+static void sfe_ipv4_free_mc_xmit_rcu(struct rcu_head *head)
+{
+	sfe_ipv4_free_mc_xmit(container_of(head, struct sfe_ipv4_mc_xmit, rcu));
+}
+
+/*
+ * sfe_ipv4_free_sfe_ipv4_connection_rcu()
+ *	Release a connection once no fast path reader can still be using it.
+ */
+static void sfe_ipv4_free_sfe_ipv4_connection_rcu(struct rcu_head *head)
+{
+	struct sfe_ipv4_connection *c = container_of(head, struct sfe_ipv4_connection, rcu);
+	struct sfe_ipv4_mc_xmit *mcx;
 
 	/*
 	 * Release our hold of the source and dest devices and free the memory
@@ -1172,476 +1866,554 @@ static void sfe_ipv4_flush_sfe_ipv4_connection(struct sfe_ipv4 *si,
 	 */
 	dev_put(c->original_dev);
 	dev_put(c->reply_dev);
+	mcx = rcu_dereference_protected(c->original_match->mc_xmit, 1);
+	if (mcx) {
+		sfe_ipv4_free_mc_xmit(mcx);
+	}
+	free_percpu(c->original_match->stats);
+	free_percpu(c->reply_match->stats);
+	kfree(c->original_match->police);
+	kfree(c->reply_match->police);
 	kfree(c->original_match);
 	kfree(c->reply_match);
 	kfree(c);
 }
 
 /*
- * sfe_ipv4_recv_udp()
- *	Handle UDP packet receives and forwarding.
+ * sfe_ipv4_flush_sfe_ipv4_connection()
+ *	Flush a connection and free all associated resources.
+ *
+ * We need to be called with bottom halves disabled locally as we need to acquire
+ * the connection hash lock and release it again.  In general we're actually called
+ * from within a BH and so we're fine, but we're also called when connections are
+ * torn down.
  */
-static int sfe_ipv4_recv_udp(struct sfe_ipv4 *si, struct sk_buff *skb, struct net_device *dev,
-			     unsigned int len, struct sfe_ipv4_ip_hdr *iph, unsigned int ihl, bool flush_on_find)
+static void sfe_ipv4_flush_sfe_ipv4_connection(struct sfe_ipv4 *si,
+					       struct sfe_ipv4_connection *c,
+					       sfe_sync_reason_t reason)
 {
-	struct sfe_ipv4_udp_hdr *udph;
-	__be32 src_ip;
-	__be32 dest_ip;
-	__be16 src_port;
-	__be16 dest_port;
-	struct sfe_ipv4_connection_match *cm;
-	u8 ttl;
-	struct net_device *xmit_dev;
+	struct sfe_connection_sync sis;
+	u64 now_jiffies;
+	sfe_sync_rule_callback_t sync_rule_callback;
 
-	/*
-	 * Is our packet too short to contain a valid UDP header?
-	 */
-	if (unlikely(!pskb_may_pull(skb, (sizeof(struct sfe_ipv4_udp_hdr) + ihl)))) {
-		spin_lock_bh(&si->lock);
-		si->exception_events[SFE_IPV4_EXCEPTION_EVENT_UDP_HEADER_INCOMPLETE]++;
-		si->packets_not_forwarded++;
-		spin_unlock_bh(&si->lock);
+	rcu_read_lock();
+	local_bh_disable();
+	sfe_ipv4_stats_inc(si, connection_flushes);
+	local_bh_enable();
+	sync_rule_callback = rcu_dereference(si->sync_rule_callback);
 
-		DEBUG_TRACE("packet too short for UDP header\n");
-		return 0;
+	if (sync_rule_callback) {
+		/*
+		 * Generate a sync message and then sync.
+		 */
+		now_jiffies = get_jiffies_64();
+		sfe_ipv4_gen_sync_sfe_ipv4_connection(si, c, &sis, reason, now_jiffies);
+		sync_rule_callback(&sis);
 	}
 
+	rcu_read_unlock();
+
 	/*
-	 * Read the IP address and port information.  Read the IP header data first
-	 * because we've almost certainly got that in the cache.  We may not yet have
-	 * the UDP header cached though so allow more time for any prefetching.
+	 * Fast path readers on other CPUs may still hold references to the
+	 * connection so defer releasing it until they're done.
 	 */
-	src_ip = iph->saddr;
-	dest_ip = iph->daddr;
+	call_rcu(&c->rcu, sfe_ipv4_free_sfe_ipv4_connection_rcu);
+}
 
-	udph = (struct sfe_ipv4_udp_hdr *)(skb->data + ihl);
-	src_port = udph->source;
-	dest_port = udph->dest;
+/*
+ * sfe_ipv4_exception_flush_sfe_ipv4_connection()
+ *	Record an exception against a connection found in the fast path and flush it.
+ *
+ * Called within an RCU read-side critical section without the lock held.
+ */
+static void sfe_ipv4_exception_flush_sfe_ipv4_connection(struct sfe_ipv4 *si,
+							 struct sfe_ipv4_connection *c,
+							 enum sfe_ipv4_exception_events event)
+{
+	bool removed;
 
 	spin_lock_bh(&si->lock);
+	removed = sfe_ipv4_remove_sfe_ipv4_connection(si, c);
+	spin_unlock_bh(&si->lock);
 
-	/*
-	 * Look for a connection match.
-	 */
-#ifdef CONFIG_NF_FLOW_COOKIE
-	cm = si->sfe_flow_cookie_table[skb->flow_cookie & SFE_FLOW_COOKIE_MASK].match;
-	if (unlikely(!cm)) {
-		cm = sfe_ipv4_find_sfe_ipv4_connection_match(si, dev, IPPROTO_UDP, src_ip, src_port, dest_ip, dest_port);
-	}
-#else
-	cm = sfe_ipv4_find_sfe_ipv4_connection_match(si, dev, IPPROTO_UDP, src_ip, src_port, dest_ip, dest_port);
-#endif
-	if (unlikely(!cm)) {
-		si->exception_events[SFE_IPV4_EXCEPTION_EVENT_UDP_NO_CONNECTION]++;
-		si->packets_not_forwarded++;
-		spin_unlock_bh(&si->lock);
+	sfe_ipv4_exception_stats_inc(si, event);
 
-		DEBUG_TRACE("no connection found\n");
-		return 0;
+	if (removed) {
+		sfe_ipv4_flush_sfe_ipv4_connection(si, c, SFE_SYNC_REASON_FLUSH);
 	}
+}
+
+/*
+ * sfe_ipv4_recv_udp_multicast()
+ *	Forward a UDP packet that matched a multicast connection.
+ *
+ * Called within an RCU read-side critical section, which we leave, once the
+ * packet has been found to be on the PPPoE session and VLAN the connection
+ * expects.  Every interface but the last gets a clone of the packet and the
+ * last gets the packet itself.  Each copy has its own L2 headers and TTL so
+ * it gets its own copy of the headers before we write to it.
+ */
+static int sfe_ipv4_recv_udp_multicast(struct sfe_ipv4 *si, struct sk_buff *skb, unsigned int len,
+				       struct sfe_ipv4_connection_match *cm, bool flush_on_find,
+				       struct sfe_ipv4_recv_batch *batch)
+{
+	struct sfe_ipv4_mc_xmit *mcx;
+	struct sfe_ipv4_mc_xmit_if *xif;
+	struct sfe_ipv4_ip_hdr *iph;
+	struct sk_buff *nskb;
+	u16 rx_src_mac[ETH_ALEN / 2];
+	u8 ttl;
+	u32 ip_csum_adj;
+	u32 mark;
+	unsigned int i;
 
-	/*
-	 * If our packet has beern marked as "flush on find" we can't actually
-	 * forward it in the fast path, but now that we've found an associated
-	 * connection we can flush that out before we process the packet.
-	 */
 	if (unlikely(flush_on_find)) {
-		struct sfe_ipv4_connection *c = cm->connection;
-		sfe_ipv4_remove_sfe_ipv4_connection(si, c);
-		si->exception_events[SFE_IPV4_EXCEPTION_EVENT_UDP_IP_OPTIONS_OR_INITIAL_FRAGMENT]++;
-		si->packets_not_forwarded++;
-		spin_unlock_bh(&si->lock);
+		sfe_ipv4_exception_flush_sfe_ipv4_connection(si, cm->connection,
+							     SFE_IPV4_EXCEPTION_EVENT_UDP_IP_OPTIONS_OR_INITIAL_FRAGMENT);
+		rcu_read_unlock();
 
 		DEBUG_TRACE("flush on find\n");
-		sfe_ipv4_flush_sfe_ipv4_connection(si, c, SFE_SYNC_REASON_FLUSH);
 		return 0;
 	}
 
-#ifdef CONFIG_XFRM
 	/*
-	 * We can't accelerate the flow on this direction, just let it go
-	 * through the slow path.
+	 * If every interface has left the group then let Linux deal with the packet.
 	 */
-	if (unlikely(!cm->flow_accel)) {
-		si->packets_not_forwarded++;
-		spin_unlock_bh(&si->lock);
+	mcx = rcu_dereference(cm->mc_xmit);
+	if (unlikely(!mcx->count)) {
+		rcu_read_unlock();
+		sfe_ipv4_stats_inc(si, packets_not_forwarded);
 		return 0;
 	}
-#endif
 
 	/*
-	 * Does our TTL allow forwarding?
+	 * Does our TTL allow forwarding?  Only routed interfaces use it.
 	 */
+	iph = (struct sfe_ipv4_ip_hdr *)skb->data;
 	ttl = iph->ttl;
-	if (unlikely(ttl < 2)) {
-		struct sfe_ipv4_connection *c = cm->connection;
-		sfe_ipv4_remove_sfe_ipv4_connection(si, c);
-		si->exception_events[SFE_IPV4_EXCEPTION_EVENT_UDP_SMALL_TTL]++;
-		si->packets_not_forwarded++;
-		spin_unlock_bh(&si->lock);
+	if (unlikely((ttl < 2) && mcx->routed)) {
+		sfe_ipv4_exception_flush_sfe_ipv4_connection(si, cm->connection,
+							     SFE_IPV4_EXCEPTION_EVENT_UDP_SMALL_TTL);
+		rcu_read_unlock();
 
 		DEBUG_TRACE("ttl too low\n");
-		sfe_ipv4_flush_sfe_ipv4_connection(si, c, SFE_SYNC_REASON_FLUSH);
 		return 0;
 	}
 
 	/*
-	 * If our packet is larger than the MTU of the transmit interface then
-	 * we can't forward it easily.
+	 * If our packet is larger than the MTU of any of the transmit interfaces
+	 * then we can't forward it easily.
 	 */
-	if (unlikely(len > cm->xmit_dev_mtu)) {
-		struct sfe_ipv4_connection *c = cm->connection;
-		sfe_ipv4_remove_sfe_ipv4_connection(si, c);
-		si->exception_events[SFE_IPV4_EXCEPTION_EVENT_UDP_NEEDS_FRAGMENTATION]++;
-		si->packets_not_forwarded++;
-		spin_unlock_bh(&si->lock);
+	if (unlikely(!sfe_ipv4_xmit_fits_mtu(skb, len, mcx->min_mtu))) {
+		sfe_ipv4_exception_flush_sfe_ipv4_connection(si, cm->connection,
+							     SFE_IPV4_EXCEPTION_EVENT_UDP_NEEDS_FRAGMENTATION);
+		rcu_read_unlock();
 
 		DEBUG_TRACE("larger than mtu\n");
-		sfe_ipv4_flush_sfe_ipv4_connection(si, c, SFE_SYNC_REASON_FLUSH);
 		return 0;
 	}
 
 	/*
-	 * From this point on we're good to modify the packet.
-	 */
-
-	/*
-	 * Check if skb was cloned. If it was, unshare it. Because
-	 * the data area is going to be written in this path and we don't want to
-	 * change the cloned skb's data section.
+	 * From this point on the packet is ours.
 	 */
-	if (unlikely(skb_cloned(skb))) {
-		DEBUG_TRACE("%p: skb is a cloned skb\n", skb);
-		skb = skb_unshare(skb, GFP_ATOMIC);
-                if (!skb) {
-			DEBUG_WARN("Failed to unshare the cloned skb\n");
-			si->exception_events[SFE_IPV4_EXCEPTION_EVENT_CLONED_SKB_UNSHARE_ERROR]++;
-			si->packets_not_forwarded++;
-			spin_unlock_bh(&si->lock);
-
-			return 0;
-		}
+	sfe_ipv4_connection_match_update_rx_stats(si, cm, skb, len);
+	sfe_ipv4_connection_match_activate(si, cm);
 
-		/*
-		 * Update the iph and udph pointers with the unshared skb's data area.
-		 */
-		iph = (struct sfe_ipv4_ip_hdr *)skb->data;
-		udph = (struct sfe_ipv4_udp_hdr *)(skb->data + ihl);
+	__vlan_hwaccel_clear_tag(skb);
+	if (unlikely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_PPPOE_DECAP)) {
+		skb->protocol = htons(ETH_P_IP);
+		skb_reset_network_header(skb);
 	}
 
 	/*
-	 * Update DSCP
+	 * Bridge ports send the packet on with the source MAC address it came with.
 	 */
-	if (unlikely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_DSCP_REMARK)) {
-		iph->tos = (iph->tos & SFE_IPV4_DSCP_MASK) | cm->dscp;
+	if (mcx->bridged) {
+		memcpy(rx_src_mac, eth_hdr(skb)->h_source, ETH_ALEN);
 	}
 
-	/*
-	 * Decrement our TTL.
-	 */
-	iph->ttl = ttl - 1;
+	mark = cm->connection->mark;
 
-	/*
-	 * Do we have to perform translations of the source address/port?
-	 */
-	if (unlikely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_XLATE_SRC)) {
-		u16 udp_csum;
+	for (i = 0; i < mcx->count; i++) {
+		xif = &mcx->xif[i];
 
-		iph->saddr = cm->xlate_src_ip;
-		udph->source = cm->xlate_src_port;
+		if (i < mcx->count - 1) {
+			nskb = skb_clone(skb, GFP_ATOMIC);
+			if (unlikely(!nskb)) {
+				sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_MULTICAST_CLONE_FAILED);
+				continue;
+			}
+		} else {
+			nskb = skb;
+		}
 
 		/*
-		 * Do we have a non-zero UDP checksum?  If we do then we need
-		 * to update it.
+		 * Get a private copy of the headers, with room for the ones we add.
 		 */
-		udp_csum = udph->check;
-		if (likely(udp_csum)) {
-			u32 sum;
-
-			if (unlikely(skb->ip_summed == CHECKSUM_PARTIAL)) {
-				sum = udp_csum + cm->xlate_src_partial_csum_adjustment;
-			} else {
-				sum = udp_csum + cm->xlate_src_csum_adjustment;
-			}
+		if (unlikely(skb_cow(nskb, xif->xmit_headroom))) {
+			kfree_skb(nskb);
+			sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_NO_HEADROOM);
+			continue;
+		}
 
-			sum = (sum & 0xffff) + (sum >> 16);
-			udph->check = (u16)sum;
+		iph = (struct sfe_ipv4_ip_hdr *)nskb->data;
+		ip_csum_adj = 0;
+		if (unlikely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_DSCP_REMARK)) {
+			ip_csum_adj += sfe_ipv4_remark_dscp(iph, cm->dscp);
 		}
-	}
 
-	/*
-	 * Do we have to perform translations of the destination address/port?
-	 */
-	if (unlikely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_XLATE_DEST)) {
-		u16 udp_csum;
+		if (likely(!(xif->flags & SFE_IPV4_MC_XMIT_IF_FLAG_BRIDGE_FLOW))) {
+			iph->ttl = ttl - 1;
+			ip_csum_adj += SFE_IPV4_TTL_DEC_CSUM_ADJUSTMENT;
+		}
 
-		iph->daddr = cm->xlate_dest_ip;
-		udph->dest = cm->xlate_dest_port;
+		sfe_ipv4_update_ip_csum(iph, ip_csum_adj);
 
 		/*
-		 * Do we have a non-zero UDP checksum?  If we do then we need
-		 * to update it.
+		 * Any checksum the driver computed over the packet no longer matches it.
 		 */
-		udp_csum = udph->check;
-		if (likely(udp_csum)) {
-			u32 sum;
+		if (unlikely(nskb->ip_summed == CHECKSUM_COMPLETE)) {
+			nskb->ip_summed = CHECKSUM_NONE;
+		}
 
-			if (unlikely(skb->ip_summed == CHECKSUM_PARTIAL)) {
-				sum = udp_csum + cm->xlate_dest_partial_csum_adjustment;
-			} else {
-				sum = udp_csum + cm->xlate_dest_csum_adjustment;
+		nskb->dev = xif->xmit_dev;
+
+		if (likely(xif->flags & SFE_IPV4_MC_XMIT_IF_FLAG_WRITE_L2_HDR)) {
+			u16 *src_mac = xif->xmit_src_mac;
+
+			if (unlikely(xif->flags & SFE_IPV4_MC_XMIT_IF_FLAG_BRIDGE_FLOW)) {
+				src_mac = rx_src_mac;
 			}
 
-			sum = (sum & 0xffff) + (sum >> 16);
-			udph->check = (u16)sum;
-		}
-	}
+			if (unlikely(xif->flags & SFE_IPV4_MC_XMIT_IF_FLAG_PPPOE_ENCAP)) {
+				sfe_pppoe_add_header(nskb, xif->xmit_pppoe_session_id, PPP_IP, ntohs(iph->tot_len));
+			}
 
-	/*
-	 * Replace the IP checksum.
-	 */
-	iph->check = sfe_ipv4_gen_ip_csum(iph);
+			if (unlikely(xif->xmit_vlan_count)) {
+				sfe_vlan_add_tags(nskb, xif->xmit_vlan_count, xif->xmit_vlan_tag);
+			}
 
-	/*
-	 * Update traffic stats.
-	 */
-	cm->rx_packet_count++;
-	cm->rx_byte_count += len;
+			if (unlikely(!(xif->flags & SFE_IPV4_MC_XMIT_IF_FLAG_WRITE_FAST_ETH_HDR))) {
+				dev_hard_header(nskb, xif->xmit_dev, ntohs(nskb->protocol),
+						xif->xmit_dest_mac, src_mac, len);
+			} else {
+				struct sfe_ipv4_eth_hdr *eth = (struct sfe_ipv4_eth_hdr *)__skb_push(nskb, ETH_HLEN);
+				eth->h_proto = nskb->protocol;
+				eth->h_dest[0] = xif->xmit_dest_mac[0];
+				eth->h_dest[1] = xif->xmit_dest_mac[1];
+				eth->h_dest[2] = xif->xmit_dest_mac[2];
+				eth->h_source[0] = src_mac[0];
+				eth->h_source[1] = src_mac[1];
+				eth->h_source[2] = src_mac[2];
+			}
+		}
 
-	/*
-	 * If we're not already on the active list then insert ourselves at the tail
-	 * of the current list.
-	 */
-	if (unlikely(!cm->active)) {
-		cm->active = true;
-		cm->active_prev = si->active_tail;
-		if (likely(si->active_tail)) {
-			si->active_tail->active_next = cm;
-		} else {
-			si->active_head = cm;
+		if (unlikely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_PRIORITY_REMARK)) {
+			nskb->priority = cm->priority;
 		}
-		si->active_tail = cm;
-	}
 
-	xmit_dev = cm->xmit_dev;
-	skb->dev = xmit_dev;
+		nskb->mark = mark;
+		nskb->fast_forwarded = 1;
 
-	/*
-	 * Check to see if we need to write a header.
-	 */
-	if (likely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_WRITE_L2_HDR)) {
-		if (unlikely(!(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_WRITE_FAST_ETH_HDR))) {
-			dev_hard_header(skb, xmit_dev, ETH_P_IP,
-					cm->xmit_dest_mac, cm->xmit_src_mac, len);
+		if (batch) {
+			__skb_queue_tail(&batch->xmit_queue, nskb);
 		} else {
-			/*
-			 * For the simple case we write this really fast.
-			 */
-			struct sfe_ipv4_eth_hdr *eth = (struct sfe_ipv4_eth_hdr *)__skb_push(skb, ETH_HLEN);
-			eth->h_proto = htons(ETH_P_IP);
-			eth->h_dest[0] = cm->xmit_dest_mac[0];
-			eth->h_dest[1] = cm->xmit_dest_mac[1];
-			eth->h_dest[2] = cm->xmit_dest_mac[2];
-			eth->h_source[0] = cm->xmit_src_mac[0];
-			eth->h_source[1] = cm->xmit_src_mac[1];
-			eth->h_source[2] = cm->xmit_src_mac[2];
+			dev_queue_xmit(nskb);
 		}
 	}
 
-	/*
-	 * Update priority of skb.
-	 */
-	if (unlikely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_PRIORITY_REMARK)) {
-		skb->priority = cm->priority;
-	}
+	rcu_read_unlock();
+	return 1;
+}
 
-	/*
-	 * Mark outgoing packet.
-	 */
-	skb->mark = cm->connection->mark;
-	if (skb->mark) {
-		DEBUG_TRACE("SKB MARK is NON ZERO %x\n", skb->mark);
-	}
+/*
+ * sfe_ipv4_frag_entry()
+ *	Find the fragment table entry a datagram would use.
+ */
+static inline struct sfe_ipv4_frag *sfe_ipv4_frag_entry(struct sfe_ipv4 *si, const struct sfe_ipv4_ip_hdr *iph)
+{
+	u32 hash = jhash_3words((__force u32)iph->saddr, (__force u32)iph->daddr,
+				((__force u32)iph->id << 8) | iph->protocol, si->frag_seed);
 
-	si->packets_forwarded++;
-	spin_unlock_bh(&si->lock);
+	return &si->frag_table[hash & SFE_IPV4_FRAG_TABLE_MASK];
+}
 
-	/*
-	 * We're going to check for GSO flags when we transmit the packet so
-	 * start fetching the necessary cache line now.
-	 */
-	prefetch(skb_shinfo(skb));
+/*
+ * sfe_ipv4_frag_live()
+ *	Check whether a fragment table entry is tracking a datagram.
+ */
+static inline bool sfe_ipv4_frag_live(const struct sfe_ipv4_frag *f)
+{
+	return (f->state != SFE_IPV4_FRAG_STATE_FREE) && time_before(jiffies, f->timeout);
+}
 
-	/*
-	 * Mark that this packet has been fast forwarded.
-	 */
-	skb->fast_forwarded = 1;
+/*
+ * sfe_ipv4_frag_is()
+ *	Check whether a live fragment table entry is tracking the datagram a fragment belongs to.
+ */
+static inline bool sfe_ipv4_frag_is(const struct sfe_ipv4_frag *f, const struct sfe_ipv4_ip_hdr *iph)
+{
+	return (f->id == iph->id) && (f->src_ip == iph->saddr) &&
+	       (f->dest_ip == iph->daddr) && (f->protocol == iph->protocol);
+}
 
-	/*
-	 * Send the packet on its way.
-	 */
-	dev_queue_xmit(skb);
+/*
+ * sfe_ipv4_frag_init()
+ *	Start tracking the datagram a fragment belongs to.
+ */
+static inline void sfe_ipv4_frag_init(struct sfe_ipv4_frag *f, const struct sfe_ipv4_ip_hdr *iph, u8 state)
+{
+	f->src_ip = iph->saddr;
+	f->dest_ip = iph->daddr;
+	f->id = iph->id;
+	f->protocol = iph->protocol;
+	f->state = state;
+	f->len_seen = 0;
+	f->len_total = 0;
+	f->timeout = jiffies + SFE_IPV4_FRAG_TIMEOUT;
+}
 
-	return 1;
+/*
+ * sfe_ipv4_frag_account()
+ *	Account for a fragment of a tracked datagram.
+ *
+ * Once all of the datagram's payload has been seen the entry is freed.
+ */
+static inline void sfe_ipv4_frag_account(struct sfe_ipv4_frag *f, const struct sfe_ipv4_ip_hdr *iph)
+{
+	unsigned int frag_off = ntohs(iph->frag_off);
+	unsigned int payload_len = ntohs(iph->tot_len) - (iph->ihl << 2);
+
+	f->len_seen += payload_len;
+	if (!(frag_off & IP_MF)) {
+		f->len_total = ((frag_off & IP_OFFSET) << 3) + payload_len;
+	}
+
+	if (f->len_total && (f->len_seen >= f->len_total)) {
+		f->state = SFE_IPV4_FRAG_STATE_FREE;
+	}
 }
 
 /*
- * sfe_ipv4_process_tcp_option_sack()
- *	Parse TCP SACK option and update ack according
+ * sfe_ipv4_frag_add()
+ *	Note the ports carried by the first fragment of a datagram we're forwarding.
+ *
+ * Returns false if the datagram can't be tracked, or if some of it has already
+ * been passed to the slow path, in which case none of it may be forwarded here.
  */
-static bool sfe_ipv4_process_tcp_option_sack(const struct sfe_ipv4_tcp_hdr *th, const u32 data_offs,
-					     u32 *ack)
+static bool sfe_ipv4_frag_add(struct sfe_ipv4 *si, const struct sfe_ipv4_ip_hdr *iph,
+			      __be16 src_port, __be16 dest_port)
 {
-	u32 length = sizeof(struct sfe_ipv4_tcp_hdr);
-	u8 *ptr = (u8 *)th + length;
+	struct sfe_ipv4_frag *f;
+	bool ret = true;
+
+	spin_lock_bh(&si->frag_lock);
+	f = sfe_ipv4_frag_entry(si, iph);
+	if (!sfe_ipv4_frag_live(f)) {
+		sfe_ipv4_frag_init(f, iph, SFE_IPV4_FRAG_STATE_FORWARD);
+	} else if (!sfe_ipv4_frag_is(f, iph)) {
+		spin_unlock_bh(&si->frag_lock);
+		return false;
+	}
 
-	/*
-	 * Ignore processing if TCP packet has only TIMESTAMP option.
-	 */
-	if (likely(data_offs == length + TCPOLEN_TIMESTAMP + 1 + 1)
-	    && likely(ptr[0] == TCPOPT_NOP)
-	    && likely(ptr[1] == TCPOPT_NOP)
-	    && likely(ptr[2] == TCPOPT_TIMESTAMP)
-	    && likely(ptr[3] == TCPOLEN_TIMESTAMP)) {
-		return true;
+	if (likely(f->state == SFE_IPV4_FRAG_STATE_FORWARD)) {
+		f->src_port = src_port;
+		f->dest_port = dest_port;
+	} else {
+		ret = false;
 	}
 
-	/*
-	 * TCP options. Parse SACK option.
-	 */
-	while (length < data_offs) {
-		u8 size;
-		u8 kind;
+	sfe_ipv4_frag_account(f, iph);
+	spin_unlock_bh(&si->frag_lock);
+	return ret;
+}
 
-		ptr = (u8 *)th + length;
-		kind = *ptr;
+/*
+ * sfe_ipv4_frag_del()
+ *	Stop tracking a datagram whose first fragment we dropped after sfe_ipv4_frag_add().
+ *
+ * The rest of the datagram can't be reassembled without it, so it isn't
+ * forwarded here on the strength of ports the receiver will never see.
+ */
+static void sfe_ipv4_frag_del(struct sfe_ipv4 *si, const struct sfe_ipv4_ip_hdr *iph)
+{
+	struct sfe_ipv4_frag *f;
 
-		/*
-		 * NOP, for padding
-		 * Not in the switch because to fast escape and to not calculate size
-		 */
-		if (kind == TCPOPT_NOP) {
-			length++;
-			continue;
-		}
+	spin_lock_bh(&si->frag_lock);
+	f = sfe_ipv4_frag_entry(si, iph);
+	if (sfe_ipv4_frag_live(f) && sfe_ipv4_frag_is(f, iph)) {
+		f->state = SFE_IPV4_FRAG_STATE_FREE;
+	}
+	spin_unlock_bh(&si->frag_lock);
+}
 
-		if (kind == TCPOPT_SACK) {
-			u32 sack = 0;
-			u8 re = 1 + 1;
+/*
+ * sfe_ipv4_frag_find()
+ *	Find the ports of the datagram a non-initial fragment belongs to.
+ *
+ * If the first fragment hasn't been forwarded here then the datagram is noted
+ * as belonging to the slow path, so that a first fragment that arrives late
+ * follows the rest.  Returns false if the fragment isn't to be forwarded here.
+ *
+ * A fragment that is to be forwarded isn't accounted for yet; the caller must
+ * pass it to sfe_ipv4_frag_commit() once it knows whether it can forward it.
+ */
+static bool sfe_ipv4_frag_find(struct sfe_ipv4 *si, const struct sfe_ipv4_ip_hdr *iph,
+			       __be16 *src_port, __be16 *dest_port)
+{
+	struct sfe_ipv4_frag *f;
+
+	spin_lock_bh(&si->frag_lock);
+	f = sfe_ipv4_frag_entry(si, iph);
+	if (!sfe_ipv4_frag_live(f)) {
+		sfe_ipv4_frag_init(f, iph, SFE_IPV4_FRAG_STATE_SLOW);
+	} else if (sfe_ipv4_frag_is(f, iph) && (f->state == SFE_IPV4_FRAG_STATE_FORWARD)) {
+		*src_port = f->src_port;
+		*dest_port = f->dest_port;
+		spin_unlock_bh(&si->frag_lock);
+		return true;
+	}
 
-			size = *(ptr + 1);
-			if ((size < (1 + 1 + TCPOLEN_SACK_PERBLOCK))
-			    || ((size - (1 + 1)) % (TCPOLEN_SACK_PERBLOCK))
-			    || (size > (data_offs - length))) {
-				return false;
-			}
+	if (sfe_ipv4_frag_is(f, iph)) {
+		sfe_ipv4_frag_account(f, iph);
+	}
+	spin_unlock_bh(&si->frag_lock);
 
-			re += 4;
-			while (re < size) {
-				u32 sack_re;
-				u8 *sptr = ptr + re;
-				sack_re = (sptr[0] << 24) | (sptr[1] << 16) | (sptr[2] << 8) | sptr[3];
-				if (sack_re > sack) {
-					sack = sack_re;
-				}
-				re += TCPOLEN_SACK_PERBLOCK;
-			}
-			if (sack > *ack) {
-				*ack = sack;
-			}
-			length += size;
-			continue;
-		}
-		if (kind == TCPOPT_EOL) {
-			return true;
-		}
-		size = *(ptr + 1);
-		if (size < 2) {
-			return false;
+	return false;
+}
+
+/*
+ * sfe_ipv4_frag_commit()
+ *	Account for a non-initial fragment that sfe_ipv4_frag_find() let through.
+ *
+ * If the fragment is going to the slow path after all then so does the rest of
+ * its datagram; the kernel can't reassemble a datagram we're forwarding part of.
+ */
+static void sfe_ipv4_frag_commit(struct sfe_ipv4 *si, const struct sfe_ipv4_ip_hdr *iph, bool forward)
+{
+	struct sfe_ipv4_frag *f;
+
+	spin_lock_bh(&si->frag_lock);
+	f = sfe_ipv4_frag_entry(si, iph);
+	if (sfe_ipv4_frag_live(f) && sfe_ipv4_frag_is(f, iph)) {
+		if (!forward) {
+			f->state = SFE_IPV4_FRAG_STATE_SLOW;
 		}
-		length += size;
-	}
 
-	return true;
+		sfe_ipv4_frag_account(f, iph);
+	}
+	spin_unlock_bh(&si->frag_lock);
 }
 
 /*
- * sfe_ipv4_recv_tcp()
- *	Handle TCP packet receives and forwarding.
+ * sfe_ipv4_recv_udp()
+ *	Handle UDP packet receives and forwarding.
  */
-static int sfe_ipv4_recv_tcp(struct sfe_ipv4 *si, struct sk_buff *skb, struct net_device *dev,
-			     unsigned int len, struct sfe_ipv4_ip_hdr *iph, unsigned int ihl, bool flush_on_find)
+static int sfe_ipv4_recv_udp(struct sfe_ipv4 *si, struct sk_buff *skb, struct net_device *dev,
+			     unsigned int len, struct sfe_ipv4_ip_hdr *iph, unsigned int ihl, bool flush_on_find,
+			     const struct sfe_vlan_info *vi, const struct sfe_tun_info *ti,
+			     struct sfe_ipv4_recv_batch *batch)
 {
-	struct sfe_ipv4_tcp_hdr *tcph;
+	struct sfe_ipv4_udp_hdr *udph;
 	__be32 src_ip;
 	__be32 dest_ip;
 	__be16 src_port;
 	__be16 dest_port;
 	struct sfe_ipv4_connection_match *cm;
-	struct sfe_ipv4_connection_match *counter_cm;
 	u8 ttl;
-	u32 flags;
+	u32 ip_csum_adj;
 	struct net_device *xmit_dev;
 
 	/*
 	 * Is our packet too short to contain a valid UDP header?
 	 */
-	if (unlikely(!pskb_may_pull(skb, (sizeof(struct sfe_ipv4_tcp_hdr) + ihl)))) {
-		spin_lock_bh(&si->lock);
-		si->exception_events[SFE_IPV4_EXCEPTION_EVENT_TCP_HEADER_INCOMPLETE]++;
-		si->packets_not_forwarded++;
-		spin_unlock_bh(&si->lock);
+	if (unlikely(!pskb_may_pull(skb, (sizeof(struct sfe_ipv4_udp_hdr) + ihl)))) {
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_UDP_HEADER_INCOMPLETE);
 
-		DEBUG_TRACE("packet too short for TCP header\n");
+		DEBUG_TRACE("packet too short for UDP header\n");
 		return 0;
 	}
 
 	/*
 	 * Read the IP address and port information.  Read the IP header data first
 	 * because we've almost certainly got that in the cache.  We may not yet have
-	 * the TCP header cached though so allow more time for any prefetching.
+	 * the UDP header cached though so allow more time for any prefetching.
 	 */
 	src_ip = iph->saddr;
 	dest_ip = iph->daddr;
 
-	tcph = (struct sfe_ipv4_tcp_hdr *)(skb->data + ihl);
-	src_port = tcph->source;
-	dest_port = tcph->dest;
-	flags = tcp_flag_word(tcph);
+	udph = (struct sfe_ipv4_udp_hdr *)(skb->data + ihl);
+	src_port = udph->source;
+	dest_port = udph->dest;
 
-	spin_lock_bh(&si->lock);
+	rcu_read_lock();
 
 	/*
 	 * Look for a connection match.
 	 */
-#ifdef CONFIG_NF_FLOW_COOKIE
-	cm = si->sfe_flow_cookie_table[skb->flow_cookie & SFE_FLOW_COOKIE_MASK].match;
+	cm = sfe_ipv4_recv_find_connection_match(si, batch, skb, dev, IPPROTO_UDP,
+						src_ip, src_port, dest_ip, dest_port);
 	if (unlikely(!cm)) {
-		cm = sfe_ipv4_find_sfe_ipv4_connection_match(si, dev, IPPROTO_TCP, src_ip, src_port, dest_ip, dest_port);
+		rcu_read_unlock();
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_UDP_NO_CONNECTION);
+
+		DEBUG_TRACE("no connection found\n");
+		return 0;
 	}
-#else
-	cm = sfe_ipv4_find_sfe_ipv4_connection_match(si, dev, IPPROTO_TCP, src_ip, src_port, dest_ip, dest_port);
-#endif
-	if (unlikely(!cm)) {
-		/*
-		 * We didn't get a connection but as TCP is connection-oriented that
-		 * may be because this is a non-fast connection (not running established).
-		 * For diagnostic purposes we differentiate this here.
-		 */
-		if (likely((flags & (TCP_FLAG_SYN | TCP_FLAG_RST | TCP_FLAG_FIN | TCP_FLAG_ACK)) == TCP_FLAG_ACK)) {
-			si->exception_events[SFE_IPV4_EXCEPTION_EVENT_TCP_NO_CONNECTION_FAST_FLAGS]++;
-			si->packets_not_forwarded++;
-			spin_unlock_bh(&si->lock);
 
-			DEBUG_TRACE("no connection found - fast flags\n");
-			return 0;
-		}
-		si->exception_events[SFE_IPV4_EXCEPTION_EVENT_TCP_NO_CONNECTION_SLOW_FLAGS]++;
-		si->packets_not_forwarded++;
-		spin_unlock_bh(&si->lock);
+	/*
+	 * Is the packet on the PPPoE session, if any, that the connection expects?
+	 */
+	if (unlikely(!sfe_pppoe_session_match(skb, cm->match_pppoe_session_id))) {
+		rcu_read_unlock();
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_PPPOE_SESSION_MISMATCH);
 
-		DEBUG_TRACE("no connection found - slow flags: 0x%x\n",
-			    flags & (TCP_FLAG_SYN | TCP_FLAG_RST | TCP_FLAG_FIN | TCP_FLAG_ACK));
+		DEBUG_TRACE("PPPoE session mismatch\n");
+		return 0;
+	}
+
+	/*
+	 * Did the packet arrive with the VLAN tags the connection expects?
+	 */
+	if (unlikely(!sfe_vlan_match(vi, cm->match_vlan_count, cm->match_vlan_tag))) {
+		rcu_read_unlock();
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_VLAN_MISMATCH);
+
+		DEBUG_TRACE("VLAN tag mismatch\n");
+		return 0;
+	}
+
+	/*
+	 * Did the packet arrive through the tunnel, if any, that the connection expects?
+	 */
+	if (unlikely(!sfe_tun_match(ti, &cm->match_tun))) {
+		rcu_read_unlock();
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_TUN_MISMATCH);
+
+		DEBUG_TRACE("tunnel mismatch\n");
+		return 0;
+	}
+
+	/*
+	 * Multicast connections transmit on a list of interfaces.  We don't track
+	 * fragments for them.
+	 */
+	if (unlikely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_MULTICAST)) {
+		flush_on_find |= !!(iph->frag_off & htons(IP_MF));
+		return sfe_ipv4_recv_udp_multicast(si, skb, len, cm, flush_on_find, batch);
+	}
+
+	/*
+	 * A bridged connection only carries packets between the hosts it was
+	 * created for.  We send them on with the MAC addresses they came with.
+	 */
+	if (unlikely((cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_BRIDGE_FLOW) &&
+		     (!ether_addr_equal(eth_hdr(skb)->h_source, (u8 *)cm->xmit_src_mac) ||
+		      !ether_addr_equal(eth_hdr(skb)->h_dest, (u8 *)cm->xmit_dest_mac)))) {
+		rcu_read_unlock();
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_BRIDGE_MAC_MISMATCH);
+
+		DEBUG_TRACE("bridge MAC mismatch\n");
 		return 0;
 	}
 
@@ -1651,14 +2423,11 @@ static int sfe_ipv4_recv_tcp(struct sfe_ipv4 *si, struct sk_buff *skb, struct ne
 	 * connection we can flush that out before we process the packet.
 	 */
 	if (unlikely(flush_on_find)) {
-		struct sfe_ipv4_connection *c = cm->connection;
-		sfe_ipv4_remove_sfe_ipv4_connection(si, c);
-		si->exception_events[SFE_IPV4_EXCEPTION_EVENT_TCP_IP_OPTIONS_OR_INITIAL_FRAGMENT]++;
-		si->packets_not_forwarded++;
-		spin_unlock_bh(&si->lock);
+		sfe_ipv4_exception_flush_sfe_ipv4_connection(si, cm->connection,
+							     SFE_IPV4_EXCEPTION_EVENT_UDP_IP_OPTIONS_OR_INITIAL_FRAGMENT);
+		rcu_read_unlock();
 
 		DEBUG_TRACE("flush on find\n");
-		sfe_ipv4_flush_sfe_ipv4_connection(si, c, SFE_SYNC_REASON_FLUSH);
 		return 0;
 	}
 
@@ -1668,24 +2437,22 @@ static int sfe_ipv4_recv_tcp(struct sfe_ipv4 *si, struct sk_buff *skb, struct ne
 	 * through the slow path.
 	 */
 	if (unlikely(!cm->flow_accel)) {
-		si->packets_not_forwarded++;
-		spin_unlock_bh(&si->lock);
+		rcu_read_unlock();
+		sfe_ipv4_stats_inc(si, packets_not_forwarded);
 		return 0;
 	}
 #endif
+
 	/*
-	 * Does our TTL allow forwarding?
+	 * Does our TTL allow forwarding?  Bridged packets don't use it.
 	 */
 	ttl = iph->ttl;
-	if (unlikely(ttl < 2)) {
-		struct sfe_ipv4_connection *c = cm->connection;
-		sfe_ipv4_remove_sfe_ipv4_connection(si, c);
-		si->exception_events[SFE_IPV4_EXCEPTION_EVENT_TCP_SMALL_TTL]++;
-		si->packets_not_forwarded++;
-		spin_unlock_bh(&si->lock);
+	if (unlikely((ttl < 2) && !(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_BRIDGE_FLOW))) {
+		sfe_ipv4_exception_flush_sfe_ipv4_connection(si, cm->connection,
+							     SFE_IPV4_EXCEPTION_EVENT_UDP_SMALL_TTL);
+		rcu_read_unlock();
 
 		DEBUG_TRACE("ttl too low\n");
-		sfe_ipv4_flush_sfe_ipv4_connection(si, c, SFE_SYNC_REASON_FLUSH);
 		return 0;
 	}
 
@@ -1693,192 +2460,54 @@ static int sfe_ipv4_recv_tcp(struct sfe_ipv4 *si, struct sk_buff *skb, struct ne
 	 * If our packet is larger than the MTU of the transmit interface then
 	 * we can't forward it easily.
 	 */
-	if (unlikely((len > cm->xmit_dev_mtu) && !skb_is_gso(skb))) {
-		struct sfe_ipv4_connection *c = cm->connection;
-		sfe_ipv4_remove_sfe_ipv4_connection(si, c);
-		si->exception_events[SFE_IPV4_EXCEPTION_EVENT_TCP_NEEDS_FRAGMENTATION]++;
-		si->packets_not_forwarded++;
-		spin_unlock_bh(&si->lock);
+	if (unlikely(!sfe_ipv4_xmit_fits_mtu(skb, len, cm->xmit_dev_mtu))) {
+		sfe_ipv4_exception_flush_sfe_ipv4_connection(si, cm->connection,
+							     SFE_IPV4_EXCEPTION_EVENT_UDP_NEEDS_FRAGMENTATION);
+		rcu_read_unlock();
 
 		DEBUG_TRACE("larger than mtu\n");
-		sfe_ipv4_flush_sfe_ipv4_connection(si, c, SFE_SYNC_REASON_FLUSH);
 		return 0;
 	}
 
 	/*
-	 * Look at our TCP flags.  Anything missing an ACK or that has RST, SYN or FIN
-	 * set is not a fast path packet.
+	 * Is there room to add any tunnel, PPPoE and VLAN headers as well as the L2 header?
 	 */
-	if (unlikely((flags & (TCP_FLAG_SYN | TCP_FLAG_RST | TCP_FLAG_FIN | TCP_FLAG_ACK)) != TCP_FLAG_ACK)) {
-		struct sfe_ipv4_connection *c = cm->connection;
-		sfe_ipv4_remove_sfe_ipv4_connection(si, c);
-		si->exception_events[SFE_IPV4_EXCEPTION_EVENT_TCP_FLAGS]++;
-		si->packets_not_forwarded++;
-		spin_unlock_bh(&si->lock);
+	if (unlikely(skb_headroom(skb) < cm->xmit_headroom)) {
+		rcu_read_unlock();
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_NO_HEADROOM);
 
-		DEBUG_TRACE("TCP flags: 0x%x are not fast\n",
-			    flags & (TCP_FLAG_SYN | TCP_FLAG_RST | TCP_FLAG_FIN | TCP_FLAG_ACK));
-		sfe_ipv4_flush_sfe_ipv4_connection(si, c, SFE_SYNC_REASON_FLUSH);
+		DEBUG_TRACE("no headroom for L2 headers\n");
 		return 0;
 	}
 
-	counter_cm = cm->counter_match;
-
 	/*
-	 * Are we doing sequence number checking?
+	 * GSO packets are segmented as they're transmitted, which can't be done
+	 * once we've added PPPoE or tunnel headers, or while the packet still
+	 * describes tunnel headers that we've removed.
 	 */
-	if (likely(!(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_NO_SEQ_CHECK))) {
-		u32 seq;
-		u32 ack;
-		u32 sack;
-		u32 data_offs;
-		u32 end;
-		u32 left_edge;
-		u32 scaled_win;
-		u32 max_end;
+	if (unlikely(skb_is_gso(skb) &&
+		     (cm->flags & (SFE_IPV4_CONNECTION_MATCH_FLAG_PPPOE_ENCAP |
+				   SFE_IPV4_CONNECTION_MATCH_FLAG_TUN_ENCAP |
+				   SFE_IPV4_CONNECTION_MATCH_FLAG_TUN_DECAP)))) {
+		rcu_read_unlock();
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_GSO_NOT_SUPPORTED);
 
-		/*
-		 * Is our sequence fully past the right hand edge of the window?
-		 */
-		seq = ntohl(tcph->seq);
-		if (unlikely((s32)(seq - (cm->protocol_state.tcp.max_end + 1)) > 0)) {
-			struct sfe_ipv4_connection *c = cm->connection;
-			sfe_ipv4_remove_sfe_ipv4_connection(si, c);
-			si->exception_events[SFE_IPV4_EXCEPTION_EVENT_TCP_SEQ_EXCEEDS_RIGHT_EDGE]++;
-			si->packets_not_forwarded++;
-			spin_unlock_bh(&si->lock);
+		DEBUG_TRACE("GSO not supported\n");
+		return 0;
+	}
 
-			DEBUG_TRACE("seq: %u exceeds right edge: %u\n",
-				    seq, cm->protocol_state.tcp.max_end + 1);
-			sfe_ipv4_flush_sfe_ipv4_connection(si, c, SFE_SYNC_REASON_FLUSH);
+	/*
+	 * If this is the first fragment of a datagram then the rest of the
+	 * datagram will need its ports to find the connection.
+	 */
+	if (unlikely(iph->frag_off & htons(IP_MF))) {
+		if (unlikely(!sfe_ipv4_frag_add(si, iph, src_port, dest_port))) {
+			rcu_read_unlock();
+			sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_UDP_FRAGMENT_NOT_TRACKED);
+
+			DEBUG_TRACE("fragment not tracked\n");
 			return 0;
 		}
-
-		/*
-		 * Check that our TCP data offset isn't too short.
-		 */
-		data_offs = tcph->doff << 2;
-		if (unlikely(data_offs < sizeof(struct sfe_ipv4_tcp_hdr))) {
-			struct sfe_ipv4_connection *c = cm->connection;
-			sfe_ipv4_remove_sfe_ipv4_connection(si, c);
-			si->exception_events[SFE_IPV4_EXCEPTION_EVENT_TCP_SMALL_DATA_OFFS]++;
-			si->packets_not_forwarded++;
-			spin_unlock_bh(&si->lock);
-
-			DEBUG_TRACE("TCP data offset: %u, too small\n", data_offs);
-			sfe_ipv4_flush_sfe_ipv4_connection(si, c, SFE_SYNC_REASON_FLUSH);
-			return 0;
-		}
-
-		/*
-		 * Update ACK according to any SACK option.
-		 */
-		ack = ntohl(tcph->ack_seq);
-		sack = ack;
-		if (unlikely(!sfe_ipv4_process_tcp_option_sack(tcph, data_offs, &sack))) {
-			struct sfe_ipv4_connection *c = cm->connection;
-			sfe_ipv4_remove_sfe_ipv4_connection(si, c);
-			si->exception_events[SFE_IPV4_EXCEPTION_EVENT_TCP_BAD_SACK]++;
-			si->packets_not_forwarded++;
-			spin_unlock_bh(&si->lock);
-
-			DEBUG_TRACE("TCP option SACK size is wrong\n");
-			sfe_ipv4_flush_sfe_ipv4_connection(si, c, SFE_SYNC_REASON_FLUSH);
-			return 0;
-		}
-
-		/*
-		 * Check that our TCP data offset isn't past the end of the packet.
-		 */
-		data_offs += sizeof(struct sfe_ipv4_ip_hdr);
-		if (unlikely(len < data_offs)) {
-			struct sfe_ipv4_connection *c = cm->connection;
-			sfe_ipv4_remove_sfe_ipv4_connection(si, c);
-			si->exception_events[SFE_IPV4_EXCEPTION_EVENT_TCP_BIG_DATA_OFFS]++;
-			si->packets_not_forwarded++;
-			spin_unlock_bh(&si->lock);
-
-			DEBUG_TRACE("TCP data offset: %u, past end of packet: %u\n",
-				    data_offs, len);
-			sfe_ipv4_flush_sfe_ipv4_connection(si, c, SFE_SYNC_REASON_FLUSH);
-			return 0;
-		}
-
-		end = seq + len - data_offs;
-
-		/*
-		 * Is our sequence fully before the left hand edge of the window?
-		 */
-		if (unlikely((s32)(end - (cm->protocol_state.tcp.end
-						- counter_cm->protocol_state.tcp.max_win - 1)) < 0)) {
-			struct sfe_ipv4_connection *c = cm->connection;
-			sfe_ipv4_remove_sfe_ipv4_connection(si, c);
-			si->exception_events[SFE_IPV4_EXCEPTION_EVENT_TCP_SEQ_BEFORE_LEFT_EDGE]++;
-			si->packets_not_forwarded++;
-			spin_unlock_bh(&si->lock);
-
-			DEBUG_TRACE("seq: %u before left edge: %u\n",
-				    end, cm->protocol_state.tcp.end - counter_cm->protocol_state.tcp.max_win - 1);
-			sfe_ipv4_flush_sfe_ipv4_connection(si, c, SFE_SYNC_REASON_FLUSH);
-			return 0;
-		}
-
-		/*
-		 * Are we acking data that is to the right of what has been sent?
-		 */
-		if (unlikely((s32)(sack - (counter_cm->protocol_state.tcp.end + 1)) > 0)) {
-			struct sfe_ipv4_connection *c = cm->connection;
-			sfe_ipv4_remove_sfe_ipv4_connection(si, c);
-			si->exception_events[SFE_IPV4_EXCEPTION_EVENT_TCP_ACK_EXCEEDS_RIGHT_EDGE]++;
-			si->packets_not_forwarded++;
-			spin_unlock_bh(&si->lock);
-
-			DEBUG_TRACE("ack: %u exceeds right edge: %u\n",
-				    sack, counter_cm->protocol_state.tcp.end + 1);
-			sfe_ipv4_flush_sfe_ipv4_connection(si, c, SFE_SYNC_REASON_FLUSH);
-			return 0;
-		}
-
-		/*
-		 * Is our ack too far before the left hand edge of the window?
-		 */
-		left_edge = counter_cm->protocol_state.tcp.end
-			    - cm->protocol_state.tcp.max_win
-			    - SFE_IPV4_TCP_MAX_ACK_WINDOW
-			    - 1;
-		if (unlikely((s32)(sack - left_edge) < 0)) {
-			struct sfe_ipv4_connection *c = cm->connection;
-			sfe_ipv4_remove_sfe_ipv4_connection(si, c);
-			si->exception_events[SFE_IPV4_EXCEPTION_EVENT_TCP_ACK_BEFORE_LEFT_EDGE]++;
-			si->packets_not_forwarded++;
-			spin_unlock_bh(&si->lock);
-
-			DEBUG_TRACE("ack: %u before left edge: %u\n", sack, left_edge);
-			sfe_ipv4_flush_sfe_ipv4_connection(si, c, SFE_SYNC_REASON_FLUSH);
-			return 0;
-		}
-
-		/*
-		 * Have we just seen the largest window size yet for this connection?  If yes
-		 * then we need to record the new value.
-		 */
-		scaled_win = ntohs(tcph->window) << cm->protocol_state.tcp.win_scale;
-		scaled_win += (sack - ack);
-		if (unlikely(cm->protocol_state.tcp.max_win < scaled_win)) {
-			cm->protocol_state.tcp.max_win = scaled_win;
-		}
-
-		/*
-		 * If our sequence and/or ack numbers have advanced then record the new state.
-		 */
-		if (likely((s32)(end - cm->protocol_state.tcp.end) >= 0)) {
-			cm->protocol_state.tcp.end = end;
-		}
-
-		max_end = sack + scaled_win;
-		if (likely((s32)(max_end - counter_cm->protocol_state.tcp.max_end) >= 0)) {
-			counter_cm->protocol_state.tcp.max_end = max_end;
-		}
 	}
 
 	/*
@@ -1895,124 +2524,172 @@ static int sfe_ipv4_recv_tcp(struct sfe_ipv4 *si, struct sk_buff *skb, struct ne
 		skb = skb_unshare(skb, GFP_ATOMIC);
                 if (!skb) {
 			DEBUG_WARN("Failed to unshare the cloned skb\n");
-			si->exception_events[SFE_IPV4_EXCEPTION_EVENT_CLONED_SKB_UNSHARE_ERROR]++;
-			si->packets_not_forwarded++;
-			spin_unlock_bh(&si->lock);
+			rcu_read_unlock();
+			sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_CLONED_SKB_UNSHARE_ERROR);
 
-			return 0;
+			/*
+			 * skb_unshare() has freed the original packet so as far as our
+			 * caller is concerned it has been consumed.
+			 */
+			return 1;
 		}
 
 		/*
-		 * Update the iph and tcph pointers with the unshared skb's data area.
+		 * Update the iph and udph pointers with the unshared skb's data area.
 		 */
 		iph = (struct sfe_ipv4_ip_hdr *)skb->data;
-		tcph = (struct sfe_ipv4_tcp_hdr *)(skb->data + ihl);
+		udph = (struct sfe_ipv4_udp_hdr *)(skb->data + ihl);
 	}
 
 	/*
 	 * Update DSCP
 	 */
+	ip_csum_adj = cm->ip_csum_adjustment;
 	if (unlikely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_DSCP_REMARK)) {
-		iph->tos = (iph->tos & SFE_IPV4_DSCP_MASK) | cm->dscp;
+		ip_csum_adj += sfe_ipv4_remark_dscp(iph, cm->dscp);
+	}
+
+	/*
+	 * Police the flow, after any DSCP remark so that the policer's remark wins.
+	 */
+	if (unlikely(cm->police) && unlikely(!sfe_ipv4_police(cm->police, iph, len, &ip_csum_adj))) {
+		rcu_read_unlock();
+		sfe_ipv4_stats_inc(si, packets_policed);
+		if (unlikely(iph->frag_off & htons(IP_MF))) {
+			sfe_ipv4_frag_del(si, iph);
+		}
+		kfree_skb(skb);
+
+		DEBUG_TRACE("exceeds policer rate\n");
+		return 1;
 	}
 
 	/*
-	 * Decrement our TTL.
+	 * Decrement our TTL, unless we're bridging.
 	 */
-	iph->ttl = ttl - 1;
+	if (likely(!(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_BRIDGE_FLOW))) {
+		iph->ttl = ttl - 1;
+	}
 
 	/*
 	 * Do we have to perform translations of the source address/port?
 	 */
 	if (unlikely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_XLATE_SRC)) {
-		u16 tcp_csum;
-		u32 sum;
+		u16 udp_csum;
 
 		iph->saddr = cm->xlate_src_ip;
-		tcph->source = cm->xlate_src_port;
+		udph->source = cm->xlate_src_port;
 
 		/*
 		 * Do we have a non-zero UDP checksum?  If we do then we need
 		 * to update it.
 		 */
-		tcp_csum = tcph->check;
-		if (unlikely(skb->ip_summed == CHECKSUM_PARTIAL)) {
-			sum = tcp_csum + cm->xlate_src_partial_csum_adjustment;
-		} else {
-			sum = tcp_csum + cm->xlate_src_csum_adjustment;
-		}
+		udp_csum = udph->check;
+		if (likely(udp_csum)) {
+			u32 sum;
 
-		sum = (sum & 0xffff) + (sum >> 16);
-		tcph->check = (u16)sum;
+			if (unlikely(skb->ip_summed == CHECKSUM_PARTIAL)) {
+				sum = udp_csum + cm->xlate_src_partial_csum_adjustment;
+			} else {
+				sum = udp_csum + cm->xlate_src_csum_adjustment;
+			}
+
+			sum = (sum & 0xffff) + (sum >> 16);
+			udph->check = (u16)sum;
+		}
 	}
 
 	/*
 	 * Do we have to perform translations of the destination address/port?
 	 */
 	if (unlikely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_XLATE_DEST)) {
-		u16 tcp_csum;
-		u32 sum;
+		u16 udp_csum;
 
 		iph->daddr = cm->xlate_dest_ip;
-		tcph->dest = cm->xlate_dest_port;
+		udph->dest = cm->xlate_dest_port;
 
 		/*
 		 * Do we have a non-zero UDP checksum?  If we do then we need
 		 * to update it.
 		 */
-		tcp_csum = tcph->check;
-		if (unlikely(skb->ip_summed == CHECKSUM_PARTIAL)) {
-			sum = tcp_csum + cm->xlate_dest_partial_csum_adjustment;
-		} else {
-			sum = tcp_csum + cm->xlate_dest_csum_adjustment;
-		}
+		udp_csum = udph->check;
+		if (likely(udp_csum)) {
+			u32 sum;
 
-		sum = (sum & 0xffff) + (sum >> 16);
-		tcph->check = (u16)sum;
+			if (unlikely(skb->ip_summed == CHECKSUM_PARTIAL)) {
+				sum = udp_csum + cm->xlate_dest_partial_csum_adjustment;
+			} else {
+				sum = udp_csum + cm->xlate_dest_csum_adjustment;
+			}
+
+			sum = (sum & 0xffff) + (sum >> 16);
+			udph->check = (u16)sum;
+		}
 	}
 
 	/*
-	 * Replace the IP checksum.
+	 * Update the IP checksum for the changes we've made to the header.  We
+	 * don't rewrite it from scratch so that any corruption isn't hidden.
 	 */
-	iph->check = sfe_ipv4_gen_ip_csum(iph);
+	sfe_ipv4_update_ip_csum(iph, ip_csum_adj);
 
 	/*
-	 * Update traffic stats.
+	 * Any checksum the driver computed over the packet no longer matches it.
 	 */
-	cm->rx_packet_count++;
-	cm->rx_byte_count += len;
+	if (unlikely(skb->ip_summed == CHECKSUM_COMPLETE)) {
+		skb->ip_summed = CHECKSUM_NONE;
+	}
 
 	/*
-	 * If we're not already on the active list then insert ourselves at the tail
-	 * of the current list.
+	 * Update traffic stats and make sure we'll get synced.
 	 */
-	if (unlikely(!cm->active)) {
-		cm->active = true;
-		cm->active_prev = si->active_tail;
-		if (likely(si->active_tail)) {
-			si->active_tail->active_next = cm;
-		} else {
-			si->active_head = cm;
-		}
-		si->active_tail = cm;
-	}
+	sfe_ipv4_connection_match_update_rx_stats(si, cm, skb, len);
+	sfe_ipv4_connection_match_activate(si, cm);
 
 	xmit_dev = cm->xmit_dev;
 	skb->dev = xmit_dev;
 
+	/*
+	 * Any VLAN tag the driver stripped for us has been dealt with.
+	 */
+	__vlan_hwaccel_clear_tag(skb);
+
+	/*
+	 * The PPPoE or tunnel headers were stripped before we looked at the packet.
+	 */
+	if (unlikely(cm->flags & (SFE_IPV4_CONNECTION_MATCH_FLAG_PPPOE_DECAP | SFE_IPV4_CONNECTION_MATCH_FLAG_TUN_DECAP))) {
+		skb->protocol = htons(ETH_P_IP);
+		skb_reset_network_header(skb);
+	}
+
+	/*
+	 * Add the tunnel headers, which go inside any L2 headers.
+	 */
+	if (unlikely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_TUN_ENCAP)) {
+		sfe_tun_add_header(skb, &cm->xmit_tun, iph->tos, iph->ttl);
+	}
+
 	/*
 	 * Check to see if we need to write a header.
 	 */
 	if (likely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_WRITE_L2_HDR)) {
+		if (unlikely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_PPPOE_ENCAP)) {
+			sfe_pppoe_add_header(skb, cm->xmit_pppoe_session_id, PPP_IP, ntohs(iph->tot_len));
+		}
+
+		if (unlikely(cm->xmit_vlan_count)) {
+			sfe_vlan_add_tags(skb, cm->xmit_vlan_count, cm->xmit_vlan_tag);
+		}
+
 		if (unlikely(!(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_WRITE_FAST_ETH_HDR))) {
-			dev_hard_header(skb, xmit_dev, ETH_P_IP,
+			dev_hard_header(skb, xmit_dev, ntohs(skb->protocol),
 					cm->xmit_dest_mac, cm->xmit_src_mac, len);
 		} else {
 			/*
 			 * For the simple case we write this really fast.
 			 */
 			struct sfe_ipv4_eth_hdr *eth = (struct sfe_ipv4_eth_hdr *)__skb_push(skb, ETH_HLEN);
-			eth->h_proto = htons(ETH_P_IP);
+			eth->h_proto = skb->protocol;
 			eth->h_dest[0] = cm->xmit_dest_mac[0];
 			eth->h_dest[1] = cm->xmit_dest_mac[1];
 			eth->h_dest[2] = cm->xmit_dest_mac[2];
@@ -2030,15 +2707,14 @@ static int sfe_ipv4_recv_tcp(struct sfe_ipv4 *si, struct sk_buff *skb, struct ne
 	}
 
 	/*
-	 * Mark outgoing packet
+	 * Mark outgoing packet.
 	 */
 	skb->mark = cm->connection->mark;
 	if (skb->mark) {
 		DEBUG_TRACE("SKB MARK is NON ZERO %x\n", skb->mark);
 	}
 
-	si->packets_forwarded++;
-	spin_unlock_bh(&si->lock);
+	rcu_read_unlock();
 
 	/*
 	 * We're going to check for GSO flags when we transmit the packet so
@@ -2052,470 +2728,2147 @@ static int sfe_ipv4_recv_tcp(struct sfe_ipv4 *si, struct sk_buff *skb, struct ne
 	skb->fast_forwarded = 1;
 
 	/*
-	 * Send the packet on its way.
+	 * Send the packet on its way.  If it's part of a batch then hold on to it
+	 * until the rest of the batch has been handled.
 	 */
-	dev_queue_xmit(skb);
+	if (batch) {
+		__skb_queue_tail(&batch->xmit_queue, skb);
+	} else {
+		dev_queue_xmit(skb);
+	}
 
 	return 1;
 }
 
 /*
- * sfe_ipv4_recv_icmp()
- *	Handle ICMP packet receives.
+ * sfe_ipv4_recv_udp_fragment()
+ *	Handle receives and forwarding of non-initial fragments of UDP datagrams.
  *
- * ICMP packets aren't handled as a "fast path" and always have us process them
- * through the default Linux stack.  What we do need to do is look for any errors
- * about connections we are handling in the fast path.  If we find any such
- * connections then we want to flush their state so that the ICMP error path
- * within Linux has all of the correct state should it need it.
+ * These carry no UDP header, so they're forwarded using the connection the
+ * first fragment of their datagram found.  Only the IP header is rewritten;
+ * any UDP checksum update was made in the first fragment.
  */
-static int sfe_ipv4_recv_icmp(struct sfe_ipv4 *si, struct sk_buff *skb, struct net_device *dev,
-			      unsigned int len, struct sfe_ipv4_ip_hdr *iph, unsigned int ihl)
+static int sfe_ipv4_recv_udp_fragment(struct sfe_ipv4 *si, struct sk_buff *skb, struct net_device *dev,
+				      unsigned int len, struct sfe_ipv4_ip_hdr *iph,
+				      const struct sfe_vlan_info *vi, const struct sfe_tun_info *ti,
+				      struct sfe_ipv4_recv_batch *batch)
 {
-	struct icmphdr *icmph;
-	struct sfe_ipv4_ip_hdr *icmp_iph;
-	unsigned int icmp_ihl_words;
-	unsigned int icmp_ihl;
-	u32 *icmp_trans_h;
-	struct sfe_ipv4_udp_hdr *icmp_udph;
-	struct sfe_ipv4_tcp_hdr *icmp_tcph;
-	__be32 src_ip;
-	__be32 dest_ip;
 	__be16 src_port;
 	__be16 dest_port;
 	struct sfe_ipv4_connection_match *cm;
-	struct sfe_ipv4_connection *c;
-	u32 pull_len = sizeof(struct icmphdr) + ihl;
+	u8 ttl;
+	u32 ip_csum_adj;
+	struct net_device *xmit_dev;
 
 	/*
-	 * Is our packet too short to contain a valid ICMP header?
+	 * Was the first fragment of the datagram forwarded here?
 	 */
-	len -= ihl;
-	if (!pskb_may_pull(skb, pull_len)) {
-		spin_lock_bh(&si->lock);
-		si->exception_events[SFE_IPV4_EXCEPTION_EVENT_ICMP_HEADER_INCOMPLETE]++;
-		si->packets_not_forwarded++;
-		spin_unlock_bh(&si->lock);
+	if (unlikely(!sfe_ipv4_frag_find(si, iph, &src_port, &dest_port))) {
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_NON_INITIAL_FRAGMENT);
 
-		DEBUG_TRACE("packet too short for ICMP header\n");
+		DEBUG_TRACE("non-initial fragment not tracked\n");
 		return 0;
 	}
 
+	rcu_read_lock();
+
 	/*
-	 * We only handle "destination unreachable" and "time exceeded" messages.
+	 * Look for a connection match.
 	 */
-	icmph = (struct icmphdr *)(skb->data + ihl);
-	if ((icmph->type != ICMP_DEST_UNREACH)
-	    && (icmph->type != ICMP_TIME_EXCEEDED)) {
-		spin_lock_bh(&si->lock);
-		si->exception_events[SFE_IPV4_EXCEPTION_EVENT_ICMP_UNHANDLED_TYPE]++;
-		si->packets_not_forwarded++;
-		spin_unlock_bh(&si->lock);
+	cm = sfe_ipv4_recv_find_connection_match(si, batch, skb, dev, IPPROTO_UDP,
+						iph->saddr, src_port, iph->daddr, dest_port);
+	if (unlikely(!cm)) {
+		rcu_read_unlock();
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_UDP_NO_CONNECTION);
 
-		DEBUG_TRACE("unhandled ICMP type: 0x%x\n", icmph->type);
-		return 0;
+		DEBUG_TRACE("no connection found\n");
+		goto slow_path;
 	}
 
 	/*
-	 * Do we have the full embedded IP header?
+	 * The first fragment was checked against the connection's PPPoE session,
+	 * VLAN tags and tunnel but the rest of the datagram might not have followed.
 	 */
-	len -= sizeof(struct icmphdr);
-	pull_len += sizeof(struct sfe_ipv4_ip_hdr);
-	if (!pskb_may_pull(skb, pull_len)) {
-		spin_lock_bh(&si->lock);
-		si->exception_events[SFE_IPV4_EXCEPTION_EVENT_ICMP_IPV4_HEADER_INCOMPLETE]++;
-		si->packets_not_forwarded++;
-		spin_unlock_bh(&si->lock);
+	if (unlikely(!sfe_pppoe_session_match(skb, cm->match_pppoe_session_id))) {
+		rcu_read_unlock();
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_PPPOE_SESSION_MISMATCH);
 
-		DEBUG_TRACE("Embedded IP header not complete\n");
-		return 0;
+		DEBUG_TRACE("PPPoE session mismatch\n");
+		goto slow_path;
 	}
 
-	/*
-	 * Is our embedded IP version wrong?
-	 */
-	icmp_iph = (struct sfe_ipv4_ip_hdr *)(icmph + 1);
-	if (unlikely(icmp_iph->version != 4)) {
-		spin_lock_bh(&si->lock);
-		si->exception_events[SFE_IPV4_EXCEPTION_EVENT_ICMP_IPV4_NON_V4]++;
-		si->packets_not_forwarded++;
-		spin_unlock_bh(&si->lock);
+	if (unlikely(!sfe_vlan_match(vi, cm->match_vlan_count, cm->match_vlan_tag))) {
+		rcu_read_unlock();
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_VLAN_MISMATCH);
 
-		DEBUG_TRACE("IP version: %u\n", icmp_iph->version);
-		return 0;
+		DEBUG_TRACE("VLAN tag mismatch\n");
+		goto slow_path;
 	}
 
-	/*
-	 * Do we have the full embedded IP header, including any options?
-	 */
-	icmp_ihl_words = icmp_iph->ihl;
-	icmp_ihl = icmp_ihl_words << 2;
-	pull_len += icmp_ihl - sizeof(struct sfe_ipv4_ip_hdr);
-	if (!pskb_may_pull(skb, pull_len)) {
-		spin_lock_bh(&si->lock);
-		si->exception_events[SFE_IPV4_EXCEPTION_EVENT_ICMP_IPV4_IP_OPTIONS_INCOMPLETE]++;
-		si->packets_not_forwarded++;
-		spin_unlock_bh(&si->lock);
+	if (unlikely(!sfe_tun_match(ti, &cm->match_tun))) {
+		rcu_read_unlock();
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_TUN_MISMATCH);
 
-		DEBUG_TRACE("Embedded header not large enough for IP options\n");
-		return 0;
+		DEBUG_TRACE("tunnel mismatch\n");
+		goto slow_path;
 	}
 
-	len -= icmp_ihl;
-	icmp_trans_h = ((u32 *)icmp_iph) + icmp_ihl_words;
-
 	/*
-	 * Handle the embedded transport layer header.
+	 * The connection may have changed since the first fragment found it.
 	 */
-	switch (icmp_iph->protocol) {
-	case IPPROTO_UDP:
-		/*
-		 * We should have 8 bytes of UDP header - that's enough to identify
-		 * the connection.
-		 */
-		pull_len += 8;
-		if (!pskb_may_pull(skb, pull_len)) {
-			spin_lock_bh(&si->lock);
-			si->exception_events[SFE_IPV4_EXCEPTION_EVENT_ICMP_IPV4_UDP_HEADER_INCOMPLETE]++;
-			si->packets_not_forwarded++;
-			spin_unlock_bh(&si->lock);
-
-			DEBUG_TRACE("Incomplete embedded UDP header\n");
-			return 0;
-		}
+	if (unlikely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_MULTICAST)) {
+		rcu_read_unlock();
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_NON_INITIAL_FRAGMENT);
 
-		icmp_udph = (struct sfe_ipv4_udp_hdr *)icmp_trans_h;
-		src_port = icmp_udph->source;
-		dest_port = icmp_udph->dest;
-		break;
+		DEBUG_TRACE("multicast fragment\n");
+		goto slow_path;
+	}
 
-	case IPPROTO_TCP:
-		/*
-		 * We should have 8 bytes of TCP header - that's enough to identify
-		 * the connection.
-		 */
-		pull_len += 8;
-		if (!pskb_may_pull(skb, pull_len)) {
-			spin_lock_bh(&si->lock);
-			si->exception_events[SFE_IPV4_EXCEPTION_EVENT_ICMP_IPV4_TCP_HEADER_INCOMPLETE]++;
-			si->packets_not_forwarded++;
-			spin_unlock_bh(&si->lock);
+	if (unlikely((cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_BRIDGE_FLOW) &&
+		     (!ether_addr_equal(eth_hdr(skb)->h_source, (u8 *)cm->xmit_src_mac) ||
+		      !ether_addr_equal(eth_hdr(skb)->h_dest, (u8 *)cm->xmit_dest_mac)))) {
+		rcu_read_unlock();
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_BRIDGE_MAC_MISMATCH);
 
-			DEBUG_TRACE("Incomplete embedded TCP header\n");
-			return 0;
-		}
+		DEBUG_TRACE("bridge MAC mismatch\n");
+		goto slow_path;
+	}
 
-		icmp_tcph = (struct sfe_ipv4_tcp_hdr *)icmp_trans_h;
-		src_port = icmp_tcph->source;
-		dest_port = icmp_tcph->dest;
-		break;
+#ifdef CONFIG_XFRM
+	if (unlikely(!cm->flow_accel)) {
+		rcu_read_unlock();
+		sfe_ipv4_stats_inc(si, packets_not_forwarded);
+		goto slow_path;
+	}
+#endif
 
-	default:
-		spin_lock_bh(&si->lock);
-		si->exception_events[SFE_IPV4_EXCEPTION_EVENT_ICMP_IPV4_UNHANDLED_PROTOCOL]++;
-		si->packets_not_forwarded++;
-		spin_unlock_bh(&si->lock);
+	/*
+	 * Unlike a first fragment we don't flush the connection if we can't
+	 * forward the fragment.  The slow path will deal with it.
+	 */
+	ttl = iph->ttl;
+	if (unlikely((ttl < 2) && !(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_BRIDGE_FLOW))) {
+		rcu_read_unlock();
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_UDP_SMALL_TTL);
 
-		DEBUG_TRACE("Unhandled embedded IP protocol: %u\n", icmp_iph->protocol);
-		return 0;
+		DEBUG_TRACE("ttl too low\n");
+		goto slow_path;
 	}
 
-	src_ip = icmp_iph->saddr;
-	dest_ip = icmp_iph->daddr;
+	if (unlikely(len > cm->xmit_dev_mtu)) {
+		rcu_read_unlock();
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_UDP_NEEDS_FRAGMENTATION);
 
-	spin_lock_bh(&si->lock);
+		DEBUG_TRACE("larger than mtu\n");
+		goto slow_path;
+	}
 
-	/*
-	 * Look for a connection match.  Note that we reverse the source and destination
-	 * here because our embedded message contains a packet that was sent in the
-	 * opposite direction to the one in which we just received it.  It will have
-	 * been sent on the interface from which we received it though so that's still
-	 * ok to use.
-	 */
-	cm = sfe_ipv4_find_sfe_ipv4_connection_match(si, dev, icmp_iph->protocol, dest_ip, dest_port, src_ip, src_port);
-	if (unlikely(!cm)) {
-		si->exception_events[SFE_IPV4_EXCEPTION_EVENT_ICMP_NO_CONNECTION]++;
-		si->packets_not_forwarded++;
-		spin_unlock_bh(&si->lock);
+	if (unlikely(skb_headroom(skb) < cm->xmit_headroom)) {
+		rcu_read_unlock();
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_NO_HEADROOM);
 
-		DEBUG_TRACE("no connection found\n");
-		return 0;
+		DEBUG_TRACE("no headroom for L2 headers\n");
+		goto slow_path;
 	}
 
 	/*
-	 * We found a connection so now remove it from the connection list and flush
-	 * its state.
+	 * The fragment is ours now, even if the policer drops it.
 	 */
-	c = cm->connection;
-	sfe_ipv4_remove_sfe_ipv4_connection(si, c);
-	si->exception_events[SFE_IPV4_EXCEPTION_EVENT_ICMP_FLUSHED_CONNECTION]++;
-	si->packets_not_forwarded++;
-	spin_unlock_bh(&si->lock);
-
-	sfe_ipv4_flush_sfe_ipv4_connection(si, c, SFE_SYNC_REASON_FLUSH);
-	return 0;
-}
-
-/*
- * sfe_ipv4_recv()
- *	Handle packet receives and forwaring.
- *
- * Returns 1 if the packet is forwarded or 0 if it isn't.
- */
-int sfe_ipv4_recv(struct net_device *dev, struct sk_buff *skb)
-{
-	struct sfe_ipv4 *si = &__si;
-	unsigned int len;
-	unsigned int tot_len;
-	unsigned int frag_off;
-	unsigned int ihl;
-	bool flush_on_find;
-	bool ip_options;
-	struct sfe_ipv4_ip_hdr *iph;
-	u32 protocol;
+	sfe_ipv4_frag_commit(si, iph, true);
 
 	/*
-	 * Check that we have space for an IP header here.
+	 * From this point on we're good to modify the packet.
 	 */
-	len = skb->len;
-	if (unlikely(!pskb_may_pull(skb, sizeof(struct sfe_ipv4_ip_hdr)))) {
-		spin_lock_bh(&si->lock);
-		si->exception_events[SFE_IPV4_EXCEPTION_EVENT_HEADER_INCOMPLETE]++;
-		si->packets_not_forwarded++;
-		spin_unlock_bh(&si->lock);
+	if (unlikely(skb_cloned(skb))) {
+		DEBUG_TRACE("%p: skb is a cloned skb\n", skb);
+		skb = skb_unshare(skb, GFP_ATOMIC);
+		if (!skb) {
+			DEBUG_WARN("Failed to unshare the cloned skb\n");
+			rcu_read_unlock();
+			sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_CLONED_SKB_UNSHARE_ERROR);
+			return 1;
+		}
 
-		DEBUG_TRACE("len: %u is too short\n", len);
-		return 0;
+		iph = (struct sfe_ipv4_ip_hdr *)skb->data;
+	}
+
+	ip_csum_adj = cm->ip_csum_adjustment;
+	if (unlikely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_DSCP_REMARK)) {
+		ip_csum_adj += sfe_ipv4_remark_dscp(iph, cm->dscp);
 	}
 
 	/*
-	 * Check that our "total length" is large enough for an IP header.
+	 * Police the flow, after any DSCP remark so that the policer's remark wins.
 	 */
-	iph = (struct sfe_ipv4_ip_hdr *)skb->data;
-	tot_len = ntohs(iph->tot_len);
-	if (unlikely(tot_len < sizeof(struct sfe_ipv4_ip_hdr))) {
-		spin_lock_bh(&si->lock);
-		si->exception_events[SFE_IPV4_EXCEPTION_EVENT_BAD_TOTAL_LENGTH]++;
-		si->packets_not_forwarded++;
-		spin_unlock_bh(&si->lock);
+	if (unlikely(cm->police) && unlikely(!sfe_ipv4_police(cm->police, iph, len, &ip_csum_adj))) {
+		rcu_read_unlock();
+		sfe_ipv4_stats_inc(si, packets_policed);
+		kfree_skb(skb);
 
-		DEBUG_TRACE("tot_len: %u is too short\n", tot_len);
-		return 0;
+		DEBUG_TRACE("exceeds policer rate\n");
+		return 1;
 	}
 
-	/*
-	 * Is our IP version wrong?
-	 */
-	if (unlikely(iph->version != 4)) {
-		spin_lock_bh(&si->lock);
-		si->exception_events[SFE_IPV4_EXCEPTION_EVENT_NON_V4]++;
-		si->packets_not_forwarded++;
-		spin_unlock_bh(&si->lock);
+	if (likely(!(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_BRIDGE_FLOW))) {
+		iph->ttl = ttl - 1;
+	}
 
-		DEBUG_TRACE("IP version: %u\n", iph->version);
-		return 0;
+	if (unlikely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_XLATE_SRC)) {
+		iph->saddr = cm->xlate_src_ip;
 	}
 
-	/*
-	 * Does our datagram fit inside the skb?
-	 */
-	if (unlikely(tot_len > len)) {
-		spin_lock_bh(&si->lock);
-		si->exception_events[SFE_IPV4_EXCEPTION_EVENT_DATAGRAM_INCOMPLETE]++;
-		si->packets_not_forwarded++;
-		spin_unlock_bh(&si->lock);
+	if (unlikely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_XLATE_DEST)) {
+		iph->daddr = cm->xlate_dest_ip;
+	}
 
-		DEBUG_TRACE("tot_len: %u, exceeds len: %u\n", tot_len, len);
-		return 0;
+	sfe_ipv4_update_ip_csum(iph, ip_csum_adj);
+	if (unlikely(skb->ip_summed == CHECKSUM_COMPLETE)) {
+		skb->ip_summed = CHECKSUM_NONE;
 	}
 
 	/*
-	 * Do we have a non-initial fragment?
+	 * Update traffic stats and make sure we'll get synced.
 	 */
-	frag_off = ntohs(iph->frag_off);
-	if (unlikely(frag_off & IP_OFFSET)) {
-		spin_lock_bh(&si->lock);
-		si->exception_events[SFE_IPV4_EXCEPTION_EVENT_NON_INITIAL_FRAGMENT]++;
-		si->packets_not_forwarded++;
-		spin_unlock_bh(&si->lock);
+	sfe_ipv4_connection_match_update_rx_stats(si, cm, skb, len);
+	sfe_ipv4_connection_match_activate(si, cm);
 
-		DEBUG_TRACE("non-initial fragment\n");
-		return 0;
+	xmit_dev = cm->xmit_dev;
+	skb->dev = xmit_dev;
+	__vlan_hwaccel_clear_tag(skb);
+
+	if (unlikely(cm->flags & (SFE_IPV4_CONNECTION_MATCH_FLAG_PPPOE_DECAP | SFE_IPV4_CONNECTION_MATCH_FLAG_TUN_DECAP))) {
+		skb->protocol = htons(ETH_P_IP);
+		skb_reset_network_header(skb);
 	}
 
-	/*
-	 * If we have a (first) fragment then mark it to cause any connection to flush.
-	 */
-	flush_on_find = unlikely(frag_off & IP_MF) ? true : false;
+	if (unlikely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_TUN_ENCAP)) {
+		sfe_tun_add_header(skb, &cm->xmit_tun, iph->tos, iph->ttl);
+	}
 
-	/*
-	 * Do we have any IP options?  That's definite a slow path!  If we do have IP
-	 * options we need to recheck our header size.
-	 */
-	ihl = iph->ihl << 2;
-	ip_options = unlikely(ihl != sizeof(struct sfe_ipv4_ip_hdr)) ? true : false;
-	if (unlikely(ip_options)) {
-		if (unlikely(len < ihl)) {
-			spin_lock_bh(&si->lock);
-			si->exception_events[SFE_IPV4_EXCEPTION_EVENT_IP_OPTIONS_INCOMPLETE]++;
-			si->packets_not_forwarded++;
-			spin_unlock_bh(&si->lock);
+	if (likely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_WRITE_L2_HDR)) {
+		if (unlikely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_PPPOE_ENCAP)) {
+			sfe_pppoe_add_header(skb, cm->xmit_pppoe_session_id, PPP_IP, ntohs(iph->tot_len));
+		}
 
-			DEBUG_TRACE("len: %u is too short for header of size: %u\n", len, ihl);
-			return 0;
+		if (unlikely(cm->xmit_vlan_count)) {
+			sfe_vlan_add_tags(skb, cm->xmit_vlan_count, cm->xmit_vlan_tag);
 		}
 
-		flush_on_find = true;
+		if (unlikely(!(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_WRITE_FAST_ETH_HDR))) {
+			dev_hard_header(skb, xmit_dev, ntohs(skb->protocol),
+					cm->xmit_dest_mac, cm->xmit_src_mac, len);
+		} else {
+			struct sfe_ipv4_eth_hdr *eth = (struct sfe_ipv4_eth_hdr *)__skb_push(skb, ETH_HLEN);
+			eth->h_proto = skb->protocol;
+			eth->h_dest[0] = cm->xmit_dest_mac[0];
+			eth->h_dest[1] = cm->xmit_dest_mac[1];
+			eth->h_dest[2] = cm->xmit_dest_mac[2];
+			eth->h_source[0] = cm->xmit_src_mac[0];
+			eth->h_source[1] = cm->xmit_src_mac[1];
+			eth->h_source[2] = cm->xmit_src_mac[2];
+		}
 	}
 
-	protocol = iph->protocol;
-	if (IPPROTO_UDP == protocol) {
-		return sfe_ipv4_recv_udp(si, skb, dev, len, iph, ihl, flush_on_find);
+	if (unlikely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_PRIORITY_REMARK)) {
+		skb->priority = cm->priority;
 	}
 
-	if (IPPROTO_TCP == protocol) {
-		return sfe_ipv4_recv_tcp(si, skb, dev, len, iph, ihl, flush_on_find);
-	}
+	skb->mark = cm->connection->mark;
 
-	if (IPPROTO_ICMP == protocol) {
-		return sfe_ipv4_recv_icmp(si, skb, dev, len, iph, ihl);
+	rcu_read_unlock();
+
+	prefetch(skb_shinfo(skb));
+	skb->fast_forwarded = 1;
+
+	if (batch) {
+		__skb_queue_tail(&batch->xmit_queue, skb);
+	} else {
+		dev_queue_xmit(skb);
 	}
 
-	spin_lock_bh(&si->lock);
-	si->exception_events[SFE_IPV4_EXCEPTION_EVENT_UNHANDLED_PROTOCOL]++;
-	si->packets_not_forwarded++;
-	spin_unlock_bh(&si->lock);
+	return 1;
 
-	DEBUG_TRACE("not UDP, TCP or ICMP: %u\n", protocol);
+slow_path:
+	sfe_ipv4_frag_commit(si, iph, false);
 	return 0;
 }
 
-static void
-sfe_ipv4_update_tcp_state(struct sfe_ipv4_connection *c,
-			  struct sfe_connection_create *sic)
+/*
+ * sfe_ipv4_process_tcp_option_sack()
+ *	Parse TCP SACK option and update ack according
+ */
+static bool sfe_ipv4_process_tcp_option_sack(const struct sfe_ipv4_tcp_hdr *th, const u32 data_offs,
+					     u32 *ack)
 {
-	struct sfe_ipv4_connection_match *orig_cm;
-	struct sfe_ipv4_connection_match *repl_cm;
-	struct sfe_ipv4_tcp_connection_match *orig_tcp;
-	struct sfe_ipv4_tcp_connection_match *repl_tcp;
-
-	orig_cm = c->original_match;
-	repl_cm = c->reply_match;
-	orig_tcp = &orig_cm->protocol_state.tcp;
-	repl_tcp = &repl_cm->protocol_state.tcp;
+	u32 length = sizeof(struct sfe_ipv4_tcp_hdr);
+	u8 *ptr = (u8 *)th + length;
 
-	/* update orig */
-	if (orig_tcp->max_win < sic->src_td_max_window) {
-		orig_tcp->max_win = sic->src_td_max_window;
-	}
-	if ((s32)(orig_tcp->end - sic->src_td_end) < 0) {
-		orig_tcp->end = sic->src_td_end;
-	}
-	if ((s32)(orig_tcp->max_end - sic->src_td_max_end) < 0) {
-		orig_tcp->max_end = sic->src_td_max_end;
+	/*
+	 * Ignore processing if TCP packet has only TIMESTAMP option.
+	 */
+	if (likely(data_offs == length + TCPOLEN_TIMESTAMP + 1 + 1)
+	    && likely(ptr[0] == TCPOPT_NOP)
+	    && likely(ptr[1] == TCPOPT_NOP)
+	    && likely(ptr[2] == TCPOPT_TIMESTAMP)
+	    && likely(ptr[3] == TCPOLEN_TIMESTAMP)) {
+		return true;
+	}
+
+	/*
+	 * TCP options. Parse SACK option.
+	 */
+	while (length < data_offs) {
+		u8 size;
+		u8 kind;
+
+		ptr = (u8 *)th + length;
+		kind = *ptr;
+
+		/*
+		 * NOP, for padding
+		 * Not in the switch because to fast escape and to not calculate size
+		 */
+		if (kind == TCPOPT_NOP) {
+			length++;
+			continue;
+		}
+
+		if (kind == TCPOPT_SACK) {
+			u32 sack = 0;
+			u8 re = 1 + 1;
+
+			size = *(ptr + 1);
+			if ((size < (1 + 1 + TCPOLEN_SACK_PERBLOCK))
+			    || ((size - (1 + 1)) % (TCPOLEN_SACK_PERBLOCK))
+			    || (size > (data_offs - length))) {
+				return false;
+			}
+
+			re += 4;
+			while (re < size) {
+				u32 sack_re;
+				u8 *sptr = ptr + re;
+				sack_re = (sptr[0] << 24) | (sptr[1] << 16) | (sptr[2] << 8) | sptr[3];
+				if (sack_re > sack) {
+					sack = sack_re;
+				}
+				re += TCPOLEN_SACK_PERBLOCK;
+			}
+			if (sack > *ack) {
+				*ack = sack;
+			}
+			length += size;
+			continue;
+		}
+		if (kind == TCPOPT_EOL) {
+			return true;
+		}
+		size = *(ptr + 1);
+		if (size < 2) {
+			return false;
+		}
+		length += size;
+	}
+
+	return true;
+}
+
+/*
+ * sfe_ipv4_recv_tcp()
+ *	Handle TCP packet receives and forwarding.
+ */
+static int sfe_ipv4_recv_tcp(struct sfe_ipv4 *si, struct sk_buff *skb, struct net_device *dev,
+			     unsigned int len, struct sfe_ipv4_ip_hdr *iph, unsigned int ihl, bool flush_on_find,
+			     const struct sfe_vlan_info *vi, const struct sfe_tun_info *ti,
+			     struct sfe_ipv4_recv_batch *batch)
+{
+	struct sfe_ipv4_tcp_hdr *tcph;
+	__be32 src_ip;
+	__be32 dest_ip;
+	__be16 src_port;
+	__be16 dest_port;
+	struct sfe_ipv4_connection_match *cm;
+	struct sfe_ipv4_connection_match *counter_cm;
+	struct sfe_ipv4_connection *c;
+	u8 ttl;
+	u32 ip_csum_adj;
+	u32 flags;
+	bool police_remark = false;
+	struct net_device *xmit_dev;
+
+	/*
+	 * Is our packet too short to contain a valid UDP header?
+	 */
+	if (unlikely(!pskb_may_pull(skb, (sizeof(struct sfe_ipv4_tcp_hdr) + ihl)))) {
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_TCP_HEADER_INCOMPLETE);
+
+		DEBUG_TRACE("packet too short for TCP header\n");
+		return 0;
+	}
+
+	/*
+	 * Read the IP address and port information.  Read the IP header data first
+	 * because we've almost certainly got that in the cache.  We may not yet have
+	 * the TCP header cached though so allow more time for any prefetching.
+	 */
+	src_ip = iph->saddr;
+	dest_ip = iph->daddr;
+
+	tcph = (struct sfe_ipv4_tcp_hdr *)(skb->data + ihl);
+	src_port = tcph->source;
+	dest_port = tcph->dest;
+	flags = tcp_flag_word(tcph);
+
+	rcu_read_lock();
+
+	/*
+	 * Look for a connection match.
+	 */
+	cm = sfe_ipv4_recv_find_connection_match(si, batch, skb, dev, IPPROTO_TCP,
+						src_ip, src_port, dest_ip, dest_port);
+	if (unlikely(!cm)) {
+		rcu_read_unlock();
+
+		/*
+		 * We didn't get a connection but as TCP is connection-oriented that
+		 * may be because this is a non-fast connection (not running established).
+		 * For diagnostic purposes we differentiate this here.
+		 */
+		if (likely((flags & (TCP_FLAG_SYN | TCP_FLAG_RST | TCP_FLAG_FIN | TCP_FLAG_ACK)) == TCP_FLAG_ACK)) {
+			sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_TCP_NO_CONNECTION_FAST_FLAGS);
+
+			DEBUG_TRACE("no connection found - fast flags\n");
+			return 0;
+		}
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_TCP_NO_CONNECTION_SLOW_FLAGS);
+
+		DEBUG_TRACE("no connection found - slow flags: 0x%x\n",
+			    flags & (TCP_FLAG_SYN | TCP_FLAG_RST | TCP_FLAG_FIN | TCP_FLAG_ACK));
+		return 0;
+	}
+
+	/*
+	 * Is the packet on the PPPoE session, if any, that the connection expects?
+	 */
+	if (unlikely(!sfe_pppoe_session_match(skb, cm->match_pppoe_session_id))) {
+		rcu_read_unlock();
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_PPPOE_SESSION_MISMATCH);
+
+		DEBUG_TRACE("PPPoE session mismatch\n");
+		return 0;
+	}
+
+	/*
+	 * Did the packet arrive with the VLAN tags the connection expects?
+	 */
+	if (unlikely(!sfe_vlan_match(vi, cm->match_vlan_count, cm->match_vlan_tag))) {
+		rcu_read_unlock();
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_VLAN_MISMATCH);
+
+		DEBUG_TRACE("VLAN tag mismatch\n");
+		return 0;
+	}
+
+	/*
+	 * Did the packet arrive through the tunnel, if any, that the connection expects?
+	 */
+	if (unlikely(!sfe_tun_match(ti, &cm->match_tun))) {
+		rcu_read_unlock();
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_TUN_MISMATCH);
+
+		DEBUG_TRACE("tunnel mismatch\n");
+		return 0;
+	}
+
+	/*
+	 * A bridged connection only carries packets between the hosts it was
+	 * created for.  We send them on with the MAC addresses they came with.
+	 */
+	if (unlikely((cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_BRIDGE_FLOW) &&
+		     (!ether_addr_equal(eth_hdr(skb)->h_source, (u8 *)cm->xmit_src_mac) ||
+		      !ether_addr_equal(eth_hdr(skb)->h_dest, (u8 *)cm->xmit_dest_mac)))) {
+		rcu_read_unlock();
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_BRIDGE_MAC_MISMATCH);
+
+		DEBUG_TRACE("bridge MAC mismatch\n");
+		return 0;
+	}
+
+	c = cm->connection;
+
+	/*
+	 * If our packet has beern marked as "flush on find" we can't actually
+	 * forward it in the fast path, but now that we've found an associated
+	 * connection we can flush that out before we process the packet.
+	 */
+	if (unlikely(flush_on_find)) {
+		sfe_ipv4_exception_flush_sfe_ipv4_connection(si, c, SFE_IPV4_EXCEPTION_EVENT_TCP_IP_OPTIONS_OR_INITIAL_FRAGMENT);
+		rcu_read_unlock();
+
+		DEBUG_TRACE("flush on find\n");
+		return 0;
+	}
+
+#ifdef CONFIG_XFRM
+	/*
+	 * We can't accelerate the flow on this direction, just let it go
+	 * through the slow path.
+	 */
+	if (unlikely(!cm->flow_accel)) {
+		rcu_read_unlock();
+		sfe_ipv4_stats_inc(si, packets_not_forwarded);
+		return 0;
+	}
+#endif
+	/*
+	 * Does our TTL allow forwarding?  Bridged packets don't use it.
+	 */
+	ttl = iph->ttl;
+	if (unlikely((ttl < 2) && !(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_BRIDGE_FLOW))) {
+		sfe_ipv4_exception_flush_sfe_ipv4_connection(si, c, SFE_IPV4_EXCEPTION_EVENT_TCP_SMALL_TTL);
+		rcu_read_unlock();
+
+		DEBUG_TRACE("ttl too low\n");
+		return 0;
+	}
+
+	/*
+	 * If our packet is larger than the MTU of the transmit interface then
+	 * we can't forward it easily.
+	 */
+	if (unlikely(!sfe_ipv4_xmit_fits_mtu(skb, len, cm->xmit_dev_mtu))) {
+		sfe_ipv4_exception_flush_sfe_ipv4_connection(si, c, SFE_IPV4_EXCEPTION_EVENT_TCP_NEEDS_FRAGMENTATION);
+		rcu_read_unlock();
+
+		DEBUG_TRACE("larger than mtu\n");
+		return 0;
+	}
+
+	/*
+	 * Is there room to add any tunnel, PPPoE and VLAN headers as well as the L2 header?
+	 */
+	if (unlikely(skb_headroom(skb) < cm->xmit_headroom)) {
+		rcu_read_unlock();
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_NO_HEADROOM);
+
+		DEBUG_TRACE("no headroom for L2 headers\n");
+		return 0;
+	}
+
+	/*
+	 * GSO packets are segmented as they're transmitted, which can't be done
+	 * once we've added PPPoE or tunnel headers, or while the packet still
+	 * describes tunnel headers that we've removed.
+	 */
+	if (unlikely(skb_is_gso(skb) &&
+		     (cm->flags & (SFE_IPV4_CONNECTION_MATCH_FLAG_PPPOE_ENCAP |
+				   SFE_IPV4_CONNECTION_MATCH_FLAG_TUN_ENCAP |
+				   SFE_IPV4_CONNECTION_MATCH_FLAG_TUN_DECAP)))) {
+		rcu_read_unlock();
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_GSO_NOT_SUPPORTED);
+
+		DEBUG_TRACE("GSO not supported\n");
+		return 0;
+	}
+
+	/*
+	 * Look at our TCP flags.  Anything missing an ACK or that has RST, SYN or FIN
+	 * set is not a fast path packet.
+	 */
+	if (unlikely((flags & (TCP_FLAG_SYN | TCP_FLAG_RST | TCP_FLAG_FIN | TCP_FLAG_ACK)) != TCP_FLAG_ACK)) {
+		sfe_ipv4_exception_flush_sfe_ipv4_connection(si, c, SFE_IPV4_EXCEPTION_EVENT_TCP_FLAGS);
+		rcu_read_unlock();
+
+		DEBUG_TRACE("TCP flags: 0x%x are not fast\n",
+			    flags & (TCP_FLAG_SYN | TCP_FLAG_RST | TCP_FLAG_FIN | TCP_FLAG_ACK));
+		return 0;
+	}
+
+	/*
+	 * Police the flow before the packet can move the TCP window on, so that a
+	 * packet the policer drops leaves no trace in the connection's state.
+	 */
+	if (unlikely(cm->police) && unlikely(!sfe_police_conform(cm->police, len))) {
+		if (cm->police->action == SFE_POLICE_ACTION_DROP) {
+			rcu_read_unlock();
+			sfe_ipv4_stats_inc(si, packets_policed);
+			kfree_skb(skb);
+
+			DEBUG_TRACE("exceeds policer rate\n");
+			return 1;
+		}
+
+		police_remark = true;
+	}
+
+	counter_cm = cm->counter_match;
+
+	/*
+	 * Are we doing sequence number checking?
+	 */
+	if (likely(!(READ_ONCE(cm->flags) & SFE_IPV4_CONNECTION_MATCH_FLAG_NO_SEQ_CHECK))) {
+		u32 seq;
+		u32 ack;
+		u32 sack;
+		u32 data_offs;
+		u32 end;
+		u32 left_edge;
+		u32 scaled_win;
+		u32 max_end;
+
+		/*
+		 * Both directions of the connection update each other's window state
+		 * and may be processed on different CPUs, so serialise on the connection.
+		 */
+		spin_lock_bh(&c->lock);
+
+		/*
+		 * Is our sequence fully past the right hand edge of the window?
+		 */
+		seq = ntohl(tcph->seq);
+		if (unlikely((s32)(seq - (cm->protocol_state.tcp.max_end + 1)) > 0)) {
+			spin_unlock_bh(&c->lock);
+			sfe_ipv4_exception_flush_sfe_ipv4_connection(si, c, SFE_IPV4_EXCEPTION_EVENT_TCP_SEQ_EXCEEDS_RIGHT_EDGE);
+			rcu_read_unlock();
+
+			DEBUG_TRACE("seq: %u exceeds right edge: %u\n",
+				    seq, cm->protocol_state.tcp.max_end + 1);
+			return 0;
+		}
+
+		/*
+		 * Check that our TCP data offset isn't too short.
+		 */
+		data_offs = tcph->doff << 2;
+		if (unlikely(data_offs < sizeof(struct sfe_ipv4_tcp_hdr))) {
+			spin_unlock_bh(&c->lock);
+			sfe_ipv4_exception_flush_sfe_ipv4_connection(si, c, SFE_IPV4_EXCEPTION_EVENT_TCP_SMALL_DATA_OFFS);
+			rcu_read_unlock();
+
+			DEBUG_TRACE("TCP data offset: %u, too small\n", data_offs);
+			return 0;
+		}
+
+		/*
+		 * Update ACK according to any SACK option.
+		 */
+		ack = ntohl(tcph->ack_seq);
+		sack = ack;
+		if (unlikely(!sfe_ipv4_process_tcp_option_sack(tcph, data_offs, &sack))) {
+			spin_unlock_bh(&c->lock);
+			sfe_ipv4_exception_flush_sfe_ipv4_connection(si, c, SFE_IPV4_EXCEPTION_EVENT_TCP_BAD_SACK);
+			rcu_read_unlock();
+
+			DEBUG_TRACE("TCP option SACK size is wrong\n");
+			return 0;
+		}
+
+		/*
+		 * Check that our TCP data offset isn't past the end of the packet.
+		 */
+		data_offs += sizeof(struct sfe_ipv4_ip_hdr);
+		if (unlikely(len < data_offs)) {
+			spin_unlock_bh(&c->lock);
+			sfe_ipv4_exception_flush_sfe_ipv4_connection(si, c, SFE_IPV4_EXCEPTION_EVENT_TCP_BIG_DATA_OFFS);
+			rcu_read_unlock();
+
+			DEBUG_TRACE("TCP data offset: %u, past end of packet: %u\n",
+				    data_offs, len);
+			return 0;
+		}
+
+		end = seq + len - data_offs;
+
+		/*
+		 * A GSO packet stands for a run of segments, and the last of them
+		 * mustn't start past the right hand edge of the window either.
+		 */
+		if (unlikely(skb_is_gso(skb) && (end != seq))) {
+			u32 gso_size = skb_shinfo(skb)->gso_size;
+			u32 last_seq = seq + ((end - seq - 1) / gso_size) * gso_size;
+
+			if (unlikely((s32)(last_seq - (cm->protocol_state.tcp.max_end + 1)) > 0)) {
+				spin_unlock_bh(&c->lock);
+				sfe_ipv4_exception_flush_sfe_ipv4_connection(si, c, SFE_IPV4_EXCEPTION_EVENT_TCP_SEQ_EXCEEDS_RIGHT_EDGE);
+				rcu_read_unlock();
+
+				DEBUG_TRACE("last segment seq: %u exceeds right edge: %u\n",
+					    last_seq, cm->protocol_state.tcp.max_end + 1);
+				return 0;
+			}
+		}
+
+		/*
+		 * Is our sequence fully before the left hand edge of the window?
+		 */
+		if (unlikely((s32)(end - (cm->protocol_state.tcp.end
+						- counter_cm->protocol_state.tcp.max_win - 1)) < 0)) {
+			spin_unlock_bh(&c->lock);
+			sfe_ipv4_exception_flush_sfe_ipv4_connection(si, c, SFE_IPV4_EXCEPTION_EVENT_TCP_SEQ_BEFORE_LEFT_EDGE);
+			rcu_read_unlock();
+
+			DEBUG_TRACE("seq: %u before left edge: %u\n",
+				    end, cm->protocol_state.tcp.end - counter_cm->protocol_state.tcp.max_win - 1);
+			return 0;
+		}
+
+		/*
+		 * Are we acking data that is to the right of what has been sent?
+		 */
+		if (unlikely((s32)(sack - (counter_cm->protocol_state.tcp.end + 1)) > 0)) {
+			spin_unlock_bh(&c->lock);
+			sfe_ipv4_exception_flush_sfe_ipv4_connection(si, c, SFE_IPV4_EXCEPTION_EVENT_TCP_ACK_EXCEEDS_RIGHT_EDGE);
+			rcu_read_unlock();
+
+			DEBUG_TRACE("ack: %u exceeds right edge: %u\n",
+				    sack, counter_cm->protocol_state.tcp.end + 1);
+			return 0;
+		}
+
+		/*
+		 * Is our ack too far before the left hand edge of the window?
+		 */
+		left_edge = counter_cm->protocol_state.tcp.end
+			    - cm->protocol_state.tcp.max_win
+			    - SFE_IPV4_TCP_MAX_ACK_WINDOW
+			    - 1;
+		if (unlikely((s32)(sack - left_edge) < 0)) {
+			spin_unlock_bh(&c->lock);
+			sfe_ipv4_exception_flush_sfe_ipv4_connection(si, c, SFE_IPV4_EXCEPTION_EVENT_TCP_ACK_BEFORE_LEFT_EDGE);
+			rcu_read_unlock();
+
+			DEBUG_TRACE("ack: %u before left edge: %u\n", sack, left_edge);
+			return 0;
+		}
+
+		/*
+		 * Have we just seen the largest window size yet for this connection?  If yes
+		 * then we need to record the new value.
+		 */
+		scaled_win = ntohs(tcph->window) << cm->protocol_state.tcp.win_scale;
+		scaled_win += (sack - ack);
+		if (unlikely(cm->protocol_state.tcp.max_win < scaled_win)) {
+			cm->protocol_state.tcp.max_win = scaled_win;
+		}
+
+		/*
+		 * If our sequence and/or ack numbers have advanced then record the new state.
+		 */
+		if (likely((s32)(end - cm->protocol_state.tcp.end) >= 0)) {
+			cm->protocol_state.tcp.end = end;
+		}
+
+		max_end = sack + scaled_win;
+		if (likely((s32)(max_end - counter_cm->protocol_state.tcp.max_end) >= 0)) {
+			counter_cm->protocol_state.tcp.max_end = max_end;
+		}
+
+		spin_unlock_bh(&c->lock);
+	}
+
+	/*
+	 * From this point on we're good to modify the packet.
+	 */
+
+	/*
+	 * Check if skb was cloned. If it was, unshare it. Because
+	 * the data area is going to be written in this path and we don't want to
+	 * change the cloned skb's data section.
+	 */
+	if (unlikely(skb_cloned(skb))) {
+		DEBUG_TRACE("%p: skb is a cloned skb\n", skb);
+		skb = skb_unshare(skb, GFP_ATOMIC);
+                if (!skb) {
+			DEBUG_WARN("Failed to unshare the cloned skb\n");
+			rcu_read_unlock();
+			sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_CLONED_SKB_UNSHARE_ERROR);
+
+			/*
+			 * skb_unshare() has freed the original packet so as far as our
+			 * caller is concerned it has been consumed.
+			 */
+			return 1;
+		}
+
+		/*
+		 * Update the iph and tcph pointers with the unshared skb's data area.
+		 */
+		iph = (struct sfe_ipv4_ip_hdr *)skb->data;
+		tcph = (struct sfe_ipv4_tcp_hdr *)(skb->data + ihl);
+	}
+
+	/*
+	 * Update DSCP
+	 */
+	ip_csum_adj = cm->ip_csum_adjustment;
+	if (unlikely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_DSCP_REMARK)) {
+		ip_csum_adj += sfe_ipv4_remark_dscp(iph, cm->dscp);
+	}
+
+	/*
+	 * Remark a packet that exceeded the policer's rate, after any DSCP remark
+	 * so that the policer's remark wins.
+	 */
+	if (unlikely(police_remark)) {
+		ip_csum_adj += sfe_ipv4_remark_dscp(iph, cm->police->dscp << SFE_IPV4_DSCP_SHIFT);
+	}
+
+	/*
+	 * Decrement our TTL, unless we're bridging.
+	 */
+	if (likely(!(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_BRIDGE_FLOW))) {
+		iph->ttl = ttl - 1;
+	}
+
+	/*
+	 * Do we have to perform translations of the source address/port?
+	 */
+	if (unlikely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_XLATE_SRC)) {
+		u16 tcp_csum;
+		u32 sum;
+
+		iph->saddr = cm->xlate_src_ip;
+		tcph->source = cm->xlate_src_port;
+
+		/*
+		 * Do we have a non-zero UDP checksum?  If we do then we need
+		 * to update it.
+		 */
+		tcp_csum = tcph->check;
+		if (unlikely(skb->ip_summed == CHECKSUM_PARTIAL)) {
+			sum = tcp_csum + cm->xlate_src_partial_csum_adjustment;
+		} else {
+			sum = tcp_csum + cm->xlate_src_csum_adjustment;
+		}
+
+		sum = (sum & 0xffff) + (sum >> 16);
+		tcph->check = (u16)sum;
+	}
+
+	/*
+	 * Do we have to perform translations of the destination address/port?
+	 */
+	if (unlikely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_XLATE_DEST)) {
+		u16 tcp_csum;
+		u32 sum;
+
+		iph->daddr = cm->xlate_dest_ip;
+		tcph->dest = cm->xlate_dest_port;
+
+		/*
+		 * Do we have a non-zero UDP checksum?  If we do then we need
+		 * to update it.
+		 */
+		tcp_csum = tcph->check;
+		if (unlikely(skb->ip_summed == CHECKSUM_PARTIAL)) {
+			sum = tcp_csum + cm->xlate_dest_partial_csum_adjustment;
+		} else {
+			sum = tcp_csum + cm->xlate_dest_csum_adjustment;
+		}
+
+		sum = (sum & 0xffff) + (sum >> 16);
+		tcph->check = (u16)sum;
+	}
+
+	/*
+	 * Update the IP checksum for the changes we've made to the header.  We
+	 * don't rewrite it from scratch so that any corruption isn't hidden.
+	 */
+	sfe_ipv4_update_ip_csum(iph, ip_csum_adj);
+
+	/*
+	 * Any checksum the driver computed over the packet no longer matches it.
+	 */
+	if (unlikely(skb->ip_summed == CHECKSUM_COMPLETE)) {
+		skb->ip_summed = CHECKSUM_NONE;
+	}
+
+	/*
+	 * Update traffic stats and make sure we'll get synced.
+	 */
+	sfe_ipv4_connection_match_update_rx_stats(si, cm, skb, len);
+	sfe_ipv4_connection_match_activate(si, cm);
+
+	xmit_dev = cm->xmit_dev;
+	skb->dev = xmit_dev;
+
+	/*
+	 * Any VLAN tag the driver stripped for us has been dealt with.
+	 */
+	__vlan_hwaccel_clear_tag(skb);
+
+	/*
+	 * The PPPoE or tunnel headers were stripped before we looked at the packet.
+	 */
+	if (unlikely(cm->flags & (SFE_IPV4_CONNECTION_MATCH_FLAG_PPPOE_DECAP | SFE_IPV4_CONNECTION_MATCH_FLAG_TUN_DECAP))) {
+		skb->protocol = htons(ETH_P_IP);
+		skb_reset_network_header(skb);
+	}
+
+	/*
+	 * Add the tunnel headers, which go inside any L2 headers.
+	 */
+	if (unlikely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_TUN_ENCAP)) {
+		sfe_tun_add_header(skb, &cm->xmit_tun, iph->tos, iph->ttl);
+	}
+
+	/*
+	 * Check to see if we need to write a header.
+	 */
+	if (likely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_WRITE_L2_HDR)) {
+		if (unlikely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_PPPOE_ENCAP)) {
+			sfe_pppoe_add_header(skb, cm->xmit_pppoe_session_id, PPP_IP, ntohs(iph->tot_len));
+		}
+
+		if (unlikely(cm->xmit_vlan_count)) {
+			sfe_vlan_add_tags(skb, cm->xmit_vlan_count, cm->xmit_vlan_tag);
+		}
+
+		if (unlikely(!(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_WRITE_FAST_ETH_HDR))) {
+			dev_hard_header(skb, xmit_dev, ntohs(skb->protocol),
+					cm->xmit_dest_mac, cm->xmit_src_mac, len);
+		} else {
+			/*
+			 * For the simple case we write this really fast.
+			 */
+			struct sfe_ipv4_eth_hdr *eth = (struct sfe_ipv4_eth_hdr *)__skb_push(skb, ETH_HLEN);
+			eth->h_proto = skb->protocol;
+			eth->h_dest[0] = cm->xmit_dest_mac[0];
+			eth->h_dest[1] = cm->xmit_dest_mac[1];
+			eth->h_dest[2] = cm->xmit_dest_mac[2];
+			eth->h_source[0] = cm->xmit_src_mac[0];
+			eth->h_source[1] = cm->xmit_src_mac[1];
+			eth->h_source[2] = cm->xmit_src_mac[2];
+		}
+	}
+
+	/*
+	 * Update priority of skb.
+	 */
+	if (unlikely(cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_PRIORITY_REMARK)) {
+		skb->priority = cm->priority;
+	}
+
+	/*
+	 * Mark outgoing packet
+	 */
+	skb->mark = c->mark;
+	if (skb->mark) {
+		DEBUG_TRACE("SKB MARK is NON ZERO %x\n", skb->mark);
+	}
+
+	rcu_read_unlock();
+
+	/*
+	 * We're going to check for GSO flags when we transmit the packet so
+	 * start fetching the necessary cache line now.
+	 */
+	prefetch(skb_shinfo(skb));
+
+	/*
+	 * Mark that this packet has been fast forwarded.
+	 */
+	skb->fast_forwarded = 1;
+
+	/*
+	 * Send the packet on its way.  If it's part of a batch then hold on to it
+	 * until the rest of the batch has been handled.
+	 */
+	if (batch) {
+		__skb_queue_tail(&batch->xmit_queue, skb);
+	} else {
+		dev_queue_xmit(skb);
+	}
+
+	return 1;
+}
+
+/*
+ * sfe_ipv4_recv_icmp()
+ *	Handle ICMP packet receives.
+ *
+ * ICMP packets aren't handled as a "fast path" and always have us process them
+ * through the default Linux stack.  What we do need to do is look for any errors
+ * about connections we are handling in the fast path.  If we find any such
+ * connections then we want to flush their state so that the ICMP error path
+ * within Linux has all of the correct state should it need it.
+ */
+static int sfe_ipv4_recv_icmp(struct sfe_ipv4 *si, struct sk_buff *skb, struct net_device *dev,
+			      unsigned int len, struct sfe_ipv4_ip_hdr *iph, unsigned int ihl)
+{
+	struct icmphdr *icmph;
+	struct sfe_ipv4_ip_hdr *icmp_iph;
+	unsigned int icmp_ihl_words;
+	unsigned int icmp_ihl;
+	u32 *icmp_trans_h;
+	struct sfe_ipv4_udp_hdr *icmp_udph;
+	struct sfe_ipv4_tcp_hdr *icmp_tcph;
+	__be32 src_ip;
+	__be32 dest_ip;
+	__be16 src_port;
+	__be16 dest_port;
+	struct sfe_ipv4_connection_match *cm;
+	struct sfe_ipv4_connection *c;
+	u32 pull_len = sizeof(struct icmphdr) + ihl;
+
+	/*
+	 * Is our packet too short to contain a valid ICMP header?
+	 */
+	len -= ihl;
+	if (!pskb_may_pull(skb, pull_len)) {
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_ICMP_HEADER_INCOMPLETE);
+
+		DEBUG_TRACE("packet too short for ICMP header\n");
+		return 0;
+	}
+
+	/*
+	 * We only handle "destination unreachable" and "time exceeded" messages.
+	 */
+	icmph = (struct icmphdr *)(skb->data + ihl);
+	if ((icmph->type != ICMP_DEST_UNREACH)
+	    && (icmph->type != ICMP_TIME_EXCEEDED)) {
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_ICMP_UNHANDLED_TYPE);
+
+		DEBUG_TRACE("unhandled ICMP type: 0x%x\n", icmph->type);
+		return 0;
+	}
+
+	/*
+	 * Do we have the full embedded IP header?
+	 */
+	len -= sizeof(struct icmphdr);
+	pull_len += sizeof(struct sfe_ipv4_ip_hdr);
+	if (!pskb_may_pull(skb, pull_len)) {
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_ICMP_IPV4_HEADER_INCOMPLETE);
+
+		DEBUG_TRACE("Embedded IP header not complete\n");
+		return 0;
+	}
+
+	/*
+	 * Is our embedded IP version wrong?
+	 */
+	icmp_iph = (struct sfe_ipv4_ip_hdr *)(icmph + 1);
+	if (unlikely(icmp_iph->version != 4)) {
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_ICMP_IPV4_NON_V4);
+
+		DEBUG_TRACE("IP version: %u\n", icmp_iph->version);
+		return 0;
+	}
+
+	/*
+	 * Do we have the full embedded IP header, including any options?
+	 */
+	icmp_ihl_words = icmp_iph->ihl;
+	icmp_ihl = icmp_ihl_words << 2;
+	pull_len += icmp_ihl - sizeof(struct sfe_ipv4_ip_hdr);
+	if (!pskb_may_pull(skb, pull_len)) {
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_ICMP_IPV4_IP_OPTIONS_INCOMPLETE);
+
+		DEBUG_TRACE("Embedded header not large enough for IP options\n");
+		return 0;
+	}
+
+	len -= icmp_ihl;
+	icmp_trans_h = ((u32 *)icmp_iph) + icmp_ihl_words;
+
+	/*
+	 * Handle the embedded transport layer header.
+	 */
+	switch (icmp_iph->protocol) {
+	case IPPROTO_UDP:
+		/*
+		 * We should have 8 bytes of UDP header - that's enough to identify
+		 * the connection.
+		 */
+		pull_len += 8;
+		if (!pskb_may_pull(skb, pull_len)) {
+			sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_ICMP_IPV4_UDP_HEADER_INCOMPLETE);
+
+			DEBUG_TRACE("Incomplete embedded UDP header\n");
+			return 0;
+		}
+
+		icmp_udph = (struct sfe_ipv4_udp_hdr *)icmp_trans_h;
+		src_port = icmp_udph->source;
+		dest_port = icmp_udph->dest;
+		break;
+
+	case IPPROTO_TCP:
+		/*
+		 * We should have 8 bytes of TCP header - that's enough to identify
+		 * the connection.
+		 */
+		pull_len += 8;
+		if (!pskb_may_pull(skb, pull_len)) {
+			sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_ICMP_IPV4_TCP_HEADER_INCOMPLETE);
+
+			DEBUG_TRACE("Incomplete embedded TCP header\n");
+			return 0;
+		}
+
+		icmp_tcph = (struct sfe_ipv4_tcp_hdr *)icmp_trans_h;
+		src_port = icmp_tcph->source;
+		dest_port = icmp_tcph->dest;
+		break;
+
+	default:
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_ICMP_IPV4_UNHANDLED_PROTOCOL);
+
+		DEBUG_TRACE("Unhandled embedded IP protocol: %u\n", icmp_iph->protocol);
+		return 0;
+	}
+
+	src_ip = icmp_iph->saddr;
+	dest_ip = icmp_iph->daddr;
+
+	rcu_read_lock();
+
+	/*
+	 * Look for a connection match.  Note that we reverse the source and destination
+	 * here because our embedded message contains a packet that was sent in the
+	 * opposite direction to the one in which we just received it.  It will have
+	 * been sent on the interface from which we received it though so that's still
+	 * ok to use.
+	 */
+	cm = sfe_ipv4_find_sfe_ipv4_connection_match(si, dev, icmp_iph->protocol, dest_ip, dest_port, src_ip, src_port);
+	if (unlikely(!cm)) {
+		rcu_read_unlock();
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_ICMP_NO_CONNECTION);
+
+		DEBUG_TRACE("no connection found\n");
+		return 0;
+	}
+
+	/*
+	 * We found a connection so now remove it from the connection list and flush
+	 * its state.
+	 */
+	c = cm->connection;
+	sfe_ipv4_exception_flush_sfe_ipv4_connection(si, c, SFE_IPV4_EXCEPTION_EVENT_ICMP_FLUSHED_CONNECTION);
+	rcu_read_unlock();
+	return 0;
+}
+
+/*
+ * sfe_ipv4_recv_ip()
+ *	Handle IPv4 datagram receives and forwarding.
+ *
+ * vi holds the VLAN tags and ti the tunnel headers the packet was received
+ * with.  If the packet is part of a batch then batch is non-NULL.
+ *
+ * Returns 1 if the packet is forwarded or 0 if it isn't.
+ */
+static int sfe_ipv4_recv_ip(struct sfe_ipv4 *si, struct net_device *dev, struct sk_buff *skb,
+			    const struct sfe_vlan_info *vi, const struct sfe_tun_info *ti,
+			    struct sfe_ipv4_recv_batch *batch)
+{
+	unsigned int len;
+	unsigned int tot_len;
+	unsigned int frag_off;
+	unsigned int ihl;
+	bool flush_on_find;
+	bool ip_options;
+	struct sfe_ipv4_ip_hdr *iph;
+	u32 protocol;
+
+	/*
+	 * Check that we have space for an IP header here.
+	 */
+	len = skb->len;
+	if (unlikely(!pskb_may_pull(skb, sizeof(struct sfe_ipv4_ip_hdr)))) {
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_HEADER_INCOMPLETE);
+
+		DEBUG_TRACE("len: %u is too short\n", len);
+		return 0;
+	}
+
+	/*
+	 * Check that our "total length" is large enough for an IP header.
+	 */
+	iph = (struct sfe_ipv4_ip_hdr *)skb->data;
+	tot_len = ntohs(iph->tot_len);
+	if (unlikely(tot_len < sizeof(struct sfe_ipv4_ip_hdr))) {
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_BAD_TOTAL_LENGTH);
+
+		DEBUG_TRACE("tot_len: %u is too short\n", tot_len);
+		return 0;
+	}
+
+	/*
+	 * Is our IP version wrong?
+	 */
+	if (unlikely(iph->version != 4)) {
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_NON_V4);
+
+		DEBUG_TRACE("IP version: %u\n", iph->version);
+		return 0;
+	}
+
+	/*
+	 * Does our datagram fit inside the skb?
+	 */
+	if (unlikely(tot_len > len)) {
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_DATAGRAM_INCOMPLETE);
+
+		DEBUG_TRACE("tot_len: %u, exceeds len: %u\n", tot_len, len);
+		return 0;
+	}
+
+	/*
+	 * Do we have a non-initial fragment?  We can forward those of UDP
+	 * datagrams whose first fragment we forwarded.
+	 */
+	frag_off = ntohs(iph->frag_off);
+	if (unlikely(frag_off & IP_OFFSET)) {
+		if ((IPPROTO_UDP == iph->protocol) && (iph->ihl == 5)) {
+			return sfe_ipv4_recv_udp_fragment(si, skb, dev, len, iph, vi, ti, batch);
+		}
+
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_NON_INITIAL_FRAGMENT);
+
+		DEBUG_TRACE("non-initial fragment\n");
+		return 0;
+	}
+
+	/*
+	 * If we have a (first) fragment then mark it to cause any connection to
+	 * flush, unless it's UDP, whose fragments we track.
+	 */
+	flush_on_find = unlikely((frag_off & IP_MF) && (IPPROTO_UDP != iph->protocol)) ? true : false;
+
+	/*
+	 * Do we have any IP options?  That's definite a slow path!  If we do have IP
+	 * options we need to recheck our header size.
+	 */
+	ihl = iph->ihl << 2;
+	ip_options = unlikely(ihl != sizeof(struct sfe_ipv4_ip_hdr)) ? true : false;
+	if (unlikely(ip_options)) {
+		if (unlikely(len < ihl)) {
+			sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_IP_OPTIONS_INCOMPLETE);
+
+			DEBUG_TRACE("len: %u is too short for header of size: %u\n", len, ihl);
+			return 0;
+		}
+
+		flush_on_find = true;
+	}
+
+	protocol = iph->protocol;
+	if (IPPROTO_UDP == protocol) {
+		return sfe_ipv4_recv_udp(si, skb, dev, len, iph, ihl, flush_on_find, vi, ti, batch);
+	}
+
+	if (IPPROTO_TCP == protocol) {
+		return sfe_ipv4_recv_tcp(si, skb, dev, len, iph, ihl, flush_on_find, vi, ti, batch);
+	}
+
+	if (IPPROTO_ICMP == protocol) {
+		return sfe_ipv4_recv_icmp(si, skb, dev, len, iph, ihl);
+	}
+
+	sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_UNHANDLED_PROTOCOL);
+
+	DEBUG_TRACE("not UDP, TCP or ICMP: %u\n", protocol);
+	return 0;
+}
+
+/*
+ * sfe_ipv4_recv_skb()
+ *	Handle packet receives and forwaring.
+ *
+ * VLAN tagged frames and PPPoE session frames arrive with their inner VLAN and
+ * PPPoE headers in place, and tunnelled packets with their outer IPv6 or GRE
+ * headers.  We strip them while we look at the datagram and put them back if
+ * we don't forward the packet, so the Linux stack sees the packet unchanged.
+ *
+ * If the packet is part of a batch then batch is non-NULL.
+ *
+ * Returns 1 if the packet is forwarded or 0 if it isn't.
+ */
+static int sfe_ipv4_recv_skb(struct sfe_ipv4 *si, struct net_device *dev, struct sk_buff *skb,
+			     struct sfe_ipv4_recv_batch *batch)
+{
+	struct sfe_vlan_info vi;
+	struct sfe_tun_info ti;
+	int ret;
+
+	if (unlikely(!sfe_vlan_parse(skb, &vi))) {
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_VLAN_HEADER_INVALID);
+
+		DEBUG_TRACE("too many or truncated VLAN headers\n");
+		return 0;
+	}
+
+	ti.type = SFE_TUN_TYPE_NONE;
+	if (likely(skb->protocol != htons(ETH_P_PPP_SES))) {
+		if (unlikely(!sfe_tun_decap(skb, htons(ETH_P_IP), &ti))) {
+			sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_TUN_HEADER_INVALID);
+
+			DEBUG_TRACE("not a tunnel carrying IPv4\n");
+			ret = 0;
+		} else {
+			ret = sfe_ipv4_recv_ip(si, dev, skb, &vi, &ti, batch);
+			if (!ret) {
+				sfe_tun_restore(skb, &ti);
+			}
+		}
+	} else if (unlikely(sfe_pppoe_session_proto(skb) != htons(PPP_IP))) {
+		sfe_ipv4_exception_stats_inc(si, SFE_IPV4_EXCEPTION_EVENT_PPPOE_HEADER_INVALID);
+
+		DEBUG_TRACE("not a PPPoE session carrying IPv4\n");
+		ret = 0;
+	} else {
+		skb_reset_network_header(skb);
+		__skb_pull(skb, PPPOE_SES_HLEN);
+
+		ret = sfe_ipv4_recv_ip(si, dev, skb, &vi, &ti, batch);
+		if (!ret) {
+			__skb_push(skb, PPPOE_SES_HLEN);
+		}
+	}
+
+	if (!ret) {
+		sfe_vlan_restore(skb, &vi);
+	}
+
+	return ret;
+}
+
+/*
+ * sfe_ipv4_recv()
+ *	Handle packet receives and forwaring.
+ *
+ * Connection lookups run under RCU without the module lock.  Shared locks are
+ * still taken in three places: the module lock for the first packet of a
+ * connection match after each sync and when a packet has its connection
+ * flushed, and the connection lock for TCP window tracking.
+ *
+ * Returns 1 if the packet is forwarded or 0 if it isn't.
+ */
+int sfe_ipv4_recv(struct net_device *dev, struct sk_buff *skb)
+{
+	return sfe_ipv4_recv_skb(&__si, dev, skb, NULL);
+}
+
+/*
+ * sfe_ipv4_recv_list()
+ *	Handle a batch of packet receives and forwarding.
+ *
+ * Packets that are forwarded are removed from the list.  Those that aren't are
+ * left on it, in their original order, for our caller to pass up the stack.
+ */
+void sfe_ipv4_recv_list(struct list_head *head)
+{
+	struct sfe_ipv4 *si = &__si;
+	struct sfe_ipv4_recv_batch batch;
+	struct sk_buff *skb;
+	struct sk_buff *tmp;
+	LIST_HEAD(not_forwarded);
+
+	batch.last_cm = NULL;
+	__skb_queue_head_init(&batch.xmit_queue);
+
+	/*
+	 * The connection match remembered from one packet to the next must remain
+	 * valid for the whole batch so hold the RCU read lock across all of it.
+	 */
+	rcu_read_lock();
+	list_for_each_entry_safe(skb, tmp, head, list) {
+		skb_list_del_init(skb);
+		if (!sfe_ipv4_recv_skb(si, skb->dev, skb, &batch)) {
+			list_add_tail(&skb->list, &not_forwarded);
+		}
+	}
+	rcu_read_unlock();
+
+	/*
+	 * Transmit everything we forwarded back to back.
+	 */
+	while ((skb = __skb_dequeue(&batch.xmit_queue))) {
+		dev_queue_xmit(skb);
+	}
+
+	list_splice(&not_forwarded, head);
+}
+
+static void
+sfe_ipv4_update_tcp_state(struct sfe_ipv4_connection *c,
+			  struct sfe_connection_create *sic)
+{
+	struct sfe_ipv4_connection_match *orig_cm;
+	struct sfe_ipv4_connection_match *repl_cm;
+	struct sfe_ipv4_tcp_connection_match *orig_tcp;
+	struct sfe_ipv4_tcp_connection_match *repl_tcp;
+	u32 orig_flags;
+	u32 repl_flags;
+
+	orig_cm = c->original_match;
+	repl_cm = c->reply_match;
+	orig_tcp = &orig_cm->protocol_state.tcp;
+	repl_tcp = &repl_cm->protocol_state.tcp;
+
+	spin_lock(&c->lock);
+
+	/* update orig */
+	if (orig_tcp->max_win < sic->src_td_max_window) {
+		orig_tcp->max_win = sic->src_td_max_window;
+	}
+	if ((s32)(orig_tcp->end - sic->src_td_end) < 0) {
+		orig_tcp->end = sic->src_td_end;
+	}
+	if ((s32)(orig_tcp->max_end - sic->src_td_max_end) < 0) {
+		orig_tcp->max_end = sic->src_td_max_end;
 	}
 
 	/* update reply */
 	if (repl_tcp->max_win < sic->dest_td_max_window) {
 		repl_tcp->max_win = sic->dest_td_max_window;
 	}
-	if ((s32)(repl_tcp->end - sic->dest_td_end) < 0) {
-		repl_tcp->end = sic->dest_td_end;
+	if ((s32)(repl_tcp->end - sic->dest_td_end) < 0) {
+		repl_tcp->end = sic->dest_td_end;
+	}
+	if ((s32)(repl_tcp->max_end - sic->dest_td_max_end) < 0) {
+		repl_tcp->max_end = sic->dest_td_max_end;
+	}
+
+	spin_unlock(&c->lock);
+
+	/*
+	 * Update match flags.  The fast path reads them without a lock, so each
+	 * is written once with its final value, never cleared and set again.
+	 */
+	orig_flags = orig_cm->flags & ~SFE_IPV4_CONNECTION_MATCH_FLAG_NO_SEQ_CHECK;
+	repl_flags = repl_cm->flags & ~SFE_IPV4_CONNECTION_MATCH_FLAG_NO_SEQ_CHECK;
+	if (sic->flags & SFE_CREATE_FLAG_NO_SEQ_CHECK) {
+		orig_flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_NO_SEQ_CHECK;
+		repl_flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_NO_SEQ_CHECK;
+	}
+
+	WRITE_ONCE(orig_cm->flags, orig_flags);
+	WRITE_ONCE(repl_cm->flags, repl_flags);
+}
+
+static void
+sfe_ipv4_update_protocol_state(struct sfe_ipv4_connection *c,
+			       struct sfe_connection_create *sic)
+{
+	switch (sic->protocol) {
+	case IPPROTO_TCP:
+		sfe_ipv4_update_tcp_state(c, sic);
+		break;
+	}
+}
+
+void sfe_ipv4_update_rule(struct sfe_connection_create *sic)
+{
+	struct sfe_ipv4_connection *c;
+	struct sfe_ipv4 *si = &__si;
+
+	spin_lock_bh(&si->lock);
+
+	c = sfe_ipv4_find_sfe_ipv4_connection(si,
+					      sic->protocol,
+					      sic->src_ip.ip,
+					      sic->src_port,
+					      sic->dest_ip.ip,
+					      sic->dest_port);
+	if (c != NULL) {
+		sfe_ipv4_update_protocol_state(c, sic);
+	}
+
+	spin_unlock_bh(&si->lock);
+}
+
+/*
+ * sfe_ipv4_create_rule()
+ *	Create a forwarding rule.
+ */
+int sfe_ipv4_create_rule(struct sfe_connection_create *sic)
+{
+	struct sfe_ipv4 *si = &__si;
+	struct sfe_ipv4_connection *c;
+	struct sfe_ipv4_connection_match *original_cm;
+	struct sfe_ipv4_connection_match *reply_cm;
+	struct net_device *dest_dev;
+	struct net_device *src_dev;
+
+	dest_dev = sic->dest_dev;
+	src_dev = sic->src_dev;
+
+	if (unlikely((dest_dev->reg_state != NETREG_REGISTERED) ||
+		     (src_dev->reg_state != NETREG_REGISTERED))) {
+		return -EINVAL;
+	}
+
+	/*
+	 * We can't handle more VLAN tags than we have room for.
+	 */
+	if (unlikely((sic->src_vlan_count > SFE_MAX_VLAN_DEPTH) || (sic->dest_vlan_count > SFE_MAX_VLAN_DEPTH))) {
+		return -EINVAL;
+	}
+
+	/*
+	 * PPPoE sessions and VLAN tags must be carried by devices we write L2
+	 * headers for.
+	 */
+	if (unlikely((((sic->flags & SFE_CREATE_FLAG_SRC_PPPOE) || sic->src_vlan_count) &&
+		      (src_dev->flags & IFF_POINTOPOINT)) ||
+		     (((sic->flags & SFE_CREATE_FLAG_DEST_PPPOE) || sic->dest_vlan_count) &&
+		      (dest_dev->flags & IFF_POINTOPOINT)))) {
+		return -EINVAL;
+	}
+
+	/*
+	 * Tunnels must carry IPv4 and be carried by devices we write L2 headers
+	 * for, without a PPPoE session in between.
+	 */
+	if (unlikely((sic->flags & SFE_CREATE_FLAG_SRC_TUN) &&
+		     (!sfe_tun_valid(&sic->src_tun, htons(ETH_P_IP)) ||
+		      (sic->flags & (SFE_CREATE_FLAG_SRC_PPPOE | SFE_CREATE_FLAG_BRIDGE_FLOW)) ||
+		      (src_dev->flags & IFF_POINTOPOINT)))) {
+		return -EINVAL;
+	}
+
+	if (unlikely((sic->flags & SFE_CREATE_FLAG_DEST_TUN) &&
+		     (!sfe_tun_valid(&sic->dest_tun, htons(ETH_P_IP)) ||
+		      (sic->flags & (SFE_CREATE_FLAG_DEST_PPPOE | SFE_CREATE_FLAG_BRIDGE_FLOW)) ||
+		      (dest_dev->flags & IFF_POINTOPOINT)))) {
+		return -EINVAL;
+	}
+
+	if (unlikely(!sfe_police_cfg_valid(&sic->src_police) || !sfe_police_cfg_valid(&sic->dest_police))) {
+		return -EINVAL;
+	}
+
+	/*
+	 * Bridged connections don't translate anything and must be between
+	 * devices we write L2 headers for.
+	 */
+	if (unlikely((sic->flags & SFE_CREATE_FLAG_BRIDGE_FLOW) &&
+		     ((sic->src_ip.ip != sic->src_ip_xlate.ip) || (sic->src_port != sic->src_port_xlate) ||
+		      (sic->dest_ip.ip != sic->dest_ip_xlate.ip) || (sic->dest_port != sic->dest_port_xlate) ||
+		      (src_dev->flags & IFF_POINTOPOINT) || (dest_dev->flags & IFF_POINTOPOINT)))) {
+		return -EINVAL;
+	}
+
+	spin_lock_bh(&si->lock);
+	sfe_ipv4_stats_inc(si, connection_create_requests);
+
+	/*
+	 * Check to see if there is already a flow that matches the rule we're
+	 * trying to create.  If there is then we can't create a new one.
+	 */
+	c = sfe_ipv4_find_sfe_ipv4_connection(si,
+					      sic->protocol,
+					      sic->src_ip.ip,
+					      sic->src_port,
+					      sic->dest_ip.ip,
+					      sic->dest_port);
+	if (c != NULL) {
+		sfe_ipv4_stats_inc(si, connection_create_collisions);
+
+		/*
+		 * If we already have the flow then it's likely that this
+		 * request to create the connection rule contains more
+		 * up-to-date information. Check and update accordingly.
+		 */
+		sfe_ipv4_update_protocol_state(c, sic);
+		spin_unlock_bh(&si->lock);
+
+		DEBUG_TRACE("connection already exists - mark: %08x, p: %d\n"
+			    "  s: %s:%pM:%pI4:%u, d: %s:%pM:%pI4:%u\n",
+			    sic->mark, sic->protocol,
+			    sic->src_dev->name, sic->src_mac, &sic->src_ip.ip, ntohs(sic->src_port),
+			    sic->dest_dev->name, sic->dest_mac, &sic->dest_ip.ip, ntohs(sic->dest_port));
+		return -EADDRINUSE;
+	}
+
+	/*
+	 * Allocate the various connection tracking objects.
+	 */
+	c = (struct sfe_ipv4_connection *)kmalloc(sizeof(struct sfe_ipv4_connection), GFP_ATOMIC);
+	if (unlikely(!c)) {
+		spin_unlock_bh(&si->lock);
+		return -ENOMEM;
+	}
+
+	original_cm = (struct sfe_ipv4_connection_match *)kmalloc(sizeof(struct sfe_ipv4_connection_match), GFP_ATOMIC);
+	if (unlikely(!original_cm)) {
+		spin_unlock_bh(&si->lock);
+		kfree(c);
+		return -ENOMEM;
+	}
+
+	reply_cm = (struct sfe_ipv4_connection_match *)kmalloc(sizeof(struct sfe_ipv4_connection_match), GFP_ATOMIC);
+	if (unlikely(!reply_cm)) {
+		spin_unlock_bh(&si->lock);
+		kfree(original_cm);
+		kfree(c);
+		return -ENOMEM;
+	}
+
+	original_cm->stats = alloc_percpu_gfp(struct sfe_ipv4_connection_match_stats, GFP_ATOMIC);
+	if (unlikely(!original_cm->stats)) {
+		spin_unlock_bh(&si->lock);
+		kfree(reply_cm);
+		kfree(original_cm);
+		kfree(c);
+		return -ENOMEM;
+	}
+
+	reply_cm->stats = alloc_percpu_gfp(struct sfe_ipv4_connection_match_stats, GFP_ATOMIC);
+	if (unlikely(!reply_cm->stats)) {
+		spin_unlock_bh(&si->lock);
+		free_percpu(original_cm->stats);
+		kfree(reply_cm);
+		kfree(original_cm);
+		kfree(c);
+		return -ENOMEM;
+	}
+
+	/*
+	 * Only the directions that are policed get a policer.
+	 */
+	original_cm->police = NULL;
+	if (sic->src_police.rate) {
+		original_cm->police = sfe_police_alloc(&sic->src_police);
+	}
+
+	reply_cm->police = NULL;
+	if (sic->dest_police.rate) {
+		reply_cm->police = sfe_police_alloc(&sic->dest_police);
+	}
+
+	if (unlikely((sic->src_police.rate && !original_cm->police) ||
+		     (sic->dest_police.rate && !reply_cm->police))) {
+		spin_unlock_bh(&si->lock);
+		kfree(reply_cm->police);
+		kfree(original_cm->police);
+		free_percpu(reply_cm->stats);
+		free_percpu(original_cm->stats);
+		kfree(reply_cm);
+		kfree(original_cm);
+		kfree(c);
+		return -ENOMEM;
+	}
+
+	/*
+	 * Fill in the "original" direction connection matching object.
+	 * Note that the transmit MAC address is "dest_mac_xlate" because
+	 * we always know both ends of a connection by their translated
+	 * addresses and not their public addresses.
+	 */
+	original_cm->match_dev = src_dev;
+	original_cm->match_protocol = sic->protocol;
+	original_cm->match_src_ip = sic->src_ip.ip;
+	original_cm->match_src_port = sic->src_port;
+	original_cm->match_dest_ip = sic->dest_ip.ip;
+	original_cm->match_dest_port = sic->dest_port;
+	original_cm->xlate_src_ip = sic->src_ip_xlate.ip;
+	original_cm->xlate_src_port = sic->src_port_xlate;
+	original_cm->xlate_dest_ip = sic->dest_ip_xlate.ip;
+	original_cm->xlate_dest_port = sic->dest_port_xlate;
+	original_cm->rx_packet_count64 = 0;
+	original_cm->rx_byte_count64 = 0;
+	original_cm->xmit_dev = dest_dev;
+	original_cm->xmit_dev_mtu = sic->dest_mtu;
+	memcpy(original_cm->xmit_src_mac, dest_dev->dev_addr, ETH_ALEN);
+	memcpy(original_cm->xmit_dest_mac, sic->dest_mac_xlate, ETH_ALEN);
+	original_cm->connection = c;
+	original_cm->counter_match = reply_cm;
+	original_cm->flags = 0;
+	if (sic->flags & SFE_CREATE_FLAG_REMARK_PRIORITY) {
+		original_cm->priority = sic->src_priority;
+		original_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_PRIORITY_REMARK;
+	}
+	if (sic->flags & SFE_CREATE_FLAG_REMARK_DSCP) {
+		original_cm->dscp = sic->src_dscp << SFE_IPV4_DSCP_SHIFT;
+		original_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_DSCP_REMARK;
+	}
+	if (sic->flags & SFE_CREATE_FLAG_BRIDGE_FLOW) {
+		memcpy(original_cm->xmit_src_mac, sic->src_mac, ETH_ALEN);
+		original_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_BRIDGE_FLOW;
+	}
+#ifdef CONFIG_NF_FLOW_COOKIE
+	original_cm->flow_cookie = 0;
+#endif
+#ifdef CONFIG_XFRM
+	original_cm->flow_accel = sic->original_accel;
+#endif
+	original_cm->active_next = NULL;
+	original_cm->active_prev = NULL;
+	original_cm->active = false;
+
+	/*
+	 * For PPP links we don't write an L2 header.  For everything else we do.
+	 */
+	if (!(dest_dev->flags & IFF_POINTOPOINT)) {
+		original_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_WRITE_L2_HDR;
+
+		/*
+		 * If our dev writes Ethernet headers then we can write a really fast
+		 * version.
+		 */
+		if (dest_dev->header_ops) {
+			if (dest_dev->header_ops->create == eth_header) {
+				original_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_WRITE_FAST_ETH_HDR;
+			}
+		}
+	}
+
+	/*
+	 * Strip the PPPoE header of packets received on a PPPoE session and add
+	 * one to packets sent to a PPPoE peer.
+	 */
+	original_cm->match_pppoe_session_id = 0;
+	original_cm->xmit_pppoe_session_id = 0;
+	if (sic->flags & SFE_CREATE_FLAG_SRC_PPPOE) {
+		original_cm->match_pppoe_session_id = htons(sic->src_pppoe_session_id);
+		original_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_PPPOE_DECAP;
 	}
-	if ((s32)(repl_tcp->max_end - sic->dest_td_max_end) < 0) {
-		repl_tcp->max_end = sic->dest_td_max_end;
+	if (sic->flags & SFE_CREATE_FLAG_DEST_PPPOE) {
+		original_cm->xmit_pppoe_session_id = htons(sic->dest_pppoe_session_id);
+		memcpy(original_cm->xmit_dest_mac, sic->dest_pppoe_remote_mac, ETH_ALEN);
+		original_cm->xmit_dev_mtu = min_t(u32, sic->dest_mtu, dest_dev->mtu - PPPOE_SES_HLEN);
+		original_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_PPPOE_ENCAP;
 	}
 
-	/* update match flags */
-	orig_cm->flags &= ~SFE_IPV4_CONNECTION_MATCH_FLAG_NO_SEQ_CHECK;
-	repl_cm->flags &= ~SFE_IPV4_CONNECTION_MATCH_FLAG_NO_SEQ_CHECK;
-	if (sic->flags & SFE_CREATE_FLAG_NO_SEQ_CHECK) {
-		orig_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_NO_SEQ_CHECK;
-		repl_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_NO_SEQ_CHECK;
+	/*
+	 * Strip the outer headers of packets received through a tunnel and add
+	 * them to packets sent into one.
+	 */
+	original_cm->match_tun.type = SFE_TUN_TYPE_NONE;
+	original_cm->xmit_tun.type = SFE_TUN_TYPE_NONE;
+	original_cm->xmit_tun.hlen = 0;
+	if (sic->flags & SFE_CREATE_FLAG_SRC_TUN) {
+		sfe_tun_match_init(&original_cm->match_tun, &sic->src_tun);
+		original_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_TUN_DECAP;
+	}
+	if (sic->flags & SFE_CREATE_FLAG_DEST_TUN) {
+		sfe_tun_xmit_init(&original_cm->xmit_tun, &sic->dest_tun, htons(ETH_P_IP));
+		original_cm->xmit_dev_mtu = min_t(u32, sic->dest_mtu, dest_dev->mtu - original_cm->xmit_tun.hlen);
+		original_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_TUN_ENCAP;
 	}
-}
 
-static void
-sfe_ipv4_update_protocol_state(struct sfe_ipv4_connection *c,
-			       struct sfe_connection_create *sic)
-{
+	/*
+	 * Match the VLAN tags of received packets and add those of the device we
+	 * transmit on.
+	 */
+	original_cm->match_vlan_count = sic->src_vlan_count;
+	memcpy(original_cm->match_vlan_tag, sic->src_vlan_tag, sizeof(original_cm->match_vlan_tag));
+	original_cm->xmit_vlan_count = sic->dest_vlan_count;
+	memcpy(original_cm->xmit_vlan_tag, sic->dest_vlan_tag, sizeof(original_cm->xmit_vlan_tag));
+	RCU_INIT_POINTER(original_cm->mc_xmit, NULL);
+
+	original_cm->xmit_headroom = 0;
+	if (original_cm->xmit_vlan_count ||
+	    (original_cm->flags & (SFE_IPV4_CONNECTION_MATCH_FLAG_PPPOE_ENCAP | SFE_IPV4_CONNECTION_MATCH_FLAG_TUN_ENCAP))) {
+		original_cm->xmit_headroom = dest_dev->hard_header_len + (original_cm->xmit_vlan_count * VLAN_HLEN);
+		if (original_cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_PPPOE_ENCAP) {
+			original_cm->xmit_headroom += PPPOE_SES_HLEN;
+		}
+		original_cm->xmit_headroom += original_cm->xmit_tun.hlen;
+	}
+
+	/*
+	 * Fill in the "reply" direction connection matching object.
+	 */
+	reply_cm->match_dev = dest_dev;
+	reply_cm->match_protocol = sic->protocol;
+	reply_cm->match_src_ip = sic->dest_ip_xlate.ip;
+	reply_cm->match_src_port = sic->dest_port_xlate;
+	reply_cm->match_dest_ip = sic->src_ip_xlate.ip;
+	reply_cm->match_dest_port = sic->src_port_xlate;
+	reply_cm->xlate_src_ip = sic->dest_ip.ip;
+	reply_cm->xlate_src_port = sic->dest_port;
+	reply_cm->xlate_dest_ip = sic->src_ip.ip;
+	reply_cm->xlate_dest_port = sic->src_port;
+	reply_cm->rx_packet_count64 = 0;
+	reply_cm->rx_byte_count64 = 0;
+	reply_cm->xmit_dev = src_dev;
+	reply_cm->xmit_dev_mtu = sic->src_mtu;
+	memcpy(reply_cm->xmit_src_mac, src_dev->dev_addr, ETH_ALEN);
+	memcpy(reply_cm->xmit_dest_mac, sic->src_mac, ETH_ALEN);
+	reply_cm->connection = c;
+	reply_cm->counter_match = original_cm;
+	reply_cm->flags = 0;
+	if (sic->flags & SFE_CREATE_FLAG_REMARK_PRIORITY) {
+		reply_cm->priority = sic->dest_priority;
+		reply_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_PRIORITY_REMARK;
+	}
+	if (sic->flags & SFE_CREATE_FLAG_REMARK_DSCP) {
+		reply_cm->dscp = sic->dest_dscp << SFE_IPV4_DSCP_SHIFT;
+		reply_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_DSCP_REMARK;
+	}
+	if (sic->flags & SFE_CREATE_FLAG_BRIDGE_FLOW) {
+		memcpy(reply_cm->xmit_src_mac, sic->dest_mac_xlate, ETH_ALEN);
+		reply_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_BRIDGE_FLOW;
+	}
+#ifdef CONFIG_NF_FLOW_COOKIE
+	reply_cm->flow_cookie = 0;
+#endif
+#ifdef CONFIG_XFRM
+	reply_cm->flow_accel = sic->reply_accel;
+#endif
+	reply_cm->active_next = NULL;
+	reply_cm->active_prev = NULL;
+	reply_cm->active = false;
+
+	/*
+	 * For PPP links we don't write an L2 header.  For everything else we do.
+	 */
+	if (!(src_dev->flags & IFF_POINTOPOINT)) {
+		reply_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_WRITE_L2_HDR;
+
+		/*
+		 * If our dev writes Ethernet headers then we can write a really fast
+		 * version.
+		 */
+		if (src_dev->header_ops) {
+			if (src_dev->header_ops->create == eth_header) {
+				reply_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_WRITE_FAST_ETH_HDR;
+			}
+		}
+	}
+
+	/*
+	 * Strip the PPPoE header of packets received on a PPPoE session and add
+	 * one to packets sent to a PPPoE peer.
+	 */
+	reply_cm->match_pppoe_session_id = 0;
+	reply_cm->xmit_pppoe_session_id = 0;
+	if (sic->flags & SFE_CREATE_FLAG_DEST_PPPOE) {
+		reply_cm->match_pppoe_session_id = htons(sic->dest_pppoe_session_id);
+		reply_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_PPPOE_DECAP;
+	}
+	if (sic->flags & SFE_CREATE_FLAG_SRC_PPPOE) {
+		reply_cm->xmit_pppoe_session_id = htons(sic->src_pppoe_session_id);
+		memcpy(reply_cm->xmit_dest_mac, sic->src_pppoe_remote_mac, ETH_ALEN);
+		reply_cm->xmit_dev_mtu = min_t(u32, sic->src_mtu, src_dev->mtu - PPPOE_SES_HLEN);
+		reply_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_PPPOE_ENCAP;
+	}
+
+	/*
+	 * Strip the outer headers of packets received through a tunnel and add
+	 * them to packets sent into one.
+	 */
+	reply_cm->match_tun.type = SFE_TUN_TYPE_NONE;
+	reply_cm->xmit_tun.type = SFE_TUN_TYPE_NONE;
+	reply_cm->xmit_tun.hlen = 0;
+	if (sic->flags & SFE_CREATE_FLAG_DEST_TUN) {
+		sfe_tun_match_init(&reply_cm->match_tun, &sic->dest_tun);
+		reply_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_TUN_DECAP;
+	}
+	if (sic->flags & SFE_CREATE_FLAG_SRC_TUN) {
+		sfe_tun_xmit_init(&reply_cm->xmit_tun, &sic->src_tun, htons(ETH_P_IP));
+		reply_cm->xmit_dev_mtu = min_t(u32, sic->src_mtu, src_dev->mtu - reply_cm->xmit_tun.hlen);
+		reply_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_TUN_ENCAP;
+	}
+
+	/*
+	 * Match the VLAN tags of received packets and add those of the device we
+	 * transmit on.
+	 */
+	reply_cm->match_vlan_count = sic->dest_vlan_count;
+	memcpy(reply_cm->match_vlan_tag, sic->dest_vlan_tag, sizeof(reply_cm->match_vlan_tag));
+	reply_cm->xmit_vlan_count = sic->src_vlan_count;
+	memcpy(reply_cm->xmit_vlan_tag, sic->src_vlan_tag, sizeof(reply_cm->xmit_vlan_tag));
+	RCU_INIT_POINTER(reply_cm->mc_xmit, NULL);
+
+	reply_cm->xmit_headroom = 0;
+	if (reply_cm->xmit_vlan_count ||
+	    (reply_cm->flags & (SFE_IPV4_CONNECTION_MATCH_FLAG_PPPOE_ENCAP | SFE_IPV4_CONNECTION_MATCH_FLAG_TUN_ENCAP))) {
+		reply_cm->xmit_headroom = src_dev->hard_header_len + (reply_cm->xmit_vlan_count * VLAN_HLEN);
+		if (reply_cm->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_PPPOE_ENCAP) {
+			reply_cm->xmit_headroom += PPPOE_SES_HLEN;
+		}
+		reply_cm->xmit_headroom += reply_cm->xmit_tun.hlen;
+	}
+
+
+	if (sic->dest_ip.ip != sic->dest_ip_xlate.ip || sic->dest_port != sic->dest_port_xlate) {
+		original_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_XLATE_DEST;
+		reply_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_XLATE_SRC;
+	}
+
+	if (sic->src_ip.ip != sic->src_ip_xlate.ip || sic->src_port != sic->src_port_xlate) {
+		original_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_XLATE_SRC;
+		reply_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_XLATE_DEST;
+	}
+
+	c->protocol = sic->protocol;
+	c->src_ip = sic->src_ip.ip;
+	c->src_ip_xlate = sic->src_ip_xlate.ip;
+	c->src_port = sic->src_port;
+	c->src_port_xlate = sic->src_port_xlate;
+	c->original_dev = src_dev;
+	c->original_match = original_cm;
+	c->dest_ip = sic->dest_ip.ip;
+	c->dest_ip_xlate = sic->dest_ip_xlate.ip;
+	c->dest_port = sic->dest_port;
+	c->dest_port_xlate = sic->dest_port_xlate;
+	c->reply_dev = dest_dev;
+	c->reply_match = reply_cm;
+	c->mark = sic->mark;
+	c->debug_read_seq = 0;
+	c->last_sync_jiffies = get_jiffies_64();
+	c->removed = false;
+	spin_lock_init(&c->lock);
+
+	/*
+	 * Take hold of our source and dest devices for the duration of the connection.
+	 */
+	dev_hold(c->original_dev);
+	dev_hold(c->reply_dev);
+
+	/*
+	 * Initialize the protocol-specific information that we track.
+	 */
 	switch (sic->protocol) {
 	case IPPROTO_TCP:
-		sfe_ipv4_update_tcp_state(c, sic);
+		original_cm->protocol_state.tcp.win_scale = sic->src_td_window_scale;
+		original_cm->protocol_state.tcp.max_win = sic->src_td_max_window ? sic->src_td_max_window : 1;
+		original_cm->protocol_state.tcp.end = sic->src_td_end;
+		original_cm->protocol_state.tcp.max_end = sic->src_td_max_end;
+		reply_cm->protocol_state.tcp.win_scale = sic->dest_td_window_scale;
+		reply_cm->protocol_state.tcp.max_win = sic->dest_td_max_window ? sic->dest_td_max_window : 1;
+		reply_cm->protocol_state.tcp.end = sic->dest_td_end;
+		reply_cm->protocol_state.tcp.max_end = sic->dest_td_max_end;
+		if (sic->flags & SFE_CREATE_FLAG_NO_SEQ_CHECK) {
+			original_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_NO_SEQ_CHECK;
+			reply_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_NO_SEQ_CHECK;
+		}
 		break;
 	}
+
+	sfe_ipv4_connection_match_compute_translations(original_cm);
+	sfe_ipv4_connection_match_compute_translations(reply_cm);
+	sfe_ipv4_insert_sfe_ipv4_connection(si, c);
+
+	spin_unlock_bh(&si->lock);
+
+	/*
+	 * We have everything we need!
+	 */
+	DEBUG_INFO("new connection - mark: %08x, p: %d\n"
+		   "  s: %s:%pM(%pM):%pI4(%pI4):%u(%u)\n"
+		   "  d: %s:%pM(%pM):%pI4(%pI4):%u(%u)\n",
+		   sic->mark, sic->protocol,
+		   sic->src_dev->name, sic->src_mac, sic->src_mac_xlate,
+		   &sic->src_ip.ip, &sic->src_ip_xlate.ip, ntohs(sic->src_port), ntohs(sic->src_port_xlate),
+		   dest_dev->name, sic->dest_mac, sic->dest_mac_xlate,
+		   &sic->dest_ip.ip, &sic->dest_ip_xlate.ip, ntohs(sic->dest_port), ntohs(sic->dest_port_xlate));
+
+	return 0;
 }
 
-void sfe_ipv4_update_rule(struct sfe_connection_create *sic)
+/*
+ * sfe_ipv4_mc_xmit_if_valid()
+ *	Check that we can transmit on a multicast egress interface.
+ */
+static bool sfe_ipv4_mc_xmit_if_valid(struct sfe_mc_xmit_if *smx, struct net_device *src_dev)
 {
-	struct sfe_ipv4_connection *c;
-	struct sfe_ipv4 *si = &__si;
+	struct net_device *dev = smx->dev;
 
-	spin_lock_bh(&si->lock);
+	if (unlikely(dev->reg_state != NETREG_REGISTERED)) {
+		return false;
+	}
 
-	c = sfe_ipv4_find_sfe_ipv4_connection(si,
-					      sic->protocol,
-					      sic->src_ip.ip,
-					      sic->src_port,
-					      sic->dest_ip.ip,
-					      sic->dest_port);
-	if (c != NULL) {
-		sfe_ipv4_update_protocol_state(c, sic);
+	if (unlikely(smx->vlan_count > SFE_MAX_VLAN_DEPTH)) {
+		return false;
+	}
+
+	/*
+	 * PPPoE sessions and VLAN tags must be carried by devices we write L2
+	 * headers for.
+	 */
+	if (unlikely((smx->pppoe_session_id || smx->vlan_count) && (dev->flags & IFF_POINTOPOINT))) {
+		return false;
+	}
+
+	/*
+	 * Bridge ports send packets on with the source MAC address they came
+	 * with so both sides must have one.
+	 */
+	if (unlikely((smx->flags & SFE_MC_XMIT_IF_FLAG_BRIDGE_FLOW) &&
+		     ((dev->flags & IFF_POINTOPOINT) || (src_dev->flags & IFF_POINTOPOINT)))) {
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * sfe_ipv4_mc_xmit_if_init()
+ *	Fill in a multicast egress interface and take hold of its device.
+ */
+static void sfe_ipv4_mc_xmit_if_init(struct sfe_ipv4_mc_xmit_if *xif, struct sfe_mc_xmit_if *smx, u8 *dest_mac)
+{
+	struct net_device *dev = smx->dev;
+
+	xif->xmit_dev = dev;
+	xif->xmit_dev_mtu = smx->mtu;
+	xif->flags = 0;
+	memcpy(xif->xmit_dest_mac, dest_mac, ETH_ALEN);
+	memcpy(xif->xmit_src_mac, smx->src_mac, ETH_ALEN);
+	if (smx->flags & SFE_MC_XMIT_IF_FLAG_BRIDGE_FLOW) {
+		xif->flags |= SFE_IPV4_MC_XMIT_IF_FLAG_BRIDGE_FLOW;
+	}
+
+	/*
+	 * For PPP links we don't write an L2 header.  For everything else we do.
+	 */
+	if (!(dev->flags & IFF_POINTOPOINT)) {
+		xif->flags |= SFE_IPV4_MC_XMIT_IF_FLAG_WRITE_L2_HDR;
+
+		if (dev->header_ops) {
+			if (dev->header_ops->create == eth_header) {
+				xif->flags |= SFE_IPV4_MC_XMIT_IF_FLAG_WRITE_FAST_ETH_HDR;
+			}
+		}
+	}
+
+	xif->xmit_pppoe_session_id = 0;
+	if (smx->pppoe_session_id) {
+		xif->xmit_pppoe_session_id = htons(smx->pppoe_session_id);
+		memcpy(xif->xmit_dest_mac, smx->pppoe_remote_mac, ETH_ALEN);
+		xif->xmit_dev_mtu = min_t(u32, smx->mtu, dev->mtu - PPPOE_SES_HLEN);
+		xif->flags |= SFE_IPV4_MC_XMIT_IF_FLAG_PPPOE_ENCAP;
+	}
+
+	xif->xmit_vlan_count = smx->vlan_count;
+	memcpy(xif->xmit_vlan_tag, smx->vlan_tag, sizeof(xif->xmit_vlan_tag));
+
+	/*
+	 * Every copy of a packet needs room for all of its headers.
+	 */
+	xif->xmit_headroom = 0;
+	if (xif->flags & SFE_IPV4_MC_XMIT_IF_FLAG_WRITE_L2_HDR) {
+		xif->xmit_headroom = dev->hard_header_len + (xif->xmit_vlan_count * VLAN_HLEN);
+		if (xif->flags & SFE_IPV4_MC_XMIT_IF_FLAG_PPPOE_ENCAP) {
+			xif->xmit_headroom += PPPOE_SES_HLEN;
+		}
+	}
+
+	dev_hold(dev);
+}
+
+/*
+ * sfe_ipv4_mc_xmit_if_same()
+ *	Check whether a multicast egress interface is the one described by an update.
+ *
+ * VLAN devices on the same real device are told apart by their tags.
+ */
+static bool sfe_ipv4_mc_xmit_if_same(struct sfe_ipv4_mc_xmit_if *xif, struct sfe_mc_xmit_if *smx)
+{
+	unsigned int i;
+
+	if ((xif->xmit_dev != smx->dev) ||
+	    (xif->xmit_pppoe_session_id != htons(smx->pppoe_session_id)) ||
+	    (xif->xmit_vlan_count != smx->vlan_count)) {
+		return false;
+	}
+
+	for (i = 0; i < xif->xmit_vlan_count; i++) {
+		if ((xif->xmit_vlan_tag[i] ^ smx->vlan_tag[i]) & SFE_VLAN_TAG_MATCH_MASK) {
+			return false;
+		}
 	}
 
-	spin_unlock_bh(&si->lock);
+	return true;
+}
+
+/*
+ * sfe_ipv4_mc_xmit_summarize()
+ *	Work out what the fast path needs to know about a multicast egress interface list as a whole.
+ */
+static void sfe_ipv4_mc_xmit_summarize(struct sfe_ipv4_mc_xmit *mcx)
+{
+	unsigned int i;
+
+	mcx->min_mtu = USHRT_MAX;
+	mcx->routed = false;
+	mcx->bridged = false;
+	for (i = 0; i < mcx->count; i++) {
+		struct sfe_ipv4_mc_xmit_if *xif = &mcx->xif[i];
+
+		mcx->min_mtu = min(mcx->min_mtu, xif->xmit_dev_mtu);
+		if (xif->flags & SFE_IPV4_MC_XMIT_IF_FLAG_BRIDGE_FLOW) {
+			mcx->bridged = true;
+		} else {
+			mcx->routed = true;
+		}
+	}
 }
 
 /*
- * sfe_ipv4_create_rule()
- *	Create a forwarding rule.
+ * sfe_ipv4_create_mc_rule()
+ *	Create a multicast forwarding rule.
+ *
+ * The connection's original direction match is the one packets from the
+ * source to the group hit.  Nothing is ever sent to a multicast source so the
+ * reply direction match is never hit, it's only there so that the connection
+ * is synced, flushed and freed like any other.
  */
-int sfe_ipv4_create_rule(struct sfe_connection_create *sic)
+int sfe_ipv4_create_mc_rule(struct sfe_mc_connection_create *smc)
 {
 	struct sfe_ipv4 *si = &__si;
 	struct sfe_ipv4_connection *c;
 	struct sfe_ipv4_connection_match *original_cm;
 	struct sfe_ipv4_connection_match *reply_cm;
-	struct net_device *dest_dev;
+	struct sfe_ipv4_mc_xmit *mcx;
 	struct net_device *src_dev;
+	unsigned int i;
 
-	dest_dev = sic->dest_dev;
-	src_dev = sic->src_dev;
+	src_dev = smc->src_dev;
 
-	if (unlikely((dest_dev->reg_state != NETREG_REGISTERED) ||
-		     (src_dev->reg_state != NETREG_REGISTERED))) {
+	if (unlikely(src_dev->reg_state != NETREG_REGISTERED)) {
 		return -EINVAL;
 	}
 
+	if (unlikely((smc->protocol != IPPROTO_UDP) || !ipv4_is_multicast(smc->dest_ip.ip))) {
+		return -EINVAL;
+	}
+
+	if (unlikely(!smc->xmit_if_count || (smc->xmit_if_count > SFE_MAX_MC_IF))) {
+		return -EINVAL;
+	}
+
+	if (unlikely(smc->src_vlan_count > SFE_MAX_VLAN_DEPTH)) {
+		return -EINVAL;
+	}
+
+	if (unlikely(((smc->flags & SFE_CREATE_FLAG_SRC_PPPOE) || smc->src_vlan_count) &&
+		     (src_dev->flags & IFF_POINTOPOINT))) {
+		return -EINVAL;
+	}
+
+	for (i = 0; i < smc->xmit_if_count; i++) {
+		if (unlikely(!sfe_ipv4_mc_xmit_if_valid(&smc->xmit_if[i], src_dev))) {
+			return -EINVAL;
+		}
+	}
+
 	spin_lock_bh(&si->lock);
-	si->connection_create_requests++;
+	sfe_ipv4_stats_inc(si, connection_create_requests);
 
-	/*
-	 * Check to see if there is already a flow that matches the rule we're
-	 * trying to create.  If there is then we can't create a new one.
-	 */
 	c = sfe_ipv4_find_sfe_ipv4_connection(si,
-					      sic->protocol,
-					      sic->src_ip.ip,
-					      sic->src_port,
-					      sic->dest_ip.ip,
-					      sic->dest_port);
+					      smc->protocol,
+					      smc->src_ip.ip,
+					      smc->src_port,
+					      smc->dest_ip.ip,
+					      smc->dest_port);
 	if (c != NULL) {
-		si->connection_create_collisions++;
-
-		/*
-		 * If we already have the flow then it's likely that this
-		 * request to create the connection rule contains more
-		 * up-to-date information. Check and update accordingly.
-		 */
-		sfe_ipv4_update_protocol_state(c, sic);
+		sfe_ipv4_stats_inc(si, connection_create_collisions);
 		spin_unlock_bh(&si->lock);
 
-		DEBUG_TRACE("connection already exists - mark: %08x, p: %d\n"
-			    "  s: %s:%pM:%pI4:%u, d: %s:%pM:%pI4:%u\n",
-			    sic->mark, sic->protocol,
-			    sic->src_dev->name, sic->src_mac, &sic->src_ip.ip, ntohs(sic->src_port),
-			    sic->dest_dev->name, sic->dest_mac, &sic->dest_ip.ip, ntohs(sic->dest_port));
+		DEBUG_TRACE("multicast connection already exists - mark: %08x, p: %d\n"
+			    "  s: %s:%pI4:%u, g: %pM:%pI4:%u\n",
+			    smc->mark, smc->protocol,
+			    src_dev->name, &smc->src_ip.ip, ntohs(smc->src_port),
+			    smc->dest_mac, &smc->dest_ip.ip, ntohs(smc->dest_port));
 		return -EADDRINUSE;
 	}
 
@@ -2528,14 +4881,14 @@ int sfe_ipv4_create_rule(struct sfe_connection_create *sic)
 		return -ENOMEM;
 	}
 
-	original_cm = (struct sfe_ipv4_connection_match *)kmalloc(sizeof(struct sfe_ipv4_connection_match), GFP_ATOMIC);
+	original_cm = (struct sfe_ipv4_connection_match *)kzalloc(sizeof(struct sfe_ipv4_connection_match), GFP_ATOMIC);
 	if (unlikely(!original_cm)) {
 		spin_unlock_bh(&si->lock);
 		kfree(c);
 		return -ENOMEM;
 	}
 
-	reply_cm = (struct sfe_ipv4_connection_match *)kmalloc(sizeof(struct sfe_ipv4_connection_match), GFP_ATOMIC);
+	reply_cm = (struct sfe_ipv4_connection_match *)kzalloc(sizeof(struct sfe_ipv4_connection_match), GFP_ATOMIC);
 	if (unlikely(!reply_cm)) {
 		spin_unlock_bh(&si->lock);
 		kfree(original_cm);
@@ -2543,198 +4896,240 @@ int sfe_ipv4_create_rule(struct sfe_connection_create *sic)
 		return -ENOMEM;
 	}
 
+	mcx = (struct sfe_ipv4_mc_xmit *)kmalloc(sizeof(struct sfe_ipv4_mc_xmit), GFP_ATOMIC);
+	if (unlikely(!mcx)) {
+		spin_unlock_bh(&si->lock);
+		kfree(reply_cm);
+		kfree(original_cm);
+		kfree(c);
+		return -ENOMEM;
+	}
+
+	original_cm->stats = alloc_percpu_gfp(struct sfe_ipv4_connection_match_stats, GFP_ATOMIC);
+	if (unlikely(!original_cm->stats)) {
+		spin_unlock_bh(&si->lock);
+		kfree(mcx);
+		kfree(reply_cm);
+		kfree(original_cm);
+		kfree(c);
+		return -ENOMEM;
+	}
+
+	reply_cm->stats = alloc_percpu_gfp(struct sfe_ipv4_connection_match_stats, GFP_ATOMIC);
+	if (unlikely(!reply_cm->stats)) {
+		spin_unlock_bh(&si->lock);
+		free_percpu(original_cm->stats);
+		kfree(mcx);
+		kfree(reply_cm);
+		kfree(original_cm);
+		kfree(c);
+		return -ENOMEM;
+	}
+
+	/*
+	 * Fill in the egress interfaces.
+	 */
+	mcx->count = smc->xmit_if_count;
+	for (i = 0; i < mcx->count; i++) {
+		sfe_ipv4_mc_xmit_if_init(&mcx->xif[i], &smc->xmit_if[i], smc->dest_mac);
+	}
+	sfe_ipv4_mc_xmit_summarize(mcx);
+
 	/*
 	 * Fill in the "original" direction connection matching object.
-	 * Note that the transmit MAC address is "dest_mac_xlate" because
-	 * we always know both ends of a connection by their translated
-	 * addresses and not their public addresses.
+	 * Multicast addresses and ports are never translated.
 	 */
 	original_cm->match_dev = src_dev;
-	original_cm->match_protocol = sic->protocol;
-	original_cm->match_src_ip = sic->src_ip.ip;
-	original_cm->match_src_port = sic->src_port;
-	original_cm->match_dest_ip = sic->dest_ip.ip;
-	original_cm->match_dest_port = sic->dest_port;
-	original_cm->xlate_src_ip = sic->src_ip_xlate.ip;
-	original_cm->xlate_src_port = sic->src_port_xlate;
-	original_cm->xlate_dest_ip = sic->dest_ip_xlate.ip;
-	original_cm->xlate_dest_port = sic->dest_port_xlate;
-	original_cm->rx_packet_count = 0;
-	original_cm->rx_packet_count64 = 0;
-	original_cm->rx_byte_count = 0;
-	original_cm->rx_byte_count64 = 0;
-	original_cm->xmit_dev = dest_dev;
-	original_cm->xmit_dev_mtu = sic->dest_mtu;
-	memcpy(original_cm->xmit_src_mac, dest_dev->dev_addr, ETH_ALEN);
-	memcpy(original_cm->xmit_dest_mac, sic->dest_mac_xlate, ETH_ALEN);
+	original_cm->match_protocol = smc->protocol;
+	original_cm->match_src_ip = smc->src_ip.ip;
+	original_cm->match_src_port = smc->src_port;
+	original_cm->match_dest_ip = smc->dest_ip.ip;
+	original_cm->match_dest_port = smc->dest_port;
+	original_cm->xlate_src_ip = smc->src_ip.ip;
+	original_cm->xlate_src_port = smc->src_port;
+	original_cm->xlate_dest_ip = smc->dest_ip.ip;
+	original_cm->xlate_dest_port = smc->dest_port;
 	original_cm->connection = c;
 	original_cm->counter_match = reply_cm;
-	original_cm->flags = 0;
-	if (sic->flags & SFE_CREATE_FLAG_REMARK_PRIORITY) {
-		original_cm->priority = sic->src_priority;
+	original_cm->flags = SFE_IPV4_CONNECTION_MATCH_FLAG_MULTICAST;
+	if (smc->flags & SFE_CREATE_FLAG_REMARK_PRIORITY) {
+		original_cm->priority = smc->priority;
 		original_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_PRIORITY_REMARK;
 	}
-	if (sic->flags & SFE_CREATE_FLAG_REMARK_DSCP) {
-		original_cm->dscp = sic->src_dscp << SFE_IPV4_DSCP_SHIFT;
+	if (smc->flags & SFE_CREATE_FLAG_REMARK_DSCP) {
+		original_cm->dscp = smc->dscp << SFE_IPV4_DSCP_SHIFT;
 		original_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_DSCP_REMARK;
 	}
-#ifdef CONFIG_NF_FLOW_COOKIE
-	original_cm->flow_cookie = 0;
-#endif
+	if (smc->flags & SFE_CREATE_FLAG_SRC_PPPOE) {
+		original_cm->match_pppoe_session_id = htons(smc->src_pppoe_session_id);
+		original_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_PPPOE_DECAP;
+	}
 #ifdef CONFIG_XFRM
-	original_cm->flow_accel = sic->original_accel;
+	original_cm->flow_accel = 1;
 #endif
-	original_cm->active_next = NULL;
-	original_cm->active_prev = NULL;
-	original_cm->active = false;
-
-	/*
-	 * For PPP links we don't write an L2 header.  For everything else we do.
-	 */
-	if (!(dest_dev->flags & IFF_POINTOPOINT)) {
-		original_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_WRITE_L2_HDR;
-
-		/*
-		 * If our dev writes Ethernet headers then we can write a really fast
-		 * version.
-		 */
-		if (dest_dev->header_ops) {
-			if (dest_dev->header_ops->create == eth_header) {
-				original_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_WRITE_FAST_ETH_HDR;
-			}
-		}
-	}
+	original_cm->match_vlan_count = smc->src_vlan_count;
+	memcpy(original_cm->match_vlan_tag, smc->src_vlan_tag, sizeof(original_cm->match_vlan_tag));
+	rcu_assign_pointer(original_cm->mc_xmit, mcx);
 
 	/*
 	 * Fill in the "reply" direction connection matching object.
 	 */
-	reply_cm->match_dev = dest_dev;
-	reply_cm->match_protocol = sic->protocol;
-	reply_cm->match_src_ip = sic->dest_ip_xlate.ip;
-	reply_cm->match_src_port = sic->dest_port_xlate;
-	reply_cm->match_dest_ip = sic->src_ip_xlate.ip;
-	reply_cm->match_dest_port = sic->src_port_xlate;
-	reply_cm->xlate_src_ip = sic->dest_ip.ip;
-	reply_cm->xlate_src_port = sic->dest_port;
-	reply_cm->xlate_dest_ip = sic->src_ip.ip;
-	reply_cm->xlate_dest_port = sic->src_port;
-	reply_cm->rx_packet_count = 0;
-	reply_cm->rx_packet_count64 = 0;
-	reply_cm->rx_byte_count = 0;
-	reply_cm->rx_byte_count64 = 0;
+	reply_cm->match_dev = src_dev;
+	reply_cm->match_protocol = smc->protocol;
+	reply_cm->match_src_ip = smc->dest_ip.ip;
+	reply_cm->match_src_port = smc->dest_port;
+	reply_cm->match_dest_ip = smc->src_ip.ip;
+	reply_cm->match_dest_port = smc->src_port;
+	reply_cm->xlate_src_ip = smc->dest_ip.ip;
+	reply_cm->xlate_src_port = smc->dest_port;
+	reply_cm->xlate_dest_ip = smc->src_ip.ip;
+	reply_cm->xlate_dest_port = smc->src_port;
 	reply_cm->xmit_dev = src_dev;
-	reply_cm->xmit_dev_mtu = sic->src_mtu;
-	memcpy(reply_cm->xmit_src_mac, src_dev->dev_addr, ETH_ALEN);
-	memcpy(reply_cm->xmit_dest_mac, sic->src_mac, ETH_ALEN);
 	reply_cm->connection = c;
 	reply_cm->counter_match = original_cm;
-	reply_cm->flags = 0;
-	if (sic->flags & SFE_CREATE_FLAG_REMARK_PRIORITY) {
-		reply_cm->priority = sic->dest_priority;
-		reply_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_PRIORITY_REMARK;
-	}
-	if (sic->flags & SFE_CREATE_FLAG_REMARK_DSCP) {
-		reply_cm->dscp = sic->dest_dscp << SFE_IPV4_DSCP_SHIFT;
-		reply_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_DSCP_REMARK;
-	}
-#ifdef CONFIG_NF_FLOW_COOKIE
-	reply_cm->flow_cookie = 0;
-#endif
-#ifdef CONFIG_XFRM
-	reply_cm->flow_accel = sic->reply_accel;
-#endif
-	reply_cm->active_next = NULL;
-	reply_cm->active_prev = NULL;
-	reply_cm->active = false;
+
+	c->protocol = smc->protocol;
+	c->src_ip = smc->src_ip.ip;
+	c->src_ip_xlate = smc->src_ip.ip;
+	c->src_port = smc->src_port;
+	c->src_port_xlate = smc->src_port;
+	c->original_dev = src_dev;
+	c->original_match = original_cm;
+	c->dest_ip = smc->dest_ip.ip;
+	c->dest_ip_xlate = smc->dest_ip.ip;
+	c->dest_port = smc->dest_port;
+	c->dest_port_xlate = smc->dest_port;
+	c->reply_dev = src_dev;
+	c->reply_match = reply_cm;
+	c->mark = smc->mark;
+	c->debug_read_seq = 0;
+	c->last_sync_jiffies = get_jiffies_64();
+	c->removed = false;
+	spin_lock_init(&c->lock);
 
 	/*
-	 * For PPP links we don't write an L2 header.  For everything else we do.
+	 * Take hold of our source device for the duration of the connection, once
+	 * for each direction.
 	 */
-	if (!(src_dev->flags & IFF_POINTOPOINT)) {
-		reply_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_WRITE_L2_HDR;
+	dev_hold(c->original_dev);
+	dev_hold(c->reply_dev);
 
-		/*
-		 * If our dev writes Ethernet headers then we can write a really fast
-		 * version.
-		 */
-		if (src_dev->header_ops) {
-			if (src_dev->header_ops->create == eth_header) {
-				reply_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_WRITE_FAST_ETH_HDR;
-			}
-		}
+	sfe_ipv4_insert_sfe_ipv4_connection(si, c);
+
+	spin_unlock_bh(&si->lock);
+
+	DEBUG_INFO("new multicast connection - mark: %08x, p: %d, interfaces: %u\n"
+		   "  s: %s:%pI4:%u, g: %pM:%pI4:%u\n",
+		   smc->mark, smc->protocol, smc->xmit_if_count,
+		   src_dev->name, &smc->src_ip.ip, ntohs(smc->src_port),
+		   smc->dest_mac, &smc->dest_ip.ip, ntohs(smc->dest_port));
+
+	return 0;
+}
+
+/*
+ * sfe_ipv4_update_mc_rule()
+ *	Add or remove egress interfaces of a multicast forwarding rule.
+ *
+ * An interface that joins again replaces the one already there.  The fast path
+ * sees either the old list or the new one, never a list being changed.
+ */
+int sfe_ipv4_update_mc_rule(struct sfe_mc_connection_create *smc)
+{
+	struct sfe_ipv4 *si = &__si;
+	struct sfe_ipv4_connection *c;
+	struct sfe_ipv4_connection_match *cm;
+	struct sfe_ipv4_mc_xmit *old_mcx;
+	struct sfe_ipv4_mc_xmit *mcx;
+	unsigned int count;
+	unsigned int i;
+	unsigned int j;
+
+	if (unlikely(smc->xmit_if_count > SFE_MAX_MC_IF)) {
+		return -EINVAL;
 	}
 
+	for (j = 0; j < smc->xmit_if_count; j++) {
+		struct sfe_mc_xmit_if *smx = &smc->xmit_if[j];
 
-	if (sic->dest_ip.ip != sic->dest_ip_xlate.ip || sic->dest_port != sic->dest_port_xlate) {
-		original_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_XLATE_DEST;
-		reply_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_XLATE_SRC;
+		if ((smx->flags & SFE_MC_XMIT_IF_FLAG_JOIN) &&
+		    unlikely(!sfe_ipv4_mc_xmit_if_valid(smx, smc->src_dev))) {
+			return -EINVAL;
+		}
 	}
 
-	if (sic->src_ip.ip != sic->src_ip_xlate.ip || sic->src_port != sic->src_port_xlate) {
-		original_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_XLATE_SRC;
-		reply_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_XLATE_DEST;
+	mcx = (struct sfe_ipv4_mc_xmit *)kmalloc(sizeof(struct sfe_ipv4_mc_xmit), GFP_ATOMIC);
+	if (unlikely(!mcx)) {
+		return -ENOMEM;
 	}
 
-	c->protocol = sic->protocol;
-	c->src_ip = sic->src_ip.ip;
-	c->src_ip_xlate = sic->src_ip_xlate.ip;
-	c->src_port = sic->src_port;
-	c->src_port_xlate = sic->src_port_xlate;
-	c->original_dev = src_dev;
-	c->original_match = original_cm;
-	c->dest_ip = sic->dest_ip.ip;
-	c->dest_ip_xlate = sic->dest_ip_xlate.ip;
-	c->dest_port = sic->dest_port;
-	c->dest_port_xlate = sic->dest_port_xlate;
-	c->reply_dev = dest_dev;
-	c->reply_match = reply_cm;
-	c->mark = sic->mark;
-	c->debug_read_seq = 0;
-	c->last_sync_jiffies = get_jiffies_64();
+	spin_lock_bh(&si->lock);
 
-	/*
-	 * Take hold of our source and dest devices for the duration of the connection.
-	 */
-	dev_hold(c->original_dev);
-	dev_hold(c->reply_dev);
+	c = sfe_ipv4_find_sfe_ipv4_connection(si,
+					      smc->protocol,
+					      smc->src_ip.ip,
+					      smc->src_port,
+					      smc->dest_ip.ip,
+					      smc->dest_port);
+	if (!c || !(c->original_match->flags & SFE_IPV4_CONNECTION_MATCH_FLAG_MULTICAST)) {
+		spin_unlock_bh(&si->lock);
+		kfree(mcx);
+
+		DEBUG_TRACE("multicast connection does not exist - p: %d, s: %pI4:%u, g: %pI4:%u\n",
+			    smc->protocol, &smc->src_ip.ip, ntohs(smc->src_port),
+			    &smc->dest_ip.ip, ntohs(smc->dest_port));
+		return -ENOENT;
+	}
+
+	cm = c->original_match;
+	old_mcx = rcu_dereference_protected(cm->mc_xmit, lockdep_is_held(&si->lock));
 
 	/*
-	 * Initialize the protocol-specific information that we track.
+	 * Keep the interfaces the update doesn't mention and then add the ones
+	 * joining.
 	 */
-	switch (sic->protocol) {
-	case IPPROTO_TCP:
-		original_cm->protocol_state.tcp.win_scale = sic->src_td_window_scale;
-		original_cm->protocol_state.tcp.max_win = sic->src_td_max_window ? sic->src_td_max_window : 1;
-		original_cm->protocol_state.tcp.end = sic->src_td_end;
-		original_cm->protocol_state.tcp.max_end = sic->src_td_max_end;
-		reply_cm->protocol_state.tcp.win_scale = sic->dest_td_window_scale;
-		reply_cm->protocol_state.tcp.max_win = sic->dest_td_max_window ? sic->dest_td_max_window : 1;
-		reply_cm->protocol_state.tcp.end = sic->dest_td_end;
-		reply_cm->protocol_state.tcp.max_end = sic->dest_td_max_end;
-		if (sic->flags & SFE_CREATE_FLAG_NO_SEQ_CHECK) {
-			original_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_NO_SEQ_CHECK;
-			reply_cm->flags |= SFE_IPV4_CONNECTION_MATCH_FLAG_NO_SEQ_CHECK;
+	mcx->count = 0;
+	for (i = 0; i < old_mcx->count; i++) {
+		struct sfe_ipv4_mc_xmit_if *xif = &old_mcx->xif[i];
+
+		for (j = 0; j < smc->xmit_if_count; j++) {
+			if ((smc->xmit_if[j].flags & (SFE_MC_XMIT_IF_FLAG_JOIN | SFE_MC_XMIT_IF_FLAG_LEAVE)) &&
+			    sfe_ipv4_mc_xmit_if_same(xif, &smc->xmit_if[j])) {
+				break;
+			}
 		}
-		break;
+
+		if (j == smc->xmit_if_count) {
+			mcx->xif[mcx->count++] = *xif;
+			dev_hold(xif->xmit_dev);
+		}
+	}
+
+	for (j = 0; j < smc->xmit_if_count; j++) {
+		if (!(smc->xmit_if[j].flags & SFE_MC_XMIT_IF_FLAG_JOIN)) {
+			continue;
+		}
+
+		if (unlikely(mcx->count == SFE_MAX_MC_IF)) {
+			spin_unlock_bh(&si->lock);
+			sfe_ipv4_free_mc_xmit(mcx);
+			return -ENOSPC;
+		}
+
+		sfe_ipv4_mc_xmit_if_init(&mcx->xif[mcx->count++], &smc->xmit_if[j], smc->dest_mac);
 	}
 
-	sfe_ipv4_connection_match_compute_translations(original_cm);
-	sfe_ipv4_connection_match_compute_translations(reply_cm);
-	sfe_ipv4_insert_sfe_ipv4_connection(si, c);
+	sfe_ipv4_mc_xmit_summarize(mcx);
+	count = mcx->count;
+	rcu_assign_pointer(cm->mc_xmit, mcx);
 
 	spin_unlock_bh(&si->lock);
 
-	/*
-	 * We have everything we need!
-	 */
-	DEBUG_INFO("new connection - mark: %08x, p: %d\n"
-		   "  s: %s:%pM(%pM):%pI4(%pI4):%u(%u)\n"
-		   "  d: %s:%pM(%pM):%pI4(%pI4):%u(%u)\n",
-		   sic->mark, sic->protocol,
-		   sic->src_dev->name, sic->src_mac, sic->src_mac_xlate,
-		   &sic->src_ip.ip, &sic->src_ip_xlate.ip, ntohs(sic->src_port), ntohs(sic->src_port_xlate),
-		   dest_dev->name, sic->dest_mac, sic->dest_mac_xlate,
-		   &sic->dest_ip.ip, &sic->dest_ip_xlate.ip, ntohs(sic->dest_port), ntohs(sic->dest_port_xlate));
+	call_rcu(&old_mcx->rcu, sfe_ipv4_free_mc_xmit_rcu);
+
+	DEBUG_INFO("multicast connection updated - p: %d, s: %pI4:%u, g: %pI4:%u, interfaces: %u\n",
+		   smc->protocol, &smc->src_ip.ip, ntohs(smc->src_port),
+		   &smc->dest_ip.ip, ntohs(smc->dest_port), count);
 
 	return 0;
 }
@@ -2749,7 +5144,7 @@ void sfe_ipv4_destroy_rule(struct sfe_connection_destroy *sid)
 	struct sfe_ipv4_connection *c;
 
 	spin_lock_bh(&si->lock);
-	si->connection_destroy_requests++;
+	sfe_ipv4_stats_inc(si, connection_destroy_requests);
 
 	/*
 	 * Check to see if we have a flow that matches the rule we're trying
@@ -2758,7 +5153,7 @@ void sfe_ipv4_destroy_rule(struct sfe_connection_destroy *sid)
 	c = sfe_ipv4_find_sfe_ipv4_connection(si, sid->protocol, sid->src_ip.ip, sid->src_port,
 					      sid->dest_ip.ip, sid->dest_port);
 	if (!c) {
-		si->connection_destroy_misses++;
+		sfe_ipv4_stats_inc(si, connection_destroy_misses);
 		spin_unlock_bh(&si->lock);
 
 		DEBUG_TRACE("connection does not exist - p: %d, s: %pI4:%u, d: %pI4:%u\n",
@@ -2793,6 +5188,21 @@ void sfe_ipv4_register_sync_rule_callback(sfe_sync_rule_callback_t sync_rule_cal
 	spin_unlock_bh(&si->lock);
 }
 
+/*
+ * sfe_ipv4_register_sync_rule_batch_callback()
+ *	Register a callback for the periodic rule synchronization to hand over its records in batches.
+ *
+ * When no batch callback is registered the records are handed to the single rule callback one by one.
+ */
+void sfe_ipv4_register_sync_rule_batch_callback(sfe_sync_rule_batch_callback_t sync_rule_batch_callback)
+{
+	struct sfe_ipv4 *si = &__si;
+
+	spin_lock_bh(&si->lock);
+	rcu_assign_pointer(si->sync_rule_batch_callback, sync_rule_batch_callback);
+	spin_unlock_bh(&si->lock);
+}
+
 /*
  * sfe_ipv4_get_debug_dev()
  */
@@ -2818,6 +5228,107 @@ static ssize_t sfe_ipv4_get_debug_dev(struct device *dev,
 static const struct device_attribute sfe_ipv4_debug_dev_attr =
 	__ATTR(debug_dev, S_IWUSR | S_IRUGO, sfe_ipv4_get_debug_dev, NULL);
 
+/*
+ * sfe_ipv4_sync_lag()
+ *	Age, in jiffies, of the oldest active connection match entry still waiting to be synced.
+ *
+ * The lock must be held.
+ */
+static unsigned long sfe_ipv4_sync_lag(struct sfe_ipv4 *si)
+{
+	if (!si->active_head) {
+		return 0;
+	}
+
+	return jiffies - si->active_head->active_jiffies;
+}
+
+/*
+ * sfe_ipv4_get_sync_budget()
+ */
+static ssize_t sfe_ipv4_get_sync_budget(struct device *dev,
+					struct device_attribute *attr,
+					char *buf)
+{
+	struct sfe_ipv4 *si = &__si;
+
+	return snprintf(buf, (ssize_t)PAGE_SIZE, "%u\n", READ_ONCE(si->sync_budget_us));
+}
+
+/*
+ * sfe_ipv4_set_sync_budget()
+ *	Set the CPU time, in microseconds, that each periodic sync may use.
+ *
+ * Whatever the budget, a periodic sync always hands over at least one batch.
+ */
+static ssize_t sfe_ipv4_set_sync_budget(struct device *dev,
+					struct device_attribute *attr,
+					const char *buf, size_t size)
+{
+	struct sfe_ipv4 *si = &__si;
+	unsigned int budget;
+	int result;
+
+	result = kstrtouint(buf, 0, &budget);
+	if (result) {
+		return result;
+	}
+
+	WRITE_ONCE(si->sync_budget_us, budget);
+	return size;
+}
+
+/*
+ * sfe_ipv4_get_sync_lag()
+ */
+static ssize_t sfe_ipv4_get_sync_lag(struct device *dev,
+				     struct device_attribute *attr,
+				     char *buf)
+{
+	struct sfe_ipv4 *si = &__si;
+	unsigned long lag;
+
+	spin_lock_bh(&si->lock);
+	lag = sfe_ipv4_sync_lag(si);
+	spin_unlock_bh(&si->lock);
+
+	return snprintf(buf, (ssize_t)PAGE_SIZE, "%u\n", jiffies_to_msecs(lag));
+}
+
+/*
+ * sysfs attributes.
+ */
+static const struct device_attribute sfe_ipv4_sync_budget_attr =
+	__ATTR(sync_budget_us, S_IWUSR | S_IRUGO, sfe_ipv4_get_sync_budget, sfe_ipv4_set_sync_budget);
+static const struct device_attribute sfe_ipv4_sync_lag_attr =
+	__ATTR(sync_lag_ms, S_IRUGO, sfe_ipv4_get_sync_lag, NULL);
+
+/*
+ * sfe_ipv4_mc_xmit_uses_dev()
+ *	Check whether a multicast connection transmits on a device.
+ *
+ * On entry we must be holding the lock.
+ */
+static bool sfe_ipv4_mc_xmit_uses_dev(struct sfe_ipv4 *si, struct sfe_ipv4_connection_match *cm,
+				      struct net_device *dev)
+{
+	struct sfe_ipv4_mc_xmit *mcx;
+	unsigned int i;
+
+	mcx = rcu_dereference_protected(cm->mc_xmit, lockdep_is_held(&si->lock));
+	if (!mcx) {
+		return false;
+	}
+
+	for (i = 0; i < mcx->count; i++) {
+		if (mcx->xif[i].xmit_dev == dev) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
 /*
  * sfe_ipv4_destroy_all_rules_for_dev()
  *	Destroy all connections that match a particular device.
@@ -2838,7 +5349,8 @@ another_round:
 		 */
 		if (!dev
 		    || (dev == c->original_dev)
-		    || (dev == c->reply_dev)) {
+		    || (dev == c->reply_dev)
+		    || sfe_ipv4_mc_xmit_uses_dev(si, c->original_match, dev)) {
 			break;
 		}
 	}
@@ -2857,6 +5369,11 @@ another_round:
 
 /*
  * sfe_ipv4_periodic_sync()
+ *	Sync the state of recently active connections back to the connection manager.
+ *
+ * The entries taken off the active list are gathered in batches under a single
+ * hold of the lock and handed over outside it.  A tick that uses up its CPU
+ * budget stops early and leaves the rest of its quota for the next one.
  */
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(4, 15, 0))
 static void sfe_ipv4_periodic_sync(struct timer_list *arg)
@@ -2867,17 +5384,21 @@ static void sfe_ipv4_periodic_sync(unsigned long arg)
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(4, 15, 0))
 	struct sfe_ipv4 *si = (struct sfe_ipv4 *)arg->cust_data;
 #else
-	struct sfe_ipv4 *s1 = (struct sfe_ipv4 *)arg;
+	struct sfe_ipv4 *si = (struct sfe_ipv4 *)arg;
 #endif /*KERNEL_VERSION(4, 15, 0)*/
 	u64 now_jiffies;
-	int quota;
+	u64 budget_end;
+	unsigned int quota;
 	sfe_sync_rule_callback_t sync_rule_callback;
+	sfe_sync_rule_batch_callback_t sync_rule_batch_callback;
 
 	now_jiffies = get_jiffies_64();
+	budget_end = sched_clock() + (u64)READ_ONCE(si->sync_budget_us) * NSEC_PER_USEC;
 
 	rcu_read_lock();
 	sync_rule_callback = rcu_dereference(si->sync_rule_callback);
-	if (!sync_rule_callback) {
+	sync_rule_batch_callback = rcu_dereference(si->sync_rule_batch_callback);
+	if (!sync_rule_callback && !sync_rule_batch_callback) {
 		rcu_read_unlock();
 		goto done;
 	}
@@ -2886,80 +5407,105 @@ static void sfe_ipv4_periodic_sync(unsigned long arg)
 	sfe_ipv4_update_summary_stats(si);
 
 	/*
-	 * Get an estimate of the number of connections to parse in this sync.
-	 */
-	quota = (si->num_connections + 63) / 64;
-
-	/*
-	 * Walk the "active" list and sync the connection state.
+	 * Scale the number of connections to sync in this tick to the length of the active list.
 	 */
-	while (quota--) {
-		struct sfe_ipv4_connection_match *cm;
-		struct sfe_ipv4_connection_match *counter_cm;
-		struct sfe_ipv4_connection *c;
-		struct sfe_connection_sync sis;
+	quota = DIV_ROUND_UP(si->active_count, SFE_IPV4_SYNC_TICKS_PER_PASS);
 
-		cm = si->active_head;
-		if (!cm) {
-			break;
-		}
+	while (quota) {
+		unsigned int count = 0;
+		unsigned int i;
 
 		/*
-		 * There's a possibility that our counter match is in the active list too.
-		 * If it is then remove it.
+		 * Walk the "active" list and gather a batch of connection states.
 		 */
-		counter_cm = cm->counter_match;
-		if (counter_cm->active) {
-			counter_cm->active = false;
+		while (quota && (count < SFE_IPV4_SYNC_BATCH_SIZE)) {
+			struct sfe_ipv4_connection_match *cm;
+			struct sfe_ipv4_connection_match *counter_cm;
+
+			cm = si->active_head;
+			if (!cm) {
+				break;
+			}
 
 			/*
-			 * We must have a connection preceding this counter match
-			 * because that's the one that got us to this point, so we don't have
-			 * to worry about removing the head of the list.
+			 * There's a possibility that our counter match is in the active list too.
+			 * If it is then remove it.
 			 */
-			counter_cm->active_prev->active_next = counter_cm->active_next;
+			counter_cm = cm->counter_match;
+			if (counter_cm->active) {
+				counter_cm->active = false;
+
+				/*
+				 * We must have a connection preceding this counter match
+				 * because that's the one that got us to this point, so we don't have
+				 * to worry about removing the head of the list.
+				 */
+				counter_cm->active_prev->active_next = counter_cm->active_next;
+
+				if (likely(counter_cm->active_next)) {
+					counter_cm->active_next->active_prev = counter_cm->active_prev;
+				} else {
+					si->active_tail = counter_cm->active_prev;
+				}
 
-			if (likely(counter_cm->active_next)) {
-				counter_cm->active_next->active_prev = counter_cm->active_prev;
+				counter_cm->active_next = NULL;
+				counter_cm->active_prev = NULL;
+				si->active_count--;
+			}
+
+			/*
+			 * Now remove the head of the active scan list.
+			 */
+			cm->active = false;
+			si->active_head = cm->active_next;
+			if (likely(cm->active_next)) {
+				cm->active_next->active_prev = NULL;
 			} else {
-				si->active_tail = counter_cm->active_prev;
+				si->active_tail = NULL;
 			}
+			cm->active_next = NULL;
+			si->active_count--;
 
-			counter_cm->active_next = NULL;
-			counter_cm->active_prev = NULL;
+			/*
+			 * Sync the connection state.
+			 */
+			sfe_ipv4_gen_sync_sfe_ipv4_connection(si, cm->connection, &si->sync_batch[count],
+							      SFE_SYNC_REASON_STATS, now_jiffies);
+			count++;
+			quota--;
 		}
 
-		/*
-		 * Now remove the head of the active scan list.
-		 */
-		cm->active = false;
-		si->active_head = cm->active_next;
-		if (likely(cm->active_next)) {
-			cm->active_next->active_prev = NULL;
-		} else {
-			si->active_tail = NULL;
+		if (!count) {
+			break;
 		}
-		cm->active_next = NULL;
 
-		/*
-		 * Sync the connection state.
-		 */
-		c = cm->connection;
-		sfe_ipv4_gen_sync_sfe_ipv4_connection(si, c, &sis, SFE_SYNC_REASON_STATS, now_jiffies);
+		si->sync_records += count;
+		si->sync_batches++;
 
 		/*
 		 * We don't want to be holding the lock when we sync!
 		 */
 		spin_unlock_bh(&si->lock);
-		sync_rule_callback(&sis);
+		if (sync_rule_batch_callback) {
+			sync_rule_batch_callback(si->sync_batch, count);
+		} else {
+			for (i = 0; i < count; i++) {
+				sync_rule_callback(&si->sync_batch[i]);
+			}
+		}
 		spin_lock_bh(&si->lock);
+
+		if (quota && (sched_clock() > budget_end)) {
+			si->sync_budget_overruns++;
+			break;
+		}
 	}
 
 	spin_unlock_bh(&si->lock);
 	rcu_read_unlock();
 
 done:
-	mod_timer(&si->timer, jiffies + ((HZ + 99) / 100));
+	mod_timer(&si->timer, jiffies + SFE_IPV4_SYNC_PERIOD);
 }
 
 #define CHAR_DEV_MSG_SIZE 768
@@ -3070,11 +5616,9 @@ static bool sfe_ipv4_debug_dev_read_connections_connection(struct sfe_ipv4 *si,
 	src_priority = original_cm->priority;
 	src_dscp = original_cm->dscp >> SFE_IPV4_DSCP_SHIFT;
 
-	sfe_ipv4_connection_match_update_summary_stats(original_cm);
-	sfe_ipv4_connection_match_update_summary_stats(reply_cm);
+	sfe_ipv4_connection_match_get_stats(original_cm, &src_rx_packets, &src_rx_bytes);
+	sfe_ipv4_connection_match_get_stats(reply_cm, &dest_rx_packets, &dest_rx_bytes);
 
-	src_rx_packets = original_cm->rx_packet_count64;
-	src_rx_bytes = original_cm->rx_byte_count64;
 	dest_dev = c->reply_dev;
 	dest_ip = c->dest_ip;
 	dest_ip_xlate = c->dest_ip_xlate;
@@ -3082,8 +5626,6 @@ static bool sfe_ipv4_debug_dev_read_connections_connection(struct sfe_ipv4 *si,
 	dest_port_xlate = c->dest_port_xlate;
 	dest_priority = reply_cm->priority;
 	dest_dscp = reply_cm->dscp >> SFE_IPV4_DSCP_SHIFT;
-	dest_rx_packets = reply_cm->rx_packet_count64;
-	dest_rx_bytes = reply_cm->rx_byte_count64;
 	last_sync_jiffies = get_jiffies_64() - c->last_sync_jiffies;
 	mark = c->mark;
 #ifdef CONFIG_NF_FLOW_COOKIE
@@ -3246,13 +5788,18 @@ static bool sfe_ipv4_debug_dev_read_stats(struct sfe_ipv4 *si, char *buffer, cha
 	unsigned int num_connections;
 	u64 packets_forwarded;
 	u64 packets_not_forwarded;
+	u64 packets_policed;
 	u64 connection_create_requests;
 	u64 connection_create_collisions;
 	u64 connection_destroy_requests;
 	u64 connection_destroy_misses;
 	u64 connection_flushes;
 	u64 connection_match_hash_hits;
-	u64 connection_match_hash_reorders;
+	u64 sync_records;
+	u64 sync_batches;
+	u64 sync_budget_overruns;
+	unsigned int active_count;
+	unsigned long sync_lag;
 
 	spin_lock_bh(&si->lock);
 	sfe_ipv4_update_summary_stats(si);
@@ -3260,32 +5807,115 @@ static bool sfe_ipv4_debug_dev_read_stats(struct sfe_ipv4 *si, char *buffer, cha
 	num_connections = si->num_connections;
 	packets_forwarded = si->packets_forwarded64;
 	packets_not_forwarded = si->packets_not_forwarded64;
+	packets_policed = si->packets_policed64;
 	connection_create_requests = si->connection_create_requests64;
 	connection_create_collisions = si->connection_create_collisions64;
 	connection_destroy_requests = si->connection_destroy_requests64;
 	connection_destroy_misses = si->connection_destroy_misses64;
 	connection_flushes = si->connection_flushes64;
 	connection_match_hash_hits = si->connection_match_hash_hits64;
-	connection_match_hash_reorders = si->connection_match_hash_reorders64;
+	sync_records = si->sync_records;
+	sync_batches = si->sync_batches;
+	sync_budget_overruns = si->sync_budget_overruns;
+	active_count = si->active_count;
+	sync_lag = sfe_ipv4_sync_lag(si);
 	spin_unlock_bh(&si->lock);
 
 	bytes_read = snprintf(msg, CHAR_DEV_MSG_SIZE, "\t<stats "
 			      "num_connections=\"%u\" "
 			      "pkts_forwarded=\"%llu\" pkts_not_forwarded=\"%llu\" "
+			      "pkts_policed=\"%llu\" "
 			      "create_requests=\"%llu\" create_collisions=\"%llu\" "
 			      "destroy_requests=\"%llu\" destroy_misses=\"%llu\" "
 			      "flushes=\"%llu\" "
-			      "hash_hits=\"%llu\" hash_reorders=\"%llu\" />\n",
+			      "hash_hits=\"%llu\" "
+			      "active=\"%u\" sync_lag_ms=\"%u\" "
+			      "sync_records=\"%llu\" sync_batches=\"%llu\" "
+			      "sync_budget_overruns=\"%llu\" />\n",
 			      num_connections,
 			      packets_forwarded,
 			      packets_not_forwarded,
+			      packets_policed,
 			      connection_create_requests,
 			      connection_create_collisions,
 			      connection_destroy_requests,
 			      connection_destroy_misses,
 			      connection_flushes,
 			      connection_match_hash_hits,
-			      connection_match_hash_reorders);
+			      active_count,
+			      jiffies_to_msecs(sync_lag),
+			      sync_records,
+			      sync_batches,
+			      sync_budget_overruns);
+	if (copy_to_user(buffer + *total_read, msg, CHAR_DEV_MSG_SIZE)) {
+		return false;
+	}
+
+	*length -= bytes_read;
+	*total_read += bytes_read;
+
+	ws->state++;
+	return true;
+}
+
+/*
+ * sfe_ipv4_debug_dev_read_hash()
+ *	Generate part of the XML output.
+ */
+static bool sfe_ipv4_debug_dev_read_hash(struct sfe_ipv4 *si, char *buffer, char *msg, size_t *length,
+					 int *total_read, struct sfe_ipv4_debug_xml_write_state *ws)
+{
+	struct sfe_ipv4_connection_hash *h;
+	struct sfe_ipv4_connection_match *cm;
+	u64 chain_lengths[SFE_IPV4_CONNECTION_HASH_HISTOGRAM_SIZE] = {0};
+	u64 hit_depths[SFE_IPV4_CONNECTION_HASH_HISTOGRAM_SIZE];
+	unsigned int num_connections;
+	unsigned int buckets;
+	u64 resizes;
+	int bytes_read;
+	int i;
+
+	/*
+	 * The chains can be walked without the lock just as the fast path does.
+	 */
+	rcu_read_lock();
+	h = rcu_dereference(si->hash);
+	buckets = 1 << h->shift;
+	for (i = 0; i < buckets; i++) {
+		unsigned int chain_length = 0;
+
+		hlist_for_each_entry_rcu(cm, &h->conn_match_hash[i], hnode) {
+			chain_length++;
+		}
+
+		chain_lengths[min_t(unsigned int, chain_length, SFE_IPV4_CONNECTION_HASH_HISTOGRAM_SIZE - 1)]++;
+	}
+	rcu_read_unlock();
+
+	spin_lock_bh(&si->lock);
+	sfe_ipv4_update_summary_stats(si);
+
+	num_connections = si->num_connections;
+	resizes = si->hash_resizes;
+	memcpy(hit_depths, si->connection_match_hash_hit_depths64, sizeof(hit_depths));
+	spin_unlock_bh(&si->lock);
+
+	bytes_read = snprintf(msg, CHAR_DEV_MSG_SIZE, "\t<hash "
+			      "buckets=\"%u\" connections=\"%u\" resizes=\"%llu\">\n"
+			      "\t\t<chain_lengths",
+			      buckets, num_connections, resizes);
+	for (i = 0; i < SFE_IPV4_CONNECTION_HASH_HISTOGRAM_SIZE; i++) {
+		bytes_read += snprintf(msg + bytes_read, CHAR_DEV_MSG_SIZE - bytes_read,
+				       " len%d=\"%llu\"", i, chain_lengths[i]);
+	}
+
+	bytes_read += snprintf(msg + bytes_read, CHAR_DEV_MSG_SIZE - bytes_read, " />\n\t\t<hit_depths");
+	for (i = 0; i < SFE_IPV4_CONNECTION_HASH_HISTOGRAM_SIZE; i++) {
+		bytes_read += snprintf(msg + bytes_read, CHAR_DEV_MSG_SIZE - bytes_read,
+				       " depth%d=\"%llu\"", i, hit_depths[i]);
+	}
+
+	bytes_read += snprintf(msg + bytes_read, CHAR_DEV_MSG_SIZE - bytes_read, " />\n\t</hash>\n");
 	if (copy_to_user(buffer + *total_read, msg, CHAR_DEV_MSG_SIZE)) {
 		return false;
 	}
@@ -3331,6 +5961,7 @@ static sfe_ipv4_debug_xml_write_method_t sfe_ipv4_debug_xml_write_methods[SFE_IP
 	sfe_ipv4_debug_dev_read_exceptions_exception,
 	sfe_ipv4_debug_dev_read_exceptions_end,
 	sfe_ipv4_debug_dev_read_stats,
+	sfe_ipv4_debug_dev_read_hash,
 	sfe_ipv4_debug_dev_read_end,
 };
 
@@ -3368,18 +5999,147 @@ static ssize_t sfe_ipv4_debug_dev_write(struct file *filp, const char *buffer, s
 
 	si->packets_forwarded64 = 0;
 	si->packets_not_forwarded64 = 0;
+	si->packets_policed64 = 0;
 	si->connection_create_requests64 = 0;
 	si->connection_create_collisions64 = 0;
 	si->connection_destroy_requests64 = 0;
 	si->connection_destroy_misses64 = 0;
 	si->connection_flushes64 = 0;
 	si->connection_match_hash_hits64 = 0;
-	si->connection_match_hash_reorders64 = 0;
+	memset(si->connection_match_hash_hit_depths64, 0, sizeof(si->connection_match_hash_hit_depths64));
 	spin_unlock_bh(&si->lock);
 
 	return length;
 }
 
+/*
+ * sfe_ipv4_export_conn_fill()
+ *	Fill in a binary export record for a connection.
+ *
+ * The lock must be held.
+ */
+static void sfe_ipv4_export_conn_fill(struct sfe_ipv4_connection *c, struct sfe_export_conn *rec, u64 now_jiffies)
+{
+	struct sfe_ipv4_connection_match *original_cm = c->original_match;
+	struct sfe_ipv4_connection_match *reply_cm = c->reply_match;
+
+	rec->src_ip[0] = c->src_ip;
+	rec->src_ip_xlate[0] = c->src_ip_xlate;
+	rec->dest_ip[0] = c->dest_ip;
+	rec->dest_ip_xlate[0] = c->dest_ip_xlate;
+	rec->src_port = c->src_port;
+	rec->src_port_xlate = c->src_port_xlate;
+	rec->dest_port = c->dest_port;
+	rec->dest_port_xlate = c->dest_port_xlate;
+	rec->src_ifindex = c->original_dev->ifindex;
+	rec->dest_ifindex = c->reply_dev->ifindex;
+	rec->src_priority = original_cm->priority;
+	rec->dest_priority = reply_cm->priority;
+	rec->mark = c->mark;
+	rec->protocol = c->protocol;
+	rec->src_dscp = original_cm->dscp >> SFE_IPV4_DSCP_SHIFT;
+	rec->dest_dscp = reply_cm->dscp >> SFE_IPV4_DSCP_SHIFT;
+	sfe_ipv4_connection_match_get_stats(original_cm, &rec->src_rx_packets, &rec->src_rx_bytes);
+	sfe_ipv4_connection_match_get_stats(reply_cm, &rec->dest_rx_packets, &rec->dest_rx_bytes);
+	rec->last_sync_ms = jiffies_to_msecs(now_jiffies - c->last_sync_jiffies);
+}
+
+/*
+ * sfe_ipv4_export_open()
+ *	Take a binary snapshot of the connection table.
+ *
+ * The whole table is copied out under a single hold of the lock, which is much
+ * cheaper than the XML output's walk and formatting per connection.
+ */
+static int sfe_ipv4_export_open(struct inode *inode, struct file *file)
+{
+	struct sfe_ipv4 *si = &__si;
+	struct sfe_ipv4_connection *c;
+	struct sfe_export_hdr *hdr;
+	struct sfe_export_conn *rec;
+	unsigned int max_records;
+	unsigned int num_records = 0;
+	u64 now_jiffies;
+
+	/*
+	 * The snapshot can't be allocated under the lock so leave some room for
+	 * connections created in the meantime.
+	 */
+	spin_lock_bh(&si->lock);
+	max_records = si->num_connections;
+	spin_unlock_bh(&si->lock);
+	max_records += (max_records >> 3) + 16;
+
+	hdr = vmalloc_user(sizeof(*hdr) + (size_t)max_records * sizeof(*rec));
+	if (!hdr) {
+		return -ENOMEM;
+	}
+
+	hdr->magic = SFE_EXPORT_MAGIC;
+	hdr->version = SFE_EXPORT_VERSION;
+	hdr->record_size = sizeof(*rec);
+	hdr->flags = 0;
+	rec = (struct sfe_export_conn *)(hdr + 1);
+
+	spin_lock_bh(&si->lock);
+	now_jiffies = get_jiffies_64();
+	for (c = si->all_connections_head; c; c = c->all_connections_next) {
+		if (num_records == max_records) {
+			hdr->flags |= SFE_EXPORT_FLAG_TRUNCATED;
+			break;
+		}
+
+		sfe_ipv4_export_conn_fill(c, rec++, now_jiffies);
+		num_records++;
+	}
+	spin_unlock_bh(&si->lock);
+
+	hdr->num_records = num_records;
+	file->private_data = hdr;
+
+	return 0;
+}
+
+/*
+ * sfe_ipv4_export_read()
+ *	Copy the connection table snapshot to userspace.
+ */
+static ssize_t sfe_ipv4_export_read(struct file *filp, char __user *buffer, size_t length, loff_t *offset)
+{
+	struct sfe_export_hdr *hdr = (struct sfe_export_hdr *)filp->private_data;
+
+	return simple_read_from_buffer(buffer, length, offset, hdr,
+				       sizeof(*hdr) + hdr->num_records * sizeof(struct sfe_export_conn));
+}
+
+/*
+ * sfe_ipv4_export_mmap()
+ *	Map the connection table snapshot into userspace.
+ */
+static int sfe_ipv4_export_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	return remap_vmalloc_range(vma, filp->private_data, vma->vm_pgoff);
+}
+
+/*
+ * sfe_ipv4_export_release()
+ */
+static int sfe_ipv4_export_release(struct inode *inode, struct file *file)
+{
+	vfree(file->private_data);
+	return 0;
+}
+
+/*
+ * File operations used for the binary export minor of the debug char device
+ */
+static const struct file_operations sfe_ipv4_export_fops = {
+	.read = sfe_ipv4_export_read,
+	.mmap = sfe_ipv4_export_mmap,
+	.llseek = default_llseek,
+	.release = sfe_ipv4_export_release
+};
+
 /*
  * sfe_ipv4_debug_dev_open()
  */
@@ -3387,6 +6147,11 @@ static int sfe_ipv4_debug_dev_open(struct inode *inode, struct file *file)
 {
 	struct sfe_ipv4_debug_xml_write_state *ws;
 
+	if (iminor(inode) == SFE_EXPORT_MINOR) {
+		replace_fops(file, &sfe_ipv4_export_fops);
+		return sfe_ipv4_export_open(inode, file);
+	}
+
 	ws = (struct sfe_ipv4_debug_xml_write_state *)file->private_data;
 	if (!ws) {
 		ws = kzalloc(sizeof(struct sfe_ipv4_debug_xml_write_state), GFP_KERNEL);
@@ -3503,17 +6268,61 @@ static const struct device_attribute sfe_ipv4_flow_cookie_attr =
 static int __init sfe_ipv4_init(void)
 {
 	struct sfe_ipv4 *si = &__si;
+	struct sfe_ipv4_connection_hash *hash;
 	int result = -1;
+	int cpu;
 
 	DEBUG_INFO("SFE IPv4 init\n");
 
+	/*
+	 * On 32-bit platforms the lookup key of a connection match entry has to
+	 * fit one 32-byte cache line, the rewrite data the next one and everything
+	 * else a simple forward needs the third. The key ends at 32 bytes with
+	 * flags, the rewrite data at 64 with xmit_dev and the QoS values at 96.
+	 */
+	BUILD_BUG_ON((sizeof(void *) == 4) &&
+		     (offsetofend(struct sfe_ipv4_connection_match, flags) > 32));
+	BUILD_BUG_ON((sizeof(void *) == 4) &&
+		     (offsetofend(struct sfe_ipv4_connection_match, xmit_dev) > 64));
+	BUILD_BUG_ON((sizeof(void *) == 4) &&
+		     (offsetofend(struct sfe_ipv4_connection_match, dscp) > 96));
+
+	/*
+	 * Allocate the per-CPU fast path statistics.
+	 */
+	si->stats = alloc_percpu(struct sfe_ipv4_stats);
+	if (!si->stats) {
+		DEBUG_ERROR("failed to allocate stats\n");
+		result = -ENOMEM;
+		goto exit0;
+	}
+
+	for_each_possible_cpu(cpu) {
+		u64_stats_init(&per_cpu_ptr(si->stats, cpu)->syncp);
+	}
+
+	/*
+	 * Allocate the connection hash tables.
+	 */
+	si->hash_min_shift = clamp_t(unsigned int, order_base_2(hash_size),
+				     SFE_IPV4_CONNECTION_HASH_SHIFT_MIN, SFE_IPV4_CONNECTION_HASH_SHIFT_MAX);
+	hash = sfe_ipv4_connection_hash_alloc(si->hash_min_shift);
+	if (!hash) {
+		DEBUG_ERROR("failed to allocate connection hash\n");
+		result = -ENOMEM;
+		goto exit1;
+	}
+
+	RCU_INIT_POINTER(si->hash, hash);
+	INIT_WORK(&si->hash_resize_work, sfe_ipv4_connection_hash_resize);
+
 	/*
 	 * Create sys/sfe_ipv4
 	 */
 	si->sys_sfe_ipv4 = kobject_create_and_add("sfe_ipv4", NULL);
 	if (!si->sys_sfe_ipv4) {
 		DEBUG_ERROR("failed to register sfe_ipv4\n");
-		goto exit1;
+		goto exit2;
 	}
 
 	/*
@@ -3522,14 +6331,26 @@ static int __init sfe_ipv4_init(void)
 	result = sysfs_create_file(si->sys_sfe_ipv4, &sfe_ipv4_debug_dev_attr.attr);
 	if (result) {
 		DEBUG_ERROR("failed to register debug dev file: %d\n", result);
-		goto exit2;
+		goto exit3;
+	}
+
+	result = sysfs_create_file(si->sys_sfe_ipv4, &sfe_ipv4_sync_budget_attr.attr);
+	if (result) {
+		DEBUG_ERROR("failed to register sync budget file: %d\n", result);
+		goto exit4;
+	}
+
+	result = sysfs_create_file(si->sys_sfe_ipv4, &sfe_ipv4_sync_lag_attr.attr);
+	if (result) {
+		DEBUG_ERROR("failed to register sync lag file: %d\n", result);
+		goto exit5;
 	}
 
 #ifdef CONFIG_NF_FLOW_COOKIE
 	result = sysfs_create_file(si->sys_sfe_ipv4, &sfe_ipv4_flow_cookie_attr.attr);
 	if (result) {
 		DEBUG_ERROR("failed to register flow cookie enable file: %d\n", result);
-		goto exit3;
+		goto exit6;
 	}
 #endif /* CONFIG_NF_FLOW_COOKIE */
 
@@ -3539,7 +6360,7 @@ static int __init sfe_ipv4_init(void)
 	result = register_chrdev(0, "sfe_ipv4", &sfe_ipv4_debug_dev_fops);
 	if (result < 0) {
 		DEBUG_ERROR("Failed to register chrdev: %d\n", result);
-		goto exit4;
+		goto exit7;
 	}
 
 	si->debug_dev = result;
@@ -3547,30 +6368,45 @@ static int __init sfe_ipv4_init(void)
 	/*
 	 * Create a timer to handle periodic statistics.
 	 */
+	si->sync_budget_us = SFE_IPV4_SYNC_BUDGET_US;
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(4, 15, 0))
 	timer_setup(&si->timer, sfe_ipv4_periodic_sync, 0);
 	si->timer.cust_data = (unsigned long)si;
 #else
 	setup_timer(&si->timer, sfe_ipv4_periodic_sync, (unsigned long)si);
 #endif /*KERNEL_VERSION(4, 15, 0)*/
-	mod_timer(&si->timer, jiffies + ((HZ + 99) / 100));
+	mod_timer(&si->timer, jiffies + SFE_IPV4_SYNC_PERIOD);
 
 	spin_lock_init(&si->lock);
+	spin_lock_init(&si->frag_lock);
+	si->frag_seed = get_random_u32();
 
 	return 0;
 
-exit4:
+exit7:
 #ifdef CONFIG_NF_FLOW_COOKIE
 	sysfs_remove_file(si->sys_sfe_ipv4, &sfe_ipv4_flow_cookie_attr.attr);
 
-exit3:
+exit6:
 #endif /* CONFIG_NF_FLOW_COOKIE */
+	sysfs_remove_file(si->sys_sfe_ipv4, &sfe_ipv4_sync_lag_attr.attr);
+
+exit5:
+	sysfs_remove_file(si->sys_sfe_ipv4, &sfe_ipv4_sync_budget_attr.attr);
+
+exit4:
 	sysfs_remove_file(si->sys_sfe_ipv4, &sfe_ipv4_debug_dev_attr.attr);
 
-exit2:
+exit3:
 	kobject_put(si->sys_sfe_ipv4);
 
+exit2:
+	sfe_ipv4_connection_hash_free(hash);
+
 exit1:
+	free_percpu(si->stats);
+
+exit0:
 	return result;
 }
 
@@ -3589,28 +6425,42 @@ static void __exit sfe_ipv4_exit(void)
 	sfe_ipv4_destroy_all_rules_for_dev(NULL);
 
 	del_timer_sync(&si->timer);
+	cancel_work_sync(&si->hash_resize_work);
+
+	/*
+	 * Wait for any connections still waiting on an RCU grace period to be freed.
+	 */
+	rcu_barrier();
 
 	unregister_chrdev(si->debug_dev, "sfe_ipv4");
 
 #ifdef CONFIG_NF_FLOW_COOKIE
 	sysfs_remove_file(si->sys_sfe_ipv4, &sfe_ipv4_flow_cookie_attr.attr);
 #endif /* CONFIG_NF_FLOW_COOKIE */
+	sysfs_remove_file(si->sys_sfe_ipv4, &sfe_ipv4_sync_lag_attr.attr);
+	sysfs_remove_file(si->sys_sfe_ipv4, &sfe_ipv4_sync_budget_attr.attr);
 	sysfs_remove_file(si->sys_sfe_ipv4, &sfe_ipv4_debug_dev_attr.attr);
 
 	kobject_put(si->sys_sfe_ipv4);
 
+	sfe_ipv4_connection_hash_free(rcu_dereference_protected(si->hash, 1));
+	free_percpu(si->stats);
 }
 
 module_init(sfe_ipv4_init)
 module_exit(sfe_ipv4_exit)
 
 EXPORT_SYMBOL(sfe_ipv4_recv);
+EXPORT_SYMBOL(sfe_ipv4_recv_list);
 EXPORT_SYMBOL(sfe_ipv4_create_rule);
 EXPORT_SYMBOL(sfe_ipv4_destroy_rule);
 EXPORT_SYMBOL(sfe_ipv4_destroy_all_rules_for_dev);
 EXPORT_SYMBOL(sfe_ipv4_register_sync_rule_callback);
+EXPORT_SYMBOL(sfe_ipv4_register_sync_rule_batch_callback);
 EXPORT_SYMBOL(sfe_ipv4_mark_rule);
 EXPORT_SYMBOL(sfe_ipv4_update_rule);
+EXPORT_SYMBOL(sfe_ipv4_create_mc_rule);
+EXPORT_SYMBOL(sfe_ipv4_update_mc_rule);
 #ifdef CONFIG_NF_FLOW_COOKIE
 EXPORT_SYMBOL(sfe_register_flow_cookie_cb);
 EXPORT_SYMBOL(sfe_unregister_flow_cookie_cb);
@@ -0,0 +1,115 @@
+/*
+ * sfe_police.h
+ *	Shortcut forwarding engine per-flow policer.
+ *
+ * Copyright (c) 2013-2016 The Linux Foundation. All rights reserved.
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+ * OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Accelerated packets never reach the qdiscs, so a connection that is
+ * policed there is policed again here, by a token bucket per direction.
+ *
+ * Tokens are kept as nanoseconds of transmission time at the policer's rate,
+ * as act_police does, so that the fast path needs no division.  A packet
+ * conforms if the bucket isn't empty and then takes its whole length from
+ * it, possibly leaving the bucket in debt.  That way GSO packets and packets
+ * larger than the burst still get through at the policer's rate.
+ *
+ * Must be included after sfe_cm.h.
+ */
+#ifndef __SFE_POLICE_H
+#define __SFE_POLICE_H
+
+#include <linux/ktime.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <net/sch_generic.h>
+
+/*
+ * struct sfe_police
+ *	Token bucket of one direction of a connection.
+ */
+struct sfe_police {
+	spinlock_t lock;		/* Protects the bucket, taken by the fast path only */
+	s64 tokens_ns;			/* Tokens in the bucket, negative when in debt */
+	s64 last_ns;			/* Time tokens were last taken from the bucket */
+	s64 burst_ns;			/* Size of the bucket */
+	struct psched_ratecfg rate;	/* Rate the bucket fills at */
+	u8 action;			/* SFE_POLICE_ACTION_... for packets that exceed the rate */
+	u8 dscp;			/* DSCP to remark exceeding packets with */
+};
+
+/*
+ * sfe_police_cfg_valid()
+ *	Check a policer configuration, DSCPs being 6 bits.
+ */
+static inline bool sfe_police_cfg_valid(const struct sfe_police_cfg *pc)
+{
+	if (!pc->rate) {
+		return true;
+	}
+
+	return (pc->action <= SFE_POLICE_ACTION_REMARK_DSCP) && (pc->dscp <= 0x3f);
+}
+
+/*
+ * sfe_police_alloc()
+ *	Allocate a policer with a full bucket.
+ */
+static inline struct sfe_police *sfe_police_alloc(const struct sfe_police_cfg *pc)
+{
+	struct tc_ratespec rs = { 0 };
+	struct sfe_police *p;
+
+	p = kmalloc(sizeof(struct sfe_police), GFP_ATOMIC);
+	if (!p) {
+		return NULL;
+	}
+
+	spin_lock_init(&p->lock);
+	psched_ratecfg_precompute(&p->rate, &rs, pc->rate);
+	p->burst_ns = (s64)psched_l2t_ns(&p->rate, pc->burst);
+	p->tokens_ns = p->burst_ns;
+	p->last_ns = ktime_get_ns();
+	p->action = pc->action;
+	p->dscp = pc->dscp;
+
+	return p;
+}
+
+/*
+ * sfe_police_conform()
+ *	Take len bytes' worth of tokens from a policer.
+ *
+ * Returns false, leaving the bucket alone, if the packet exceeds the rate.
+ */
+static inline bool sfe_police_conform(struct sfe_police *p, unsigned int len)
+{
+	s64 now = ktime_get_ns();
+	s64 tokens;
+
+	spin_lock(&p->lock);
+	tokens = min_t(s64, p->tokens_ns + (now - p->last_ns), p->burst_ns);
+	if (unlikely(tokens <= 0)) {
+		spin_unlock(&p->lock);
+		return false;
+	}
+
+	p->tokens_ns = tokens - (s64)psched_l2t_ns(&p->rate, len);
+	p->last_ns = now;
+	spin_unlock(&p->lock);
+
+	return true;
+}
+
+#endif /* __SFE_POLICE_H */
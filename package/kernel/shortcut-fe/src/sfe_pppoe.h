@@ -0,0 +1,99 @@
+/*
+ * sfe_pppoe.h
+ *	Shortcut forwarding engine PPPoE session helpers.
+ *
+ * Copyright (c) 2013-2016 The Linux Foundation. All rights reserved.
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+ * OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * PPPoE session frames are handed to the SFE with skb->protocol set to
+ * ETH_P_PPP_SES and skb->data pointing at the PPPoE header.  The IP code
+ * strips the PPPoE and PPP headers while it looks for a connection and puts
+ * them back if it doesn't forward the packet.
+ *
+ * Forwarded packets bypass the PPP device, so its counters don't see them.
+ * sfe_cm only creates PPPoE rules when built with SFE_SUPPORT_PPPOE, which
+ * needs the PPP channel helpers of the ECM kernel patch; otherwise only rules
+ * pushed by ECM carry a session.
+ */
+#ifndef __SFE_PPPOE_H
+#define __SFE_PPPOE_H
+
+#include <linux/if_pppox.h>
+#include <linux/ppp_defs.h>
+
+/*
+ * sfe_pppoe_session_proto()
+ *	Check a PPPoE session header and return the PPP protocol it carries.
+ *
+ * Returns 0 if the header isn't one we can forward.
+ */
+static inline __be16 sfe_pppoe_session_proto(struct sk_buff *skb)
+{
+	struct pppoe_hdr *ph;
+
+	if (unlikely(!pskb_may_pull(skb, PPPOE_SES_HLEN))) {
+		return 0;
+	}
+
+	ph = (struct pppoe_hdr *)skb->data;
+	if (unlikely((ph->ver != 1) || (ph->type != 1) || ph->code)) {
+		return 0;
+	}
+
+	if (unlikely((ntohs(ph->length) + sizeof(struct pppoe_hdr)) > skb->len)) {
+		return 0;
+	}
+
+	return *(__be16 *)(skb->data + sizeof(struct pppoe_hdr));
+}
+
+/*
+ * sfe_pppoe_session_match()
+ *	Check that a packet arrived on the PPPoE session a connection match expects.
+ *
+ * A session_id of 0 means the connection match expects plain IP packets.  For
+ * PPPoE packets the network header still points at the PPPoE header.
+ */
+static inline bool sfe_pppoe_session_match(struct sk_buff *skb, __be16 session_id)
+{
+	if (likely(skb->protocol != htons(ETH_P_PPP_SES))) {
+		return !session_id;
+	}
+
+	return pppoe_hdr(skb)->sid == session_id;
+}
+
+/*
+ * sfe_pppoe_add_header()
+ *	Push a PPPoE session header in front of an IP datagram of length len.
+ *
+ * The caller must have checked there's headroom.
+ */
+static inline void sfe_pppoe_add_header(struct sk_buff *skb, __be16 session_id, u16 ppp_proto, unsigned int len)
+{
+	struct pppoe_hdr *ph;
+
+	ph = (struct pppoe_hdr *)__skb_push(skb, PPPOE_SES_HLEN);
+	ph->ver = 1;
+	ph->type = 1;
+	ph->code = 0;
+	ph->sid = session_id;
+	ph->length = htons(len + sizeof(__be16));
+	*(__be16 *)(skb->data + sizeof(struct pppoe_hdr)) = htons(ppp_proto);
+
+	skb->protocol = htons(ETH_P_PPP_SES);
+	skb_reset_network_header(skb);
+}
+
+#endif /* __SFE_PPPOE_H */
@@ -0,0 +1,521 @@
+/*
+ * sfe_tun.h
+ *	Shortcut forwarding engine tunnel helpers.
+ *
+ * Copyright (c) 2013-2016 The Linux Foundation. All rights reserved.
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+ * OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Tunnelled packets are handed to the SFE on the device carrying the tunnel,
+ * before the Linux tunnel devices see them, and are looked up by the module
+ * handling the protocol they carry.  That module strips the outer headers
+ * while it looks for a connection and puts them back if it doesn't forward
+ * the packet.
+ *
+ * On transmit the outer headers are copied from a template built when the
+ * connection is created, so only the lengths, the IPv4 ID and checksum and
+ * any inherited fields are filled in per packet.
+ *
+ * Must be included after sfe_cm.h.
+ */
+#ifndef __SFE_TUN_H
+#define __SFE_TUN_H
+
+#include <linux/ip.h>
+#include <linux/ipv6.h>
+#include <linux/if_tunnel.h>
+#include <net/gre.h>
+#include <net/ipv6.h>
+#include <net/dsfield.h>
+#include <net/checksum.h>
+#include <linux/ip6_tunnel.h>
+
+/*
+ * Longest outer header we add: an IPv6 header with a tunnel encapsulation
+ * limit option.
+ */
+#define SFE_TUN_ENCAP_LIMIT_HLEN 8
+#define SFE_TUN_MAX_HLEN (sizeof(struct ipv6hdr) + SFE_TUN_ENCAP_LIMIT_HLEN)
+
+/*
+ * struct sfe_tun_info
+ *	Outer headers a packet was received with, or that a connection expects.
+ */
+struct sfe_tun_info {
+	u8 type;			/* SFE_TUN_TYPE_NONE if not tunnelled */
+	u8 hlen;			/* Length of the outer headers */
+	__be32 gre_key;			/* GRE key, 0 if none */
+	__be32 src_ip[4];		/* Outer source address, IPv4 in src_ip[0] */
+	__be32 dest_ip[4];		/* Outer destination address, IPv4 in dest_ip[0] */
+};
+
+/*
+ * struct sfe_tun_xmit
+ *	Outer headers to add to transmitted packets.
+ */
+struct sfe_tun_xmit {
+	u8 type;			/* SFE_TUN_TYPE_NONE if not tunnelled */
+	u8 flags;			/* SFE_TUN_FLAG_xxx */
+	u8 hlen;			/* Length of hdr */
+	atomic_t ip_id;			/* Last outer IPv4 ID used when DF is clear */
+	u8 hdr[SFE_TUN_MAX_HLEN];	/* Outer header template */
+};
+
+/*
+ * sfe_tun_l3_proto()
+ *	Find the protocol the SFE should look a packet up as.
+ *
+ * proto is the protocol of the packet's L3 header.  Tunnelled packets we
+ * handle are looked up as the protocol they carry; anything else as proto.
+ * Only packets without VLAN or PPPoE headers in the data are looked at.
+ */
+static inline __be16 sfe_tun_l3_proto(struct sk_buff *skb, __be16 proto)
+{
+	struct iphdr *iph;
+	struct ipv6hdr *ip6h;
+	struct gre_base_hdr *greh;
+	u8 nexthdr;
+
+	if (unlikely(skb->protocol != proto)) {
+		return proto;
+	}
+
+	if (likely(proto == htons(ETH_P_IP))) {
+		if (unlikely(!pskb_may_pull(skb, sizeof(struct iphdr)))) {
+			return proto;
+		}
+
+		iph = (struct iphdr *)skb->data;
+		if (likely((iph->protocol != IPPROTO_IPV6) && (iph->protocol != IPPROTO_GRE))) {
+			return proto;
+		}
+
+		if (iph->protocol == IPPROTO_IPV6) {
+			return htons(ETH_P_IPV6);
+		}
+
+		if (!pskb_may_pull(skb, sizeof(struct iphdr) + sizeof(struct gre_base_hdr))) {
+			return proto;
+		}
+
+		greh = (struct gre_base_hdr *)(skb->data + sizeof(struct iphdr));
+		if (greh->protocol == htons(ETH_P_IPV6)) {
+			return htons(ETH_P_IPV6);
+		}
+
+		return proto;
+	}
+
+	if (proto != htons(ETH_P_IPV6)) {
+		return proto;
+	}
+
+	if (unlikely(!pskb_may_pull(skb, sizeof(struct ipv6hdr)))) {
+		return proto;
+	}
+
+	ip6h = (struct ipv6hdr *)skb->data;
+	nexthdr = ip6h->nexthdr;
+	if (unlikely(nexthdr == NEXTHDR_DEST)) {
+		if (!pskb_may_pull(skb, sizeof(struct ipv6hdr) + SFE_TUN_ENCAP_LIMIT_HLEN)) {
+			return proto;
+		}
+
+		nexthdr = *(skb->data + sizeof(struct ipv6hdr));
+	}
+
+	if (nexthdr == IPPROTO_IPIP) {
+		return htons(ETH_P_IP);
+	}
+
+	return proto;
+}
+
+/*
+ * sfe_tun_restore()
+ *	Put back any outer headers that sfe_tun_decap() pulled.
+ */
+static inline void sfe_tun_restore(struct sk_buff *skb, struct sfe_tun_info *ti)
+{
+	if (likely(ti->type == SFE_TUN_TYPE_NONE)) {
+		return;
+	}
+
+	/*
+	 * Add the outer headers back into the checksum that skb_pull_rcsum()
+	 * took them out of.
+	 */
+	__skb_push(skb, ti->hlen);
+	if (skb->ip_summed == CHECKSUM_COMPLETE) {
+		skb->csum = csum_add(skb->csum, csum_partial(skb->data, ti->hlen, 0));
+	}
+
+	ti->type = SFE_TUN_TYPE_NONE;
+}
+
+/*
+ * sfe_tun_decap_ipv4()
+ *	Pull an outer IPv4 header, and any GRE header, carrying inner_proto.
+ */
+static inline bool sfe_tun_decap_ipv4(struct sk_buff *skb, __be16 inner_proto, struct sfe_tun_info *ti)
+{
+	struct iphdr *iph;
+	struct gre_base_hdr *greh;
+	unsigned int hlen = sizeof(struct iphdr);
+	unsigned int tot_len;
+	bool plain = (inner_proto == htons(ETH_P_IP));
+	__be32 gre_key = 0;
+	u8 type;
+
+	if (unlikely(!pskb_may_pull(skb, hlen))) {
+		return plain;
+	}
+
+	iph = (struct iphdr *)skb->data;
+	if ((iph->protocol == IPPROTO_IPV6) && !plain) {
+		type = SFE_TUN_TYPE_6RD;
+	} else if (unlikely(iph->protocol == IPPROTO_GRE)) {
+		type = SFE_TUN_TYPE_GRE;
+	} else {
+		return plain;
+	}
+
+	/*
+	 * Options and fragments are left to the Linux tunnel devices.
+	 */
+	if (unlikely((iph->version != 4) || (iph->ihl != 5) || (iph->frag_off & htons(IP_MF | IP_OFFSET)))) {
+		return plain;
+	}
+
+	/*
+	 * Only plain GRE, optionally with a key, is handled.
+	 */
+	if (type == SFE_TUN_TYPE_GRE) {
+		if (!pskb_may_pull(skb, hlen + sizeof(struct gre_base_hdr))) {
+			return plain;
+		}
+
+		greh = (struct gre_base_hdr *)(skb->data + hlen);
+		if ((greh->protocol != inner_proto) || (greh->flags & ~GRE_KEY)) {
+			return plain;
+		}
+
+		hlen += sizeof(struct gre_base_hdr);
+		if (greh->flags & GRE_KEY) {
+			if (!pskb_may_pull(skb, hlen + sizeof(__be32))) {
+				return plain;
+			}
+
+			gre_key = *(__be32 *)(skb->data + hlen);
+			hlen += sizeof(__be32);
+		}
+	}
+
+	/*
+	 * Drop any link layer padding so the inner datagram ends the packet.
+	 */
+	iph = (struct iphdr *)skb->data;
+	tot_len = ntohs(iph->tot_len);
+	if (unlikely((tot_len < hlen) || (tot_len > skb->len))) {
+		return plain;
+	}
+
+	if (unlikely(tot_len < skb->len) && pskb_trim_rcsum(skb, tot_len)) {
+		return plain;
+	}
+
+	/*
+	 * Trimming may have reallocated the header.
+	 */
+	iph = (struct iphdr *)skb->data;
+	ti->type = type;
+	ti->hlen = hlen;
+	ti->gre_key = gre_key;
+	ti->src_ip[0] = iph->saddr;
+	ti->dest_ip[0] = iph->daddr;
+
+	skb_reset_network_header(skb);
+	skb_pull_rcsum(skb, hlen);
+	return true;
+}
+
+/*
+ * sfe_tun_decap_ipv6()
+ *	Pull an outer IPv6 header, and any encapsulation limit option, carrying IPv4.
+ */
+static inline bool sfe_tun_decap_ipv6(struct sk_buff *skb, __be16 inner_proto, struct sfe_tun_info *ti)
+{
+	struct ipv6hdr *ip6h;
+	unsigned int hlen = sizeof(struct ipv6hdr);
+	unsigned int len;
+	u8 nexthdr;
+
+	if (inner_proto != htons(ETH_P_IP)) {
+		return true;
+	}
+
+	if (unlikely(!pskb_may_pull(skb, hlen))) {
+		return false;
+	}
+
+	nexthdr = ((struct ipv6hdr *)skb->data)->nexthdr;
+	if (nexthdr == NEXTHDR_DEST) {
+		if (!pskb_may_pull(skb, hlen + SFE_TUN_ENCAP_LIMIT_HLEN)) {
+			return false;
+		}
+
+		nexthdr = *(skb->data + hlen);
+		hlen += ipv6_optlen((struct ipv6_opt_hdr *)(skb->data + hlen));
+		if (!pskb_may_pull(skb, hlen)) {
+			return false;
+		}
+	}
+
+	ip6h = (struct ipv6hdr *)skb->data;
+	if (unlikely((ip6h->version != 6) || (nexthdr != IPPROTO_IPIP))) {
+		return false;
+	}
+
+	len = ntohs(ip6h->payload_len) + sizeof(struct ipv6hdr);
+	if (unlikely((len < hlen) || (len > skb->len))) {
+		return false;
+	}
+
+	if (unlikely(len < skb->len) && pskb_trim_rcsum(skb, len)) {
+		return false;
+	}
+
+	/*
+	 * Trimming may have reallocated the header.
+	 */
+	ip6h = (struct ipv6hdr *)skb->data;
+	ti->type = SFE_TUN_TYPE_IPIP6;
+	ti->hlen = hlen;
+	ti->gre_key = 0;
+	memcpy(ti->src_ip, &ip6h->saddr, sizeof(ti->src_ip));
+	memcpy(ti->dest_ip, &ip6h->daddr, sizeof(ti->dest_ip));
+
+	skb_reset_network_header(skb);
+	skb_pull_rcsum(skb, hlen);
+	return true;
+}
+
+/*
+ * sfe_tun_decap()
+ *	Pull the outer headers of a tunnelled packet carrying inner_proto.
+ *
+ * Packets that are already inner_proto, and aren't tunnelled, are left alone
+ * with ti->type set to SFE_TUN_TYPE_NONE.  The network header is left
+ * pointing at the outer header of tunnelled packets.
+ *
+ * Returns false, with the packet unchanged, if the packet is neither an
+ * inner_proto packet nor a tunnelled one we handle.
+ */
+static inline bool sfe_tun_decap(struct sk_buff *skb, __be16 inner_proto, struct sfe_tun_info *ti)
+{
+	ti->type = SFE_TUN_TYPE_NONE;
+
+	if (likely(skb->protocol == htons(ETH_P_IP))) {
+		return sfe_tun_decap_ipv4(skb, inner_proto, ti);
+	}
+
+	if (skb->protocol == htons(ETH_P_IPV6)) {
+		return sfe_tun_decap_ipv6(skb, inner_proto, ti);
+	}
+
+	return false;
+}
+
+/*
+ * sfe_tun_match()
+ *	Check that a packet arrived through the tunnel a connection match expects.
+ */
+static inline bool sfe_tun_match(const struct sfe_tun_info *ti, const struct sfe_tun_info *tm)
+{
+	if (likely(!(ti->type | tm->type))) {
+		return true;
+	}
+
+	if ((ti->type != tm->type) || (ti->gre_key != tm->gre_key)) {
+		return false;
+	}
+
+	if (ti->type != SFE_TUN_TYPE_IPIP6) {
+		return (ti->src_ip[0] == tm->src_ip[0]) && (ti->dest_ip[0] == tm->dest_ip[0]);
+	}
+
+	return !memcmp(ti->src_ip, tm->src_ip, sizeof(ti->src_ip)) &&
+	       !memcmp(ti->dest_ip, tm->dest_ip, sizeof(ti->dest_ip));
+}
+
+/*
+ * sfe_tun_valid()
+ *	Check that a tunnel can carry inner_proto.
+ */
+static inline bool sfe_tun_valid(const struct sfe_tun *tun, __be16 inner_proto)
+{
+	switch (tun->type) {
+	case SFE_TUN_TYPE_6RD:
+		return inner_proto == htons(ETH_P_IPV6);
+
+	case SFE_TUN_TYPE_IPIP6:
+		return inner_proto == htons(ETH_P_IP);
+
+	case SFE_TUN_TYPE_GRE:
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * sfe_tun_match_init()
+ *	Fill in the outer headers a connection match expects to receive.
+ */
+static inline void sfe_tun_match_init(struct sfe_tun_info *tm, const struct sfe_tun *tun)
+{
+	memset(tm, 0, sizeof(*tm));
+	tm->type = tun->type;
+
+	if (tun->type == SFE_TUN_TYPE_IPIP6) {
+		memcpy(tm->src_ip, tun->remote_ip.ip6[0].addr, sizeof(tm->src_ip));
+		memcpy(tm->dest_ip, tun->local_ip.ip6[0].addr, sizeof(tm->dest_ip));
+		return;
+	}
+
+	tm->src_ip[0] = tun->remote_ip.ip;
+	tm->dest_ip[0] = tun->local_ip.ip;
+	if (tun->flags & SFE_TUN_FLAG_GRE_KEY) {
+		tm->gre_key = tun->gre_key;
+	}
+}
+
+/*
+ * sfe_tun_xmit_init()
+ *	Build the outer header template of a connection match.
+ */
+static inline void sfe_tun_xmit_init(struct sfe_tun_xmit *tx, const struct sfe_tun *tun, __be16 inner_proto)
+{
+	struct iphdr *iph;
+	struct ipv6hdr *ip6h;
+	struct gre_base_hdr *greh;
+	u8 *opt;
+
+	memset(tx, 0, sizeof(*tx));
+	tx->type = tun->type;
+	tx->flags = tun->flags;
+
+	if (tun->type == SFE_TUN_TYPE_IPIP6) {
+		ip6h = (struct ipv6hdr *)tx->hdr;
+		ip6_flow_hdr(ip6h, tun->tos, tun->flowlabel);
+		ip6h->nexthdr = IPPROTO_IPIP;
+		ip6h->hop_limit = tun->ttl;
+		memcpy(&ip6h->saddr, tun->local_ip.ip6[0].addr, sizeof(ip6h->saddr));
+		memcpy(&ip6h->daddr, tun->remote_ip.ip6[0].addr, sizeof(ip6h->daddr));
+		tx->hlen = sizeof(struct ipv6hdr);
+
+		if (tun->flags & SFE_TUN_FLAG_ENCAP_LIMIT) {
+			/*
+			 * A destination options header holding the limit and a
+			 * PadN option, as ip6_tnl sends.
+			 */
+			ip6h->nexthdr = NEXTHDR_DEST;
+			opt = tx->hdr + tx->hlen;
+			opt[0] = IPPROTO_IPIP;
+			opt[1] = 0;
+			opt[2] = IPV6_TLV_TNL_ENCAP_LIMIT;
+			opt[3] = 1;
+			opt[4] = tun->encap_limit;
+			opt[5] = IPV6_TLV_PADN;
+			opt[6] = 1;
+			opt[7] = 0;
+			tx->hlen += SFE_TUN_ENCAP_LIMIT_HLEN;
+		}
+		return;
+	}
+
+	iph = (struct iphdr *)tx->hdr;
+	iph->version = 4;
+	iph->ihl = sizeof(struct iphdr) >> 2;
+	iph->tos = tun->tos;
+	iph->frag_off = (tun->flags & SFE_TUN_FLAG_DF) ? htons(IP_DF) : 0;
+	iph->ttl = tun->ttl;
+	iph->protocol = IPPROTO_IPV6;
+	iph->saddr = tun->local_ip.ip;
+	iph->daddr = tun->remote_ip.ip;
+	tx->hlen = sizeof(struct iphdr);
+
+	if (tun->type != SFE_TUN_TYPE_GRE) {
+		return;
+	}
+
+	iph->protocol = IPPROTO_GRE;
+	greh = (struct gre_base_hdr *)(tx->hdr + tx->hlen);
+	greh->protocol = inner_proto;
+	tx->hlen += sizeof(struct gre_base_hdr);
+
+	if (tun->flags & SFE_TUN_FLAG_GRE_KEY) {
+		greh->flags = GRE_KEY;
+		*(__be32 *)(tx->hdr + tx->hlen) = tun->gre_key;
+		tx->hlen += sizeof(__be32);
+	}
+}
+
+/*
+ * sfe_tun_add_header()
+ *	Push the outer headers in front of a datagram.
+ *
+ * dsfield and ttl are the inner datagram's, for tunnels that inherit them.
+ * The caller must have checked there's headroom.
+ */
+static inline void sfe_tun_add_header(struct sk_buff *skb, struct sfe_tun_xmit *tx, u8 dsfield, u8 ttl)
+{
+	struct iphdr *iph;
+	struct ipv6hdr *ip6h;
+	unsigned int len = skb->len;
+
+	__skb_push(skb, tx->hlen);
+	memcpy(skb->data, tx->hdr, tx->hlen);
+	skb_reset_network_header(skb);
+
+	if (tx->type == SFE_TUN_TYPE_IPIP6) {
+		ip6h = (struct ipv6hdr *)skb->data;
+		ip6h->payload_len = htons(tx->hlen - sizeof(struct ipv6hdr) + len);
+		if (unlikely(tx->flags & SFE_TUN_FLAG_INHERIT_TTL)) {
+			ip6h->hop_limit = ttl;
+		}
+		if (unlikely(tx->flags & SFE_TUN_FLAG_INHERIT_TOS)) {
+			ipv6_change_dsfield(ip6h, 0, dsfield);
+		}
+
+		skb->protocol = htons(ETH_P_IPV6);
+		return;
+	}
+
+	iph = (struct iphdr *)skb->data;
+	iph->tot_len = htons(tx->hlen + len);
+	if (unlikely(!(tx->flags & SFE_TUN_FLAG_DF))) {
+		iph->id = htons((u16)atomic_inc_return(&tx->ip_id));
+	}
+	if (unlikely(tx->flags & SFE_TUN_FLAG_INHERIT_TTL)) {
+		iph->ttl = ttl;
+	}
+	if (unlikely(tx->flags & SFE_TUN_FLAG_INHERIT_TOS)) {
+		iph->tos = dsfield;
+	}
+	iph->check = ip_fast_csum((u8 *)iph, iph->ihl);
+
+	skb->protocol = htons(ETH_P_IP);
+}
+
+#endif /* __SFE_TUN_H */
@@ -0,0 +1,226 @@
+/*
+ * sfe_vlan.h
+ *	Shortcut forwarding engine VLAN tag helpers.
+ *
+ * Copyright (c) 2013-2016 The Linux Foundation. All rights reserved.
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+ * OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * VLAN tagged packets are handed to the SFE on the real device, before the
+ * Linux VLAN devices see them.  By then the outer tag has normally been moved
+ * to skb->vlan_tci but any inner (QinQ) tag is still in the packet data.
+ *
+ * Tags are held as (TPID << 16) | TCI, outermost first.  Only the TPID and
+ * VLAN ID are compared when we match received packets.
+ *
+ * Must be included after sfe_cm.h.
+ */
+#ifndef __SFE_VLAN_H
+#define __SFE_VLAN_H
+
+#include <linux/if_vlan.h>
+#include "sfe_pppoe.h"
+
+#define SFE_VLAN_TAG_MATCH_MASK (0xffff0000 | VLAN_VID_MASK)
+
+/*
+ * struct sfe_vlan_info
+ *	VLAN tags a packet was received with.
+ */
+struct sfe_vlan_info {
+	u32 tag[SFE_MAX_VLAN_DEPTH];	/* Tags, outermost first */
+	u8 count;			/* Number of tags */
+	u8 pulled;			/* Number of tags pulled from the packet data */
+};
+
+/*
+ * sfe_vlan_restore()
+ *	Put back any VLAN headers that sfe_vlan_parse() pulled.
+ */
+static inline void sfe_vlan_restore(struct sk_buff *skb, struct sfe_vlan_info *vi)
+{
+	if (likely(!vi->pulled)) {
+		return;
+	}
+
+	__skb_push(skb, vi->pulled * VLAN_HLEN);
+	skb->protocol = htons(vi->tag[vi->count - vi->pulled] >> 16);
+	vi->pulled = 0;
+}
+
+/*
+ * sfe_vlan_parse()
+ *	Gather the VLAN tags a packet was received with.
+ *
+ * VLAN headers still in the packet data are pulled, leaving skb->protocol as
+ * the protocol they encapsulate.
+ *
+ * Returns false, with the packet unchanged, if the packet has more tags than
+ * we handle or is truncated.
+ */
+static inline bool sfe_vlan_parse(struct sk_buff *skb, struct sfe_vlan_info *vi)
+{
+	struct vlan_hdr *vh;
+
+	vi->count = 0;
+	vi->pulled = 0;
+
+	if (skb_vlan_tag_present(skb)) {
+		vi->tag[vi->count++] = (ntohs(skb->vlan_proto) << 16) | skb_vlan_tag_get(skb);
+	}
+
+	while (unlikely(eth_type_vlan(skb->protocol))) {
+		if (unlikely((vi->count == SFE_MAX_VLAN_DEPTH) || !pskb_may_pull(skb, VLAN_HLEN))) {
+			sfe_vlan_restore(skb, vi);
+			return false;
+		}
+
+		vh = (struct vlan_hdr *)skb->data;
+		vi->tag[vi->count++] = (ntohs(skb->protocol) << 16) | ntohs(vh->h_vlan_TCI);
+		vi->pulled++;
+		skb->protocol = vh->h_vlan_encapsulated_proto;
+		__skb_pull(skb, VLAN_HLEN);
+	}
+
+	return true;
+}
+
+/*
+ * sfe_vlan_match()
+ *	Check that a packet was received with the VLAN tags a connection match expects.
+ */
+static inline bool sfe_vlan_match(const struct sfe_vlan_info *vi, u8 count, const u32 *tag)
+{
+	unsigned int i;
+
+	if (likely(!(vi->count | count))) {
+		return true;
+	}
+
+	if (vi->count != count) {
+		return false;
+	}
+
+	for (i = 0; i < count; i++) {
+		if ((vi->tag[i] ^ tag[i]) & SFE_VLAN_TAG_MATCH_MASK) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * sfe_vlan_add_tags()
+ *	Push VLAN headers in front of the packet, innermost first.
+ *
+ * skb->protocol must be the protocol the tags encapsulate and is left as the
+ * TPID of the outer tag.  The caller must have checked there's headroom.
+ */
+static inline void sfe_vlan_add_tags(struct sk_buff *skb, u8 count, const u32 *tag)
+{
+	struct vlan_hdr *vh;
+
+	while (count--) {
+		vh = (struct vlan_hdr *)__skb_push(skb, VLAN_HLEN);
+		vh->h_vlan_TCI = htons(tag[count] & 0xffff);
+		vh->h_vlan_encapsulated_proto = skb->protocol;
+		skb->protocol = htons(tag[count] >> 16);
+	}
+}
+
+/*
+ * sfe_vlan_l3_proto()
+ *	Find the L3 protocol of a packet that still carries VLAN or PPPoE headers.
+ *
+ * Returns htons(ETH_P_IP), htons(ETH_P_IPV6) or the protocol of whatever else
+ * is encapsulated.  Returns 0 if the packet is truncated.
+ */
+static inline __be16 sfe_vlan_l3_proto(struct sk_buff *skb)
+{
+	unsigned int offset = 0;
+	__be16 proto = skb->protocol;
+	__be16 ppp_proto;
+
+	while (eth_type_vlan(proto)) {
+		if (unlikely(!pskb_may_pull(skb, offset + VLAN_HLEN))) {
+			return 0;
+		}
+
+		proto = ((struct vlan_hdr *)(skb->data + offset))->h_vlan_encapsulated_proto;
+		offset += VLAN_HLEN;
+	}
+
+	if (proto != htons(ETH_P_PPP_SES)) {
+		return proto;
+	}
+
+	if (unlikely(!pskb_may_pull(skb, offset + PPPOE_SES_HLEN))) {
+		return 0;
+	}
+
+	ppp_proto = *(__be16 *)(skb->data + offset + sizeof(struct pppoe_hdr));
+	if (ppp_proto == htons(PPP_IP)) {
+		return htons(ETH_P_IP);
+	}
+
+	if (ppp_proto == htons(PPP_IPV6)) {
+		return htons(ETH_P_IPV6);
+	}
+
+	return 0;
+}
+
+/*
+ * sfe_vlan_real_dev_get()
+ *	If dev is a VLAN device return the real device underneath it and the tags it adds.
+ *
+ * The tags, outermost first, include the priority bits the VLAN devices map
+ * priority to.  The real device is returned held and the caller must dev_put()
+ * it.  Returns NULL if dev isn't a VLAN device or has more VLAN devices
+ * stacked under it than we handle.
+ */
+static inline struct net_device *sfe_vlan_real_dev_get(struct net_device *dev, u32 priority, u32 *tag, u8 *count)
+{
+	u32 stacked_tag[SFE_MAX_VLAN_DEPTH];
+	unsigned int depth = 0;
+	unsigned int i;
+
+	while (is_vlan_dev(dev)) {
+		if (depth == SFE_MAX_VLAN_DEPTH) {
+			return NULL;
+		}
+
+		stacked_tag[depth++] = (ntohs(vlan_dev_vlan_proto(dev)) << 16) |
+				       vlan_dev_get_egress_qos_mask(dev, priority) |
+				       vlan_dev_vlan_id(dev);
+		dev = vlan_dev_real_dev(dev);
+	}
+
+	if (!depth) {
+		return NULL;
+	}
+
+	/*
+	 * We walked the devices from the top so the outermost tag came last.
+	 */
+	for (i = 0; i < depth; i++) {
+		tag[i] = stacked_tag[depth - 1 - i];
+	}
+	*count = depth;
+
+	dev_hold(dev);
+	return dev;
+}
+
+#endif /* __SFE_VLAN_H */
@@ -0,0 +1,128 @@
+#!/bin/sh
+#
+# Copyright (c) 2015 The Linux Foundation. All rights reserved.
+# Permission to use, copy, modify, and/or distribute this software for
+# any purpose with or without fee is hereby granted, provided that the
+# above copyright notice and this permission notice appear in all copies.
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+# WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+# ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+# OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+#
+
+#@sfe_drv_bench
+#@example : sfe_drv_bench.sh (drv|ecm|clean) [flows] [udp|tcp]
+#
+# Builds a lan namespace <-> router <-> wan namespace topology out of two veth
+# pairs, with the router side in the root namespace, then either:
+#	drv : pushes synthetic rules through the simulated sfe driver using the
+#	      shortcut-fe-drv-bench module (ECM must not be loaded).
+#	ecm : opens real UDP flows from lan to wan so they are conntrack
+#	      confirmed and accelerated by ECM, and measures how fast the
+#	      ECM SFE accelerated connection count follows.
+
+LAN_NS=sfe_bench_lan
+WAN_NS=sfe_bench_wan
+LAN_IP=192.168.250.2
+WAN_IP=192.168.251.2
+BENCH_SYS=/sys/sfe_drv_bench
+ECM_ACCEL=/sys/kernel/debug/ecm/ecm_sfe_ipv4/accelerated_count
+
+sfe_drv_bench_topology(){
+	ip netns list | grep -q "^$LAN_NS" && return
+
+	ip netns add $LAN_NS
+	ip netns add $WAN_NS
+	ip link add bench-lan type veth peer name bench-lan-ns
+	ip link add bench-wan type veth peer name bench-wan-ns
+	ip link set bench-lan-ns netns $LAN_NS
+	ip link set bench-wan-ns netns $WAN_NS
+
+	ip addr add 192.168.250.1/24 dev bench-lan
+	ip addr add 192.168.251.1/24 dev bench-wan
+	ip link set bench-lan up
+	ip link set bench-wan up
+
+	ip -n $LAN_NS addr add $LAN_IP/24 dev bench-lan-ns
+	ip -n $LAN_NS link set bench-lan-ns up
+	ip -n $LAN_NS route add default via 192.168.250.1
+	ip -n $WAN_NS addr add $WAN_IP/24 dev bench-wan-ns
+	ip -n $WAN_NS link set bench-wan-ns up
+	ip -n $WAN_NS route add default via 192.168.251.1
+
+	echo 1 > /proc/sys/net/ipv4/ip_forward
+}
+
+sfe_drv_bench_clean(){
+	ip link del bench-lan 2>/dev/null
+	ip link del bench-wan 2>/dev/null
+	ip netns del $LAN_NS 2>/dev/null
+	ip netns del $WAN_NS 2>/dev/null
+}
+
+sfe_drv_bench_drv(){
+	local proto=17
+
+	[ "$2" = "tcp" ] && proto=6
+	[ -d $BENCH_SYS ] || insmod shortcut-fe-drv-bench || return 1
+
+	echo "$(cat /sys/class/net/bench-lan/ifindex) $(cat /sys/class/net/bench-wan/ifindex) $1 $proto $LAN_IP $WAN_IP" > $BENCH_SYS/config
+	echo 1 > $BENCH_SYS/run
+	cat $BENCH_SYS/results
+}
+
+sfe_drv_bench_ecm(){
+	local flows=$1
+	local base start end now i
+
+	[ -e $ECM_ACCEL ] || {
+		echo "ECM SFE front end is not loaded"
+		return 1
+	}
+
+	ip netns exec $WAN_NS sh -c "while true; do nc -u -l -p 80 > /dev/null; done" &
+	base=$(cat $ECM_ACCEL)
+	start=$(date +%s)
+
+	i=0
+	while [ $i -lt $flows ]; do
+		ip netns exec $LAN_NS sh -c "echo x | nc -u -w 1 -p $((1024 + i)) $WAN_IP 80" &
+		i=$((i + 1))
+	done
+
+	while true; do
+		now=$(($(cat $ECM_ACCEL) - base))
+		[ $now -ge $flows ] && break
+		end=$(date +%s)
+		[ $((end - start)) -gt 60 ] && break
+		sleep 1
+	done
+	end=$(date +%s)
+
+	kill %1 2>/dev/null
+	echo "flows = $flows"
+	echo "accelerated = $now"
+	echo "seconds = $((end - start))"
+	[ $end -gt $start ] && echo "accel_cps = $((now / (end - start)))"
+}
+
+case "$1" in
+	drv)
+		sfe_drv_bench_topology
+		sfe_drv_bench_drv ${2:-10000} ${3:-udp}
+		;;
+	ecm)
+		sfe_drv_bench_topology
+		sfe_drv_bench_ecm ${2:-1000}
+		;;
+	clean)
+		rmmod shortcut-fe-drv-bench 2>/dev/null
+		sfe_drv_bench_clean
+		;;
+	*)
+		echo "usage: $0 (drv|ecm|clean) [flows] [udp|tcp]"
+		;;
+esac
@@ -21,24 +21,43 @@
 #include <net/addrconf.h>
 #include <linux/inetdevice.h>
 #include <net/pkt_sched.h>
+#include <linux/hashtable.h>
+#include <linux/jhash.h>
+#include <linux/if_arp.h>
+#include <net/route.h>
+#include <net/ip6_route.h>
+#include <net/ip_tunnels.h>
+#include <net/ip6_tunnel.h>
 
 #include "../shortcut-fe/sfe.h"
 #include "../shortcut-fe/sfe_cm.h"
+#include "../shortcut-fe/sfe_vlan.h"
+#include "../shortcut-fe/sfe_tun.h"
 #include "sfe_drv.h"
 
 typedef enum sfe_drv_exception {
 	SFE_DRV_EXCEPTION_IPV4_MSG_UNKNOW,
 	SFE_DRV_EXCEPTION_IPV6_MSG_UNKNOW,
 	SFE_DRV_EXCEPTION_CONNECTION_INVALID,
-	SFE_DRV_EXCEPTION_NOT_SUPPORT_BRIDGE,
 	SFE_DRV_EXCEPTION_TCP_INVALID,
 	SFE_DRV_EXCEPTION_PROTOCOL_NOT_SUPPORT,
 	SFE_DRV_EXCEPTION_SRC_DEV_NOT_L3,
 	SFE_DRV_EXCEPTION_DEST_DEV_NOT_L3,
+	SFE_DRV_EXCEPTION_SRC_DEV_NOT_BRIDGE_PORT,
+	SFE_DRV_EXCEPTION_DEST_DEV_NOT_BRIDGE_PORT,
 	SFE_DRV_EXCEPTION_CREATE_FAILED,
 	SFE_DRV_EXCEPTION_ENQUEUE_FAILED,
-	SFE_DRV_EXCEPTION_NOT_SUPPORT_6RD,
+	SFE_DRV_EXCEPTION_TUN6RD_MSG_INVALID,
 	SFE_DRV_EXCEPTION_NO_SYNC_CB,
+	SFE_DRV_EXCEPTION_BATCH_TOO_LARGE,
+	SFE_DRV_EXCEPTION_PPPOE_DEV_NOT_FOUND,
+	SFE_DRV_EXCEPTION_MC_NAT_NOT_SUPPORT,
+	SFE_DRV_EXCEPTION_MC_DEV_NOT_FOUND,
+	SFE_DRV_EXCEPTION_MC_IF_COUNT_INVALID,
+	SFE_DRV_EXCEPTION_TUN6RD_PEER_TABLE_FULL,
+	SFE_DRV_EXCEPTION_TUN_NOT_SUPPORT,
+	SFE_DRV_EXCEPTION_TUN_PEER_NOT_FOUND,
+	SFE_DRV_EXCEPTION_TUN_CARRIER_NOT_FOUND,
 	SFE_DRV_EXCEPTION_MAX
 } sfe_drv_exception_t;
 
@@ -46,19 +65,31 @@ static char *sfe_drv_exception_events_string[SFE_DRV_EXCEPTION_MAX] = {
 	"IPV4_MSG_UNKNOW",
 	"IPV6_MSG_UNKNOW",
 	"CONNECTION_INVALID",
-	"NOT_SUPPORT_BRIDGE",
 	"TCP_INVALID",
 	"PROTOCOL_NOT_SUPPORT",
 	"SRC_DEV_NOT_L3",
 	"DEST_DEV_NOT_L3",
+	"SRC_DEV_NOT_BRIDGE_PORT",
+	"DEST_DEV_NOT_BRIDGE_PORT",
 	"CREATE_FAILED",
 	"ENQUEUE_FAILED",
-	"NOT_SUPPORT_6RD",
-	"NO_SYNC_CB"
+	"TUN6RD_MSG_INVALID",
+	"NO_SYNC_CB",
+	"BATCH_TOO_LARGE",
+	"PPPOE_DEV_NOT_FOUND",
+	"MC_NAT_NOT_SUPPORT",
+	"MC_DEV_NOT_FOUND",
+	"MC_IF_COUNT_INVALID",
+	"TUN6RD_PEER_TABLE_FULL",
+	"TUN_NOT_SUPPORT",
+	"TUN_PEER_NOT_FOUND",
+	"TUN_CARRIER_NOT_FOUND"
 };
 
 #define SFE_MESSAGE_VERSION 0x1
 #define SFE_MAX_CONNECTION_NUM 65535
+#define SFE_DRV_TUN6RD_PEER_HASH_BITS 8
+#define SFE_DRV_TUN6RD_PEER_MAX 4096
 #define sfe_drv_ipv6_addr_copy(src, dest) memcpy((void *)(dest), (void *)(src), 16)
 #define sfe_drv_ipv4_stopped(CTX) (rcu_dereference((CTX)->ipv4_stats_sync_cb) == NULL)
 #define sfe_drv_ipv6_stopped(CTX) (rcu_dereference((CTX)->ipv6_stats_sync_cb) == NULL)
@@ -68,7 +99,9 @@ static char *sfe_drv_exception_events_string[SFE_DRV_EXCEPTION_MAX] = {
  */
 typedef enum {
 	SFE_DRV_MSG_TYPE_IPV4,
-	SFE_DRV_MSG_TYPE_IPV6
+	SFE_DRV_MSG_TYPE_IPV6,
+	SFE_DRV_MSG_TYPE_IPV4_BATCH,
+	SFE_DRV_MSG_TYPE_IPV6_BATCH
 } sfe_drv_msg_types_t;
 
 /*
@@ -86,6 +119,17 @@ struct sfe_drv_response_msg {
 	(!list_empty(ptr) ? list_first_entry(ptr, type, member) : NULL)
 #endif
 
+/*
+ * 6rd peer of a tunnel without a remote address, as learned by the connection
+ * manager from the packets Linux sends through it.
+ */
+struct sfe_drv_tun6rd_peer {
+	struct hlist_node node;		/* Hash chain linkage */
+	int ifindex;			/* Tunnel device */
+	struct in6_addr addr;		/* IPv6 address reached through the peer */
+	__be32 dest;			/* IPv4 address of the peer */
+};
+
 /*
  * sfe driver context instance, private for sfe driver
  */
@@ -98,7 +142,11 @@ struct sfe_drv_ctx_instance_internal {
 	struct kobject *sys_sfe_drv;	/* sysfs linkage */
 
 	struct list_head msg_queue;	/* response message queue*/
-	spinlock_t lock;		/* Lock to protect message queue */
+	spinlock_t lock;		/* Lock to protect message queue and 6rd peers */
+
+	DECLARE_HASHTABLE(tun6rd_peers, SFE_DRV_TUN6RD_PEER_HASH_BITS);
+					/* 6rd peers, hashed by tunnel and IPv6 address */
+	u32 tun6rd_peer_count;		/* Number of 6rd peers */
 
 	struct work_struct work;	/* work to send response message back to caller*/
 
@@ -188,6 +236,328 @@ inline bool sfe_drv_dev_is_layer_3_interface(struct net_device *dev, bool check_
 	return true;
 }
 
+/*
+ * sfe_drv_tun6rd_peer_hash()
+ *	Hash a 6rd peer's tunnel and IPv6 address.
+ */
+static inline u32 sfe_drv_tun6rd_peer_hash(int ifindex, const struct in6_addr *addr)
+{
+	return jhash2((const u32 *)addr->s6_addr32, 4, (u32)ifindex);
+}
+
+/*
+ * sfe_drv_tun6rd_peer_find()
+ *	Find the IPv4 address of the 6rd peer through which a tunnel reaches addr.
+ *
+ * Returns 0 if we don't know it.
+ */
+static __be32 sfe_drv_tun6rd_peer_find(int ifindex, const struct in6_addr *addr)
+{
+	struct sfe_drv_ctx_instance_internal *sfe_drv_ctx = &__sfe_drv_ctx;
+	struct sfe_drv_tun6rd_peer *peer;
+	__be32 dest = 0;
+
+	spin_lock_bh(&sfe_drv_ctx->lock);
+	hash_for_each_possible(sfe_drv_ctx->tun6rd_peers, peer, node, sfe_drv_tun6rd_peer_hash(ifindex, addr)) {
+		if ((peer->ifindex == ifindex) && ipv6_addr_equal(&peer->addr, addr)) {
+			dest = peer->dest;
+			break;
+		}
+	}
+	spin_unlock_bh(&sfe_drv_ctx->lock);
+
+	return dest;
+}
+
+/*
+ * sfe_drv_tun6rd_peer_flush()
+ *	Forget all the 6rd peers.
+ */
+static void sfe_drv_tun6rd_peer_flush(struct sfe_drv_ctx_instance_internal *sfe_drv_ctx)
+{
+	struct sfe_drv_tun6rd_peer *peer;
+	struct hlist_node *tmp;
+	int bkt;
+
+	spin_lock_bh(&sfe_drv_ctx->lock);
+	hash_for_each_safe(sfe_drv_ctx->tun6rd_peers, bkt, tmp, peer, node) {
+		hash_del(&peer->node);
+		kfree(peer);
+	}
+	sfe_drv_ctx->tun6rd_peer_count = 0;
+	spin_unlock_bh(&sfe_drv_ctx->lock);
+}
+
+/*
+ * sfe_drv_tun6rd_remote_get()
+ *	Find the IPv4 address of the peer through which a sit tunnel with no
+ *	remote address reaches addr.
+ *
+ * Like sit itself we try the 6rd prefix and then the IPv4-compatible next hop
+ * of the route, but first any peer the connection manager has told us about.
+ */
+static __be32 sfe_drv_tun6rd_remote_get(struct net_device *dev, struct ip_tunnel *t, const struct in6_addr *addr)
+{
+	struct rt6_info *rt6;
+	const struct in6_addr *nexthop;
+	__be32 dest;
+
+	dest = sfe_drv_tun6rd_peer_find(dev->ifindex, addr);
+	if (dest) {
+		return dest;
+	}
+
+#ifdef CONFIG_IPV6_SIT_6RD
+	if (ipv6_prefix_equal(addr, &t->ip6rd.prefix, t->ip6rd.prefixlen)) {
+		unsigned int pbw0, pbi0;
+		int pbi1;
+		u32 d;
+
+		pbw0 = t->ip6rd.prefixlen >> 5;
+		pbi0 = t->ip6rd.prefixlen & 0x1f;
+
+		d = t->ip6rd.relay_prefixlen < 32 ?
+			(ntohl(addr->s6_addr32[pbw0]) << pbi0) >> t->ip6rd.relay_prefixlen : 0;
+
+		pbi1 = pbi0 - t->ip6rd.relay_prefixlen;
+		if (pbi1 > 0) {
+			d |= ntohl(addr->s6_addr32[pbw0 + 1]) >> (32 - pbi1);
+		}
+
+		return t->ip6rd.relay_prefix | htonl(d);
+	}
+#endif
+
+	rt6 = rt6_lookup(dev_net(dev), addr, NULL, dev->ifindex, NULL, 0);
+	if (!rt6) {
+		return 0;
+	}
+
+	dest = 0;
+	nexthop = rt6_nexthop(rt6, (struct in6_addr *)addr);
+	if ((rt6->dst.dev == dev) && (ipv6_addr_type(nexthop) & IPV6_ADDR_COMPATv4)) {
+		dest = nexthop->s6_addr32[3];
+	}
+	ip6_rt_put(rt6);
+
+	return dest;
+}
+
+/*
+ * sfe_drv_dev_is_tun()
+ *	Check whether a device is a tunnel the SFE may add and remove the headers of.
+ */
+static inline bool sfe_drv_dev_is_tun(struct net_device *dev)
+{
+	return (dev->type == ARPHRD_SIT) || (dev->type == ARPHRD_TUNNEL6) || (dev->type == ARPHRD_IPGRE);
+}
+
+/*
+ * sfe_drv_tun_ip_params_get()
+ *	Describe a sit or GRE tunnel.
+ *
+ * addr is the IPv6 address of the host reached through a sit tunnel, which
+ * picks the peer of tunnels without a remote address, or NULL for rules that
+ * don't carry IPv6.
+ */
+static bool sfe_drv_tun_ip_params_get(struct net_device *dev, const struct in6_addr *addr, struct sfe_tun *tun)
+{
+	struct ip_tunnel *t = netdev_priv(dev);
+	const struct iphdr *tiph = &t->parms.iph;
+
+	if (t->collect_md) {
+		return false;
+	}
+
+	tun->local_ip.ip = tiph->saddr;
+	tun->remote_ip.ip = tiph->daddr;
+	tun->ttl = tiph->ttl;
+	tun->tos = tiph->tos & ~0x1;
+	if (tiph->frag_off & htons(IP_DF)) {
+		tun->flags |= SFE_TUN_FLAG_DF;
+	}
+	if (!tiph->ttl) {
+		tun->flags |= SFE_TUN_FLAG_INHERIT_TTL;
+	}
+	if (tiph->tos & 0x1) {
+		tun->flags |= SFE_TUN_FLAG_INHERIT_TOS;
+	}
+
+	if (dev->type == ARPHRD_SIT) {
+		if (!addr || (t->parms.i_flags & SIT_ISATAP)) {
+			return false;
+		}
+
+		tun->type = SFE_TUN_TYPE_6RD;
+		if (!tun->remote_ip.ip) {
+			tun->remote_ip.ip = sfe_drv_tun6rd_remote_get(dev, t, addr);
+		}
+		return true;
+	}
+
+	/*
+	 * Only plain GRE, optionally with the same key both ways.
+	 */
+	if ((t->parms.i_flags | t->parms.o_flags) & ~TUNNEL_KEY) {
+		return false;
+	}
+
+	if ((t->parms.i_flags ^ t->parms.o_flags) & TUNNEL_KEY) {
+		return false;
+	}
+
+	tun->type = SFE_TUN_TYPE_GRE;
+	if (t->parms.o_flags & TUNNEL_KEY) {
+		if (t->parms.i_key != t->parms.o_key) {
+			return false;
+		}
+
+		tun->gre_key = t->parms.o_key;
+		tun->flags |= SFE_TUN_FLAG_GRE_KEY;
+	}
+
+	return true;
+}
+
+/*
+ * sfe_drv_tun_ip6_params_get()
+ *	Describe an IPv4 in IPv6 tunnel.
+ */
+static bool sfe_drv_tun_ip6_params_get(struct net_device *dev, struct sfe_tun *tun)
+{
+	struct ip6_tnl *t = netdev_priv(dev);
+
+	if (t->parms.collect_md || ((t->parms.proto != IPPROTO_IPIP) && t->parms.proto)) {
+		return false;
+	}
+
+	if (ipv6_addr_any(&t->parms.laddr) || ipv6_addr_any(&t->parms.raddr)) {
+		return false;
+	}
+
+	tun->type = SFE_TUN_TYPE_IPIP6;
+	memcpy(tun->local_ip.ip6, &t->parms.laddr, sizeof(struct in6_addr));
+	memcpy(tun->remote_ip.ip6, &t->parms.raddr, sizeof(struct in6_addr));
+	tun->ttl = t->parms.hop_limit;
+	tun->tos = ip6_tclass(t->parms.flowinfo);
+	tun->flowlabel = t->parms.flowinfo & IPV6_FLOWLABEL_MASK;
+	if (t->parms.flags & IP6_TNL_F_USE_ORIG_TCLASS) {
+		tun->flags |= SFE_TUN_FLAG_INHERIT_TOS;
+	}
+	if (!(t->parms.flags & IP6_TNL_F_IGN_ENCAP_LIMIT)) {
+		tun->encap_limit = t->parms.encap_limit;
+		tun->flags |= SFE_TUN_FLAG_ENCAP_LIMIT;
+	}
+
+	return true;
+}
+
+/*
+ * sfe_drv_tun_carrier_get()
+ *	Describe a tunnel the SFE may add and remove the headers of and find the
+ *	device that carries its packets.
+ *
+ * addr is as for sfe_drv_tun_ip_params_get().  The carrier
+ * device is returned held, with the MAC address of the tunnel's next hop on it
+ * in mac, and the caller must dev_put() it.  Returns NULL if we can't handle
+ * the tunnel.
+ */
+static struct net_device *sfe_drv_tun_carrier_get(struct net_device *dev, const struct in6_addr *addr,
+						  struct sfe_tun *tun, u8 *mac)
+{
+	struct net_device *carrier_dev;
+	struct neighbour *neigh;
+	struct dst_entry *dst;
+	struct rtable *rt;
+	struct flowi4 fl4;
+	struct flowi6 fl6;
+
+	memset(tun, 0, sizeof(*tun));
+	if (dev->type == ARPHRD_TUNNEL6) {
+		if (!sfe_drv_tun_ip6_params_get(dev, tun)) {
+			sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_TUN_NOT_SUPPORT);
+			return NULL;
+		}
+
+		memset(&fl6, 0, sizeof(fl6));
+		fl6.flowi6_oif = ((struct ip6_tnl *)netdev_priv(dev))->parms.link;
+		fl6.flowi6_proto = IPPROTO_IPIP;
+		memcpy(&fl6.daddr, tun->remote_ip.ip6, sizeof(fl6.daddr));
+		memcpy(&fl6.saddr, tun->local_ip.ip6, sizeof(fl6.saddr));
+		dst = ip6_route_output(dev_net(dev), NULL, &fl6);
+		if (dst->error) {
+			dst_release(dst);
+			sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_TUN_CARRIER_NOT_FOUND);
+			return NULL;
+		}
+
+		if (!tun->ttl) {
+			tun->ttl = ip6_dst_hoplimit(dst);
+		}
+	} else {
+		if (!sfe_drv_tun_ip_params_get(dev, addr, tun)) {
+			sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_TUN_NOT_SUPPORT);
+			return NULL;
+		}
+
+		if (!tun->remote_ip.ip) {
+			sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_TUN_PEER_NOT_FOUND);
+			return NULL;
+		}
+
+		memset(&fl4, 0, sizeof(fl4));
+		fl4.flowi4_oif = ((struct ip_tunnel *)netdev_priv(dev))->parms.link;
+		fl4.flowi4_tos = RT_TOS(tun->tos);
+		fl4.flowi4_proto = (tun->type == SFE_TUN_TYPE_GRE) ? IPPROTO_GRE : IPPROTO_IPV6;
+		fl4.daddr = tun->remote_ip.ip;
+		fl4.saddr = tun->local_ip.ip;
+		rt = ip_route_output_key(dev_net(dev), &fl4);
+		if (IS_ERR(rt)) {
+			sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_TUN_CARRIER_NOT_FOUND);
+			return NULL;
+		}
+
+		/*
+		 * Tunnels with no local address use the one the route picks.
+		 */
+		tun->local_ip.ip = fl4.saddr;
+		dst = &rt->dst;
+	}
+
+	/*
+	 * The carrier must be a device we write L2 headers for and the tunnel
+	 * must not route back into another tunnel.
+	 */
+	carrier_dev = dst->dev;
+	if ((carrier_dev->flags & IFF_POINTOPOINT) || sfe_drv_dev_is_tun(carrier_dev)) {
+		dst_release(dst);
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_TUN_NOT_SUPPORT);
+		return NULL;
+	}
+
+	neigh = dst_neigh_lookup(dst, (tun->type == SFE_TUN_TYPE_IPIP6) ?
+				 (void *)tun->remote_ip.ip6 : (void *)&tun->remote_ip.ip);
+	if (!neigh) {
+		dst_release(dst);
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_TUN_CARRIER_NOT_FOUND);
+		return NULL;
+	}
+
+	if (!(neigh->nud_state & NUD_VALID) || (carrier_dev->addr_len != ETH_ALEN)) {
+		neigh_release(neigh);
+		dst_release(dst);
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_TUN_CARRIER_NOT_FOUND);
+		return NULL;
+	}
+
+	memcpy(mac, neigh->ha, ETH_ALEN);
+	dev_hold(carrier_dev);
+	neigh_release(neigh);
+	dst_release(dst);
+
+	return carrier_dev;
+}
+
 /*
  * sfe_drv_clean_response_msg_by_type()
  * 	clean response message in queue when ECM exit
@@ -249,6 +619,18 @@ static void sfe_drv_process_response_msg(struct work_struct *work)
 			if (callback) {
 				callback((void *)msg->cm.app_data, msg);
 			}
+		} else if ((response->type == SFE_DRV_MSG_TYPE_IPV4_BATCH) && !sfe_drv_ipv4_stopped(sfe_drv_ctx)) {
+			struct sfe_ipv4_batch_msg *msg = (struct sfe_ipv4_batch_msg *)response->msg;
+			sfe_ipv4_batch_msg_callback_t callback = (sfe_ipv4_batch_msg_callback_t)msg->cm.cb;
+			if (callback) {
+				callback((void *)msg->cm.app_data, msg);
+			}
+		} else if ((response->type == SFE_DRV_MSG_TYPE_IPV6_BATCH) && !sfe_drv_ipv6_stopped(sfe_drv_ctx)) {
+			struct sfe_ipv6_batch_msg *msg = (struct sfe_ipv6_batch_msg *)response->msg;
+			sfe_ipv6_batch_msg_callback_t callback = (sfe_ipv6_batch_msg_callback_t)msg->cm.cb;
+			if (callback) {
+				callback((void *)msg->cm.app_data, msg);
+			}
 		}
 
 		rcu_read_unlock();
@@ -283,6 +665,12 @@ sfe_drv_alloc_response_msg(sfe_drv_msg_types_t type, void *msg)
 	case SFE_DRV_MSG_TYPE_IPV6:
 		size = sizeof(struct sfe_ipv6_msg);
 		break;
+	case SFE_DRV_MSG_TYPE_IPV4_BATCH:
+		size = sizeof(struct sfe_ipv4_batch_msg);
+		break;
+	case SFE_DRV_MSG_TYPE_IPV6_BATCH:
+		size = sizeof(struct sfe_ipv6_batch_msg);
+		break;
 	default:
 		DEBUG_ERROR("message type %d not supported\n", type);
 		return NULL;
@@ -340,30 +728,17 @@ static void sfe_cmn_msg_init(struct sfe_cmn_msg *ncm, u16 if_num, u32 type,  u32
 }
 
 /*
- * sfe_drv_ipv4_stats_sync_callback()
- *	Synchronize a connection's state.
- *
- * @param sis SFE statistics from SFE core engine
+ * sfe_drv_ipv4_stats_sync_msg_init()
+ *	Build the connection stats sync message for a connection's state.
  */
-static void sfe_drv_ipv4_stats_sync_callback(struct sfe_connection_sync *sis)
+static void sfe_drv_ipv4_stats_sync_msg_init(struct sfe_ipv4_msg *msg, struct sfe_connection_sync *sis)
 {
-	struct sfe_drv_ctx_instance_internal *sfe_drv_ctx = &__sfe_drv_ctx;
-	struct sfe_ipv4_msg msg;
 	struct sfe_ipv4_conn_sync *sync_msg;
-	sfe_ipv4_msg_callback_t sync_cb;
 
-	rcu_read_lock();
-	sync_cb = rcu_dereference(sfe_drv_ctx->ipv4_stats_sync_cb);
-	if (!sync_cb) {
-		rcu_read_unlock();
-		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_NO_SYNC_CB);
-		return;
-	}
-
-	sync_msg = &msg.msg.conn_stats;
+	sync_msg = &msg->msg.conn_stats;
 
-	memset(&msg, 0, sizeof(msg));
-	sfe_cmn_msg_init(&msg.cm, 0, SFE_RX_CONN_STATS_SYNC_MSG,
+	memset(msg, 0, sizeof(*msg));
+	sfe_cmn_msg_init(&msg->cm, 0, SFE_RX_CONN_STATS_SYNC_MSG,
 			sizeof(struct sfe_ipv4_conn_sync), NULL, NULL);
 
 	/*
@@ -425,6 +800,29 @@ static void sfe_drv_ipv4_stats_sync_callback(struct sfe_connection_sync *sis)
 		sync_msg->reason = SFE_RULE_SYNC_REASON_STATS;
 		break;
 	}
+}
+
+/*
+ * sfe_drv_ipv4_stats_sync_callback()
+ *	Synchronize a connection's state.
+ *
+ * @param sis SFE statistics from SFE core engine
+ */
+static void sfe_drv_ipv4_stats_sync_callback(struct sfe_connection_sync *sis)
+{
+	struct sfe_drv_ctx_instance_internal *sfe_drv_ctx = &__sfe_drv_ctx;
+	struct sfe_ipv4_msg msg;
+	sfe_ipv4_msg_callback_t sync_cb;
+
+	rcu_read_lock();
+	sync_cb = rcu_dereference(sfe_drv_ctx->ipv4_stats_sync_cb);
+	if (!sync_cb) {
+		rcu_read_unlock();
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_NO_SYNC_CB);
+		return;
+	}
+
+	sfe_drv_ipv4_stats_sync_msg_init(&msg, sis);
 
 	/*
 	 * SFE sync calling is excuted in a timer, so we can redirect it to ECM directly.
@@ -434,43 +832,57 @@ static void sfe_drv_ipv4_stats_sync_callback(struct sfe_connection_sync *sis)
 }
 
 /*
- * sfe_drv_create_ipv4_rule_msg()
- * 	convert create message format from ecm to sfe
+ * sfe_drv_ipv4_stats_sync_batch_callback()
+ *	Synchronize the state of a batch of connections.
+ */
+static void sfe_drv_ipv4_stats_sync_batch_callback(struct sfe_connection_sync *sis, unsigned int count)
+{
+	struct sfe_drv_ctx_instance_internal *sfe_drv_ctx = &__sfe_drv_ctx;
+	struct sfe_ipv4_msg msg;
+	sfe_ipv4_msg_callback_t sync_cb;
+
+	rcu_read_lock();
+	sync_cb = rcu_dereference(sfe_drv_ctx->ipv4_stats_sync_cb);
+	if (!sync_cb) {
+		rcu_read_unlock();
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_NO_SYNC_CB);
+		return;
+	}
+
+	while (count--) {
+		sfe_drv_ipv4_stats_sync_msg_init(&msg, sis++);
+		sync_cb(sfe_drv_ctx->ipv4_stats_sync_data, &msg);
+	}
+	rcu_read_unlock();
+}
+
+/*
+ * sfe_drv_ipv4_create_rule()
+ * 	convert create message format from ecm to sfe and create the connection
  *
- * @param sfe_drv_ctx sfe driver context
  * @param msg The IPv4 message
  *
- * @return sfe_tx_status_t The status of the Tx operation
+ * @return enum sfe_cmn_response The response to return for this message
  */
-sfe_tx_status_t sfe_drv_create_ipv4_rule_msg(struct sfe_drv_ctx_instance_internal *sfe_drv_ctx, struct sfe_ipv4_msg *msg)
+static enum sfe_cmn_response sfe_drv_ipv4_create_rule(struct sfe_ipv4_msg *msg)
 {
 	struct sfe_connection_create sic;
 	struct net_device *src_dev = NULL;
 	struct net_device *dest_dev = NULL;
-	struct sfe_drv_response_msg *response;
+	struct net_device *src_pppoe_dev = NULL;
+	struct net_device *dest_pppoe_dev = NULL;
+	struct net_device *src_vlan_dev = NULL;
+	struct net_device *dest_vlan_dev = NULL;
+	struct net_device *src_tun_dev = NULL;
+	struct net_device *dest_tun_dev = NULL;
 	enum sfe_cmn_response ret;
 
-	response = sfe_drv_alloc_response_msg(SFE_DRV_MSG_TYPE_IPV4, msg);
-	if (!response) {
-		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_ENQUEUE_FAILED);
-		return SFE_TX_FAILURE_QUEUE;
-	}
-
 	if (!(msg->msg.rule_create.valid_flags & SFE_RULE_CREATE_CONN_VALID)) {
 		ret = SFE_CMN_RESPONSE_EMSG;
 		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_CONNECTION_INVALID);
 		goto failed_ret;
 	}
 
-	/*
-	 * not support bridged flows now
-	 */
-	if (msg->msg.rule_create.rule_flags & SFE_RULE_CREATE_FLAG_BRIDGE_FLOW) {
-		ret = SFE_CMN_RESPONSE_EINTERFACE;
-		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_NOT_SUPPORT_BRIDGE);
-		goto failed_ret;
-	}
-
 	sic.protocol = msg->msg.rule_create.tuple.protocol;
 	sic.src_ip.ip = msg->msg.rule_create.tuple.flow_ip;
 	sic.dest_ip.ip = msg->msg.rule_create.tuple.return_ip;
@@ -521,37 +933,119 @@ sfe_tx_status_t sfe_drv_create_ipv4_rule_msg(struct sfe_drv_ctx_instance_interna
 	memset(sic.dest_mac, 0, ETH_ALEN);
 	memcpy(sic.dest_mac_xlate, msg->msg.rule_create.conn_rule.return_mac, ETH_ALEN);
 
-	/*
-	 * Does our input device support IP processing?
-	 */
 	src_dev = dev_get_by_index(&init_net, msg->msg.rule_create.conn_rule.flow_top_interface_num);
-	if (!src_dev || !sfe_drv_dev_is_layer_3_interface(src_dev, true)) {
-		ret = SFE_CMN_RESPONSE_EINTERFACE;
-		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_SRC_DEV_NOT_L3);
-		goto failed_ret;
-	}
-
-	/*
-	 * Does our output device support IP processing?
-	 */
 	dest_dev = dev_get_by_index(&init_net, msg->msg.rule_create.conn_rule.return_top_interface_num);
-	if (!dest_dev || !sfe_drv_dev_is_layer_3_interface(dest_dev, true)) {
-		ret = SFE_CMN_RESPONSE_EINTERFACE;
-		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_DEST_DEV_NOT_L3);
-		goto failed_ret;
-	}
-
-	sic.src_dev = src_dev;
-	sic.dest_dev = dest_dev;
 
-	sic.src_mtu = msg->msg.rule_create.conn_rule.flow_mtu;
-	sic.dest_mtu = msg->msg.rule_create.conn_rule.return_mtu;
+	if (msg->msg.rule_create.rule_flags & SFE_RULE_CREATE_FLAG_BRIDGE_FLOW) {
+		/*
+		 * Bridged flows go directly between two ports of a bridge.
+		 */
+		if (!src_dev || !netif_is_bridge_port(src_dev)) {
+			ret = SFE_CMN_RESPONSE_EINTERFACE;
+			sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_SRC_DEV_NOT_BRIDGE_PORT);
+			goto failed_ret;
+		}
 
-	if (msg->msg.rule_create.valid_flags & SFE_RULE_CREATE_QOS_VALID) {
-		sic.src_priority = msg->msg.rule_create.qos_rule.flow_qos_tag;
-		sic.dest_priority = msg->msg.rule_create.qos_rule.return_qos_tag;
-		sic.flags |= SFE_CREATE_FLAG_REMARK_PRIORITY;
-	}
+		if (!dest_dev || !netif_is_bridge_port(dest_dev)) {
+			ret = SFE_CMN_RESPONSE_EINTERFACE;
+			sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_DEST_DEV_NOT_BRIDGE_PORT);
+			goto failed_ret;
+		}
+
+		sic.flags |= SFE_CREATE_FLAG_BRIDGE_FLOW;
+	} else {
+		/*
+		 * Does our input device support IP processing?
+		 */
+		if (!src_dev || (!sfe_drv_dev_is_tun(src_dev) && !sfe_drv_dev_is_layer_3_interface(src_dev, true))) {
+			ret = SFE_CMN_RESPONSE_EINTERFACE;
+			sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_SRC_DEV_NOT_L3);
+			goto failed_ret;
+		}
+
+		/*
+		 * Does our output device support IP processing?
+		 */
+		if (!dest_dev || (!sfe_drv_dev_is_tun(dest_dev) && !sfe_drv_dev_is_layer_3_interface(dest_dev, true))) {
+			ret = SFE_CMN_RESPONSE_EINTERFACE;
+			sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_DEST_DEV_NOT_L3);
+			goto failed_ret;
+		}
+	}
+
+	sic.src_dev = src_dev;
+	sic.dest_dev = dest_dev;
+
+	/*
+	 * The SFE adds and removes PPPoE headers itself so for a PPPoE session it
+	 * wants the device carrying the session, which is the flow or return
+	 * interface rather than the top interface.
+	 */
+	if (msg->msg.rule_create.valid_flags & SFE_RULE_CREATE_PPPOE_VALID) {
+		if (msg->msg.rule_create.pppoe_rule.flow_pppoe_session_id) {
+			src_pppoe_dev = dev_get_by_index(&init_net, msg->msg.rule_create.conn_rule.flow_interface_num);
+			if (!src_pppoe_dev) {
+				ret = SFE_CMN_RESPONSE_EINTERFACE;
+				sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_PPPOE_DEV_NOT_FOUND);
+				goto failed_ret;
+			}
+
+			sic.src_dev = src_pppoe_dev;
+			sic.src_pppoe_session_id = msg->msg.rule_create.pppoe_rule.flow_pppoe_session_id;
+			memcpy(sic.src_pppoe_remote_mac, msg->msg.rule_create.pppoe_rule.flow_pppoe_remote_mac, ETH_ALEN);
+			sic.flags |= SFE_CREATE_FLAG_SRC_PPPOE;
+		}
+
+		if (msg->msg.rule_create.pppoe_rule.return_pppoe_session_id) {
+			dest_pppoe_dev = dev_get_by_index(&init_net, msg->msg.rule_create.conn_rule.return_interface_num);
+			if (!dest_pppoe_dev) {
+				ret = SFE_CMN_RESPONSE_EINTERFACE;
+				sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_PPPOE_DEV_NOT_FOUND);
+				goto failed_ret;
+			}
+
+			sic.dest_dev = dest_pppoe_dev;
+			sic.dest_pppoe_session_id = msg->msg.rule_create.pppoe_rule.return_pppoe_session_id;
+			memcpy(sic.dest_pppoe_remote_mac, msg->msg.rule_create.pppoe_rule.return_pppoe_remote_mac, ETH_ALEN);
+			sic.flags |= SFE_CREATE_FLAG_DEST_PPPOE;
+		}
+	}
+
+	/*
+	 * Tunnel headers are added and removed by the SFE as well, so for a tunnel
+	 * it wants the device carrying the tunnel's packets and the MAC address of
+	 * the tunnel's next hop on it.
+	 */
+	if (sfe_drv_dev_is_tun(sic.src_dev)) {
+		src_tun_dev = sfe_drv_tun_carrier_get(sic.src_dev, NULL, &sic.src_tun, sic.src_mac);
+		if (!src_tun_dev) {
+			ret = SFE_CMN_RESPONSE_EINTERFACE;
+			goto failed_ret;
+		}
+
+		sic.src_dev = src_tun_dev;
+		sic.flags |= SFE_CREATE_FLAG_SRC_TUN;
+	}
+
+	if (sfe_drv_dev_is_tun(sic.dest_dev)) {
+		dest_tun_dev = sfe_drv_tun_carrier_get(sic.dest_dev, NULL, &sic.dest_tun, sic.dest_mac_xlate);
+		if (!dest_tun_dev) {
+			ret = SFE_CMN_RESPONSE_EINTERFACE;
+			goto failed_ret;
+		}
+
+		sic.dest_dev = dest_tun_dev;
+		sic.flags |= SFE_CREATE_FLAG_DEST_TUN;
+	}
+
+	sic.src_mtu = msg->msg.rule_create.conn_rule.flow_mtu;
+	sic.dest_mtu = msg->msg.rule_create.conn_rule.return_mtu;
+
+	if (msg->msg.rule_create.valid_flags & SFE_RULE_CREATE_QOS_VALID) {
+		sic.src_priority = msg->msg.rule_create.qos_rule.flow_qos_tag;
+		sic.dest_priority = msg->msg.rule_create.qos_rule.return_qos_tag;
+		sic.flags |= SFE_CREATE_FLAG_REMARK_PRIORITY;
+	}
 
 	if (msg->msg.rule_create.valid_flags & SFE_RULE_CREATE_DSCP_MARKING_VALID) {
 		sic.src_dscp = msg->msg.rule_create.dscp_rule.flow_dscp;
@@ -559,6 +1053,40 @@ sfe_tx_status_t sfe_drv_create_ipv4_rule_msg(struct sfe_drv_ctx_instance_interna
 		sic.flags |= SFE_CREATE_FLAG_REMARK_DSCP;
 	}
 
+	memset(&sic.src_police, 0, sizeof(sic.src_police));
+	memset(&sic.dest_police, 0, sizeof(sic.dest_police));
+	if (msg->msg.rule_create.valid_flags & SFE_RULE_CREATE_POLICE_VALID) {
+		sic.src_police.rate = msg->msg.rule_create.police_rule.flow_rate;
+		sic.src_police.burst = msg->msg.rule_create.police_rule.flow_burst;
+		sic.src_police.action = msg->msg.rule_create.police_rule.flow_action;
+		sic.src_police.dscp = msg->msg.rule_create.police_rule.flow_dscp;
+		sic.dest_police.rate = msg->msg.rule_create.police_rule.return_rate;
+		sic.dest_police.burst = msg->msg.rule_create.police_rule.return_burst;
+		sic.dest_police.action = msg->msg.rule_create.police_rule.return_action;
+		sic.dest_police.dscp = msg->msg.rule_create.police_rule.return_dscp;
+	}
+
+	/*
+	 * The SFE adds and removes VLAN tags itself too so it wants the real device
+	 * underneath any VLAN devices.  The priority bits of the tags follow the
+	 * priority of the direction they're added in.
+	 */
+	sic.src_vlan_count = 0;
+	src_vlan_dev = sfe_vlan_real_dev_get(sic.src_dev,
+					     (sic.flags & SFE_CREATE_FLAG_REMARK_PRIORITY) ? sic.dest_priority : 0,
+					     sic.src_vlan_tag, &sic.src_vlan_count);
+	if (src_vlan_dev) {
+		sic.src_dev = src_vlan_dev;
+	}
+
+	sic.dest_vlan_count = 0;
+	dest_vlan_dev = sfe_vlan_real_dev_get(sic.dest_dev,
+					      (sic.flags & SFE_CREATE_FLAG_REMARK_PRIORITY) ? sic.src_priority : 0,
+					      sic.dest_vlan_tag, &sic.dest_vlan_count);
+	if (dest_vlan_dev) {
+		sic.dest_dev = dest_vlan_dev;
+	}
+
 #ifdef CONFIG_XFRM
 	if (msg->msg.rule_create.valid_flags & SFE_RULE_CREATE_DIRECTION_VALID) {
 		sic.original_accel = msg->msg.rule_create.direction_rule.flow_accel;
@@ -589,15 +1117,84 @@ failed_ret:
 		dev_put(dest_dev);
 	}
 
+	if (src_pppoe_dev) {
+		dev_put(src_pppoe_dev);
+	}
+
+	if (dest_pppoe_dev) {
+		dev_put(dest_pppoe_dev);
+	}
+
+	if (src_vlan_dev) {
+		dev_put(src_vlan_dev);
+	}
+
+	if (dest_vlan_dev) {
+		dev_put(dest_vlan_dev);
+	}
+
+	if (src_tun_dev) {
+		dev_put(src_tun_dev);
+	}
+
+	if (dest_tun_dev) {
+		dev_put(dest_tun_dev);
+	}
+
+	return ret;
+}
+
+/*
+ * sfe_drv_create_ipv4_rule_msg()
+ * 	convert create message format from ecm to sfe
+ *
+ * @param sfe_drv_ctx sfe driver context
+ * @param msg The IPv4 message
+ *
+ * @return sfe_tx_status_t The status of the Tx operation
+ */
+sfe_tx_status_t sfe_drv_create_ipv4_rule_msg(struct sfe_drv_ctx_instance_internal *sfe_drv_ctx, struct sfe_ipv4_msg *msg)
+{
+	struct sfe_drv_response_msg *response;
+
+	response = sfe_drv_alloc_response_msg(SFE_DRV_MSG_TYPE_IPV4, msg);
+	if (!response) {
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_ENQUEUE_FAILED);
+		return SFE_TX_FAILURE_QUEUE;
+	}
+
 	/*
 	 * try to queue response message
 	 */
-	((struct sfe_ipv4_msg *)response->msg)->cm.response = msg->cm.response = ret;
+	((struct sfe_ipv4_msg *)response->msg)->cm.response = msg->cm.response = sfe_drv_ipv4_create_rule(msg);
 	sfe_drv_enqueue_msg(sfe_drv_ctx, response);
 
 	return SFE_TX_SUCCESS;
 }
 
+/*
+ * sfe_drv_ipv4_destroy_rule()
+ * 	convert destroy message format from ecm to sfe and destroy the connection
+ *
+ * @param msg The IPv4 message
+ *
+ * @return enum sfe_cmn_response The response to return for this message
+ */
+static enum sfe_cmn_response sfe_drv_ipv4_destroy_rule(struct sfe_ipv4_msg *msg)
+{
+	struct sfe_connection_destroy sid;
+
+	sid.protocol = msg->msg.rule_destroy.tuple.protocol;
+	sid.src_ip.ip = msg->msg.rule_destroy.tuple.flow_ip;
+	sid.dest_ip.ip = msg->msg.rule_destroy.tuple.return_ip;
+	sid.src_port = msg->msg.rule_destroy.tuple.flow_ident;
+	sid.dest_port = msg->msg.rule_destroy.tuple.return_ident;
+
+	sfe_ipv4_destroy_rule(&sid);
+
+	return SFE_CMN_RESPONSE_ACK;
+}
+
 /*
  * sfe_drv_destroy_ipv4_rule_msg()
  * 	convert destroy message format from ecm to sfe
@@ -609,7 +1206,6 @@ failed_ret:
  */
 sfe_tx_status_t sfe_drv_destroy_ipv4_rule_msg(struct sfe_drv_ctx_instance_internal *sfe_drv_ctx, struct sfe_ipv4_msg *msg)
 {
-	struct sfe_connection_destroy sid;
 	struct sfe_drv_response_msg *response;
 
 	response = sfe_drv_alloc_response_msg(SFE_DRV_MSG_TYPE_IPV4, msg);
@@ -618,18 +1214,271 @@ sfe_tx_status_t sfe_drv_destroy_ipv4_rule_msg(struct sfe_drv_ctx_instance_intern
 		return SFE_TX_FAILURE_QUEUE;
 	}
 
-	sid.protocol = msg->msg.rule_destroy.tuple.protocol;
-	sid.src_ip.ip = msg->msg.rule_destroy.tuple.flow_ip;
-	sid.dest_ip.ip = msg->msg.rule_destroy.tuple.return_ip;
-	sid.src_port = msg->msg.rule_destroy.tuple.flow_ident;
-	sid.dest_port = msg->msg.rule_destroy.tuple.return_ident;
+	/*
+	 * try to queue response message
+	 */
+	((struct sfe_ipv4_msg *)response->msg)->cm.response = msg->cm.response = sfe_drv_ipv4_destroy_rule(msg);
+	sfe_drv_enqueue_msg(sfe_drv_ctx, response);
 
-	sfe_ipv4_destroy_rule(&sid);
+	return SFE_TX_SUCCESS;
+}
+
+/*
+ * sfe_drv_mc_vlan_tags_get()
+ * 	copy the configured VLAN tags of a multicast message, outermost first
+ *
+ * @param tag The tags to fill in
+ * @param msg_tag The message tags, SFE_VLAN_ID_NOT_CONFIGURED if unused
+ *
+ * @return u8 The number of tags
+ */
+static u8 sfe_drv_mc_vlan_tags_get(u32 *tag, const u32 *msg_tag)
+{
+	u8 count = 0;
+	unsigned int i;
+
+	for (i = 0; i < MAX_VLAN_DEPTH; i++) {
+		if ((msg_tag[i] & VLAN_VID_MASK) == SFE_VLAN_ID_NOT_CONFIGURED) {
+			continue;
+		}
+
+		tag[count++] = msg_tag[i];
+	}
+
+	return count;
+}
+
+/*
+ * sfe_drv_mc_xmit_if_init()
+ * 	convert a multicast egress interface rule from ecm to sfe format
+ *
+ * Multicast rules name the device the SFE sends on, under any VLAN devices,
+ * and carry the VLAN tags themselves since there is no top interface per
+ * egress interface to look them up from.  The device is returned held in xif.
+ *
+ * @param xif The sfe egress interface
+ * @param ifr The ecm egress interface rule
+ *
+ * @return enum sfe_cmn_response The response to return for this rule
+ */
+static enum sfe_cmn_response sfe_drv_mc_xmit_if_init(struct sfe_mc_xmit_if *xif, struct sfe_mc_if_rule *ifr)
+{
+	/*
+	 * The SFE never translates multicast packets.
+	 */
+	if (ifr->valid_flags & SFE_RULE_CREATE_MC_NAT_VALID) {
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_MC_NAT_NOT_SUPPORT);
+		return SFE_CMN_RESPONSE_EMSG;
+	}
+
+	xif->dev = dev_get_by_index(&init_net, ifr->if_num);
+	if (!xif->dev) {
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_MC_DEV_NOT_FOUND);
+		return SFE_CMN_RESPONSE_EINTERFACE;
+	}
+
+	xif->flags = 0;
+	if (ifr->rule_flags & SFE_RULE_CREATE_FLAG_BRIDGE_FLOW) {
+		xif->flags |= SFE_MC_XMIT_IF_FLAG_BRIDGE_FLOW;
+	}
+
+	if (ifr->rule_flags & SFE_RULE_CREATE_FLAG_MC_JOIN) {
+		xif->flags |= SFE_MC_XMIT_IF_FLAG_JOIN;
+	}
+
+	if (ifr->rule_flags & SFE_RULE_CREATE_FLAG_MC_LEAVE) {
+		xif->flags |= SFE_MC_XMIT_IF_FLAG_LEAVE;
+	}
+
+	xif->mtu = ifr->if_mtu;
+	memcpy(xif->src_mac, ifr->if_mac, ETH_ALEN);
+
+	if ((ifr->valid_flags & SFE_RULE_CREATE_PPPOE_VALID) && ifr->pppoe_session_id) {
+		xif->pppoe_session_id = ifr->pppoe_session_id;
+		memcpy(xif->pppoe_remote_mac, ifr->pppoe_remote_mac, ETH_ALEN);
+	}
+
+	if (ifr->valid_flags & SFE_RULE_CREATE_VLAN_VALID) {
+		xif->vlan_count = sfe_drv_mc_vlan_tags_get(xif->vlan_tag, ifr->egress_vlan_tag);
+	}
+
+	return SFE_CMN_RESPONSE_ACK;
+}
+
+/*
+ * sfe_drv_mc_rule_release()
+ * 	release the devices held for a multicast rule
+ *
+ * @param smc The sfe multicast rule
+ */
+static void sfe_drv_mc_rule_release(struct sfe_mc_connection_create *smc)
+{
+	unsigned int i;
+
+	if (smc->src_dev) {
+		dev_put(smc->src_dev);
+	}
+
+	for (i = 0; i < smc->xmit_if_count; i++) {
+		if (smc->xmit_if[i].dev) {
+			dev_put(smc->xmit_if[i].dev);
+		}
+	}
+
+	kfree(smc);
+}
+
+/*
+ * sfe_drv_ipv4_mc_rule()
+ * 	convert multicast create/update message format from ecm to sfe and apply it
+ *
+ * The ingress device is the one carrying any PPPoE session or VLAN tags, like
+ * the egress ones.  A message with SFE_RULE_CREATE_FLAG_MC_UPDATE set only
+ * lists the interfaces joining or leaving the group.
+ *
+ * @param msg The IPv4 message
+ *
+ * @return enum sfe_cmn_response The response to return for this message
+ */
+static enum sfe_cmn_response sfe_drv_ipv4_mc_rule(struct sfe_ipv4_msg *msg)
+{
+	struct sfe_ipv4_mc_rule_create_msg *mc = &msg->msg.mc_rule_create;
+	struct sfe_mc_connection_create *smc;
+	struct net_device *top_dev;
+	enum sfe_cmn_response ret;
+	u32 i;
+	int err;
+
+	if (mc->tuple.protocol != IPPROTO_UDP) {
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_PROTOCOL_NOT_SUPPORT);
+		return SFE_CMN_RESPONSE_EMSG;
+	}
+
+	if (!mc->if_rule || !mc->if_count || (mc->if_count > SFE_MAX_MC_IF)) {
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_MC_IF_COUNT_INVALID);
+		return SFE_CMN_RESPONSE_EMSG;
+	}
+
+	/*
+	 * The rule is too large for the stack.
+	 */
+	smc = kzalloc(sizeof(*smc), GFP_ATOMIC);
+	if (!smc) {
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_CREATE_FAILED);
+		return SFE_CMN_RESPONSE_EMSG;
+	}
+
+	smc->protocol = mc->tuple.protocol;
+	smc->src_ip.ip = mc->tuple.flow_ip;
+	smc->dest_ip.ip = mc->tuple.return_ip;
+	smc->src_port = mc->tuple.flow_ident;
+	smc->dest_port = mc->tuple.return_ident;
+	memcpy(smc->dest_mac, mc->dest_mac, ETH_ALEN);
+
+	smc->src_dev = dev_get_by_index(&init_net, mc->src_interface_num);
+	if (!smc->src_dev) {
+		ret = SFE_CMN_RESPONSE_EINTERFACE;
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_MC_DEV_NOT_FOUND);
+		goto done;
+	}
+
+	/*
+	 * Routed groups must arrive on an interface doing IP processing.
+	 */
+	if (mc->rule_flags & SFE_RULE_CREATE_FLAG_ROUTED) {
+		top_dev = dev_get_by_index(&init_net, mc->src_top_interface_num);
+		if (!top_dev || !sfe_drv_dev_is_layer_3_interface(top_dev, true)) {
+			if (top_dev) {
+				dev_put(top_dev);
+			}
+
+			ret = SFE_CMN_RESPONSE_EINTERFACE;
+			sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_SRC_DEV_NOT_L3);
+			goto done;
+		}
+
+		dev_put(top_dev);
+	}
+
+	if ((mc->valid_flags & SFE_RULE_CREATE_PPPOE_VALID) && mc->ingress_pppoe_session_id) {
+		smc->src_pppoe_session_id = mc->ingress_pppoe_session_id;
+		smc->flags |= SFE_CREATE_FLAG_SRC_PPPOE;
+	}
+
+	if (mc->valid_flags & SFE_RULE_CREATE_VLAN_VALID) {
+		smc->src_vlan_count = sfe_drv_mc_vlan_tags_get(smc->src_vlan_tag, mc->ingress_vlan_tag);
+	}
+
+	if (mc->valid_flags & SFE_RULE_CREATE_QOS_VALID) {
+		smc->priority = mc->qos_tag;
+		smc->flags |= SFE_CREATE_FLAG_REMARK_PRIORITY;
+	}
+
+	if (mc->valid_flags & SFE_RULE_CREATE_DSCP_MARKING_VALID) {
+		smc->dscp = mc->egress_dscp;
+		smc->flags |= SFE_CREATE_FLAG_REMARK_DSCP;
+	}
+
+	for (i = 0; i < mc->if_count; i++) {
+		ret = sfe_drv_mc_xmit_if_init(&smc->xmit_if[i], &mc->if_rule[i]);
+		if (ret != SFE_CMN_RESPONSE_ACK) {
+			goto done;
+		}
+
+		smc->xmit_if_count++;
+	}
+
+	if (mc->rule_flags & SFE_RULE_CREATE_FLAG_MC_UPDATE) {
+		err = sfe_ipv4_update_mc_rule(smc);
+	} else {
+		err = sfe_ipv4_create_mc_rule(smc);
+	}
+
+	if (!err) {
+		/* success */
+		ret = SFE_CMN_RESPONSE_ACK;
+	} else {
+		/* failed */
+		ret = SFE_CMN_RESPONSE_EMSG;
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_CREATE_FAILED);
+	}
+
+	/*
+	 * fall through
+	 */
+done:
+	sfe_drv_mc_rule_release(smc);
+	return ret;
+}
+
+/*
+ * sfe_drv_create_ipv4_mc_rule_msg()
+ * 	convert multicast create/update message format from ecm to sfe
+ *
+ * @param sfe_drv_ctx sfe driver context
+ * @param msg The IPv4 message
+ *
+ * @return sfe_tx_status_t The status of the Tx operation
+ */
+sfe_tx_status_t sfe_drv_create_ipv4_mc_rule_msg(struct sfe_drv_ctx_instance_internal *sfe_drv_ctx, struct sfe_ipv4_msg *msg)
+{
+	struct sfe_drv_response_msg *response;
+
+	response = sfe_drv_alloc_response_msg(SFE_DRV_MSG_TYPE_IPV4, msg);
+	if (!response) {
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_ENQUEUE_FAILED);
+		return SFE_TX_FAILURE_QUEUE;
+	}
+
+	/*
+	 * The sender may free the interface rules as soon as we return.
+	 */
+	((struct sfe_ipv4_msg *)response->msg)->msg.mc_rule_create.if_rule = NULL;
 
 	/*
 	 * try to queue response message
 	 */
-	((struct sfe_ipv4_msg *)response->msg)->cm.response = msg->cm.response = SFE_CMN_RESPONSE_ACK;
+	((struct sfe_ipv4_msg *)response->msg)->cm.response = msg->cm.response = sfe_drv_ipv4_mc_rule(msg);
 	sfe_drv_enqueue_msg(sfe_drv_ctx, response);
 
 	return SFE_TX_SUCCESS;
@@ -651,6 +1500,8 @@ sfe_tx_status_t sfe_drv_ipv4_tx(struct sfe_drv_ctx_instance *sfe_drv_ctx, struct
 		return sfe_drv_create_ipv4_rule_msg(SFE_DRV_CTX_TO_PRIVATE(sfe_drv_ctx), msg);
 	case SFE_TX_DESTROY_RULE_MSG:
 		return sfe_drv_destroy_ipv4_rule_msg(SFE_DRV_CTX_TO_PRIVATE(sfe_drv_ctx), msg);
+	case SFE_TX_CREATE_MC_RULE_MSG:
+		return sfe_drv_create_ipv4_mc_rule_msg(SFE_DRV_CTX_TO_PRIVATE(sfe_drv_ctx), msg);
 	default:
 		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_IPV4_MSG_UNKNOW);
 		return SFE_TX_FAILURE_NOT_ENABLED;
@@ -658,6 +1509,62 @@ sfe_tx_status_t sfe_drv_ipv4_tx(struct sfe_drv_ctx_instance *sfe_drv_ctx, struct
 }
 EXPORT_SYMBOL(sfe_drv_ipv4_tx);
 
+/*
+ * sfe_drv_ipv4_tx_batch()
+ * 	Transmit a batch of IPv4 create/destroy rule messages to the sfe
+ *
+ * Every message in the batch is processed in order and has its own cm.response
+ * filled in; a single response carrying the whole batch is then sent back to
+ * the batch callback.
+ *
+ * @param sfe_drv_ctx sfe driver context
+ * @param batch The IPv4 batch message
+ *
+ * @return sfe_tx_status_t The status of the Tx operation
+ */
+sfe_tx_status_t sfe_drv_ipv4_tx_batch(struct sfe_drv_ctx_instance *sfe_drv_ctx, struct sfe_ipv4_batch_msg *batch)
+{
+	struct sfe_drv_response_msg *response;
+	u32 idx;
+
+	if (batch->num_msgs > SFE_RULE_BATCH_MAX) {
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_BATCH_TOO_LARGE);
+		return SFE_TX_FAILURE_TOO_LARGE;
+	}
+
+	response = sfe_drv_alloc_response_msg(SFE_DRV_MSG_TYPE_IPV4_BATCH, NULL);
+	if (!response) {
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_ENQUEUE_FAILED);
+		return SFE_TX_FAILURE_QUEUE;
+	}
+
+	for (idx = 0; idx < batch->num_msgs; idx++) {
+		struct sfe_ipv4_msg *msg = &batch->msgs[idx];
+
+		switch (msg->cm.type) {
+		case SFE_TX_CREATE_RULE_MSG:
+			msg->cm.response = sfe_drv_ipv4_create_rule(msg);
+			break;
+		case SFE_TX_DESTROY_RULE_MSG:
+			msg->cm.response = sfe_drv_ipv4_destroy_rule(msg);
+			break;
+		default:
+			msg->cm.response = SFE_CMN_RESPONSE_EMSG;
+			sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_IPV4_MSG_UNKNOW);
+		}
+	}
+
+	/*
+	 * try to queue response message
+	 */
+	batch->cm.response = SFE_CMN_RESPONSE_ACK;
+	memcpy(response->msg, batch, sizeof(struct sfe_ipv4_batch_msg));
+	sfe_drv_enqueue_msg(SFE_DRV_CTX_TO_PRIVATE(sfe_drv_ctx), response);
+
+	return SFE_TX_SUCCESS;
+}
+EXPORT_SYMBOL(sfe_drv_ipv4_tx_batch);
+
 /*
  * sfe_ipv4_msg_init()
  *	Initialize IPv4 message.
@@ -669,6 +1576,19 @@ void sfe_ipv4_msg_init(struct sfe_ipv4_msg *nim, u16 if_num, u32 type, u32 len,
 }
 EXPORT_SYMBOL(sfe_ipv4_msg_init);
 
+/*
+ * sfe_ipv4_batch_msg_init()
+ *	Initialize an empty IPv4 batch message.
+ */
+void sfe_ipv4_batch_msg_init(struct sfe_ipv4_batch_msg *batch, u16 if_num,
+			sfe_ipv4_batch_msg_callback_t cb, void *app_data)
+{
+	sfe_cmn_msg_init(&batch->cm, if_num, SFE_TX_BATCH_RULE_MSG, sizeof(struct sfe_ipv4_batch_msg) - sizeof(struct sfe_cmn_msg),
+			(void *)cb, app_data);
+	batch->num_msgs = 0;
+}
+EXPORT_SYMBOL(sfe_ipv4_batch_msg_init);
+
 /*
  * sfe_drv_ipv4_max_conn_count()
  * 	return maximum number of entries SFE supported
@@ -698,6 +1618,7 @@ struct sfe_drv_ctx_instance *sfe_drv_ipv4_notify_register(sfe_ipv4_msg_callback_
 	 */
 	if (cb && !sfe_drv_ctx->ipv4_stats_sync_cb) {
 		sfe_ipv4_register_sync_rule_callback(sfe_drv_ipv4_stats_sync_callback);
+		sfe_ipv4_register_sync_rule_batch_callback(sfe_drv_ipv4_stats_sync_batch_callback);
 	}
 
 	rcu_assign_pointer(sfe_drv_ctx->ipv4_stats_sync_cb, cb);
@@ -709,6 +1630,36 @@ struct sfe_drv_ctx_instance *sfe_drv_ipv4_notify_register(sfe_ipv4_msg_callback_
 }
 EXPORT_SYMBOL(sfe_drv_ipv4_notify_register);
 
+/*
+ * sfe_drv_ipv4_notify_try_register()
+ * 	Register a notifier callback for IPv4 messages unless one is registered already
+ *
+ * @param cb The callback pointer
+ * @param app_data The application context for this message
+ *
+ * @return struct sfe_drv_ctx_instance * The sfe driver context, NULL if another callback owns it
+ */
+struct sfe_drv_ctx_instance *sfe_drv_ipv4_notify_try_register(sfe_ipv4_msg_callback_t cb, void *app_data)
+{
+	struct sfe_drv_ctx_instance_internal *sfe_drv_ctx = &__sfe_drv_ctx;
+
+	spin_lock_bh(&sfe_drv_ctx->lock);
+	if (sfe_drv_ctx->ipv4_stats_sync_cb) {
+		spin_unlock_bh(&sfe_drv_ctx->lock);
+		return NULL;
+	}
+
+	sfe_ipv4_register_sync_rule_callback(sfe_drv_ipv4_stats_sync_callback);
+	sfe_ipv4_register_sync_rule_batch_callback(sfe_drv_ipv4_stats_sync_batch_callback);
+	rcu_assign_pointer(sfe_drv_ctx->ipv4_stats_sync_cb, cb);
+	sfe_drv_ctx->ipv4_stats_sync_data = app_data;
+
+	spin_unlock_bh(&sfe_drv_ctx->lock);
+
+	return SFE_DRV_CTX_TO_PUBLIC(sfe_drv_ctx);
+}
+EXPORT_SYMBOL(sfe_drv_ipv4_notify_try_register);
+
 /*
  * sfe_drv_ipv4_notify_unregister()
  * 	Un-Register a notifier callback for IPv4 messages from sfe driver
@@ -722,6 +1673,7 @@ void sfe_drv_ipv4_notify_unregister(void)
 	 * Unregister our sync callback.
 	 */
 	if (sfe_drv_ctx->ipv4_stats_sync_cb) {
+		sfe_ipv4_register_sync_rule_batch_callback(NULL);
 		sfe_ipv4_register_sync_rule_callback(NULL);
 		rcu_assign_pointer(sfe_drv_ctx->ipv4_stats_sync_cb, NULL);
 		sfe_drv_ctx->ipv4_stats_sync_data = NULL;
@@ -729,34 +1681,24 @@ void sfe_drv_ipv4_notify_unregister(void)
 	spin_unlock_bh(&sfe_drv_ctx->lock);
 
 	sfe_drv_clean_response_msg_by_type(sfe_drv_ctx, SFE_DRV_MSG_TYPE_IPV4);
+	sfe_drv_clean_response_msg_by_type(sfe_drv_ctx, SFE_DRV_MSG_TYPE_IPV4_BATCH);
 
 	return;
 }
 EXPORT_SYMBOL(sfe_drv_ipv4_notify_unregister);
 
 /*
- * sfe_drv_ipv6_stats_sync_callback()
- *	Synchronize a connection's state.
+ * sfe_drv_ipv6_stats_sync_msg_init()
+ *	Build the connection stats sync message for a connection's state.
  */
-static void sfe_drv_ipv6_stats_sync_callback(struct sfe_connection_sync *sis)
+static void sfe_drv_ipv6_stats_sync_msg_init(struct sfe_ipv6_msg *msg, struct sfe_connection_sync *sis)
 {
-	struct sfe_drv_ctx_instance_internal *sfe_drv_ctx = &__sfe_drv_ctx;
-	struct sfe_ipv6_msg msg;
 	struct sfe_ipv6_conn_sync *sync_msg;
-	sfe_ipv6_msg_callback_t sync_cb;
 
-	rcu_read_lock();
-	sync_cb = rcu_dereference(sfe_drv_ctx->ipv6_stats_sync_cb);
-	if (!sync_cb) {
-		rcu_read_unlock();
-		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_NO_SYNC_CB);
-		return;
-	}
-
-	sync_msg = &msg.msg.conn_stats;
+	sync_msg = &msg->msg.conn_stats;
 
-	memset(&msg, 0, sizeof(msg));
-	sfe_cmn_msg_init(&msg.cm, 0, SFE_RX_CONN_STATS_SYNC_MSG,
+	memset(msg, 0, sizeof(*msg));
+	sfe_cmn_msg_init(&msg->cm, 0, SFE_RX_CONN_STATS_SYNC_MSG,
 			sizeof(struct sfe_ipv6_conn_sync), NULL, NULL);
 
 	/*
@@ -814,6 +1756,27 @@ static void sfe_drv_ipv6_stats_sync_callback(struct sfe_connection_sync *sis)
 		sync_msg->reason = SFE_RULE_SYNC_REASON_STATS;
 		break;
 	}
+}
+
+/*
+ * sfe_drv_ipv6_stats_sync_callback()
+ *	Synchronize a connection's state.
+ */
+static void sfe_drv_ipv6_stats_sync_callback(struct sfe_connection_sync *sis)
+{
+	struct sfe_drv_ctx_instance_internal *sfe_drv_ctx = &__sfe_drv_ctx;
+	struct sfe_ipv6_msg msg;
+	sfe_ipv6_msg_callback_t sync_cb;
+
+	rcu_read_lock();
+	sync_cb = rcu_dereference(sfe_drv_ctx->ipv6_stats_sync_cb);
+	if (!sync_cb) {
+		rcu_read_unlock();
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_NO_SYNC_CB);
+		return;
+	}
+
+	sfe_drv_ipv6_stats_sync_msg_init(&msg, sis);
 
 	/*
 	 * SFE sync calling is excuted in a timer, so we can redirect it to ECM directly.
@@ -823,43 +1786,57 @@ static void sfe_drv_ipv6_stats_sync_callback(struct sfe_connection_sync *sis)
 }
 
 /*
- * sfe_drv_create_ipv6_rule_msg()
- * 	convert create message format from ecm to sfe
+ * sfe_drv_ipv6_stats_sync_batch_callback()
+ *	Synchronize the state of a batch of connections.
+ */
+static void sfe_drv_ipv6_stats_sync_batch_callback(struct sfe_connection_sync *sis, unsigned int count)
+{
+	struct sfe_drv_ctx_instance_internal *sfe_drv_ctx = &__sfe_drv_ctx;
+	struct sfe_ipv6_msg msg;
+	sfe_ipv6_msg_callback_t sync_cb;
+
+	rcu_read_lock();
+	sync_cb = rcu_dereference(sfe_drv_ctx->ipv6_stats_sync_cb);
+	if (!sync_cb) {
+		rcu_read_unlock();
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_NO_SYNC_CB);
+		return;
+	}
+
+	while (count--) {
+		sfe_drv_ipv6_stats_sync_msg_init(&msg, sis++);
+		sync_cb(sfe_drv_ctx->ipv6_stats_sync_data, &msg);
+	}
+	rcu_read_unlock();
+}
+
+/*
+ * sfe_drv_ipv6_create_rule()
+ * 	convert create message format from ecm to sfe and create the connection
  *
- * @param sfe_drv_ctx sfe driver context
  * @param msg The IPv6 message
  *
- * @return sfe_tx_status_t The status of the Tx operation
+ * @return enum sfe_cmn_response The response to return for this message
  */
-sfe_tx_status_t sfe_drv_create_ipv6_rule_msg(struct sfe_drv_ctx_instance_internal *sfe_drv_ctx, struct sfe_ipv6_msg *msg)
+static enum sfe_cmn_response sfe_drv_ipv6_create_rule(struct sfe_ipv6_msg *msg)
 {
 	struct sfe_connection_create sic;
 	struct net_device *src_dev = NULL;
 	struct net_device *dest_dev = NULL;
-	struct sfe_drv_response_msg *response;
+	struct net_device *src_pppoe_dev = NULL;
+	struct net_device *dest_pppoe_dev = NULL;
+	struct net_device *src_vlan_dev = NULL;
+	struct net_device *dest_vlan_dev = NULL;
+	struct net_device *src_tun_dev = NULL;
+	struct net_device *dest_tun_dev = NULL;
 	enum sfe_cmn_response ret;
 
-	response = sfe_drv_alloc_response_msg(SFE_DRV_MSG_TYPE_IPV6, msg);
-	if (!response) {
-		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_ENQUEUE_FAILED);
-		return SFE_TX_FAILURE_QUEUE;
-	}
-
 	if (!(msg->msg.rule_create.valid_flags & SFE_RULE_CREATE_CONN_VALID)) {
 		ret = SFE_CMN_RESPONSE_EMSG;
 		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_CONNECTION_INVALID);
 		goto failed_ret;
 	}
 
-	/*
-	 * not support bridged flows now
-	 */
-	if (msg->msg.rule_create.rule_flags & SFE_RULE_CREATE_FLAG_BRIDGE_FLOW) {
-		ret = SFE_CMN_RESPONSE_EINTERFACE;
-		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_NOT_SUPPORT_BRIDGE);
-		goto failed_ret;
-	}
-
 	sic.protocol = msg->msg.rule_create.tuple.protocol;
 	sfe_drv_ipv6_addr_copy(msg->msg.rule_create.tuple.flow_ip, sic.src_ip.ip6);
 	sfe_drv_ipv6_addr_copy(msg->msg.rule_create.tuple.return_ip, sic.dest_ip.ip6);
@@ -899,38 +1876,120 @@ sfe_tx_status_t sfe_drv_create_ipv6_rule_msg(struct sfe_drv_ctx_instance_interna
 		sic.dest_port_xlate = msg->msg.rule_create.tuple.return_ident;
 		break;
 
-	default:
-		ret = SFE_CMN_RESPONSE_EMSG;
-		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_PROTOCOL_NOT_SUPPORT);
-		goto failed_ret;
+	default:
+		ret = SFE_CMN_RESPONSE_EMSG;
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_PROTOCOL_NOT_SUPPORT);
+		goto failed_ret;
+	}
+
+	memcpy(sic.src_mac, msg->msg.rule_create.conn_rule.flow_mac, ETH_ALEN);
+	memset(sic.src_mac_xlate, 0, ETH_ALEN);
+	memset(sic.dest_mac, 0, ETH_ALEN);
+	memcpy(sic.dest_mac_xlate, msg->msg.rule_create.conn_rule.return_mac, ETH_ALEN);
+	src_dev = dev_get_by_index(&init_net, msg->msg.rule_create.conn_rule.flow_top_interface_num);
+	dest_dev = dev_get_by_index(&init_net, msg->msg.rule_create.conn_rule.return_top_interface_num);
+
+	if (msg->msg.rule_create.rule_flags & SFE_RULE_CREATE_FLAG_BRIDGE_FLOW) {
+		/*
+		 * Bridged flows go directly between two ports of a bridge.
+		 */
+		if (!src_dev || !netif_is_bridge_port(src_dev)) {
+			ret = SFE_CMN_RESPONSE_EINTERFACE;
+			sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_SRC_DEV_NOT_BRIDGE_PORT);
+			goto failed_ret;
+		}
+
+		if (!dest_dev || !netif_is_bridge_port(dest_dev)) {
+			ret = SFE_CMN_RESPONSE_EINTERFACE;
+			sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_DEST_DEV_NOT_BRIDGE_PORT);
+			goto failed_ret;
+		}
+
+		sic.flags |= SFE_CREATE_FLAG_BRIDGE_FLOW;
+	} else {
+		/*
+		 * Does our input device support IP processing?
+		 */
+		if (!src_dev || (!sfe_drv_dev_is_tun(src_dev) && !sfe_drv_dev_is_layer_3_interface(src_dev, false))) {
+			ret = SFE_CMN_RESPONSE_EINTERFACE;
+			sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_SRC_DEV_NOT_L3);
+			goto failed_ret;
+		}
+
+		/*
+		 * Does our output device support IP processing?
+		 */
+		if (!dest_dev || (!sfe_drv_dev_is_tun(dest_dev) && !sfe_drv_dev_is_layer_3_interface(dest_dev, false))) {
+			ret = SFE_CMN_RESPONSE_EINTERFACE;
+			sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_DEST_DEV_NOT_L3);
+			goto failed_ret;
+		}
 	}
 
-	memcpy(sic.src_mac, msg->msg.rule_create.conn_rule.flow_mac, ETH_ALEN);
-	memset(sic.src_mac_xlate, 0, ETH_ALEN);
-	memset(sic.dest_mac, 0, ETH_ALEN);
-	memcpy(sic.dest_mac_xlate, msg->msg.rule_create.conn_rule.return_mac, ETH_ALEN);
+	sic.src_dev = src_dev;
+	sic.dest_dev = dest_dev;
+
 	/*
-	 * Does our input device support IP processing?
+	 * The SFE adds and removes PPPoE headers itself so for a PPPoE session it
+	 * wants the device carrying the session, which is the flow or return
+	 * interface rather than the top interface.
 	 */
-	src_dev = dev_get_by_index(&init_net, msg->msg.rule_create.conn_rule.flow_top_interface_num);
-	if (!src_dev || !sfe_drv_dev_is_layer_3_interface(src_dev, false)) {
-		ret = SFE_CMN_RESPONSE_EINTERFACE;
-		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_SRC_DEV_NOT_L3);
-		goto failed_ret;
+	if (msg->msg.rule_create.valid_flags & SFE_RULE_CREATE_PPPOE_VALID) {
+		if (msg->msg.rule_create.pppoe_rule.flow_pppoe_session_id) {
+			src_pppoe_dev = dev_get_by_index(&init_net, msg->msg.rule_create.conn_rule.flow_interface_num);
+			if (!src_pppoe_dev) {
+				ret = SFE_CMN_RESPONSE_EINTERFACE;
+				sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_PPPOE_DEV_NOT_FOUND);
+				goto failed_ret;
+			}
+
+			sic.src_dev = src_pppoe_dev;
+			sic.src_pppoe_session_id = msg->msg.rule_create.pppoe_rule.flow_pppoe_session_id;
+			memcpy(sic.src_pppoe_remote_mac, msg->msg.rule_create.pppoe_rule.flow_pppoe_remote_mac, ETH_ALEN);
+			sic.flags |= SFE_CREATE_FLAG_SRC_PPPOE;
+		}
+
+		if (msg->msg.rule_create.pppoe_rule.return_pppoe_session_id) {
+			dest_pppoe_dev = dev_get_by_index(&init_net, msg->msg.rule_create.conn_rule.return_interface_num);
+			if (!dest_pppoe_dev) {
+				ret = SFE_CMN_RESPONSE_EINTERFACE;
+				sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_PPPOE_DEV_NOT_FOUND);
+				goto failed_ret;
+			}
+
+			sic.dest_dev = dest_pppoe_dev;
+			sic.dest_pppoe_session_id = msg->msg.rule_create.pppoe_rule.return_pppoe_session_id;
+			memcpy(sic.dest_pppoe_remote_mac, msg->msg.rule_create.pppoe_rule.return_pppoe_remote_mac, ETH_ALEN);
+			sic.flags |= SFE_CREATE_FLAG_DEST_PPPOE;
+		}
 	}
 
 	/*
-	 * Does our output device support IP processing?
+	 * Tunnel headers are added and removed by the SFE as well, so for a tunnel
+	 * it wants the device carrying the tunnel's packets and the MAC address of
+	 * the tunnel's next hop on it.
 	 */
-	dest_dev = dev_get_by_index(&init_net, msg->msg.rule_create.conn_rule.return_top_interface_num);
-	if (!dest_dev || !sfe_drv_dev_is_layer_3_interface(dest_dev, false)) {
-		ret = SFE_CMN_RESPONSE_EINTERFACE;
-		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_DEST_DEV_NOT_L3);
-		goto failed_ret;
+	if (sfe_drv_dev_is_tun(sic.src_dev)) {
+		src_tun_dev = sfe_drv_tun_carrier_get(sic.src_dev, (struct in6_addr *)sic.src_ip.ip6, &sic.src_tun, sic.src_mac);
+		if (!src_tun_dev) {
+			ret = SFE_CMN_RESPONSE_EINTERFACE;
+			goto failed_ret;
+		}
+
+		sic.src_dev = src_tun_dev;
+		sic.flags |= SFE_CREATE_FLAG_SRC_TUN;
 	}
 
-	sic.src_dev = src_dev;
-	sic.dest_dev = dest_dev;
+	if (sfe_drv_dev_is_tun(sic.dest_dev)) {
+		dest_tun_dev = sfe_drv_tun_carrier_get(sic.dest_dev, (struct in6_addr *)sic.dest_ip.ip6, &sic.dest_tun, sic.dest_mac_xlate);
+		if (!dest_tun_dev) {
+			ret = SFE_CMN_RESPONSE_EINTERFACE;
+			goto failed_ret;
+		}
+
+		sic.dest_dev = dest_tun_dev;
+		sic.flags |= SFE_CREATE_FLAG_DEST_TUN;
+	}
 
 	sic.src_mtu = msg->msg.rule_create.conn_rule.flow_mtu;
 	sic.dest_mtu = msg->msg.rule_create.conn_rule.return_mtu;
@@ -947,6 +2006,40 @@ sfe_tx_status_t sfe_drv_create_ipv6_rule_msg(struct sfe_drv_ctx_instance_interna
 		sic.flags |= SFE_CREATE_FLAG_REMARK_DSCP;
 	}
 
+	memset(&sic.src_police, 0, sizeof(sic.src_police));
+	memset(&sic.dest_police, 0, sizeof(sic.dest_police));
+	if (msg->msg.rule_create.valid_flags & SFE_RULE_CREATE_POLICE_VALID) {
+		sic.src_police.rate = msg->msg.rule_create.police_rule.flow_rate;
+		sic.src_police.burst = msg->msg.rule_create.police_rule.flow_burst;
+		sic.src_police.action = msg->msg.rule_create.police_rule.flow_action;
+		sic.src_police.dscp = msg->msg.rule_create.police_rule.flow_dscp;
+		sic.dest_police.rate = msg->msg.rule_create.police_rule.return_rate;
+		sic.dest_police.burst = msg->msg.rule_create.police_rule.return_burst;
+		sic.dest_police.action = msg->msg.rule_create.police_rule.return_action;
+		sic.dest_police.dscp = msg->msg.rule_create.police_rule.return_dscp;
+	}
+
+	/*
+	 * The SFE adds and removes VLAN tags itself too so it wants the real device
+	 * underneath any VLAN devices.  The priority bits of the tags follow the
+	 * priority of the direction they're added in.
+	 */
+	sic.src_vlan_count = 0;
+	src_vlan_dev = sfe_vlan_real_dev_get(sic.src_dev,
+					     (sic.flags & SFE_CREATE_FLAG_REMARK_PRIORITY) ? sic.dest_priority : 0,
+					     sic.src_vlan_tag, &sic.src_vlan_count);
+	if (src_vlan_dev) {
+		sic.src_dev = src_vlan_dev;
+	}
+
+	sic.dest_vlan_count = 0;
+	dest_vlan_dev = sfe_vlan_real_dev_get(sic.dest_dev,
+					      (sic.flags & SFE_CREATE_FLAG_REMARK_PRIORITY) ? sic.src_priority : 0,
+					      sic.dest_vlan_tag, &sic.dest_vlan_count);
+	if (dest_vlan_dev) {
+		sic.dest_dev = dest_vlan_dev;
+	}
+
 #ifdef CONFIG_XFRM
 	if (msg->msg.rule_create.valid_flags & SFE_RULE_CREATE_DIRECTION_VALID) {
 		sic.original_accel = msg->msg.rule_create.direction_rule.flow_accel;
@@ -977,15 +2070,84 @@ failed_ret:
 		dev_put(dest_dev);
 	}
 
+	if (src_pppoe_dev) {
+		dev_put(src_pppoe_dev);
+	}
+
+	if (dest_pppoe_dev) {
+		dev_put(dest_pppoe_dev);
+	}
+
+	if (src_vlan_dev) {
+		dev_put(src_vlan_dev);
+	}
+
+	if (dest_vlan_dev) {
+		dev_put(dest_vlan_dev);
+	}
+
+	if (src_tun_dev) {
+		dev_put(src_tun_dev);
+	}
+
+	if (dest_tun_dev) {
+		dev_put(dest_tun_dev);
+	}
+
+	return ret;
+}
+
+/*
+ * sfe_drv_create_ipv6_rule_msg()
+ * 	convert create message format from ecm to sfe
+ *
+ * @param sfe_drv_ctx sfe driver context
+ * @param msg The IPv6 message
+ *
+ * @return sfe_tx_status_t The status of the Tx operation
+ */
+sfe_tx_status_t sfe_drv_create_ipv6_rule_msg(struct sfe_drv_ctx_instance_internal *sfe_drv_ctx, struct sfe_ipv6_msg *msg)
+{
+	struct sfe_drv_response_msg *response;
+
+	response = sfe_drv_alloc_response_msg(SFE_DRV_MSG_TYPE_IPV6, msg);
+	if (!response) {
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_ENQUEUE_FAILED);
+		return SFE_TX_FAILURE_QUEUE;
+	}
+
 	/*
 	 * try to queue response message
 	 */
-	((struct sfe_ipv6_msg *)response->msg)->cm.response = msg->cm.response = ret;
+	((struct sfe_ipv6_msg *)response->msg)->cm.response = msg->cm.response = sfe_drv_ipv6_create_rule(msg);
 	sfe_drv_enqueue_msg(sfe_drv_ctx, response);
 
 	return SFE_TX_SUCCESS;
 }
 
+/*
+ * sfe_drv_ipv6_destroy_rule()
+ * 	convert destroy message format from ecm to sfe and destroy the connection
+ *
+ * @param msg The IPv6 message
+ *
+ * @return enum sfe_cmn_response The response to return for this message
+ */
+static enum sfe_cmn_response sfe_drv_ipv6_destroy_rule(struct sfe_ipv6_msg *msg)
+{
+	struct sfe_connection_destroy sid;
+
+	sid.protocol = msg->msg.rule_destroy.tuple.protocol;
+	sfe_drv_ipv6_addr_copy(msg->msg.rule_destroy.tuple.flow_ip, sid.src_ip.ip6);
+	sfe_drv_ipv6_addr_copy(msg->msg.rule_destroy.tuple.return_ip, sid.dest_ip.ip6);
+	sid.src_port = msg->msg.rule_destroy.tuple.flow_ident;
+	sid.dest_port = msg->msg.rule_destroy.tuple.return_ident;
+
+	sfe_ipv6_destroy_rule(&sid);
+
+	return SFE_CMN_RESPONSE_ACK;
+}
+
 /*
  * sfe_drv_destroy_ipv6_rule_msg()
  * 	convert destroy message format from ecm to sfe
@@ -997,7 +2159,6 @@ failed_ret:
  */
 sfe_tx_status_t sfe_drv_destroy_ipv6_rule_msg(struct sfe_drv_ctx_instance_internal *sfe_drv_ctx, struct sfe_ipv6_msg *msg)
 {
-	struct sfe_connection_destroy sid;
 	struct sfe_drv_response_msg *response;
 
 	response = sfe_drv_alloc_response_msg(SFE_DRV_MSG_TYPE_IPV6, msg);
@@ -1006,18 +2167,166 @@ sfe_tx_status_t sfe_drv_destroy_ipv6_rule_msg(struct sfe_drv_ctx_instance_intern
 		return SFE_TX_FAILURE_QUEUE;
 	}
 
-	sid.protocol = msg->msg.rule_destroy.tuple.protocol;
-	sfe_drv_ipv6_addr_copy(msg->msg.rule_destroy.tuple.flow_ip, sid.src_ip.ip6);
-	sfe_drv_ipv6_addr_copy(msg->msg.rule_destroy.tuple.return_ip, sid.dest_ip.ip6);
-	sid.src_port = msg->msg.rule_destroy.tuple.flow_ident;
-	sid.dest_port = msg->msg.rule_destroy.tuple.return_ident;
+	/*
+	 * try to queue response message
+	 */
+	((struct sfe_ipv6_msg *)response->msg)->cm.response = msg->cm.response = sfe_drv_ipv6_destroy_rule(msg);
+	sfe_drv_enqueue_msg(sfe_drv_ctx, response);
 
-	sfe_ipv6_destroy_rule(&sid);
+	return SFE_TX_SUCCESS;
+}
+
+/*
+ * sfe_drv_ipv6_mc_rule()
+ * 	convert multicast create/update message format from ecm to sfe and apply it
+ *
+ * The ingress device is the one carrying any PPPoE session or VLAN tags, like
+ * the egress ones.  A message with SFE_RULE_CREATE_FLAG_MC_UPDATE set only
+ * lists the interfaces joining or leaving the group.
+ *
+ * @param msg The IPv6 message
+ *
+ * @return enum sfe_cmn_response The response to return for this message
+ */
+static enum sfe_cmn_response sfe_drv_ipv6_mc_rule(struct sfe_ipv6_msg *msg)
+{
+	struct sfe_ipv6_mc_rule_create_msg *mc = &msg->msg.mc_rule_create;
+	struct sfe_mc_connection_create *smc;
+	struct net_device *top_dev;
+	enum sfe_cmn_response ret;
+	u32 i;
+	int err;
+
+	if (mc->tuple.protocol != IPPROTO_UDP) {
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_PROTOCOL_NOT_SUPPORT);
+		return SFE_CMN_RESPONSE_EMSG;
+	}
+
+	if (!mc->if_rule || !mc->if_count || (mc->if_count > SFE_MAX_MC_IF)) {
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_MC_IF_COUNT_INVALID);
+		return SFE_CMN_RESPONSE_EMSG;
+	}
+
+	/*
+	 * The rule is too large for the stack.
+	 */
+	smc = kzalloc(sizeof(*smc), GFP_ATOMIC);
+	if (!smc) {
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_CREATE_FAILED);
+		return SFE_CMN_RESPONSE_EMSG;
+	}
+
+	smc->protocol = mc->tuple.protocol;
+	sfe_drv_ipv6_addr_copy(mc->tuple.flow_ip, smc->src_ip.ip6);
+	sfe_drv_ipv6_addr_copy(mc->tuple.return_ip, smc->dest_ip.ip6);
+	smc->src_port = mc->tuple.flow_ident;
+	smc->dest_port = mc->tuple.return_ident;
+	memcpy(smc->dest_mac, mc->dest_mac, ETH_ALEN);
+
+	smc->src_dev = dev_get_by_index(&init_net, mc->src_interface_num);
+	if (!smc->src_dev) {
+		ret = SFE_CMN_RESPONSE_EINTERFACE;
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_MC_DEV_NOT_FOUND);
+		goto done;
+	}
+
+	/*
+	 * Routed groups must arrive on an interface doing IP processing.
+	 */
+	if (mc->rule_flags & SFE_RULE_CREATE_FLAG_ROUTED) {
+		top_dev = dev_get_by_index(&init_net, mc->src_top_interface_num);
+		if (!top_dev || !sfe_drv_dev_is_layer_3_interface(top_dev, false)) {
+			if (top_dev) {
+				dev_put(top_dev);
+			}
+
+			ret = SFE_CMN_RESPONSE_EINTERFACE;
+			sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_SRC_DEV_NOT_L3);
+			goto done;
+		}
+
+		dev_put(top_dev);
+	}
+
+	if ((mc->valid_flags & SFE_RULE_CREATE_PPPOE_VALID) && mc->ingress_pppoe_session_id) {
+		smc->src_pppoe_session_id = mc->ingress_pppoe_session_id;
+		smc->flags |= SFE_CREATE_FLAG_SRC_PPPOE;
+	}
+
+	if (mc->valid_flags & SFE_RULE_CREATE_VLAN_VALID) {
+		smc->src_vlan_count = sfe_drv_mc_vlan_tags_get(smc->src_vlan_tag, mc->ingress_vlan_tag);
+	}
+
+	if (mc->valid_flags & SFE_RULE_CREATE_QOS_VALID) {
+		smc->priority = mc->qos_tag;
+		smc->flags |= SFE_CREATE_FLAG_REMARK_PRIORITY;
+	}
+
+	if (mc->valid_flags & SFE_RULE_CREATE_DSCP_MARKING_VALID) {
+		smc->dscp = mc->egress_dscp;
+		smc->flags |= SFE_CREATE_FLAG_REMARK_DSCP;
+	}
+
+	for (i = 0; i < mc->if_count; i++) {
+		ret = sfe_drv_mc_xmit_if_init(&smc->xmit_if[i], &mc->if_rule[i]);
+		if (ret != SFE_CMN_RESPONSE_ACK) {
+			goto done;
+		}
+
+		smc->xmit_if_count++;
+	}
+
+	if (mc->rule_flags & SFE_RULE_CREATE_FLAG_MC_UPDATE) {
+		err = sfe_ipv6_update_mc_rule(smc);
+	} else {
+		err = sfe_ipv6_create_mc_rule(smc);
+	}
+
+	if (!err) {
+		/* success */
+		ret = SFE_CMN_RESPONSE_ACK;
+	} else {
+		/* failed */
+		ret = SFE_CMN_RESPONSE_EMSG;
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_CREATE_FAILED);
+	}
+
+	/*
+	 * fall through
+	 */
+done:
+	sfe_drv_mc_rule_release(smc);
+	return ret;
+}
+
+/*
+ * sfe_drv_create_ipv6_mc_rule_msg()
+ * 	convert multicast create/update message format from ecm to sfe
+ *
+ * @param sfe_drv_ctx sfe driver context
+ * @param msg The IPv6 message
+ *
+ * @return sfe_tx_status_t The status of the Tx operation
+ */
+sfe_tx_status_t sfe_drv_create_ipv6_mc_rule_msg(struct sfe_drv_ctx_instance_internal *sfe_drv_ctx, struct sfe_ipv6_msg *msg)
+{
+	struct sfe_drv_response_msg *response;
+
+	response = sfe_drv_alloc_response_msg(SFE_DRV_MSG_TYPE_IPV6, msg);
+	if (!response) {
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_ENQUEUE_FAILED);
+		return SFE_TX_FAILURE_QUEUE;
+	}
+
+	/*
+	 * The sender may free the interface rules as soon as we return.
+	 */
+	((struct sfe_ipv6_msg *)response->msg)->msg.mc_rule_create.if_rule = NULL;
 
 	/*
 	 * try to queue response message
 	 */
-	((struct sfe_ipv6_msg *)response->msg)->cm.response = msg->cm.response = SFE_CMN_RESPONSE_ACK;
+	((struct sfe_ipv6_msg *)response->msg)->cm.response = msg->cm.response = sfe_drv_ipv6_mc_rule(msg);
 	sfe_drv_enqueue_msg(sfe_drv_ctx, response);
 
 	return SFE_TX_SUCCESS;
@@ -1039,6 +2348,8 @@ sfe_tx_status_t sfe_drv_ipv6_tx(struct sfe_drv_ctx_instance *sfe_drv_ctx, struct
 		return sfe_drv_create_ipv6_rule_msg(SFE_DRV_CTX_TO_PRIVATE(sfe_drv_ctx), msg);
 	case SFE_TX_DESTROY_RULE_MSG:
 		return sfe_drv_destroy_ipv6_rule_msg(SFE_DRV_CTX_TO_PRIVATE(sfe_drv_ctx), msg);
+	case SFE_TX_CREATE_MC_RULE_MSG:
+		return sfe_drv_create_ipv6_mc_rule_msg(SFE_DRV_CTX_TO_PRIVATE(sfe_drv_ctx), msg);
 	default:
 		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_IPV6_MSG_UNKNOW);
 		return SFE_TX_FAILURE_NOT_ENABLED;
@@ -1046,6 +2357,62 @@ sfe_tx_status_t sfe_drv_ipv6_tx(struct sfe_drv_ctx_instance *sfe_drv_ctx, struct
 }
 EXPORT_SYMBOL(sfe_drv_ipv6_tx);
 
+/*
+ * sfe_drv_ipv6_tx_batch()
+ * 	Transmit a batch of IPv6 create/destroy rule messages to the sfe
+ *
+ * Every message in the batch is processed in order and has its own cm.response
+ * filled in; a single response carrying the whole batch is then sent back to
+ * the batch callback.
+ *
+ * @param sfe_drv_ctx sfe driver context
+ * @param batch The IPv6 batch message
+ *
+ * @return sfe_tx_status_t The status of the Tx operation
+ */
+sfe_tx_status_t sfe_drv_ipv6_tx_batch(struct sfe_drv_ctx_instance *sfe_drv_ctx, struct sfe_ipv6_batch_msg *batch)
+{
+	struct sfe_drv_response_msg *response;
+	u32 idx;
+
+	if (batch->num_msgs > SFE_RULE_BATCH_MAX) {
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_BATCH_TOO_LARGE);
+		return SFE_TX_FAILURE_TOO_LARGE;
+	}
+
+	response = sfe_drv_alloc_response_msg(SFE_DRV_MSG_TYPE_IPV6_BATCH, NULL);
+	if (!response) {
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_ENQUEUE_FAILED);
+		return SFE_TX_FAILURE_QUEUE;
+	}
+
+	for (idx = 0; idx < batch->num_msgs; idx++) {
+		struct sfe_ipv6_msg *msg = &batch->msgs[idx];
+
+		switch (msg->cm.type) {
+		case SFE_TX_CREATE_RULE_MSG:
+			msg->cm.response = sfe_drv_ipv6_create_rule(msg);
+			break;
+		case SFE_TX_DESTROY_RULE_MSG:
+			msg->cm.response = sfe_drv_ipv6_destroy_rule(msg);
+			break;
+		default:
+			msg->cm.response = SFE_CMN_RESPONSE_EMSG;
+			sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_IPV6_MSG_UNKNOW);
+		}
+	}
+
+	/*
+	 * try to queue response message
+	 */
+	batch->cm.response = SFE_CMN_RESPONSE_ACK;
+	memcpy(response->msg, batch, sizeof(struct sfe_ipv6_batch_msg));
+	sfe_drv_enqueue_msg(SFE_DRV_CTX_TO_PRIVATE(sfe_drv_ctx), response);
+
+	return SFE_TX_SUCCESS;
+}
+EXPORT_SYMBOL(sfe_drv_ipv6_tx_batch);
+
 /*
  * sfe_ipv6_msg_init()
  *	Initialize IPv6 message.
@@ -1057,6 +2424,19 @@ void sfe_ipv6_msg_init(struct sfe_ipv6_msg *nim, u16 if_num, u32 type, u32 len,
 }
 EXPORT_SYMBOL(sfe_ipv6_msg_init);
 
+/*
+ * sfe_ipv6_batch_msg_init()
+ *	Initialize an empty IPv6 batch message.
+ */
+void sfe_ipv6_batch_msg_init(struct sfe_ipv6_batch_msg *batch, u16 if_num,
+			sfe_ipv6_batch_msg_callback_t cb, void *app_data)
+{
+	sfe_cmn_msg_init(&batch->cm, if_num, SFE_TX_BATCH_RULE_MSG, sizeof(struct sfe_ipv6_batch_msg) - sizeof(struct sfe_cmn_msg),
+			(void *)cb, app_data);
+	batch->num_msgs = 0;
+}
+EXPORT_SYMBOL(sfe_ipv6_batch_msg_init);
+
 /*
  * sfe_drv_ipv6_max_conn_count()
  * 	return maximum number of entries SFE supported
@@ -1086,6 +2466,7 @@ struct sfe_drv_ctx_instance *sfe_drv_ipv6_notify_register(sfe_ipv6_msg_callback_
 	 */
 	if (cb && !sfe_drv_ctx->ipv6_stats_sync_cb) {
 		sfe_ipv6_register_sync_rule_callback(sfe_drv_ipv6_stats_sync_callback);
+		sfe_ipv6_register_sync_rule_batch_callback(sfe_drv_ipv6_stats_sync_batch_callback);
 	}
 
 	rcu_assign_pointer(sfe_drv_ctx->ipv6_stats_sync_cb, cb);
@@ -1110,6 +2491,7 @@ void sfe_drv_ipv6_notify_unregister(void)
 	 * Unregister our sync callback.
 	 */
 	if (sfe_drv_ctx->ipv6_stats_sync_cb) {
+		sfe_ipv6_register_sync_rule_batch_callback(NULL);
 		sfe_ipv6_register_sync_rule_callback(NULL);
 		rcu_assign_pointer(sfe_drv_ctx->ipv6_stats_sync_cb, NULL);
 		sfe_drv_ctx->ipv6_stats_sync_data = NULL;
@@ -1117,6 +2499,7 @@ void sfe_drv_ipv6_notify_unregister(void)
 	spin_unlock_bh(&sfe_drv_ctx->lock);
 
 	sfe_drv_clean_response_msg_by_type(sfe_drv_ctx, SFE_DRV_MSG_TYPE_IPV6);
+	sfe_drv_clean_response_msg_by_type(sfe_drv_ctx, SFE_DRV_MSG_TYPE_IPV6_BATCH);
 
 	return;
 }
@@ -1128,8 +2511,54 @@ EXPORT_SYMBOL(sfe_drv_ipv6_notify_unregister);
  */
 sfe_tx_status_t sfe_tun6rd_tx(struct sfe_drv_ctx_instance *sfe_drv_ctx, struct sfe_tun6rd_msg *msg)
 {
-	sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_NOT_SUPPORT_6RD);
-	return SFE_TX_FAILURE_NOT_ENABLED;
+	struct sfe_drv_ctx_instance_internal *sfe_drv_ctx_internal = &__sfe_drv_ctx;
+	struct sfe_drv_tun6rd_peer *peer;
+	struct in6_addr addr;
+	int ifindex;
+	u32 hash;
+
+	if ((msg->cm.type != SFE_TUN6RD_ADD_UPDATE_PEER) || !msg->msg.peer.dest) {
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_TUN6RD_MSG_INVALID);
+		return SFE_TX_FAILURE_BAD_PARAM;
+	}
+
+	/*
+	 * The peers are looked up when connections through the sit tunnel with
+	 * no remote address are created.
+	 */
+	ifindex = msg->cm.interface;
+	memcpy(&addr, msg->msg.peer.ipv6_address, sizeof(addr));
+	hash = sfe_drv_tun6rd_peer_hash(ifindex, &addr);
+
+	spin_lock_bh(&sfe_drv_ctx_internal->lock);
+	hash_for_each_possible(sfe_drv_ctx_internal->tun6rd_peers, peer, node, hash) {
+		if ((peer->ifindex == ifindex) && ipv6_addr_equal(&peer->addr, &addr)) {
+			peer->dest = msg->msg.peer.dest;
+			spin_unlock_bh(&sfe_drv_ctx_internal->lock);
+			return SFE_TX_SUCCESS;
+		}
+	}
+
+	if (sfe_drv_ctx_internal->tun6rd_peer_count == SFE_DRV_TUN6RD_PEER_MAX) {
+		spin_unlock_bh(&sfe_drv_ctx_internal->lock);
+		sfe_drv_incr_exceptions(SFE_DRV_EXCEPTION_TUN6RD_PEER_TABLE_FULL);
+		return SFE_TX_FAILURE_QUEUE;
+	}
+
+	peer = kmalloc(sizeof(struct sfe_drv_tun6rd_peer), GFP_ATOMIC);
+	if (!peer) {
+		spin_unlock_bh(&sfe_drv_ctx_internal->lock);
+		return SFE_TX_FAILURE;
+	}
+
+	peer->ifindex = ifindex;
+	peer->addr = addr;
+	peer->dest = msg->msg.peer.dest;
+	hash_add(sfe_drv_ctx_internal->tun6rd_peers, &peer->node, hash);
+	sfe_drv_ctx_internal->tun6rd_peer_count++;
+	spin_unlock_bh(&sfe_drv_ctx_internal->lock);
+
+	return SFE_TX_SUCCESS;
 }
 EXPORT_SYMBOL(sfe_tun6rd_tx);
 
@@ -1152,6 +2581,7 @@ EXPORT_SYMBOL(sfe_tun6rd_msg_init);
 int sfe_drv_recv(struct sk_buff *skb)
 {
 	struct net_device *dev;
+	__be16 proto;
 
 	/*
 	 * We know that for the vast majority of packets we need the transport
@@ -1173,28 +2603,47 @@ int sfe_drv_recv(struct sk_buff *skb)
 #endif
 
 	/*
-	 * We're only interested in IPv4 and IPv6 packets.
+	 * VLAN tagged packets are seen first on the real device, and PPPoE
+	 * sessions on their carrier device.  Those don't normally have IP
+	 * addresses so we don't check them.
 	 */
-	if (likely(htons(ETH_P_IP) == skb->protocol)) {
-		if (sfe_drv_dev_is_layer_3_interface(dev, true)) {
+	if (unlikely(skb_vlan_tag_present(skb) ||
+		     ((htons(ETH_P_IP) != skb->protocol) && (htons(ETH_P_IPV6) != skb->protocol)))) {
+		proto = sfe_tun_l3_proto(skb, sfe_vlan_l3_proto(skb));
+		if (proto == htons(ETH_P_IP)) {
 			return sfe_ipv4_recv(dev, skb);
-		} else {
-			DEBUG_TRACE("no IPv4 address for device: %s\n", dev->name);
-			return 0;
 		}
-	}
 
-	if (likely(htons(ETH_P_IPV6) == skb->protocol)) {
-		if (sfe_drv_dev_is_layer_3_interface(dev, false)) {
+		if (proto == htons(ETH_P_IPV6)) {
 			return sfe_ipv6_recv(dev, skb);
-		} else {
-			DEBUG_TRACE("no IPv6 address for device: %s\n", dev->name);
+		}
+
+		DEBUG_TRACE("not IP packet\n");
+		return 0;
+	}
+
+	/*
+	 * We're only interested in IPv4 and IPv6 packets, on devices with IP
+	 * addresses or on bridge ports that may have bridged flows.  Tunnelled
+	 * packets need an address of their outer protocol and are handled as the
+	 * protocol they carry.
+	 */
+	if (likely(htons(ETH_P_IP) == skb->protocol)) {
+		if (!sfe_drv_dev_is_layer_3_interface(dev, true) && !netif_is_bridge_port(dev)) {
+			DEBUG_TRACE("no IPv4 address for device: %s\n", dev->name);
 			return 0;
 		}
+	} else if (!sfe_drv_dev_is_layer_3_interface(dev, false) && !netif_is_bridge_port(dev)) {
+		DEBUG_TRACE("no IPv6 address for device: %s\n", dev->name);
+		return 0;
 	}
 
-	DEBUG_TRACE("not IP packet\n");
-	return 0;
+	proto = sfe_tun_l3_proto(skb, skb->protocol);
+	if (likely(htons(ETH_P_IP) == proto)) {
+		return sfe_ipv4_recv(dev, skb);
+	}
+
+	return sfe_ipv6_recv(dev, skb);
 }
 
 /*
@@ -1254,6 +2703,7 @@ static int __init sfe_drv_init(void)
 	spin_lock_init(&sfe_drv_ctx->lock);
 
 	INIT_LIST_HEAD(&sfe_drv_ctx->msg_queue);
+	hash_init(sfe_drv_ctx->tun6rd_peers);
 	INIT_WORK(&sfe_drv_ctx->work, sfe_drv_process_response_msg);
 
 	/*
@@ -1304,6 +2754,8 @@ static void __exit sfe_drv_exit(void)
 	sfe_drv_ipv4_notify_unregister();
 	sfe_drv_ipv6_notify_unregister();
 
+	sfe_drv_tun6rd_peer_flush(sfe_drv_ctx);
+
 	kobject_put(sfe_drv_ctx->sys_sfe_drv);
 
 	return;
@@ -55,6 +55,7 @@
 #define SFE_RULE_CREATE_VLAN_MARKING_VALID (1<<6) /**< VLAN marking fields are valid */
 #define SFE_RULE_CREATE_MC_NAT_VALID       (1<<7) /**< Interface is configured with Source-NAT */
 #define SFE_RULE_CREATE_DIRECTION_VALID    (1<<8) /**< specify acceleration directions */
+#define SFE_RULE_CREATE_POLICE_VALID       (1<<9) /**< Policer fields are valid */
 
 typedef enum sfe_rule_sync_reason {
 	SFE_RULE_SYNC_REASON_STATS,	/* Sync is to synchronize stats */
@@ -92,6 +93,11 @@ enum sfe_cmn_response {
 	SFE_CMN_RESPONSE_LAST
 };
 
+/**
+ * Maximum number of rule messages carried by one batch message
+ */
+#define SFE_RULE_BATCH_MAX 16
+
 /**
  * IPv4 bridge/route rule messages
  */
@@ -101,6 +107,7 @@ enum sfe_message_types {
 	SFE_RX_CONN_STATS_SYNC_MSG,	/**< IPv4/6 connection stats sync message */
 	SFE_TX_CREATE_MC_RULE_MSG,	/**< IPv4/6 multicast create rule message */
 	SFE_TUN6RD_ADD_UPDATE_PEER,	/**< Add/update peer for 6rd tunnel */
+	SFE_TX_BATCH_RULE_MSG,		/**< IPv4/6 batch of create/destroy rule messages */
 	SFE_MAX_MSG_TYPES,		/**< IPv4/6 message max type number */
 };
 
@@ -216,6 +223,22 @@ struct sfe_dscp_rule {
 	u8 reserved[2];		/**< Padded for alignment */
 };
 
+/**
+ * Policer connection rule structure
+ *	A direction with a rate of 0 isn't policed.  The actions are
+ *	SFE_POLICE_ACTION_DROP or SFE_POLICE_ACTION_REMARK_DSCP.
+ */
+struct sfe_police_rule {
+	u64 flow_rate;		/**< Flow direction's rate in bytes per second */
+	u64 return_rate;	/**< Return direction's rate in bytes per second */
+	u32 flow_burst;		/**< Flow direction's burst in bytes */
+	u32 return_burst;	/**< Return direction's burst in bytes */
+	u8 flow_action;		/**< Action for flow direction packets that exceed the rate */
+	u8 return_action;	/**< Action for return direction packets that exceed the rate */
+	u8 flow_dscp;		/**< DSCP to remark exceeding flow direction packets with */
+	u8 return_dscp;		/**< DSCP to remark exceeding return direction packets with */
+};
+
 /**
  * VLAN connection rule structure
  */
@@ -251,6 +274,7 @@ struct sfe_ipv4_rule_create_msg {
 	struct sfe_dscp_rule dscp_rule;			/**< DSCP related accleration parameters */
 	struct sfe_vlan_rule vlan_primary_rule;		/**< Primary VLAN related accleration parameters */
 	struct sfe_vlan_rule vlan_secondary_rule;	/**< Secondary VLAN related accleration parameters */
+	struct sfe_police_rule police_rule;		/**< Policer related accleration parameters */
 #ifdef CONFIG_XFRM
 	struct sfe_acceleration_direction_rule direction_rule;/* Direction related accleration parameters*/
 #endif
@@ -310,6 +334,47 @@ struct sfe_ipv4_conn_sync {
 	u32 cause;			/**< Flush Cause */
 };
 
+/**
+ * Multicast egress interface rule structure.
+ *	rule_flags takes SFE_RULE_CREATE_FLAG_BRIDGE_FLOW/ROUTED and, in updates,
+ *	SFE_RULE_CREATE_FLAG_MC_JOIN/LEAVE.  valid_flags takes
+ *	SFE_RULE_CREATE_PPPOE_VALID, SFE_RULE_CREATE_VLAN_VALID and
+ *	SFE_RULE_CREATE_MC_NAT_VALID.
+ */
+struct sfe_mc_if_rule {
+	u16 rule_flags;		/**< Bit flags associated with the interface */
+	u16 valid_flags;		/**< Bit flags associated with the validity of parameters */
+	u32 egress_vlan_tag[MAX_VLAN_DEPTH];	/**< VLAN tags for egress packets */
+	u16 pppoe_session_id;	/**< PPPoE session ID */
+	u16 pppoe_remote_mac[3];	/**< PPPoE server MAC address */
+	s32 if_num;			/**< Interface number */
+	u32 if_mtu;			/**< Interface MTU */
+	u16 if_mac[3];		/**< Interface MAC address, used as the source of routed packets */
+	u16 reserved;		/**< Padded for alignment */
+};
+
+/**
+ * The IPv4 multicast rule create sub-message structure.
+ *	The egress interface rules are kept out of the message, so that multicast
+ *	does not grow every IPv4 message and batch; the sender owns the if_rule
+ *	array and may free it once sfe_drv_ipv4_tx() returns.
+ */
+struct sfe_ipv4_mc_rule_create_msg {
+	struct sfe_ipv4_5tuple tuple;		/**< Holds values of the 5 tuple, return_ip being the group */
+	u16 rule_flags;				/**< Bit flags associated with the rule */
+	u16 valid_flags;				/**< Bit flags associated with the validity of parameters */
+	s32 src_interface_num;			/**< Source interface number */
+	s32 src_top_interface_num;		/**< Top source interface number */
+	u32 ingress_vlan_tag[MAX_VLAN_DEPTH];	/**< VLAN tags for ingress packets */
+	u16 ingress_pppoe_session_id;		/**< Ingress PPPoE session ID */
+	u16 dest_mac[3];				/**< Group MAC address */
+	u32 qos_tag;				/**< QoS tag */
+	u8 egress_dscp;				/**< Egress DSCP value */
+	u8 reserved[3];				/**< Padded for alignment */
+	u32 if_count;				/**< Number of valid entries in if_rule */
+	struct sfe_mc_if_rule *if_rule;		/**< if_count egress interface rules, read only during the tx call */
+};
+
 /*
  * Message structure to send/receive IPv4 bridge/route commands
  */
@@ -319,6 +384,8 @@ struct sfe_ipv4_msg {
 		struct sfe_ipv4_rule_create_msg rule_create;	/**< Message: rule create */
 		struct sfe_ipv4_rule_destroy_msg rule_destroy;	/**< Message: rule destroy */
 		struct sfe_ipv4_conn_sync conn_stats;	/**< Message: connection stats sync */
+		struct sfe_ipv4_mc_rule_create_msg mc_rule_create;
+								/**< Message: multicast rule create */
 	} msg;
 };
 
@@ -327,6 +394,21 @@ struct sfe_ipv4_msg {
  */
 typedef void (*sfe_ipv4_msg_callback_t)(void *app_data, struct sfe_ipv4_msg *msg);
 
+/**
+ * Batch of IPv4 create/destroy rule messages, acknowledged by a single response.
+ * Each message keeps its own header; its cm.response holds the per-rule status.
+ */
+struct sfe_ipv4_batch_msg {
+	struct sfe_cmn_msg cm;				/**< Message Header */
+	u32 num_msgs;					/**< Number of valid entries in msgs */
+	struct sfe_ipv4_msg msgs[SFE_RULE_BATCH_MAX];	/**< Rule messages */
+};
+
+/**
+ * Callback to be called when an IPv4 batch response is received
+ */
+typedef void (*sfe_ipv4_batch_msg_callback_t)(void *app_data, struct sfe_ipv4_batch_msg *msg);
+
 /**
  * The IPv6 rule create sub-message structure.
  */
@@ -344,6 +426,7 @@ struct sfe_ipv6_rule_create_msg {
 	struct sfe_dscp_rule dscp_rule;			/**< DSCP related accleration parameters */
 	struct sfe_vlan_rule vlan_primary_rule;		/**< VLAN related accleration parameters */
 	struct sfe_vlan_rule vlan_secondary_rule;	/**< VLAN related accleration parameters */
+	struct sfe_police_rule police_rule;		/**< Policer related accleration parameters */
 #ifdef CONFIG_XFRM
 	struct sfe_acceleration_direction_rule direction_rule;/* Direction related accleration parameters*/
 #endif
@@ -400,6 +483,28 @@ struct sfe_ipv6_conn_sync {
 	u32 cause;			/**< Flush cause associated with the rule */
 };
 
+/**
+ * The IPv6 multicast rule create sub-message structure.
+ *	The egress interface rules are kept out of the message, so that multicast
+ *	does not grow every IPv6 message and batch; the sender owns the if_rule
+ *	array and may free it once sfe_drv_ipv6_tx() returns.
+ */
+struct sfe_ipv6_mc_rule_create_msg {
+	struct sfe_ipv6_5tuple tuple;		/**< Holds values of the 5 tuple, return_ip being the group */
+	u16 rule_flags;				/**< Bit flags associated with the rule */
+	u16 valid_flags;				/**< Bit flags associated with the validity of parameters */
+	s32 src_interface_num;			/**< Source interface number */
+	s32 src_top_interface_num;		/**< Top source interface number */
+	u32 ingress_vlan_tag[MAX_VLAN_DEPTH];	/**< VLAN tags for ingress packets */
+	u16 ingress_pppoe_session_id;		/**< Ingress PPPoE session ID */
+	u16 dest_mac[3];				/**< Group MAC address */
+	u32 qos_tag;				/**< QoS tag */
+	u8 egress_dscp;				/**< Egress DSCP value */
+	u8 reserved[3];				/**< Padded for alignment */
+	u32 if_count;				/**< Number of valid entries in if_rule */
+	struct sfe_mc_if_rule *if_rule;		/**< if_count egress interface rules, read only during the tx call */
+};
+
 /**
  * Message structure to send/receive IPv6 bridge/route commands
  */
@@ -409,6 +514,8 @@ struct sfe_ipv6_msg {
 		struct sfe_ipv6_rule_create_msg rule_create;	/**< Message: rule create */
 		struct sfe_ipv6_rule_destroy_msg rule_destroy;	/**< Message: rule destroy */
 		struct sfe_ipv6_conn_sync conn_stats;		/**< Message: stats sync */
+		struct sfe_ipv6_mc_rule_create_msg mc_rule_create;
+								/**< Message: multicast rule create */
 	} msg;
 };
 
@@ -417,6 +524,21 @@ struct sfe_ipv6_msg {
  */
 typedef void (*sfe_ipv6_msg_callback_t)(void *app_data, struct sfe_ipv6_msg *msg);
 
+/**
+ * Batch of IPv6 create/destroy rule messages, acknowledged by a single response.
+ * Each message keeps its own header; its cm.response holds the per-rule status.
+ */
+struct sfe_ipv6_batch_msg {
+	struct sfe_cmn_msg cm;				/**< Message Header */
+	u32 num_msgs;					/**< Number of valid entries in msgs */
+	struct sfe_ipv6_msg msgs[SFE_RULE_BATCH_MAX];	/**< Rule messages */
+};
+
+/**
+ * Callback to be called when an IPv6 batch response is received
+ */
+typedef void (*sfe_ipv6_batch_msg_callback_t)(void *app_data, struct sfe_ipv6_batch_msg *msg);
+
 /**
  * 6rd tunnel peer addr.
  */
@@ -461,6 +583,17 @@ int sfe_drv_ipv4_max_conn_count(void);
  */
 extern sfe_tx_status_t sfe_drv_ipv4_tx(struct sfe_drv_ctx_instance *sfe_drv_ctx, struct sfe_ipv4_msg *msg);
 
+/*
+ * sfe_drv_ipv4_tx_batch()
+ * 	Transmit a batch of IPv4 rule messages to the sfe
+ *
+ * @param sfe_drv_ctx sfe driver context
+ * @param batch The IPv4 batch message
+ *
+ * @return sfe_tx_status_t The status of the Tx operation
+ */
+extern sfe_tx_status_t sfe_drv_ipv4_tx_batch(struct sfe_drv_ctx_instance *sfe_drv_ctx, struct sfe_ipv4_batch_msg *batch);
+
 /*
  * sfe_drv_ipv4_notify_register()
  * 	Register a notifier callback for IPv4 messages from sfe driver
@@ -472,6 +605,17 @@ extern sfe_tx_status_t sfe_drv_ipv4_tx(struct sfe_drv_ctx_instance *sfe_drv_ctx,
  */
 extern struct sfe_drv_ctx_instance *sfe_drv_ipv4_notify_register(sfe_ipv4_msg_callback_t cb, void *app_data);
 
+/*
+ * sfe_drv_ipv4_notify_try_register()
+ * 	Register a notifier callback for IPv4 messages unless one is registered already
+ *
+ * @param cb The callback pointer
+ * @param app_data The application context for this message
+ *
+ * @return struct sfe_drv_ctx_instance * The sfe driver context, NULL if another callback owns it
+ */
+extern struct sfe_drv_ctx_instance *sfe_drv_ipv4_notify_try_register(sfe_ipv4_msg_callback_t cb, void *app_data);
+
 /*
  * sfe_drv_ipv4_notify_unregister()
  * 	Un-Register a notifier callback for IPv4 messages from sfe driver
@@ -485,6 +629,13 @@ extern void sfe_drv_ipv4_notify_unregister(void);
 extern void sfe_ipv4_msg_init(struct sfe_ipv4_msg *nim, u16 if_num, u32 type, u32 len,
 			sfe_ipv4_msg_callback_t cb, void *app_data);
 
+/*
+ * sfe_ipv4_batch_msg_init()
+ * 	IPv4 batch message init
+ */
+extern void sfe_ipv4_batch_msg_init(struct sfe_ipv4_batch_msg *batch, u16 if_num,
+			sfe_ipv4_batch_msg_callback_t cb, void *app_data);
+
 /*
  * sfe_drv_ipv6_max_conn_count()
  * 	Return the maximum number of IPv6 connections that the sfe acceleration engine supports
@@ -504,6 +655,17 @@ int sfe_drv_ipv6_max_conn_count(void);
  */
 extern sfe_tx_status_t sfe_drv_ipv6_tx(struct sfe_drv_ctx_instance *sfe_drv_ctx, struct sfe_ipv6_msg *msg);
 
+/*
+ * sfe_drv_ipv6_tx_batch()
+ * 	Transmit a batch of IPv6 rule messages to the sfe
+ *
+ * @param sfe_drv_ctx sfe driver context
+ * @param batch The IPv6 batch message
+ *
+ * @return sfe_tx_status_t The status of the Tx operation
+ */
+extern sfe_tx_status_t sfe_drv_ipv6_tx_batch(struct sfe_drv_ctx_instance *sfe_drv_ctx, struct sfe_ipv6_batch_msg *batch);
+
 /*
  * sfe_drv_ipv6_notify_register()
  * 	Register a notifier callback for IPv6 messages from sfe driver
@@ -528,6 +690,13 @@ extern void sfe_drv_ipv6_notify_unregister(void);
 extern void sfe_ipv6_msg_init(struct sfe_ipv6_msg *nim, u16 if_num, u32 type, u32 len,
 			sfe_ipv6_msg_callback_t cb, void *app_data);
 
+/*
+ * sfe_ipv6_batch_msg_init()
+ * 	IPv6 batch message init
+ */
+extern void sfe_ipv6_batch_msg_init(struct sfe_ipv6_batch_msg *batch, u16 if_num,
+			sfe_ipv6_batch_msg_callback_t cb, void *app_data);
+
 /*
  * sfe_tun6rd_tx()
  * 	Transmit a tun6rd message to sfe engine
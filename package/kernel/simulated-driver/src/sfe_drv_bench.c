@@ -0,0 +1,613 @@
+/*
+ * sfe_drv_bench.c
+ *	Connection setup benchmark for the simulated sfe driver.
+ *
+ * Copyright (c) 2015,2016 The Linux Foundation. All rights reserved.
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+ * OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * The benchmark drives synthetic flows through the same sfe_drv_ipv4_tx()
+ * create/destroy rule messages the ECM SFE front end sends from its accel
+ * path, and reports:
+ *
+ *	- connections per second for rule creation and destruction,
+ *	- latency percentiles of the synchronous rule install and of the
+ *	  asynchronous ACK delivered back through the message callback,
+ *	- slab memory consumed per accelerated connection.
+ *
+ * The flows are routed between two layer 3 interfaces given by ifindex,
+ * normally the veth pair created by sfe_drv_bench.sh.
+ *
+ * NOTE: The benchmark registers itself as the IPv4 notify owner of the sfe
+ * driver for the duration of a run. A run is refused with -EBUSY while
+ * another owner, such as ECM, is registered.
+ */
+#include <linux/module.h>
+#include <linux/version.h>
+#include <linux/sysfs.h>
+#include <linux/netdevice.h>
+#include <linux/etherdevice.h>
+#include <linux/vmalloc.h>
+#include <linux/sort.h>
+#include <linux/completion.h>
+#include <linux/sched/clock.h>
+#include <linux/vmstat.h>
+#include <linux/in.h>
+
+#include "../shortcut-fe/sfe.h"
+#include "../shortcut-fe/sfe_cm.h"
+#include "sfe_drv.h"
+
+#define SFE_DRV_BENCH_MAX_FLOWS 65535
+#define SFE_DRV_BENCH_PORTS_PER_IP 60000
+#define SFE_DRV_BENCH_BASE_PORT 1024
+#define SFE_DRV_BENCH_ACK_TIMEOUT (10 * HZ)
+
+/*
+ * Latency distribution summary
+ */
+struct sfe_drv_bench_latency {
+	u64 p50;			/* Median, in ns */
+	u64 p90;			/* 90th percentile, in ns */
+	u64 p99;			/* 99th percentile, in ns */
+	u64 max;			/* Worst case, in ns */
+};
+
+/*
+ * Benchmark state
+ */
+struct sfe_drv_bench {
+	struct kobject *sys_sfe_drv_bench;	/* sysfs linkage */
+	struct mutex lock;		/* Serialises configuration and runs */
+
+	/*
+	 * Configuration
+	 */
+	int src_ifindex;		/* Flow (LAN) side interface */
+	int dest_ifindex;		/* Return (WAN) side interface */
+	u32 flows;			/* Number of flows per run */
+	u8 protocol;			/* IPPROTO_UDP or IPPROTO_TCP */
+	__be32 src_ip;			/* First flow source address */
+	__be32 dest_ip;			/* Flow destination address */
+
+	/*
+	 * Per run scratch
+	 */
+	u64 *tx_start;			/* Per flow time the create message was sent */
+	u64 *setup_ns;			/* Per flow synchronous install time */
+	u64 *ack_ns;			/* Per flow time until the ACK callback */
+	atomic_t acks;			/* ACKs received for this run */
+	atomic_t nacks;			/* Negative responses received for this run */
+	atomic_t outstanding;		/* Responses still expected */
+	struct completion done;		/* Signalled when all responses arrived */
+
+	/*
+	 * Results of the last run
+	 */
+	u32 sent;			/* Create messages accepted by the driver */
+	u32 tx_failed;			/* Create messages rejected by the driver */
+	u64 create_ns;			/* Wall time to send all create messages */
+	u64 complete_ns;		/* Wall time until the last ACK */
+	u64 destroy_ns;			/* Wall time to destroy all rules */
+	long slab_bytes;		/* Slab growth while the rules existed */
+	struct sfe_drv_bench_latency setup;
+	struct sfe_drv_bench_latency ack;
+	bool valid;			/* Results hold a completed run */
+};
+
+static struct sfe_drv_bench __sfe_drv_bench;
+
+/*
+ * sfe_drv_bench_cmp_u64()
+ *	sort() comparator for latency samples.
+ */
+static int sfe_drv_bench_cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a;
+	u64 y = *(const u64 *)b;
+
+	if (x < y) {
+		return -1;
+	}
+	return x > y;
+}
+
+/*
+ * sfe_drv_bench_summarise()
+ *	Sort the samples and pick out the percentiles.
+ */
+static void sfe_drv_bench_summarise(u64 *samples, u32 count, struct sfe_drv_bench_latency *lat)
+{
+	memset(lat, 0, sizeof(*lat));
+	if (!count) {
+		return;
+	}
+
+	sort(samples, count, sizeof(u64), sfe_drv_bench_cmp_u64, NULL);
+	lat->p50 = samples[(count - 1) * 50 / 100];
+	lat->p90 = samples[(count - 1) * 90 / 100];
+	lat->p99 = samples[(count - 1) * 99 / 100];
+	lat->max = samples[count - 1];
+}
+
+/*
+ * sfe_drv_bench_rate()
+ *	Operations per second for count operations over ns nanoseconds.
+ */
+static u64 sfe_drv_bench_rate(u32 count, u64 ns)
+{
+	if (!ns) {
+		return 0;
+	}
+	return div64_u64((u64)count * NSEC_PER_SEC, ns);
+}
+
+/*
+ * sfe_drv_bench_slab_bytes()
+ *	Current unreclaimable slab usage, where SFE connections are allocated from.
+ */
+static long sfe_drv_bench_slab_bytes(void)
+{
+	return global_node_page_state(NR_SLAB_UNRECLAIMABLE) << PAGE_SHIFT;
+}
+
+/*
+ * sfe_drv_bench_flow_tuple()
+ *	Generate the 5 tuple of flow number idx.
+ */
+static void sfe_drv_bench_flow_tuple(struct sfe_drv_bench *sdb, u32 idx, struct sfe_ipv4_5tuple *tuple)
+{
+	tuple->protocol = sdb->protocol;
+	tuple->flow_ip = htonl(ntohl(sdb->src_ip) + idx / SFE_DRV_BENCH_PORTS_PER_IP);
+	tuple->flow_ident = htons(SFE_DRV_BENCH_BASE_PORT + idx % SFE_DRV_BENCH_PORTS_PER_IP);
+	tuple->return_ip = sdb->dest_ip;
+	tuple->return_ident = htons(80);
+}
+
+/*
+ * sfe_drv_bench_sync_callback()
+ *	Stats sync messages are of no interest to the benchmark.
+ */
+static void sfe_drv_bench_sync_callback(void *app_data, struct sfe_ipv4_msg *msg)
+{
+	return;
+}
+
+/*
+ * sfe_drv_bench_create_callback()
+ *	Response to a create rule message, called from the sfe driver work queue.
+ */
+static void sfe_drv_bench_create_callback(void *app_data, struct sfe_ipv4_msg *msg)
+{
+	struct sfe_drv_bench *sdb = &__sfe_drv_bench;
+	u32 idx = (u32)(unsigned long)app_data;
+
+	if (idx < sdb->flows) {
+		sdb->ack_ns[idx] = sched_clock() - sdb->tx_start[idx];
+	}
+
+	if (msg->cm.response == SFE_CMN_RESPONSE_ACK) {
+		atomic_inc(&sdb->acks);
+	} else {
+		atomic_inc(&sdb->nacks);
+	}
+
+	if (atomic_dec_and_test(&sdb->outstanding)) {
+		complete(&sdb->done);
+	}
+}
+
+/*
+ * sfe_drv_bench_run()
+ *	Create and then destroy sdb->flows connections, recording timings.
+ *
+ * Called with sdb->lock held.
+ */
+static int sfe_drv_bench_run(struct sfe_drv_bench *sdb)
+{
+	struct sfe_drv_ctx_instance *sfe_drv_ctx;
+	struct net_device *src_dev;
+	struct net_device *dest_dev;
+	struct sfe_ipv4_msg nim;
+	u8 flow_mac[ETH_ALEN];
+	u8 return_mac[ETH_ALEN];
+	u32 src_mtu, dest_mtu;
+	u32 acked;
+	u64 run_start;
+	long slab_before;
+	int result = 0;
+	u32 idx;
+
+	src_dev = dev_get_by_index(&init_net, sdb->src_ifindex);
+	if (!src_dev) {
+		DEBUG_ERROR("no source interface %d\n", sdb->src_ifindex);
+		return -ENODEV;
+	}
+
+	dest_dev = dev_get_by_index(&init_net, sdb->dest_ifindex);
+	if (!dest_dev) {
+		DEBUG_ERROR("no destination interface %d\n", sdb->dest_ifindex);
+		dev_put(src_dev);
+		return -ENODEV;
+	}
+
+	src_mtu = src_dev->mtu;
+	dest_mtu = dest_dev->mtu;
+	eth_random_addr(flow_mac);
+	eth_random_addr(return_mac);
+	dev_put(src_dev);
+	dev_put(dest_dev);
+
+	sdb->tx_start = vzalloc(sizeof(u64) * sdb->flows);
+	sdb->setup_ns = vzalloc(sizeof(u64) * sdb->flows);
+	sdb->ack_ns = vzalloc(sizeof(u64) * sdb->flows);
+	if (!sdb->tx_start || !sdb->setup_ns || !sdb->ack_ns) {
+		result = -ENOMEM;
+		goto done;
+	}
+
+	sdb->valid = false;
+	sdb->sent = 0;
+	sdb->tx_failed = 0;
+	atomic_set(&sdb->acks, 0);
+	atomic_set(&sdb->nacks, 0);
+
+	/*
+	 * Hold one extra count on outstanding so that the completion cannot
+	 * fire before every create message has been sent.
+	 */
+	atomic_set(&sdb->outstanding, 1);
+	reinit_completion(&sdb->done);
+
+	sfe_drv_ctx = sfe_drv_ipv4_notify_try_register(sfe_drv_bench_sync_callback, NULL);
+	if (!sfe_drv_ctx) {
+		DEBUG_ERROR("sfe driver IPv4 notifier is owned by someone else, is ECM loaded?\n");
+		result = -EBUSY;
+		goto done;
+	}
+
+	slab_before = sfe_drv_bench_slab_bytes();
+	run_start = sched_clock();
+	for (idx = 0; idx < sdb->flows; idx++) {
+		struct sfe_ipv4_rule_create_msg *nircm = &nim.msg.rule_create;
+		sfe_tx_status_t status;
+		u64 start;
+
+		/*
+		 * Build the message the way ecm_sfe_ported_ipv4_connection_accelerate() does
+		 * for a simple routed, non-NAT flow.
+		 */
+		memset(&nim, 0, sizeof(nim));
+		sfe_ipv4_msg_init(&nim, SFE_SPECIAL_INTERFACE_IPV4, SFE_TX_CREATE_RULE_MSG,
+				sizeof(struct sfe_ipv4_rule_create_msg),
+				sfe_drv_bench_create_callback,
+				(void *)(unsigned long)idx);
+
+		nircm->valid_flags = SFE_RULE_CREATE_CONN_VALID;
+		nircm->rule_flags = SFE_RULE_CREATE_FLAG_ROUTED;
+		sfe_drv_bench_flow_tuple(sdb, idx, &nircm->tuple);
+
+		nircm->conn_rule.flow_interface_num = sdb->src_ifindex;
+		nircm->conn_rule.return_interface_num = sdb->dest_ifindex;
+		nircm->conn_rule.flow_top_interface_num = sdb->src_ifindex;
+		nircm->conn_rule.return_top_interface_num = sdb->dest_ifindex;
+		nircm->conn_rule.flow_mtu = src_mtu;
+		nircm->conn_rule.return_mtu = dest_mtu;
+		nircm->conn_rule.flow_ip_xlate = nircm->tuple.flow_ip;
+		nircm->conn_rule.return_ip_xlate = nircm->tuple.return_ip;
+		nircm->conn_rule.flow_ident_xlate = nircm->tuple.flow_ident;
+		nircm->conn_rule.return_ident_xlate = nircm->tuple.return_ident;
+		memcpy(nircm->conn_rule.flow_mac, flow_mac, ETH_ALEN);
+		memcpy(nircm->conn_rule.return_mac, return_mac, ETH_ALEN);
+
+		if (sdb->protocol == IPPROTO_TCP) {
+			nircm->valid_flags |= SFE_RULE_CREATE_TCP_VALID;
+			nircm->rule_flags |= SFE_RULE_CREATE_FLAG_NO_SEQ_CHECK;
+		}
+
+		atomic_inc(&sdb->outstanding);
+		start = sched_clock();
+		sdb->tx_start[idx] = start;
+		status = sfe_drv_ipv4_tx(sfe_drv_ctx, &nim);
+		sdb->setup_ns[sdb->sent] = sched_clock() - start;
+		if (status != SFE_TX_SUCCESS) {
+			atomic_dec(&sdb->outstanding);
+			sdb->tx_failed++;
+			continue;
+		}
+		sdb->sent++;
+
+		if (!(idx & 0xff)) {
+			cond_resched();
+		}
+	}
+	sdb->create_ns = sched_clock() - run_start;
+
+	/*
+	 * Drop our extra count and wait for the remaining ACKs.
+	 */
+	if (!atomic_dec_and_test(&sdb->outstanding)) {
+		if (!wait_for_completion_timeout(&sdb->done, SFE_DRV_BENCH_ACK_TIMEOUT)) {
+			DEBUG_WARN("timed out with %d responses outstanding\n", atomic_read(&sdb->outstanding));
+			result = -ETIMEDOUT;
+		}
+	}
+	sdb->complete_ns = sched_clock() - run_start;
+	sdb->slab_bytes = sfe_drv_bench_slab_bytes() - slab_before;
+
+	/*
+	 * Tear everything down again, timing the destroy path.
+	 */
+	run_start = sched_clock();
+	for (idx = 0; idx < sdb->flows; idx++) {
+		memset(&nim, 0, sizeof(nim));
+		sfe_ipv4_msg_init(&nim, SFE_SPECIAL_INTERFACE_IPV4, SFE_TX_DESTROY_RULE_MSG,
+				sizeof(struct sfe_ipv4_rule_destroy_msg), NULL, NULL);
+		sfe_drv_bench_flow_tuple(sdb, idx, &nim.msg.rule_destroy.tuple);
+		sfe_drv_ipv4_tx(sfe_drv_ctx, &nim);
+
+		if (!(idx & 0xff)) {
+			cond_resched();
+		}
+	}
+	sdb->destroy_ns = sched_clock() - run_start;
+
+	/*
+	 * Unregistering flushes any responses we did not wait for, after which
+	 * no callback can reference the sample arrays any more.
+	 */
+	sfe_drv_ipv4_notify_unregister();
+	synchronize_rcu();
+
+	/*
+	 * Flows whose response never arrived have no ACK sample; pack the
+	 * valid ones to the front.
+	 */
+	for (acked = 0, idx = 0; idx < sdb->flows; idx++) {
+		if (sdb->ack_ns[idx]) {
+			sdb->ack_ns[acked++] = sdb->ack_ns[idx];
+		}
+	}
+
+	sfe_drv_bench_summarise(sdb->setup_ns, sdb->sent, &sdb->setup);
+	sfe_drv_bench_summarise(sdb->ack_ns, acked, &sdb->ack);
+	sdb->valid = true;
+
+done:
+	vfree(sdb->tx_start);
+	vfree(sdb->setup_ns);
+	vfree(sdb->ack_ns);
+	sdb->tx_start = NULL;
+	sdb->setup_ns = NULL;
+	sdb->ack_ns = NULL;
+
+	return result;
+}
+
+/*
+ * sfe_drv_bench_get_results()
+ *	Dump the results of the last run.
+ */
+static ssize_t sfe_drv_bench_get_results(struct device *dev,
+					struct device_attribute *attr,
+					char *buf)
+{
+	struct sfe_drv_bench *sdb = &__sfe_drv_bench;
+	u32 acks;
+	ssize_t len;
+
+	mutex_lock(&sdb->lock);
+	if (!sdb->valid) {
+		mutex_unlock(&sdb->lock);
+		return snprintf(buf, PAGE_SIZE, "no results\n");
+	}
+
+	acks = atomic_read(&sdb->acks);
+	len = snprintf(buf, PAGE_SIZE,
+			"flows = %u\n"
+			"protocol = %u\n"
+			"sent = %u\n"
+			"tx_failed = %u\n"
+			"acks = %u\n"
+			"nacks = %d\n"
+			"create_cps = %llu\n"
+			"complete_cps = %llu\n"
+			"destroy_cps = %llu\n"
+			"setup_ns_p50 = %llu\n"
+			"setup_ns_p90 = %llu\n"
+			"setup_ns_p99 = %llu\n"
+			"setup_ns_max = %llu\n"
+			"ack_ns_p50 = %llu\n"
+			"ack_ns_p90 = %llu\n"
+			"ack_ns_p99 = %llu\n"
+			"ack_ns_max = %llu\n"
+			"bytes_per_conn = %ld\n",
+			sdb->flows, sdb->protocol, sdb->sent, sdb->tx_failed,
+			acks, atomic_read(&sdb->nacks),
+			sfe_drv_bench_rate(sdb->sent, sdb->create_ns),
+			sfe_drv_bench_rate(acks, sdb->complete_ns),
+			sfe_drv_bench_rate(sdb->flows, sdb->destroy_ns),
+			sdb->setup.p50, sdb->setup.p90, sdb->setup.p99, sdb->setup.max,
+			sdb->ack.p50, sdb->ack.p90, sdb->ack.p99, sdb->ack.max,
+			acks ? sdb->slab_bytes / (long)acks : 0);
+	mutex_unlock(&sdb->lock);
+
+	return len;
+}
+
+/*
+ * sfe_drv_bench_set_run()
+ *	Start a run; the write returns once it has completed.
+ */
+static ssize_t sfe_drv_bench_set_run(struct device *dev,
+				    struct device_attribute *attr,
+				    const char *buf, size_t count)
+{
+	struct sfe_drv_bench *sdb = &__sfe_drv_bench;
+	int result;
+
+	mutex_lock(&sdb->lock);
+	if (!sdb->flows || !sdb->src_ifindex || !sdb->dest_ifindex) {
+		mutex_unlock(&sdb->lock);
+		return -EINVAL;
+	}
+
+	result = sfe_drv_bench_run(sdb);
+	mutex_unlock(&sdb->lock);
+
+	return result ? result : count;
+}
+
+/*
+ * sfe_drv_bench_get_config()
+ *	Show the benchmark configuration.
+ */
+static ssize_t sfe_drv_bench_get_config(struct device *dev,
+				       struct device_attribute *attr,
+				       char *buf)
+{
+	struct sfe_drv_bench *sdb = &__sfe_drv_bench;
+	ssize_t len;
+
+	mutex_lock(&sdb->lock);
+	len = snprintf(buf, PAGE_SIZE, "%d %d %u %u %pI4 %pI4\n",
+			sdb->src_ifindex, sdb->dest_ifindex, sdb->flows, sdb->protocol,
+			&sdb->src_ip, &sdb->dest_ip);
+	mutex_unlock(&sdb->lock);
+
+	return len;
+}
+
+/*
+ * sfe_drv_bench_set_config()
+ *	Configure a run: "<src ifindex> <dest ifindex> <flows> <protocol> <src ip> <dest ip>"
+ */
+static ssize_t sfe_drv_bench_set_config(struct device *dev,
+				       struct device_attribute *attr,
+				       const char *buf, size_t count)
+{
+	struct sfe_drv_bench *sdb = &__sfe_drv_bench;
+	int src_ifindex, dest_ifindex;
+	unsigned int flows, protocol;
+	u8 src_ip[4], dest_ip[4];
+
+	if (sscanf(buf, "%d %d %u %u %hhu.%hhu.%hhu.%hhu %hhu.%hhu.%hhu.%hhu",
+		   &src_ifindex, &dest_ifindex, &flows, &protocol,
+		   &src_ip[0], &src_ip[1], &src_ip[2], &src_ip[3],
+		   &dest_ip[0], &dest_ip[1], &dest_ip[2], &dest_ip[3]) != 12) {
+		return -EINVAL;
+	}
+
+	if (!flows || (flows > SFE_DRV_BENCH_MAX_FLOWS)) {
+		return -EINVAL;
+	}
+
+	if ((protocol != IPPROTO_UDP) && (protocol != IPPROTO_TCP)) {
+		return -EINVAL;
+	}
+
+	mutex_lock(&sdb->lock);
+	sdb->src_ifindex = src_ifindex;
+	sdb->dest_ifindex = dest_ifindex;
+	sdb->flows = flows;
+	sdb->protocol = (u8)protocol;
+	memcpy(&sdb->src_ip, src_ip, sizeof(sdb->src_ip));
+	memcpy(&sdb->dest_ip, dest_ip, sizeof(sdb->dest_ip));
+	sdb->valid = false;
+	mutex_unlock(&sdb->lock);
+
+	return count;
+}
+
+/*
+ * sysfs attributes.
+ */
+static const struct device_attribute sfe_drv_bench_config_attr =
+	__ATTR(config, S_IWUSR | S_IRUGO, sfe_drv_bench_get_config, sfe_drv_bench_set_config);
+static const struct device_attribute sfe_drv_bench_run_attr =
+	__ATTR(run, S_IWUSR, NULL, sfe_drv_bench_set_run);
+static const struct device_attribute sfe_drv_bench_results_attr =
+	__ATTR(results, S_IRUGO, sfe_drv_bench_get_results, NULL);
+
+/*
+ * sfe_drv_bench_init()
+ */
+static int __init sfe_drv_bench_init(void)
+{
+	struct sfe_drv_bench *sdb = &__sfe_drv_bench;
+	int result = -1;
+
+	mutex_init(&sdb->lock);
+	init_completion(&sdb->done);
+
+	/*
+	 * Create sys/sfe_drv_bench
+	 */
+	sdb->sys_sfe_drv_bench = kobject_create_and_add("sfe_drv_bench", NULL);
+	if (!sdb->sys_sfe_drv_bench) {
+		DEBUG_ERROR("failed to register sfe_drv_bench\n");
+		goto exit1;
+	}
+
+	result = sysfs_create_file(sdb->sys_sfe_drv_bench, &sfe_drv_bench_config_attr.attr);
+	if (result) {
+		DEBUG_ERROR("failed to register config file: %d\n", result);
+		goto exit2;
+	}
+
+	result = sysfs_create_file(sdb->sys_sfe_drv_bench, &sfe_drv_bench_run_attr.attr);
+	if (result) {
+		DEBUG_ERROR("failed to register run file: %d\n", result);
+		goto exit3;
+	}
+
+	result = sysfs_create_file(sdb->sys_sfe_drv_bench, &sfe_drv_bench_results_attr.attr);
+	if (result) {
+		DEBUG_ERROR("failed to register results file: %d\n", result);
+		goto exit4;
+	}
+
+	return 0;
+
+exit4:
+	sysfs_remove_file(sdb->sys_sfe_drv_bench, &sfe_drv_bench_run_attr.attr);
+exit3:
+	sysfs_remove_file(sdb->sys_sfe_drv_bench, &sfe_drv_bench_config_attr.attr);
+exit2:
+	kobject_put(sdb->sys_sfe_drv_bench);
+exit1:
+	return result;
+}
+
+/*
+ * sfe_drv_bench_exit()
+ */
+static void __exit sfe_drv_bench_exit(void)
+{
+	struct sfe_drv_bench *sdb = &__sfe_drv_bench;
+
+	/*
+	 * Removing the files waits for any run in progress to finish.
+	 */
+	sysfs_remove_file(sdb->sys_sfe_drv_bench, &sfe_drv_bench_results_attr.attr);
+	sysfs_remove_file(sdb->sys_sfe_drv_bench, &sfe_drv_bench_run_attr.attr);
+	sysfs_remove_file(sdb->sys_sfe_drv_bench, &sfe_drv_bench_config_attr.attr);
+	kobject_put(sdb->sys_sfe_drv_bench);
+}
+
+module_init(sfe_drv_bench_init)
+module_exit(sfe_drv_bench_exit)
+
+MODULE_AUTHOR("Qualcomm Atheros Inc.");
+MODULE_DESCRIPTION("Connection setup benchmark for the simulated sfe driver");
+MODULE_LICENSE("Dual BSD/GPL");
@@ -0,0 +1,329 @@
+/*
+ * flowdump.c
+ *	Read the binary connection table snapshots exported by SFE and ECM.
+ *
+ * Copyright (c) 2015 The Linux Foundation. All rights reserved.
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all copies.
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+ * OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/types.h>
+
+#include "sfe_export.h"
+#include "ecm_state_export.h"
+
+/*
+ * Both snapshot headers share this layout.
+ */
+struct flowdump_hdr {
+	__u32 magic;
+	__u16 version;
+	__u16 record_size;
+	__u32 num_records;
+	__u32 flags;
+};
+
+/*
+ * Description of one of the exported tables.
+ */
+struct flowdump_source {
+	const char *name;		/* Name given on the command line */
+	const char *major_file;		/* File holding the major number of the char device */
+	const char *dev;		/* Device node for the export minor */
+	int minor;			/* Export minor */
+	__u32 magic;			/* Expected snapshot magic */
+	__u16 version;			/* Expected snapshot version */
+	__u16 record_size;		/* Expected record size */
+	__u32 truncated_flag;		/* Flag set when the snapshot is incomplete */
+	void (*print)(const struct flowdump_hdr *hdr, const void *rec);
+	void (*total)(const void *rec, unsigned long long *packets, unsigned long long *bytes);
+};
+
+/*
+ * flowdump_proto()
+ */
+static const char *flowdump_proto(int protocol)
+{
+	static char buf[8];
+
+	switch (protocol) {
+	case IPPROTO_TCP:
+		return "tcp";
+	case IPPROTO_UDP:
+		return "udp";
+	case IPPROTO_ICMP:
+		return "icmp";
+	case IPPROTO_ICMPV6:
+		return "icmpv6";
+	}
+
+	snprintf(buf, sizeof(buf), "%d", protocol);
+	return buf;
+}
+
+/*
+ * flowdump_addr()
+ */
+static const char *flowdump_addr(const __be32 *addr, int is_v6, char *buf, size_t len)
+{
+	return inet_ntop(is_v6 ? AF_INET6 : AF_INET, addr, buf, len);
+}
+
+/*
+ * flowdump_sfe_print()
+ */
+static void flowdump_sfe_print(const struct flowdump_hdr *hdr, const void *rec)
+{
+	const struct sfe_export_conn *c = rec;
+	int is_v6 = !!(hdr->flags & SFE_EXPORT_FLAG_IPV6);
+	char src[INET6_ADDRSTRLEN], src_xlate[INET6_ADDRSTRLEN];
+	char dest[INET6_ADDRSTRLEN], dest_xlate[INET6_ADDRSTRLEN];
+
+	printf("%s %s:%u (%s:%u) -> %s:%u (%s:%u) if %u/%u "
+	       "pkts %llu/%llu bytes %llu/%llu sync %ums mark %08x\n",
+	       flowdump_proto(c->protocol),
+	       flowdump_addr(c->src_ip, is_v6, src, sizeof(src)), ntohs(c->src_port),
+	       flowdump_addr(c->src_ip_xlate, is_v6, src_xlate, sizeof(src_xlate)), ntohs(c->src_port_xlate),
+	       flowdump_addr(c->dest_ip, is_v6, dest, sizeof(dest)), ntohs(c->dest_port),
+	       flowdump_addr(c->dest_ip_xlate, is_v6, dest_xlate, sizeof(dest_xlate)), ntohs(c->dest_port_xlate),
+	       c->src_ifindex, c->dest_ifindex,
+	       (unsigned long long)c->src_rx_packets, (unsigned long long)c->dest_rx_packets,
+	       (unsigned long long)c->src_rx_bytes, (unsigned long long)c->dest_rx_bytes,
+	       c->last_sync_ms, c->mark);
+}
+
+/*
+ * flowdump_sfe_total()
+ */
+static void flowdump_sfe_total(const void *rec, unsigned long long *packets, unsigned long long *bytes)
+{
+	const struct sfe_export_conn *c = rec;
+
+	*packets += c->src_rx_packets + c->dest_rx_packets;
+	*bytes += c->src_rx_bytes + c->dest_rx_bytes;
+}
+
+/*
+ * flowdump_ecm_print()
+ */
+static void flowdump_ecm_print(const struct flowdump_hdr *hdr __attribute__((unused)), const void *rec)
+{
+	const struct ecm_state_export_conn *c = rec;
+	int is_v6 = (c->ip_version == 6);
+	char from[INET6_ADDRSTRLEN], from_nat[INET6_ADDRSTRLEN];
+	char to[INET6_ADDRSTRLEN], to_nat[INET6_ADDRSTRLEN];
+
+	printf("%u ipv%u %s %s:%u (%s:%u) -> %s:%u (%s:%u) if %d/%d %s "
+	       "pkts %llu/%llu bytes %llu/%llu dropped %llu/%llu age %us\n",
+	       c->serial, c->ip_version, flowdump_proto(c->protocol),
+	       flowdump_addr(c->from_ip, is_v6, from, sizeof(from)), c->from_port,
+	       flowdump_addr(c->from_ip_nat, is_v6, from_nat, sizeof(from_nat)), c->from_port_nat,
+	       flowdump_addr(c->to_ip, is_v6, to, sizeof(to)), c->to_port,
+	       flowdump_addr(c->to_ip_nat, is_v6, to_nat, sizeof(to_nat)), c->to_port_nat,
+	       c->from_ifindex, c->to_ifindex,
+	       c->is_routed ? "routed" : "bridged",
+	       (unsigned long long)c->from_packet_total, (unsigned long long)c->to_packet_total,
+	       (unsigned long long)c->from_data_total, (unsigned long long)c->to_data_total,
+	       (unsigned long long)c->from_packet_total_dropped, (unsigned long long)c->to_packet_total_dropped,
+	       c->age);
+}
+
+/*
+ * flowdump_ecm_total()
+ */
+static void flowdump_ecm_total(const void *rec, unsigned long long *packets, unsigned long long *bytes)
+{
+	const struct ecm_state_export_conn *c = rec;
+
+	*packets += c->from_packet_total + c->to_packet_total;
+	*bytes += c->from_data_total + c->to_data_total;
+}
+
+static const struct flowdump_source flowdump_sources[] = {
+	{
+		"sfe4", "/sys/sfe_ipv4/debug_dev", "/dev/sfe_ipv4_export", SFE_EXPORT_MINOR,
+		SFE_EXPORT_MAGIC, SFE_EXPORT_VERSION, sizeof(struct sfe_export_conn), SFE_EXPORT_FLAG_TRUNCATED,
+		flowdump_sfe_print, flowdump_sfe_total
+	},
+	{
+		"sfe6", "/sys/sfe_ipv6/debug_dev", "/dev/sfe_ipv6_export", SFE_EXPORT_MINOR,
+		SFE_EXPORT_MAGIC, SFE_EXPORT_VERSION, sizeof(struct sfe_export_conn), SFE_EXPORT_FLAG_TRUNCATED,
+		flowdump_sfe_print, flowdump_sfe_total
+	},
+	{
+		"ecm", "/sys/kernel/debug/ecm/ecm_state/state_dev_major", "/dev/ecm_state_export", ECM_STATE_EXPORT_MINOR,
+		ECM_STATE_EXPORT_MAGIC, ECM_STATE_EXPORT_VERSION, sizeof(struct ecm_state_export_conn), ECM_STATE_EXPORT_FLAG_TRUNCATED,
+		flowdump_ecm_print, flowdump_ecm_total
+	},
+};
+
+/*
+ * flowdump_dev_node()
+ *	Make sure the device node for the export minor exists.
+ */
+static int flowdump_dev_node(const struct flowdump_source *src)
+{
+	FILE *f;
+	int major;
+
+	if (!access(src->dev, F_OK)) {
+		return 0;
+	}
+
+	f = fopen(src->major_file, "r");
+	if (!f) {
+		fprintf(stderr, "%s: %s\n", src->major_file, strerror(errno));
+		return -1;
+	}
+
+	if (fscanf(f, "%d", &major) != 1) {
+		fprintf(stderr, "%s: no major number\n", src->major_file);
+		fclose(f);
+		return -1;
+	}
+	fclose(f);
+
+	if (mknod(src->dev, S_IFCHR | 0400, makedev(major, src->minor))) {
+		fprintf(stderr, "%s: %s\n", src->dev, strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * flowdump_snapshot()
+ *	Take and output one snapshot.
+ */
+static int flowdump_snapshot(const struct flowdump_source *src, int summary)
+{
+	struct flowdump_hdr hdr;
+	unsigned long long packets = 0;
+	unsigned long long bytes = 0;
+	const char *rec;
+	void *map;
+	size_t size;
+	__u32 i;
+	int fd;
+
+	fd = open(src->dev, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "%s: %s\n", src->dev, strerror(errno));
+		return -1;
+	}
+
+	if (read(fd, &hdr, sizeof(hdr)) != sizeof(hdr)) {
+		fprintf(stderr, "%s: short read\n", src->dev);
+		close(fd);
+		return -1;
+	}
+
+	if ((hdr.magic != src->magic) || (hdr.version != src->version) || (hdr.record_size != src->record_size)) {
+		fprintf(stderr, "%s: unsupported snapshot %08x version %u record size %u\n",
+			src->dev, hdr.magic, hdr.version, hdr.record_size);
+		close(fd);
+		return -1;
+	}
+
+	size = sizeof(hdr) + (size_t)hdr.num_records * hdr.record_size;
+	map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "%s: mmap: %s\n", src->dev, strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	rec = (const char *)map + sizeof(hdr);
+	for (i = 0; i < hdr.num_records; i++, rec += hdr.record_size) {
+		src->total(rec, &packets, &bytes);
+		if (!summary) {
+			src->print(&hdr, rec);
+		}
+	}
+
+	printf("%s: connections %u packets %llu bytes %llu%s\n", src->name, hdr.num_records,
+	       packets, bytes, (hdr.flags & src->truncated_flag) ? " (truncated)" : "");
+
+	munmap(map, size);
+	close(fd);
+	return 0;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-s] [-i <seconds>] (sfe4|sfe6|ecm)\n"
+		"\t-s\tonly print the summary line\n"
+		"\t-i\ttake a snapshot every <seconds> seconds\n", name);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	const struct flowdump_source *src = NULL;
+	int summary = 0;
+	int interval = 0;
+	unsigned int i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "si:")) != -1) {
+		switch (opt) {
+		case 's':
+			summary = 1;
+			break;
+		case 'i':
+			interval = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (optind != argc - 1) {
+		usage(argv[0]);
+	}
+
+	for (i = 0; i < sizeof(flowdump_sources) / sizeof(flowdump_sources[0]); i++) {
+		if (!strcmp(argv[optind], flowdump_sources[i].name)) {
+			src = &flowdump_sources[i];
+		}
+	}
+
+	if (!src) {
+		usage(argv[0]);
+	}
+
+	if (flowdump_dev_node(src)) {
+		return 1;
+	}
+
+	do {
+		if (flowdump_snapshot(src, summary)) {
+			return 1;
+		}
+
+		fflush(stdout);
+		if (interval > 0) {
+			sleep(interval);
+		}
+	} while (interval > 0);
+
+	return 0;
+}